@@ -351,7 +351,7 @@ void ShapesApp::OnMouseMove(WPARAM btnState, int x, int y)
  
 void ShapesApp::OnKeyboardInput(const GameTimer& gt)
 {
-    if(GetAsyncKeyState('1') & 0x8000)
+    if(IsKeyDown('1'))
         mIsWireframe = true;
     else
         mIsWireframe = false;
@@ -382,7 +382,7 @@ void SkullApp::OnMouseMove(WPARAM btnState, int x, int y)
  
 void SkullApp::OnKeyboardInput(const GameTimer& gt)
 {
-    if(GetAsyncKeyState('1') & 0x8000)
+    if(IsKeyDown('1'))
         mIsWireframe = true;
     else
         mIsWireframe = false;
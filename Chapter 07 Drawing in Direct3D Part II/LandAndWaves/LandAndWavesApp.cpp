@@ -8,8 +8,10 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/ThreadPool.h"
 #include "FrameResource.h"
-#include "Waves.h"
+#include "LandAndWavesScene.h"
+#include "LandAndWavesHeadless.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -17,6 +19,11 @@ using namespace DirectX::PackedVector;
 
 const int gNumFrameResources = 3;
 
+// LandAndWavesScene writes these through its SimdMath mirrors.
+static_assert(sizeof(ObjectConstants) == sizeof(LandAndWavesScene::ObjectConstants), "ObjectConstants layout");
+static_assert(sizeof(PassConstants) == sizeof(LandAndWavesScene::PassConstants), "PassConstants layout");
+static_assert(sizeof(Vertex) == sizeof(LandAndWavesScene::Vertex), "Vertex layout");
+
 // Lightweight structure stores parameters to draw a shape.  This will
 // vary from app-to-app.
 struct RenderItem
@@ -74,7 +81,6 @@ private:
     virtual void OnMouseMove(WPARAM btnState, int x, int y)override;
 
 	void OnKeyboardInput(const GameTimer& gt);
-	void UpdateCamera(const GameTimer& gt);
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
 	void UpdateWaves(const GameTimer& gt);
@@ -115,20 +121,14 @@ private:
 	// Render items divided by PSO.
 	std::vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
 
-	std::unique_ptr<Waves> mWaves;
+	// The camera and the wave simulation, shared with LandAndWavesHeadless.
+	ThreadPool mThreadPool;
+	LandAndWavesScene mScene{ &mThreadPool };
 
     PassConstants mMainPassCB;
 
     bool mIsWireframe = false;
 
-	XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
-	XMFLOAT4X4 mView = MathHelper::Identity4x4();
-	XMFLOAT4X4 mProj = MathHelper::Identity4x4();
-
-    float mTheta = 1.5f*XM_PI;
-    float mPhi = XM_PIDIV2 - 0.1f;
-    float mRadius = 50.0f;
-
 	float mSunTheta = 1.25f*XM_PI;
 	float mSunPhi = XM_PIDIV4;
 
@@ -143,6 +143,26 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
     _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
 
+    // "-headless" runs the CPU side of Update and Draw without a window or a
+    // device and writes the timings to the debugger output; see HeadlessRunner.h.
+    if(strstr(cmdLine, "-headless") != nullptr)
+    {
+        HeadlessRunner::Settings settings;
+        if(!HeadlessRunner::ParseCommandLine(cmdLine, &settings))
+        {
+            OutputDebugStringA("usage: -headless [-frames N] [-warmup N] [-dt seconds] [-csv file] [-json file]\n");
+            return 1;
+        }
+
+        LandAndWavesHeadless app;
+        HeadlessRunner runner(settings);
+        bool ok = runner.Run(app);
+
+        OutputDebugStringA(runner.GetReport().ToString().c_str());
+
+        return ok ? 0 : 1;
+    }
+
     try
     {
         LandAndWavesApp theApp(hInstance);
@@ -177,8 +197,6 @@ bool LandAndWavesApp::Initialize()
     // Reset the command list to prep for initialization commands.
     ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
 
-	mWaves = std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f);
-
     BuildRootSignature();
     BuildShadersAndInputLayout();
 	BuildLandGeometry();
@@ -204,14 +222,16 @@ void LandAndWavesApp::OnResize()
     D3DApp::OnResize();
 
     // The window resized, so update the aspect ratio and recompute the projection matrix.
-    XMMATRIX P = XMMatrixPerspectiveFovLH(0.25f*MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
-    XMStoreFloat4x4(&mProj, P);
+    mScene.OnResize((float)mClientWidth, (float)mClientHeight);
 }
 
 void LandAndWavesApp::Update(const GameTimer& gt)
 {
 	OnKeyboardInput(gt);
-	UpdateCamera(gt);
+
+	// Move the camera and step the waves while the GPU may still be reading
+	// the frame resource about to be reused.
+	mScene.Update(gt.DeltaTime());
 
 	// Cycle through the circular frame resource array.
 	mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % gNumFrameResources;
@@ -319,11 +339,7 @@ void LandAndWavesApp::OnMouseMove(WPARAM btnState, int x, int y)
         float dy = XMConvertToRadians(0.25f*static_cast<float>(y - mLastMousePos.y));
 
         // Update angles based on input to orbit camera around box.
-        mTheta += dx;
-        mPhi += dy;
-
-        // Restrict the angle mPhi.
-        mPhi = MathHelper::Clamp(mPhi, 0.1f, MathHelper::Pi - 0.1f);
+        mScene.Orbit(dx, dy);
     }
     else if((btnState & MK_RBUTTON) != 0)
     {
@@ -332,10 +348,7 @@ void LandAndWavesApp::OnMouseMove(WPARAM btnState, int x, int y)
         float dy = 0.2f*static_cast<float>(y - mLastMousePos.y);
 
         // Update the camera radius based on input.
-        mRadius += dx - dy;
-
-        // Restrict the radius.
-        mRadius = MathHelper::Clamp(mRadius, 5.0f, 150.0f);
+        mScene.Zoom(dx - dy);
     }
 
     mLastMousePos.x = x;
@@ -344,28 +357,12 @@ void LandAndWavesApp::OnMouseMove(WPARAM btnState, int x, int y)
 
 void LandAndWavesApp::OnKeyboardInput(const GameTimer& gt)
 {
-    if(GetAsyncKeyState('1') & 0x8000)
+    if(IsKeyDown('1'))
         mIsWireframe = true;
     else
         mIsWireframe = false;
 }
 
-void LandAndWavesApp::UpdateCamera(const GameTimer& gt)
-{
-	// Convert Spherical to Cartesian coordinates.
-	mEyePos.x = mRadius*sinf(mPhi)*cosf(mTheta);
-	mEyePos.z = mRadius*sinf(mPhi)*sinf(mTheta);
-	mEyePos.y = mRadius*cosf(mPhi);
-
-	// Build the view matrix.
-	XMVECTOR pos = XMVectorSet(mEyePos.x, mEyePos.y, mEyePos.z, 1.0f);
-	XMVECTOR target = XMVectorZero();
-	XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
-
-	XMMATRIX view = XMMatrixLookAtLH(pos, target, up);
-	XMStoreFloat4x4(&mView, view);
-}
-
 void LandAndWavesApp::UpdateObjectCBs(const GameTimer& gt)
 {
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
@@ -375,12 +372,10 @@ void LandAndWavesApp::UpdateObjectCBs(const GameTimer& gt)
 		// This needs to be tracked per frame resource.
 		if(e->NumFramesDirty > 0)
 		{
-			XMMATRIX world = XMLoadFloat4x4(&e->World);
+			auto objConstants = LandAndWavesScene::GetObjectConstants(
+				reinterpret_cast<const SimdMath::Float4x4&>(e->World));
 
-			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
+			currObjectCB->CopyData(e->ObjCBIndex, reinterpret_cast<const ObjectConstants&>(objConstants));
 
 			// Next FrameResource need to be updated too.
 			e->NumFramesDirty--;
@@ -390,27 +385,8 @@ void LandAndWavesApp::UpdateObjectCBs(const GameTimer& gt)
 
 void LandAndWavesApp::UpdateMainPassCB(const GameTimer& gt)
 {
-	XMMATRIX view = XMLoadFloat4x4(&mView);
-	XMMATRIX proj = XMLoadFloat4x4(&mProj);
-
-	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
-	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
-	XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
-	XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
-
-	XMStoreFloat4x4(&mMainPassCB.View, XMMatrixTranspose(view));
-	XMStoreFloat4x4(&mMainPassCB.InvView, XMMatrixTranspose(invView));
-	XMStoreFloat4x4(&mMainPassCB.Proj, XMMatrixTranspose(proj));
-	XMStoreFloat4x4(&mMainPassCB.InvProj, XMMatrixTranspose(invProj));
-	XMStoreFloat4x4(&mMainPassCB.ViewProj, XMMatrixTranspose(viewProj));
-	XMStoreFloat4x4(&mMainPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
-	mMainPassCB.EyePosW = mEyePos;
-	mMainPassCB.RenderTargetSize = XMFLOAT2((float)mClientWidth, (float)mClientHeight);
-	mMainPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / mClientWidth, 1.0f / mClientHeight);
-	mMainPassCB.NearZ = 1.0f;
-	mMainPassCB.FarZ = 1000.0f;
-	mMainPassCB.TotalTime = gt.TotalTime();
-	mMainPassCB.DeltaTime = gt.DeltaTime();
+	mScene.GetPassConstants(gt.TotalTime(), gt.DeltaTime(),
+		reinterpret_cast<LandAndWavesScene::PassConstants*>(&mMainPassCB));
 
 	auto currPassCB = mCurrFrameResource->PassCB.get();
 	currPassCB->CopyData(0, mMainPassCB);
@@ -418,33 +394,12 @@ void LandAndWavesApp::UpdateMainPassCB(const GameTimer& gt)
 
 void LandAndWavesApp::UpdateWaves(const GameTimer& gt)
 {
-	// Every quarter second, generate a random wave.
-	static float t_base = 0.0f;
-	if((mTimer.TotalTime() - t_base) >= 0.25f)
-	{
-		t_base += 0.25f;
-
-		int i = MathHelper::Rand(4, mWaves->RowCount() - 5);
-		int j = MathHelper::Rand(4, mWaves->ColumnCount() - 5);
-
-		float r = MathHelper::RandF(0.2f, 0.5f);
-
-		mWaves->Disturb(i, j, r);
-	}
-
-	// Update the wave simulation.
-	mWaves->Update(gt.DeltaTime());
-
 	// Update the wave vertex buffer with the new solution.
 	auto currWavesVB = mCurrFrameResource->WavesVB.get();
-	for(int i = 0; i < mWaves->VertexCount(); ++i)
+	for(int i = 0; i < mScene.GetWaves().VertexCount(); ++i)
 	{
-		Vertex v;
-
-		v.Pos = mWaves->Position(i);
-        v.Color = XMFLOAT4(DirectX::Colors::Blue);
-
-		currWavesVB->CopyData(i, v);
+		auto v = mScene.GetWaveVertex(i);
+		currWavesVB->CopyData(i, reinterpret_cast<const Vertex&>(v));
 	}
 
 	// Set the dynamic VB of the wave renderitem to the current frame VB.
@@ -577,12 +532,13 @@ void LandAndWavesApp::BuildLandGeometry()
 
 void LandAndWavesApp::BuildWavesGeometryBuffers()
 {
-	std::vector<std::uint16_t> indices(3 * mWaves->TriangleCount()); // 3 indices per face
-	assert(mWaves->VertexCount() < 0x0000ffff);
+	const Waves& waves = mScene.GetWaves();
+	std::vector<std::uint16_t> indices(3 * waves.TriangleCount()); // 3 indices per face
+	assert(waves.VertexCount() < 0x0000ffff);
 
 	// Iterate over each quad.
-	int m = mWaves->RowCount();
-	int n = mWaves->ColumnCount();
+	int m = waves.RowCount();
+	int n = waves.ColumnCount();
 	int k = 0;
 	for(int i = 0; i < m - 1; ++i)
 	{
@@ -600,7 +556,7 @@ void LandAndWavesApp::BuildWavesGeometryBuffers()
 		}
 	}
 
-	UINT vbByteSize = mWaves->VertexCount()*sizeof(Vertex);
+	UINT vbByteSize = waves.VertexCount()*sizeof(Vertex);
 	UINT ibByteSize = (UINT)indices.size()*sizeof(std::uint16_t);
 
 	auto geo = std::make_unique<MeshGeometry>();
@@ -677,7 +633,7 @@ void LandAndWavesApp::BuildFrameResources()
     for(int i = 0; i < gNumFrameResources; ++i)
     {
         mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
-            1, (UINT)mAllRitems.size(), mWaves->VertexCount()));
+            1, (UINT)mAllRitems.size(), mScene.GetWaves().VertexCount()));
     }
 }
 
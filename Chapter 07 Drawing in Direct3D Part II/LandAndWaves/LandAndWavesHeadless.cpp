@@ -0,0 +1,142 @@
+//***************************************************************************************
+// LandAndWavesHeadless.cpp by DanielDFY
+//***************************************************************************************
+
+#include "LandAndWavesHeadless.h"
+#include <cstdio>
+
+using namespace SimdMath;
+
+namespace
+{
+	// Ids of the app's tables, as a DrawPacketRecorder for it would resolve them.
+	const std::uint32_t OpaquePso = 0;
+	const std::uint32_t WaterGeometry = 0;
+	const std::uint32_t LandGeometry = 1;
+	const std::uint32_t TriangleListTopology = 4; // D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+
+	// d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants))
+	const std::uint64_t ObjectCBByteSize = 256;
+
+	// GeometryGenerator::CreateGrid(160.0f, 160.0f, 50, 50) in BuildLandGeometry.
+	const std::uint32_t LandIndexCount = 49 * 49 * 6;
+
+	Float4x4 Identity4x4()
+	{
+		Float4x4 m;
+		StoreFloat4x4(&m, MatrixIdentity());
+		return m;
+	}
+}
+
+bool LandAndWavesHeadless::Initialize()
+{
+	mScene = std::make_unique<LandAndWavesScene>(&mThreadPool);
+	const Waves& waves = mScene->GetWaves();
+
+	RenderItem water;
+	water.World = Identity4x4();
+	water.NumFramesDirty = NumFrameResources;
+	water.ObjCBIndex = 0;
+	water.Geometry = WaterGeometry;
+	water.IndexCount = 3 * (std::uint32_t)waves.TriangleCount();
+	mRitems.push_back(water);
+
+	RenderItem land;
+	land.World = Identity4x4();
+	land.NumFramesDirty = NumFrameResources;
+	land.ObjCBIndex = 1;
+	land.Geometry = LandGeometry;
+	land.IndexCount = LandIndexCount;
+	mRitems.push_back(land);
+
+	for(FrameResource& frame : mFrameResources)
+	{
+		frame.ObjectCB.resize(mRitems.size());
+		frame.WavesVB.resize(waves.VertexCount());
+	}
+
+	return true;
+}
+
+void LandAndWavesHeadless::Update(float totalTime, float deltaTime)
+{
+	mScene->Update(deltaTime);
+
+	// Cycle through the circular frame resource array.  There is no GPU to
+	// wait for.
+	mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % NumFrameResources;
+	mCurrFrameResource = &mFrameResources[mCurrFrameResourceIndex];
+
+	UpdateObjectCBs();
+	UpdateMainPassCB(totalTime, deltaTime);
+	UpdateWaves();
+}
+
+void LandAndWavesHeadless::Draw(DrawPacketRecorder& recorder)
+{
+	recorder.SetPipelineState(OpaquePso);
+
+	for(const RenderItem& ri : mRitems)
+	{
+		DrawPacket packet;
+		packet.Geometry = ri.Geometry;
+		packet.PrimitiveTopology = TriangleListTopology;
+		packet.ObjectCB = ri.ObjCBIndex*ObjectCBByteSize;
+		packet.IndexCount = ri.IndexCount;
+
+		recorder.SetGeometry(packet.Geometry);
+		recorder.SetPrimitiveTopology(packet.PrimitiveTopology);
+		recorder.SetObjectCB(packet.ObjectCB);
+		recorder.DrawIndexedInstanced(packet);
+	}
+}
+
+void LandAndWavesHeadless::UpdateObjectCBs()
+{
+	for(RenderItem& e : mRitems)
+	{
+		// Only update the cbuffer data if the constants have changed.
+		if(e.NumFramesDirty > 0)
+		{
+			mCurrFrameResource->ObjectCB[e.ObjCBIndex] = LandAndWavesScene::GetObjectConstants(e.World);
+
+			e.NumFramesDirty--;
+		}
+	}
+}
+
+void LandAndWavesHeadless::UpdateMainPassCB(float totalTime, float deltaTime)
+{
+	mScene->GetPassConstants(totalTime, deltaTime, &mCurrFrameResource->PassCB);
+}
+
+void LandAndWavesHeadless::UpdateWaves()
+{
+	// Update the wave vertex buffer with the new solution.
+	std::vector<Vertex>& wavesVB = mCurrFrameResource->WavesVB;
+	for(int i = 0; i < mScene->GetWaves().VertexCount(); ++i)
+		wavesVB[i] = mScene->GetWaveVertex(i);
+}
+
+#if !defined(_WIN32)
+
+int main(int argc, char** argv)
+{
+	HeadlessRunner::Settings settings;
+	if(!HeadlessRunner::ParseArguments(argc, argv, &settings))
+	{
+		std::fprintf(stderr, "usage: %s [-frames N] [-warmup N] [-dt seconds] [-csv file] [-json file]\n", argv[0]);
+		return 1;
+	}
+
+	LandAndWavesHeadless app;
+	HeadlessRunner runner(settings);
+	bool ok = runner.Run(app);
+
+	std::printf("%s", runner.GetReport().ToString().c_str());
+
+	return ok ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,73 @@
+//***************************************************************************************
+// LandAndWavesHeadless.h by DanielDFY
+//
+// The per-frame CPU work of LandAndWavesApp for HeadlessRunner: the app's
+// LandAndWavesScene, with object and pass constants and the dynamic wave
+// vertices written to the current of gNumFrameResources CPU-side copies as the
+// app writes its upload buffers, and the app's draw calls recorded as
+// DrawPackets.
+//
+// Built without the Windows SDK.  LandAndWavesApp runs it for "-headless";
+// elsewhere build this file with LandAndWavesScene.cpp, Waves.cpp and
+// Common/{HeadlessRunner,FrameStatistics,ThreadPool,Profiler,FixedTimestep}.cpp
+// for a command line benchmark.
+//***************************************************************************************
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../../Common/HeadlessRunner.h"
+#include "../../Common/SimdMath.h"
+#include "../../Common/ThreadPool.h"
+#include "LandAndWavesScene.h"
+
+class LandAndWavesHeadless : public HeadlessApp
+{
+public:
+	LandAndWavesHeadless() = default;
+	LandAndWavesHeadless(const LandAndWavesHeadless& rhs) = delete;
+	LandAndWavesHeadless& operator=(const LandAndWavesHeadless& rhs) = delete;
+
+	bool Initialize()override;
+	void Update(float totalTime, float deltaTime)override;
+	void Draw(DrawPacketRecorder& recorder)override;
+
+private:
+	typedef LandAndWavesScene::ObjectConstants ObjectConstants;
+	typedef LandAndWavesScene::PassConstants PassConstants;
+	typedef LandAndWavesScene::Vertex Vertex;
+
+	struct FrameResource
+	{
+		PassConstants PassCB;
+		std::vector<ObjectConstants> ObjectCB;
+		std::vector<Vertex> WavesVB;
+	};
+
+	struct RenderItem
+	{
+		SimdMath::Float4x4 World;
+		int NumFramesDirty = 0;
+		std::uint32_t ObjCBIndex = 0;
+		std::uint32_t Geometry = 0;
+		std::uint32_t IndexCount = 0;
+	};
+
+	void UpdateObjectCBs();
+	void UpdateMainPassCB(float totalTime, float deltaTime);
+	void UpdateWaves();
+
+private:
+	static const int NumFrameResources = 3;
+
+	ThreadPool mThreadPool;
+	std::unique_ptr<LandAndWavesScene> mScene;
+
+	FrameResource mFrameResources[NumFrameResources];
+	FrameResource* mCurrFrameResource = nullptr;
+	int mCurrFrameResourceIndex = 0;
+
+	std::vector<RenderItem> mRitems;
+};
@@ -0,0 +1,135 @@
+//***************************************************************************************
+// LandAndWavesScene.cpp by DanielDFY
+//***************************************************************************************
+
+#include "LandAndWavesScene.h"
+#include <algorithm>
+
+using namespace SimdMath;
+
+namespace
+{
+	Float4x4 Identity4x4()
+	{
+		Float4x4 m;
+		StoreFloat4x4(&m, MatrixIdentity());
+		return m;
+	}
+}
+
+LandAndWavesScene::LandAndWavesScene(ThreadPool* pool) :
+	mWaves(std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f, pool)),
+	mEyePos(0.0f, 0.0f, 0.0f),
+	mView(Identity4x4()),
+	mProj(Identity4x4()),
+	mTheta(1.5f*Pi),
+	mPhi(PiDiv2 - 0.1f)
+{
+	OnResize(mWidth, mHeight);
+}
+
+void LandAndWavesScene::OnResize(float width, float height)
+{
+	mWidth = width;
+	mHeight = height;
+
+	StoreFloat4x4(&mProj, MatrixPerspectiveFovLH(0.25f*Pi, mWidth / mHeight, 1.0f, 1000.0f));
+}
+
+void LandAndWavesScene::Orbit(float dTheta, float dPhi)
+{
+	mTheta += dTheta;
+	mPhi = std::min(std::max(mPhi + dPhi, 0.1f), Pi - 0.1f);
+}
+
+void LandAndWavesScene::Zoom(float dRadius)
+{
+	mRadius = std::min(std::max(mRadius + dRadius, 5.0f), 150.0f);
+}
+
+void LandAndWavesScene::Update(float deltaTime)
+{
+	UpdateCamera();
+	UpdateWaves(deltaTime);
+}
+
+void LandAndWavesScene::UpdateCamera()
+{
+	// Convert Spherical to Cartesian coordinates.
+	mEyePos.x = mRadius*sinf(mPhi)*cosf(mTheta);
+	mEyePos.z = mRadius*sinf(mPhi)*sinf(mTheta);
+	mEyePos.y = mRadius*cosf(mPhi);
+
+	// Build the view matrix.
+	Vector pos = VectorSet(mEyePos.x, mEyePos.y, mEyePos.z, 1.0f);
+	Vector target = VectorZero();
+	Vector up = VectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+
+	StoreFloat4x4(&mView, MatrixLookAtLH(pos, target, up));
+}
+
+void LandAndWavesScene::UpdateWaves(float deltaTime)
+{
+	// Every quarter second, generate a random wave.
+	std::uint32_t disturbances = mDisturbStep.Advance(deltaTime);
+	for(std::uint32_t d = 0; d < disturbances; ++d)
+	{
+		int i = mRandom.NextInt(4, mWaves->RowCount() - 5);
+		int j = mRandom.NextInt(4, mWaves->ColumnCount() - 5);
+
+		float r = mRandom.NextFloat(0.2f, 0.5f);
+
+		mWaves->Disturb(i, j, r);
+	}
+
+	// Update the wave simulation.
+	mWaves->Update(deltaTime);
+}
+
+void LandAndWavesScene::GetPassConstants(float totalTime, float deltaTime, PassConstants* passCB)const
+{
+	Matrix view = LoadFloat4x4(&mView);
+	Matrix proj = LoadFloat4x4(&mProj);
+
+	Matrix viewProj = MatrixMultiply(view, proj);
+	Vector det = MatrixDeterminant(view);
+	Matrix invView = MatrixInverse(&det, view);
+	det = MatrixDeterminant(proj);
+	Matrix invProj = MatrixInverse(&det, proj);
+	det = MatrixDeterminant(viewProj);
+	Matrix invViewProj = MatrixInverse(&det, viewProj);
+
+	StoreFloat4x4(&passCB->View, MatrixTranspose(view));
+	StoreFloat4x4(&passCB->InvView, MatrixTranspose(invView));
+	StoreFloat4x4(&passCB->Proj, MatrixTranspose(proj));
+	StoreFloat4x4(&passCB->InvProj, MatrixTranspose(invProj));
+	StoreFloat4x4(&passCB->ViewProj, MatrixTranspose(viewProj));
+	StoreFloat4x4(&passCB->InvViewProj, MatrixTranspose(invViewProj));
+	passCB->EyePosW = mEyePos;
+	passCB->cbPerObjectPad1 = 0.0f;
+	passCB->RenderTargetSize = Float2(mWidth, mHeight);
+	passCB->InvRenderTargetSize = Float2(1.0f / mWidth, 1.0f / mHeight);
+	passCB->NearZ = 1.0f;
+	passCB->FarZ = 1000.0f;
+	passCB->TotalTime = totalTime;
+	passCB->DeltaTime = deltaTime;
+}
+
+LandAndWavesScene::Vertex LandAndWavesScene::GetWaveVertex(int i)const
+{
+	float alpha = mWaves->Alpha();
+	const Float3& p0 = mWaves->PreviousPosition(i);
+	const Float3& p1 = mWaves->Position(i);
+
+	Vertex v;
+	v.Pos = Float3(p1.x, p0.y + (p1.y - p0.y)*alpha, p1.z);
+	v.Color = Float4(0.0f, 0.0f, 1.0f, 1.0f); // Colors::Blue
+	return v;
+}
+
+LandAndWavesScene::ObjectConstants LandAndWavesScene::GetObjectConstants(const Float4x4& world)
+{
+	ObjectConstants objConstants;
+	StoreFloat4x4(&objConstants.World, MatrixTranspose(LoadFloat4x4(&world)));
+	return objConstants;
+}
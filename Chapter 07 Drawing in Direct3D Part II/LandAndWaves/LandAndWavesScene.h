@@ -0,0 +1,105 @@
+//***************************************************************************************
+// LandAndWavesScene.h by DanielDFY
+//
+// The per-frame CPU work LandAndWavesApp and LandAndWavesHeadless share: the
+// orbiting camera, the pass constants, the wave simulation with its random
+// disturbances, and the interpolated wave vertices.  Each of them copies the
+// results into its own per-frame buffers.
+//
+// Built with SimdMath instead of DirectXMath, so it compiles without the
+// Windows SDK; the structs below match FrameResource.h byte for byte.  Waves
+// are disturbed from a fixed seed, so runs are repeatable.
+//***************************************************************************************
+
+#pragma once
+
+#include <memory>
+
+#include "../../Common/FixedTimestep.h"
+#include "../../Common/Random.h"
+#include "../../Common/SimdMath.h"
+#include "Waves.h"
+
+class ThreadPool;
+
+class LandAndWavesScene
+{
+public:
+	// Mirror FrameResource.h without DirectXMath.
+	struct ObjectConstants
+	{
+		SimdMath::Float4x4 World;
+	};
+
+	struct PassConstants
+	{
+		SimdMath::Float4x4 View;
+		SimdMath::Float4x4 InvView;
+		SimdMath::Float4x4 Proj;
+		SimdMath::Float4x4 InvProj;
+		SimdMath::Float4x4 ViewProj;
+		SimdMath::Float4x4 InvViewProj;
+		SimdMath::Float3 EyePosW;
+		float cbPerObjectPad1;
+		SimdMath::Float2 RenderTargetSize;
+		SimdMath::Float2 InvRenderTargetSize;
+		float NearZ;
+		float FarZ;
+		float TotalTime;
+		float DeltaTime;
+	};
+
+	struct Vertex
+	{
+		SimdMath::Float3 Pos;
+		SimdMath::Float4 Color;
+	};
+
+	// The wave rows are updated in parallel on pool, or serially when it is null.
+	explicit LandAndWavesScene(ThreadPool* pool = nullptr);
+	LandAndWavesScene(const LandAndWavesScene& rhs) = delete;
+	LandAndWavesScene& operator=(const LandAndWavesScene& rhs) = delete;
+
+	const Waves& GetWaves()const { return *mWaves; }
+
+	// Recomputes the projection for the new render target size.
+	void OnResize(float width, float height);
+
+	// Rotates the camera around the origin and moves it closer or further,
+	// keeping it off the poles and within range.
+	void Orbit(float dTheta, float dPhi);
+	void Zoom(float dRadius);
+
+	// Moves the camera, disturbs the water and steps the simulation.
+	void Update(float deltaTime);
+
+	void GetPassConstants(float totalTime, float deltaTime, PassConstants* passCB)const;
+
+	// The ith wave vertex, interpolated between the last two simulation steps
+	// for the time since the last one.
+	Vertex GetWaveVertex(int i)const;
+
+	static ObjectConstants GetObjectConstants(const SimdMath::Float4x4& world);
+
+private:
+	void UpdateCamera();
+	void UpdateWaves(float deltaTime);
+
+private:
+	std::unique_ptr<Waves> mWaves;
+	Random mRandom;
+
+	// Random waves, one per quarter second.
+	FixedTimestep mDisturbStep{ 0.25 };
+
+	SimdMath::Float3 mEyePos;
+	SimdMath::Float4x4 mView;
+	SimdMath::Float4x4 mProj;
+
+	float mTheta;
+	float mPhi;
+	float mRadius = 50.0f;
+
+	float mWidth = 800.0f;
+	float mHeight = 600.0f;
+};
@@ -3,15 +3,19 @@
 //***************************************************************************************
 
 #include "Waves.h"
-#include <ppl.h>
+#include "../../Common/Profiler.h"
+#include "../../Common/ThreadPool.h"
 #include <algorithm>
 #include <vector>
 #include <cassert>
 
-using namespace DirectX;
+using namespace SimdMath;
 
-Waves::Waves(int m, int n, float dx, float dt, float speed, float damping)
+Waves::Waves(int m, int n, float dx, float dt, float speed, float damping, ThreadPool* pool)
+    : mStepper(dt)
 {
+    mThreadPool = pool;
+
     mNumRows = m;
     mNumCols = n;
 
@@ -43,10 +47,10 @@ Waves::Waves(int m, int n, float dx, float dt, float speed, float damping)
         {
             float x = -halfWidth + j*dx;
 
-            mPrevSolution[i*n + j] = XMFLOAT3(x, 0.0f, z);
-            mCurrSolution[i*n + j] = XMFLOAT3(x, 0.0f, z);
-            mNormals[i*n + j] = XMFLOAT3(0.0f, 1.0f, 0.0f);
-            mTangentX[i*n + j] = XMFLOAT3(1.0f, 0.0f, 0.0f);
+            mPrevSolution[i*n + j] = Float3(x, 0.0f, z);
+            mCurrSolution[i*n + j] = Float3(x, 0.0f, z);
+            mNormals[i*n + j] = Float3(0.0f, 1.0f, 0.0f);
+            mTangentX[i*n + j] = Float3(1.0f, 0.0f, 0.0f);
         }
     }
 }
@@ -85,19 +89,36 @@ float Waves::Depth()const
 	return mNumRows*mSpatialStep;
 }
 
+template<typename Body>
+void Waves::ForEachInteriorRow(const Body& body)
+{
+	if(mThreadPool == nullptr)
+	{
+		for(int i = 1; i < mNumRows - 1; ++i)
+			body(i);
+		return;
+	}
+
+	mThreadPool->ParallelFor((std::uint32_t)(mNumRows - 2), [&body](std::uint32_t index, std::uint32_t)
+	{
+		body((int)index + 1);
+	});
+}
+
 void Waves::Update(float dt)
 {
-	static float t = 0;
+	PROFILE_SCOPE("Waves::Update");
 
-	// Accumulate time.
-	t += dt;
+	// Run the simulation at its fixed time step, as many steps as the time
+	// accumulated so far allows; the remainder carries into the next call.
+	std::uint32_t steps = mStepper.Advance(dt);
+	if( steps == 0 )
+		return;
 
-	// Only update the simulation at the specified time step.
-	if( t >= mTimeStep )
+	for(std::uint32_t step = 0; step < steps; ++step)
 	{
 		// Only update interior points; we use zero boundary conditions.
-		concurrency::parallel_for(1, mNumRows - 1, [this](int i)
-		//for(int i = 1; i < mNumRows-1; ++i)
+		ForEachInteriorRow([this](int i)
 		{
 			for(int j = 1; j < mNumCols-1; ++j)
 			{
@@ -124,34 +145,31 @@ void Waves::Update(float dt)
 		// this data needs to become the current solution and the old
 		// current solution becomes the new previous solution.
 		std::swap(mPrevSolution, mCurrSolution);
+	}
 
-		t = 0.0f; // reset time
-
-		//
-		// Compute normals using finite difference scheme.
-		//
-		concurrency::parallel_for(1, mNumRows - 1, [this](int i)
-		//for(int i = 1; i < mNumRows - 1; ++i)
+	//
+	// Compute normals using finite difference scheme.
+	//
+	ForEachInteriorRow([this](int i)
+	{
+		for(int j = 1; j < mNumCols-1; ++j)
 		{
-			for(int j = 1; j < mNumCols-1; ++j)
-			{
-				float l = mCurrSolution[i*mNumCols+j-1].y;
-				float r = mCurrSolution[i*mNumCols+j+1].y;
-				float t = mCurrSolution[(i-1)*mNumCols+j].y;
-				float b = mCurrSolution[(i+1)*mNumCols+j].y;
-				mNormals[i*mNumCols+j].x = -r+l;
-				mNormals[i*mNumCols+j].y = 2.0f*mSpatialStep;
-				mNormals[i*mNumCols+j].z = b-t;
-
-				XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&mNormals[i*mNumCols+j]));
-				XMStoreFloat3(&mNormals[i*mNumCols+j], n);
-
-				mTangentX[i*mNumCols+j] = XMFLOAT3(2.0f*mSpatialStep, r-l, 0.0f);
-				XMVECTOR T = XMVector3Normalize(XMLoadFloat3(&mTangentX[i*mNumCols+j]));
-				XMStoreFloat3(&mTangentX[i*mNumCols+j], T);
-			}
-		});
-	}
+			float l = mCurrSolution[i*mNumCols+j-1].y;
+			float r = mCurrSolution[i*mNumCols+j+1].y;
+			float t = mCurrSolution[(i-1)*mNumCols+j].y;
+			float b = mCurrSolution[(i+1)*mNumCols+j].y;
+			mNormals[i*mNumCols+j].x = -r+l;
+			mNormals[i*mNumCols+j].y = 2.0f*mSpatialStep;
+			mNormals[i*mNumCols+j].z = b-t;
+
+			Vector n = Vector3Normalize(LoadFloat3(&mNormals[i*mNumCols+j]));
+			StoreFloat3(&mNormals[i*mNumCols+j], n);
+
+			mTangentX[i*mNumCols+j] = Float3(2.0f*mSpatialStep, r-l, 0.0f);
+			Vector T = Vector3Normalize(LoadFloat3(&mTangentX[i*mNumCols+j]));
+			StoreFloat3(&mTangentX[i*mNumCols+j], T);
+		}
+	});
 }
 
 void Waves::Disturb(int i, int j, float magnitude)
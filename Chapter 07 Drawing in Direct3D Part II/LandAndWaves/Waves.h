@@ -10,12 +10,16 @@
 #define WAVES_H
 
 #include <vector>
-#include <DirectXMath.h>
+#include "../../Common/FixedTimestep.h"
+#include "../../Common/SimdMath.h"
+
+class ThreadPool;
 
 class Waves
 {
 public:
-    Waves(int m, int n, float dx, float dt, float speed, float damping);
+    // The rows are updated in parallel on pool, or serially when it is null.
+    Waves(int m, int n, float dx, float dt, float speed, float damping, ThreadPool* pool = nullptr);
     Waves(const Waves& rhs) = delete;
     Waves& operator=(const Waves& rhs) = delete;
     ~Waves();
@@ -28,18 +32,32 @@ public:
 	float Depth()const;
 
 	// Returns the solution at the ith grid point.
-    const DirectX::XMFLOAT3& Position(int i)const { return mCurrSolution[i]; }
+    const SimdMath::Float3& Position(int i)const { return mCurrSolution[i]; }
+
+	// Returns the solution at the ith grid point one time step earlier.
+	const SimdMath::Float3& PreviousPosition(int i)const { return mPrevSolution[i]; }
+
+	// How far the time since the last step is into the next one, in [0, 1),
+	// for drawing between PreviousPosition and Position.
+	float Alpha()const { return mStepper.Alpha(); }
 
 	// Returns the solution normal at the ith grid point.
-    const DirectX::XMFLOAT3& Normal(int i)const { return mNormals[i]; }
+    const SimdMath::Float3& Normal(int i)const { return mNormals[i]; }
 
 	// Returns the unit tangent vector at the ith grid point in the local x-axis direction.
-    const DirectX::XMFLOAT3& TangentX(int i)const { return mTangentX[i]; }
+    const SimdMath::Float3& TangentX(int i)const { return mTangentX[i]; }
 
 	void Update(float dt);
 	void Disturb(int i, int j, float magnitude);
 
 private:
+	// Runs body(i) for every interior row i.
+	template<typename Body>
+	void ForEachInteriorRow(const Body& body);
+
+private:
+    ThreadPool* mThreadPool = nullptr;
+
     int mNumRows = 0;
     int mNumCols = 0;
 
@@ -52,12 +70,13 @@ private:
     float mK3 = 0.0f;
 
     float mTimeStep = 0.0f;
+    FixedTimestep mStepper;
     float mSpatialStep = 0.0f;
 
-    std::vector<DirectX::XMFLOAT3> mPrevSolution;
-    std::vector<DirectX::XMFLOAT3> mCurrSolution;
-    std::vector<DirectX::XMFLOAT3> mNormals;
-    std::vector<DirectX::XMFLOAT3> mTangentX;
+    std::vector<SimdMath::Float3> mPrevSolution;
+    std::vector<SimdMath::Float3> mCurrSolution;
+    std::vector<SimdMath::Float3> mNormals;
+    std::vector<SimdMath::Float3> mTangentX;
 };
 
 #endif // WAVES_H
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/DescriptorHeap.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -86,7 +87,10 @@ private:
     int mCurrFrameResourceIndex = 0;
 
     ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
-    ComPtr<ID3D12DescriptorHeap> mCbvHeap = nullptr;
+    // Object CBVs are persistent, one range per frame resource.  The pass CBV
+    // is recreated every frame in the transient part of the heap.
+    std::unique_ptr<DescriptorHeap> mCbvHeap;
+    std::vector<DescriptorRange> mObjectCbvs;
 
     ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
 
@@ -104,8 +108,6 @@ private:
 
     PassConstants mMainPassCB;
 
-    UINT mPassCbvOffset = 0;
-
     bool mIsWireframe = false;
 
     XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
@@ -200,6 +202,9 @@ void ShapesApp::Update(const GameTimer& gt) {
         CloseHandle(eventHandle);
     }
 
+    // Pass CBVs of the frames the GPU has finished with can be reused.
+    mCbvHeap->Retire(mFence->GetCompletedValue());
+
     UpdateObjectCBs(gt);
     UpdateMainPassCB(gt);
 }
@@ -234,15 +239,18 @@ void ShapesApp::Draw(const GameTimer& gt) {
     // Specify the buffers we are going to render to.
     mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
 
-    ID3D12DescriptorHeap* descriptorHeaps[] = { mCbvHeap.Get() };
+    ID3D12DescriptorHeap* descriptorHeaps[] = { mCbvHeap->Heap() };
     mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
     mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
 
-    int passCbvIndex = mPassCbvOffset + mCurrFrameResourceIndex;
-    auto passCbvHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(mCbvHeap->GetGPUDescriptorHandleForHeapStart());
-    passCbvHandle.Offset(passCbvIndex, mCbvSrvUavDescriptorSize);
-    mCommandList->SetGraphicsRootDescriptorTable(1, passCbvHandle);
+    D3D12_CONSTANT_BUFFER_VIEW_DESC passCbvDesc;
+    passCbvDesc.BufferLocation = mCurrFrameResource->PassCB->Resource()->GetGPUVirtualAddress();
+    passCbvDesc.SizeInBytes = d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
+
+    auto passCbv = mCbvHeap->AllocateTransient(1);
+    md3dDevice->CreateConstantBufferView(&passCbvDesc, passCbv.Cpu());
+    mCommandList->SetGraphicsRootDescriptorTable(1, passCbv.Gpu());
 
     DrawRenderItems(mCommandList.Get(), mOpaqueRitems);
 
@@ -268,6 +276,8 @@ void ShapesApp::Draw(const GameTimer& gt) {
     // Because we are on the GPU timeline, the new fence point won't be 
     // set until the GPU finishes processing all the commands prior to this Signal().
     mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+
+    mCbvHeap->FinishFrame(mCurrentFence);
 }
 
 void ShapesApp::OnMouseDown(WPARAM btnState, int x, int y) {
@@ -311,7 +321,7 @@ void ShapesApp::OnMouseMove(WPARAM btnState, int x, int y) {
 }
 
 void ShapesApp::OnKeyboardInput(const GameTimer& gt) {
-    if (GetAsyncKeyState('1') & 0x8000)
+    if (IsKeyDown('1'))
         mIsWireframe = true;
     else
         mIsWireframe = false;
@@ -381,20 +391,13 @@ void ShapesApp::UpdateMainPassCB(const GameTimer& gt) {
 void ShapesApp::BuildDescriptorHeaps() {
     UINT objCount = (UINT)mOpaqueRitems.size();
 
-    // Need a CBV descriptor for each object for each frame resource,
-    // +1 for the perPass CBV for each frame resource.
-    UINT numDescriptors = (objCount + 1) * gNumFrameResources;
-
-    // Save an offset to the start of the pass CBVs.  These are the last 3 descriptors.
-    mPassCbvOffset = objCount * gNumFrameResources;
-
-    D3D12_DESCRIPTOR_HEAP_DESC cbvHeapDesc;
-    cbvHeapDesc.NumDescriptors = numDescriptors;
-    cbvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-    cbvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-    cbvHeapDesc.NodeMask = 0;
-    ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&cbvHeapDesc,
-        IID_PPV_ARGS(&mCbvHeap)));
+    // Need a CBV descriptor for each object for each frame resource, and room
+    // for the per frame pass CBV of every frame in flight.
+    mCbvHeap = std::make_unique<DescriptorHeap>(md3dDevice.Get(),
+        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+        objCount * gNumFrameResources,
+        gNumFrameResources + 1,
+        true);
 }
 
 void ShapesApp::BuildConstantBufferViews() {
@@ -405,42 +408,21 @@ void ShapesApp::BuildConstantBufferViews() {
     // Need a CBV descriptor for each object for each frame resource.
     for (int frameIndex = 0; frameIndex < gNumFrameResources; ++frameIndex) {
         auto objectCB = mFrameResources[frameIndex]->ObjectCB->Resource();
+        auto cbvs = mCbvHeap->Allocate(objCount);
         for (UINT i = 0; i < objCount; ++i) {
             D3D12_GPU_VIRTUAL_ADDRESS cbAddress = objectCB->GetGPUVirtualAddress();
 
             // Offset to the ith object constant buffer in the buffer.
             cbAddress += i * objCBByteSize;
 
-            // Offset to the object cbv in the descriptor heap.
-            int heapIndex = frameIndex * objCount + i;
-            auto handle = CD3DX12_CPU_DESCRIPTOR_HANDLE(mCbvHeap->GetCPUDescriptorHandleForHeapStart());
-            handle.Offset(heapIndex, mCbvSrvUavDescriptorSize);
-
             D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc;
             cbvDesc.BufferLocation = cbAddress;
             cbvDesc.SizeInBytes = objCBByteSize;
 
-            md3dDevice->CreateConstantBufferView(&cbvDesc, handle);
+            md3dDevice->CreateConstantBufferView(&cbvDesc, cbvs.Cpu(i));
         }
-    }
-
-    UINT passCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
-
-    // Last three descriptors are the pass CBVs for each frame resource.
-    for (int frameIndex = 0; frameIndex < gNumFrameResources; ++frameIndex) {
-        auto passCB = mFrameResources[frameIndex]->PassCB->Resource();
-        D3D12_GPU_VIRTUAL_ADDRESS cbAddress = passCB->GetGPUVirtualAddress();
-
-        // Offset to the pass cbv in the descriptor heap.
-        int heapIndex = mPassCbvOffset + frameIndex;
-        auto handle = CD3DX12_CPU_DESCRIPTOR_HANDLE(mCbvHeap->GetCPUDescriptorHandleForHeapStart());
-        handle.Offset(heapIndex, mCbvSrvUavDescriptorSize);
-
-        D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc;
-        cbvDesc.BufferLocation = cbAddress;
-        cbvDesc.SizeInBytes = passCBByteSize;
 
-        md3dDevice->CreateConstantBufferView(&cbvDesc, handle);
+        mObjectCbvs.push_back(cbvs);
     }
 }
 
@@ -748,10 +730,8 @@ void ShapesApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::v
         cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
         cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
 
-        // Offset to the CBV in the descriptor heap for this object and for this frame resource.
-        UINT cbvIndex = mCurrFrameResourceIndex * (UINT)mOpaqueRitems.size() + ri->ObjCBIndex;
-        auto cbvHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(mCbvHeap->GetGPUDescriptorHandleForHeapStart());
-        cbvHandle.Offset(cbvIndex, mCbvSrvUavDescriptorSize);
+        // The CBV for this object and for this frame resource.
+        auto cbvHandle = mObjectCbvs[mCurrFrameResourceIndex].Gpu(ri->ObjCBIndex);
 
         cmdList->SetGraphicsRootDescriptorTable(0, cbvHandle);
 
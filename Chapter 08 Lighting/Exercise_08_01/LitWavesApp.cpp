@@ -354,16 +354,16 @@ void LitWavesApp::OnKeyboardInput(const GameTimer& gt)
 {
 	const float dt = gt.DeltaTime();
 
-	if(GetAsyncKeyState(VK_LEFT) & 0x8000)
+	if(IsKeyDown(VK_LEFT))
 		mSunTheta -= 1.0f*dt;
 
-	if(GetAsyncKeyState(VK_RIGHT) & 0x8000)
+	if(IsKeyDown(VK_RIGHT))
 		mSunTheta += 1.0f*dt;
 
-	if(GetAsyncKeyState(VK_UP) & 0x8000)
+	if(IsKeyDown(VK_UP))
 		mSunPhi -= 1.0f*dt;
 
-	if(GetAsyncKeyState(VK_DOWN) & 0x8000)
+	if(IsKeyDown(VK_DOWN))
 		mSunPhi += 1.0f*dt;
 
 	mSunPhi = MathHelper::Clamp(mSunPhi, 0.1f, XM_PIDIV2);
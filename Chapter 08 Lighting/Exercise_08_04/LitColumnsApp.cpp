@@ -319,7 +319,7 @@ void LitColumnsApp::OnMouseMove(WPARAM btnState, int x, int y) {
 
 void LitColumnsApp::OnKeyboardInput(const GameTimer& gt) {
 	// Modify: press "1" to display spot light, else point light.
-	if (GetAsyncKeyState('1') & 0x8000)
+	if (IsKeyDown('1'))
 		mIsSpotLight = true;
 	else
 		mIsSpotLight = false;
@@ -6,6 +6,7 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/TextureStreamBackend.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -74,6 +75,7 @@ private:
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMaterialCBs(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
+	void UpdateTextureStreaming(const GameTimer& gt);
 
 	void LoadTextures();
 	void BuildRootSignature();
@@ -94,15 +96,17 @@ private:
 	FrameResource* mCurrFrameResource = nullptr;
 	int mCurrFrameResourceIndex = 0;
 
-	UINT mCbvSrvDescriptorSize = 0;
-
 	ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
 
-	ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
+	// Declared in dependency order, so they are destroyed the other way round.
+	std::unique_ptr<UploadManager> mUploadManager;
+	std::unique_ptr<DescriptorHeap> mSrvHeap;
+	std::unique_ptr<TextureStreamBackend> mTextureBackend;
+	std::unique_ptr<TextureStreamer> mTextureStreamer;
+	TextureStreamer::TextureId mWoodCrateTex = TextureStreamer::InvalidTexture;
 
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
 	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
-	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
 
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
@@ -164,14 +168,9 @@ bool CrateApp::Initialize() {
 	// Reset the command list to prep for initialization commands.
 	ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
 
-	// Get the increment size of a descriptor in this heap type.  This is hardware specific, 
-	// so we have to query this information.
-	mCbvSrvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-
-
+	BuildDescriptorHeaps();
 	LoadTextures();
 	BuildRootSignature();
-	BuildDescriptorHeaps();
 	BuildShadersAndInputLayout();
 	BuildShapeGeometry();
 	BuildMaterials();
@@ -187,6 +186,12 @@ bool CrateApp::Initialize() {
 	// Wait until initialization is complete.
 	FlushCommandQueue();
 
+	// Only the mip tails are loaded before the first frame; the higher mips
+	// stream in while the app runs.
+	mTextureStreamer->Update();
+	mTextureStreamer->WaitIdle();
+	mUploadManager->WaitIdle();
+
 	return true;
 }
 
@@ -215,6 +220,10 @@ void CrateApp::Update(const GameTimer& gt) {
 		CloseHandle(eventHandle);
 	}
 
+	// Textures the streamer replaced are released once no frame in flight uses them.
+	mTextureBackend->Retire(mFence->GetCompletedValue());
+	UpdateTextureStreaming(gt);
+
 	AnimateMaterials(gt);
 	UpdateObjectCBs(gt);
 	UpdateMaterialCBs(gt);
@@ -246,7 +255,7 @@ void CrateApp::Draw(const GameTimer& gt) {
 	// Specify the buffers we are going to render to.
 	mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
 
-	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
+	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvHeap->Heap() };
 	mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
 	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
@@ -278,6 +287,8 @@ void CrateApp::Draw(const GameTimer& gt) {
 	// Because we are on the GPU timeline, the new fence point won't be 
 	// set until the GPU finishes processing all the commands prior to this Signal().
 	mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+
+	mTextureBackend->FinishFrame(mCurrentFence);
 }
 
 void CrateApp::OnMouseDown(WPARAM btnState, int x, int y) {
@@ -420,15 +431,24 @@ void CrateApp::UpdateMainPassCB(const GameTimer& gt) {
 	currPassCB->CopyData(0, mMainPassCB);
 }
 
+void CrateApp::UpdateTextureStreaming(const GameTimer& gt) {
+	// A face of the unit box seen from mRadius away covers about this many
+	// pixels vertically with the 45 degree field of view of the projection.
+	float pixels = mClientHeight / (2.0f * mRadius * tanf(0.125f * MathHelper::Pi));
+	mTextureStreamer->ReportUsage(mWoodCrateTex, pixels);
+
+	mTextureStreamer->Update();
+
+	// The texture copies run before this frame's command list.
+	mUploadManager->Flush();
+}
+
 void CrateApp::LoadTextures() {
-	auto woodCrateTex = std::make_unique<Texture>();
-	woodCrateTex->Name = "woodCrateTex";
-	woodCrateTex->Filename = L"../../Textures/WoodCrate01.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), woodCrateTex->Filename.c_str(),
-		woodCrateTex->Resource, woodCrateTex->UploadHeap));
-
-	mTextures[woodCrateTex->Name] = std::move(woodCrateTex);
+	mUploadManager = std::make_unique<UploadManager>(md3dDevice.Get(), mCommandQueue.Get());
+	mTextureBackend = std::make_unique<TextureStreamBackend>(md3dDevice.Get(), *mUploadManager, *mSrvHeap);
+	mTextureStreamer = std::make_unique<TextureStreamer>(*mTextureBackend);
+
+	mWoodCrateTex = mTextureStreamer->Register("../../Textures/WoodCrate01.dds");
 }
 
 void CrateApp::BuildRootSignature() {
@@ -470,31 +490,10 @@ void CrateApp::BuildRootSignature() {
 }
 
 void CrateApp::BuildDescriptorHeaps() {
-	//
-	// Create the SRV heap.
-	//
-	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 1;
-	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
-
-	//
-	// Fill out the heap with actual descriptors.
-	//
-	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-
-	auto woodCrateTex = mTextures["woodCrateTex"]->Resource;
-
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = woodCrateTex->GetDesc().Format;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.Texture2D.MipLevels = woodCrateTex->GetDesc().MipLevels;
-	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-
-	md3dDevice->CreateShaderResourceView(woodCrateTex.Get(), &srvDesc, hDescriptor);
+	// The streamed textures get a new SRV every time their resident mips
+	// change, and keep the old one until the frames using it retire.
+	mSrvHeap = std::make_unique<DescriptorHeap>(md3dDevice.Get(),
+		D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 16, 0, true);
 }
 
 void CrateApp::BuildShadersAndInputLayout() {
@@ -600,7 +599,7 @@ void CrateApp::BuildMaterials() {
 	auto woodCrate = std::make_unique<Material>();
 	woodCrate->Name = "woodCrate";
 	woodCrate->MatCBIndex = 0;
-	woodCrate->DiffuseSrvHeapIndex = 0;
+	woodCrate->DiffuseStreamedTexture = mWoodCrateTex;
 	woodCrate->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	woodCrate->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05f);
 	woodCrate->Roughness = 0.2f;
@@ -639,8 +638,8 @@ void CrateApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::ve
 		cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
 		cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
 
-		CD3DX12_GPU_DESCRIPTOR_HANDLE tex(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		tex.Offset(ri->Mat->DiffuseSrvHeapIndex, mCbvSrvDescriptorSize);
+		// Resident mips of the texture, or a null SRV until its mip tail is in.
+		CD3DX12_GPU_DESCRIPTOR_HANDLE tex = mTextureBackend->Srv(ri->Mat->DiffuseStreamedTexture);
 
 		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex * objCBByteSize;
 		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex * matCBByteSize;
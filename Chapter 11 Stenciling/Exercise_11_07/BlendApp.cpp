@@ -8,6 +8,9 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/TexturePacker.h"
+#include "../../Common/BlockCompression.h"
+#include "../../Common/ThreadPool.h"
 #include "FrameResource.h"
 #include "Waves.h"
 
@@ -20,6 +23,9 @@ using namespace DirectX::PackedVector;
 
 const int gNumFrameResources = 3;
 
+// Modify: frames of the bolt animation, Bolt001.dds to Bolt060.dds
+const int gNumBoltFrames = 60;
+
 // Lightweight structure stores parameters to draw a shape.  This will
 // vary from app-to-app.
 struct RenderItem
@@ -112,7 +118,6 @@ private:
     std::vector<std::unique_ptr<FrameResource>> mFrameResources;
     FrameResource* mCurrFrameResource = nullptr;
     int mCurrFrameResourceIndex = 0;
-	int mCurrBoltTexIndex = 0;
 
     UINT mCbvSrvDescriptorSize = 0;
 
@@ -138,6 +143,9 @@ private:
 
 	std::unique_ptr<Waves> mWaves;
 
+	// Modify: one pool for the app's lifetime instead of one per cook step
+	ThreadPool mThreadPool;
+
     PassConstants mMainPassCB;
 
 	XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
@@ -293,9 +301,8 @@ void BlendApp::Draw(const GameTimer& gt)
 
     DrawRenderItems(mCommandList.Get(), mRitemLayer[static_cast<int>(RenderLayer::Opaque)]);
 
-	// Modify: draw with proper texture indicated by mCurrBoltTexIndex
+	// Modify: the bolt shader picks the frame from the total time
 	mCommandList->SetPipelineState(mPSOs["bolt"].Get());
-	mCurrBoltTexIndex %= 60;
 	DrawRenderItems(mCommandList.Get(), mRitemLayer[static_cast<int>(RenderLayer::Bolt)]);
 
 	mCommandList->SetPipelineState(mPSOs["transparent"].Get());
@@ -559,19 +566,46 @@ void BlendApp::LoadTextures()
 	mTextures[grassTex->Name] = std::move(grassTex);
 	mTextures[waterTex->Name] = std::move(waterTex);
 
-	// Modify: one bolt texture each frame
-	const std::string texNamePrefix = "BoltTex_";
-	for (size_t i = 0; i < 60; ++i) {
-		auto boltTex = std::make_unique<Texture>();
-		boltTex->Name = texNamePrefix + std::to_string(i);
-		const std::wstring fileNamePrefix = (i < 9) ? L"../../Textures/Bolt00" : L"../../Textures/Bolt0";
-		boltTex->Filename = fileNamePrefix + std::to_wstring(i + 1) + L".dds";
-		ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-			mCommandList.Get(), boltTex->Filename.c_str(),
-			boltTex->Resource, boltTex->UploadHeap));
-
-		mTextures[boltTex->Name] = std::move(boltTex);
+	// Modify: all bolt frames in one BC3 texture array, packed from the separate
+	//		   frames and compressed on the first run (delete BoltArray.dds and
+	//		   BoltArrayBC3.dds to cook it again)
+	const std::string boltArrayFile = "../../Textures/BoltArray.dds";
+	const std::string boltArrayBC3File = "../../Textures/BoltArrayBC3.dds";
+	if (!TexturePacker::IsPacked(boltArrayBC3File, gNumBoltFrames) &&
+		!TexturePacker::IsPacked(boltArrayFile, gNumBoltFrames)) {
+		std::vector<std::string> boltFrames;
+		for (int i = 1; i <= gNumBoltFrames; ++i) {
+			const std::string fileNamePrefix = (i < 10) ? "../../Textures/Bolt00" : "../../Textures/Bolt0";
+			boltFrames.push_back(fileNamePrefix + std::to_string(i) + ".dds");
+		}
+
+		TexturePacker::Report report;
+		TexturePacker::Status status = TexturePacker::PackArray(boltFrames, boltArrayFile, &report);
+		::OutputDebugStringA(("BlendApp: " + std::string(TexturePacker::StatusToString(status)) + ", " +
+			report.Filename + ": " + report.ToString() + "\n").c_str());
+		if (status != TexturePacker::Status::Ok)
+			ThrowIfFailed(E_FAIL);
+	}
+
+	// Modify: a quarter of the memory and upload of the 8 bit frames
+	if (!TexturePacker::IsPacked(boltArrayBC3File, gNumBoltFrames)) {
+		BlockCompression::Report report;
+		BlockCompression::Status status = BlockCompression::CompressDDS(boltArrayFile, boltArrayBC3File,
+			BlockCompression::Format::BC3, BlockCompression::Quality::Normal, &mThreadPool, &report);
+		::OutputDebugStringA(("BlendApp: " + std::string(BlockCompression::StatusToString(status)) + ", " +
+			boltArrayBC3File + ": " + report.ToString() + "\n").c_str());
+		if (status != BlockCompression::Status::Ok)
+			ThrowIfFailed(E_FAIL);
 	}
+
+	auto boltTex = std::make_unique<Texture>();
+	boltTex->Name = "boltTex";
+	boltTex->Filename = L"../../Textures/BoltArrayBC3.dds";
+	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
+		mCommandList.Get(), boltTex->Filename.c_str(),
+		boltTex->Resource, boltTex->UploadHeap));
+
+	mTextures[boltTex->Name] = std::move(boltTex);
 }
 
 void BlendApp::BuildRootSignature()
@@ -620,7 +654,7 @@ void BlendApp::BuildDescriptorHeaps()
 	// Create the SRV heap.
 	//
 	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 62;
+	srvHeapDesc.NumDescriptors = 3;
 	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
@@ -631,14 +665,8 @@ void BlendApp::BuildDescriptorHeaps()
 
 	auto grassTex = mTextures["grassTex"]->Resource;
 	auto waterTex = mTextures["waterTex"]->Resource;
+	auto boltTex = mTextures["boltTex"]->Resource;
 
-	// Modify: load all the bolt textures into descriptor heap
-	std::vector<ComPtr<ID3D12Resource>> boltTexList(60);
-	const std::string boltTexNamePrefix = "BoltTex_";
-	for (size_t i = 0; i < 60; ++i) {
-		boltTexList[i] = mTextures[boltTexNamePrefix + std::to_string(i)]->Resource;
-	}
-	
 	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
 
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
@@ -658,14 +686,14 @@ void BlendApp::BuildDescriptorHeaps()
 	// next descriptor
 	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
 
-	for (size_t i = 0; i < 60; ++i) {
-		srvDesc.Format = boltTexList[i]->GetDesc().Format;
-		md3dDevice->CreateShaderResourceView(boltTexList[i].Get(), &srvDesc, hDescriptor);
-		
-		// next descriptor
-		hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	}
-	
+	// Modify: one array view for every bolt frame
+	srvDesc.Format = boltTex->GetDesc().Format;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+	srvDesc.Texture2DArray.MostDetailedMip = 0;
+	srvDesc.Texture2DArray.MipLevels = -1;
+	srvDesc.Texture2DArray.FirstArraySlice = 0;
+	srvDesc.Texture2DArray.ArraySize = boltTex->GetDesc().DepthOrArraySize;
+	md3dDevice->CreateShaderResourceView(boltTex.Get(), &srvDesc, hDescriptor);
 }
 
 void BlendApp::BuildShadersAndInputLayout()
@@ -683,9 +711,19 @@ void BlendApp::BuildShadersAndInputLayout()
 		NULL, NULL
 	};
 
+	// Modify: alpha tested, sampling the frame of a texture array
+	const D3D_SHADER_MACRO flipbookDefines[] =
+	{
+		"FOG", "1",
+		"ALPHA_TEST", "1",
+		"FLIPBOOK", "1",
+		NULL, NULL
+	};
+
 	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders/Default.hlsl", nullptr, "VS", "vs_5_1");
 	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders/Default.hlsl", defines, "PS", "ps_5_1");
 	mShaders["alphaTestedPS"] = d3dUtil::CompileShader(L"Shaders/Default.hlsl", alphaTestDefines, "PS", "ps_5_1");
+	mShaders["flipbookPS"] = d3dUtil::CompileShader(L"Shaders/Default.hlsl", flipbookDefines, "PS", "ps_5_1");
 	
     mInputLayout =
     {
@@ -1020,8 +1058,8 @@ void BlendApp::BuildPSOs()
 	
 	boltPsoDesc.PS =
 	{
-		reinterpret_cast<BYTE*>(mShaders["alphaTestedPS"]->GetBufferPointer()),
-		mShaders["alphaTestedPS"]->GetBufferSize()
+		reinterpret_cast<BYTE*>(mShaders["flipbookPS"]->GetBufferPointer()),
+		mShaders["flipbookPS"]->GetBufferSize()
 	};
 	boltPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
 	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&boltPsoDesc, IID_PPV_ARGS(&mPSOs["bolt"])));
@@ -1135,14 +1173,8 @@ void BlendApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::ve
         cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
         cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
 
-    		// Modify: bolt texture descriptors start from 2, and the
-    		//		   offset is based on current bolt texture index
 		CD3DX12_GPU_DESCRIPTOR_HANDLE tex(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		INT OffsetInDescriptors = ri->Mat->DiffuseSrvHeapIndex;
-    		if (OffsetInDescriptors == 2) {
-			OffsetInDescriptors += mCurrBoltTexIndex++;
-    		}
-		tex.Offset(OffsetInDescriptors, mCbvSrvDescriptorSize);
+		tex.Offset(ri->Mat->DiffuseSrvHeapIndex, mCbvSrvDescriptorSize);
 
         D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex*objCBByteSize;
 		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex*matCBByteSize;
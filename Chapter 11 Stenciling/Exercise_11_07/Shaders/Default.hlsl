@@ -22,7 +22,16 @@
 // Include structures and functions for lighting.
 #include "LightingUtil.hlsl"
 
+#ifdef FLIPBOOK
+// Frames of an animation, one per array slice.
+Texture2DArray gDiffuseMap : register(t0);
+
+#ifndef FLIPBOOK_FPS
+    #define FLIPBOOK_FPS 60.0f
+#endif
+#else
 Texture2D    gDiffuseMap : register(t0);
+#endif
 
 
 SamplerState gsamPointWrap        : register(s0);
@@ -173,7 +182,14 @@ VertexOut VS(VertexIn vin)
 
 float4 PS(VertexOut pin) : SV_Target
 {
+#ifdef FLIPBOOK
+    uint width, height, frameCount, mipLevels;
+    gDiffuseMap.GetDimensions(0, width, height, frameCount, mipLevels);
+    float frame = (uint)(gPassConstants.gTotalTime * FLIPBOOK_FPS) % frameCount;
+    float4 diffuseAlbedo = gDiffuseMap.Sample(gsamAnisotropicWrap, float3(pin.TexC, frame)) * gMaterialConstants.gDiffuseAlbedo;
+#else
     float4 diffuseAlbedo = gDiffuseMap.Sample(gsamAnisotropicWrap, pin.TexC) * gMaterialConstants.gDiffuseAlbedo;
+#endif
 	
 #ifdef ALPHA_TEST
 	// Discard pixel if texture alpha < 0.1.  We do this test as soon 
@@ -396,16 +396,16 @@ void StencilApp::OnKeyboardInput(const GameTimer& gt)
 
 	const float dt = gt.DeltaTime();
 
-	if(GetAsyncKeyState('A') & 0x8000)
+	if(IsKeyDown('A'))
 		mSkullTranslation.x -= 1.0f*dt;
 
-	if(GetAsyncKeyState('D') & 0x8000)
+	if(IsKeyDown('D'))
 		mSkullTranslation.x += 1.0f*dt;
 
-	if(GetAsyncKeyState('W') & 0x8000)
+	if(IsKeyDown('W'))
 		mSkullTranslation.y += 1.0f*dt;
 
-	if(GetAsyncKeyState('S') & 0x8000)
+	if(IsKeyDown('S'))
 		mSkullTranslation.y -= 1.0f*dt;
 
 	// Don't let user move below ground plane.
@@ -409,9 +409,9 @@ void BlendApp::OnMouseMove(WPARAM btnState, int x, int y)
 void BlendApp::OnKeyboardInput(const GameTimer& gt)
 {
 	// Modify: use keyboard input to switch modes
-	mVisualizeVertexNormal = GetAsyncKeyState('1') & 0x8000;
-	mVisualizeFaceNormal = GetAsyncKeyState('2') & 0x8000;
-	mIsWireFrameMode = !(GetAsyncKeyState('3') & 0x8000);
+	mVisualizeVertexNormal = IsKeyDown('1');
+	mVisualizeFaceNormal = IsKeyDown('2');
+	mIsWireFrameMode = !IsKeyDown('3');
 }
  
 void BlendApp::UpdateCamera(const GameTimer& gt)
@@ -6,6 +6,7 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/MipGenerator.h"
 #include "FrameResource.h"
 #include "Waves.h"
 
@@ -564,9 +565,28 @@ void TreeBillboardsApp::LoadTextures()
 		mCommandList.Get(), fenceTex->Filename.c_str(),
 		fenceTex->Resource, fenceTex->UploadHeap));
 
+	// treeArray2.dds has a single mip, so the distant trees alias.  Build the
+	// chain on the first run, keeping the share of texels that pass the
+	// clip(alpha - 0.1) test so the trees do not thin out with distance.
+	const std::string treeArrayMipsFile = "../../Textures/treeArray2Mips.dds";
+	if(!std::ifstream(treeArrayMipsFile).good())
+	{
+		MipGenerator::Settings settings;
+		settings.PreserveAlphaCoverage = true;
+		settings.AlphaReference = 0.1f;
+
+		MipGenerator::Report report;
+		MipGenerator::Status status = MipGenerator::GenerateDDS("../../Textures/treeArray2.dds",
+			treeArrayMipsFile, settings, nullptr, &report);
+		::OutputDebugStringA(("TreeBillboardsApp: " + std::string(MipGenerator::StatusToString(status)) + ", " +
+			treeArrayMipsFile + ": " + report.ToString() + "\n").c_str());
+		if(status != MipGenerator::Status::Ok)
+			ThrowIfFailed(E_FAIL);
+	}
+
 	auto treeArrayTex = std::make_unique<Texture>();
 	treeArrayTex->Name = "treeArrayTex";
-	treeArrayTex->Filename = L"../../Textures/treeArray2.dds";
+	treeArrayTex->Filename = L"../../Textures/treeArray2Mips.dds";
 	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
 		mCommandList.Get(), treeArrayTex->Filename.c_str(),
 		treeArrayTex->Resource, treeArrayTex->UploadHeap));
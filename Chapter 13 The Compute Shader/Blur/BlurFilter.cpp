@@ -69,21 +69,20 @@ void BlurFilter::Execute(ID3D12GraphicsCommandList* cmdList,
 	cmdList->SetComputeRoot32BitConstants(0, 1, &blurRadius, 0);
 	cmdList->SetComputeRoot32BitConstants(0, (UINT)weights.size(), weights.data(), 1);
 
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(input,
-		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE));
+	// The input is only tracked while we use it; it is left in COPY_SOURCE.
+	mBarriers.Track(input, D3D12_RESOURCE_STATE_RENDER_TARGET);
 
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mBlurMap0.Get(),
-		D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+	mBarriers.Transition(input, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	mBarriers.Transition(mBlurMap0.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+	mBarriers.Transition(mBlurMap1.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	mBarriers.Flush(cmdList);
 
 	// Copy the input (back-buffer in this example) to BlurMap0.
 	cmdList->CopyResource(mBlurMap0.Get(), input);
-	
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mBlurMap0.Get(),
-		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
 
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mBlurMap1.Get(),
-		D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
- 
+	mBarriers.Transition(mBlurMap0.Get(), D3D12_RESOURCE_STATE_GENERIC_READ);
+	mBarriers.Flush(cmdList);
+
 	for(int i = 0; i < blurCount; ++i)
 	{
 		//
@@ -100,11 +99,9 @@ void BlurFilter::Execute(ID3D12GraphicsCommandList* cmdList,
 		UINT numGroupsX = (UINT)ceilf(mWidth / 256.0f);
 		cmdList->Dispatch(numGroupsX, mHeight, 1);
 
-		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mBlurMap0.Get(),
-			D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
-
-		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mBlurMap1.Get(),
-			D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_GENERIC_READ));
+		mBarriers.Transition(mBlurMap0.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		mBarriers.Transition(mBlurMap1.Get(), D3D12_RESOURCE_STATE_GENERIC_READ);
+		mBarriers.Flush(cmdList);
 
 		//
 		// Vertical Blur pass.
@@ -120,12 +117,12 @@ void BlurFilter::Execute(ID3D12GraphicsCommandList* cmdList,
 		UINT numGroupsY = (UINT)ceilf(mHeight / 256.0f);
 		cmdList->Dispatch(mWidth, numGroupsY, 1);
 
-		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mBlurMap0.Get(),
-			D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_GENERIC_READ));
-
-		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mBlurMap1.Get(),
-			D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+		mBarriers.Transition(mBlurMap0.Get(), D3D12_RESOURCE_STATE_GENERIC_READ);
+		mBarriers.Transition(mBlurMap1.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		mBarriers.Flush(cmdList);
 	}
+
+	mBarriers.Untrack(input);
 }
  
 std::vector<float> BlurFilter::CalcGaussWeights(float sigma)
@@ -220,4 +217,8 @@ void BlurFilter::BuildResources()
 		D3D12_RESOURCE_STATE_COMMON,
 		nullptr,
 		IID_PPV_ARGS(&mBlurMap1)));
+
+	mBarriers.Reset();
+	mBarriers.Track(mBlurMap0.Get(), D3D12_RESOURCE_STATE_COMMON);
+	mBarriers.Track(mBlurMap1.Get(), D3D12_RESOURCE_STATE_COMMON);
 }
\ No newline at end of file
@@ -7,6 +7,7 @@
 #pragma once
 
 #include "../../Common/d3dUtil.h"
+#include "../../Common/BarrierBatch.h"
 
 class BlurFilter
 {
@@ -74,4 +75,7 @@ private:
 	// Two for ping-ponging the textures.
 	Microsoft::WRL::ComPtr<ID3D12Resource> mBlurMap0 = nullptr;
 	Microsoft::WRL::ComPtr<ID3D12Resource> mBlurMap1 = nullptr;
+
+	// States of the blur maps across frames (and of the input during Execute).
+	BarrierBatch mBarriers;
 };
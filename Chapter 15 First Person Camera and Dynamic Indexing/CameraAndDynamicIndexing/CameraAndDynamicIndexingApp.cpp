@@ -9,6 +9,7 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/DirtyTracker.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -34,11 +35,10 @@ struct RenderItem
 
 	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
 
-	// Dirty flag indicating the object data has changed and we need to update the constant buffer.
-	// Because we have an object cbuffer for each FrameResource, we have to apply the
-	// update to each FrameResource.  Thus, when we modify obect data we should set 
-	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
-	int NumFramesDirty = gNumFrameResources;
+	// Dirty state is kept by CameraAndDynamicIndexingApp::mObjectDirty instead of a
+	// NumFramesDirty counter, so static objects cost nothing per frame.  When we modify
+	// object data we should call mObjectDirty.MarkDirty(ObjCBIndex) so that each
+	// frame resource gets the update.
 
 	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
 	UINT ObjCBIndex = -1;
@@ -118,6 +118,13 @@ private:
 	// Render items divided by PSO.
 	std::vector<RenderItem*> mOpaqueRitems;
 
+	// Render items and materials by constant buffer index, and which of them
+	// still need to be copied into each frame resource.
+	std::vector<RenderItem*> mRitemsByObjCB;
+	std::vector<Material*> mMaterialsByMatCB;
+	DirtyTracker mObjectDirty = DirtyTracker(gNumFrameResources);
+	DirtyTracker mMaterialDirty = DirtyTracker(gNumFrameResources);
+
     PassConstants mMainPassCB;
 
 	Camera mCamera;
@@ -328,16 +335,16 @@ void CameraAndDynamicIndexingApp::OnKeyboardInput(const GameTimer& gt)
 {
 	const float dt = gt.DeltaTime();
 
-	if(GetAsyncKeyState('W') & 0x8000)
+	if(IsKeyDown('W'))
 		mCamera.Walk(10.0f*dt);
 
-	if(GetAsyncKeyState('S') & 0x8000)
+	if(IsKeyDown('S'))
 		mCamera.Walk(-10.0f*dt);
 
-	if(GetAsyncKeyState('A') & 0x8000)
+	if(IsKeyDown('A'))
 		mCamera.Strafe(-10.0f*dt);
 
-	if(GetAsyncKeyState('D') & 0x8000)
+	if(IsKeyDown('D'))
 		mCamera.Strafe(10.0f*dt);
 
 	mCamera.UpdateViewMatrix();
@@ -351,53 +358,46 @@ void CameraAndDynamicIndexingApp::AnimateMaterials(const GameTimer& gt)
 void CameraAndDynamicIndexingApp::UpdateObjectCBs(const GameTimer& gt)
 {
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
-	for(auto& e : mAllRitems)
+
+	// Only update the cbuffer data if the constants have changed.  This is tracked
+	// per frame resource, and only the dirty render items are visited.
+	mObjectDirty.ConsumeDirty(mCurrFrameResourceIndex, [&](UINT objCBIndex)
 	{
-		// Only update the cbuffer data if the constants have changed.  
-		// This needs to be tracked per frame resource.
-		if(e->NumFramesDirty > 0)
-		{
-			XMMATRIX world = XMLoadFloat4x4(&e->World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
-
-			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
-			objConstants.MaterialIndex = e->Mat->MatCBIndex;
-
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
-
-			// Next FrameResource need to be updated too.
-			e->NumFramesDirty--;
-		}
-	}
+		RenderItem* e = mRitemsByObjCB[objCBIndex];
+
+		XMMATRIX world = XMLoadFloat4x4(&e->World);
+		XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
+
+		ObjectConstants objConstants;
+		XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
+		XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
+		objConstants.MaterialIndex = e->Mat->MatCBIndex;
+
+		currObjectCB->CopyData(e->ObjCBIndex, objConstants);
+	});
 }
 
 void CameraAndDynamicIndexingApp::UpdateMaterialBuffer(const GameTimer& gt)
 {
 	auto currMaterialBuffer = mCurrFrameResource->MaterialBuffer.get();
-	for(auto& e : mMaterials)
+
+	// Only update the cbuffer data if the constants have changed.  If the cbuffer
+	// data changes, mMaterialDirty queues it for each FrameResource.
+	mMaterialDirty.ConsumeDirty(mCurrFrameResourceIndex, [&](UINT matCBIndex)
 	{
-		// Only update the cbuffer data if the constants have changed.  If the cbuffer
-		// data changes, it needs to be updated for each FrameResource.
-		Material* mat = e.second.get();
-		if(mat->NumFramesDirty > 0)
-		{
-			XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
-
-			MaterialData matData;
-			matData.DiffuseAlbedo = mat->DiffuseAlbedo;
-			matData.FresnelR0 = mat->FresnelR0;
-			matData.Roughness = mat->Roughness;
-			XMStoreFloat4x4(&matData.MatTransform, XMMatrixTranspose(matTransform));
-			matData.DiffuseMapIndex = mat->DiffuseSrvHeapIndex;
-
-			currMaterialBuffer->CopyData(mat->MatCBIndex, matData);
-
-			// Next FrameResource need to be updated too.
-			mat->NumFramesDirty--;
-		}
-	}
+		Material* mat = mMaterialsByMatCB[matCBIndex];
+
+		XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
+
+		MaterialData matData;
+		matData.DiffuseAlbedo = mat->DiffuseAlbedo;
+		matData.FresnelR0 = mat->FresnelR0;
+		matData.Roughness = mat->Roughness;
+		XMStoreFloat4x4(&matData.MatTransform, XMMatrixTranspose(matTransform));
+		matData.DiffuseMapIndex = mat->DiffuseSrvHeapIndex;
+
+		currMaterialBuffer->CopyData(mat->MatCBIndex, matData);
+	});
 }
 
 void CameraAndDynamicIndexingApp::UpdateMainPassCB(const GameTimer& gt)
@@ -787,6 +787,12 @@ void CameraAndDynamicIndexingApp::BuildMaterials()
 	mMaterials["stone0"] = std::move(stone0);
 	mMaterials["tile0"] = std::move(tile0);
 	mMaterials["crate0"] = std::move(crate0);
+
+	// Every material starts dirty so each frame resource gets its initial data.
+	mMaterialsByMatCB.resize(mMaterials.size());
+	for(auto& e : mMaterials)
+		mMaterialsByMatCB[e.second->MatCBIndex] = e.second.get();
+	mMaterialDirty.Resize((UINT)mMaterialsByMatCB.size());
 }
 
 void CameraAndDynamicIndexingApp::BuildRenderItems()
@@ -879,6 +885,12 @@ void CameraAndDynamicIndexingApp::BuildRenderItems()
 	// All the render items are opaque.
 	for(auto& e : mAllRitems)
 		mOpaqueRitems.push_back(e.get());
+
+	// Every render item starts dirty so each frame resource gets its initial data.
+	mRitemsByObjCB.resize(mAllRitems.size());
+	for(auto& e : mAllRitems)
+		mRitemsByObjCB[e->ObjCBIndex] = e.get();
+	mObjectDirty.Resize((UINT)mRitemsByObjCB.size());
 }
 
 void CameraAndDynamicIndexingApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
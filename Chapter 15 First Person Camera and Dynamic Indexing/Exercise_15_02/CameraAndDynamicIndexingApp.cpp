@@ -327,23 +327,23 @@ void CameraAndDynamicIndexingApp::OnKeyboardInput(const GameTimer& gt)
 {
 	const float dt = gt.DeltaTime();
 
-	if(GetAsyncKeyState('W') & 0x8000)
+	if(IsKeyDown('W'))
 		mCamera.Walk(10.0f*dt);
 
-	if(GetAsyncKeyState('S') & 0x8000)
+	if(IsKeyDown('S'))
 		mCamera.Walk(-10.0f*dt);
 
-	if(GetAsyncKeyState('A') & 0x8000)
+	if(IsKeyDown('A'))
 		mCamera.Strafe(-10.0f*dt);
 
-	if(GetAsyncKeyState('D') & 0x8000)
+	if(IsKeyDown('D'))
 		mCamera.Strafe(10.0f*dt);
 
 	// Modify: add rolling
-	if (GetAsyncKeyState('Q') & 0x8000)
+	if (IsKeyDown('Q'))
 		mCamera.Roll(-5.0f * dt);
 
-	if (GetAsyncKeyState('E') & 0x8000)
+	if (IsKeyDown('E'))
 		mCamera.Roll(5.0f * dt);
 
 	mCamera.UpdateViewMatrix();
@@ -368,6 +368,8 @@ void InstancingAndCullingApp::AnimateMaterials(const GameTimer& gt)
 
 void InstancingAndCullingApp::UpdateInstanceData(const GameTimer& gt)
 {
+	PROFILE_SCOPE("UpdateInstanceData");
+
 	XMMATRIX view = mCamera.GetView();
 	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
 
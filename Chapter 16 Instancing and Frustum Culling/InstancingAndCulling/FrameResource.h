@@ -68,7 +68,7 @@ struct FrameResource
 {
 public:
     
-    FrameResource(ID3D12Device* device, UINT passCount, UINT maxInstanceCount, UINT materialCount);
+    FrameResource(ID3D12Device* device, UINT passCount, UINT materialCount);
     FrameResource(const FrameResource& rhs) = delete;
     FrameResource& operator=(const FrameResource& rhs) = delete;
     ~FrameResource();
@@ -83,15 +83,9 @@ public:
     std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
     std::unique_ptr<UploadBuffer<MaterialData>> MaterialBuffer = nullptr;
 
-	// NOTE: In this demo, we instance only one render-item, so we only have one structured buffer to 
-	// store instancing data.  To make this more general (i.e., to support instancing multiple render-items), 
-	// you would need to have a structured buffer for each render-item, and allocate each buffer with enough
-	// room for the maximum number of instances you would ever draw.  
-	// This sounds like a lot, but it is actually no more than the amount of per-object constant data we 
-	// would need if we were not using instancing.  For example, if we were drawing 1000 objects without instancing,
-	// we would create a constant buffer with enough room for a 1000 objects.  With instancing, we would just
-	// create a structured buffer large enough to store the instance data for 1000 instances.  
-    std::unique_ptr<UploadBuffer<InstanceData>> InstanceBuffer = nullptr;
+	// NOTE: Instance data is not stored here.  It is suballocated every frame from the app's
+	// UploadRing, so each render-item gets exactly the room its visible instances need and
+	// the space is reclaimed when this frame resource's fence completes.
 
     // Fence value to mark commands up to this fence point.  This lets us
     // check if these frame resources are still in use by the GPU.
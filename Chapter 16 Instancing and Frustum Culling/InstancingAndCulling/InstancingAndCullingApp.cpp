@@ -5,8 +5,11 @@
 #include "../../Common/d3dApp.h"
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
+#include "../../Common/UploadRing.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/BoundsFitting.h"
+#include "../../Common/VertexCompression.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -48,11 +51,20 @@ struct RenderItem
     D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
 	BoundingBox Bounds;
+
+	// Tightest of sphere/AABB/OBB fitted to the mesh, tested after the box.
+	BoundingVolume TightBounds;
+
+	// Maps the quantized positions of Geo back to local space (see VertexCompression).
+	XMFLOAT3 PosScale = { 1.0f, 1.0f, 1.0f };
+	XMFLOAT3 PosBias = { 0.0f, 0.0f, 0.0f };
+
 	std::vector<InstanceData> Instances;
 
     // DrawIndexedInstanced parameters.
     UINT IndexCount = 0;
 	UINT InstanceCount = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS InstanceBufferAddress = 0;
     UINT StartIndexLocation = 0;
     int BaseVertexLocation = 0;
 };
@@ -123,6 +135,11 @@ private:
 
 	UINT mInstanceCount = 0;
 
+	// Per-frame instance data for all render items, and the indices of the
+	// instances that passed culling this frame.
+	std::unique_ptr<UploadRing> mUploadRing;
+	std::vector<UINT> mVisibleInstances;
+
 	bool mFrustumCullingEnabled = true;
 
 	BoundingFrustum mCamFrustum;
@@ -230,6 +247,9 @@ void InstancingAndCullingApp::Update(const GameTimer& gt)
         CloseHandle(eventHandle);
     }
 
+	// Reclaim the instance data of frames the GPU has finished with.
+	mUploadRing->Retire(mFence->GetCompletedValue());
+
 	AnimateMaterials(gt);
 	UpdateInstanceData(gt);
 	UpdateMaterialBuffer(gt);
@@ -302,6 +322,9 @@ void InstancingAndCullingApp::Draw(const GameTimer& gt)
     // Because we are on the GPU timeline, the new fence point won't be 
     // set until the GPU finishes processing all the commands prior to this Signal().
     mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+
+	// Everything allocated from the ring this frame is in use until this fence point.
+	mUploadRing->FinishFrame(mCurrentFence);
 }
 
 void InstancingAndCullingApp::OnMouseDown(WPARAM btnState, int x, int y)
@@ -337,22 +360,22 @@ void InstancingAndCullingApp::OnKeyboardInput(const GameTimer& gt)
 {
 	const float dt = gt.DeltaTime();
 
-	if(GetAsyncKeyState('W') & 0x8000)
+	if(IsKeyDown('W'))
 		mCamera.Walk(20.0f*dt);
 
-	if(GetAsyncKeyState('S') & 0x8000)
+	if(IsKeyDown('S'))
 		mCamera.Walk(-20.0f*dt);
 
-	if(GetAsyncKeyState('A') & 0x8000)
+	if(IsKeyDown('A'))
 		mCamera.Strafe(-20.0f*dt);
 
-	if(GetAsyncKeyState('D') & 0x8000)
+	if(IsKeyDown('D'))
 		mCamera.Strafe(20.0f*dt);
 
-	if(GetAsyncKeyState('1') & 0x8000)
+	if(IsKeyDown('1'))
 		mFrustumCullingEnabled = true;
 
-	if(GetAsyncKeyState('2') & 0x8000)
+	if(IsKeyDown('2'))
 		mFrustumCullingEnabled = false;
 
 	mCamera.UpdateViewMatrix();
@@ -365,20 +388,23 @@ void InstancingAndCullingApp::AnimateMaterials(const GameTimer& gt)
 
 void InstancingAndCullingApp::UpdateInstanceData(const GameTimer& gt)
 {
+	PROFILE_SCOPE("UpdateInstanceData");
+
 	XMMATRIX view = mCamera.GetView();
 	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
 
-	auto currInstanceBuffer = mCurrFrameResource->InstanceBuffer.get();
 	for(auto& e : mAllRitems)
 	{
 		const auto& instanceData = e->Instances;
 
-		int visibleInstanceCount = 0;
+		mVisibleInstances.clear();
+
+		// Instances the AABB test lets through but the tight volume rejects.
+		int boxFalsePositiveCount = 0;
 
 		for(UINT i = 0; i < (UINT)instanceData.size(); ++i)
 		{
 			XMMATRIX world = XMLoadFloat4x4(&instanceData[i].World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&instanceData[i].TexTransform);
 
 			XMMATRIX invWorld = XMMatrixInverse(&XMMatrixDeterminant(world), world);
 
@@ -389,26 +415,51 @@ void InstancingAndCullingApp::UpdateInstanceData(const GameTimer& gt)
 			BoundingFrustum localSpaceFrustum;
 			mCamFrustum.Transform(localSpaceFrustum, viewToLocal);
 
-			// Perform the box/frustum intersection test in local space.
-			if((localSpaceFrustum.Contains(e->Bounds) != DirectX::DISJOINT) || (mFrustumCullingEnabled==false))
+			// Perform the box/frustum intersection test in local space.  Instances
+			// passing it are tested again against the tighter fitted volume.
+			bool visible = true;
+			if(mFrustumCullingEnabled)
 			{
-				InstanceData data;
-				XMStoreFloat4x4(&data.World, XMMatrixTranspose(world));
-				XMStoreFloat4x4(&data.TexTransform, XMMatrixTranspose(texTransform));
-				data.MaterialIndex = instanceData[i].MaterialIndex;
-
-				// Write the instance data to structured buffer for the visible objects.
-				currInstanceBuffer->CopyData(visibleInstanceCount++, data);
+				visible = localSpaceFrustum.Contains(e->Bounds) != DirectX::DISJOINT;
+				if(visible && e->TightBounds.ContainedBy(localSpaceFrustum) == DirectX::DISJOINT)
+				{
+					visible = false;
+					boxFalsePositiveCount++;
+				}
 			}
+
+			if(visible)
+				mVisibleInstances.push_back(i);
 		}
 
-		e->InstanceCount = visibleInstanceCount;
+		// Allocate exactly enough room for the visible instances of this render item.
+		auto instanceBuffer = mUploadRing->AllocateArray<InstanceData>((UINT)mVisibleInstances.size());
+		InstanceData* visibleData = reinterpret_cast<InstanceData*>(instanceBuffer.CpuAddress);
+
+		for(UINT v = 0; v < (UINT)mVisibleInstances.size(); ++v)
+		{
+			const InstanceData& src = instanceData[mVisibleInstances[v]];
+
+			XMMATRIX world = XMLoadFloat4x4(&src.World);
+			XMMATRIX texTransform = XMLoadFloat4x4(&src.TexTransform);
+
+			// Write the instance data to structured buffer for the visible objects.
+			InstanceData data;
+			XMStoreFloat4x4(&data.World, XMMatrixTranspose(world));
+			XMStoreFloat4x4(&data.TexTransform, XMMatrixTranspose(texTransform));
+			data.MaterialIndex = src.MaterialIndex;
+			visibleData[v] = data;
+		}
+
+		e->InstanceCount = (UINT)mVisibleInstances.size();
+		e->InstanceBufferAddress = instanceBuffer.GpuAddress;
 
 		std::wostringstream outs;
 		outs.precision(6);
 		outs << L"Instancing and Culling Demo" <<
 			L"    " << e->InstanceCount <<
-			L" objects visible out of " << e->Instances.size();
+			L" objects visible out of " << e->Instances.size() <<
+			L"    (" << boxFalsePositiveCount << L" AABB false positives)";
 		mMainWndCaption = outs.str();
 	}
 }
@@ -541,18 +592,19 @@ void InstancingAndCullingApp::BuildRootSignature()
 	texTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 7, 0, 0);
 
     // Root parameter can be a table, root descriptor or root constants.
-    CD3DX12_ROOT_PARAMETER slotRootParameter[4];
+    CD3DX12_ROOT_PARAMETER slotRootParameter[5];
 
 	// Perfomance TIP: Order from most frequent to least frequent.
     slotRootParameter[0].InitAsShaderResourceView(0, 1);
     slotRootParameter[1].InitAsShaderResourceView(1, 1);
     slotRootParameter[2].InitAsConstantBufferView(0);
 	slotRootParameter[3].InitAsDescriptorTable(1, &texTable, D3D12_SHADER_VISIBILITY_PIXEL);
+	slotRootParameter[4].InitAsConstants(8, 1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
 
 	auto staticSamplers = GetStaticSamplers();
 
     // A root signature is an array of root parameters.
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(4, slotRootParameter,
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(5, slotRootParameter,
 		(UINT)staticSamplers.size(), staticSamplers.data(),
 		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
@@ -662,12 +714,8 @@ void InstancingAndCullingApp::BuildShadersAndInputLayout()
 	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1");
 	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "PS", "ps_5_1");
 	
-    mInputLayout =
-    {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-    };
+	// The skull is drawn from VertexCompression::Vertex (16 bytes instead of 32).
+    mInputLayout = VertexCompression::GetInputLayout();
 }
 
 void InstancingAndCullingApp::BuildSkullGeometry()
@@ -727,6 +775,8 @@ void InstancingAndCullingApp::BuildSkullGeometry()
 	XMStoreFloat3(&bounds.Center, 0.5f*(vMin + vMax));
 	XMStoreFloat3(&bounds.Extents, 0.5f*(vMax - vMin));
 
+	BoundingVolume tightBounds = BoundsFitting::Fit(&vertices[0].Pos, sizeof(Vertex), vcount);
+
 	fin >> ignore;
 	fin >> ignore;
 	fin >> ignore;
@@ -739,11 +789,21 @@ void InstancingAndCullingApp::BuildSkullGeometry()
 
 	fin.close();
 
+	//
+	// Quantize the vertices relative to the bounds; the vertex shader maps them
+	// back with the render item's PosScale/PosBias.
+	//
+
+	std::vector<VertexCompression::Vertex> packedVertices(vcount);
+	VertexCompression::Report report;
+	VertexCompression::Compress(vertices.data(), vcount, bounds, packedVertices.data(), &report);
+	::OutputDebugStringW((L"skull: " + report.ToString()).c_str());
+
 	//
 	// Pack the indices of all the meshes into one index buffer.
 	//
 
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
+	const UINT vbByteSize = (UINT)packedVertices.size() * sizeof(VertexCompression::Vertex);
 
 	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::int32_t);
 
@@ -751,18 +811,18 @@ void InstancingAndCullingApp::BuildSkullGeometry()
 	geo->Name = "skullGeo";
 
 	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
+	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), packedVertices.data(), vbByteSize);
 
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
 	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+		mCommandList.Get(), packedVertices.data(), vbByteSize, geo->VertexBufferUploader);
 
 	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
 		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
 
-	geo->VertexByteStride = sizeof(Vertex);
+	geo->VertexByteStride = sizeof(VertexCompression::Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R32_UINT;
 	geo->IndexBufferByteSize = ibByteSize;
@@ -772,6 +832,7 @@ void InstancingAndCullingApp::BuildSkullGeometry()
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
 	submesh.Bounds = bounds;
+	submesh.TightBounds = tightBounds;
 
 	geo->DrawArgs["skull"] = submesh;
 
@@ -816,8 +877,13 @@ void InstancingAndCullingApp::BuildFrameResources()
     for(int i = 0; i < gNumFrameResources; ++i)
     {
         mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
-            1, mInstanceCount, (UINT)mMaterials.size()));
+            1, (UINT)mMaterials.size()));
     }
+
+	// Room for every instance to be visible in each frame in flight, plus slack for
+	// alignment and for the ring wrapping around.
+	UINT64 frameBytes = (UINT64)sizeof(InstanceData)*mInstanceCount + D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT*mAllRitems.size();
+	mUploadRing = std::make_unique<UploadRing>(md3dDevice.Get(), frameBytes*(gNumFrameResources + 1));
 }
 
 void InstancingAndCullingApp::BuildMaterials()
@@ -901,6 +967,8 @@ void InstancingAndCullingApp::BuildRenderItems()
 	skullRitem->StartIndexLocation = skullRitem->Geo->DrawArgs["skull"].StartIndexLocation;
 	skullRitem->BaseVertexLocation = skullRitem->Geo->DrawArgs["skull"].BaseVertexLocation;
 	skullRitem->Bounds = skullRitem->Geo->DrawArgs["skull"].Bounds;
+	skullRitem->TightBounds = skullRitem->Geo->DrawArgs["skull"].TightBounds;
+	VertexCompression::GetDequantizeScaleBias(skullRitem->Bounds, skullRitem->PosScale, skullRitem->PosBias);
 
 	// Generate instance data.
 	const int n = 5;
@@ -959,8 +1027,14 @@ void InstancingAndCullingApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList
 
 		// Set the instance buffer to use for this render-item.  For structured buffers, we can bypass 
 		// the heap and set as a root descriptor.
-		auto instanceBuffer = mCurrFrameResource->InstanceBuffer->Resource();
-		mCommandList->SetGraphicsRootShaderResourceView(0, instanceBuffer->GetGPUVirtualAddress());
+		mCommandList->SetGraphicsRootShaderResourceView(0, ri->InstanceBufferAddress);
+
+		const XMFLOAT4 dequantize[2] =
+		{
+			XMFLOAT4(ri->PosScale.x, ri->PosScale.y, ri->PosScale.z, 0.0f),
+			XMFLOAT4(ri->PosBias.x, ri->PosBias.y, ri->PosBias.z, 0.0f),
+		};
+		cmdList->SetGraphicsRoot32BitConstants(4, 8, dequantize, 0);
 
         cmdList->DrawIndexedInstanced(ri->IndexCount, ri->InstanceCount, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
     }
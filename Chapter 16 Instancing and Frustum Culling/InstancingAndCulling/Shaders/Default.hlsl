@@ -110,13 +110,32 @@ struct PassConstants {
 
 ConstantBuffer<PassConstants> gPassConstants : register(b0);
 
+// Maps the quantized positions of the current geometry back to local space,
+// set per render item as root constants.
+cbuffer cbDequantize : register(b1)
+{
+    float4 gPosScale;
+    float4 gPosBias;
+};
+
+// VertexCompression::Vertex: the position is R16G16B16A16_UNORM relative to
+// the bounds, the normal is octahedral R16G16_SNORM, the uv is R16G16_FLOAT.
 struct VertexIn
 {
-	float3 PosL    : POSITION;
-    float3 NormalL : NORMAL;
+	float4 PosL    : POSITION;
+    float2 NormalL : NORMAL;
 	float2 TexC    : TEXCOORD;
 };
 
+// Unfolds an octahedral encoded unit vector.
+float3 OctDecode(float2 e)
+{
+    float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
 struct VertexOut
 {
 	float4 PosH    : SV_POSITION;
@@ -144,12 +163,16 @@ VertexOut VS(VertexIn vin, uint instanceID : SV_InstanceID)
 	// Fetch the material data.
 	MaterialData matData = gMaterialData[matIndex];
 	
+    // Decompress the vertex.
+    float3 posL = vin.PosL.xyz*gPosScale.xyz + gPosBias.xyz;
+    float3 normalL = OctDecode(vin.NormalL);
+
     // Transform to world space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), world);
+    float4 posW = mul(float4(posL, 1.0f), world);
     vout.PosW = posW.xyz;
 
     // Assumes nonuniform scaling; otherwise, need to use inverse-transpose of world matrix.
-    vout.NormalW = mul(vin.NormalL, (float3x3)world);
+    vout.NormalW = mul(normalL, (float3x3)world);
 
     // Transform to homogeneous clip space.
     vout.PosH = mul(posW, gPassConstants.gViewProj);
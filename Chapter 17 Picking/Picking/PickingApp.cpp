@@ -7,6 +7,7 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/BoundsFitting.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -28,6 +29,9 @@ struct RenderItem
 	bool Visible = true;
 
 	BoundingBox Bounds;
+
+	// Tightest of sphere/AABB/OBB fitted to the mesh, tested after the box.
+	BoundingVolume TightBounds;
  
     // World matrix of the shape that describes the object's local space
     // relative to the world space, which defines the position, orientation,
@@ -131,6 +135,12 @@ private:
 
 	RenderItem* mPickedRitem = nullptr;
 
+	// Ray/render item tests of all picks so far, and how many of them hit the
+	// AABB or the fitted volume but none of the triangles.
+	UINT mRayTestCount = 0;
+	UINT mBoxFalsePositiveCount = 0;
+	UINT mTightFalsePositiveCount = 0;
+
     PassConstants mMainPassCB;
 
 	Camera mCamera;
@@ -354,16 +364,16 @@ void PickingApp::OnKeyboardInput(const GameTimer& gt)
 {
 	const float dt = gt.DeltaTime();
 
-	if(GetAsyncKeyState('W') & 0x8000)
+	if(IsKeyDown('W'))
 		mCamera.Walk(10.0f*dt);
 
-	if(GetAsyncKeyState('S') & 0x8000)
+	if(IsKeyDown('S'))
 		mCamera.Walk(-10.0f*dt);
 
-	if(GetAsyncKeyState('A') & 0x8000)
+	if(IsKeyDown('A'))
 		mCamera.Strafe(-10.0f*dt);
 
-	if(GetAsyncKeyState('D') & 0x8000)
+	if(IsKeyDown('D'))
 		mCamera.Strafe(10.0f*dt);
 
 	mCamera.UpdateViewMatrix();
@@ -603,6 +613,8 @@ void PickingApp::BuildCarGeometry()
 	XMStoreFloat3(&bounds.Center, 0.5f*(vMin + vMax));
 	XMStoreFloat3(&bounds.Extents, 0.5f*(vMax - vMin));
 
+	BoundingVolume tightBounds = BoundsFitting::Fit(&vertices[0].Pos, sizeof(Vertex), vcount);
+
 	fin >> ignore;
 	fin >> ignore;
 	fin >> ignore;
@@ -648,6 +660,7 @@ void PickingApp::BuildCarGeometry()
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
 	submesh.Bounds = bounds;
+	submesh.TightBounds = tightBounds;
 
 	geo->DrawArgs["car"] = submesh;
 
@@ -757,6 +770,7 @@ void PickingApp::BuildRenderItems()
 	carRitem->Geo = mGeometries["carGeo"].get();
 	carRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	carRitem->Bounds = carRitem->Geo->DrawArgs["car"].Bounds;
+	carRitem->TightBounds = carRitem->Geo->DrawArgs["car"].TightBounds;
 	carRitem->IndexCount = carRitem->Geo->DrawArgs["car"].IndexCount;
 	carRitem->StartIndexLocation = carRitem->Geo->DrawArgs["car"].StartIndexLocation;
 	carRitem->BaseVertexLocation = carRitem->Geo->DrawArgs["car"].BaseVertexLocation;
@@ -912,9 +926,13 @@ void PickingApp::Pick(int sx, int sy)
 		// so do the ray/triangle tests.
 		//
 		// If we did not hit the bounding box, then it is impossible that we hit 
-		// the Mesh, so do not waste effort doing ray/triangle tests.
+		// the Mesh, so do not waste effort doing ray/triangle tests.  The box is
+		// cheap, so test it first and only then the tighter fitted volume.
 		float tmin = 0.0f;
-		if(ri->Bounds.Intersects(rayOrigin, rayDir, tmin))
+		bool boxHit = ri->Bounds.Intersects(rayOrigin, rayDir, tmin);
+		bool tightHit = boxHit && ri->TightBounds.Intersects(rayOrigin, rayDir, tmin);
+		bool triangleHit = false;
+		if(tightHit)
 		{
 			// NOTE: For the demo, we know what to cast the vertex/index data to.  If we were mixing
 			// formats, some metadata would be needed to figure out what to cast it to.
@@ -940,6 +958,8 @@ void PickingApp::Pick(int sx, int sy)
 				float t = 0.0f;
 				if(TriangleTests::Intersects(rayOrigin, rayDir, v0, v1, v2, t))
 				{
+					triangleHit = true;
+
 					if(t < tmin)
 					{
 						// This is the new nearest picked triangle.
@@ -960,5 +980,23 @@ void PickingApp::Pick(int sx, int sy)
 				}
 			}
 		}
+
+		// The fitted volume contains the mesh, so a ray it rejects misses every
+		// triangle: a box hit it rejects is a false positive of the box alone.
+		mRayTestCount++;
+		if(boxHit && !triangleHit)
+			mBoxFalsePositiveCount++;
+		if(tightHit && !triangleHit)
+			mTightFalsePositiveCount++;
 	}
+
+	if(mRayTestCount == 0)
+		return;
+
+	std::wostringstream outs;
+	outs.precision(3);
+	outs << L"Picking: " << mRayTestCount << L" ray tests, false positives: AABB " <<
+		mBoxFalsePositiveCount << L" (" << 100.0f*mBoxFalsePositiveCount / mRayTestCount << L"%), fitted volume " <<
+		mTightFalsePositiveCount << L" (" << 100.0f*mTightFalsePositiveCount / mRayTestCount << L"%)\n";
+	::OutputDebugStringW(outs.str().c_str());
 }
\ No newline at end of file
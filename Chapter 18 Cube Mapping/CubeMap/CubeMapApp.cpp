@@ -7,6 +7,10 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/DrawPacket.h"
+#include "../../Common/ParallelRecorder.h"
+#include "../../Common/ParallelCommandLists.h"
+#include "../../Common/Meshlet.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -44,6 +48,9 @@ struct RenderItem
 	Material* Mat = nullptr;
 	MeshGeometry* Geo = nullptr;
 
+	// Index of Geo in CubeMapApp::mPacketGeometries, used by the draw packets.
+	UINT GeoId = 0;
+
     // Primitive topology.
     D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
@@ -51,6 +58,10 @@ struct RenderItem
     UINT IndexCount = 0;
     UINT StartIndexLocation = 0;
     int BaseVertexLocation = 0;
+
+	// If set, the index range above is ordered by these meshlets and only the
+	// meshlets passing MeshletCuller are drawn.
+	const MeshletMesh* Meshlets = nullptr;
 };
 
 enum class RenderLayer : int
@@ -60,6 +71,54 @@ enum class RenderLayer : int
 	Count
 };
 
+// Turns the ids of the draw packets into command list calls.
+class CommandListDrawRecorder : public DrawPacketRecorder
+{
+public:
+	CommandListDrawRecorder(ID3D12GraphicsCommandList* cmdList,
+		const std::vector<ID3D12PipelineState*>& psos,
+		const std::vector<MeshGeometry*>& geometries)
+		: mCmdList(cmdList), mPsos(psos), mGeometries(geometries)
+	{
+	}
+
+	virtual void SetPipelineState(std::uint32_t pso)override
+	{
+		mCmdList->SetPipelineState(mPsos[pso]);
+	}
+
+	virtual void SetGeometry(std::uint32_t geometry)override
+	{
+		mCmdList->IASetVertexBuffers(0, 1, &mGeometries[geometry]->VertexBufferView());
+		mCmdList->IASetIndexBuffer(&mGeometries[geometry]->IndexBufferView());
+	}
+
+	virtual void SetPrimitiveTopology(std::uint32_t topology)override
+	{
+		mCmdList->IASetPrimitiveTopology((D3D12_PRIMITIVE_TOPOLOGY)topology);
+	}
+
+	virtual void SetMaterial(std::uint32_t material)override
+	{
+		// Materials are indexed from the structured buffer, nothing to bind per material.
+	}
+
+	virtual void SetObjectCB(std::uint64_t objectCB)override
+	{
+		mCmdList->SetGraphicsRootConstantBufferView(0, objectCB);
+	}
+
+	virtual void DrawIndexedInstanced(const DrawPacket& p)override
+	{
+		mCmdList->DrawIndexedInstanced(p.IndexCount, p.InstanceCount, p.StartIndexLocation, p.BaseVertexLocation, p.StartInstanceLocation);
+	}
+
+private:
+	ID3D12GraphicsCommandList* mCmdList;
+	const std::vector<ID3D12PipelineState*>& mPsos;
+	const std::vector<MeshGeometry*>& mGeometries;
+};
+
 class CubeMapApp : public D3DApp
 {
 public:
@@ -95,7 +154,9 @@ private:
     void BuildFrameResources();
     void BuildMaterials();
     void BuildRenderItems();
-    void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+	void BuildDrawPacketTables();
+	void BuildDrawPackets();
+	void SetPassState(ID3D12GraphicsCommandList* cmdList);
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();
 
@@ -125,8 +186,31 @@ private:
 	// Render items divided by PSO.
 	std::vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
 
+	// Draw packets for all layers, rebuilt and sorted every frame.  Packets refer
+	// to PSOs and geometry by their index in these tables.
+	DrawPacketQueue mDrawPackets;
+	std::vector<ID3D12PipelineState*> mPacketPsos;
+	std::vector<MeshGeometry*> mPacketGeometries;
+	UINT mLayerPso[(int)RenderLayer::Count];
+
+	// The sorted packets are recorded in mChunkCount chunks on the worker threads,
+	// chunk i into list i of mChunkLists.  The last list of mChunkLists holds the
+	// transition to PRESENT.
+	std::unique_ptr<ThreadPool> mThreadPool;
+	std::unique_ptr<ParallelRecorder> mParallelRecorder;
+	std::unique_ptr<ParallelCommandLists> mChunkLists;
+	UINT mChunkCount = 0;
+	std::vector<ID3D12CommandList*> mSubmitLists;
+
 	UINT mSkyTexHeapIndex = 0;
 
+	// The skull is split into meshlets that are culled against the camera every
+	// frame; the last frame's results are kept in mSkullCullStats.
+	MeshletMesh mSkullMeshlets;
+	std::vector<std::uint32_t> mVisibleMeshlets;
+	std::vector<MeshletCuller::DrawRange> mMeshletRanges;
+	MeshletCuller::Stats mSkullCullStats;
+
     PassConstants mMainPassCB;
 
 	Camera mCamera;
@@ -190,6 +274,13 @@ bool CubeMapApp::Initialize()
     BuildRenderItems();
     BuildFrameResources();
     BuildPSOs();
+	BuildDrawPacketTables();
+
+	// The scene is small, a few workers are plenty.
+	mThreadPool = std::make_unique<ThreadPool>(MathHelper::Min(ThreadPool::DefaultThreadCount(), 3u));
+	mParallelRecorder = std::make_unique<ParallelRecorder>(*mThreadPool);
+	mChunkCount = mThreadPool->WorkerCount();
+	mChunkLists = std::make_unique<ParallelCommandLists>(md3dDevice.Get(), gNumFrameResources, mChunkCount + 1);
 
     // Execute the initialization commands.
     ThrowIfFailed(mCommandList->Close());
@@ -245,9 +336,6 @@ void CubeMapApp::Draw(const GameTimer& gt)
     // Reusing the command list reuses memory.
     ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
 
-    mCommandList->RSSetViewports(1, &mScreenViewport);
-    mCommandList->RSSetScissorRects(1, &mScissorRect);
-
     // Indicate a state transition on the resource usage.
 	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
 		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
@@ -256,21 +344,75 @@ void CubeMapApp::Draw(const GameTimer& gt)
     mCommandList->ClearRenderTargetView(CurrentBackBufferView(), Colors::LightSteelBlue, 0, nullptr);
     mCommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
+    // Done recording commands.
+    ThrowIfFailed(mCommandList->Close());
+
+	// Draw all layers in sort key order, skipping redundant bindings.  The packets
+	// are recorded in chunks on the worker threads, each into its own command list.
+	BuildDrawPackets();
+	mChunkLists->BeginFrame(mCurrFrameResourceIndex);
+
+	ID3D12PipelineState* opaquePso = mPSOs["opaque"].Get();
+	mParallelRecorder->Record(mDrawPackets, mChunkCount, true,
+		[&](std::uint32_t chunk, std::uint32_t worker, const CommandStream& stream)
+	{
+		auto cmdList = mChunkLists->Begin(chunk, opaquePso);
+
+		// A command list starts with no state; every chunk sets up the pass.
+		SetPassState(cmdList);
+
+		CommandListDrawRecorder recorder(cmdList, mPacketPsos, mPacketGeometries);
+		stream.Replay(recorder);
+
+		ThrowIfFailed(cmdList->Close());
+	});
+
+    // Indicate a state transition on the resource usage.
+	auto presentList = mChunkLists->Begin(mChunkCount);
+	presentList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
+		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+	ThrowIfFailed(presentList->Close());
+
+    // Add the command lists to the queue for execution, in chunk order.
+	mSubmitLists.clear();
+	mSubmitLists.push_back(mCommandList.Get());
+	for(UINT i = 0; i <= mChunkCount; ++i)
+		mSubmitLists.push_back(mChunkLists->List(i));
+    mCommandQueue->ExecuteCommandLists((UINT)mSubmitLists.size(), mSubmitLists.data());
+
+    // Swap the back and front buffers
+    ThrowIfFailed(mSwapChain->Present(0, 0));
+	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
+
+    // Advance the fence value to mark commands up to this fence point.
+    mCurrFrameResource->Fence = ++mCurrentFence;
+
+    // Add an instruction to the command queue to set a new fence point. 
+    // Because we are on the GPU timeline, the new fence point won't be 
+    // set until the GPU finishes processing all the commands prior to this Signal().
+    mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+}
+
+void CubeMapApp::SetPassState(ID3D12GraphicsCommandList* cmdList)
+{
+    cmdList->RSSetViewports(1, &mScreenViewport);
+    cmdList->RSSetScissorRects(1, &mScissorRect);
+
     // Specify the buffers we are going to render to.
-    mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
+    cmdList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
 
 	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
-	mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+	cmdList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
-	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
+	cmdList->SetGraphicsRootSignature(mRootSignature.Get());
 
 	auto passCB = mCurrFrameResource->PassCB->Resource();
-	mCommandList->SetGraphicsRootConstantBufferView(1, passCB->GetGPUVirtualAddress());
+	cmdList->SetGraphicsRootConstantBufferView(1, passCB->GetGPUVirtualAddress());
 
 	// Bind all the materials used in this scene.  For structured buffers, we can bypass the heap and 
 	// set as a root descriptor.
 	auto matBuffer = mCurrFrameResource->MaterialBuffer->Resource();
-	mCommandList->SetGraphicsRootShaderResourceView(2, matBuffer->GetGPUVirtualAddress());
+	cmdList->SetGraphicsRootShaderResourceView(2, matBuffer->GetGPUVirtualAddress());
 
 	// Bind the sky cube map.  For our demos, we just use one "world" cube map representing the environment
 	// from far away, so all objects will use the same cube map and we only need to set it once per-frame.  
@@ -279,40 +421,12 @@ void CubeMapApp::Draw(const GameTimer& gt)
 
 	CD3DX12_GPU_DESCRIPTOR_HANDLE skyTexDescriptor(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
 	skyTexDescriptor.Offset(mSkyTexHeapIndex, mCbvSrvDescriptorSize);
-	mCommandList->SetGraphicsRootDescriptorTable(3, skyTexDescriptor);
+	cmdList->SetGraphicsRootDescriptorTable(3, skyTexDescriptor);
 
 	// Bind all the textures used in this scene.  Observe
     // that we only have to specify the first descriptor in the table.  
     // The root signature knows how many descriptors are expected in the table.
-	mCommandList->SetGraphicsRootDescriptorTable(4, mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-
-    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
-
-	mCommandList->SetPipelineState(mPSOs["sky"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Sky]);
-
-    // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
-
-    // Done recording commands.
-    ThrowIfFailed(mCommandList->Close());
-
-    // Add the command list to the queue for execution.
-    ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
-    mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
-
-    // Swap the back and front buffers
-    ThrowIfFailed(mSwapChain->Present(0, 0));
-	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
-
-    // Advance the fence value to mark commands up to this fence point.
-    mCurrFrameResource->Fence = ++mCurrentFence;
-
-    // Add an instruction to the command queue to set a new fence point. 
-    // Because we are on the GPU timeline, the new fence point won't be 
-    // set until the GPU finishes processing all the commands prior to this Signal().
-    mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+	cmdList->SetGraphicsRootDescriptorTable(4, mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
 }
 
 void CubeMapApp::OnMouseDown(WPARAM btnState, int x, int y)
@@ -348,16 +462,16 @@ void CubeMapApp::OnKeyboardInput(const GameTimer& gt)
 {
 	const float dt = gt.DeltaTime();
 
-	if(GetAsyncKeyState('W') & 0x8000)
+	if(IsKeyDown('W'))
 		mCamera.Walk(10.0f*dt);
 
-	if(GetAsyncKeyState('S') & 0x8000)
+	if(IsKeyDown('S'))
 		mCamera.Walk(-10.0f*dt);
 
-	if(GetAsyncKeyState('A') & 0x8000)
+	if(IsKeyDown('A'))
 		mCamera.Strafe(-10.0f*dt);
 
-	if(GetAsyncKeyState('D') & 0x8000)
+	if(IsKeyDown('D'))
 		mCamera.Strafe(10.0f*dt);
 
 	mCamera.UpdateViewMatrix();
@@ -788,6 +902,16 @@ void CubeMapApp::BuildSkullGeometry()
 
     fin.close();
 
+    //
+    // Split the skull into meshlets.  The index buffer is replaced by the
+    // meshlet ordered one, so each meshlet is a contiguous index range.
+    //
+
+    std::vector<std::uint32_t> indices32(indices.begin(), indices.end());
+    MeshletBuilder::Build(reinterpret_cast<const SimdMath::Float3*>(&vertices[0].Pos), sizeof(Vertex), vcount,
+        indices32.data(), (UINT)indices32.size(), mSkullMeshlets);
+    indices.assign(mSkullMeshlets.Indices.begin(), mSkullMeshlets.Indices.end());
+
     //
     // Pack the indices of all the meshes into one index buffer.
     //
@@ -984,6 +1108,7 @@ void CubeMapApp::BuildRenderItems()
     skullRitem->IndexCount = skullRitem->Geo->DrawArgs["skull"].IndexCount;
     skullRitem->StartIndexLocation = skullRitem->Geo->DrawArgs["skull"].StartIndexLocation;
     skullRitem->BaseVertexLocation = skullRitem->Geo->DrawArgs["skull"].BaseVertexLocation;
+    skullRitem->Meshlets = &mSkullMeshlets;
 
     mRitemLayer[(int)RenderLayer::Opaque].push_back(skullRitem.get());
     mAllRitems.push_back(std::move(skullRitem));
@@ -1069,27 +1194,88 @@ void CubeMapApp::BuildRenderItems()
 	}
 }
 
-void CubeMapApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
+void CubeMapApp::BuildDrawPacketTables()
+{
+	mPacketPsos.clear();
+	mPacketPsos.push_back(mPSOs["opaque"].Get());
+	mPacketPsos.push_back(mPSOs["sky"].Get());
+	mLayerPso[(int)RenderLayer::Opaque] = 0;
+	mLayerPso[(int)RenderLayer::Sky] = 1;
+
+	mPacketGeometries.clear();
+	for(auto& e : mGeometries)
+		mPacketGeometries.push_back(e.second.get());
+
+	for(auto& ri : mAllRitems)
+	{
+		auto it = std::find(mPacketGeometries.begin(), mPacketGeometries.end(), ri->Geo);
+		ri->GeoId = (UINT)(it - mPacketGeometries.begin());
+	}
+}
+
+void CubeMapApp::BuildDrawPackets()
 {
     UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
  
 	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
 
-    // For each render item...
-    for(size_t i = 0; i < ritems.size(); ++i)
-    {
-        auto ri = ritems[i];
-
-        cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-        cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
-        cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
-
-        D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex*objCBByteSize;
+	XMMATRIX view = mCamera.GetView();
+	XMMATRIX viewProj = XMMatrixMultiply(view, mCamera.GetProj());
+	XMVECTOR eyePos = mCamera.GetPosition();
+	float invFarZ = 1.0f / mCamera.GetFarZ();
 
-		cmdList->SetGraphicsRootConstantBufferView(0, objCBAddress);
+	mDrawPackets.Clear();
+	for(int layer = 0; layer < (int)RenderLayer::Count; ++layer)
+	{
+		for(auto ri : mRitemLayer[layer])
+		{
+			// View space depth of the object's origin, for front to back order
+			// within the same state.
+			XMMATRIX world = XMLoadFloat4x4(&ri->World);
+			float depth = XMVectorGetZ(XMVector3TransformCoord(world.r[3], view))*invFarZ;
+
+			DrawPacket p;
+			p.Pso = mLayerPso[layer];
+			p.Geometry = ri->GeoId;
+			p.PrimitiveTopology = (UINT)ri->PrimitiveType;
+			p.ObjectCB = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex*objCBByteSize;
+			p.IndexCount = ri->IndexCount;
+			p.StartIndexLocation = ri->StartIndexLocation;
+			p.BaseVertexLocation = ri->BaseVertexLocation;
+			p.SortKey = DrawPacketQueue::MakeSortKey(layer, p.Pso, p.Geometry, ri->Mat->MatCBIndex, depth);
+
+			if(ri->Meshlets == nullptr)
+			{
+				mDrawPackets.Add(p);
+				continue;
+			}
+
+			// Cull the meshlets in the object's local space and draw the visible
+			// index ranges.  SimdMath::Float4x4/Float3 match XMFLOAT4X4/XMFLOAT3.
+			XMFLOAT4X4 localToClip;
+			XMStoreFloat4x4(&localToClip, XMMatrixMultiply(world, viewProj));
+
+			XMMATRIX invWorld = XMMatrixInverse(&XMMatrixDeterminant(world), world);
+			XMFLOAT3 localEyePos;
+			XMStoreFloat3(&localEyePos, XMVector3TransformCoord(eyePos, invWorld));
+
+			MeshletFrustum frustum = MeshletFrustum::FromMatrix(reinterpret_cast<const SimdMath::Float4x4&>(localToClip));
+
+			mVisibleMeshlets.clear();
+			MeshletCuller::Cull(*ri->Meshlets, frustum, reinterpret_cast<const SimdMath::Float3&>(localEyePos),
+				mVisibleMeshlets, &mSkullCullStats);
+			MeshletCuller::BuildDrawRanges(*ri->Meshlets, mVisibleMeshlets, mMeshletRanges);
+
+			for(const MeshletCuller::DrawRange& range : mMeshletRanges)
+			{
+				p.IndexCount = range.IndexCount;
+				p.StartIndexLocation = ri->StartIndexLocation + range.StartIndexLocation;
+				mDrawPackets.Add(p);
+			}
+		}
+	}
 
-        cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
-    }
+	mDrawPackets.Sort();
 }
 
 std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> CubeMapApp::GetStaticSamplers()
@@ -7,6 +7,7 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/BoundsFitting.h"
 #include "FrameResource.h"
 #include "ShadowMap.h"
 
@@ -97,6 +98,7 @@ private:
     void BuildFrameResources();
     void BuildMaterials();
     void BuildRenderItems();
+    void BuildSceneBounds();
     void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
     void DrawSceneToShadowMap();
 
@@ -187,12 +189,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 ShadowMapApp::ShadowMapApp(HINSTANCE hInstance)
     : D3DApp(hInstance)
 {
-    // Estimate the scene bounding sphere manually since we know how the scene was constructed.
-    // The grid is the "widest object" with a width of 20 and depth of 30.0f, and centered at
-    // the world space origin.  In general, you need to loop over every world space vertex
-    // position and compute the bounding sphere.
-    mSceneBounds.Center = XMFLOAT3(0.0f, 0.0f, 0.0f);
-    mSceneBounds.Radius = sqrtf(10.0f*10.0f + 15.0f*15.0f);
+    // The scene bounding sphere is fitted to the world space vertices in BuildSceneBounds().
 }
 
 ShadowMapApp::~ShadowMapApp()
@@ -222,6 +219,7 @@ bool ShadowMapApp::Initialize()
     BuildSkullGeometry();
 	BuildMaterials();
     BuildRenderItems();
+    BuildSceneBounds();
     BuildFrameResources();
     BuildPSOs();
 
@@ -428,16 +426,16 @@ void ShadowMapApp::OnKeyboardInput(const GameTimer& gt)
 {
 	const float dt = gt.DeltaTime();
 
-	if(GetAsyncKeyState('W') & 0x8000)
+	if(IsKeyDown('W'))
 		mCamera.Walk(10.0f*dt);
 
-	if(GetAsyncKeyState('S') & 0x8000)
+	if(IsKeyDown('S'))
 		mCamera.Walk(-10.0f*dt);
 
-	if(GetAsyncKeyState('A') & 0x8000)
+	if(IsKeyDown('A'))
 		mCamera.Strafe(-10.0f*dt);
 
-	if(GetAsyncKeyState('D') & 0x8000)
+	if(IsKeyDown('D'))
 		mCamera.Strafe(10.0f*dt);
 
 	mCamera.UpdateViewMatrix();
@@ -1362,6 +1360,61 @@ void ShadowMapApp::BuildRenderItems()
 	}
 }
 
+void ShadowMapApp::BuildSceneBounds()
+{
+    // Loop over every world space vertex position of the opaque render items
+    // and fit a tight bounding sphere to them.  The shadow map frustum is built
+    // from this sphere, so a tighter sphere means better shadow map resolution.
+    std::vector<XMFLOAT3> points;
+    std::vector<bool> used;
+    for(auto ri : mRitemLayer[(int)RenderLayer::Opaque])
+    {
+        auto geo = ri->Geo;
+        auto vertices = (BYTE*)geo->VertexBufferCPU->GetBufferPointer();
+        auto indexData = (BYTE*)geo->IndexBufferCPU->GetBufferPointer();
+        bool indices32 = geo->IndexFormat == DXGI_FORMAT_R32_UINT;
+
+        // Mark the vertices the item's indices reference, so each one is
+        // transformed once however many triangles share it.
+        UINT vertexCount = geo->VertexBufferByteSize / geo->VertexByteStride;
+        used.assign(vertexCount, false);
+        UINT first = vertexCount;
+        UINT last = 0;
+        for(UINT i = 0; i < ri->IndexCount; ++i)
+        {
+            UINT index = ri->StartIndexLocation + i;
+            UINT v = indices32 ? ((std::uint32_t*)indexData)[index] : ((std::uint16_t*)indexData)[index];
+            v += ri->BaseVertexLocation;
+
+            used[v] = true;
+            first = MathHelper::Min(first, v);
+            last = MathHelper::Max(last, v);
+        }
+
+        XMMATRIX world = XMLoadFloat4x4(&ri->World);
+        for(UINT v = first; v <= last && v < vertexCount; ++v)
+        {
+            if(!used[v])
+                continue;
+
+            XMFLOAT3 posL = *(XMFLOAT3*)(vertices + v*geo->VertexByteStride);
+
+            XMFLOAT3 posW;
+            XMStoreFloat3(&posW, XMVector3TransformCoord(XMLoadFloat3(&posL), world));
+            points.push_back(posW);
+        }
+    }
+
+    mSceneBounds = BoundsFitting::MinimalSphere(points.data(), sizeof(XMFLOAT3), (UINT)points.size());
+
+    // The sphere the demo used to estimate by hand, for comparison.
+    std::wostringstream outs;
+    outs << L"Scene bounds: " << points.size() << L" vertices, radius " << mSceneBounds.Radius <<
+        L" at (" << mSceneBounds.Center.x << L", " << mSceneBounds.Center.y << L", " << mSceneBounds.Center.z <<
+        L"), hand estimate " << sqrtf(10.0f*10.0f + 15.0f*15.0f) << L" at (0, 0, 0)\n";
+    ::OutputDebugStringW(outs.str().c_str());
+}
+
 void ShadowMapApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
     UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
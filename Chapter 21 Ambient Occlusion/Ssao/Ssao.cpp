@@ -3,6 +3,7 @@
 //***************************************************************************************
 
 #include "Ssao.h"
+#include "../../Common/Random.h"
 #include <DirectXPackedVector.h>
 
 using namespace DirectX;
@@ -197,8 +198,8 @@ void Ssao::ComputeSsao(
 	// We compute the initial SSAO to AmbientMap0.
 
     // Change to RENDER_TARGET.
-    cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mAmbientMap0.Get(),
-        D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_RENDER_TARGET));
+    mBarriers.Transition(mAmbientMap0.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET);
+    mBarriers.Flush(cmdList);
   
 	float clearValue[] = {1.0f, 1.0f, 1.0f, 1.0f};
     cmdList->ClearRenderTargetView(mhAmbientMap0CpuRtv, clearValue, 0, nullptr);
@@ -226,10 +227,12 @@ void Ssao::ComputeSsao(
 	cmdList->DrawInstanced(6, 1, 0, 0);
    
 	// Change back to GENERIC_READ so we can read the texture in a shader.
-    cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mAmbientMap0.Get(),
-        D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_GENERIC_READ));
+    mBarriers.Transition(mAmbientMap0.Get(), D3D12_RESOURCE_STATE_GENERIC_READ);
 
     BlurAmbientMap(cmdList, currFrame, blurCount);
+
+    // Submit the transitions still pending after the last blur pass.
+    mBarriers.Flush(cmdList);
 }
  
 void Ssao::BlurAmbientMap(ID3D12GraphicsCommandList* cmdList, FrameResource* currFrame, int blurCount)
@@ -269,8 +272,9 @@ void Ssao::BlurAmbientMap(ID3D12GraphicsCommandList* cmdList, bool horzBlur)
         cmdList->SetGraphicsRoot32BitConstant(1, 0, 0);
 	}
  
-    cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(output,
-        D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_RENDER_TARGET));
+    // Batched with the input's transition back to GENERIC_READ.
+    mBarriers.Transition(output, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    mBarriers.Flush(cmdList);
 
 	float clearValue[] = { 1.0f, 1.0f, 1.0f, 1.0f };
     cmdList->ClearRenderTargetView(outputRtv, clearValue, 0, nullptr);
@@ -292,8 +296,7 @@ void Ssao::BlurAmbientMap(ID3D12GraphicsCommandList* cmdList, bool horzBlur)
     cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	cmdList->DrawInstanced(6, 1, 0, 0);
    
-    cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(output,
-        D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_GENERIC_READ));
+    mBarriers.Transition(output, D3D12_RESOURCE_STATE_GENERIC_READ);
 }
  
 void Ssao::BuildResources()
@@ -351,6 +354,10 @@ void Ssao::BuildResources()
         D3D12_RESOURCE_STATE_GENERIC_READ,
         &optClear,
         IID_PPV_ARGS(&mAmbientMap1)));
+
+    mBarriers.Reset();
+    mBarriers.Track(mAmbientMap0.Get(), D3D12_RESOURCE_STATE_GENERIC_READ);
+    mBarriers.Track(mAmbientMap1.Get(), D3D12_RESOURCE_STATE_GENERIC_READ);
 }
 
 void Ssao::BuildRandomVectorTexture(ID3D12GraphicsCommandList* cmdList)
@@ -393,13 +400,16 @@ void Ssao::BuildRandomVectorTexture(ID3D12GraphicsCommandList* cmdList)
         nullptr,
         IID_PPV_ARGS(mRandomVectorMapUploadBuffer.GetAddressOf())));
 
+    // Random vectors in [0,1].  We will decompress in shader to [-1,1].
+    std::vector<XMFLOAT3> randomVectors(256 * 256);
+    Random::ThreadLocal().FillFloats(&randomVectors[0].x, randomVectors.size() * 3);
+
     XMCOLOR initData[256 * 256];
     for(int i = 0; i < 256; ++i)
     {
         for(int j = 0; j < 256; ++j)
         {
-			// Random vector in [0,1].  We will decompress in shader to [-1,1].
-            XMFLOAT3 v(MathHelper::RandF(), MathHelper::RandF(), MathHelper::RandF());
+            const XMFLOAT3& v = randomVectors[i * 256 + j];
 
             initData[i * 256 + j] = XMCOLOR(v.x, v.y, v.z, 0.0f);
         }
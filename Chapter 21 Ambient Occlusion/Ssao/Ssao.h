@@ -8,6 +8,7 @@
 #pragma once
 
 #include "../../Common/d3dUtil.h"
+#include "../../Common/BarrierBatch.h"
 #include "FrameResource.h"
  
  
@@ -100,6 +101,10 @@ private:
     Microsoft::WRL::ComPtr<ID3D12Resource> mAmbientMap0;
     Microsoft::WRL::ComPtr<ID3D12Resource> mAmbientMap1;
 
+    // Transitions of the ambient maps; each pass requests the state it needs and
+    // the previous pass's transition back to GENERIC_READ goes out with it.
+    BarrierBatch mBarriers;
+
     CD3DX12_CPU_DESCRIPTOR_HANDLE mhNormalMapCpuSrv;
     CD3DX12_GPU_DESCRIPTOR_HANDLE mhNormalMapGpuSrv;
     CD3DX12_CPU_DESCRIPTOR_HANDLE mhNormalMapCpuRtv;
@@ -7,6 +7,12 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/UploadManager.h"
+#include "../../Common/TextureCache.h"
+#include "../../Common/TextureCacheBackend.h"
+#include "../../Common/ShaderCache.h"
+#include "../../Common/ShaderCacheBackend.h"
+#include "../../Common/ThreadPool.h"
 #include "FrameResource.h"
 #include "ShadowMap.h"
 #include "Ssao.h"
@@ -90,6 +96,7 @@ private:
     void UpdateSsaoCB(const GameTimer& gt);
 
 	void LoadTextures();
+	ID3D12Resource* GetTexture(const std::string& name);
     void BuildRootSignature();
     void BuildSsaoRootSignature();
 	void BuildDescriptorHeaps();
@@ -122,9 +129,20 @@ private:
 
 	ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
 
+	// Declared in dependency order, and before the handles in mTextures, so
+	// they are destroyed the other way round.  The upload manager stages the
+	// geometry buffers and the textures the cache creates.
+	std::unique_ptr<UploadManager> mUploadManager;
+	std::unique_ptr<TextureCacheBackend> mTextureBackend;
+	std::unique_ptr<TextureCache> mTextureCache;
+
+	// Compiles the shaders; kept for the app's lifetime so later work can
+	// share its threads instead of starting its own.
+	ThreadPool mThreadPool;
+
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
 	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
-	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
+	std::unordered_map<std::string, TextureCache::Handle> mTextures;
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
 	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
 
@@ -234,6 +252,10 @@ bool SsaoApp::Initialize()
         mCommandList.Get(),
         mClientWidth, mClientHeight);
 
+    mUploadManager = std::make_unique<UploadManager>(
+        md3dDevice.Get(),
+        mCommandQueue.Get());
+
 	LoadTextures();
     BuildRootSignature();
     BuildSsaoRootSignature();
@@ -248,6 +270,9 @@ bool SsaoApp::Initialize()
 
     mSsao->SetPSOs(mPSOs["ssao"].Get(), mPSOs["ssaoBlur"].Get());
 
+    // Submit the buffer copies first so the initialization commands see the data.
+    mUploadManager->Flush();
+
     // Execute the initialization commands.
     ThrowIfFailed(mCommandList->Close());
     ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
@@ -256,6 +281,9 @@ bool SsaoApp::Initialize()
     // Wait until initialization is complete.
     FlushCommandQueue();
 
+    OutputDebugString((L"SsaoApp: " + mUploadManager->GetStats().ToString() + L"\n").c_str());
+    OutputDebugStringA(("SsaoApp: " + mTextureCache->GetStats().ToString() + "\n").c_str());
+
     return true;
 }
 
@@ -313,6 +341,13 @@ void SsaoApp::Update(const GameTimer& gt)
         CloseHandle(eventHandle);
     }
 
+    // Textures the cache evicted are released once no frame in flight uses
+    // them; loads that finished since the last frame are uploaded before this
+    // frame's command list.
+    mTextureBackend->Retire(mFence->GetCompletedValue());
+    mTextureCache->Update();
+    mUploadManager->Flush();
+
     //
     // Animate the lights (and hence shadows).
     //
@@ -463,6 +498,8 @@ void SsaoApp::Draw(const GameTimer& gt)
     // Because we are on the GPU timeline, the new fence point won't be 
     // set until the GPU finishes processing all the commands prior to this Signal().
     mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+
+    mTextureBackend->FinishFrame(mCurrentFence);
 }
 
 void SsaoApp::OnMouseDown(WPARAM btnState, int x, int y)
@@ -498,16 +535,16 @@ void SsaoApp::OnKeyboardInput(const GameTimer& gt)
 {
 	const float dt = gt.DeltaTime();
 
-	if(GetAsyncKeyState('W') & 0x8000)
+	if(IsKeyDown('W'))
 		mCamera.Walk(10.0f*dt);
 
-	if(GetAsyncKeyState('S') & 0x8000)
+	if(IsKeyDown('S'))
 		mCamera.Walk(-10.0f*dt);
 
-	if(GetAsyncKeyState('A') & 0x8000)
+	if(IsKeyDown('A'))
 		mCamera.Strafe(-10.0f*dt);
 
-	if(GetAsyncKeyState('D') & 0x8000)
+	if(IsKeyDown('D'))
 		mCamera.Strafe(10.0f*dt);
 
 	mCamera.UpdateViewMatrix();
@@ -736,28 +773,37 @@ void SsaoApp::LoadTextures()
 		"skyCubeMap"
 	};
 	
-    std::vector<std::wstring> texFilenames =
+    std::vector<std::string> texFilenames =
     {
-        L"../../Textures/bricks2.dds",
-        L"../../Textures/bricks2_nmap.dds",
-        L"../../Textures/tile.dds",
-        L"../../Textures/tile_nmap.dds",
-        L"../../Textures/white1x1.dds",
-        L"../../Textures/default_nmap.dds",
-        L"../../Textures/sunsetcube1024.dds"
+        "../../Textures/bricks2.dds",
+        "../../Textures/bricks2_nmap.dds",
+        "../../Textures/tile.dds",
+        "../../Textures/tile_nmap.dds",
+        "../../Textures/white1x1.dds",
+        "../../Textures/default_nmap.dds",
+        "../../Textures/sunsetcube1024.dds"
     };
-	
+
+	mTextureBackend = std::make_unique<TextureCacheBackend>(md3dDevice.Get(), *mUploadManager);
+	mTextureCache = std::make_unique<TextureCache>(*mTextureBackend);
+
+	// The files load in parallel on the cache's I/O threads; the textures are
+	// created, and their copies recorded, by WaitIdle.
 	for(int i = 0; i < (int)texNames.size(); ++i)
+		mTextures[texNames[i]] = mTextureCache->Acquire(texFilenames[i]);
+
+	mTextureCache->WaitIdle();
+
+	for(auto& tex : mTextures)
 	{
-		auto texMap = std::make_unique<Texture>();
-		texMap->Name = texNames[i];
-		texMap->Filename = texFilenames[i];
-		ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-			mCommandList.Get(), texMap->Filename.c_str(),
-			texMap->Resource, texMap->UploadHeap));
-			
-		mTextures[texMap->Name] = std::move(texMap);
-	}		
+		if(!mTextureCache->IsReady(tex.second))
+			ThrowIfFailed(E_FAIL);
+	}
+}
+
+ID3D12Resource* SsaoApp::GetTexture(const std::string& name)
+{
+	return mTextureBackend->Resource(mTextureCache->GetTexture(mTextures[name]));
 }
 
 void SsaoApp::BuildRootSignature()
@@ -901,15 +947,15 @@ void SsaoApp::BuildDescriptorHeaps()
 
 	std::vector<ComPtr<ID3D12Resource>> tex2DList = 
 	{
-		mTextures["bricksDiffuseMap"]->Resource,
-		mTextures["bricksNormalMap"]->Resource,
-		mTextures["tileDiffuseMap"]->Resource,
-		mTextures["tileNormalMap"]->Resource,
-		mTextures["defaultDiffuseMap"]->Resource,
-		mTextures["defaultNormalMap"]->Resource
+		GetTexture("bricksDiffuseMap"),
+		GetTexture("bricksNormalMap"),
+		GetTexture("tileDiffuseMap"),
+		GetTexture("tileNormalMap"),
+		GetTexture("defaultDiffuseMap"),
+		GetTexture("defaultNormalMap")
 	};
 	
-	auto skyCubeMap = mTextures["skyCubeMap"]->Resource;
+	auto skyCubeMap = GetTexture("skyCubeMap");
 
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
@@ -932,7 +978,7 @@ void SsaoApp::BuildDescriptorHeaps()
 	srvDesc.TextureCube.MipLevels = skyCubeMap->GetDesc().MipLevels;
 	srvDesc.TextureCube.ResourceMinLODClamp = 0.0f;
 	srvDesc.Format = skyCubeMap->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(skyCubeMap.Get(), &srvDesc, hDescriptor);
+	md3dDevice->CreateShaderResourceView(skyCubeMap, &srvDesc, hDescriptor);
 	
 	mSkyTexHeapIndex = (UINT)tex2DList.size();
     mShadowMapHeapIndex = mSkyTexHeapIndex + 1;
@@ -974,33 +1020,60 @@ void SsaoApp::BuildDescriptorHeaps()
 
 void SsaoApp::BuildShadersAndInputLayout()
 {
-	const D3D_SHADER_MACRO alphaTestDefines[] =
+	const std::vector<ShaderCache::Define> alphaTestDefines = { { "ALPHA_TEST", "1" } };
+
+	std::vector<std::string> names;
+	std::vector<ShaderCache::Request> requests;
+	auto addShader = [&](const std::string& name, const std::string& filename,
+		const std::vector<ShaderCache::Define>& defines, const std::string& entryPoint, const std::string& target)
 	{
-		"ALPHA_TEST", "1",
-		NULL, NULL
+		names.push_back(name);
+		requests.push_back({ filename, defines, entryPoint, target });
 	};
 
-	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "PS", "ps_5_1");
+	addShader("standardVS", "Shaders\\Default.hlsl", {}, "VS", "vs_5_1");
+	addShader("opaquePS", "Shaders\\Default.hlsl", {}, "PS", "ps_5_1");
 
-    mShaders["shadowVS"] = d3dUtil::CompileShader(L"Shaders\\Shadows.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["shadowOpaquePS"] = d3dUtil::CompileShader(L"Shaders\\Shadows.hlsl", nullptr, "PS", "ps_5_1");
-    mShaders["shadowAlphaTestedPS"] = d3dUtil::CompileShader(L"Shaders\\Shadows.hlsl", alphaTestDefines, "PS", "ps_5_1");
-	
-    mShaders["debugVS"] = d3dUtil::CompileShader(L"Shaders\\ShadowDebug.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["debugPS"] = d3dUtil::CompileShader(L"Shaders\\ShadowDebug.hlsl", nullptr, "PS", "ps_5_1");
+    addShader("shadowVS", "Shaders\\Shadows.hlsl", {}, "VS", "vs_5_1");
+    addShader("shadowOpaquePS", "Shaders\\Shadows.hlsl", {}, "PS", "ps_5_1");
+    addShader("shadowAlphaTestedPS", "Shaders\\Shadows.hlsl", alphaTestDefines, "PS", "ps_5_1");
+
+    addShader("debugVS", "Shaders\\ShadowDebug.hlsl", {}, "VS", "vs_5_1");
+    addShader("debugPS", "Shaders\\ShadowDebug.hlsl", {}, "PS", "ps_5_1");
+
+    addShader("drawNormalsVS", "Shaders\\DrawNormals.hlsl", {}, "VS", "vs_5_1");
+    addShader("drawNormalsPS", "Shaders\\DrawNormals.hlsl", {}, "PS", "ps_5_1");
 
-    mShaders["drawNormalsVS"] = d3dUtil::CompileShader(L"Shaders\\DrawNormals.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["drawNormalsPS"] = d3dUtil::CompileShader(L"Shaders\\DrawNormals.hlsl", nullptr, "PS", "ps_5_1");
+    addShader("ssaoVS", "Shaders\\Ssao.hlsl", {}, "VS", "vs_5_1");
+    addShader("ssaoPS", "Shaders\\Ssao.hlsl", {}, "PS", "ps_5_1");
 
-    mShaders["ssaoVS"] = d3dUtil::CompileShader(L"Shaders\\Ssao.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["ssaoPS"] = d3dUtil::CompileShader(L"Shaders\\Ssao.hlsl", nullptr, "PS", "ps_5_1");
+    addShader("ssaoBlurVS", "Shaders\\SsaoBlur.hlsl", {}, "VS", "vs_5_1");
+    addShader("ssaoBlurPS", "Shaders\\SsaoBlur.hlsl", {}, "PS", "ps_5_1");
 
-    mShaders["ssaoBlurVS"] = d3dUtil::CompileShader(L"Shaders\\SsaoBlur.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["ssaoBlurPS"] = d3dUtil::CompileShader(L"Shaders\\SsaoBlur.hlsl", nullptr, "PS", "ps_5_1");
+	addShader("skyVS", "Shaders\\Sky.hlsl", {}, "VS", "vs_5_1");
+	addShader("skyPS", "Shaders\\Sky.hlsl", {}, "PS", "ps_5_1");
+
+	// Only the shaders whose source, includes or defines changed since the
+	// last run are compiled, in parallel; the rest come from the ShaderCache
+	// directory.
+	ShaderCacheBackend compiler;
+	ShaderCache cache(compiler);
+
+	std::vector<ShaderCache::Shader> shaders;
+	ShaderCache::Status status = cache.Build(requests, &shaders, &mThreadPool);
+
+	for(size_t i = 0; i < shaders.size(); ++i)
+	{
+		if(!shaders[i].Errors.empty())
+			OutputDebugStringA(shaders[i].Errors.c_str());
+
+		if(shaders[i].Result == ShaderCache::Status::Ok)
+			mShaders[names[i]] = ShaderCacheBackend::ToBlob(shaders[i].Bytecode);
+	}
 
-	mShaders["skyVS"] = d3dUtil::CompileShader(L"Shaders\\Sky.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["skyPS"] = d3dUtil::CompileShader(L"Shaders\\Sky.hlsl", nullptr, "PS", "ps_5_1");
+	OutputDebugStringA(("SsaoApp: " + cache.GetStats().ToString() + "\n").c_str());
+	if(status != ShaderCache::Status::Ok)
+		ThrowIfFailed(E_FAIL);
 
     mInputLayout =
     {
@@ -1138,11 +1211,9 @@ void SsaoApp::BuildShapeGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+	geo->VertexBufferGPU = mUploadManager->CreateDefaultBuffer(vertices.data(), vbByteSize);
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	geo->IndexBufferGPU = mUploadManager->CreateDefaultBuffer(indices.data(), ibByteSize);
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -1248,11 +1319,9 @@ void SsaoApp::BuildSkullGeometry()
     ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
     CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-    geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-        mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+    geo->VertexBufferGPU = mUploadManager->CreateDefaultBuffer(vertices.data(), vbByteSize);
 
-    geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-        mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+    geo->IndexBufferGPU = mUploadManager->CreateDefaultBuffer(indices.data(), ibByteSize);
 
     geo->VertexByteStride = sizeof(Vertex);
     geo->VertexBufferByteSize = vbByteSize;
@@ -1,4 +1,5 @@
 #include "SkinnedData.h"
+#include "../../Common/Profiler.h"
 
 using namespace DirectX;
 
@@ -138,6 +139,8 @@ void SkinnedData::Set(std::vector<int>& boneHierarchy,
  
 void SkinnedData::GetFinalTransforms(const std::string& clipName, float timePos,  std::vector<XMFLOAT4X4>& finalTransforms)const
 {
+	PROFILE_SCOPE("SkinnedData::GetFinalTransforms");
+
 	UINT numBones = mBoneOffsets.size();
 
 	std::vector<XMFLOAT4X4> toParentTransforms(numBones);
@@ -7,6 +7,9 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/TaskGraph.h"
+#include "../../Common/ShaderCache.h"
+#include "../../Common/ShaderCacheBackend.h"
 #include "FrameResource.h"
 #include "ShadowMap.h"
 #include "Ssao.h"
@@ -114,6 +117,7 @@ private:
     virtual void OnMouseMove(WPARAM btnState, int x, int y)override;
 
     void OnKeyboardInput(const GameTimer& gt);
+    void AnimateLights(const GameTimer& gt);
 	void AnimateMaterials(const GameTimer& gt);
 	void UpdateObjectCBs(const GameTimer& gt);
     void UpdateSkinnedCBs(const GameTimer& gt);
@@ -134,6 +138,7 @@ private:
     void BuildFrameResources();
     void BuildMaterials();
     void BuildRenderItems();
+    void BuildUpdateGraph();
     void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
     void DrawSceneToShadowMap();
 	void DrawNormalsAndDepth();
@@ -216,6 +221,18 @@ private:
     };
     XMFLOAT3 mRotatedLightDirections[3];
 
+    // The Update* stages run as a task graph on mThreadPool, which also
+    // compiles the shaders; mUpdateTimer is the timer of the Update call in
+    // progress.
+    std::unique_ptr<ThreadPool> mThreadPool;
+    TaskGraph mUpdateGraph;
+    const GameTimer* mUpdateTimer = nullptr;
+    float mUpdateStatsElapsed = 0.0f;
+
+    // Debug output of the graph's critical path, off by default; press 1 to
+    // turn it on and 2 to turn it off.
+    bool mLogUpdateCriticalPath = false;
+
     POINT mLastMousePos;
 };
 
@@ -268,6 +285,9 @@ bool SkinnedMeshApp::Initialize()
     ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
 
 	mCamera.SetPosition(0.0f, 2.0f, -15.0f);
+
+    // Compiles the shaders below and then runs the update graph every frame.
+    mThreadPool = std::make_unique<ThreadPool>(MathHelper::Min(ThreadPool::DefaultThreadCount(), 3u));
  
     mShadowMap = std::make_unique<ShadowMap>(md3dDevice.Get(),
         2048, 2048);
@@ -288,6 +308,7 @@ bool SkinnedMeshApp::Initialize()
     BuildRenderItems();
     BuildFrameResources();
     BuildPSOs();
+    BuildUpdateGraph();
 
     mSsao->SetPSOs(mPSOs["ssao"].Get(), mPSOs["ssaoBlur"].Get());
 
@@ -356,28 +377,21 @@ void SkinnedMeshApp::Update(const GameTimer& gt)
         CloseHandle(eventHandle);
     }
 
-    //
-    // Animate the lights (and hence shadows).
-    //
+    // Runs AnimateLights ... UpdateSsaoCB, independent stages in parallel.
+    mUpdateTimer = &gt;
+    const auto& stats = mUpdateGraph.Run(*mThreadPool);
+    mUpdateTimer = nullptr;
 
-    mLightRotationAngle += 0.1f*gt.DeltaTime();
-
-    XMMATRIX R = XMMatrixRotationY(mLightRotationAngle);
-    for(int i = 0; i < 3; ++i)
+    // Report the longest dependency chain about once per second.
+    mUpdateStatsElapsed += gt.DeltaTime();
+    if(mLogUpdateCriticalPath && mUpdateStatsElapsed >= 1.0f)
     {
-        XMVECTOR lightDir = XMLoadFloat3(&mBaseLightDirections[i]);
-        lightDir = XMVector3TransformNormal(lightDir, R);
-        XMStoreFloat3(&mRotatedLightDirections[i], lightDir);
+        mUpdateStatsElapsed = 0.0f;
+
+        std::string text = "Update: " + mUpdateGraph.CriticalPathToString() +
+            ", wall " + std::to_string(stats.WallMilliseconds) + " ms\n";
+        ::OutputDebugStringA(text.c_str());
     }
- 
-	AnimateMaterials(gt);
-	UpdateObjectCBs(gt);
-    UpdateSkinnedCBs(gt);
-	UpdateMaterialBuffer(gt);
-    UpdateShadowTransform(gt);
-	UpdateMainPassCB(gt);
-    UpdateShadowPassCB(gt);
-    UpdateSsaoCB(gt);
 }
 
 void SkinnedMeshApp::Draw(const GameTimer& gt)
@@ -543,21 +557,41 @@ void SkinnedMeshApp::OnKeyboardInput(const GameTimer& gt)
 {
 	const float dt = gt.DeltaTime();
 
-	if(GetAsyncKeyState('W') & 0x8000)
+	if(IsKeyDown('W'))
 		mCamera.Walk(10.0f*dt);
 
-	if(GetAsyncKeyState('S') & 0x8000)
+	if(IsKeyDown('S'))
 		mCamera.Walk(-10.0f*dt);
 
-	if(GetAsyncKeyState('A') & 0x8000)
+	if(IsKeyDown('A'))
 		mCamera.Strafe(-10.0f*dt);
 
-	if(GetAsyncKeyState('D') & 0x8000)
+	if(IsKeyDown('D'))
 		mCamera.Strafe(10.0f*dt);
 
+	if(IsKeyDown('1'))
+		mLogUpdateCriticalPath = true;
+
+	if(IsKeyDown('2'))
+		mLogUpdateCriticalPath = false;
+
 	mCamera.UpdateViewMatrix();
 }
  
+void SkinnedMeshApp::AnimateLights(const GameTimer& gt)
+{
+    // Animate the lights (and hence shadows).
+    mLightRotationAngle += 0.1f*gt.DeltaTime();
+
+    XMMATRIX R = XMMatrixRotationY(mLightRotationAngle);
+    for(int i = 0; i < 3; ++i)
+    {
+        XMVECTOR lightDir = XMLoadFloat3(&mBaseLightDirections[i]);
+        lightDir = XMVector3TransformNormal(lightDir, R);
+        XMStoreFloat3(&mRotatedLightDirections[i], lightDir);
+    }
+}
+
 void SkinnedMeshApp::AnimateMaterials(const GameTimer& gt)
 {
 	
@@ -784,6 +818,49 @@ void SkinnedMeshApp::UpdateSsaoCB(const GameTimer& gt)
     currSsaoCB->CopyData(0, ssaoCB);
 }
 
+void SkinnedMeshApp::BuildUpdateGraph()
+{
+    // The camera is moved by OnKeyboardInput before the graph runs, so it is
+    // not a resource here.
+    auto lights = mUpdateGraph.AddResource("Lights");
+    auto shadowTransform = mUpdateGraph.AddResource("ShadowTransform");
+    auto materials = mUpdateGraph.AddResource("Materials");
+    auto renderItems = mUpdateGraph.AddResource("RenderItems");
+    auto skinnedInst = mUpdateGraph.AddResource("SkinnedModelInstance");
+    auto objectCB = mUpdateGraph.AddResource("ObjectCB");
+    auto skinnedCB = mUpdateGraph.AddResource("SkinnedCB");
+    auto materialBuffer = mUpdateGraph.AddResource("MaterialBuffer");
+    auto mainPass = mUpdateGraph.AddResource("MainPassCB");
+    auto shadowPass = mUpdateGraph.AddResource("ShadowPassCB");
+    auto ssaoCB = mUpdateGraph.AddResource("SsaoCB");
+
+    // Added in the order the stages used to be called, which the graph keeps
+    // for every pair that touches the same data.
+    mUpdateGraph.AddTask("AnimateLights",
+        [this]() { AnimateLights(*mUpdateTimer); }, {}, { lights });
+    mUpdateGraph.AddTask("AnimateMaterials",
+        [this]() { AnimateMaterials(*mUpdateTimer); }, {}, { materials });
+
+    // Only reads Mat->MatCBIndex, which never changes after BuildMaterials,
+    // so it does not wait for the materials.
+    mUpdateGraph.AddTask("ObjectCBs",
+        [this]() { UpdateObjectCBs(*mUpdateTimer); }, {}, { renderItems, objectCB });
+    mUpdateGraph.AddTask("SkinnedCBs",
+        [this]() { UpdateSkinnedCBs(*mUpdateTimer); }, {}, { skinnedInst, skinnedCB });
+    mUpdateGraph.AddTask("MaterialBuffer",
+        [this]() { UpdateMaterialBuffer(*mUpdateTimer); }, {}, { materials, materialBuffer });
+    mUpdateGraph.AddTask("ShadowTransform",
+        [this]() { UpdateShadowTransform(*mUpdateTimer); }, { lights }, { shadowTransform });
+
+    // The main and shadow pass write different elements of PassCB.
+    mUpdateGraph.AddTask("MainPassCB",
+        [this]() { UpdateMainPassCB(*mUpdateTimer); }, { lights, shadowTransform }, { mainPass });
+    mUpdateGraph.AddTask("ShadowPassCB",
+        [this]() { UpdateShadowPassCB(*mUpdateTimer); }, { shadowTransform }, { shadowPass });
+    mUpdateGraph.AddTask("SsaoCB",
+        [this]() { UpdateSsaoCB(*mUpdateTimer); }, { mainPass }, { ssaoCB });
+}
+
 void SkinnedMeshApp::LoadTextures()
 {
 	std::vector<std::string> texNames = 
@@ -1071,42 +1148,64 @@ void SkinnedMeshApp::BuildDescriptorHeaps()
 
 void SkinnedMeshApp::BuildShadersAndInputLayout()
 {
-	const D3D_SHADER_MACRO alphaTestDefines[] =
+	const std::vector<ShaderCache::Define> alphaTestDefines = { { "ALPHA_TEST", "1" } };
+	const std::vector<ShaderCache::Define> skinnedDefines = { { "SKINNED", "1" } };
+
+	std::vector<std::string> names;
+	std::vector<ShaderCache::Request> requests;
+	auto addShader = [&](const std::string& name, const std::string& filename,
+		const std::vector<ShaderCache::Define>& defines, const std::string& entryPoint, const std::string& target)
 	{
-		"ALPHA_TEST", "1",
-		NULL, NULL
+		names.push_back(name);
+		requests.push_back({ filename, defines, entryPoint, target });
 	};
 
-    const D3D_SHADER_MACRO skinnedDefines[] =
-    {
-        "SKINNED", "1",
-        NULL, NULL
-    };
+	addShader("standardVS", "Shaders\\Default.hlsl", {}, "VS", "vs_5_1");
+    addShader("skinnedVS", "Shaders\\Default.hlsl", skinnedDefines, "VS", "vs_5_1");
+	addShader("opaquePS", "Shaders\\Default.hlsl", {}, "PS", "ps_5_1");
 
-	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["skinnedVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", skinnedDefines, "VS", "vs_5_1");
-	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "PS", "ps_5_1");
+    addShader("shadowVS", "Shaders\\Shadows.hlsl", {}, "VS", "vs_5_1");
+    addShader("skinnedShadowVS", "Shaders\\Shadows.hlsl", skinnedDefines, "VS", "vs_5_1");
+    addShader("shadowOpaquePS", "Shaders\\Shadows.hlsl", {}, "PS", "ps_5_1");
+    addShader("shadowAlphaTestedPS", "Shaders\\Shadows.hlsl", alphaTestDefines, "PS", "ps_5_1");
 
-    mShaders["shadowVS"] = d3dUtil::CompileShader(L"Shaders\\Shadows.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["skinnedShadowVS"] = d3dUtil::CompileShader(L"Shaders\\Shadows.hlsl", skinnedDefines, "VS", "vs_5_1");
-    mShaders["shadowOpaquePS"] = d3dUtil::CompileShader(L"Shaders\\Shadows.hlsl", nullptr, "PS", "ps_5_1");
-    mShaders["shadowAlphaTestedPS"] = d3dUtil::CompileShader(L"Shaders\\Shadows.hlsl", alphaTestDefines, "PS", "ps_5_1");
-	
-    mShaders["debugVS"] = d3dUtil::CompileShader(L"Shaders\\ShadowDebug.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["debugPS"] = d3dUtil::CompileShader(L"Shaders\\ShadowDebug.hlsl", nullptr, "PS", "ps_5_1");
+    addShader("debugVS", "Shaders\\ShadowDebug.hlsl", {}, "VS", "vs_5_1");
+    addShader("debugPS", "Shaders\\ShadowDebug.hlsl", {}, "PS", "ps_5_1");
+
+    addShader("drawNormalsVS", "Shaders\\DrawNormals.hlsl", {}, "VS", "vs_5_1");
+    addShader("skinnedDrawNormalsVS", "Shaders\\DrawNormals.hlsl", skinnedDefines, "VS", "vs_5_1");
+    addShader("drawNormalsPS", "Shaders\\DrawNormals.hlsl", {}, "PS", "ps_5_1");
+
+    addShader("ssaoVS", "Shaders\\Ssao.hlsl", {}, "VS", "vs_5_1");
+    addShader("ssaoPS", "Shaders\\Ssao.hlsl", {}, "PS", "ps_5_1");
 
-    mShaders["drawNormalsVS"] = d3dUtil::CompileShader(L"Shaders\\DrawNormals.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["skinnedDrawNormalsVS"] = d3dUtil::CompileShader(L"Shaders\\DrawNormals.hlsl", skinnedDefines, "VS", "vs_5_1");
-    mShaders["drawNormalsPS"] = d3dUtil::CompileShader(L"Shaders\\DrawNormals.hlsl", nullptr, "PS", "ps_5_1");
+    addShader("ssaoBlurVS", "Shaders\\SsaoBlur.hlsl", {}, "VS", "vs_5_1");
+    addShader("ssaoBlurPS", "Shaders\\SsaoBlur.hlsl", {}, "PS", "ps_5_1");
 
-    mShaders["ssaoVS"] = d3dUtil::CompileShader(L"Shaders\\Ssao.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["ssaoPS"] = d3dUtil::CompileShader(L"Shaders\\Ssao.hlsl", nullptr, "PS", "ps_5_1");
+	addShader("skyVS", "Shaders\\Sky.hlsl", {}, "VS", "vs_5_1");
+	addShader("skyPS", "Shaders\\Sky.hlsl", {}, "PS", "ps_5_1");
 
-    mShaders["ssaoBlurVS"] = d3dUtil::CompileShader(L"Shaders\\SsaoBlur.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["ssaoBlurPS"] = d3dUtil::CompileShader(L"Shaders\\SsaoBlur.hlsl", nullptr, "PS", "ps_5_1");
+	// Only the shaders whose source, includes or defines changed since the
+	// last run are compiled, in parallel; the rest come from the ShaderCache
+	// directory.
+	ShaderCacheBackend compiler;
+	ShaderCache cache(compiler);
+
+	std::vector<ShaderCache::Shader> shaders;
+	ShaderCache::Status status = cache.Build(requests, &shaders, mThreadPool.get());
+
+	for(size_t i = 0; i < shaders.size(); ++i)
+	{
+		if(!shaders[i].Errors.empty())
+			OutputDebugStringA(shaders[i].Errors.c_str());
+
+		if(shaders[i].Result == ShaderCache::Status::Ok)
+			mShaders[names[i]] = ShaderCacheBackend::ToBlob(shaders[i].Bytecode);
+	}
 
-	mShaders["skyVS"] = d3dUtil::CompileShader(L"Shaders\\Sky.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["skyPS"] = d3dUtil::CompileShader(L"Shaders\\Sky.hlsl", nullptr, "PS", "ps_5_1");
+	OutputDebugStringA(("SkinnedMeshApp: " + cache.GetStats().ToString() + "\n").c_str());
+	if(status != ShaderCache::Status::Ok)
+		ThrowIfFailed(E_FAIL);
 
     mInputLayout =
     {
@@ -0,0 +1,114 @@
+//***************************************************************************************
+// BarrierBatch.h by DanielDFY
+//
+// D3D12 front end of ResourceStateTracker.  Track a resource with its current
+// state, ask for the state each use needs with Transition, and call Flush before
+// the commands that depend on it; everything requested since the previous Flush
+// goes out in one ResourceBarrier call, with redundant transitions removed.
+//
+// Transitions always apply to all subresources.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "ResourceStateTracker.h"
+
+class BarrierBatch
+{
+public:
+	// Read states that may be combined with each other (GENERIC_READ is one such
+	// combination).
+	static const UINT ReadOnlyStates =
+		D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER |
+		D3D12_RESOURCE_STATE_INDEX_BUFFER |
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE |
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE |
+		D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT |
+		D3D12_RESOURCE_STATE_COPY_SOURCE |
+		D3D12_RESOURCE_STATE_DEPTH_READ;
+
+	BarrierBatch() :
+		mTracker(ReadOnlyStates)
+	{
+	}
+
+	BarrierBatch(const BarrierBatch& rhs) = delete;
+	BarrierBatch& operator=(const BarrierBatch& rhs) = delete;
+
+	void Track(ID3D12Resource* resource, D3D12_RESOURCE_STATES state)
+	{
+		assert(mIds.find(resource) == mIds.end());
+
+		auto id = mTracker.Register((ResourceStateTracker::State)state);
+		mIds[resource] = id;
+
+		if(id >= mResources.size())
+			mResources.resize(id + 1);
+		mResources[id] = resource;
+	}
+
+	// The resource is left in its current state.
+	void Untrack(ID3D12Resource* resource)
+	{
+		auto it = mIds.find(resource);
+		assert(it != mIds.end());
+
+		mTracker.Unregister(it->second);
+		mResources[it->second] = nullptr;
+		mIds.erase(it);
+	}
+
+	// Forgets every resource, e.g. before they are recreated on resize.
+	void Reset()
+	{
+		mTracker.Clear();
+		mIds.clear();
+		mResources.clear();
+	}
+
+	D3D12_RESOURCE_STATES GetState(ID3D12Resource* resource)const
+	{
+		auto it = mIds.find(resource);
+		assert(it != mIds.end());
+
+		return (D3D12_RESOURCE_STATES)mTracker.GetState(it->second);
+	}
+
+	void Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES state)
+	{
+		auto it = mIds.find(resource);
+		assert(it != mIds.end());
+
+		mTracker.Transition(it->second, (ResourceStateTracker::State)state);
+	}
+
+	void Flush(ID3D12GraphicsCommandList* cmdList)
+	{
+		mTracker.Flush([&](const ResourceStateTracker::Barrier* barriers, std::uint32_t count)
+		{
+			mBarriers.resize(count);
+			for(std::uint32_t i = 0; i < count; ++i)
+			{
+				mBarriers[i] = CD3DX12_RESOURCE_BARRIER::Transition(
+					mResources[barriers[i].Resource],
+					(D3D12_RESOURCE_STATES)barriers[i].Before,
+					(D3D12_RESOURCE_STATES)barriers[i].After);
+			}
+
+			cmdList->ResourceBarrier(count, mBarriers.data());
+		});
+	}
+
+	const ResourceStateTracker::Stats& GetStats()const
+	{
+		return mTracker.GetStats();
+	}
+
+private:
+	ResourceStateTracker mTracker;
+
+	std::unordered_map<ID3D12Resource*, ResourceStateTracker::ResourceId> mIds;
+	std::vector<ID3D12Resource*> mResources;
+	std::vector<D3D12_RESOURCE_BARRIER> mBarriers;
+};
@@ -0,0 +1,1115 @@
+//***************************************************************************************
+// BlockCompression.cpp by DanielDFY
+//***************************************************************************************
+
+#include "BlockCompression.h"
+#include "SimdMath.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+	//----------------------------------------------------------------------------------
+	// Lanes: as many floats as the SimdMath backend processes per instruction.
+	//----------------------------------------------------------------------------------
+#if defined(SIMDMATH_AVX2)
+	typedef __m256 Lanes;
+	const int LaneCount = 8;
+
+	inline Lanes LanesLoad(const float* p) { return _mm256_loadu_ps(p); }
+	inline void LanesStore(float* p, Lanes v) { _mm256_storeu_ps(p, v); }
+	inline Lanes LanesSet(float s) { return _mm256_set1_ps(s); }
+	inline Lanes LanesRamp() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+	inline Lanes LanesAdd(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+	inline Lanes LanesSub(Lanes a, Lanes b) { return _mm256_sub_ps(a, b); }
+	inline Lanes LanesMul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+	inline Lanes LanesDiv(Lanes a, Lanes b) { return _mm256_div_ps(a, b); }
+	inline Lanes LanesMin(Lanes a, Lanes b) { return _mm256_min_ps(a, b); }
+	inline Lanes LanesMax(Lanes a, Lanes b) { return _mm256_max_ps(a, b); }
+	inline Lanes LanesLess(Lanes a, Lanes b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	inline Lanes LanesSelect(Lanes a, Lanes b, Lanes mask) { return _mm256_blendv_ps(a, b, mask); }
+	inline Lanes LanesRound(Lanes v) { return _mm256_round_ps(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+	inline Lanes LanesTruncate(Lanes v) { return _mm256_round_ps(v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+#elif defined(SIMDMATH_SSE2)
+	typedef __m128 Lanes;
+	const int LaneCount = 4;
+
+	inline Lanes LanesLoad(const float* p) { return _mm_loadu_ps(p); }
+	inline void LanesStore(float* p, Lanes v) { _mm_storeu_ps(p, v); }
+	inline Lanes LanesSet(float s) { return _mm_set1_ps(s); }
+	inline Lanes LanesRamp() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+	inline Lanes LanesAdd(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+	inline Lanes LanesSub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+	inline Lanes LanesMul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+	inline Lanes LanesDiv(Lanes a, Lanes b) { return _mm_div_ps(a, b); }
+	inline Lanes LanesMin(Lanes a, Lanes b) { return _mm_min_ps(a, b); }
+	inline Lanes LanesMax(Lanes a, Lanes b) { return _mm_max_ps(a, b); }
+	inline Lanes LanesLess(Lanes a, Lanes b) { return _mm_cmplt_ps(a, b); }
+	inline Lanes LanesSelect(Lanes a, Lanes b, Lanes mask) { return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a)); }
+	inline Lanes LanesRound(Lanes v) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(v)); }
+	inline Lanes LanesTruncate(Lanes v) { return _mm_cvtepi32_ps(_mm_cvttps_epi32(v)); }
+#else
+	typedef float Lanes;
+	const int LaneCount = 1;
+
+	inline Lanes LanesLoad(const float* p) { return *p; }
+	inline void LanesStore(float* p, Lanes v) { *p = v; }
+	inline Lanes LanesSet(float s) { return s; }
+	inline Lanes LanesRamp() { return 0.0f; }
+	inline Lanes LanesAdd(Lanes a, Lanes b) { return a + b; }
+	inline Lanes LanesSub(Lanes a, Lanes b) { return a - b; }
+	inline Lanes LanesMul(Lanes a, Lanes b) { return a * b; }
+	inline Lanes LanesDiv(Lanes a, Lanes b) { return a / b; }
+	inline Lanes LanesMin(Lanes a, Lanes b) { return a < b ? a : b; }
+	inline Lanes LanesMax(Lanes a, Lanes b) { return a > b ? a : b; }
+	inline Lanes LanesLess(Lanes a, Lanes b) { return a < b ? 1.0f : 0.0f; }
+	inline Lanes LanesSelect(Lanes a, Lanes b, Lanes mask) { return mask != 0.0f ? b : a; }
+	inline Lanes LanesRound(Lanes v) { return std::nearbyint(v); }
+	inline Lanes LanesTruncate(Lanes v) { return std::trunc(v); }
+#endif
+
+	const float MaxError = std::numeric_limits<float>::max();
+
+	// The 16 texels of a block, one array per channel, in row order.
+	struct BlockTexels
+	{
+		float R[16];
+		float G[16];
+		float B[16];
+		float A[16];
+	};
+
+	void LoadBlock(const std::uint8_t rgba[64], BlockTexels* t)
+	{
+		for(int i = 0; i < 16; ++i)
+		{
+			t->R[i] = rgba[i * 4 + 0];
+			t->G[i] = rgba[i * 4 + 1];
+			t->B[i] = rgba[i * 4 + 2];
+			t->A[i] = rgba[i * 4 + 3];
+		}
+	}
+
+	// For each texel, the nearest of count palette entries (Channels floats
+	// each) and the squared distance to it.
+	template<int Channels>
+	void FindIndices(const float* const channels[Channels], const float* palette, int count,
+		std::uint8_t indices[16], float distances[16])
+	{
+		float best[LaneCount];
+		float bestIndex[LaneCount];
+		for(int base = 0; base < 16; base += LaneCount)
+		{
+			Lanes bestDistance = LanesSet(MaxError);
+			Lanes bestK = LanesSet(0.0f);
+			for(int k = 0; k < count; ++k)
+			{
+				Lanes d = LanesSet(0.0f);
+				for(int c = 0; c < Channels; ++c)
+				{
+					Lanes diff = LanesSub(LanesLoad(channels[c] + base), LanesSet(palette[k * Channels + c]));
+					d = LanesAdd(d, LanesMul(diff, diff));
+				}
+
+				Lanes closer = LanesLess(d, bestDistance);
+				bestDistance = LanesSelect(bestDistance, d, closer);
+				bestK = LanesSelect(bestK, LanesSet((float)k), closer);
+			}
+
+			LanesStore(best, bestDistance);
+			LanesStore(bestIndex, bestK);
+			for(int l = 0; l < LaneCount; ++l)
+			{
+				indices[base + l] = (std::uint8_t)bestIndex[l];
+				distances[base + l] = best[l];
+			}
+		}
+	}
+
+	//----------------------------------------------------------------------------------
+	// BC1 color blocks (also the color half of BC3)
+	//----------------------------------------------------------------------------------
+
+	float Clamp255(float v)
+	{
+		return v < 0.0f ? 0.0f : (v > 255.0f ? 255.0f : v);
+	}
+
+	std::uint16_t To565(const float rgb[3])
+	{
+		std::uint32_t r = (std::uint32_t)(Clamp255(rgb[0]) * (31.0f / 255.0f) + 0.5f);
+		std::uint32_t g = (std::uint32_t)(Clamp255(rgb[1]) * (63.0f / 255.0f) + 0.5f);
+		std::uint32_t b = (std::uint32_t)(Clamp255(rgb[2]) * (31.0f / 255.0f) + 0.5f);
+		return (std::uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	// The palette the decoder builds from the two endpoints, as RGBA.  Entry 3
+	// is transparent black in the 3 color mode.
+	void ColorPalette(std::uint16_t c0, std::uint16_t c1, bool fourColor, std::uint8_t palette[4][4])
+	{
+		std::uint32_t r0 = (c0 >> 11) & 31, g0 = (c0 >> 5) & 63, b0 = c0 & 31;
+		std::uint32_t r1 = (c1 >> 11) & 31, g1 = (c1 >> 5) & 63, b1 = c1 & 31;
+
+		std::uint32_t e[2][3] =
+		{
+			{ (r0 << 3) | (r0 >> 2), (g0 << 2) | (g0 >> 4), (b0 << 3) | (b0 >> 2) },
+			{ (r1 << 3) | (r1 >> 2), (g1 << 2) | (g1 >> 4), (b1 << 3) | (b1 >> 2) }
+		};
+
+		for(int c = 0; c < 3; ++c)
+		{
+			palette[0][c] = (std::uint8_t)e[0][c];
+			palette[1][c] = (std::uint8_t)e[1][c];
+			if(fourColor)
+			{
+				palette[2][c] = (std::uint8_t)((2 * e[0][c] + e[1][c] + 1) / 3);
+				palette[3][c] = (std::uint8_t)((e[0][c] + 2 * e[1][c] + 1) / 3);
+			}
+			else
+			{
+				palette[2][c] = (std::uint8_t)((e[0][c] + e[1][c] + 1) / 2);
+				palette[3][c] = 0;
+			}
+		}
+
+		palette[0][3] = palette[1][3] = palette[2][3] = 255;
+		palette[3][3] = fourColor ? 255 : 0;
+	}
+
+	struct ColorFit
+	{
+		std::uint16_t C0 = 0;
+		std::uint16_t C1 = 0;
+		std::uint8_t Indices[16] = {};
+		float Error = MaxError;
+	};
+
+	// How the decoder will read the block.
+	enum class ColorMode
+	{
+		FourColor,       // BC1, needs C0 > C1
+		ThreeColor,      // BC1, needs C0 <= C1; index 3 is transparent
+		AlwaysFourColor  // BC3 ignores the order of the endpoints
+	};
+
+	// Quantizes the endpoints, orders them for the mode and picks the nearest
+	// palette entry for every texel in use; the others get index 3.
+	void EvaluateColorEndpoints(const BlockTexels& t, std::uint32_t use, const float a[3], const float b[3],
+		ColorMode mode, ColorFit* fit)
+	{
+		std::uint16_t c0 = To565(a);
+		std::uint16_t c1 = To565(b);
+		if((mode == ColorMode::FourColor && c0 < c1) || (mode == ColorMode::ThreeColor && c0 > c1))
+			std::swap(c0, c1);
+
+		// Equal endpoints read as the 3 color mode; the palette is one color.
+		bool fourColor = mode == ColorMode::AlwaysFourColor || c0 > c1;
+
+		std::uint8_t entries[4][4];
+		ColorPalette(c0, c1, fourColor, entries);
+
+		float palette[12];
+		for(int k = 0; k < 4; ++k)
+		{
+			palette[k * 3 + 0] = entries[k][0];
+			palette[k * 3 + 1] = entries[k][1];
+			palette[k * 3 + 2] = entries[k][2];
+		}
+
+		const float* channels[3] = { t.R, t.G, t.B };
+		std::uint8_t indices[16];
+		float distances[16];
+		FindIndices<3>(channels, palette, fourColor ? 4 : 3, indices, distances);
+
+		float error = 0.0f;
+		for(int i = 0; i < 16; ++i)
+		{
+			if(use & (1u << i))
+				error += distances[i];
+			else
+				indices[i] = 3;
+		}
+
+		if(error < fit->Error)
+		{
+			fit->C0 = c0;
+			fit->C1 = c1;
+			std::copy(indices, indices + 16, fit->Indices);
+			fit->Error = error;
+		}
+	}
+
+	// Mean and principal axis of the texels in use, the axis by power iteration
+	// on their covariance.
+	void PrincipalAxis(const BlockTexels& t, std::uint32_t use, float mean[3], float axis[3])
+	{
+		float n = 0.0f;
+		mean[0] = mean[1] = mean[2] = 0.0f;
+		for(int i = 0; i < 16; ++i)
+		{
+			if(use & (1u << i))
+			{
+				mean[0] += t.R[i];
+				mean[1] += t.G[i];
+				mean[2] += t.B[i];
+				n += 1.0f;
+			}
+		}
+		mean[0] /= n;
+		mean[1] /= n;
+		mean[2] /= n;
+
+		float cov[6] = {};
+		for(int i = 0; i < 16; ++i)
+		{
+			if(use & (1u << i))
+			{
+				float r = t.R[i] - mean[0];
+				float g = t.G[i] - mean[1];
+				float b = t.B[i] - mean[2];
+				cov[0] += r * r;
+				cov[1] += r * g;
+				cov[2] += r * b;
+				cov[3] += g * g;
+				cov[4] += g * b;
+				cov[5] += b * b;
+			}
+		}
+
+		float v[3] = { 1.0f, 1.0f, 1.0f };
+		for(int iteration = 0; iteration < 8; ++iteration)
+		{
+			float x = cov[0] * v[0] + cov[1] * v[1] + cov[2] * v[2];
+			float y = cov[1] * v[0] + cov[3] * v[1] + cov[4] * v[2];
+			float z = cov[2] * v[0] + cov[4] * v[1] + cov[5] * v[2];
+
+			float m = std::fabs(x) > std::fabs(y) ? std::fabs(x) : std::fabs(y);
+			m = std::fabs(z) > m ? std::fabs(z) : m;
+			if(m == 0.0f)
+				break;
+
+			v[0] = x / m;
+			v[1] = y / m;
+			v[2] = z / m;
+		}
+
+		float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		axis[0] = v[0] / length;
+		axis[1] = v[1] / length;
+		axis[2] = v[2] / length;
+	}
+
+	// The texels in use with the lowest and highest projection on the axis.
+	void RangeFit(const BlockTexels& t, std::uint32_t use, const float axis[3], float a[3], float b[3])
+	{
+		float lo = MaxError;
+		float hi = -MaxError;
+		int loIndex = 0;
+		int hiIndex = 0;
+		for(int i = 0; i < 16; ++i)
+		{
+			if(!(use & (1u << i)))
+				continue;
+
+			float d = t.R[i] * axis[0] + t.G[i] * axis[1] + t.B[i] * axis[2];
+			if(d < lo)
+			{
+				lo = d;
+				loIndex = i;
+			}
+			if(d > hi)
+			{
+				hi = d;
+				hiIndex = i;
+			}
+		}
+
+		a[0] = t.R[hiIndex];
+		a[1] = t.G[hiIndex];
+		a[2] = t.B[hiIndex];
+		b[0] = t.R[loIndex];
+		b[1] = t.G[loIndex];
+		b[2] = t.B[loIndex];
+	}
+
+	// Least squares endpoints for fixed indices: texel ~ w * a + (1 - w) * b,
+	// with w the weight of endpoint 0 in the index's palette entry.
+	bool SolveEndpoints(const BlockTexels& t, std::uint32_t use, const std::uint8_t indices[16],
+		bool fourColor, float a[3], float b[3])
+	{
+		const float fourWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		const float threeWeights[4] = { 1.0f, 0.0f, 0.5f, 0.0f };
+		const float* weights = fourColor ? fourWeights : threeWeights;
+
+		float alpha2 = 0.0f, beta2 = 0.0f, alphaBeta = 0.0f;
+		float alphaX[3] = {}, betaX[3] = {};
+		for(int i = 0; i < 16; ++i)
+		{
+			if(!(use & (1u << i)) || (!fourColor && indices[i] == 3))
+				continue;
+
+			float w = weights[indices[i]];
+			float x[3] = { t.R[i], t.G[i], t.B[i] };
+			alpha2 += w * w;
+			beta2 += (1.0f - w) * (1.0f - w);
+			alphaBeta += w * (1.0f - w);
+			for(int c = 0; c < 3; ++c)
+			{
+				alphaX[c] += w * x[c];
+				betaX[c] += (1.0f - w) * x[c];
+			}
+		}
+
+		float det = alpha2 * beta2 - alphaBeta * alphaBeta;
+		if(std::fabs(det) < 1e-3f)
+			return false;
+
+		float factor = 1.0f / det;
+		for(int c = 0; c < 3; ++c)
+		{
+			a[c] = (alphaX[c] * beta2 - betaX[c] * alphaBeta) * factor;
+			b[c] = (betaX[c] * alpha2 - alphaX[c] * alphaBeta) * factor;
+		}
+
+		return true;
+	}
+
+	void RefineColorFit(const BlockTexels& t, std::uint32_t use, ColorMode mode, ColorFit* fit)
+	{
+		for(int iteration = 0; iteration < 2; ++iteration)
+		{
+			bool fourColor = mode == ColorMode::AlwaysFourColor || fit->C0 > fit->C1;
+
+			float a[3], b[3];
+			float error = fit->Error;
+			if(!SolveEndpoints(t, use, fit->Indices, fourColor, a, b))
+				return;
+
+			EvaluateColorEndpoints(t, use, a, b, fourColor ? mode : ColorMode::ThreeColor, fit);
+			if(fit->Error >= error)
+				return;
+		}
+	}
+
+	// Quantizes endpoint channels to the 5 or 6 bit grid and back.
+	inline Lanes QuantizeLanes(Lanes v, float levels, float expand, float shift)
+	{
+		Lanes clamped = LanesMin(LanesMax(v, LanesSet(0.0f)), LanesSet(255.0f));
+		Lanes q = LanesRound(LanesMul(clamped, LanesSet(levels / 255.0f)));
+		return LanesAdd(LanesMul(q, LanesSet(expand)), LanesTruncate(LanesMul(q, LanesSet(shift))));
+	}
+
+	// Tries every split of the texels, ordered along the axis, into the four
+	// palette entries and keeps the one whose least squares endpoints have the
+	// lowest error once quantized.  The splits that differ only in where the
+	// last cluster starts are evaluated LaneCount at a time.
+	void ClusterFit(const BlockTexels& t, std::uint32_t use, const float axis[3], ColorMode mode, ColorFit* fit)
+	{
+		int order[16];
+		float keys[16];
+		int n = 0;
+		for(int i = 0; i < 16; ++i)
+		{
+			if(!(use & (1u << i)))
+				continue;
+
+			float key = t.R[i] * axis[0] + t.G[i] * axis[1] + t.B[i] * axis[2];
+			int j = n++;
+			for(; j > 0 && keys[j - 1] > key; --j)
+			{
+				keys[j] = keys[j - 1];
+				order[j] = order[j - 1];
+			}
+			keys[j] = key;
+			order[j] = i;
+		}
+
+		// Sums of the first k ordered texels, padded so every lane can load.
+		float prefix[3][17 + LaneCount] = {};
+		for(int k = 0; k < n; ++k)
+		{
+			prefix[0][k + 1] = prefix[0][k] + t.R[order[k]];
+			prefix[1][k + 1] = prefix[1][k] + t.G[order[k]];
+			prefix[2][k + 1] = prefix[2][k] + t.B[order[k]];
+		}
+		for(int c = 0; c < 3; ++c)
+		{
+			for(int k = n + 1; k < 17 + LaneCount; ++k)
+				prefix[c][k] = prefix[c][n];
+		}
+
+		const float levels[3] = { 31.0f, 63.0f, 31.0f };
+		const float expand[3] = { 8.0f, 4.0f, 8.0f };
+		const float shift[3] = { 0.25f, 1.0f / 16.0f, 0.25f };
+
+		float bestError = MaxError;
+		int bestI = 0, bestJ = 0, bestK = 0;
+
+		float laneErrors[LaneCount];
+		for(int i = 0; i <= n; ++i)
+		{
+			for(int j = i; j <= n; ++j)
+			{
+				// [0, i) -> entry 0, [i, j) -> entry 2, [j, k) -> entry 3, [k, n) -> entry 1
+				for(int k0 = j; k0 <= n; k0 += LaneCount)
+				{
+					Lanes k = LanesAdd(LanesRamp(), LanesSet((float)k0));
+					Lanes count2 = LanesSet((float)(j - i));
+					Lanes count3 = LanesSub(k, LanesSet((float)j));
+					Lanes count1 = LanesSub(LanesSet((float)n), k);
+
+					Lanes alpha2 = LanesAdd(LanesSet((float)i),
+						LanesAdd(LanesMul(count2, LanesSet(4.0f / 9.0f)), LanesMul(count3, LanesSet(1.0f / 9.0f))));
+					Lanes beta2 = LanesAdd(count1,
+						LanesAdd(LanesMul(count2, LanesSet(1.0f / 9.0f)), LanesMul(count3, LanesSet(4.0f / 9.0f))));
+					Lanes alphaBeta = LanesMul(LanesAdd(count2, count3), LanesSet(2.0f / 9.0f));
+					Lanes det = LanesSub(LanesMul(alpha2, beta2), LanesMul(alphaBeta, alphaBeta));
+					Lanes factor = LanesDiv(LanesSet(1.0f), LanesMax(det, LanesSet(1e-3f)));
+
+					Lanes error = LanesSet(0.0f);
+					for(int c = 0; c < 3; ++c)
+					{
+						Lanes sumI = LanesSet(prefix[c][i]);
+						Lanes sumJ = LanesSet(prefix[c][j]);
+						Lanes sumK = LanesLoad(&prefix[c][k0]);
+						Lanes sumN = LanesSet(prefix[c][n]);
+
+						Lanes sum2 = LanesSub(sumJ, sumI);
+						Lanes sum3 = LanesSub(sumK, sumJ);
+						Lanes alphaX = LanesAdd(sumI, LanesAdd(LanesMul(sum2, LanesSet(2.0f / 3.0f)), LanesMul(sum3, LanesSet(1.0f / 3.0f))));
+						Lanes betaX = LanesAdd(LanesSub(sumN, sumK), LanesAdd(LanesMul(sum2, LanesSet(1.0f / 3.0f)), LanesMul(sum3, LanesSet(2.0f / 3.0f))));
+
+						Lanes a = LanesMul(LanesSub(LanesMul(alphaX, beta2), LanesMul(betaX, alphaBeta)), factor);
+						Lanes b = LanesMul(LanesSub(LanesMul(betaX, alpha2), LanesMul(alphaX, alphaBeta)), factor);
+						a = QuantizeLanes(a, levels[c], expand[c], shift[c]);
+						b = QuantizeLanes(b, levels[c], expand[c], shift[c]);
+
+						// |x - (w a + (1 - w) b)|^2 summed over the texels, less the
+						// sum of x^2, which every split shares.
+						Lanes e = LanesAdd(LanesMul(LanesMul(a, a), alpha2), LanesMul(LanesMul(b, b), beta2));
+						e = LanesAdd(e, LanesMul(LanesMul(LanesMul(a, b), alphaBeta), LanesSet(2.0f)));
+						e = LanesSub(e, LanesMul(LanesAdd(LanesMul(a, alphaX), LanesMul(b, betaX)), LanesSet(2.0f)));
+						error = LanesAdd(error, e);
+					}
+
+					// Splits past n, and the ones with a single cluster, have no
+					// unique solution.
+					error = LanesSelect(error, LanesSet(MaxError), LanesLess(LanesSet((float)n), k));
+					error = LanesSelect(error, LanesSet(MaxError), LanesLess(det, LanesSet(1e-3f)));
+
+					LanesStore(laneErrors, error);
+					for(int l = 0; l < LaneCount; ++l)
+					{
+						if(laneErrors[l] < bestError)
+						{
+							bestError = laneErrors[l];
+							bestI = i;
+							bestJ = j;
+							bestK = k0 + l;
+						}
+					}
+				}
+			}
+		}
+
+		if(bestError == MaxError)
+			return;
+
+		std::uint8_t indices[16] = {};
+		for(int p = 0; p < n; ++p)
+			indices[order[p]] = (std::uint8_t)(p < bestI ? 0 : (p < bestJ ? 2 : (p < bestK ? 3 : 1)));
+
+		float a[3], b[3];
+		if(SolveEndpoints(t, use, indices, true, a, b))
+			EvaluateColorEndpoints(t, use, a, b, mode, fit);
+	}
+
+	void WriteColorBlock(const ColorFit& fit, std::uint8_t* out)
+	{
+		std::uint32_t bits = 0;
+		for(int i = 0; i < 16; ++i)
+			bits |= (std::uint32_t)fit.Indices[i] << (2 * i);
+
+		out[0] = (std::uint8_t)(fit.C0 & 0xff);
+		out[1] = (std::uint8_t)(fit.C0 >> 8);
+		out[2] = (std::uint8_t)(fit.C1 & 0xff);
+		out[3] = (std::uint8_t)(fit.C1 >> 8);
+		out[4] = (std::uint8_t)(bits & 0xff);
+		out[5] = (std::uint8_t)((bits >> 8) & 0xff);
+		out[6] = (std::uint8_t)((bits >> 16) & 0xff);
+		out[7] = (std::uint8_t)(bits >> 24);
+	}
+
+	// BC1 (allowTransparent) or the color half of BC3.
+	void EncodeColorBlock(const BlockTexels& t, BlockCompression::Quality quality, bool allowTransparent, std::uint8_t* out)
+	{
+		std::uint32_t use = 0xffff;
+		if(allowTransparent)
+		{
+			for(int i = 0; i < 16; ++i)
+			{
+				if(t.A[i] < 128.0f)
+					use &= ~(1u << i);
+			}
+		}
+
+		ColorFit fit;
+		if(use == 0)
+		{
+			// 3 color mode, every texel transparent.
+			fit.C0 = 0;
+			fit.C1 = 0xffff;
+			std::fill(fit.Indices, fit.Indices + 16, (std::uint8_t)3);
+			WriteColorBlock(fit, out);
+			return;
+		}
+
+		ColorMode mode = !allowTransparent ? ColorMode::AlwaysFourColor :
+			(use == 0xffff ? ColorMode::FourColor : ColorMode::ThreeColor);
+
+		float mean[3], axis[3];
+		PrincipalAxis(t, use, mean, axis);
+
+		float a[3], b[3];
+		RangeFit(t, use, axis, a, b);
+		EvaluateColorEndpoints(t, use, a, b, mode, &fit);
+
+		if(quality != BlockCompression::Quality::Fast)
+		{
+			RefineColorFit(t, use, mode, &fit);
+
+			// An opaque BC1 block can still be closer with the 3 color palette.
+			if(mode == ColorMode::FourColor)
+			{
+				ColorFit threeColor;
+				EvaluateColorEndpoints(t, use, a, b, ColorMode::ThreeColor, &threeColor);
+				RefineColorFit(t, use, ColorMode::ThreeColor, &threeColor);
+				if(threeColor.Error < fit.Error)
+					fit = threeColor;
+			}
+		}
+
+		if(quality == BlockCompression::Quality::High && mode != ColorMode::ThreeColor)
+			ClusterFit(t, use, axis, mode, &fit);
+
+		WriteColorBlock(fit, out);
+	}
+
+	void DecodeColorBlock(const std::uint8_t* in, bool alwaysFourColor, std::uint8_t rgba[64])
+	{
+		std::uint16_t c0 = (std::uint16_t)(in[0] | (in[1] << 8));
+		std::uint16_t c1 = (std::uint16_t)(in[2] | (in[3] << 8));
+		std::uint32_t bits = in[4] | (in[5] << 8) | (in[6] << 16) | ((std::uint32_t)in[7] << 24);
+
+		std::uint8_t palette[4][4];
+		ColorPalette(c0, c1, alwaysFourColor || c0 > c1, palette);
+
+		for(int i = 0; i < 16; ++i)
+		{
+			const std::uint8_t* p = palette[(bits >> (2 * i)) & 3];
+			std::copy(p, p + 4, rgba + i * 4);
+		}
+	}
+
+	//----------------------------------------------------------------------------------
+	// BC4 channels (also the alpha of BC3 and both channels of BC5)
+	//----------------------------------------------------------------------------------
+
+	void ChannelPalette(std::uint32_t r0, std::uint32_t r1, std::uint8_t palette[8])
+	{
+		palette[0] = (std::uint8_t)r0;
+		palette[1] = (std::uint8_t)r1;
+		if(r0 > r1)
+		{
+			for(std::uint32_t i = 1; i < 7; ++i)
+				palette[i + 1] = (std::uint8_t)(((7 - i) * r0 + i * r1 + 3) / 7);
+		}
+		else
+		{
+			for(std::uint32_t i = 1; i < 5; ++i)
+				palette[i + 1] = (std::uint8_t)(((5 - i) * r0 + i * r1 + 2) / 5);
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	struct ChannelFit
+	{
+		std::uint32_t R0 = 0;
+		std::uint32_t R1 = 0;
+		std::uint8_t Indices[16] = {};
+		float Error = MaxError;
+	};
+
+	void EvaluateChannelEndpoints(const float values[16], std::uint32_t r0, std::uint32_t r1, ChannelFit* fit)
+	{
+		std::uint8_t entries[8];
+		ChannelPalette(r0, r1, entries);
+
+		float palette[8];
+		for(int k = 0; k < 8; ++k)
+			palette[k] = entries[k];
+
+		const float* channels[1] = { values };
+		std::uint8_t indices[16];
+		float distances[16];
+		FindIndices<1>(channels, palette, 8, indices, distances);
+
+		float error = 0.0f;
+		for(int i = 0; i < 16; ++i)
+			error += distances[i];
+
+		if(error < fit->Error)
+		{
+			fit->R0 = r0;
+			fit->R1 = r1;
+			std::copy(indices, indices + 16, fit->Indices);
+			fit->Error = error;
+		}
+	}
+
+	// r0 > r1 selects the 8 value mode, r0 <= r1 the 6 value mode; the search
+	// keeps each candidate in its mode.
+	void SearchChannelEndpoints(const float values[16], int r0, int r1, bool eightValues, ChannelFit* fit)
+	{
+		for(int d0 = -2; d0 <= 2; ++d0)
+		{
+			for(int d1 = -2; d1 <= 2; ++d1)
+			{
+				int a = r0 + d0;
+				int b = r1 + d1;
+				if(a < 0 || a > 255 || b < 0 || b > 255 || (eightValues ? a <= b : a > b))
+					continue;
+
+				EvaluateChannelEndpoints(values, (std::uint32_t)a, (std::uint32_t)b, fit);
+			}
+		}
+	}
+
+	void EncodeChannelBlock(const float values[16], BlockCompression::Quality quality, std::uint8_t* out)
+	{
+		float lo = 255.0f, hi = 0.0f;
+		float innerLo = 255.0f, innerHi = 0.0f;
+		for(int i = 0; i < 16; ++i)
+		{
+			float v = values[i];
+			lo = v < lo ? v : lo;
+			hi = v > hi ? v : hi;
+			if(v > 0.0f && v < 255.0f)
+			{
+				innerLo = v < innerLo ? v : innerLo;
+				innerHi = v > innerHi ? v : innerHi;
+			}
+		}
+
+		// Equal endpoints read as the 6 value mode with index 0 everywhere.
+		ChannelFit fit;
+		EvaluateChannelEndpoints(values, (std::uint32_t)hi, (std::uint32_t)lo, &fit);
+
+		if(quality != BlockCompression::Quality::Fast && (lo == 0.0f || hi == 255.0f))
+		{
+			// 0 and 255 come for free; the interpolation spans the rest.
+			if(innerLo > innerHi)
+				innerLo = innerHi = 0.0f;
+			EvaluateChannelEndpoints(values, (std::uint32_t)innerLo, (std::uint32_t)innerHi, &fit);
+		}
+
+		if(quality == BlockCompression::Quality::High && fit.Error > 0.0f)
+		{
+			if(hi > lo)
+				SearchChannelEndpoints(values, (int)hi, (int)lo, true, &fit);
+			if(lo == 0.0f || hi == 255.0f)
+				SearchChannelEndpoints(values, (int)innerLo, (int)innerHi, false, &fit);
+		}
+
+		std::uint64_t bits = 0;
+		for(int i = 0; i < 16; ++i)
+			bits |= (std::uint64_t)fit.Indices[i] << (3 * i);
+
+		out[0] = (std::uint8_t)fit.R0;
+		out[1] = (std::uint8_t)fit.R1;
+		for(int i = 0; i < 6; ++i)
+			out[2 + i] = (std::uint8_t)((bits >> (8 * i)) & 0xff);
+	}
+
+	// 16 values written every stride bytes.
+	void DecodeChannelBlock(const std::uint8_t* in, std::uint8_t* values, int stride)
+	{
+		std::uint8_t palette[8];
+		ChannelPalette(in[0], in[1], palette);
+
+		std::uint64_t bits = 0;
+		for(int i = 0; i < 6; ++i)
+			bits |= (std::uint64_t)in[2 + i] << (8 * i);
+
+		for(int i = 0; i < 16; ++i)
+			values[i * stride] = palette[(bits >> (3 * i)) & 7];
+	}
+
+	// Squared error and number of samples over the channels the format stores.
+	void SquaredError(BlockCompression::Format format, const std::uint8_t* a, std::uint64_t rowPitchA,
+		const std::uint8_t* b, std::uint64_t rowPitchB, std::uint32_t width, std::uint32_t height,
+		double* error, std::uint64_t* samples)
+	{
+		int channels = 3;
+		switch(format)
+		{
+		case BlockCompression::Format::BC1: channels = 3; break;
+		case BlockCompression::Format::BC3: channels = 4; break;
+		case BlockCompression::Format::BC4: channels = 1; break;
+		case BlockCompression::Format::BC5: channels = 2; break;
+		}
+
+		std::uint64_t sum = 0;
+		for(std::uint32_t y = 0; y < height; ++y)
+		{
+			const std::uint8_t* rowA = a + y * rowPitchA;
+			const std::uint8_t* rowB = b + y * rowPitchB;
+			for(std::uint32_t x = 0; x < width; ++x)
+			{
+				for(int c = 0; c < channels; ++c)
+				{
+					int d = (int)rowA[x * 4 + c] - (int)rowB[x * 4 + c];
+					sum += (std::uint64_t)(d * d);
+				}
+			}
+		}
+
+		*error += (double)sum;
+		*samples += (std::uint64_t)width * height * channels;
+	}
+
+	double ToPsnr(double error, std::uint64_t samples)
+	{
+		if(error == 0.0)
+			return std::numeric_limits<double>::infinity();
+
+		return 10.0 * std::log10(255.0 * 255.0 * (double)samples / error);
+	}
+
+	// Source formats CompressDDS reads; *bgr for the ones stored blue first.
+	bool IsSourceFormat(DXGI_FORMAT format, bool* bgr, bool* srgb, bool* opaque)
+	{
+		*bgr = false;
+		*srgb = false;
+		*opaque = false;
+		switch(format)
+		{
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB: *srgb = true; return true;
+		case DXGI_FORMAT_R8G8B8A8_UNORM:      return true;
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB: *srgb = true; *bgr = true; return true;
+		case DXGI_FORMAT_B8G8R8A8_UNORM:      *bgr = true; return true;
+		case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB: *srgb = true; *bgr = true; *opaque = true; return true;
+		case DXGI_FORMAT_B8G8R8X8_UNORM:      *bgr = true; *opaque = true; return true;
+		default:                              return false;
+		}
+	}
+}
+
+double BlockCompression::Report::EncodeMPixPerSecond()const
+{
+	return EncodeMilliseconds > 0.0 ? Texels / (EncodeMilliseconds * 1000.0) : 0.0;
+}
+
+double BlockCompression::Report::DecodeMPixPerSecond()const
+{
+	return DecodeMilliseconds > 0.0 ? Texels / (DecodeMilliseconds * 1000.0) : 0.0;
+}
+
+std::string BlockCompression::Report::ToString()const
+{
+	std::ostringstream outs;
+	outs << Texels / 1000 << "K texels, encode " << EncodeMPixPerSecond() << " MPix/s, decode " <<
+		DecodeMPixPerSecond() << " MPix/s, PSNR " << Psnr << " dB";
+	return outs.str();
+}
+
+std::uint32_t BlockCompression::BlockBytes(Format format)
+{
+	return format == Format::BC1 || format == Format::BC4 ? 8 : 16;
+}
+
+DXGI_FORMAT BlockCompression::GetDXGIFormat(Format format, bool srgb)
+{
+	switch(format)
+	{
+	case Format::BC1: return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+	case Format::BC3: return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+	case Format::BC4: return DXGI_FORMAT_BC4_UNORM;
+	case Format::BC5: return DXGI_FORMAT_BC5_UNORM;
+	}
+
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+void BlockCompression::EncodeBlock(Format format, Quality quality, const std::uint8_t rgba[64], std::uint8_t* block)
+{
+	BlockTexels t;
+	LoadBlock(rgba, &t);
+
+	switch(format)
+	{
+	case Format::BC1:
+		EncodeColorBlock(t, quality, true, block);
+		break;
+
+	case Format::BC3:
+		EncodeChannelBlock(t.A, quality, block);
+		EncodeColorBlock(t, quality, false, block + 8);
+		break;
+
+	case Format::BC4:
+		EncodeChannelBlock(t.R, quality, block);
+		break;
+
+	case Format::BC5:
+		EncodeChannelBlock(t.R, quality, block);
+		EncodeChannelBlock(t.G, quality, block + 8);
+		break;
+	}
+}
+
+void BlockCompression::DecodeBlock(Format format, const std::uint8_t* block, std::uint8_t rgba[64])
+{
+	switch(format)
+	{
+	case Format::BC1:
+		DecodeColorBlock(block, false, rgba);
+		break;
+
+	case Format::BC3:
+		DecodeColorBlock(block + 8, true, rgba);
+		DecodeChannelBlock(block, rgba + 3, 4);
+		break;
+
+	case Format::BC4:
+	case Format::BC5:
+		for(int i = 0; i < 16; ++i)
+		{
+			rgba[i * 4 + 1] = 0;
+			rgba[i * 4 + 2] = 0;
+			rgba[i * 4 + 3] = 255;
+		}
+		DecodeChannelBlock(block, rgba, 4);
+		if(format == Format::BC5)
+			DecodeChannelBlock(block + 8, rgba + 1, 4);
+		break;
+	}
+}
+
+void BlockCompression::Encode(Format format, Quality quality,
+	const std::uint8_t* rgba, std::uint32_t width, std::uint32_t height, std::uint64_t rowPitch,
+	std::uint8_t* blocks, std::uint64_t blockRowPitch, ThreadPool* pool)
+{
+	std::uint32_t blocksWide = (width + 3) / 4;
+	std::uint32_t blocksHigh = (height + 3) / 4;
+	std::uint32_t blockBytes = BlockBytes(format);
+
+	auto encodeRow = [&](std::uint32_t by, std::uint32_t)
+	{
+		std::uint8_t texels[64];
+		for(std::uint32_t bx = 0; bx < blocksWide; ++bx)
+		{
+			for(std::uint32_t y = 0; y < 4; ++y)
+			{
+				std::uint32_t sy = by * 4 + y < height ? by * 4 + y : height - 1;
+				for(std::uint32_t x = 0; x < 4; ++x)
+				{
+					std::uint32_t sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+					const std::uint8_t* p = rgba + sy * rowPitch + sx * 4;
+					std::copy(p, p + 4, texels + (y * 4 + x) * 4);
+				}
+			}
+
+			EncodeBlock(format, quality, texels, blocks + by * blockRowPitch + bx * blockBytes);
+		}
+	};
+
+	if(pool != nullptr)
+	{
+		pool->ParallelFor(blocksHigh, encodeRow);
+	}
+	else
+	{
+		for(std::uint32_t by = 0; by < blocksHigh; ++by)
+			encodeRow(by, 0);
+	}
+}
+
+void BlockCompression::Decode(Format format,
+	const std::uint8_t* blocks, std::uint64_t blockRowPitch, std::uint32_t width, std::uint32_t height,
+	std::uint8_t* rgba, std::uint64_t rowPitch, ThreadPool* pool)
+{
+	std::uint32_t blocksWide = (width + 3) / 4;
+	std::uint32_t blocksHigh = (height + 3) / 4;
+	std::uint32_t blockBytes = BlockBytes(format);
+
+	auto decodeRow = [&](std::uint32_t by, std::uint32_t)
+	{
+		std::uint8_t texels[64];
+		for(std::uint32_t bx = 0; bx < blocksWide; ++bx)
+		{
+			DecodeBlock(format, blocks + by * blockRowPitch + bx * blockBytes, texels);
+
+			for(std::uint32_t y = 0; y < 4 && by * 4 + y < height; ++y)
+			{
+				std::uint32_t count = bx * 4 + 4 <= width ? 4 : width - bx * 4;
+				std::copy(texels + y * 16, texels + y * 16 + count * 4,
+					rgba + (by * 4 + y) * rowPitch + bx * 16);
+			}
+		}
+	};
+
+	if(pool != nullptr)
+	{
+		pool->ParallelFor(blocksHigh, decodeRow);
+	}
+	else
+	{
+		for(std::uint32_t by = 0; by < blocksHigh; ++by)
+			decodeRow(by, 0);
+	}
+}
+
+double BlockCompression::Psnr(Format format, const std::uint8_t* a, std::uint64_t rowPitchA,
+	const std::uint8_t* b, std::uint64_t rowPitchB, std::uint32_t width, std::uint32_t height)
+{
+	double error = 0.0;
+	std::uint64_t samples = 0;
+	SquaredError(format, a, rowPitchA, b, rowPitchB, width, height, &error, &samples);
+	return ToPsnr(error, samples);
+}
+
+BlockCompression::Status BlockCompression::CompressDDS(const std::string& input, const std::string& output,
+	Format format, Quality quality, ThreadPool* pool, Report* report)
+{
+	DDSFile file;
+	if(file.Open(input) != DDSFile::Status::Ok)
+		return Status::OpenFailed;
+
+	const DDSFile::Desc& desc = file.GetDesc();
+
+	// D3D12 wants the top mip of a BC texture to be whole blocks.
+	bool bgr, srgb, opaque;
+	if(!IsSourceFormat(desc.Format, &bgr, &srgb, &opaque) ||
+		desc.Dimension != DDSFile::TextureDimension::Texture2D ||
+		desc.Width % 4 != 0 || desc.Height % 4 != 0)
+	{
+		return Status::NotSupported;
+	}
+
+	DDSFile::Desc compressed = desc;
+	compressed.Format = GetDXGIFormat(format, srgb);
+
+	Report r;
+
+	// Subresources in file order, each converted to RGBA and then encoded.
+	std::vector<std::vector<std::uint8_t>> sources;
+	std::vector<std::uint64_t> offsets;
+	std::uint64_t compressedBytes = 0;
+	for(const DDSFile::Subresource& s : file.Subresources())
+	{
+		std::vector<std::uint8_t> rgba((size_t)s.Width * s.Height * 4);
+		for(std::uint32_t y = 0; y < s.Height; ++y)
+		{
+			const std::uint8_t* src = s.Data + y * s.RowPitch;
+			std::uint8_t* dst = rgba.data() + (size_t)y * s.Width * 4;
+			for(std::uint32_t x = 0; x < s.Width; ++x)
+			{
+				dst[x * 4 + 0] = src[x * 4 + (bgr ? 2 : 0)];
+				dst[x * 4 + 1] = src[x * 4 + 1];
+				dst[x * 4 + 2] = src[x * 4 + (bgr ? 0 : 2)];
+				dst[x * 4 + 3] = opaque ? 255 : src[x * 4 + 3];
+			}
+		}
+		sources.push_back(std::move(rgba));
+
+		size_t numBytes = 0;
+		size_t rowBytes = 0;
+		size_t numRows = 0;
+		DDSGetSurfaceInfo(s.Width, s.Height, compressed.Format, &numBytes, &rowBytes, &numRows);
+		offsets.push_back(compressedBytes);
+		compressedBytes += numBytes;
+
+		r.Texels += (std::uint64_t)s.Width * s.Height;
+	}
+
+	const std::vector<DDSFile::Subresource>& subresources = file.Subresources();
+	std::vector<std::uint8_t> blocks((size_t)compressedBytes);
+
+	auto start = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < subresources.size(); ++i)
+	{
+		const DDSFile::Subresource& s = subresources[i];
+		Encode(format, quality, sources[i].data(), s.Width, s.Height, (std::uint64_t)s.Width * 4,
+			blocks.data() + offsets[i], ((s.Width + 3) / 4) * BlockBytes(format), pool);
+	}
+	auto encoded = std::chrono::steady_clock::now();
+
+	std::vector<std::vector<std::uint8_t>> decoded(subresources.size());
+	for(size_t i = 0; i < subresources.size(); ++i)
+	{
+		const DDSFile::Subresource& s = subresources[i];
+		decoded[i].resize(sources[i].size());
+		Decode(format, blocks.data() + offsets[i], ((s.Width + 3) / 4) * BlockBytes(format),
+			s.Width, s.Height, decoded[i].data(), (std::uint64_t)s.Width * 4, pool);
+	}
+	auto finished = std::chrono::steady_clock::now();
+
+	double error = 0.0;
+	std::uint64_t samples = 0;
+	for(size_t i = 0; i < subresources.size(); ++i)
+	{
+		const DDSFile::Subresource& s = subresources[i];
+		SquaredError(format, sources[i].data(), (std::uint64_t)s.Width * 4,
+			decoded[i].data(), (std::uint64_t)s.Width * 4, s.Width, s.Height, &error, &samples);
+	}
+
+	r.EncodeMilliseconds = std::chrono::duration<double, std::milli>(encoded - start).count();
+	r.DecodeMilliseconds = std::chrono::duration<double, std::milli>(finished - encoded).count();
+	r.Psnr = ToPsnr(error, samples);
+	if(report != nullptr)
+		*report = r;
+
+	std::ofstream out(output, std::ios::binary | std::ios::trunc);
+	if(!out)
+		return Status::WriteFailed;
+
+	// Keeps the reserved words, so a TexturePacker layout survives.
+	bool written = DDSFile::WriteHeader(out, compressed, file.Header()->reserved1);
+	if(written)
+	{
+		out.write((const char*)blocks.data(), (std::streamsize)blocks.size());
+		out.close();
+		written = !out.fail();
+	}
+
+	if(!written)
+	{
+		out.close();
+		std::remove(output.c_str());
+		return Status::WriteFailed;
+	}
+
+	return Status::Ok;
+}
+
+const char* BlockCompression::StatusToString(Status status)
+{
+	switch(status)
+	{
+	case Status::Ok:           return "Ok";
+	case Status::OpenFailed:   return "OpenFailed";
+	case Status::NotSupported: return "NotSupported";
+	case Status::WriteFailed:  return "WriteFailed";
+	}
+
+	return "Unknown";
+}
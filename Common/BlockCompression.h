@@ -0,0 +1,115 @@
+//***************************************************************************************
+// BlockCompression.h by DanielDFY
+//
+// CPU encoder and decoder for the BC1, BC3, BC4 and BC5 block compressed
+// formats, so source art can be transcoded at cook time instead of only being
+// passed through by DDSTextureLoader, and BC data can be read back on the CPU
+// for tools and software paths.
+//
+//   BC1 : RGB plus 1 bit alpha, 8 bytes per 4x4 block
+//   BC3 : RGB plus a BC4 alpha channel, 16 bytes
+//   BC4 : one channel (red), 8 bytes
+//   BC5 : two channels (red, green), 16 bytes; normal maps
+//
+// The color endpoints are fit at one of three qualities:
+//   Fast   : range fit, the extreme texels along the principal axis
+//   Normal : range fit, then least squares endpoints for the chosen indices
+//   High   : cluster fit, the best split of the texels ordered along the
+//            principal axis into the four palette entries
+// BC4 channels use the extremes, the 6 value mode that stores 0 and 255
+// exactly (Normal), and a search around the extremes (High).
+//
+// The index searches and the cluster fit evaluate several candidates per
+// instruction; the backend (AVX2, SSE2 or scalar) follows SimdMath.h.  Images
+// are split into rows of blocks across an optional ThreadPool.
+//
+// Interpolated palette entries are rounded to the nearest 8 bit value, which
+// can differ from what a GPU filters by one step.
+//***************************************************************************************
+
+#pragma once
+
+#include "DDSFile.h"
+#include <cstdint>
+#include <string>
+
+class ThreadPool;
+
+class BlockCompression
+{
+public:
+	enum class Format
+	{
+		BC1,
+		BC3,
+		BC4,
+		BC5
+	};
+
+	enum class Quality
+	{
+		Fast,
+		Normal,
+		High
+	};
+
+	enum class Status
+	{
+		Ok,
+		OpenFailed,    // the input could not be opened or parsed
+		NotSupported,  // not an 8 bit RGBA 2D texture with a size multiple of 4
+		WriteFailed
+	};
+
+	struct Report
+	{
+		std::uint64_t Texels = 0;
+		double EncodeMilliseconds = 0.0;
+		double DecodeMilliseconds = 0.0;
+
+		// Peak signal to noise ratio of the decoded texels against the source,
+		// over the channels the format stores.
+		double Psnr = 0.0;
+
+		double EncodeMPixPerSecond()const;
+		double DecodeMPixPerSecond()const;
+
+		std::string ToString()const;
+	};
+
+	// 8 for BC1 and BC4, 16 for BC3 and BC5.
+	static std::uint32_t BlockBytes(Format format);
+
+	static DXGI_FORMAT GetDXGIFormat(Format format, bool srgb);
+
+	// One block from 16 RGBA texels in row order.  BC1 makes texels with
+	// alpha below 128 transparent.
+	static void EncodeBlock(Format format, Quality quality, const std::uint8_t rgba[64], std::uint8_t* block);
+
+	// 16 RGBA texels; channels the format does not store decode as 0 and
+	// alpha as 255.
+	static void DecodeBlock(Format format, const std::uint8_t* block, std::uint8_t rgba[64]);
+
+	// Whole images of RGBA texels.  Partial blocks at the right and bottom
+	// edges repeat the last row and column when encoding and are clipped
+	// when decoding.
+	static void Encode(Format format, Quality quality,
+		const std::uint8_t* rgba, std::uint32_t width, std::uint32_t height, std::uint64_t rowPitch,
+		std::uint8_t* blocks, std::uint64_t blockRowPitch, ThreadPool* pool = nullptr);
+	static void Decode(Format format,
+		const std::uint8_t* blocks, std::uint64_t blockRowPitch, std::uint32_t width, std::uint32_t height,
+		std::uint8_t* rgba, std::uint64_t rowPitch, ThreadPool* pool = nullptr);
+
+	// In dB, over the channels the format stores; infinite for equal images.
+	static double Psnr(Format format, const std::uint8_t* a, std::uint64_t rowPitchA,
+		const std::uint8_t* b, std::uint64_t rowPitchB, std::uint32_t width, std::uint32_t height);
+
+	// Compresses every subresource of an R8G8B8A8, B8G8R8A8 or B8G8R8X8 DDS
+	// texture (sRGB or not) and writes it as a DDS file in the BC format,
+	// keeping sRGB for BC1 and BC3 and the reserved words of the header (so a
+	// TexturePacker layout survives).  The report covers all subresources.
+	static Status CompressDDS(const std::string& input, const std::string& output,
+		Format format, Quality quality, ThreadPool* pool = nullptr, Report* report = nullptr);
+
+	static const char* StatusToString(Status status);
+};
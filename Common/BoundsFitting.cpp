@@ -0,0 +1,572 @@
+//***************************************************************************************
+// BoundsFitting.cpp by DanielDFY
+//***************************************************************************************
+
+#include "BoundsFitting.h"
+#include "MathHelper.h"
+#include <cmath>
+#include <utility>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	XMVECTOR LoadPoint(const XMFLOAT3* points, std::uint32_t stride, std::uint32_t i)
+	{
+		return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(
+			reinterpret_cast<const std::uint8_t*>(points) + (size_t)stride*i));
+	}
+
+	// Grows the sphere just enough to contain p.
+	void GrowSphere(XMVECTOR& center, float& radius, FXMVECTOR p)
+	{
+		XMVECTOR d = XMVectorSubtract(p, center);
+		float dist = XMVectorGetX(XMVector3Length(d));
+		if(dist > radius)
+		{
+			float newRadius = 0.5f*(radius + dist);
+			center = XMVectorAdd(center, XMVectorScale(d, (newRadius - radius) / dist));
+			radius = newRadius;
+		}
+	}
+
+	// Cyclic Jacobi rotations for a symmetric 3x3 matrix.  On return the
+	// diagonal of a holds the eigenvalues and the columns of v the eigenvectors.
+	void JacobiEigen(double a[3][3], double v[3][3])
+	{
+		for(int i = 0; i < 3; ++i)
+			for(int j = 0; j < 3; ++j)
+				v[i][j] = (i == j) ? 1.0 : 0.0;
+
+		const int pairs[3][2] = { { 0, 1 }, { 0, 2 }, { 1, 2 } };
+		for(int sweep = 0; sweep < 32; ++sweep)
+		{
+			double off = a[0][1]*a[0][1] + a[0][2]*a[0][2] + a[1][2]*a[1][2];
+			if(off < 1e-18)
+				break;
+
+			for(auto& pq : pairs)
+			{
+				int p = pq[0];
+				int q = pq[1];
+				if(fabs(a[p][q]) < 1e-18)
+					continue;
+
+				double theta = (a[q][q] - a[p][p]) / (2.0*a[p][q]);
+				double t = (theta >= 0.0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta*theta + 1.0));
+				double c = 1.0 / sqrt(t*t + 1.0);
+				double s = t*c;
+
+				for(int k = 0; k < 3; ++k)
+				{
+					double akp = a[k][p], akq = a[k][q];
+					a[k][p] = c*akp - s*akq;
+					a[k][q] = s*akp + c*akq;
+				}
+				for(int k = 0; k < 3; ++k)
+				{
+					double apk = a[p][k], aqk = a[q][k];
+					a[p][k] = c*apk - s*aqk;
+					a[q][k] = s*apk + c*aqk;
+				}
+				for(int k = 0; k < 3; ++k)
+				{
+					double vkp = v[k][p], vkq = v[k][q];
+					v[k][p] = c*vkp - s*vkq;
+					v[k][q] = s*vkp + c*vkq;
+				}
+			}
+		}
+	}
+
+	// Builds a right handed orthonormal frame (u, v, u x v) from u and a second
+	// direction that does not need to be perpendicular to it.
+	bool MakeFrame(FXMVECTOR a, FXMVECTOR b, XMVECTOR& axis0, XMVECTOR& axis1, XMVECTOR& axis2)
+	{
+		if(XMVectorGetX(XMVector3LengthSq(a)) < 1e-12f)
+			return false;
+
+		axis0 = XMVector3Normalize(a);
+		XMVECTOR perp = XMVectorSubtract(b, XMVectorMultiply(XMVector3Dot(b, axis0), axis0));
+		if(XMVectorGetX(XMVector3LengthSq(perp)) < 1e-12f)
+			return false;
+
+		axis1 = XMVector3Normalize(perp);
+		axis2 = XMVector3Cross(axis0, axis1);
+		return true;
+	}
+
+	// Area of the rectangle spanning the 2D points rotated by angle.
+	float RectArea(const std::vector<XMFLOAT2>& pts, float angle)
+	{
+		float c = cosf(angle);
+		float s = sinf(angle);
+
+		float minU = +MathHelper::Infinity, maxU = -MathHelper::Infinity;
+		float minV = +MathHelper::Infinity, maxV = -MathHelper::Infinity;
+		for(const XMFLOAT2& p : pts)
+		{
+			float u = c*p.x + s*p.y;
+			float v = -s*p.x + c*p.y;
+			minU = MathHelper::Min(minU, u);
+			maxU = MathHelper::Max(maxU, u);
+			minV = MathHelper::Min(minV, v);
+			maxV = MathHelper::Max(maxV, v);
+		}
+
+		return (maxU - minU)*(maxV - minV);
+	}
+
+	// Rotation of the (b, c) plane about the axis a that gives the smallest
+	// rectangle around the projected points.  A coarse sweep over the quarter
+	// turn finds the basin, bisection narrows it down.
+	float BestAngleAboutAxis(const XMFLOAT3* points, std::uint32_t stride, std::uint32_t count,
+		FXMVECTOR b, FXMVECTOR c)
+	{
+		std::vector<XMFLOAT2> pts(count);
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			XMVECTOR p = LoadPoint(points, stride, i);
+			pts[i] = XMFLOAT2(XMVectorGetX(XMVector3Dot(p, b)), XMVectorGetX(XMVector3Dot(p, c)));
+		}
+
+		const int sweepSteps = 16;
+		float step = 0.5f*XM_PI / sweepSteps;
+
+		float bestAngle = 0.0f;
+		float bestArea = RectArea(pts, 0.0f);
+		for(int i = 1; i < sweepSteps; ++i)
+		{
+			float area = RectArea(pts, i*step);
+			if(area < bestArea)
+			{
+				bestArea = area;
+				bestAngle = i*step;
+			}
+		}
+
+		for(int i = 0; i < 10; ++i)
+		{
+			step *= 0.5f;
+			float center = bestAngle;
+			for(float angle : { center - step, center + step })
+			{
+				float area = RectArea(pts, angle);
+				if(area < bestArea)
+				{
+					bestArea = area;
+					bestAngle = angle;
+				}
+			}
+		}
+
+		return bestAngle;
+	}
+}
+
+ContainmentType BoundingVolume::ContainedBy(const BoundingFrustum& frustum)const
+{
+	switch(Type)
+	{
+	case Shape::Sphere:
+		return frustum.Contains(Sphere);
+	case Shape::OrientedBox:
+		return frustum.Contains(OrientedBox);
+	default:
+		return frustum.Contains(Box);
+	}
+}
+
+bool BoundingVolume::Intersects(FXMVECTOR origin, FXMVECTOR direction, float& dist)const
+{
+	switch(Type)
+	{
+	case Shape::Sphere:
+		return Sphere.Intersects(origin, direction, dist);
+	case Shape::OrientedBox:
+		return OrientedBox.Intersects(origin, direction, dist);
+	default:
+		return Box.Intersects(origin, direction, dist);
+	}
+}
+
+float BoundingVolume::Volume()const
+{
+	switch(Type)
+	{
+	case Shape::Sphere:
+		return BoundsFitting::Volume(Sphere);
+	case Shape::OrientedBox:
+		return BoundsFitting::Volume(OrientedBox);
+	default:
+		return BoundsFitting::Volume(Box);
+	}
+}
+
+float BoundsFitting::Volume(const BoundingSphere& s)
+{
+	return 4.0f / 3.0f * XM_PI * s.Radius*s.Radius*s.Radius;
+}
+
+float BoundsFitting::Volume(const BoundingBox& b)
+{
+	return 8.0f * b.Extents.x*b.Extents.y*b.Extents.z;
+}
+
+float BoundsFitting::Volume(const BoundingOrientedBox& b)
+{
+	return 8.0f * b.Extents.x*b.Extents.y*b.Extents.z;
+}
+
+BoundingSphere BoundsFitting::MinimalSphere(const XMFLOAT3* points, std::uint32_t stride, std::uint32_t count,
+	std::uint32_t refineIterations)
+{
+	BoundingSphere result;
+	if(count == 0)
+		return result;
+
+	//
+	// Ritter: start from the most separated pair of axis extremal points and
+	// grow the sphere over all the points.
+	//
+
+	std::uint32_t minIdx[3] = { 0, 0, 0 };
+	std::uint32_t maxIdx[3] = { 0, 0, 0 };
+	XMFLOAT3 minP, maxP;
+	XMStoreFloat3(&minP, LoadPoint(points, stride, 0));
+	maxP = minP;
+	for(std::uint32_t i = 1; i < count; ++i)
+	{
+		XMFLOAT3 p;
+		XMStoreFloat3(&p, LoadPoint(points, stride, i));
+		if(p.x < minP.x) { minP.x = p.x; minIdx[0] = i; }
+		if(p.y < minP.y) { minP.y = p.y; minIdx[1] = i; }
+		if(p.z < minP.z) { minP.z = p.z; minIdx[2] = i; }
+		if(p.x > maxP.x) { maxP.x = p.x; maxIdx[0] = i; }
+		if(p.y > maxP.y) { maxP.y = p.y; maxIdx[1] = i; }
+		if(p.z > maxP.z) { maxP.z = p.z; maxIdx[2] = i; }
+	}
+
+	int bestAxis = 0;
+	float bestDistSq = -1.0f;
+	for(int a = 0; a < 3; ++a)
+	{
+		XMVECTOR d = XMVectorSubtract(LoadPoint(points, stride, maxIdx[a]), LoadPoint(points, stride, minIdx[a]));
+		float distSq = XMVectorGetX(XMVector3LengthSq(d));
+		if(distSq > bestDistSq)
+		{
+			bestDistSq = distSq;
+			bestAxis = a;
+		}
+	}
+
+	XMVECTOR pMin = LoadPoint(points, stride, minIdx[bestAxis]);
+	XMVECTOR pMax = LoadPoint(points, stride, maxIdx[bestAxis]);
+	XMVECTOR center = XMVectorScale(XMVectorAdd(pMin, pMax), 0.5f);
+	float radius = 0.5f*sqrtf(bestDistSq);
+
+	for(std::uint32_t i = 0; i < count; ++i)
+		GrowSphere(center, radius, LoadPoint(points, stride, i));
+
+	//
+	// Refinement: shrink the sphere a little, regrow it over the points in a
+	// different order and keep it if it ended up smaller.  The order is permuted
+	// with a fixed seed so the result is reproducible.
+	//
+
+	std::vector<std::uint32_t> order(count);
+	for(std::uint32_t i = 0; i < count; ++i)
+		order[i] = i;
+
+	std::uint32_t seed = 0x9E3779B9u;
+	XMVECTOR bestCenter = center;
+	float bestRadius = radius;
+	for(std::uint32_t iter = 0; iter < refineIterations; ++iter)
+	{
+		for(std::uint32_t i = count - 1; i > 0; --i)
+		{
+			seed = seed*1664525u + 1013904223u;
+			std::swap(order[i], order[seed % (i + 1)]);
+		}
+
+		XMVECTOR c = bestCenter;
+		float r = bestRadius*0.95f;
+		for(std::uint32_t i = 0; i < count; ++i)
+			GrowSphere(c, r, LoadPoint(points, stride, order[i]));
+
+		if(r < bestRadius)
+		{
+			bestCenter = c;
+			bestRadius = r;
+		}
+	}
+
+	XMStoreFloat3(&result.Center, bestCenter);
+
+	// GrowSphere keeps points exactly on the surface, pad against round off.
+	result.Radius = bestRadius*1.0001f;
+
+	return result;
+}
+
+BoundingOrientedBox BoundsFitting::BoxFromAxes(
+	const XMFLOAT3* points, std::uint32_t stride, std::uint32_t count,
+	FXMVECTOR axis0, FXMVECTOR axis1, FXMVECTOR axis2)
+{
+	XMVECTOR vMin = XMVectorReplicate(+MathHelper::Infinity);
+	XMVECTOR vMax = XMVectorReplicate(-MathHelper::Infinity);
+
+	// Rows are the box axes, so multiplying by the transpose projects onto them.
+	XMMATRIX R(axis0, axis1, axis2, XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f));
+	XMMATRIX toBox = XMMatrixTranspose(R);
+
+	for(std::uint32_t i = 0; i < count; ++i)
+	{
+		XMVECTOR p = XMVector3TransformNormal(LoadPoint(points, stride, i), toBox);
+		vMin = XMVectorMin(vMin, p);
+		vMax = XMVectorMax(vMax, p);
+	}
+
+	BoundingOrientedBox box;
+	XMVECTOR localCenter = XMVectorScale(XMVectorAdd(vMin, vMax), 0.5f);
+	XMStoreFloat3(&box.Center, XMVector3TransformNormal(localCenter, R));
+	XMStoreFloat3(&box.Extents, XMVectorScale(XMVectorSubtract(vMax, vMin), 0.5f));
+	XMStoreFloat4(&box.Orientation, XMQuaternionNormalize(XMQuaternionRotationMatrix(R)));
+
+	return box;
+}
+
+BoundingOrientedBox BoundsFitting::PcaOrientedBox(const XMFLOAT3* points, std::uint32_t stride, std::uint32_t count)
+{
+	BoundingOrientedBox box;
+	if(count == 0)
+		return box;
+
+	double mean[3] = { 0.0, 0.0, 0.0 };
+	for(std::uint32_t i = 0; i < count; ++i)
+	{
+		XMFLOAT3 p;
+		XMStoreFloat3(&p, LoadPoint(points, stride, i));
+		mean[0] += p.x;
+		mean[1] += p.y;
+		mean[2] += p.z;
+	}
+	for(int k = 0; k < 3; ++k)
+		mean[k] /= count;
+
+	double cov[3][3] = {};
+	for(std::uint32_t i = 0; i < count; ++i)
+	{
+		XMFLOAT3 p;
+		XMStoreFloat3(&p, LoadPoint(points, stride, i));
+		double d[3] = { p.x - mean[0], p.y - mean[1], p.z - mean[2] };
+		for(int r = 0; r < 3; ++r)
+			for(int c = r; c < 3; ++c)
+				cov[r][c] += d[r]*d[c];
+	}
+	cov[1][0] = cov[0][1];
+	cov[2][0] = cov[0][2];
+	cov[2][1] = cov[1][2];
+
+	double eigVecs[3][3];
+	JacobiEigen(cov, eigVecs);
+
+	XMVECTOR e0 = XMVectorSet((float)eigVecs[0][0], (float)eigVecs[1][0], (float)eigVecs[2][0], 0.0f);
+	XMVECTOR e1 = XMVectorSet((float)eigVecs[0][1], (float)eigVecs[1][1], (float)eigVecs[2][1], 0.0f);
+
+	XMVECTOR axis0, axis1, axis2;
+	if(!MakeFrame(e0, e1, axis0, axis1, axis2))
+	{
+		axis0 = XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+		axis1 = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+		axis2 = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+	}
+
+	return BoxFromAxes(points, stride, count, axis0, axis1, axis2);
+}
+
+BoundingOrientedBox BoundsFitting::FitOrientedBox(const XMFLOAT3* points, std::uint32_t stride, std::uint32_t count)
+{
+	BoundingOrientedBox best = PcaOrientedBox(points, stride, count);
+	if(count < 3)
+		return best;
+
+	float bestVolume = Volume(best);
+
+	auto tryAxes = [&](FXMVECTOR a, FXMVECTOR b)
+	{
+		XMVECTOR axis0, axis1, axis2;
+		if(!MakeFrame(a, b, axis0, axis1, axis2))
+			return;
+
+		BoundingOrientedBox box = BoxFromAxes(points, stride, count, axis0, axis1, axis2);
+		float volume = Volume(box);
+		if(volume < bestVolume)
+		{
+			best = box;
+			bestVolume = volume;
+		}
+	};
+
+	// World axes (the AABB expressed as an oriented box).
+	tryAxes(XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+
+	//
+	// DiTO: collect the extremal points along a fixed set of directions, build a
+	// large triangle from them and use its edges and normal as candidate axes.
+	//
+
+	const XMVECTOR dirs[7] =
+	{
+		XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f),
+		XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f),
+		XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f),
+		XMVectorSet(1.0f, 1.0f, 1.0f, 0.0f),
+		XMVectorSet(1.0f, 1.0f, -1.0f, 0.0f),
+		XMVectorSet(1.0f, -1.0f, 1.0f, 0.0f),
+		XMVectorSet(1.0f, -1.0f, -1.0f, 0.0f)
+	};
+
+	XMVECTOR minPts[7], maxPts[7];
+	float minProj[7], maxProj[7];
+	for(int d = 0; d < 7; ++d)
+	{
+		minProj[d] = +MathHelper::Infinity;
+		maxProj[d] = -MathHelper::Infinity;
+	}
+
+	for(std::uint32_t i = 0; i < count; ++i)
+	{
+		XMVECTOR p = LoadPoint(points, stride, i);
+		for(int d = 0; d < 7; ++d)
+		{
+			float proj = XMVectorGetX(XMVector3Dot(p, dirs[d]));
+			if(proj < minProj[d]) { minProj[d] = proj; minPts[d] = p; }
+			if(proj > maxProj[d]) { maxProj[d] = proj; maxPts[d] = p; }
+		}
+	}
+
+	// The farthest pair of extremal points forms the first edge.
+	int bestPair = 0;
+	float bestDistSq = -1.0f;
+	for(int d = 0; d < 7; ++d)
+	{
+		float distSq = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(maxPts[d], minPts[d])));
+		if(distSq > bestDistSq)
+		{
+			bestDistSq = distSq;
+			bestPair = d;
+		}
+	}
+
+	XMVECTOR p0 = minPts[bestPair];
+	XMVECTOR p1 = maxPts[bestPair];
+	XMVECTOR e0 = XMVectorSubtract(p1, p0);
+	if(bestDistSq < 1e-12f)
+		return best;
+
+	// The third vertex is the extremal point farthest from the line p0p1.
+	XMVECTOR p2 = p0;
+	float bestLineDistSq = -1.0f;
+	XMVECTOR e0n = XMVector3Normalize(e0);
+	for(int d = 0; d < 14; ++d)
+	{
+		XMVECTOR p = (d < 7) ? minPts[d] : maxPts[d - 7];
+		XMVECTOR v = XMVectorSubtract(p, p0);
+		XMVECTOR perp = XMVectorSubtract(v, XMVectorMultiply(XMVector3Dot(v, e0n), e0n));
+		float distSq = XMVectorGetX(XMVector3LengthSq(perp));
+		if(distSq > bestLineDistSq)
+		{
+			bestLineDistSq = distSq;
+			p2 = p;
+		}
+	}
+
+	XMVECTOR e1 = XMVectorSubtract(p2, p1);
+	XMVECTOR e2 = XMVectorSubtract(p0, p2);
+	XMVECTOR n = XMVector3Cross(e0, e1);
+
+	if(XMVectorGetX(XMVector3LengthSq(n)) < 1e-12f)
+	{
+		// Points are (nearly) collinear; use the edge with any perpendicular.
+		tryAxes(e0, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		tryAxes(e0, XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f));
+		RefineOrientedBox(points, stride, count, best);
+		return best;
+	}
+
+	tryAxes(e0, XMVector3Cross(n, e0));
+	tryAxes(e1, XMVector3Cross(n, e1));
+	tryAxes(e2, XMVector3Cross(n, e2));
+
+	RefineOrientedBox(points, stride, count, best);
+	return best;
+}
+
+void BoundsFitting::RefineOrientedBox(const XMFLOAT3* points, std::uint32_t stride, std::uint32_t count,
+	BoundingOrientedBox& box)
+{
+	// When two extents are close (e.g. a square cross section) PCA and DiTO
+	// leave the axes between them arbitrary, up to twice the area off.  Keep
+	// each axis in turn and rotate the other two about it.
+	float bestVolume = Volume(box);
+	for(int k = 0; k < 3; ++k)
+	{
+		XMMATRIX R = XMMatrixRotationQuaternion(XMLoadFloat4(&box.Orientation));
+		XMVECTOR a = R.r[k];
+		XMVECTOR b = R.r[(k + 1) % 3];
+		XMVECTOR c = R.r[(k + 2) % 3];
+
+		float angle = BestAngleAboutAxis(points, stride, count, b, c);
+		if(angle == 0.0f)
+			continue;
+
+		XMVECTOR rotatedB = XMVectorAdd(XMVectorScale(b, cosf(angle)), XMVectorScale(c, sinf(angle)));
+		XMVECTOR axis0, axis1, axis2;
+		if(!MakeFrame(a, rotatedB, axis0, axis1, axis2))
+			continue;
+
+		BoundingOrientedBox rotated = BoxFromAxes(points, stride, count, axis0, axis1, axis2);
+		float volume = Volume(rotated);
+		if(volume < bestVolume)
+		{
+			box = rotated;
+			bestVolume = volume;
+		}
+	}
+}
+
+BoundingVolume BoundsFitting::Fit(const XMFLOAT3* points, std::uint32_t stride, std::uint32_t count)
+{
+	BoundingVolume bv;
+	if(count == 0)
+		return bv;
+
+	BoundingBox::CreateFromPoints(bv.Box, count, points, stride);
+	bv.Sphere = MinimalSphere(points, stride, count);
+	bv.OrientedBox = FitOrientedBox(points, stride, count);
+
+	// Candidates are visited from the cheapest test to the most expensive one.
+	// A more expensive shape has to be noticeably tighter to be picked.
+	const float threshold = 0.98f;
+
+	bv.Type = BoundingVolume::Shape::Sphere;
+	float bestVolume = Volume(bv.Sphere);
+
+	float boxVolume = Volume(bv.Box);
+	if(boxVolume < bestVolume*threshold)
+	{
+		bv.Type = BoundingVolume::Shape::Box;
+		bestVolume = boxVolume;
+	}
+
+	float obbVolume = Volume(bv.OrientedBox);
+	if(obbVolume < bestVolume*threshold)
+	{
+		bv.Type = BoundingVolume::Shape::OrientedBox;
+		bestVolume = obbVolume;
+	}
+
+	return bv;
+}
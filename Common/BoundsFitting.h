@@ -0,0 +1,81 @@
+//***************************************************************************************
+// BoundsFitting.h by DanielDFY
+//
+// Fits tight bounding volumes to point sets:
+//
+//   MinimalSphere   : Ritter's sphere followed by iterative shrink/regrow
+//                     refinement (Larsson, "Fast and Tight Fitting Bounding Spheres").
+//   FitOrientedBox  : best of the PCA axes, the world axes and the DiTO candidate
+//                     axes derived from a large base triangle of extremal points,
+//                     then rotated about each of its axes to the smallest box.
+//   Fit             : computes all of the above plus the AABB and keeps the one
+//                     with the smallest volume, so culling and ray tests reject
+//                     as much as possible.
+//
+// Only DirectXMath/DirectXCollision are needed, so d3dUtil.h includes this
+// header for SubmeshGeometry::TightBounds.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <DirectXCollision.h>
+
+struct BoundingVolume
+{
+	enum class Shape
+	{
+		Sphere = 0,
+		Box,
+		OrientedBox
+	};
+
+	// Shape used by Contains/Intersects.  The AABB is always valid so code that
+	// only needs a box (e.g. SubmeshGeometry::Bounds) can still use it.
+	Shape Type = Shape::Box;
+
+	DirectX::BoundingSphere Sphere;
+	DirectX::BoundingBox Box;
+	DirectX::BoundingOrientedBox OrientedBox;
+
+	// Same semantics as BoundingFrustum::Contains for the selected shape.
+	DirectX::ContainmentType ContainedBy(const DirectX::BoundingFrustum& frustum)const;
+
+	// Ray test for the selected shape; direction must be normalized.
+	bool Intersects(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, float& dist)const;
+
+	float Volume()const;
+};
+
+class BoundsFitting
+{
+public:
+
+	static DirectX::BoundingSphere MinimalSphere(
+		const DirectX::XMFLOAT3* points, std::uint32_t stride, std::uint32_t count,
+		std::uint32_t refineIterations = 8);
+
+	static DirectX::BoundingOrientedBox PcaOrientedBox(
+		const DirectX::XMFLOAT3* points, std::uint32_t stride, std::uint32_t count);
+
+	static DirectX::BoundingOrientedBox FitOrientedBox(
+		const DirectX::XMFLOAT3* points, std::uint32_t stride, std::uint32_t count);
+
+	static BoundingVolume Fit(
+		const DirectX::XMFLOAT3* points, std::uint32_t stride, std::uint32_t count);
+
+	static float Volume(const DirectX::BoundingSphere& s);
+	static float Volume(const DirectX::BoundingBox& b);
+	static float Volume(const DirectX::BoundingOrientedBox& b);
+
+private:
+	// Projects all points onto the orthonormal axes and returns the box spanning them.
+	static DirectX::BoundingOrientedBox BoxFromAxes(
+		const DirectX::XMFLOAT3* points, std::uint32_t stride, std::uint32_t count,
+		DirectX::FXMVECTOR axis0, DirectX::FXMVECTOR axis1, DirectX::FXMVECTOR axis2);
+
+	// Replaces box with a smaller one rotated about one of its axes, if any.
+	static void RefineOrientedBox(
+		const DirectX::XMFLOAT3* points, std::uint32_t stride, std::uint32_t count,
+		DirectX::BoundingOrientedBox& box);
+};
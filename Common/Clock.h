@@ -0,0 +1,60 @@
+//***************************************************************************************
+// Clock.h by DanielDFY
+//
+// A monotonic time source behind GameTimer, so timing code does not call
+// QueryPerformanceCounter directly and can run on other platforms or against a
+// clock the caller controls.
+//
+// SteadyClock reads std::chrono::steady_clock (QueryPerformanceCounter on
+// MSVC).  ManualClock only moves when told to, so code built on GameTimer or
+// FixedTimestep can be stepped through exact frame times, e.g.
+//   ManualClock clock;
+//   GameTimer timer(clock);
+//   timer.Reset();
+//   clock.Advance(0.016);
+//   timer.Tick();          // timer.DeltaTime() == 0.016f
+//***************************************************************************************
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+class Clock
+{
+public:
+	virtual ~Clock() = default;
+
+	// Nanoseconds since an arbitrary origin; never decreases.
+	virtual std::int64_t Now()const = 0;
+
+	static const Clock& Steady();
+};
+
+class SteadyClock : public Clock
+{
+public:
+	std::int64_t Now()const override
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+};
+
+class ManualClock : public Clock
+{
+public:
+	std::int64_t Now()const override { return mNow; }
+
+	void Set(std::int64_t nanoseconds) { mNow = nanoseconds; }
+	void Advance(double seconds) { mNow += (std::int64_t)(seconds*1e9 + 0.5); }
+
+private:
+	std::int64_t mNow = 0;
+};
+
+inline const Clock& Clock::Steady()
+{
+	static const SteadyClock clock;
+	return clock;
+}
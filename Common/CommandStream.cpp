@@ -0,0 +1,104 @@
+//***************************************************************************************
+// CommandStream.cpp by DanielDFY
+//***************************************************************************************
+
+#include "CommandStream.h"
+#include <cassert>
+
+void CommandStream::Clear()
+{
+	// Keep the capacity, streams are refilled every frame.
+	mWords.clear();
+	mCommandCount = 0;
+}
+
+void CommandStream::SetPipelineState(std::uint32_t pso)
+{
+	mWords.push_back((std::uint32_t)Op::SetPipelineState);
+	mWords.push_back(pso);
+	mCommandCount++;
+}
+
+void CommandStream::SetGeometry(std::uint32_t geometry)
+{
+	mWords.push_back((std::uint32_t)Op::SetGeometry);
+	mWords.push_back(geometry);
+	mCommandCount++;
+}
+
+void CommandStream::SetPrimitiveTopology(std::uint32_t topology)
+{
+	mWords.push_back((std::uint32_t)Op::SetPrimitiveTopology);
+	mWords.push_back(topology);
+	mCommandCount++;
+}
+
+void CommandStream::SetMaterial(std::uint32_t material)
+{
+	mWords.push_back((std::uint32_t)Op::SetMaterial);
+	mWords.push_back(material);
+	mCommandCount++;
+}
+
+void CommandStream::SetObjectCB(std::uint64_t objectCB)
+{
+	mWords.push_back((std::uint32_t)Op::SetObjectCB);
+	mWords.push_back((std::uint32_t)objectCB);
+	mWords.push_back((std::uint32_t)(objectCB >> 32));
+	mCommandCount++;
+}
+
+void CommandStream::DrawIndexedInstanced(const DrawPacket& packet)
+{
+	mWords.push_back((std::uint32_t)Op::DrawIndexedInstanced);
+	mWords.push_back(packet.IndexCount);
+	mWords.push_back(packet.InstanceCount);
+	mWords.push_back(packet.StartIndexLocation);
+	mWords.push_back((std::uint32_t)packet.BaseVertexLocation);
+	mWords.push_back(packet.StartInstanceLocation);
+	mCommandCount++;
+}
+
+void CommandStream::Replay(DrawPacketRecorder& recorder)const
+{
+	const std::uint32_t* w = mWords.data();
+	const std::uint32_t* end = w + mWords.size();
+
+	while(w < end)
+	{
+		switch((Op)*w++)
+		{
+		case Op::SetPipelineState:
+			recorder.SetPipelineState(*w++);
+			break;
+		case Op::SetGeometry:
+			recorder.SetGeometry(*w++);
+			break;
+		case Op::SetPrimitiveTopology:
+			recorder.SetPrimitiveTopology(*w++);
+			break;
+		case Op::SetMaterial:
+			recorder.SetMaterial(*w++);
+			break;
+		case Op::SetObjectCB:
+			recorder.SetObjectCB((std::uint64_t)w[0] | ((std::uint64_t)w[1] << 32));
+			w += 2;
+			break;
+		case Op::DrawIndexedInstanced:
+		{
+			DrawPacket p;
+			p.IndexCount = w[0];
+			p.InstanceCount = w[1];
+			p.StartIndexLocation = w[2];
+			p.BaseVertexLocation = (std::int32_t)w[3];
+			p.StartInstanceLocation = w[4];
+			w += 5;
+			recorder.DrawIndexedInstanced(p);
+			break;
+		}
+		default:
+			assert(false && "corrupt command stream");
+			return;
+		}
+	}
+}
@@ -0,0 +1,48 @@
+//***************************************************************************************
+// CommandStream.h by DanielDFY
+//
+// A DrawPacketRecorder that stores the calls it receives in a compact CPU-side
+// buffer instead of issuing them.  Replay sends them to another recorder later,
+// e.g. the app's command list recorder on the thread that owns that list, or a
+// CountingDrawPacketRecorder when there is no device.  Recording into streams
+// lets draw submission be split across threads and measured without a GPU.
+//***************************************************************************************
+
+#pragma once
+
+#include "DrawPacket.h"
+
+class CommandStream : public DrawPacketRecorder
+{
+public:
+	void Clear();
+
+	virtual void SetPipelineState(std::uint32_t pso)override;
+	virtual void SetGeometry(std::uint32_t geometry)override;
+	virtual void SetPrimitiveTopology(std::uint32_t topology)override;
+	virtual void SetMaterial(std::uint32_t material)override;
+	virtual void SetObjectCB(std::uint64_t objectCB)override;
+	virtual void DrawIndexedInstanced(const DrawPacket& packet)override;
+
+	// Issues the recorded calls in order.  The draws receive packets with only
+	// the draw arguments filled in.
+	void Replay(DrawPacketRecorder& recorder)const;
+
+	std::uint32_t CommandCount()const { return mCommandCount; }
+	size_t SizeInBytes()const { return mWords.size() * sizeof(std::uint32_t); }
+
+private:
+	enum class Op : std::uint32_t
+	{
+		SetPipelineState = 0,
+		SetGeometry,
+		SetPrimitiveTopology,
+		SetMaterial,
+		SetObjectCB,
+		DrawIndexedInstanced
+	};
+
+	// Each command is its opcode followed by its arguments, one 32-bit word each.
+	std::vector<std::uint32_t> mWords;
+	std::uint32_t mCommandCount = 0;
+};
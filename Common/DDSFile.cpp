@@ -0,0 +1,939 @@
+//***************************************************************************************
+// DDSFile.cpp by DanielDFY
+//
+// The format helpers are the ones from DDSTextureLoader.cpp (Microsoft
+// Corporation), see http://go.microsoft.com/fwlink/?LinkId=248926
+//***************************************************************************************
+
+#include "DDSFile.h"
+#include <algorithm>
+
+// Size limits of the D3D12_REQ_* constants, so that no header is accepted
+// here that the device would reject.
+static const uint32_t MaxMipLevels = 15;
+static const uint32_t MaxTexture1DWidth = 16384;
+static const uint32_t MaxTexture1DArraySize = 2048;
+static const uint32_t MaxTexture2DSize = 16384;
+static const uint32_t MaxTexture2DArraySize = 2048;
+static const uint32_t MaxTextureCubeSize = 16384;
+static const uint32_t MaxTexture3DSize = 2048;
+
+// DDS_HEADER flags and caps, see DDS.h in DirectXTex.
+static const uint32_t DDSD_CAPS = 0x00000001;
+static const uint32_t DDSD_PITCH = 0x00000008;
+static const uint32_t DDSD_PIXELFORMAT = 0x00001000;
+static const uint32_t DDSD_MIPMAPCOUNT = 0x00020000;
+static const uint32_t DDSD_LINEARSIZE = 0x00080000;
+static const uint32_t DDSCAPS_COMPLEX = 0x00000008;
+static const uint32_t DDSCAPS_TEXTURE = 0x00001000;
+static const uint32_t DDSCAPS_MIPMAP = 0x00400000;
+
+//--------------------------------------------------------------------------------------
+// Return the BPP for a particular format
+//--------------------------------------------------------------------------------------
+size_t DDSBitsPerPixel( DXGI_FORMAT fmt )
+{
+    switch( fmt )
+    {
+    case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+    case DXGI_FORMAT_R32G32B32A32_FLOAT:
+    case DXGI_FORMAT_R32G32B32A32_UINT:
+    case DXGI_FORMAT_R32G32B32A32_SINT:
+        return 128;
+
+    case DXGI_FORMAT_R32G32B32_TYPELESS:
+    case DXGI_FORMAT_R32G32B32_FLOAT:
+    case DXGI_FORMAT_R32G32B32_UINT:
+    case DXGI_FORMAT_R32G32B32_SINT:
+        return 96;
+
+    case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+    case DXGI_FORMAT_R16G16B16A16_FLOAT:
+    case DXGI_FORMAT_R16G16B16A16_UNORM:
+    case DXGI_FORMAT_R16G16B16A16_UINT:
+    case DXGI_FORMAT_R16G16B16A16_SNORM:
+    case DXGI_FORMAT_R16G16B16A16_SINT:
+    case DXGI_FORMAT_R32G32_TYPELESS:
+    case DXGI_FORMAT_R32G32_FLOAT:
+    case DXGI_FORMAT_R32G32_UINT:
+    case DXGI_FORMAT_R32G32_SINT:
+    case DXGI_FORMAT_R32G8X24_TYPELESS:
+    case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+    case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
+    case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
+    case DXGI_FORMAT_Y416:
+    case DXGI_FORMAT_Y210:
+    case DXGI_FORMAT_Y216:
+        return 64;
+
+    case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+    case DXGI_FORMAT_R10G10B10A2_UNORM:
+    case DXGI_FORMAT_R10G10B10A2_UINT:
+    case DXGI_FORMAT_R11G11B10_FLOAT:
+    case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+    case DXGI_FORMAT_R8G8B8A8_UNORM:
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+    case DXGI_FORMAT_R8G8B8A8_UINT:
+    case DXGI_FORMAT_R8G8B8A8_SNORM:
+    case DXGI_FORMAT_R8G8B8A8_SINT:
+    case DXGI_FORMAT_R16G16_TYPELESS:
+    case DXGI_FORMAT_R16G16_FLOAT:
+    case DXGI_FORMAT_R16G16_UNORM:
+    case DXGI_FORMAT_R16G16_UINT:
+    case DXGI_FORMAT_R16G16_SNORM:
+    case DXGI_FORMAT_R16G16_SINT:
+    case DXGI_FORMAT_R32_TYPELESS:
+    case DXGI_FORMAT_D32_FLOAT:
+    case DXGI_FORMAT_R32_FLOAT:
+    case DXGI_FORMAT_R32_UINT:
+    case DXGI_FORMAT_R32_SINT:
+    case DXGI_FORMAT_R24G8_TYPELESS:
+    case DXGI_FORMAT_D24_UNORM_S8_UINT:
+    case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
+    case DXGI_FORMAT_X24_TYPELESS_G8_UINT:
+    case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+    case DXGI_FORMAT_R8G8_B8G8_UNORM:
+    case DXGI_FORMAT_G8R8_G8B8_UNORM:
+    case DXGI_FORMAT_B8G8R8A8_UNORM:
+    case DXGI_FORMAT_B8G8R8X8_UNORM:
+    case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+    case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+    case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+    case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+    case DXGI_FORMAT_AYUV:
+    case DXGI_FORMAT_Y410:
+    case DXGI_FORMAT_YUY2:
+        return 32;
+
+    case DXGI_FORMAT_P010:
+    case DXGI_FORMAT_P016:
+        return 24;
+
+    case DXGI_FORMAT_R8G8_TYPELESS:
+    case DXGI_FORMAT_R8G8_UNORM:
+    case DXGI_FORMAT_R8G8_UINT:
+    case DXGI_FORMAT_R8G8_SNORM:
+    case DXGI_FORMAT_R8G8_SINT:
+    case DXGI_FORMAT_R16_TYPELESS:
+    case DXGI_FORMAT_R16_FLOAT:
+    case DXGI_FORMAT_D16_UNORM:
+    case DXGI_FORMAT_R16_UNORM:
+    case DXGI_FORMAT_R16_UINT:
+    case DXGI_FORMAT_R16_SNORM:
+    case DXGI_FORMAT_R16_SINT:
+    case DXGI_FORMAT_B5G6R5_UNORM:
+    case DXGI_FORMAT_B5G5R5A1_UNORM:
+    case DXGI_FORMAT_A8P8:
+    case DXGI_FORMAT_B4G4R4A4_UNORM:
+        return 16;
+
+    case DXGI_FORMAT_NV12:
+    case DXGI_FORMAT_420_OPAQUE:
+    case DXGI_FORMAT_NV11:
+        return 12;
+
+    case DXGI_FORMAT_R8_TYPELESS:
+    case DXGI_FORMAT_R8_UNORM:
+    case DXGI_FORMAT_R8_UINT:
+    case DXGI_FORMAT_R8_SNORM:
+    case DXGI_FORMAT_R8_SINT:
+    case DXGI_FORMAT_A8_UNORM:
+    case DXGI_FORMAT_AI44:
+    case DXGI_FORMAT_IA44:
+    case DXGI_FORMAT_P8:
+        return 8;
+
+    case DXGI_FORMAT_R1_UNORM:
+        return 1;
+
+    case DXGI_FORMAT_BC1_TYPELESS:
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC4_TYPELESS:
+    case DXGI_FORMAT_BC4_UNORM:
+    case DXGI_FORMAT_BC4_SNORM:
+        return 4;
+
+    case DXGI_FORMAT_BC2_TYPELESS:
+    case DXGI_FORMAT_BC2_UNORM:
+    case DXGI_FORMAT_BC2_UNORM_SRGB:
+    case DXGI_FORMAT_BC3_TYPELESS:
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+    case DXGI_FORMAT_BC5_TYPELESS:
+    case DXGI_FORMAT_BC5_UNORM:
+    case DXGI_FORMAT_BC5_SNORM:
+    case DXGI_FORMAT_BC6H_TYPELESS:
+    case DXGI_FORMAT_BC6H_UF16:
+    case DXGI_FORMAT_BC6H_SF16:
+    case DXGI_FORMAT_BC7_TYPELESS:
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        return 8;
+
+    default:
+        return 0;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Get surface information for a particular format
+//--------------------------------------------------------------------------------------
+void DDSGetSurfaceInfo( size_t width,
+                        size_t height,
+                        DXGI_FORMAT fmt,
+                        size_t* outNumBytes,
+                        size_t* outRowBytes,
+                        size_t* outNumRows )
+{
+    size_t numBytes = 0;
+    size_t rowBytes = 0;
+    size_t numRows = 0;
+
+    bool bc = false;
+    bool packed = false;
+    bool planar = false;
+    size_t bpe = 0;
+    switch (fmt)
+    {
+    case DXGI_FORMAT_BC1_TYPELESS:
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC4_TYPELESS:
+    case DXGI_FORMAT_BC4_UNORM:
+    case DXGI_FORMAT_BC4_SNORM:
+        bc=true;
+        bpe = 8;
+        break;
+
+    case DXGI_FORMAT_BC2_TYPELESS:
+    case DXGI_FORMAT_BC2_UNORM:
+    case DXGI_FORMAT_BC2_UNORM_SRGB:
+    case DXGI_FORMAT_BC3_TYPELESS:
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+    case DXGI_FORMAT_BC5_TYPELESS:
+    case DXGI_FORMAT_BC5_UNORM:
+    case DXGI_FORMAT_BC5_SNORM:
+    case DXGI_FORMAT_BC6H_TYPELESS:
+    case DXGI_FORMAT_BC6H_UF16:
+    case DXGI_FORMAT_BC6H_SF16:
+    case DXGI_FORMAT_BC7_TYPELESS:
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        bc = true;
+        bpe = 16;
+        break;
+
+    case DXGI_FORMAT_R8G8_B8G8_UNORM:
+    case DXGI_FORMAT_G8R8_G8B8_UNORM:
+    case DXGI_FORMAT_YUY2:
+        packed = true;
+        bpe = 4;
+        break;
+
+    case DXGI_FORMAT_Y210:
+    case DXGI_FORMAT_Y216:
+        packed = true;
+        bpe = 8;
+        break;
+
+    case DXGI_FORMAT_NV12:
+    case DXGI_FORMAT_420_OPAQUE:
+        planar = true;
+        bpe = 2;
+        break;
+
+    case DXGI_FORMAT_P010:
+    case DXGI_FORMAT_P016:
+        planar = true;
+        bpe = 4;
+        break;
+
+    default:
+        // Everything else is a plain per pixel format, see below.
+        break;
+    }
+
+    if (bc)
+    {
+        size_t numBlocksWide = 0;
+        if (width > 0)
+        {
+            numBlocksWide = std::max<size_t>( 1, (width + 3) / 4 );
+        }
+        size_t numBlocksHigh = 0;
+        if (height > 0)
+        {
+            numBlocksHigh = std::max<size_t>( 1, (height + 3) / 4 );
+        }
+        rowBytes = numBlocksWide * bpe;
+        numRows = numBlocksHigh;
+        numBytes = rowBytes * numBlocksHigh;
+    }
+    else if (packed)
+    {
+        rowBytes = ( ( width + 1 ) >> 1 ) * bpe;
+        numRows = height;
+        numBytes = rowBytes * height;
+    }
+    else if ( fmt == DXGI_FORMAT_NV11 )
+    {
+        rowBytes = ( ( width + 3 ) >> 2 ) * 4;
+        numRows = height * 2; // Direct3D makes this simplifying assumption, although it is larger than the 4:1:1 data
+        numBytes = rowBytes * numRows;
+    }
+    else if (planar)
+    {
+        rowBytes = ( ( width + 1 ) >> 1 ) * bpe;
+        numBytes = ( rowBytes * height ) + ( ( rowBytes * height + 1 ) >> 1 );
+        numRows = height + ( ( height + 1 ) >> 1 );
+    }
+    else
+    {
+        size_t bpp = DDSBitsPerPixel( fmt );
+        rowBytes = ( width * bpp + 7 ) / 8; // round up to nearest byte
+        numRows = height;
+        numBytes = rowBytes * height;
+    }
+
+    if (outNumBytes)
+    {
+        *outNumBytes = numBytes;
+    }
+    if (outRowBytes)
+    {
+        *outRowBytes = rowBytes;
+    }
+    if (outNumRows)
+    {
+        *outNumRows = numRows;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+#define ISBITMASK( r,g,b,a ) ( ddpf.RBitMask == r && ddpf.GBitMask == g && ddpf.BBitMask == b && ddpf.ABitMask == a )
+
+DXGI_FORMAT DDSGetDXGIFormat( const DDS_PIXELFORMAT& ddpf )
+{
+    if (ddpf.flags & DDS_RGB)
+    {
+        // Note that sRGB formats are written using the "DX10" extended header
+
+        switch (ddpf.RGBBitCount)
+        {
+        case 32:
+            if (ISBITMASK(0x000000ff,0x0000ff00,0x00ff0000,0xff000000))
+            {
+                return DXGI_FORMAT_R8G8B8A8_UNORM;
+            }
+
+            if (ISBITMASK(0x00ff0000,0x0000ff00,0x000000ff,0xff000000))
+            {
+                return DXGI_FORMAT_B8G8R8A8_UNORM;
+            }
+
+            if (ISBITMASK(0x00ff0000,0x0000ff00,0x000000ff,0x00000000))
+            {
+                return DXGI_FORMAT_B8G8R8X8_UNORM;
+            }
+
+            // No DXGI format maps to ISBITMASK(0x000000ff,0x0000ff00,0x00ff0000,0x00000000) aka D3DFMT_X8B8G8R8
+
+            // Note that many common DDS reader/writers (including D3DX) swap the
+            // the RED/BLUE masks for 10:10:10:2 formats. We assume
+            // below that the 'backwards' header mask is being used since it is most
+            // likely written by D3DX. The more robust solution is to use the 'DX10'
+            // header extension and specify the DXGI_FORMAT_R10G10B10A2_UNORM format directly
+
+            // For 'correct' writers, this should be 0x000003ff,0x000ffc00,0x3ff00000 for RGB data
+            if (ISBITMASK(0x3ff00000,0x000ffc00,0x000003ff,0xc0000000))
+            {
+                return DXGI_FORMAT_R10G10B10A2_UNORM;
+            }
+
+            // No DXGI format maps to ISBITMASK(0x000003ff,0x000ffc00,0x3ff00000,0xc0000000) aka D3DFMT_A2R10G10B10
+
+            if (ISBITMASK(0x0000ffff,0xffff0000,0x00000000,0x00000000))
+            {
+                return DXGI_FORMAT_R16G16_UNORM;
+            }
+
+            if (ISBITMASK(0xffffffff,0x00000000,0x00000000,0x00000000))
+            {
+                // Only 32-bit color channel format in D3D9 was R32F
+                return DXGI_FORMAT_R32_FLOAT; // D3DX writes this out as a FourCC of 114
+            }
+            break;
+
+        case 24:
+            // No 24bpp DXGI formats aka D3DFMT_R8G8B8
+            break;
+
+        case 16:
+            if (ISBITMASK(0x7c00,0x03e0,0x001f,0x8000))
+            {
+                return DXGI_FORMAT_B5G5R5A1_UNORM;
+            }
+            if (ISBITMASK(0xf800,0x07e0,0x001f,0x0000))
+            {
+                return DXGI_FORMAT_B5G6R5_UNORM;
+            }
+
+            // No DXGI format maps to ISBITMASK(0x7c00,0x03e0,0x001f,0x0000) aka D3DFMT_X1R5G5B5
+
+            if (ISBITMASK(0x0f00,0x00f0,0x000f,0xf000))
+            {
+                return DXGI_FORMAT_B4G4R4A4_UNORM;
+            }
+
+            // No DXGI format maps to ISBITMASK(0x0f00,0x00f0,0x000f,0x0000) aka D3DFMT_X4R4G4B4
+
+            // No 3:3:2, 3:3:2:8, or paletted DXGI formats aka D3DFMT_A8R3G3B2, D3DFMT_R3G3B2, D3DFMT_P8, D3DFMT_A8P8, etc.
+            break;
+        }
+    }
+    else if (ddpf.flags & DDS_LUMINANCE)
+    {
+        if (8 == ddpf.RGBBitCount)
+        {
+            if (ISBITMASK(0x000000ff,0x00000000,0x00000000,0x00000000))
+            {
+                return DXGI_FORMAT_R8_UNORM; // D3DX10/11 writes this out as DX10 extension
+            }
+
+            // No DXGI format maps to ISBITMASK(0x0f,0x00,0x00,0xf0) aka D3DFMT_A4L4
+        }
+
+        if (16 == ddpf.RGBBitCount)
+        {
+            if (ISBITMASK(0x0000ffff,0x00000000,0x00000000,0x00000000))
+            {
+                return DXGI_FORMAT_R16_UNORM; // D3DX10/11 writes this out as DX10 extension
+            }
+            if (ISBITMASK(0x000000ff,0x00000000,0x00000000,0x0000ff00))
+            {
+                return DXGI_FORMAT_R8G8_UNORM; // D3DX10/11 writes this out as DX10 extension
+            }
+        }
+    }
+    else if (ddpf.flags & DDS_ALPHA)
+    {
+        if (8 == ddpf.RGBBitCount)
+        {
+            return DXGI_FORMAT_A8_UNORM;
+        }
+    }
+    else if (ddpf.flags & DDS_FOURCC)
+    {
+        if (MAKEFOURCC( 'D', 'X', 'T', '1' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC1_UNORM;
+        }
+        if (MAKEFOURCC( 'D', 'X', 'T', '3' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC2_UNORM;
+        }
+        if (MAKEFOURCC( 'D', 'X', 'T', '5' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC3_UNORM;
+        }
+
+        // While pre-multiplied alpha isn't directly supported by the DXGI formats,
+        // they are basically the same as these BC formats so they can be mapped
+        if (MAKEFOURCC( 'D', 'X', 'T', '2' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC2_UNORM;
+        }
+        if (MAKEFOURCC( 'D', 'X', 'T', '4' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC3_UNORM;
+        }
+
+        if (MAKEFOURCC( 'A', 'T', 'I', '1' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC4_UNORM;
+        }
+        if (MAKEFOURCC( 'B', 'C', '4', 'U' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC4_UNORM;
+        }
+        if (MAKEFOURCC( 'B', 'C', '4', 'S' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC4_SNORM;
+        }
+
+        if (MAKEFOURCC( 'A', 'T', 'I', '2' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC5_UNORM;
+        }
+        if (MAKEFOURCC( 'B', 'C', '5', 'U' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC5_UNORM;
+        }
+        if (MAKEFOURCC( 'B', 'C', '5', 'S' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC5_SNORM;
+        }
+
+        // BC6H and BC7 are written using the "DX10" extended header
+
+        if (MAKEFOURCC( 'R', 'G', 'B', 'G' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_R8G8_B8G8_UNORM;
+        }
+        if (MAKEFOURCC( 'G', 'R', 'G', 'B' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_G8R8_G8B8_UNORM;
+        }
+
+        if (MAKEFOURCC('Y','U','Y','2') == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_YUY2;
+        }
+
+        // Check for D3DFORMAT enums being set here
+        switch( ddpf.fourCC )
+        {
+        case 36: // D3DFMT_A16B16G16R16
+            return DXGI_FORMAT_R16G16B16A16_UNORM;
+
+        case 110: // D3DFMT_Q16W16V16U16
+            return DXGI_FORMAT_R16G16B16A16_SNORM;
+
+        case 111: // D3DFMT_R16F
+            return DXGI_FORMAT_R16_FLOAT;
+
+        case 112: // D3DFMT_G16R16F
+            return DXGI_FORMAT_R16G16_FLOAT;
+
+        case 113: // D3DFMT_A16B16G16R16F
+            return DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+        case 114: // D3DFMT_R32F
+            return DXGI_FORMAT_R32_FLOAT;
+
+        case 115: // D3DFMT_G32R32F
+            return DXGI_FORMAT_R32G32_FLOAT;
+
+        case 116: // D3DFMT_A32B32G32R32F
+            return DXGI_FORMAT_R32G32B32A32_FLOAT;
+        }
+    }
+
+    return DXGI_FORMAT_UNKNOWN;
+}
+
+
+//--------------------------------------------------------------------------------------
+DXGI_FORMAT DDSMakeSRGB( DXGI_FORMAT format )
+{
+    switch( format )
+    {
+    case DXGI_FORMAT_R8G8B8A8_UNORM:
+        return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+
+    case DXGI_FORMAT_BC1_UNORM:
+        return DXGI_FORMAT_BC1_UNORM_SRGB;
+
+    case DXGI_FORMAT_BC2_UNORM:
+        return DXGI_FORMAT_BC2_UNORM_SRGB;
+
+    case DXGI_FORMAT_BC3_UNORM:
+        return DXGI_FORMAT_BC3_UNORM_SRGB;
+
+    case DXGI_FORMAT_B8G8R8A8_UNORM:
+        return DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+
+    case DXGI_FORMAT_B8G8R8X8_UNORM:
+        return DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+
+    case DXGI_FORMAT_BC7_UNORM:
+        return DXGI_FORMAT_BC7_UNORM_SRGB;
+
+    default:
+        return format;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+uint32_t DDSGetAlphaMode( const DDS_HEADER* header )
+{
+    if ( header->ddspf.flags & DDS_FOURCC )
+    {
+        if ( MAKEFOURCC( 'D', 'X', '1', '0' ) == header->ddspf.fourCC )
+        {
+            auto d3d10ext = reinterpret_cast<const DDS_HEADER_DXT10*>( (const char*)header + sizeof(DDS_HEADER) );
+            uint32_t mode = d3d10ext->miscFlags2 & DDS_MISC_FLAGS2_ALPHA_MODE_MASK;
+            switch( mode )
+            {
+            case 1: // DDS_ALPHA_MODE_STRAIGHT
+            case 2: // DDS_ALPHA_MODE_PREMULTIPLIED
+            case 3: // DDS_ALPHA_MODE_OPAQUE
+            case 4: // DDS_ALPHA_MODE_CUSTOM
+                return mode;
+            }
+        }
+        else if ( ( MAKEFOURCC( 'D', 'X', 'T', '2' ) == header->ddspf.fourCC )
+                  || ( MAKEFOURCC( 'D', 'X', 'T', '4' ) == header->ddspf.fourCC ) )
+        {
+            return 2; // DDS_ALPHA_MODE_PREMULTIPLIED
+        }
+    }
+
+    return 0; // DDS_ALPHA_MODE_UNKNOWN
+}
+
+
+//--------------------------------------------------------------------------------------
+// DDSFile
+//--------------------------------------------------------------------------------------
+DDSFile::Status DDSFile::Open(const std::string& filename)
+{
+	Close();
+
+	if(!mFile.Open(filename))
+		return Status::OpenFailed;
+
+	return ParseData(mFile.Data(), mFile.Size());
+}
+
+#ifdef _WIN32
+DDSFile::Status DDSFile::Open(const std::wstring& filename)
+{
+	Close();
+
+	if(!mFile.Open(filename))
+		return Status::OpenFailed;
+
+	return ParseData(mFile.Data(), mFile.Size());
+}
+#endif
+
+DDSFile::Status DDSFile::Parse(const void* data, std::uint64_t size)
+{
+	Close();
+
+	return ParseData((const std::uint8_t*)data, size);
+}
+
+void DDSFile::Close()
+{
+	mFile.Close();
+
+	mData = nullptr;
+	mHeader = nullptr;
+	mBitOffset = 0;
+	mDataSize = 0;
+	mSize = 0;
+	mDesc = Desc();
+	mSubresources.clear();
+}
+
+DDSFile::Status DDSFile::ParseData(const std::uint8_t* data, std::uint64_t size)
+{
+	mData = data;
+	mSize = size;
+
+	Status status = ParseHeader(size);
+	if(status == Status::Ok)
+		status = BuildSubresources(size);
+
+	if(status != Status::Ok)
+	{
+		mHeader = nullptr;
+		mSize = 0;
+		mDesc = Desc();
+		mSubresources.clear();
+	}
+
+	return status;
+}
+
+DDSFile::Status DDSFile::ParseHeader(std::uint64_t size)
+{
+	// Need at least enough data to fill the header and magic number to be a valid DDS
+	if(mData == nullptr || size < sizeof(uint32_t) + sizeof(DDS_HEADER))
+		return Status::InvalidData;
+
+	// DDS files always start with the same magic number ("DDS ")
+	uint32_t magic;
+	std::copy(mData, mData + sizeof(magic), (std::uint8_t*)&magic);
+	if(magic != DDS_MAGIC)
+		return Status::InvalidData;
+
+	auto header = reinterpret_cast<const DDS_HEADER*>(mData + sizeof(uint32_t));
+	if(header->size != sizeof(DDS_HEADER) ||
+		header->ddspf.size != sizeof(DDS_PIXELFORMAT))
+	{
+		return Status::InvalidData;
+	}
+
+	const DDS_HEADER_DXT10* d3d10ext = nullptr;
+	if((header->ddspf.flags & DDS_FOURCC) && MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC)
+	{
+		// Must be long enough for both headers and magic value
+		if(size < sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10))
+			return Status::InvalidData;
+
+		d3d10ext = reinterpret_cast<const DDS_HEADER_DXT10*>((const std::uint8_t*)header + sizeof(DDS_HEADER));
+	}
+
+	mHeader = header;
+	mBitOffset = sizeof(uint32_t) + sizeof(DDS_HEADER) + (d3d10ext != nullptr ? sizeof(DDS_HEADER_DXT10) : 0);
+
+	Desc& desc = mDesc;
+	desc.Width = header->width;
+	desc.Height = header->height;
+	desc.Depth = header->depth;
+	desc.MipLevels = std::max<uint32_t>(header->mipMapCount, 1);
+	desc.ArraySize = 1;
+	desc.AlphaMode = DDSGetAlphaMode(header);
+
+	if(desc.Width == 0)
+		return Status::InvalidData;
+
+	if(d3d10ext != nullptr)
+	{
+		desc.ArraySize = d3d10ext->arraySize;
+		if(desc.ArraySize == 0)
+			return Status::InvalidData;
+
+		switch(d3d10ext->dxgiFormat)
+		{
+		case DXGI_FORMAT_AI44:
+		case DXGI_FORMAT_IA44:
+		case DXGI_FORMAT_P8:
+		case DXGI_FORMAT_A8P8:
+			return Status::NotSupported;
+
+		default:
+			if(DDSBitsPerPixel(d3d10ext->dxgiFormat) == 0)
+				return Status::NotSupported;
+		}
+
+		desc.Format = d3d10ext->dxgiFormat;
+
+		switch((TextureDimension)d3d10ext->resourceDimension)
+		{
+		case TextureDimension::Texture1D:
+			if((header->flags & DDS_HEIGHT) && desc.Height != 1)
+				return Status::InvalidData;
+			desc.Height = desc.Depth = 1;
+			break;
+
+		case TextureDimension::Texture2D:
+			if(d3d10ext->miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE)
+			{
+				desc.ArraySize *= 6;
+				desc.IsCubeMap = true;
+			}
+			desc.Depth = 1;
+			break;
+
+		case TextureDimension::Texture3D:
+			if(!(header->flags & DDS_HEADER_FLAGS_VOLUME))
+				return Status::InvalidData;
+			if(desc.ArraySize > 1)
+				return Status::NotSupported;
+			break;
+
+		default:
+			return Status::NotSupported;
+		}
+
+		desc.Dimension = (TextureDimension)d3d10ext->resourceDimension;
+	}
+	else
+	{
+		desc.Format = DDSGetDXGIFormat(header->ddspf);
+		if(desc.Format == DXGI_FORMAT_UNKNOWN)
+			return Status::NotSupported;
+
+		if(header->flags & DDS_HEADER_FLAGS_VOLUME)
+		{
+			desc.Dimension = TextureDimension::Texture3D;
+		}
+		else
+		{
+			if(header->caps2 & DDS_CUBEMAP)
+			{
+				// We require all six faces to be defined
+				if((header->caps2 & DDS_CUBEMAP_ALLFACES) != DDS_CUBEMAP_ALLFACES)
+					return Status::NotSupported;
+
+				desc.ArraySize = 6;
+				desc.IsCubeMap = true;
+			}
+
+			desc.Depth = 1;
+			desc.Dimension = TextureDimension::Texture2D;
+		}
+	}
+
+	if(desc.Height == 0 || desc.Depth == 0)
+		return Status::InvalidData;
+
+	// Bound sizes (for security purposes we don't trust DDS file metadata larger than the hardware requirements)
+	if(desc.MipLevels > MaxMipLevels)
+		return Status::NotSupported;
+
+	switch(desc.Dimension)
+	{
+	case TextureDimension::Texture1D:
+		if(desc.ArraySize > MaxTexture1DArraySize || desc.Width > MaxTexture1DWidth)
+			return Status::NotSupported;
+		break;
+
+	case TextureDimension::Texture2D:
+		if(desc.IsCubeMap)
+		{
+			// This is the right bound because ArraySize is NumCubes*6
+			if(desc.ArraySize > MaxTexture2DArraySize ||
+				desc.Width > MaxTextureCubeSize || desc.Height > MaxTextureCubeSize)
+			{
+				return Status::NotSupported;
+			}
+		}
+		else if(desc.ArraySize > MaxTexture2DArraySize ||
+			desc.Width > MaxTexture2DSize || desc.Height > MaxTexture2DSize)
+		{
+			return Status::NotSupported;
+		}
+		break;
+
+	case TextureDimension::Texture3D:
+		if(desc.ArraySize > 1 ||
+			desc.Width > MaxTexture3DSize || desc.Height > MaxTexture3DSize || desc.Depth > MaxTexture3DSize)
+		{
+			return Status::NotSupported;
+		}
+		break;
+
+	default:
+		return Status::NotSupported;
+	}
+
+	return Status::Ok;
+}
+
+DDSFile::Status DDSFile::BuildSubresources(std::uint64_t size)
+{
+	const std::uint64_t bitSize = size - mBitOffset;
+
+	mSubresources.resize((size_t)mDesc.MipLevels * mDesc.ArraySize);
+
+	// Array slices one after another, each with its full mip chain.
+	std::uint64_t offset = 0;
+	size_t index = 0;
+	for(uint32_t j = 0; j < mDesc.ArraySize; ++j)
+	{
+		uint32_t w = mDesc.Width;
+		uint32_t h = mDesc.Height;
+		uint32_t d = mDesc.Depth;
+		for(uint32_t i = 0; i < mDesc.MipLevels; ++i)
+		{
+			size_t numBytes = 0;
+			size_t rowBytes = 0;
+			size_t numRows = 0;
+			DDSGetSurfaceInfo(w, h, mDesc.Format, &numBytes, &rowBytes, &numRows);
+
+			std::uint64_t bytes = (std::uint64_t)numBytes * d;
+			if(bytes > bitSize - offset)
+				return Status::Truncated;
+
+			Subresource& s = mSubresources[index++];
+			s.Data = mData + mBitOffset + offset;
+			s.Offset = mBitOffset + offset;
+			s.Width = w;
+			s.Height = h;
+			s.Depth = d;
+			s.RowPitch = rowBytes;
+			s.SlicePitch = numBytes;
+			s.RowCount = (uint32_t)numRows;
+
+			offset += bytes;
+
+			w = std::max<uint32_t>(w >> 1, 1);
+			h = std::max<uint32_t>(h >> 1, 1);
+			d = std::max<uint32_t>(d >> 1, 1);
+		}
+	}
+
+	mDataSize = offset;
+
+	return Status::Ok;
+}
+
+bool DDSFile::WriteHeader(std::ostream& out, const Desc& desc, const std::uint32_t* reserved1)
+{
+	size_t numBytes = 0;
+	size_t rowBytes = 0;
+	size_t numRows = 0;
+	DDSGetSurfaceInfo(desc.Width, desc.Height, desc.Format, &numBytes, &rowBytes, &numRows);
+	bool blockCompressed = numRows != desc.Height;
+
+	DDS_HEADER header = {};
+	header.size = sizeof(DDS_HEADER);
+	header.flags = DDSD_CAPS | DDS_HEIGHT | DDS_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT |
+		(blockCompressed ? DDSD_LINEARSIZE : DDSD_PITCH);
+	header.height = desc.Height;
+	header.width = desc.Width;
+	header.pitchOrLinearSize = (uint32_t)(blockCompressed ? numBytes : rowBytes);
+	header.depth = desc.Depth;
+	header.mipMapCount = desc.MipLevels;
+	if(reserved1 != nullptr)
+		std::copy(reserved1, reserved1 + 11, header.reserved1);
+	header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+	header.ddspf.flags = DDS_FOURCC;
+	header.ddspf.fourCC = MAKEFOURCC('D', 'X', '1', '0');
+	header.caps = DDSCAPS_TEXTURE;
+	if(desc.MipLevels > 1)
+		header.caps |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+
+	DDS_HEADER_DXT10 d3d10ext = {};
+	d3d10ext.dxgiFormat = desc.Format;
+	d3d10ext.resourceDimension = (uint32_t)desc.Dimension;
+	d3d10ext.arraySize = desc.ArraySize;
+	d3d10ext.miscFlags2 = desc.AlphaMode & DDS_MISC_FLAGS2_ALPHA_MODE_MASK;
+
+	if(desc.Dimension == TextureDimension::Texture3D)
+	{
+		header.flags |= DDS_HEADER_FLAGS_VOLUME;
+	}
+	else if(desc.IsCubeMap)
+	{
+		// The DX10 header counts cubes, not faces.
+		header.caps |= DDSCAPS_COMPLEX;
+		header.caps2 = DDS_CUBEMAP_ALLFACES;
+		d3d10ext.miscFlag = DDS_RESOURCE_MISC_TEXTURECUBE;
+		d3d10ext.arraySize = desc.ArraySize / 6;
+	}
+
+	if(desc.ArraySize > 1)
+		header.caps |= DDSCAPS_COMPLEX;
+
+	out.write((const char*)&DDS_MAGIC, sizeof(DDS_MAGIC));
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)&d3d10ext, sizeof(d3d10ext));
+
+	return out.good();
+}
+
+const char* DDSFile::StatusToString(Status status)
+{
+	switch(status)
+	{
+	case Status::Ok:           return "Ok";
+	case Status::OpenFailed:   return "OpenFailed";
+	case Status::InvalidData:  return "InvalidData";
+	case Status::NotSupported: return "NotSupported";
+	case Status::Truncated:    return "Truncated";
+	}
+
+	return "Unknown";
+}
@@ -0,0 +1,239 @@
+//***************************************************************************************
+// DDSFile.h by DanielDFY
+//
+// Reads a DDS file without a device: validates the header and lays out every
+// subresource (mip level, array slice, cube face) with its offset, row pitch
+// and slice pitch.  Subresource data points into the memory-mapped file, so
+// nothing is copied until the texture is uploaded.
+//
+// The file format structures and the format helpers used to live privately
+// in DDSTextureLoader.cpp; the D3D12 loader now goes through this class.
+//***************************************************************************************
+
+#pragma once
+
+#include "DXGIFormat.h"
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//--------------------------------------------------------------------------------------
+// DDS file structure definitions
+//
+// See DDS.h in the 'Texconv' sample and the 'DirectXTex' library
+//--------------------------------------------------------------------------------------
+#ifndef MAKEFOURCC
+    #define MAKEFOURCC(ch0, ch1, ch2, ch3)                              \
+                ((uint32_t)(uint8_t)(ch0) | ((uint32_t)(uint8_t)(ch1) << 8) |       \
+                ((uint32_t)(uint8_t)(ch2) << 16) | ((uint32_t)(uint8_t)(ch3) << 24 ))
+#endif /* defined(MAKEFOURCC) */
+
+#pragma pack(push,1)
+
+const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+struct DDS_PIXELFORMAT
+{
+    uint32_t    size;
+    uint32_t    flags;
+    uint32_t    fourCC;
+    uint32_t    RGBBitCount;
+    uint32_t    RBitMask;
+    uint32_t    GBitMask;
+    uint32_t    BBitMask;
+    uint32_t    ABitMask;
+};
+
+#define DDS_FOURCC      0x00000004  // DDPF_FOURCC
+#define DDS_RGB         0x00000040  // DDPF_RGB
+#define DDS_LUMINANCE   0x00020000  // DDPF_LUMINANCE
+#define DDS_ALPHA       0x00000002  // DDPF_ALPHA
+
+#define DDS_HEADER_FLAGS_VOLUME         0x00800000  // DDSD_DEPTH
+
+#define DDS_HEIGHT 0x00000002 // DDSD_HEIGHT
+#define DDS_WIDTH  0x00000004 // DDSD_WIDTH
+
+#define DDS_CUBEMAP_POSITIVEX 0x00000600 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEX
+#define DDS_CUBEMAP_NEGATIVEX 0x00000a00 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEX
+#define DDS_CUBEMAP_POSITIVEY 0x00001200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEY
+#define DDS_CUBEMAP_NEGATIVEY 0x00002200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEY
+#define DDS_CUBEMAP_POSITIVEZ 0x00004200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEZ
+#define DDS_CUBEMAP_NEGATIVEZ 0x00008200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEZ
+
+#define DDS_CUBEMAP_ALLFACES ( DDS_CUBEMAP_POSITIVEX | DDS_CUBEMAP_NEGATIVEX |\
+                               DDS_CUBEMAP_POSITIVEY | DDS_CUBEMAP_NEGATIVEY |\
+                               DDS_CUBEMAP_POSITIVEZ | DDS_CUBEMAP_NEGATIVEZ )
+
+#define DDS_CUBEMAP 0x00000200 // DDSCAPS2_CUBEMAP
+
+// D3D11_RESOURCE_MISC_TEXTURECUBE in the DX10 header's miscFlag.
+#define DDS_RESOURCE_MISC_TEXTURECUBE 0x4
+
+enum DDS_MISC_FLAGS2
+{
+    DDS_MISC_FLAGS2_ALPHA_MODE_MASK = 0x7L,
+};
+
+struct DDS_HEADER
+{
+    uint32_t        size;
+    uint32_t        flags;
+    uint32_t        height;
+    uint32_t        width;
+    uint32_t        pitchOrLinearSize;
+    uint32_t        depth; // only if DDS_HEADER_FLAGS_VOLUME is set in flags
+    uint32_t        mipMapCount;
+    uint32_t        reserved1[11];
+    DDS_PIXELFORMAT ddspf;
+    uint32_t        caps;
+    uint32_t        caps2;
+    uint32_t        caps3;
+    uint32_t        caps4;
+    uint32_t        reserved2;
+};
+
+struct DDS_HEADER_DXT10
+{
+    DXGI_FORMAT     dxgiFormat;
+    uint32_t        resourceDimension;
+    uint32_t        miscFlag; // see D3D11_RESOURCE_MISC_FLAG
+    uint32_t        arraySize;
+    uint32_t        miscFlags2;
+};
+
+#pragma pack(pop)
+
+//--------------------------------------------------------------------------------------
+// Format helpers
+//--------------------------------------------------------------------------------------
+
+// Bits per pixel (per texel for block compressed formats); 0 if unknown.
+size_t DDSBitsPerPixel(DXGI_FORMAT fmt);
+
+// Bytes of one 2D surface, bytes of one row (of blocks for BC formats) and
+// number of rows.
+void DDSGetSurfaceInfo(size_t width, size_t height, DXGI_FORMAT fmt,
+    size_t* outNumBytes, size_t* outRowBytes, size_t* outNumRows);
+
+// Format of a legacy (non DX10) pixel format; DXGI_FORMAT_UNKNOWN if none matches.
+DXGI_FORMAT DDSGetDXGIFormat(const DDS_PIXELFORMAT& ddpf);
+
+DXGI_FORMAT DDSMakeSRGB(DXGI_FORMAT format);
+
+// DDS_ALPHA_MODE value of a header followed by its optional DX10 header.
+uint32_t DDSGetAlphaMode(const DDS_HEADER* header);
+
+//--------------------------------------------------------------------------------------
+// DDSFile
+//--------------------------------------------------------------------------------------
+class DDSFile
+{
+public:
+	enum class Status
+	{
+		Ok,
+		OpenFailed,    // see SystemError()
+		InvalidData,   // not a DDS file, or inconsistent header
+		NotSupported,  // valid DDS, but a format or size the loader does not handle
+		Truncated      // the file ends before the last subresource
+	};
+
+	// Same values as D3D12_RESOURCE_DIMENSION.
+	enum class TextureDimension : std::uint32_t
+	{
+		Unknown = 0,
+		Texture1D = 2,
+		Texture2D = 3,
+		Texture3D = 4
+	};
+
+	struct Desc
+	{
+		TextureDimension Dimension = TextureDimension::Unknown;
+		DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+		std::uint32_t Width = 0;
+		std::uint32_t Height = 0;
+		std::uint32_t Depth = 0;
+		std::uint32_t MipLevels = 0;
+
+		// Includes the six faces of each cube.
+		std::uint32_t ArraySize = 0;
+		bool IsCubeMap = false;
+
+		// DDS_ALPHA_MODE value.
+		std::uint32_t AlphaMode = 0;
+	};
+
+	struct Subresource
+	{
+		// Into the file data; Depth slices of SlicePitch bytes each.
+		const std::uint8_t* Data = nullptr;
+		std::uint64_t Offset = 0;
+
+		std::uint32_t Width = 0;
+		std::uint32_t Height = 0;
+		std::uint32_t Depth = 0;
+		std::uint64_t RowPitch = 0;
+		std::uint64_t SlicePitch = 0;
+		std::uint32_t RowCount = 0;
+	};
+
+	// Maps the file and parses it.  The subresources stay valid until the
+	// next Open/Parse or Close.
+	Status Open(const std::string& filename);
+#ifdef _WIN32
+	Status Open(const std::wstring& filename);
+#endif
+
+	// Parses a DDS file already in memory; the caller keeps data alive.
+	Status Parse(const void* data, std::uint64_t size);
+
+	void Close();
+
+	const Desc& GetDesc()const { return mDesc; }
+	const DDS_HEADER* Header()const { return mHeader; }
+
+	// In D3D12 subresource order: mip + arraySlice * MipLevels.
+	const std::vector<Subresource>& Subresources()const { return mSubresources; }
+	const Subresource& GetSubresource(std::uint32_t mip, std::uint32_t arraySlice)const
+	{
+		return mSubresources[mip + arraySlice * mDesc.MipLevels];
+	}
+
+	// Bytes of pixel data the subresources cover.
+	std::uint64_t DataSize()const { return mDataSize; }
+
+	// Bytes of the whole file, or of the data given to Parse.
+	std::uint64_t Size()const { return mSize; }
+
+	int SystemError()const { return mFile.SystemError(); }
+
+	// Writes the magic number, DDS_HEADER and DX10 header of a texture
+	// described by desc; the caller appends the subresources in
+	// Subresources() order.  reserved1, if given, fills the 11 reserved words
+	// of the header, which the loaders ignore.
+	static bool WriteHeader(std::ostream& out, const Desc& desc, const std::uint32_t* reserved1 = nullptr);
+
+	static const char* StatusToString(Status status);
+
+private:
+	Status ParseData(const std::uint8_t* data, std::uint64_t size);
+	Status ParseHeader(std::uint64_t size);
+	Status BuildSubresources(std::uint64_t size);
+
+private:
+	MappedFile mFile;
+
+	const std::uint8_t* mData = nullptr;
+	const DDS_HEADER* mHeader = nullptr;
+	std::uint64_t mBitOffset = 0;
+	std::uint64_t mDataSize = 0;
+	std::uint64_t mSize = 0;
+
+	Desc mDesc;
+	std::vector<Subresource> mSubresources;
+};
@@ -0,0 +1,108 @@
+//***************************************************************************************
+// DescriptorAllocator.cpp by DanielDFY
+//***************************************************************************************
+
+#include "DescriptorAllocator.h"
+#include <cassert>
+#include <iterator>
+
+DescriptorAllocator::DescriptorAllocator(std::uint32_t capacity)
+{
+	Reset(capacity);
+}
+
+void DescriptorAllocator::Reset(std::uint32_t capacity)
+{
+	mCapacity = capacity;
+	mAllocated = 0;
+	mFreeByOffset.clear();
+	mFreeBySize.clear();
+	mStats = Stats();
+
+	if(capacity > 0)
+		InsertFree(0, capacity);
+}
+
+std::uint32_t DescriptorAllocator::Allocate(std::uint32_t count)
+{
+	assert(count > 0);
+
+	// Smallest free range that fits keeps large ranges intact for large requests;
+	// among equal sizes the lowest index wins.
+	auto sizeIt = mFreeBySize.lower_bound(std::make_pair(count, 0u));
+	if(sizeIt == mFreeBySize.end())
+	{
+		mStats.FailedAllocations++;
+		return InvalidOffset;
+	}
+
+	std::uint32_t offset = sizeIt->second;
+	std::uint32_t size = sizeIt->first;
+
+	EraseFree(mFreeByOffset.find(offset));
+	if(size > count)
+		InsertFree(offset + count, size - count);
+
+	mAllocated += count;
+	mStats.Allocations++;
+	if(mAllocated > mStats.PeakAllocatedCount)
+		mStats.PeakAllocatedCount = mAllocated;
+
+	return offset;
+}
+
+void DescriptorAllocator::Free(std::uint32_t offset, std::uint32_t count)
+{
+	assert(count > 0 && offset + count <= mCapacity);
+	assert(count <= mAllocated);
+
+	std::uint32_t begin = offset;
+	std::uint32_t end = offset + count;
+
+	// Merge with the free range that follows...
+	auto next = mFreeByOffset.lower_bound(offset);
+	assert(next == mFreeByOffset.end() || next->first >= end);
+	if(next != mFreeByOffset.end() && next->first == end)
+	{
+		end += next->second;
+		auto merged = next++;
+		EraseFree(merged);
+	}
+
+	// ...and with the one that precedes it.
+	if(next != mFreeByOffset.begin())
+	{
+		auto prev = std::prev(next);
+		assert(prev->first + prev->second <= begin);
+		if(prev->first + prev->second == begin)
+		{
+			begin = prev->first;
+			EraseFree(prev);
+		}
+	}
+
+	InsertFree(begin, end - begin);
+
+	mAllocated -= count;
+	mStats.Frees++;
+}
+
+void DescriptorAllocator::InsertFree(std::uint32_t offset, std::uint32_t count)
+{
+	mFreeByOffset.emplace(offset, count);
+	mFreeBySize.emplace(count, offset);
+}
+
+void DescriptorAllocator::EraseFree(std::map<std::uint32_t, std::uint32_t>::iterator it)
+{
+	mFreeBySize.erase(std::make_pair(it->second, it->first));
+	mFreeByOffset.erase(it);
+}
+
+const DescriptorAllocator::Stats& DescriptorAllocator::GetStats()const
+{
+	mStats.AllocatedCount = mAllocated;
+	mStats.FreeRanges = (std::uint32_t)mFreeByOffset.size();
+	mStats.LargestFreeRange = mFreeBySize.empty() ? 0 : mFreeBySize.rbegin()->first;
+	return mStats;
+}
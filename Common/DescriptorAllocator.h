@@ -0,0 +1,68 @@
+//***************************************************************************************
+// DescriptorAllocator.h by DanielDFY
+//
+// Bookkeeping for the persistent part of a descriptor heap: contiguous ranges of
+// descriptors are handed out best fit from a free list and coalesced with their
+// neighbours when freed, so a heap can recycle space instead of being laid out
+// by hand once.  Per-frame transient ranges use RingAllocator instead.
+//
+// The class only deals with indices, so it can be used and tested without D3D;
+// DescriptorHeap.h turns the indices into descriptor handles.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+
+class DescriptorAllocator
+{
+public:
+	static const std::uint32_t InvalidOffset = ~0u;
+
+	struct Stats
+	{
+		std::uint32_t AllocatedCount = 0;
+		std::uint32_t PeakAllocatedCount = 0;
+		std::uint32_t FreeRanges = 0;
+		std::uint32_t LargestFreeRange = 0;
+
+		std::uint32_t Allocations = 0;
+		std::uint32_t Frees = 0;
+		std::uint32_t FailedAllocations = 0;
+	};
+
+	explicit DescriptorAllocator(std::uint32_t capacity = 0);
+
+	void Reset(std::uint32_t capacity);
+
+	// Returns the first index of count contiguous descriptors, or InvalidOffset
+	// if no free range is large enough.
+	std::uint32_t Allocate(std::uint32_t count);
+
+	// Returns a range obtained from Allocate.
+	void Free(std::uint32_t offset, std::uint32_t count);
+
+	std::uint32_t Capacity()const { return mCapacity; }
+	std::uint32_t AllocatedCount()const { return mAllocated; }
+	std::uint32_t FreeCount()const { return mCapacity - mAllocated; }
+
+	const Stats& GetStats()const;
+
+private:
+	void InsertFree(std::uint32_t offset, std::uint32_t count);
+	void EraseFree(std::map<std::uint32_t, std::uint32_t>::iterator it);
+
+private:
+	std::uint32_t mCapacity = 0;
+	std::uint32_t mAllocated = 0;
+
+	// Free ranges by first index (for coalescing) and by (size, first index)
+	// (for best fit, and so a range can be found again without a scan).
+	std::map<std::uint32_t, std::uint32_t> mFreeByOffset;
+	std::set<std::pair<std::uint32_t, std::uint32_t>> mFreeBySize;
+
+	mutable Stats mStats;
+};
@@ -0,0 +1,154 @@
+//***************************************************************************************
+// DescriptorHeap.h by DanielDFY
+//
+// A descriptor heap split into a persistent region, managed with a free list
+// (DescriptorAllocator), and a transient region for views that only live for
+// one frame, managed with a RingAllocator and reclaimed by fence.  Allocations
+// are returned as DescriptorRange, which keeps its heap handles, so callers no
+// longer compute offsets by hand.  The heap never moves, so handles stay valid
+// until the range is freed (or, for transient ranges, until the frame retires).
+//
+// Transient usage per frame:
+//   Retire(fence->GetCompletedValue())  after waiting for the frame resource
+//   AllocateTransient                   while building the frame
+//   FinishFrame(fenceValue)             after signaling the frame's fence
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "DescriptorAllocator.h"
+#include "RingAllocator.h"
+
+struct DescriptorRange
+{
+	D3D12_CPU_DESCRIPTOR_HANDLE CpuStart = {};
+	D3D12_GPU_DESCRIPTOR_HANDLE GpuStart = {};
+	UINT Offset = 0;
+	UINT Count = 0;
+	UINT DescriptorSize = 0;
+
+	// Handle of the index-th descriptor of the range.
+	CD3DX12_CPU_DESCRIPTOR_HANDLE Cpu(UINT index = 0)const
+	{
+		assert(index < Count);
+		return CD3DX12_CPU_DESCRIPTOR_HANDLE(CpuStart, index, DescriptorSize);
+	}
+
+	// Only valid for shader visible heaps.
+	CD3DX12_GPU_DESCRIPTOR_HANDLE Gpu(UINT index = 0)const
+	{
+		assert(index < Count && GpuStart.ptr != 0);
+		return CD3DX12_GPU_DESCRIPTOR_HANDLE(GpuStart, index, DescriptorSize);
+	}
+};
+
+class DescriptorHeap
+{
+public:
+	// The first persistentCount descriptors are persistent, the following
+	// transientCount are transient.  Only CBV_SRV_UAV and sampler heaps can be
+	// shader visible.
+	DescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type,
+		UINT persistentCount, UINT transientCount, bool shaderVisible) :
+		mPersistent(persistentCount),
+		mTransient(transientCount),
+		mPersistentCount(persistentCount)
+	{
+		D3D12_DESCRIPTOR_HEAP_DESC heapDesc;
+		heapDesc.NumDescriptors = persistentCount + transientCount;
+		heapDesc.Type = type;
+		heapDesc.Flags = shaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+		heapDesc.NodeMask = 0;
+		ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mHeap)));
+
+		mDescriptorSize = device->GetDescriptorHandleIncrementSize(type);
+		mCpuStart = mHeap->GetCPUDescriptorHandleForHeapStart();
+		if(shaderVisible)
+			mGpuStart = mHeap->GetGPUDescriptorHandleForHeapStart();
+	}
+
+	DescriptorHeap(const DescriptorHeap& rhs) = delete;
+	DescriptorHeap& operator=(const DescriptorHeap& rhs) = delete;
+
+	ID3D12DescriptorHeap* Heap()const
+	{
+		return mHeap.Get();
+	}
+
+	UINT DescriptorSize()const
+	{
+		return mDescriptorSize;
+	}
+
+	const DescriptorAllocator& PersistentAllocator()const
+	{
+		return mPersistent;
+	}
+
+	const RingAllocator& TransientAllocator()const
+	{
+		return mTransient;
+	}
+
+	// Throws E_OUTOFMEMORY if no free range of count descriptors is left.
+	DescriptorRange Allocate(UINT count)
+	{
+		UINT offset = mPersistent.Allocate(count);
+		if(offset == DescriptorAllocator::InvalidOffset)
+			ThrowIfFailed(E_OUTOFMEMORY);
+
+		return MakeRange(offset, count);
+	}
+
+	// The GPU must be done with the descriptors; free after a fence wait.
+	void Free(const DescriptorRange& range)
+	{
+		assert(range.Offset + range.Count <= mPersistentCount);
+		mPersistent.Free(range.Offset, range.Count);
+	}
+
+	// Throws E_OUTOFMEMORY if the frames in flight still use the space; size the
+	// transient region for gNumFrameResources frames of the worst case.
+	DescriptorRange AllocateTransient(UINT count)
+	{
+		UINT64 offset = mTransient.Allocate(count, 1);
+		if(offset == RingAllocator::InvalidOffset)
+			ThrowIfFailed(E_OUTOFMEMORY);
+
+		return MakeRange(mPersistentCount + (UINT)offset, count);
+	}
+
+	void FinishFrame(UINT64 fenceValue)
+	{
+		mTransient.FinishFrame(fenceValue);
+	}
+
+	void Retire(UINT64 completedFenceValue)
+	{
+		mTransient.Retire(completedFenceValue);
+	}
+
+private:
+	DescriptorRange MakeRange(UINT offset, UINT count)const
+	{
+		DescriptorRange range;
+		range.CpuStart = CD3DX12_CPU_DESCRIPTOR_HANDLE(mCpuStart, offset, mDescriptorSize);
+		if(mGpuStart.ptr != 0)
+			range.GpuStart = CD3DX12_GPU_DESCRIPTOR_HANDLE(mGpuStart, offset, mDescriptorSize);
+		range.Offset = offset;
+		range.Count = count;
+		range.DescriptorSize = mDescriptorSize;
+		return range;
+	}
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mHeap;
+	D3D12_CPU_DESCRIPTOR_HANDLE mCpuStart = {};
+	D3D12_GPU_DESCRIPTOR_HANDLE mGpuStart = {};
+	UINT mDescriptorSize = 0;
+
+	DescriptorAllocator mPersistent;
+	RingAllocator mTransient;
+	UINT mPersistentCount = 0;
+};
@@ -0,0 +1,103 @@
+//***************************************************************************************
+// DirtyTracker.cpp by DanielDFY
+//***************************************************************************************
+
+#include "DirtyTracker.h"
+#include <cassert>
+
+DirtyTracker::DirtyTracker(std::uint32_t frameCount, std::uint32_t count)
+	: mFrames(frameCount)
+{
+	assert(frameCount > 0);
+	Resize(count);
+}
+
+void DirtyTracker::Resize(std::uint32_t count)
+{
+	std::uint32_t oldCount = mCount;
+	std::uint32_t wordCount = (count + 63) / 64;
+	std::uint32_t summaryCount = (wordCount + 63) / 64;
+
+	for(FrameBits& frame : mFrames)
+	{
+		// Drop bits past the new end so DirtyCount stays exact when shrinking.
+		if(count < oldCount)
+		{
+			for(std::uint32_t i = count; i < oldCount; ++i)
+			{
+				std::uint64_t& word = frame.Bits[i / 64];
+				std::uint64_t mask = 1ull << (i % 64);
+				if(word & mask)
+				{
+					word &= ~mask;
+					frame.DirtyCount--;
+				}
+			}
+		}
+
+		frame.Bits.resize(wordCount, 0);
+		frame.Summary.resize(summaryCount, 0);
+
+		// Rebuild the summary; words may have been dropped.
+		for(std::uint32_t s = 0; s < summaryCount; ++s)
+			frame.Summary[s] = 0;
+		for(std::uint32_t w = 0; w < wordCount; ++w)
+		{
+			if(frame.Bits[w] != 0)
+				frame.Summary[w / 64] |= 1ull << (w % 64);
+		}
+	}
+
+	mCount = count;
+
+	for(std::uint32_t i = oldCount; i < count; ++i)
+		MarkDirty(i);
+}
+
+void DirtyTracker::SetBit(FrameBits& frame, std::uint32_t index)
+{
+	std::uint32_t w = index / 64;
+	std::uint64_t mask = 1ull << (index % 64);
+
+	if((frame.Bits[w] & mask) == 0)
+	{
+		frame.Bits[w] |= mask;
+		frame.Summary[w / 64] |= 1ull << (w % 64);
+		frame.DirtyCount++;
+	}
+}
+
+void DirtyTracker::MarkDirty(std::uint32_t index)
+{
+	assert(index < mCount);
+
+	for(FrameBits& frame : mFrames)
+		SetBit(frame, index);
+}
+
+void DirtyTracker::MarkAllDirty()
+{
+	std::uint32_t wordCount = (mCount + 63) / 64;
+
+	for(FrameBits& frame : mFrames)
+	{
+		for(std::uint32_t w = 0; w < wordCount; ++w)
+		{
+			std::uint32_t bitsInWord = (w + 1 == wordCount && mCount % 64 != 0) ? mCount % 64 : 64;
+			frame.Bits[w] = bitsInWord == 64 ? ~0ull : (1ull << bitsInWord) - 1;
+			frame.Summary[w / 64] |= 1ull << (w % 64);
+		}
+		frame.DirtyCount = mCount;
+	}
+}
+
+bool DirtyTracker::IsDirty(std::uint32_t frameIndex, std::uint32_t index)const
+{
+	assert(index < mCount);
+	return (mFrames[frameIndex].Bits[index / 64] >> (index % 64)) & 1;
+}
+
+std::uint32_t DirtyTracker::DirtyCount(std::uint32_t frameIndex)const
+{
+	return mFrames[frameIndex].DirtyCount;
+}
@@ -0,0 +1,107 @@
+//***************************************************************************************
+// DirtyTracker.h by DanielDFY
+//
+// Tracks which objects (render items, materials, ...) need their constant buffer
+// data copied into each frame resource, replacing per-object NumFramesDirty
+// counters that force UpdateObjectCBs/UpdateMaterialBuffer to visit every object
+// every frame.
+//
+// Each frame resource has a two level bitset: one bit per object, plus one
+// summary bit per 64-bit word of object bits.  MarkDirty sets the object's bit in
+// every frame resource, which is the same as NumFramesDirty = gNumFrameResources.
+// ConsumeDirty walks the summary words with bit scans and only touches words
+// that have dirty objects, so a frame costs O(changed objects + count/4096)
+// instead of O(count).
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+class DirtyTracker
+{
+public:
+	// frameCount is normally gNumFrameResources.
+	explicit DirtyTracker(std::uint32_t frameCount = 1, std::uint32_t count = 0);
+
+	// Grows or shrinks the number of tracked objects.  New objects start dirty
+	// in every frame resource, like a new RenderItem with NumFramesDirty = gNumFrameResources.
+	void Resize(std::uint32_t count);
+
+	// Queues the object for update in the next frameCount frames.
+	void MarkDirty(std::uint32_t index);
+	void MarkAllDirty();
+
+	// Calls fn(index) once for every object dirty in the given frame resource,
+	// in ascending index order, and clears them for that frame resource.
+	template<typename Fn>
+	void ConsumeDirty(std::uint32_t frameIndex, Fn&& fn);
+
+	bool IsDirty(std::uint32_t frameIndex, std::uint32_t index)const;
+
+	// Number of objects waiting to be updated in the given frame resource.
+	std::uint32_t DirtyCount(std::uint32_t frameIndex)const;
+
+	std::uint32_t Count()const { return mCount; }
+	std::uint32_t FrameCount()const { return (std::uint32_t)mFrames.size(); }
+
+private:
+	struct FrameBits
+	{
+		std::vector<std::uint64_t> Bits;
+		std::vector<std::uint64_t> Summary;
+		std::uint32_t DirtyCount = 0;
+	};
+
+	static std::uint32_t FirstBit(std::uint64_t word)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, word);
+		return (std::uint32_t)index;
+#else
+		return (std::uint32_t)__builtin_ctzll(word);
+#endif
+	}
+
+	void SetBit(FrameBits& frame, std::uint32_t index);
+
+private:
+	std::uint32_t mCount = 0;
+	std::vector<FrameBits> mFrames;
+};
+
+template<typename Fn>
+void DirtyTracker::ConsumeDirty(std::uint32_t frameIndex, Fn&& fn)
+{
+	FrameBits& frame = mFrames[frameIndex];
+	if(frame.DirtyCount == 0)
+		return;
+
+	for(std::uint32_t s = 0; s < (std::uint32_t)frame.Summary.size(); ++s)
+	{
+		std::uint64_t summary = frame.Summary[s];
+		while(summary != 0)
+		{
+			std::uint32_t w = s*64 + FirstBit(summary);
+			summary &= summary - 1;
+
+			std::uint64_t bits = frame.Bits[w];
+			frame.Bits[w] = 0;
+
+			while(bits != 0)
+			{
+				fn(w*64 + FirstBit(bits));
+				bits &= bits - 1;
+			}
+		}
+		frame.Summary[s] = 0;
+	}
+
+	frame.DirtyCount = 0;
+}
@@ -0,0 +1,188 @@
+//***************************************************************************************
+// DrawPacket.cpp by DanielDFY
+//***************************************************************************************
+
+#include "DrawPacket.h"
+#include <cassert>
+#include <chrono>
+
+namespace
+{
+	std::uint64_t Field(std::uint32_t value, std::uint32_t bits)
+	{
+		// Ids that do not fit (including NoBinding) share the largest value, which
+		// only affects sort quality, never correctness.
+		std::uint64_t maxValue = (1ull << bits) - 1;
+		return value < maxValue ? value : maxValue;
+	}
+}
+
+std::uint64_t DrawPacketQueue::MakeSortKey(
+	std::uint32_t layer, std::uint32_t pso, std::uint32_t geometry, std::uint32_t material,
+	float depth, bool backToFront)
+{
+	depth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+
+	const std::uint64_t maxDepth = (1ull << DepthBits) - 1;
+	std::uint64_t d = (std::uint64_t)(depth*(float)maxDepth);
+
+	std::uint64_t key = Field(layer, LayerBits);
+	if(backToFront)
+	{
+		key = (key << DepthBits) | (maxDepth - d);
+		key = (key << PsoBits) | Field(pso, PsoBits);
+		key = (key << GeometryBits) | Field(geometry, GeometryBits);
+		key = (key << MaterialBits) | Field(material, MaterialBits);
+	}
+	else
+	{
+		key = (key << PsoBits) | Field(pso, PsoBits);
+		key = (key << GeometryBits) | Field(geometry, GeometryBits);
+		key = (key << MaterialBits) | Field(material, MaterialBits);
+		key = (key << DepthBits) | d;
+	}
+
+	return key;
+}
+
+void DrawPacketQueue::Clear()
+{
+	mPackets.clear();
+}
+
+void DrawPacketQueue::Add(const DrawPacket& packet)
+{
+	mPackets.push_back(packet);
+}
+
+void DrawPacketQueue::Sort()
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	const std::uint32_t n = (std::uint32_t)mPackets.size();
+
+	mKeys.resize(n);
+	mKeysTemp.resize(n);
+	mOrder.resize(n);
+	mOrderTemp.resize(n);
+
+	std::uint64_t diff = 0;
+	for(std::uint32_t i = 0; i < n; ++i)
+	{
+		mKeys[i] = mPackets[i].SortKey;
+		mOrder[i] = i;
+		diff |= mKeys[i] ^ mKeys[0];
+	}
+
+	//
+	// LSD radix sort, 8 bits per pass.  Bytes in which all keys agree are
+	// skipped, so a frame with few distinct states only needs a few passes.
+	//
+
+	for(std::uint32_t shift = 0; shift < 64; shift += 8)
+	{
+		if(((diff >> shift) & 0xff) == 0)
+			continue;
+
+		std::uint32_t count[256] = {};
+		for(std::uint32_t i = 0; i < n; ++i)
+			count[(mKeys[i] >> shift) & 0xff]++;
+
+		std::uint32_t offset = 0;
+		for(std::uint32_t b = 0; b < 256; ++b)
+		{
+			std::uint32_t c = count[b];
+			count[b] = offset;
+			offset += c;
+		}
+
+		for(std::uint32_t i = 0; i < n; ++i)
+		{
+			std::uint32_t dst = count[(mKeys[i] >> shift) & 0xff]++;
+			mKeysTemp[dst] = mKeys[i];
+			mOrderTemp[dst] = mOrder[i];
+		}
+
+		mKeys.swap(mKeysTemp);
+		mOrder.swap(mOrderTemp);
+	}
+
+	mSorted.resize(n);
+	for(std::uint32_t i = 0; i < n; ++i)
+		mSorted[i] = mPackets[mOrder[i]];
+	mPackets.swap(mSorted);
+
+	auto d = std::chrono::high_resolution_clock::now() - startTime;
+	mSortMilliseconds = std::chrono::duration<float, std::milli>(d).count();
+}
+
+DrawPacketQueue::SubmitStats DrawPacketQueue::Submit(DrawPacketRecorder& recorder, bool filterRedundant)const
+{
+	return Submit(recorder, filterRedundant, 0, mPackets.size());
+}
+
+DrawPacketQueue::SubmitStats DrawPacketQueue::Submit(DrawPacketRecorder& recorder, bool filterRedundant,
+	size_t first, size_t count)const
+{
+	assert(first + count <= mPackets.size());
+
+	SubmitStats stats;
+	stats.Packets = (std::uint32_t)count;
+	stats.SortMilliseconds = mSortMilliseconds;
+
+	// Nothing is known to be bound at the start of the command list.
+	std::uint32_t pso = DrawPacket::NoBinding;
+	std::uint32_t geometry = DrawPacket::NoBinding;
+	std::uint32_t topology = DrawPacket::NoBinding;
+	std::uint32_t material = DrawPacket::NoBinding;
+	std::uint64_t objectCB = 0;
+	bool isFirst = true;
+
+	auto changed = [&](bool isDifferent)
+	{
+		if(!filterRedundant || isDifferent)
+		{
+			stats.StateChanges++;
+			return true;
+		}
+
+		stats.RedundantStateSkipped++;
+		return false;
+	};
+
+	for(size_t i = first; i < first + count; ++i)
+	{
+		const DrawPacket& p = mPackets[i];
+
+		if(p.Pso != DrawPacket::NoBinding && changed(p.Pso != pso))
+			recorder.SetPipelineState(p.Pso);
+
+		if(p.Geometry != DrawPacket::NoBinding && changed(p.Geometry != geometry))
+			recorder.SetGeometry(p.Geometry);
+
+		if(p.PrimitiveTopology != DrawPacket::NoBinding && changed(p.PrimitiveTopology != topology))
+			recorder.SetPrimitiveTopology(p.PrimitiveTopology);
+
+		if(p.Material != DrawPacket::NoBinding && changed(p.Material != material))
+			recorder.SetMaterial(p.Material);
+
+		if(changed(isFirst || p.ObjectCB != objectCB))
+			recorder.SetObjectCB(p.ObjectCB);
+
+		recorder.DrawIndexedInstanced(p);
+
+		// Packets without a binding leave the previous one bound.
+		if(p.Pso != DrawPacket::NoBinding)
+			pso = p.Pso;
+		if(p.Geometry != DrawPacket::NoBinding)
+			geometry = p.Geometry;
+		if(p.PrimitiveTopology != DrawPacket::NoBinding)
+			topology = p.PrimitiveTopology;
+		if(p.Material != DrawPacket::NoBinding)
+			material = p.Material;
+		objectCB = p.ObjectCB;
+		isFirst = false;
+	}
+
+	return stats;
+}
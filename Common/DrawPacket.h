@@ -0,0 +1,156 @@
+//***************************************************************************************
+// DrawPacket.h by DanielDFY
+//
+// Sort-key based draw submission.  Instead of walking mRitemLayer in whatever
+// order it was built and binding everything for every item, the app fills a
+// DrawPacketQueue with one packet per draw, each carrying a 64-bit sort key:
+//
+//   opaque layers  : | layer:4 | pso:10 | geometry:12 | material:14 | depth:24 |
+//   back to front  : | layer:4 | ~depth:24 | pso:10 | geometry:12 | material:14 |
+//
+// The queue radix sorts the keys and replays the packets through a
+// DrawPacketRecorder, skipping bindings that did not change since the previous
+// packet.  State is referred to by small integer ids (index into the app's PSO,
+// geometry and material tables), so the queue does not depend on Direct3D; the
+// app provides a recorder that turns the ids into command list calls.
+//
+// CountingDrawPacketRecorder records nothing and just counts calls, so the
+// reduction can be measured without a device.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct DrawPacket
+{
+	// Binding ids equal to NoBinding are never set, e.g. for apps that index
+	// materials from a structured buffer and have nothing to bind per material.
+	static const std::uint32_t NoBinding = 0xffffffff;
+
+	std::uint64_t SortKey = 0;
+
+	std::uint32_t Pso = NoBinding;
+	std::uint32_t Geometry = NoBinding;
+	std::uint32_t PrimitiveTopology = NoBinding;
+	std::uint32_t Material = NoBinding;
+
+	// Per draw constants (normally the object constant buffer address).  Always
+	// set unless it matches the previous packet.
+	std::uint64_t ObjectCB = 0;
+
+	std::uint32_t IndexCount = 0;
+	std::uint32_t InstanceCount = 1;
+	std::uint32_t StartIndexLocation = 0;
+	std::int32_t BaseVertexLocation = 0;
+	std::uint32_t StartInstanceLocation = 0;
+};
+
+// Receives the calls of DrawPacketQueue::Submit.
+class DrawPacketRecorder
+{
+public:
+	virtual ~DrawPacketRecorder() = default;
+
+	virtual void SetPipelineState(std::uint32_t pso) = 0;
+	virtual void SetGeometry(std::uint32_t geometry) = 0;
+	virtual void SetPrimitiveTopology(std::uint32_t topology) = 0;
+	virtual void SetMaterial(std::uint32_t material) = 0;
+	virtual void SetObjectCB(std::uint64_t objectCB) = 0;
+	virtual void DrawIndexedInstanced(const DrawPacket& packet) = 0;
+};
+
+// Counts every call it receives.  Useful headless, and to compare filtered
+// against unfiltered submission.
+class CountingDrawPacketRecorder : public DrawPacketRecorder
+{
+public:
+	struct Counts
+	{
+		std::uint32_t PipelineStates = 0;
+		std::uint32_t Geometries = 0;
+		std::uint32_t PrimitiveTopologies = 0;
+		std::uint32_t Materials = 0;
+		std::uint32_t ObjectCBs = 0;
+		std::uint32_t Draws = 0;
+
+		std::uint32_t Total()const
+		{
+			return PipelineStates + Geometries + PrimitiveTopologies + Materials + ObjectCBs + Draws;
+		}
+	};
+
+	virtual void SetPipelineState(std::uint32_t /*pso*/)override { mCounts.PipelineStates++; }
+	virtual void SetGeometry(std::uint32_t /*geometry*/)override { mCounts.Geometries++; }
+	virtual void SetPrimitiveTopology(std::uint32_t /*topology*/)override { mCounts.PrimitiveTopologies++; }
+	virtual void SetMaterial(std::uint32_t /*material*/)override { mCounts.Materials++; }
+	virtual void SetObjectCB(std::uint64_t /*objectCB*/)override { mCounts.ObjectCBs++; }
+	virtual void DrawIndexedInstanced(const DrawPacket& /*packet*/)override { mCounts.Draws++; }
+
+	const Counts& GetCounts()const { return mCounts; }
+	void Reset() { mCounts = Counts(); }
+
+private:
+	Counts mCounts;
+};
+
+class DrawPacketQueue
+{
+public:
+	static const std::uint32_t LayerBits = 4;
+	static const std::uint32_t PsoBits = 10;
+	static const std::uint32_t GeometryBits = 12;
+	static const std::uint32_t MaterialBits = 14;
+	static const std::uint32_t DepthBits = 24;
+
+	struct SubmitStats
+	{
+		std::uint32_t Packets = 0;
+
+		// Bindings actually issued and bindings skipped because they matched
+		// the previous packet.
+		std::uint32_t StateChanges = 0;
+		std::uint32_t RedundantStateSkipped = 0;
+
+		float SortMilliseconds = 0.0f;
+	};
+
+	// depth is the view space distance normalized to [0, 1] (e.g. z/farZ), and
+	// is clamped.  Layers drawn back to front (transparent) sort by depth first;
+	// the others sort by state first and front to back within equal state.
+	static std::uint64_t MakeSortKey(
+		std::uint32_t layer, std::uint32_t pso, std::uint32_t geometry, std::uint32_t material,
+		float depth, bool backToFront = false);
+
+	void Clear();
+	void Add(const DrawPacket& packet);
+
+	// Sorts by SortKey.  The radix sort is stable, so packets with equal keys
+	// keep the order in which they were added.
+	void Sort();
+
+	// Replays the packets in their current order.  With filterRedundant = false
+	// every binding is set for every packet, like the original DrawRenderItems.
+	SubmitStats Submit(DrawPacketRecorder& recorder, bool filterRedundant = true)const;
+
+	// Replays count packets starting at first, assuming nothing is bound yet
+	// (e.g. one chunk per command list).
+	SubmitStats Submit(DrawPacketRecorder& recorder, bool filterRedundant, size_t first, size_t count)const;
+
+	const std::vector<DrawPacket>& Packets()const { return mPackets; }
+	size_t Size()const { return mPackets.size(); }
+
+private:
+	std::vector<DrawPacket> mPackets;
+
+	// Sort scratch, kept to avoid allocations every frame.
+	std::vector<std::uint64_t> mKeys;
+	std::vector<std::uint64_t> mKeysTemp;
+	std::vector<std::uint32_t> mOrder;
+	std::vector<std::uint32_t> mOrderTemp;
+	std::vector<DrawPacket> mSorted;
+
+	float mSortMilliseconds = 0.0f;
+};
@@ -0,0 +1,59 @@
+//***************************************************************************************
+// FixedTimestep.cpp by DanielDFY
+//***************************************************************************************
+
+#include "FixedTimestep.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+const std::uint32_t FixedTimestep::DefaultMaxStepsPerFrame;
+
+FixedTimestep::FixedTimestep(double stepSeconds, std::uint32_t maxStepsPerFrame) :
+	mStepSeconds(stepSeconds),
+	mMaxStepsPerFrame(maxStepsPerFrame)
+{
+	assert(stepSeconds > 0.0);
+	assert(maxStepsPerFrame > 0);
+}
+
+std::uint32_t FixedTimestep::Advance(double frameSeconds)
+{
+	if(frameSeconds > 0.0)
+		mAccumulator += frameSeconds;
+
+	// Frame times rarely add up to a step exactly in floating point, so a step
+	// that is due within rounding error is taken now rather than one frame
+	// late.
+	double due = mStepSeconds*(1.0 - 1e-6);
+
+	std::uint32_t steps = 0;
+	while(mAccumulator >= due && steps < mMaxStepsPerFrame)
+	{
+		mAccumulator = std::max(mAccumulator - mStepSeconds, 0.0);
+		++steps;
+	}
+
+	// Too far behind: keep only the part of a step, so Alpha stays valid and
+	// the next frame starts on time.
+	if(mAccumulator >= due)
+	{
+		double remainder = std::fmod(mAccumulator, mStepSeconds);
+		if(remainder >= due)
+			remainder = 0.0;
+
+		mDroppedSeconds += mAccumulator - remainder;
+		mAccumulator = remainder;
+	}
+
+	mStepCount += steps;
+
+	return steps;
+}
+
+void FixedTimestep::Reset()
+{
+	mAccumulator = 0.0;
+	mStepCount = 0;
+	mDroppedSeconds = 0.0;
+}
@@ -0,0 +1,57 @@
+//***************************************************************************************
+// FixedTimestep.h by DanielDFY
+//
+// Runs a simulation at a fixed rate whatever the frame rate.  Each frame adds
+// its time to an accumulator and gets back how many steps to run; the time
+// left over carries into the next frame instead of being lost, so a 30 Hz
+// simulation takes 30 steps per second at 60, 144 or 24 frames per second.
+//
+// A frame that falls far behind (a hitch, a breakpoint) runs at most
+// MaxStepsPerFrame steps and drops the rest of its time, so a slow frame does
+// not cause an even slower one.  Alpha() is how far the time left over is
+// into the next step, for drawing between the previous and current states.
+//
+// Usage per frame:
+//   std::uint32_t steps = mStepper.Advance(gt.DeltaTime());
+//   for(std::uint32_t i = 0; i < steps; ++i)
+//       Simulate(mStepper.StepSeconds());
+//   Draw(Lerp(previous, current, mStepper.Alpha()));
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+
+class FixedTimestep
+{
+public:
+	static const std::uint32_t DefaultMaxStepsPerFrame = 8;
+
+	explicit FixedTimestep(double stepSeconds, std::uint32_t maxStepsPerFrame = DefaultMaxStepsPerFrame);
+
+	// Adds frameSeconds (negative counts as 0) and returns the steps to run.
+	std::uint32_t Advance(double frameSeconds);
+
+	// Forgets the accumulated time and the counters.
+	void Reset();
+
+	double StepSeconds()const { return mStepSeconds; }
+	std::uint32_t MaxStepsPerFrame()const { return mMaxStepsPerFrame; }
+
+	// In [0, 1).
+	float Alpha()const { return (float)(mAccumulator / mStepSeconds); }
+
+	// Steps taken since construction or Reset, the time they simulated, and
+	// the time dropped because a frame hit MaxStepsPerFrame.
+	std::uint64_t StepCount()const { return mStepCount; }
+	double SimulatedSeconds()const { return mStepCount*mStepSeconds; }
+	double DroppedSeconds()const { return mDroppedSeconds; }
+
+private:
+	double mStepSeconds = 0.0;
+	std::uint32_t mMaxStepsPerFrame = 0;
+
+	double mAccumulator = 0.0;
+	std::uint64_t mStepCount = 0;
+	double mDroppedSeconds = 0.0;
+};
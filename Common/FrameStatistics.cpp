@@ -0,0 +1,286 @@
+//***************************************************************************************
+// FrameStatistics.cpp by DanielDFY
+//***************************************************************************************
+
+#include "FrameStatistics.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+const std::uint32_t FrameStatistics::MaxStages;
+
+FrameStatistics::FrameStatistics(std::uint32_t frameCount) :
+	mFrameCount(frameCount),
+	mSlots(new Slot[frameCount + 1]()),
+	mHead(0),
+	mTail(0),
+	mTotalHitches(0)
+{
+	assert(frameCount > 0);
+}
+
+std::uint32_t FrameStatistics::AddStage(const std::string& name)
+{
+	assert(mStageNames.size() < MaxStages);
+	assert(TotalFrames() == 0);
+
+	mStageNames.push_back(name);
+
+	return (std::uint32_t)mStageNames.size() - 1;
+}
+
+void FrameStatistics::SetHitchThreshold(float factor, float minimumMilliseconds)
+{
+	mHitchFactor = factor;
+	mHitchMinimumMilliseconds = minimumMilliseconds;
+}
+
+void FrameStatistics::AddStageTime(std::uint32_t stage, float milliseconds)
+{
+	assert(stage < mStageNames.size());
+	mCurrentStages[stage] += milliseconds;
+}
+
+void FrameStatistics::EndFrame(float frameMilliseconds)
+{
+	// Compare with the typical frame time before this frame is taken in.
+	bool hitch = mTypicalMilliseconds > 0.0f &&
+		frameMilliseconds > mHitchFactor * mTypicalMilliseconds &&
+		frameMilliseconds - mTypicalMilliseconds >= mHitchMinimumMilliseconds;
+
+	if(mTypicalMilliseconds == 0.0f)
+		mTypicalMilliseconds = frameMilliseconds;
+	else if(!hitch)
+		mTypicalMilliseconds += 0.05f * (frameMilliseconds - mTypicalMilliseconds);
+
+	std::uint64_t head = mHead.load(std::memory_order_relaxed);
+	Slot& slot = mSlots[head % (mFrameCount + 1)];
+
+	// Orders the previous mHead store before the slot stores, so a reader that
+	// sees a value of this frame also sees that the slot is being reused; pairs
+	// with the acquire fence in GetFrames.
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot.FrameMilliseconds.store(frameMilliseconds, std::memory_order_relaxed);
+	slot.Hitch.store(hitch, std::memory_order_relaxed);
+	for(std::uint32_t i = 0; i < MaxStages; ++i)
+	{
+		slot.StageMilliseconds[i].store(mCurrentStages[i], std::memory_order_relaxed);
+		mCurrentStages[i] = 0.0f;
+	}
+
+	if(hitch)
+		mTotalHitches.fetch_add(1, std::memory_order_relaxed);
+
+	mHead.store(head + 1, std::memory_order_release);
+}
+
+void FrameStatistics::Reset()
+{
+	mTail.store(mHead.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+std::vector<FrameStatistics::FrameRecord> FrameStatistics::GetFrames()const
+{
+	std::uint64_t head = mHead.load(std::memory_order_acquire);
+	std::uint64_t first = std::max(mTail.load(std::memory_order_relaxed),
+		head > mFrameCount ? head - mFrameCount : 0);
+
+	std::vector<FrameRecord> frames;
+	frames.reserve((size_t)(head - first));
+	for(std::uint64_t i = first; i < head; ++i)
+	{
+		const Slot& slot = mSlots[i % (mFrameCount + 1)];
+
+		FrameRecord f;
+		f.Index = i;
+		f.FrameMilliseconds = slot.FrameMilliseconds.load(std::memory_order_relaxed);
+		f.Hitch = slot.Hitch.load(std::memory_order_relaxed);
+		for(std::uint32_t s = 0; s < MaxStages; ++s)
+			f.StageMilliseconds[s] = slot.StageMilliseconds[s].load(std::memory_order_relaxed);
+		frames.push_back(f);
+	}
+
+	// Drop the frames the recorder may have been overwriting while we copied.
+	// The ring has one slot more than it reports, so this only happens if
+	// frames were recorded during the copy.
+	std::atomic_thread_fence(std::memory_order_acquire);
+	std::uint64_t newHead = mHead.load(std::memory_order_relaxed);
+	if(newHead > first + mFrameCount)
+	{
+		size_t overwritten = (size_t)std::min<std::uint64_t>(newHead - mFrameCount - first, frames.size());
+		frames.erase(frames.begin(), frames.begin() + overwritten);
+	}
+
+	return frames;
+}
+
+FrameStatistics::Summary FrameStatistics::Summarize(std::vector<float>& milliseconds)
+{
+	Summary s;
+	s.Frames = (std::uint32_t)milliseconds.size();
+	if(milliseconds.empty())
+		return s;
+
+	std::sort(milliseconds.begin(), milliseconds.end());
+
+	// Nearest rank: the smallest time that at least p percent of the frames
+	// do not exceed.
+	auto percentile = [&](float p)
+	{
+		size_t rank = (size_t)std::ceil(p / 100.0f * milliseconds.size());
+		return milliseconds[std::max<size_t>(rank, 1) - 1];
+	};
+
+	double sum = 0.0;
+	for(float ms : milliseconds)
+		sum += ms;
+
+	s.MeanMilliseconds = (float)(sum / milliseconds.size());
+	s.P50Milliseconds = percentile(50.0f);
+	s.P95Milliseconds = percentile(95.0f);
+	s.P99Milliseconds = percentile(99.0f);
+	s.MaxMilliseconds = milliseconds.back();
+
+	return s;
+}
+
+FrameStatistics::Summary FrameStatistics::GetSummary()const
+{
+	std::vector<FrameRecord> frames = GetFrames();
+
+	std::vector<float> ms;
+	ms.reserve(frames.size());
+	for(const FrameRecord& f : frames)
+		ms.push_back(f.FrameMilliseconds);
+
+	return Summarize(ms);
+}
+
+FrameStatistics::Summary FrameStatistics::GetStageSummary(std::uint32_t stage)const
+{
+	assert(stage < mStageNames.size());
+
+	std::vector<FrameRecord> frames = GetFrames();
+
+	std::vector<float> ms;
+	ms.reserve(frames.size());
+	for(const FrameRecord& f : frames)
+		ms.push_back(f.StageMilliseconds[stage]);
+
+	return Summarize(ms);
+}
+
+std::uint32_t FrameStatistics::HitchCount()const
+{
+	std::uint32_t count = 0;
+	for(const FrameRecord& f : GetFrames())
+		count += f.Hitch ? 1 : 0;
+
+	return count;
+}
+
+std::string FrameStatistics::SummaryToString()const
+{
+	std::vector<FrameRecord> frames = GetFrames();
+
+	std::vector<float> ms;
+	std::uint32_t hitches = 0;
+	for(const FrameRecord& f : frames)
+	{
+		ms.push_back(f.FrameMilliseconds);
+		hitches += f.Hitch ? 1 : 0;
+	}
+
+	Summary s = Summarize(ms);
+
+	char buf[128];
+	snprintf(buf, sizeof(buf), "p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms  hitches %u",
+		s.P50Milliseconds, s.P95Milliseconds, s.P99Milliseconds, s.MaxMilliseconds, hitches);
+
+	return buf;
+}
+
+void FrameStatistics::WriteCsv(std::ostream& os)const
+{
+	os << "frame,frame_ms,hitch";
+	for(const std::string& name : mStageNames)
+		os << "," << name << "_ms";
+	os << "\n";
+
+	char buf[32];
+	for(const FrameRecord& f : GetFrames())
+	{
+		snprintf(buf, sizeof(buf), ",%.4f", f.FrameMilliseconds);
+		os << f.Index << buf << "," << (f.Hitch ? 1 : 0);
+
+		for(std::uint32_t s = 0; s < StageCount(); ++s)
+		{
+			snprintf(buf, sizeof(buf), ",%.4f", f.StageMilliseconds[s]);
+			os << buf;
+		}
+		os << "\n";
+	}
+}
+
+static void WriteSummaryJson(std::ostream& os, const FrameStatistics::Summary& s)
+{
+	char buf[256];
+	snprintf(buf, sizeof(buf),
+		"{\"mean_ms\":%.4f,\"p50_ms\":%.4f,\"p95_ms\":%.4f,\"p99_ms\":%.4f,\"max_ms\":%.4f}",
+		s.MeanMilliseconds, s.P50Milliseconds, s.P95Milliseconds, s.P99Milliseconds, s.MaxMilliseconds);
+	os << buf;
+}
+
+void FrameStatistics::WriteJson(std::ostream& os)const
+{
+	// Summaries are computed from one snapshot so that they agree.
+	std::vector<FrameRecord> frames = GetFrames();
+
+	std::vector<float> ms;
+	std::uint32_t hitches = 0;
+	for(const FrameRecord& f : frames)
+	{
+		ms.push_back(f.FrameMilliseconds);
+		hitches += f.Hitch ? 1 : 0;
+	}
+
+	os << "{\"frames\":" << frames.size() << ",\"hitches\":" << hitches << ",\"frame\":";
+	WriteSummaryJson(os, Summarize(ms));
+
+	os << ",\"stages\":{";
+	for(std::uint32_t s = 0; s < StageCount(); ++s)
+	{
+		for(size_t i = 0; i < frames.size(); ++i)
+			ms[i] = frames[i].StageMilliseconds[s];
+
+		// Stage names are chosen by the app; keep them to plain identifiers.
+		os << (s > 0 ? "," : "") << "\"" << mStageNames[s] << "\":";
+		WriteSummaryJson(os, Summarize(ms));
+	}
+	os << "}}\n";
+}
+
+bool FrameStatistics::WriteCsv(const std::string& filename)const
+{
+	std::ofstream fout(filename);
+	if(!fout)
+		return false;
+
+	WriteCsv(fout);
+
+	return (bool)fout;
+}
+
+bool FrameStatistics::WriteJson(const std::string& filename)const
+{
+	std::ofstream fout(filename);
+	if(!fout)
+		return false;
+
+	WriteJson(fout);
+
+	return (bool)fout;
+}
@@ -0,0 +1,147 @@
+//***************************************************************************************
+// FrameStatistics.h by DanielDFY
+//
+// Keeps the times of the last frames (whole frame plus named stages such as
+// Update and Draw) in a ring and reports percentiles over them.  An average
+// over a second hides the one 50 ms frame among sixty 16 ms ones; p99 and max
+// do not.
+//
+// A frame whose time is well above the recent typical frame time is flagged
+// as a hitch.  The typical time is a moving average of the frames that were
+// not hitches, so a single long frame does not raise the bar for the next.
+//
+// One thread records (AddStageTime, EndFrame).  Any thread may read, e.g. to
+// dump CSV/JSON while the app runs; recording never waits for a reader.
+// Nothing here depends on Windows, so a headless benchmark can feed EndFrame
+// with its own measurements.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class FrameStatistics
+{
+public:
+	static const std::uint32_t MaxStages = 8;
+
+	struct Summary
+	{
+		std::uint32_t Frames = 0;
+		float MeanMilliseconds = 0.0f;
+		float P50Milliseconds = 0.0f;
+		float P95Milliseconds = 0.0f;
+		float P99Milliseconds = 0.0f;
+		float MaxMilliseconds = 0.0f;
+	};
+
+	struct FrameRecord
+	{
+		std::uint64_t Index = 0;
+		float FrameMilliseconds = 0.0f;
+		bool Hitch = false;
+		float StageMilliseconds[MaxStages] = {};
+	};
+
+	// Adds the time from construction to destruction to a stage of the frame
+	// in progress.
+	class ScopedStage
+	{
+	public:
+		ScopedStage(FrameStatistics& stats, std::uint32_t stage) :
+			mStats(stats), mStage(stage), mStart(std::chrono::steady_clock::now())
+		{
+		}
+
+		~ScopedStage()
+		{
+			auto end = std::chrono::steady_clock::now();
+			mStats.AddStageTime(mStage, std::chrono::duration<float, std::milli>(end - mStart).count());
+		}
+
+		ScopedStage(const ScopedStage& rhs) = delete;
+		ScopedStage& operator=(const ScopedStage& rhs) = delete;
+
+	private:
+		FrameStatistics& mStats;
+		std::uint32_t mStage;
+		std::chrono::steady_clock::time_point mStart;
+	};
+
+	// Keeps the last frameCount frames.
+	explicit FrameStatistics(std::uint32_t frameCount = 1024);
+	FrameStatistics(const FrameStatistics& rhs) = delete;
+	FrameStatistics& operator=(const FrameStatistics& rhs) = delete;
+
+	// Add stages before the first frame is recorded.
+	std::uint32_t AddStage(const std::string& name);
+	std::uint32_t StageCount()const { return (std::uint32_t)mStageNames.size(); }
+	const std::string& StageName(std::uint32_t stage)const { return mStageNames[stage]; }
+
+	// A frame is a hitch if it takes more than factor times the typical frame
+	// time and at least minimumMilliseconds longer.  Defaults 2x and 4 ms.
+	void SetHitchThreshold(float factor, float minimumMilliseconds);
+
+	// Recording thread only.
+	void AddStageTime(std::uint32_t stage, float milliseconds);
+	void EndFrame(float frameMilliseconds);
+
+	// Forgets the frames recorded so far.
+	void Reset();
+
+	// Any thread.  Frames recorded since construction or Reset, at most
+	// frameCount, oldest first.
+	std::vector<FrameRecord> GetFrames()const;
+	Summary GetSummary()const;
+	Summary GetStageSummary(std::uint32_t stage)const;
+	std::uint32_t HitchCount()const;
+
+	// Total frames and hitches since construction, including those that left
+	// the ring.
+	std::uint64_t TotalFrames()const { return mHead.load(std::memory_order_acquire); }
+	std::uint64_t TotalHitches()const { return mTotalHitches.load(std::memory_order_relaxed); }
+
+	// e.g. "p50 16.61  p95 16.90  p99 17.32  max 33.40 ms  hitches 1"
+	std::string SummaryToString()const;
+
+	// One line per frame: index, frame time, hitch flag, stage times.
+	void WriteCsv(std::ostream& os)const;
+	bool WriteCsv(const std::string& filename)const;
+
+	// Summaries of the frame time and every stage.
+	void WriteJson(std::ostream& os)const;
+	bool WriteJson(const std::string& filename)const;
+
+private:
+	struct Slot
+	{
+		std::atomic<float> FrameMilliseconds;
+		std::atomic<bool> Hitch;
+		std::atomic<float> StageMilliseconds[MaxStages];
+	};
+
+	static Summary Summarize(std::vector<float>& milliseconds);
+
+private:
+	std::uint32_t mFrameCount = 0;
+	std::unique_ptr<Slot[]> mSlots;
+
+	// Frames ever recorded, and where the last Reset left it.
+	std::atomic<std::uint64_t> mHead;
+	std::atomic<std::uint64_t> mTail;
+	std::atomic<std::uint64_t> mTotalHitches;
+
+	std::vector<std::string> mStageNames;
+
+	// Recording thread state.
+	float mCurrentStages[MaxStages] = {};
+	float mTypicalMilliseconds = 0.0f;
+	float mHitchFactor = 2.0f;
+	float mHitchMinimumMilliseconds = 4.0f;
+};
@@ -2,16 +2,20 @@
 // GameTimer.cpp by Frank Luna (C) 2011 All Rights Reserved.
 //***************************************************************************************
 
-#include <windows.h>
 #include "GameTimer.h"
+#include "Clock.h"
+#include "FrameStatistics.h"
 
 GameTimer::GameTimer()
-: mSecondsPerCount(0.0), mDeltaTime(-1.0), mBaseTime(0), 
-  mPausedTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
+: GameTimer(Clock::Steady())
+{
+}
+
+GameTimer::GameTimer(const Clock& clock)
+: mClock(&clock), mSecondsPerCount(1e-9), mDeltaTime(-1.0), mBaseTime(0), 
+  mPausedTime(0), mStopTime(0), mPrevTime(0), mCurrTime(0), mStopped(false),
+  mOverridden(false), mOverrideTotalTime(0.0f), mFrameStats(nullptr)
 {
-	__int64 countsPerSec;
-	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
-	mSecondsPerCount = 1.0 / (double)countsPerSec;
 }
 
 // Returns the total time elapsed since Reset() was called, NOT counting any
@@ -27,6 +31,11 @@ float GameTimer::TotalTime()const
 	// ----*---------------*-----------------*------------*------------*------> time
 	//  mBaseTime       mStopTime        startTime     mStopTime    mCurrTime
 
+	if( mOverridden )
+	{
+		return mOverrideTotalTime;
+	}
+
 	if( mStopped )
 	{
 		return (float)(((mStopTime - mPausedTime)-mBaseTime)*mSecondsPerCount);
@@ -55,8 +64,7 @@ float GameTimer::DeltaTime()const
 
 void GameTimer::Reset()
 {
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	std::int64_t currTime = mClock->Now();
 
 	mBaseTime = currTime;
 	mPrevTime = currTime;
@@ -66,8 +74,7 @@ void GameTimer::Reset()
 
 void GameTimer::Start()
 {
-	__int64 startTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+	std::int64_t startTime = mClock->Now();
 
 
 	// Accumulate the time elapsed between stop and start pairs.
@@ -90,8 +97,7 @@ void GameTimer::Stop()
 {
 	if( !mStopped )
 	{
-		__int64 currTime;
-		QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+		std::int64_t currTime = mClock->Now();
 
 		mStopTime = currTime;
 		mStopped  = true;
@@ -100,14 +106,15 @@ void GameTimer::Stop()
 
 void GameTimer::Tick()
 {
+	mOverridden = false;
+
 	if( mStopped )
 	{
 		mDeltaTime = 0.0;
 		return;
 	}
 
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	std::int64_t currTime = mClock->Now();
 	mCurrTime = currTime;
 
 	// Time difference between this frame and the previous.
@@ -123,5 +130,22 @@ void GameTimer::Tick()
 	{
 		mDeltaTime = 0.0;
 	}
+
+	if(mFrameStats != nullptr)
+	{
+		mFrameStats->EndFrame((float)(mDeltaTime*1000.0));
+	}
+}
+
+void GameTimer::SetFrameStatistics(FrameStatistics* stats)
+{
+	mFrameStats = stats;
+}
+
+void GameTimer::Override(float totalTime, float deltaTime)
+{
+	mOverridden = true;
+	mOverrideTotalTime = totalTime;
+	mDeltaTime = deltaTime;
 }
 
@@ -5,10 +5,18 @@
 #ifndef GAMETIMER_H
 #define GAMETIMER_H
 
+#include <cstdint>
+
+class Clock;
+class FrameStatistics;
+
+// Times are read from a Clock (Clock.h); the steady clock by default, or one
+// the caller controls, e.g. a ManualClock.
 class GameTimer
 {
 public:
 	GameTimer();
+	explicit GameTimer(const Clock& clock);
 
 	float TotalTime()const; // in seconds
 	float DeltaTime()const; // in seconds
@@ -18,17 +26,31 @@ public:
 	void Stop();  // Call when paused.
 	void Tick();  // Call every frame.
 
+	// If set, every Tick records the length of the frame that just ended.
+	void SetFrameStatistics(FrameStatistics* stats);
+
+	// Until the next Tick, TotalTime and DeltaTime return these instead of the
+	// clock's; used to replay recorded frame times (see InputLog.h).
+	void Override(float totalTime, float deltaTime);
+
 private:
+	const Clock* mClock;
+
 	double mSecondsPerCount;
 	double mDeltaTime;
 
-	__int64 mBaseTime;
-	__int64 mPausedTime;
-	__int64 mStopTime;
-	__int64 mPrevTime;
-	__int64 mCurrTime;
+	std::int64_t mBaseTime;
+	std::int64_t mPausedTime;
+	std::int64_t mStopTime;
+	std::int64_t mPrevTime;
+	std::int64_t mCurrTime;
 
 	bool mStopped;
+
+	bool mOverridden;
+	float mOverrideTotalTime;
+
+	FrameStatistics* mFrameStats;
 };
 
 #endif // GAMETIMER_H
\ No newline at end of file
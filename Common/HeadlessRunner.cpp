@@ -0,0 +1,226 @@
+//***************************************************************************************
+// HeadlessRunner.cpp by DanielDFY
+//***************************************************************************************
+
+#include "HeadlessRunner.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+	bool ParseUInt(const char* text, std::uint32_t* value)
+	{
+		char* end = nullptr;
+		unsigned long v = std::strtoul(text, &end, 10);
+		if(end == text || *end != '\0' || text[0] == '-')
+			return false;
+
+		*value = (std::uint32_t)v;
+		return true;
+	}
+
+	bool ParseFloat(const char* text, float* value)
+	{
+		char* end = nullptr;
+		float v = std::strtof(text, &end);
+		if(end == text || *end != '\0')
+			return false;
+
+		*value = v;
+		return true;
+	}
+
+	double Milliseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+	{
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+}
+
+std::string HeadlessRunner::Report::ToString()const
+{
+	std::ostringstream oss;
+	oss.setf(std::ios::fixed);
+	oss.precision(3);
+
+	double frames = std::max(Frames, 1u);
+
+	oss << "Headless run: " << Frames << " frames of " << DeltaTime * 1000.0f << " ms in "
+		<< TotalMilliseconds << " ms\n";
+
+	const FrameStatistics::Summary* summaries[] = { &Frame, &Update, &Draw };
+	const char* names[] = { "Frame ", "Update", "Draw  " };
+	for(int i = 0; i < 3; ++i)
+	{
+		const FrameStatistics::Summary& s = *summaries[i];
+		oss << "  " << names[i] << "  mean " << s.MeanMilliseconds << "  p50 " << s.P50Milliseconds
+			<< "  p95 " << s.P95Milliseconds << "  p99 " << s.P99Milliseconds
+			<< "  max " << s.MaxMilliseconds << " ms\n";
+	}
+
+	oss.precision(1);
+	oss << "  Commands per frame: " << Commands.Total() / frames
+		<< " (draws " << Commands.Draws / frames
+		<< ", PSOs " << Commands.PipelineStates / frames
+		<< ", geometries " << Commands.Geometries / frames
+		<< ", topologies " << Commands.PrimitiveTopologies / frames
+		<< ", materials " << Commands.Materials / frames
+		<< ", object CBs " << Commands.ObjectCBs / frames << ")\n";
+
+	return oss.str();
+}
+
+HeadlessRunner::HeadlessRunner() :
+	HeadlessRunner(Settings())
+{
+}
+
+HeadlessRunner::HeadlessRunner(const Settings& settings) :
+	mSettings(settings),
+	mFrameStats(std::max(settings.Frames, 1u))
+{
+	mUpdateStage = mFrameStats.AddStage("Update");
+	mDrawStage = mFrameStats.AddStage("Draw");
+}
+
+bool HeadlessRunner::ParseArguments(int argc, const char* const* argv, Settings* settings)
+{
+	for(int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if(std::strcmp(arg, "-headless") == 0)
+			continue;
+
+		bool ok = false;
+		if(value == nullptr)
+			ok = false;
+		else if(std::strcmp(arg, "-frames") == 0)
+			ok = ParseUInt(value, &settings->Frames) && settings->Frames > 0;
+		else if(std::strcmp(arg, "-warmup") == 0)
+			ok = ParseUInt(value, &settings->WarmupFrames);
+		else if(std::strcmp(arg, "-dt") == 0)
+			ok = ParseFloat(value, &settings->DeltaTime) && settings->DeltaTime > 0.0f;
+		else if(std::strcmp(arg, "-csv") == 0)
+		{
+			settings->CsvFile = value;
+			ok = true;
+		}
+		else if(std::strcmp(arg, "-json") == 0)
+		{
+			settings->JsonFile = value;
+			ok = true;
+		}
+
+		if(!ok)
+			return false;
+
+		++i;
+	}
+
+	return true;
+}
+
+bool HeadlessRunner::ParseCommandLine(const std::string& commandLine, Settings* settings)
+{
+	std::vector<std::string> args(1);
+	bool inArg = false;
+	bool quoted = false;
+	for(char c : commandLine)
+	{
+		if(c == '"')
+		{
+			quoted = !quoted;
+			if(!inArg)
+				args.emplace_back();
+			inArg = true;
+		}
+		else if((c == ' ' || c == '\t') && !quoted)
+		{
+			inArg = false;
+		}
+		else
+		{
+			if(!inArg)
+				args.emplace_back();
+			args.back() += c;
+			inArg = true;
+		}
+	}
+
+	std::vector<const char*> argv;
+	for(const std::string& arg : args)
+		argv.push_back(arg.c_str());
+
+	return ParseArguments((int)argv.size(), argv.data(), settings);
+}
+
+bool HeadlessRunner::Run(HeadlessApp& app)
+{
+	Profiler::Get().SetThreadName("Main");
+
+	mFrameStats.Reset();
+	mReport = Report();
+	mReport.DeltaTime = mSettings.DeltaTime;
+
+	if(!app.Initialize())
+		return false;
+
+	CountingDrawPacketRecorder recorder;
+
+	// The total time is computed from the frame index rather than summed, so
+	// it does not drift over long runs.
+	std::uint32_t frameCount = mSettings.WarmupFrames + mSettings.Frames;
+	auto runStart = std::chrono::steady_clock::now();
+	for(std::uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		bool warmup = frame < mSettings.WarmupFrames;
+		if(frame == mSettings.WarmupFrames)
+		{
+			recorder.Reset();
+			runStart = std::chrono::steady_clock::now();
+		}
+
+		float totalTime = (float)((frame + 1) * (double)mSettings.DeltaTime);
+
+		PROFILE_SCOPE("Frame");
+
+		auto start = std::chrono::steady_clock::now();
+		{
+			PROFILE_SCOPE("Update");
+			app.Update(totalTime, mSettings.DeltaTime);
+		}
+		auto updated = std::chrono::steady_clock::now();
+		{
+			PROFILE_SCOPE("Draw");
+			app.Draw(recorder);
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		if(!warmup)
+		{
+			mFrameStats.AddStageTime(mUpdateStage, (float)Milliseconds(start, updated));
+			mFrameStats.AddStageTime(mDrawStage, (float)Milliseconds(updated, end));
+			mFrameStats.EndFrame((float)Milliseconds(start, end));
+		}
+	}
+
+	mReport.Frames = mSettings.Frames;
+	mReport.TotalMilliseconds = Milliseconds(runStart, std::chrono::steady_clock::now());
+	mReport.Frame = mFrameStats.GetSummary();
+	mReport.Update = mFrameStats.GetStageSummary(mUpdateStage);
+	mReport.Draw = mFrameStats.GetStageSummary(mDrawStage);
+	mReport.Commands = recorder.GetCounts();
+
+	bool ok = true;
+	if(!mSettings.CsvFile.empty())
+		ok = mFrameStats.WriteCsv(mSettings.CsvFile) && ok;
+	if(!mSettings.JsonFile.empty())
+		ok = mFrameStats.WriteJson(mSettings.JsonFile) && ok;
+
+	return ok;
+}
@@ -0,0 +1,107 @@
+//***************************************************************************************
+// HeadlessRunner.h by DanielDFY
+//
+// Runs an app's per-frame CPU work with no window, swap chain or device, for
+// benchmarking Update on machines without a GPU (or without Windows).
+//
+// The app implements HeadlessApp: Update gets the same total/delta times
+// D3DApp::Update reads from the GameTimer, and Draw records its submission
+// into a DrawPacketRecorder instead of a command list.  The runner feeds a
+// fixed time step, so every run simulates exactly the same frames, and
+// records into a CountingDrawPacketRecorder (the null renderer).
+//
+// Update and Draw are timed into a FrameStatistics with "Update" and "Draw"
+// stages, and under PROFILE_SCOPE like D3DApp::Run, so the usual CSV/JSON and
+// Chrome trace output work for headless runs too.  Warm-up frames run first
+// and are not recorded.
+//
+// Usage:
+//   HeadlessRunner::Settings settings;
+//   if(!HeadlessRunner::ParseArguments(argc, argv, &settings)) ...
+//   HeadlessRunner runner(settings);
+//   if(runner.Run(app))
+//       printf("%s", runner.GetReport().ToString().c_str());
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "DrawPacket.h"
+#include "FrameStatistics.h"
+
+class HeadlessApp
+{
+public:
+	virtual ~HeadlessApp() = default;
+
+	// Called once before the first frame; false stops the run.
+	virtual bool Initialize() { return true; }
+
+	virtual void Update(float totalTime, float deltaTime) = 0;
+	virtual void Draw(DrawPacketRecorder& recorder) = 0;
+};
+
+class HeadlessRunner
+{
+public:
+	struct Settings
+	{
+		std::uint32_t Frames = 1000;
+		std::uint32_t WarmupFrames = 60;
+		float DeltaTime = 1.0f / 60.0f;
+
+		// Written after the run when not empty: FrameStatistics::WriteCsv and
+		// WriteJson of the recorded frames.
+		std::string CsvFile;
+		std::string JsonFile;
+	};
+
+	struct Report
+	{
+		std::uint32_t Frames = 0;
+		float DeltaTime = 0.0f;
+
+		// Wall time of the recorded frames, warm-up excluded.
+		double TotalMilliseconds = 0.0;
+
+		FrameStatistics::Summary Frame;
+		FrameStatistics::Summary Update;
+		FrameStatistics::Summary Draw;
+
+		// Recorder calls summed over the recorded frames.
+		CountingDrawPacketRecorder::Counts Commands;
+
+		std::string ToString()const;
+	};
+
+	HeadlessRunner();
+	explicit HeadlessRunner(const Settings& settings);
+	HeadlessRunner(const HeadlessRunner& rhs) = delete;
+	HeadlessRunner& operator=(const HeadlessRunner& rhs) = delete;
+
+	// Reads "-frames N", "-warmup N", "-dt seconds", "-csv file" and "-json
+	// file" into settings, skipping argv[0] and "-headless".  Returns false on
+	// an unknown option or a bad value.
+	static bool ParseArguments(int argc, const char* const* argv, Settings* settings);
+
+	// The same for a WinMain command line (no program name); arguments are
+	// split at spaces, and double quotes group a file name with spaces.
+	static bool ParseCommandLine(const std::string& commandLine, Settings* settings);
+
+	// Initializes app and runs the warm-up and recorded frames.  False if
+	// Initialize failed or an output file could not be written.
+	bool Run(HeadlessApp& app);
+
+	const Report& GetReport()const { return mReport; }
+	const FrameStatistics& GetFrameStats()const { return mFrameStats; }
+
+private:
+	Settings mSettings;
+	Report mReport;
+
+	FrameStatistics mFrameStats;
+	std::uint32_t mUpdateStage = 0;
+	std::uint32_t mDrawStage = 0;
+};
@@ -0,0 +1,172 @@
+//***************************************************************************************
+// InputLog.cpp by DanielDFY
+//***************************************************************************************
+
+#include "InputLog.h"
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+	const std::uint32_t FileMagic = 0x474f4c49; // "ILOG"
+	const std::uint32_t FileVersion = 1;
+
+	struct FileHeader
+	{
+		std::uint32_t Magic;
+		std::uint32_t Version;
+		std::uint32_t FrameCount;
+		std::uint32_t EventCount;
+	};
+
+	struct StoredFrame
+	{
+		float DeltaTime;
+		std::uint32_t EventCount;
+	};
+
+	static_assert(sizeof(InputLog::Event) == 6, "InputLog::Event is stored as is");
+
+	std::int16_t ClampCoordinate(int v)
+	{
+		return (std::int16_t)std::min(std::max(v, -32768), 32767);
+	}
+}
+
+InputLog::Event InputLog::MouseEvent(EventType type, std::uint32_t buttons, int x, int y)
+{
+	Event e;
+	e.Type = type;
+	e.Code = (std::uint8_t)buttons;
+	e.X = ClampCoordinate(x);
+	e.Y = ClampCoordinate(y);
+
+	return e;
+}
+
+InputLog::Event InputLog::KeyEvent(int key, bool down)
+{
+	Event e;
+	e.Type = down ? EventType::KeyDown : EventType::KeyUp;
+	e.Code = (std::uint8_t)key;
+	e.X = 0;
+	e.Y = 0;
+
+	return e;
+}
+
+void InputLog::BeginFrame(float deltaTime)
+{
+	Frame frame;
+	frame.DeltaTime = deltaTime;
+	frame.FirstEvent = (std::uint32_t)mEvents.size();
+	mFrames.push_back(frame);
+}
+
+void InputLog::AddEvent(const Event& event)
+{
+	if(mFrames.empty())
+		return;
+
+	mEvents.push_back(event);
+	mFrames.back().EventCount++;
+}
+
+void InputLog::Clear()
+{
+	mFrames.clear();
+	mEvents.clear();
+}
+
+InputLog::Status InputLog::Save(const std::string& filename)const
+{
+	std::ofstream fout(filename, std::ios::binary | std::ios::trunc);
+	if(!fout)
+		return Status::OpenFailed;
+
+	FileHeader header;
+	header.Magic = FileMagic;
+	header.Version = FileVersion;
+	header.FrameCount = (std::uint32_t)mFrames.size();
+	header.EventCount = (std::uint32_t)mEvents.size();
+	fout.write((const char*)&header, sizeof(header));
+
+	std::vector<StoredFrame> frames(mFrames.size());
+	for(size_t i = 0; i < mFrames.size(); ++i)
+	{
+		frames[i].DeltaTime = mFrames[i].DeltaTime;
+		frames[i].EventCount = mFrames[i].EventCount;
+	}
+	fout.write((const char*)frames.data(), (std::streamsize)(frames.size()*sizeof(StoredFrame)));
+	fout.write((const char*)mEvents.data(), (std::streamsize)(mEvents.size()*sizeof(Event)));
+
+	fout.close();
+
+	return fout ? Status::Ok : Status::WriteFailed;
+}
+
+InputLog::Status InputLog::Load(const std::string& filename)
+{
+	Clear();
+
+	std::ifstream fin(filename, std::ios::binary);
+	if(!fin)
+		return Status::OpenFailed;
+
+	FileHeader header;
+	if(!fin.read((char*)&header, sizeof(header)) || header.Magic != FileMagic || header.Version != FileVersion)
+		return Status::BadFormat;
+
+	// Read what the file actually holds before trusting the counts.
+	std::vector<StoredFrame> frames;
+	StoredFrame stored;
+	while(frames.size() < header.FrameCount && fin.read((char*)&stored, sizeof(stored)))
+		frames.push_back(stored);
+
+	std::vector<Event> events;
+	Event event;
+	while(events.size() < header.EventCount && fin.read((char*)&event, sizeof(event)))
+		events.push_back(event);
+
+	if(frames.size() != header.FrameCount || events.size() != header.EventCount)
+		return Status::BadFormat;
+
+	std::uint64_t eventCount = 0;
+	for(const StoredFrame& f : frames)
+	{
+		Frame frame;
+		frame.DeltaTime = f.DeltaTime;
+		frame.FirstEvent = (std::uint32_t)eventCount;
+		frame.EventCount = f.EventCount;
+		mFrames.push_back(frame);
+
+		eventCount += f.EventCount;
+	}
+
+	bool valid = eventCount == header.EventCount;
+	for(const Event& e : events)
+		valid = valid && e.Type <= EventType::KeyUp;
+
+	if(!valid)
+	{
+		Clear();
+		return Status::BadFormat;
+	}
+
+	mEvents = std::move(events);
+
+	return Status::Ok;
+}
+
+const char* InputLog::StatusToString(Status status)
+{
+	switch(status)
+	{
+	case Status::Ok:          return "Ok";
+	case Status::OpenFailed:  return "OpenFailed";
+	case Status::BadFormat:   return "BadFormat";
+	case Status::WriteFailed: return "WriteFailed";
+	}
+
+	return "Unknown";
+}
@@ -0,0 +1,84 @@
+//***************************************************************************************
+// InputLog.h by DanielDFY
+//
+// Per-frame input and frame times, recorded from one run and replayed in
+// another, so two builds can be compared on exactly the same simulation and
+// camera path instead of on whatever the mouse and the clock did that time.
+//
+// A frame holds its delta time and the events that belong to it:
+//   - key changes, as seen by the app's polling during the frame's Update,
+//     replayed before the frame's Update;
+//   - mouse messages that arrived during the frame, replayed after its Draw.
+// Events added before the first frame are dropped.
+//
+// The file is a small header followed by 8 bytes per frame and 6 per event.
+// D3DApp records with "-record file" and replays with "-replay file".
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class InputLog
+{
+public:
+	enum class Status
+	{
+		Ok,
+		OpenFailed,
+		BadFormat,
+		WriteFailed
+	};
+
+	enum class EventType : std::uint8_t
+	{
+		MouseDown,
+		MouseUp,
+		MouseMove,
+		KeyDown,
+		KeyUp
+	};
+
+	struct Event
+	{
+		EventType Type;
+
+		// Button flags (MK_LBUTTON, ...) for mouse events, the virtual key for
+		// key events.
+		std::uint8_t Code;
+
+		// Client coordinates of mouse events.
+		std::int16_t X;
+		std::int16_t Y;
+	};
+
+	struct Frame
+	{
+		float DeltaTime = 0.0f;
+		std::uint32_t FirstEvent = 0;
+		std::uint32_t EventCount = 0;
+	};
+
+	static Event MouseEvent(EventType type, std::uint32_t buttons, int x, int y);
+	static Event KeyEvent(int key, bool down);
+
+	// Recording.
+	void BeginFrame(float deltaTime);
+	void AddEvent(const Event& event);
+	void Clear();
+
+	std::uint32_t FrameCount()const { return (std::uint32_t)mFrames.size(); }
+	const Frame& GetFrame(std::uint32_t frame)const { return mFrames[frame]; }
+	const Event& GetEvent(std::uint32_t event)const { return mEvents[event]; }
+
+	Status Save(const std::string& filename)const;
+	Status Load(const std::string& filename);
+
+	static const char* StatusToString(Status status);
+
+private:
+	std::vector<Frame> mFrames;
+	std::vector<Event> mEvents;
+};
@@ -0,0 +1,198 @@
+//***************************************************************************************
+// MappedFile.cpp by DanielDFY
+//***************************************************************************************
+
+#include "MappedFile.h"
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& rhs) :
+	mData(rhs.mData),
+	mSize(rhs.mSize),
+	mOpen(rhs.mOpen),
+	mSystemError(rhs.mSystemError)
+{
+	rhs.mData = nullptr;
+	rhs.mSize = 0;
+	rhs.mOpen = false;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& rhs)
+{
+	if(this != &rhs)
+	{
+		Close();
+		std::swap(mData, rhs.mData);
+		std::swap(mSize, rhs.mSize);
+		std::swap(mOpen, rhs.mOpen);
+		mSystemError = rhs.mSystemError;
+	}
+
+	return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& filename)
+{
+	int length = MultiByteToWideChar(CP_UTF8, 0, filename.c_str(), -1, nullptr, 0);
+	if(length == 0)
+	{
+		mSystemError = (int)GetLastError();
+		return false;
+	}
+
+	std::wstring wide(length, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, filename.c_str(), -1, &wide[0], length);
+	wide.resize(length - 1);
+
+	return Open(wide);
+}
+
+bool MappedFile::Open(const std::wstring& filename)
+{
+	Close();
+
+	HANDLE file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		mSystemError = (int)GetLastError();
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(file, &size))
+	{
+		mSystemError = (int)GetLastError();
+		CloseHandle(file);
+		return false;
+	}
+
+	// A view needs a non-empty mapping; an empty file maps to nothing.
+	if(size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		mOpen = true;
+		return true;
+	}
+
+	if((std::uint64_t)size.QuadPart > (std::uint64_t)SIZE_MAX)
+	{
+		mSystemError = ERROR_FILE_TOO_LARGE;
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(mapping == nullptr)
+	{
+		mSystemError = (int)GetLastError();
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	mSystemError = view == nullptr ? (int)GetLastError() : 0;
+
+	// The view keeps the mapping and the file alive.
+	CloseHandle(mapping);
+	CloseHandle(file);
+
+	if(view == nullptr)
+		return false;
+
+	mData = (const std::uint8_t*)view;
+	mSize = (std::uint64_t)size.QuadPart;
+	mOpen = true;
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if(mData != nullptr)
+		UnmapViewOfFile(mData);
+
+	mData = nullptr;
+	mSize = 0;
+	mOpen = false;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+	int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if(fd < 0)
+	{
+		mSystemError = errno;
+		return false;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) != 0)
+	{
+		mSystemError = errno;
+		close(fd);
+		return false;
+	}
+
+	// mmap rejects a length of 0; an empty file maps to nothing.
+	if(st.st_size == 0)
+	{
+		close(fd);
+		mOpen = true;
+		return true;
+	}
+
+	if((std::uint64_t)st.st_size > (std::uint64_t)SIZE_MAX)
+	{
+		mSystemError = EFBIG;
+		close(fd);
+		return false;
+	}
+
+	void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	mSystemError = view == MAP_FAILED ? errno : 0;
+
+	// The mapping keeps the file alive.
+	close(fd);
+
+	if(view == MAP_FAILED)
+		return false;
+
+	mData = (const std::uint8_t*)view;
+	mSize = (std::uint64_t)st.st_size;
+	mOpen = true;
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if(mData != nullptr)
+		munmap((void*)mData, (size_t)mSize);
+
+	mData = nullptr;
+	mSize = 0;
+	mOpen = false;
+}
+
+#endif
@@ -0,0 +1,43 @@
+//***************************************************************************************
+// MappedFile.h by DanielDFY
+//
+// Maps a whole file read-only into memory (MapViewOfFile on Windows, mmap
+// elsewhere).  Readers get a pointer into the page cache instead of a heap
+// copy, and pages are only read from disk when first touched.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile& rhs) = delete;
+	MappedFile& operator=(const MappedFile& rhs) = delete;
+	MappedFile(MappedFile&& rhs);
+	MappedFile& operator=(MappedFile&& rhs);
+
+	// Returns false if the file cannot be opened or mapped; SystemError() then
+	// holds GetLastError() or errno.  Filenames are UTF-8.
+	bool Open(const std::string& filename);
+#ifdef _WIN32
+	bool Open(const std::wstring& filename);
+#endif
+	void Close();
+
+	bool IsOpen()const { return mOpen; }
+	const std::uint8_t* Data()const { return mData; }
+	std::uint64_t Size()const { return mSize; }
+	int SystemError()const { return mSystemError; }
+
+private:
+	const std::uint8_t* mData = nullptr;
+	std::uint64_t mSize = 0;
+	bool mOpen = false;
+	int mSystemError = 0;
+};
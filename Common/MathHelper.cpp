@@ -3,14 +3,27 @@
 //***************************************************************************************
 
 #include "MathHelper.h"
+#include "Random.h"
 #include <float.h>
 #include <cmath>
 
+#if defined(_WIN32)
 using namespace DirectX;
+#endif
 
 const float MathHelper::Infinity = FLT_MAX;
 const float MathHelper::Pi       = 3.1415926535f;
 
+float MathHelper::RandF()
+{
+	return Random::ThreadLocal().NextFloat();
+}
+
+int MathHelper::Rand(int a, int b)
+{
+	return Random::ThreadLocal().NextInt(a, b);
+}
+
 float MathHelper::AngleFromXY(float x, float y)
 {
 	float theta = 0.0f;
@@ -33,50 +46,30 @@ float MathHelper::AngleFromXY(float x, float y)
 	return theta;
 }
 
+#if defined(_WIN32)
 XMVECTOR MathHelper::RandUnitVec3()
 {
-	XMVECTOR One  = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
-	XMVECTOR Zero = XMVectorZero();
-
-	// Keep trying until we get a point on/in the hemisphere.
-	while(true)
-	{
-		// Generate random point in the cube [-1,1]^3.
-		XMVECTOR v = XMVectorSet(MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), 0.0f);
+	// Pick z uniformly in [-1, 1] and the azimuth uniformly in [0, 2pi).  By
+	// Archimedes' hat-box theorem this is uniform over the unit sphere, so no
+	// points need to be rejected.
+	Random& random = Random::ThreadLocal();
 
-		// Ignore points outside the unit sphere in order to get an even distribution 
-		// over the unit sphere.  Otherwise points will clump more on the sphere near 
-		// the corners of the cube.
+	float z = random.NextFloat(-1.0f, 1.0f);
+	float phi = random.NextFloat(0.0f, 2.0f*Pi);
+	float r = sqrtf(MathHelper::Max(1.0f - z*z, 0.0f));
 
-		if( XMVector3Greater( XMVector3LengthSq(v), One) )
-			continue;
-
-		return XMVector3Normalize(v);
-	}
+	return XMVectorSet(r*cosf(phi), r*sinf(phi), z, 0.0f);
 }
 
 XMVECTOR MathHelper::RandHemisphereUnitVec3(XMVECTOR n)
 {
-	XMVECTOR One  = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
-	XMVECTOR Zero = XMVectorZero();
-
-	// Keep trying until we get a point on/in the hemisphere.
-	while(true)
-	{
-		// Generate random point in the cube [-1,1]^3.
-		XMVECTOR v = XMVectorSet(MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), 0.0f);
+	XMVECTOR v = RandUnitVec3();
 
-		// Ignore points outside the unit sphere in order to get an even distribution 
-		// over the unit sphere.  Otherwise points will clump more on the sphere near 
-		// the corners of the cube.
-		
-		if( XMVector3Greater( XMVector3LengthSq(v), One) )
-			continue;
+	// Mirror points in the bottom hemisphere.  The sphere distribution is
+	// symmetric, so the result is still uniform over the hemisphere.
+	if( XMVector3Less( XMVector3Dot(n, v), XMVectorZero() ) )
+		v = XMVectorNegate(v);
 
-		// Ignore points in the bottom hemisphere.
-		if( XMVector3Less( XMVector3Dot(n, v), Zero ) )
-			continue;
-
-		return XMVector3Normalize(v);
-	}
-}
\ No newline at end of file
+	return v;
+}
+#endif
@@ -2,22 +2,24 @@
 // MathHelper.h by Frank Luna (C) 2011 All Rights Reserved.
 //
 // Helper math class.
+//
+// The scalar helpers are portable.  The DirectXMath helpers are only declared
+// on Windows, so code shared with other platforms can include this header
+// without the Windows SDK.
 //***************************************************************************************
 
 #pragma once
 
-#include <Windows.h>
+#if defined(_WIN32)
 #include <DirectXMath.h>
+#endif
 #include <cstdint>
 
 class MathHelper
 {
 public:
-	// Returns random float in [0, 1).
-	static float RandF()
-	{
-		return (float)(rand()) / (float)RAND_MAX;
-	}
+	// Returns random float in [0, 1).  Uses the calling thread's generator, see Random.h.
+	static float RandF();
 
 	// Returns random float in [a, b).
 	static float RandF(float a, float b)
@@ -25,10 +27,8 @@ public:
 		return a + RandF()*(b-a);
 	}
 
-    static int Rand(int a, int b)
-    {
-        return a + rand() % ((b - a) + 1);
-    }
+	// Returns random int in [a, b].
+    static int Rand(int a, int b);
 
 	template<typename T>
 	static T Min(const T& a, const T& b)
@@ -57,6 +57,7 @@ public:
 	// Returns the polar angle of the point (x,y) in [0, 2*PI).
 	static float AngleFromXY(float x, float y);
 
+#if defined(_WIN32)
 	static DirectX::XMVECTOR SphericalToCartesian(float radius, float theta, float phi)
 	{
 		return DirectX::XMVectorSet(
@@ -91,6 +92,7 @@ public:
 
     static DirectX::XMVECTOR RandUnitVec3();
     static DirectX::XMVECTOR RandHemisphereUnitVec3(DirectX::XMVECTOR n);
+#endif
 
 	static const float Infinity;
 	static const float Pi;
@@ -0,0 +1,441 @@
+//***************************************************************************************
+// Meshlet.cpp by DanielDFY
+//***************************************************************************************
+
+#include "Meshlet.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <climits>
+
+using namespace SimdMath;
+
+namespace
+{
+	const Float3& PositionAt(const Float3* positions, std::uint32_t stride, std::uint32_t i)
+	{
+		return *reinterpret_cast<const Float3*>(reinterpret_cast<const std::uint8_t*>(positions) + (size_t)stride*i);
+	}
+
+	// Ritter's bounding sphere: start from the most separated pair of axis
+	// extreme points and grow the sphere to include every point outside it.
+	MeshletSphere ComputeSphere(const std::vector<Float3>& points)
+	{
+		MeshletSphere sphere;
+		if(points.empty())
+			return sphere;
+
+		size_t minIndex[3] = { 0, 0, 0 };
+		size_t maxIndex[3] = { 0, 0, 0 };
+		for(size_t i = 1; i < points.size(); ++i)
+		{
+			const float* p = &points[i].x;
+			for(int a = 0; a < 3; ++a)
+			{
+				if(p[a] < (&points[minIndex[a]].x)[a])
+					minIndex[a] = i;
+				if(p[a] > (&points[maxIndex[a]].x)[a])
+					maxIndex[a] = i;
+			}
+		}
+
+		Vector p0 = LoadFloat3(&points[minIndex[0]]);
+		Vector p1 = LoadFloat3(&points[maxIndex[0]]);
+		float bestDistSq = VectorGetX(Vector3LengthSq(VectorSubtract(p1, p0)));
+		for(int a = 1; a < 3; ++a)
+		{
+			Vector q0 = LoadFloat3(&points[minIndex[a]]);
+			Vector q1 = LoadFloat3(&points[maxIndex[a]]);
+			float distSq = VectorGetX(Vector3LengthSq(VectorSubtract(q1, q0)));
+			if(distSq > bestDistSq)
+			{
+				p0 = q0;
+				p1 = q1;
+				bestDistSq = distSq;
+			}
+		}
+
+		Vector center = VectorScale(VectorAdd(p0, p1), 0.5f);
+		float radius = 0.5f*sqrtf(bestDistSq);
+
+		for(const Float3& pf : points)
+		{
+			Vector d = VectorSubtract(LoadFloat3(&pf), center);
+			float dist = VectorGetX(Vector3Length(d));
+			if(dist > radius)
+			{
+				// Move the center towards the point so the new sphere touches both
+				// the point and the far side of the old sphere.
+				float newRadius = 0.5f*(radius + dist);
+				center = VectorAdd(center, VectorScale(d, (newRadius - radius)/dist));
+				radius = newRadius;
+			}
+		}
+
+		StoreFloat3(&sphere.Center, center);
+		sphere.Radius = radius;
+		return sphere;
+	}
+
+	float ElapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		auto d = std::chrono::high_resolution_clock::now() - start;
+		return std::chrono::duration<float, std::milli>(d).count();
+	}
+}
+
+MeshletFrustum MeshletFrustum::FromMatrix(const Float4x4& m)
+{
+	// With row vectors clip.c = dot(p, column c).  A point is inside when
+	// -w <= x <= w, -w <= y <= w and 0 <= z <= w.
+	MeshletFrustum f;
+	for(int c = 0; c < 4; ++c)
+	{
+		float x = m.m[c][0];
+		float y = m.m[c][1];
+		float z = m.m[c][2];
+		float w = m.m[c][3];
+		(&f.Planes[Left].x)[c] = w + x;
+		(&f.Planes[Right].x)[c] = w - x;
+		(&f.Planes[Bottom].x)[c] = w + y;
+		(&f.Planes[Top].x)[c] = w - y;
+		(&f.Planes[Near].x)[c] = z;
+		(&f.Planes[Far].x)[c] = w - z;
+	}
+
+	for(Float4& plane : f.Planes)
+	{
+		Vector v = LoadFloat4(&plane);
+		float length = VectorGetX(Vector3Length(v));
+		StoreFloat4(&plane, VectorScale(v, 1.0f / length));
+	}
+
+	return f;
+}
+
+bool MeshletFrustum::Intersects(const MeshletSphere& sphere)const
+{
+	Vector center = VectorSetW(LoadFloat3(&sphere.Center), 1.0f);
+	for(const Float4& plane : Planes)
+	{
+		float dist = VectorGetX(Vector4Dot(LoadFloat4(&plane), center));
+		if(dist < -sphere.Radius)
+			return false;
+	}
+
+	return true;
+}
+
+void MeshletBuilder::Build(
+	const Float3* positions, std::uint32_t positionStride, std::uint32_t vertexCount,
+	const std::uint16_t* indices, std::uint32_t indexCount,
+	MeshletMesh& mesh,
+	std::uint32_t maxVertices, std::uint32_t maxTriangles)
+{
+	std::vector<std::uint32_t> indices32(indices, indices + indexCount);
+	Build(positions, positionStride, vertexCount, indices32.data(), indexCount, mesh, maxVertices, maxTriangles);
+}
+
+void MeshletBuilder::Build(
+	const Float3* positions, std::uint32_t positionStride, std::uint32_t vertexCount,
+	const std::uint32_t* indices, std::uint32_t indexCount,
+	MeshletMesh& mesh,
+	std::uint32_t maxVertices, std::uint32_t maxTriangles)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	assert(maxVertices >= 3 && maxTriangles >= 1);
+
+	const std::uint32_t triCount = indexCount / 3;
+
+	mesh.Meshlets.clear();
+	mesh.UniqueVertices.clear();
+	mesh.Indices.clear();
+	mesh.Indices.reserve(triCount*3);
+
+	//
+	// Vertex -> triangle adjacency, stored compactly (offset/count per vertex).
+	//
+
+	std::vector<std::uint32_t> adjCount(vertexCount, 0);
+	for(std::uint32_t i = 0; i < triCount*3; ++i)
+		adjCount[indices[i]]++;
+
+	std::vector<std::uint32_t> adjOffset(vertexCount + 1, 0);
+	for(std::uint32_t v = 0; v < vertexCount; ++v)
+		adjOffset[v + 1] = adjOffset[v] + adjCount[v];
+
+	std::vector<std::uint32_t> adjTris(adjOffset[vertexCount]);
+	std::vector<std::uint32_t> fill(adjOffset.begin(), adjOffset.end() - 1);
+	for(std::uint32_t t = 0; t < triCount; ++t)
+	{
+		for(std::uint32_t k = 0; k < 3; ++k)
+			adjTris[fill[indices[t*3 + k]]++] = t;
+	}
+
+	// Number of not yet emitted triangles using each vertex.  Preferring vertices
+	// with few remaining triangles finishes them off and keeps meshlets compact.
+	std::vector<std::uint32_t>& liveCount = adjCount;
+
+	std::vector<bool> emitted(triCount, false);
+	std::vector<int> localIndex(vertexCount, -1);
+
+	std::vector<std::uint32_t> currVertices;
+	std::vector<std::uint32_t> currTriangles;
+	currVertices.reserve(maxVertices);
+	currTriangles.reserve(maxTriangles);
+
+	auto flush = [&]()
+	{
+		if(currTriangles.empty())
+			return;
+
+		Meshlet m;
+		m.VertexOffset = (std::uint32_t)mesh.UniqueVertices.size();
+		m.VertexCount = (std::uint32_t)currVertices.size();
+		m.IndexOffset = (std::uint32_t)mesh.Indices.size();
+		m.TriangleCount = (std::uint32_t)currTriangles.size();
+
+		mesh.UniqueVertices.insert(mesh.UniqueVertices.end(), currVertices.begin(), currVertices.end());
+		for(std::uint32_t t : currTriangles)
+		{
+			mesh.Indices.push_back(indices[t*3 + 0]);
+			mesh.Indices.push_back(indices[t*3 + 1]);
+			mesh.Indices.push_back(indices[t*3 + 2]);
+		}
+
+		ComputeBounds(positions, positionStride, mesh, m);
+		mesh.Meshlets.push_back(m);
+
+		for(std::uint32_t v : currVertices)
+			localIndex[v] = -1;
+
+		currVertices.clear();
+		currTriangles.clear();
+	};
+
+	auto newVertexCount = [&](std::uint32_t t)
+	{
+		std::uint32_t n = 0;
+		for(std::uint32_t k = 0; k < 3; ++k)
+			n += (localIndex[indices[t*3 + k]] < 0) ? 1 : 0;
+		return n;
+	};
+
+	auto addTriangle = [&](std::uint32_t t)
+	{
+		for(std::uint32_t k = 0; k < 3; ++k)
+		{
+			std::uint32_t v = indices[t*3 + k];
+			if(localIndex[v] < 0)
+			{
+				localIndex[v] = (int)currVertices.size();
+				currVertices.push_back(v);
+			}
+			liveCount[v]--;
+		}
+
+		currTriangles.push_back(t);
+		emitted[t] = true;
+	};
+
+	std::uint32_t seedCursor = 0;
+	std::uint32_t emittedCount = 0;
+	while(emittedCount < triCount)
+	{
+		// Pick the neighbour triangle adding the fewest new vertices to the
+		// current meshlet.
+		std::uint32_t best = UINT_MAX;
+		std::uint32_t bestNew = 4;
+		std::uint32_t bestLive = UINT_MAX;
+		for(std::uint32_t v : currVertices)
+		{
+			for(std::uint32_t a = adjOffset[v]; a < adjOffset[v + 1]; ++a)
+			{
+				std::uint32_t t = adjTris[a];
+				if(emitted[t])
+					continue;
+
+				std::uint32_t n = newVertexCount(t);
+				std::uint32_t live = liveCount[indices[t*3 + 0]] + liveCount[indices[t*3 + 1]] + liveCount[indices[t*3 + 2]];
+				if(n < bestNew || (n == bestNew && live < bestLive))
+				{
+					best = t;
+					bestNew = n;
+					bestLive = live;
+				}
+			}
+		}
+
+		// No connected triangle left.  Close the meshlet unless it is still small,
+		// then continue from the next triangle in index order.
+		if(best == UINT_MAX)
+		{
+			if(currTriangles.size() >= maxTriangles/4)
+				flush();
+
+			while(emitted[seedCursor])
+				++seedCursor;
+
+			best = seedCursor;
+			bestNew = newVertexCount(best);
+		}
+
+		// The meshlet is full.  The rejected triangle seeds the next one so the
+		// new meshlet continues where this one stopped.
+		if(currVertices.size() + bestNew > maxVertices || currTriangles.size() + 1 > maxTriangles)
+			flush();
+
+		addTriangle(best);
+		++emittedCount;
+	}
+
+	flush();
+
+	mesh.BuildMilliseconds = ElapsedMilliseconds(startTime);
+}
+
+void MeshletBuilder::ComputeBounds(
+	const Float3* positions, std::uint32_t positionStride,
+	const MeshletMesh& mesh, Meshlet& meshlet)
+{
+	std::vector<Float3> points(meshlet.VertexCount);
+	for(std::uint32_t i = 0; i < meshlet.VertexCount; ++i)
+		points[i] = PositionAt(positions, positionStride, mesh.UniqueVertices[meshlet.VertexOffset + i]);
+
+	meshlet.Bounds = ComputeSphere(points);
+
+	//
+	// Normal cone.  The axis is the average face normal and the cone has to
+	// contain every face normal of the meshlet.
+	//
+
+	std::vector<Float3> normals;
+	normals.reserve(meshlet.TriangleCount);
+
+	Vector axis = VectorZero();
+	for(std::uint32_t t = 0; t < meshlet.TriangleCount; ++t)
+	{
+		const std::uint32_t* tri = &mesh.Indices[meshlet.IndexOffset + t*3];
+		Vector p0 = LoadFloat3(&PositionAt(positions, positionStride, tri[0]));
+		Vector p1 = LoadFloat3(&PositionAt(positions, positionStride, tri[1]));
+		Vector p2 = LoadFloat3(&PositionAt(positions, positionStride, tri[2]));
+
+		// Clockwise front faces, so this points out of the front side.
+		Vector n = Vector3Cross(VectorSubtract(p1, p0), VectorSubtract(p2, p0));
+
+		// Skip degenerate triangles; they are never visible anyway.
+		if(VectorGetX(Vector3LengthSq(n)) < 1e-20f)
+			continue;
+
+		n = Vector3Normalize(n);
+		axis = VectorAdd(axis, n);
+
+		Float3 nf;
+		StoreFloat3(&nf, n);
+		normals.push_back(nf);
+	}
+
+	meshlet.ConeCutoff = 2.0f;
+	if(normals.empty() || VectorGetX(Vector3LengthSq(axis)) < 1e-12f)
+		return;
+
+	axis = Vector3Normalize(axis);
+
+	float minDot = 1.0f;
+	for(const Float3& nf : normals)
+		minDot = std::min(minDot, VectorGetX(Vector3Dot(axis, LoadFloat3(&nf))));
+
+	// A cone wider than a hemisphere is useless for backface rejection.
+	if(minDot <= 0.0f)
+		return;
+
+	StoreFloat3(&meshlet.ConeAxis, axis);
+	meshlet.ConeCutoff = sqrtf(1.0f - minDot*minDot);
+}
+
+bool MeshletCuller::IsBackfacing(const Meshlet& meshlet, const Float3& localEyePos)
+{
+	if(meshlet.ConeCutoff > 1.0f)
+		return false;
+
+	// The meshlet is backfacing if every direction from the eye into the bounding
+	// sphere makes an angle less than 90 - coneAngle with the cone axis:
+	//   dot(c - e, axis) >= sin(coneAngle)*|c - e| + r
+	Vector center = LoadFloat3(&meshlet.Bounds.Center);
+	Vector axis = LoadFloat3(&meshlet.ConeAxis);
+	Vector toCenter = VectorSubtract(center, LoadFloat3(&localEyePos));
+
+	float d = VectorGetX(Vector3Dot(toCenter, axis));
+	float dist = VectorGetX(Vector3Length(toCenter));
+
+	return d >= meshlet.ConeCutoff*dist + meshlet.Bounds.Radius;
+}
+
+void MeshletCuller::Cull(
+	const MeshletMesh& mesh,
+	const MeshletFrustum& localFrustum,
+	const Float3& localEyePos,
+	std::vector<std::uint32_t>& visible,
+	Stats* stats)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	Stats s;
+	for(std::uint32_t i = 0; i < (std::uint32_t)mesh.Meshlets.size(); ++i)
+	{
+		const Meshlet& m = mesh.Meshlets[i];
+
+		s.MeshletsTested++;
+		s.TrianglesTested += m.TriangleCount;
+
+		// The cone test is cheaper than the frustum test, so do it first.
+		if(IsBackfacing(m, localEyePos))
+		{
+			s.BackfaceCulled++;
+			continue;
+		}
+
+		if(!localFrustum.Intersects(m.Bounds))
+		{
+			s.FrustumCulled++;
+			continue;
+		}
+
+		visible.push_back(i);
+		s.MeshletsVisible++;
+		s.TrianglesVisible += m.TriangleCount;
+	}
+
+	if(stats != nullptr)
+	{
+		s.CullMilliseconds = ElapsedMilliseconds(startTime);
+		*stats = s;
+	}
+}
+
+void MeshletCuller::BuildDrawRanges(
+	const MeshletMesh& mesh,
+	const std::vector<std::uint32_t>& visible,
+	std::vector<DrawRange>& ranges)
+{
+	ranges.clear();
+
+	for(std::uint32_t i : visible)
+	{
+		const Meshlet& m = mesh.Meshlets[i];
+		std::uint32_t indexCount = m.TriangleCount*3;
+
+		if(!ranges.empty() && ranges.back().StartIndexLocation + ranges.back().IndexCount == m.IndexOffset)
+		{
+			ranges.back().IndexCount += indexCount;
+		}
+		else
+		{
+			DrawRange r;
+			r.IndexCount = indexCount;
+			r.StartIndexLocation = m.IndexOffset;
+			ranges.push_back(r);
+		}
+	}
+}
@@ -0,0 +1,145 @@
+//***************************************************************************************
+// Meshlet.h by DanielDFY
+//
+// Splits an indexed triangle mesh into small clusters (meshlets) and culls them
+// on the CPU.  Every meshlet stores a bounding sphere for frustum culling and a
+// normal cone so that clusters whose triangles all face away from the camera
+// can be rejected as a whole.
+//
+// The builder also emits an index buffer reordered by meshlet, so a visible
+// meshlet is just a [StartIndexLocation, IndexCount) range of it and can be
+// drawn with DrawIndexedInstanced.  Adjacent visible meshlets are merged into
+// a single draw by MeshletCuller::BuildDrawRanges.
+//
+// Only SimdMath is used so the builder and culler also build without the
+// Windows SDK.  SimdMath::Float3/Float4x4 have the layout of XMFLOAT3/XMFLOAT4X4,
+// so the demos pass their vertex positions and matrices straight through.
+// CubeMapApp culls its skull this way.
+//***************************************************************************************
+
+#pragma once
+
+#include "SimdMath.h"
+#include <cstdint>
+#include <vector>
+
+struct MeshletSphere
+{
+	SimdMath::Float3 Center = { 0.0f, 0.0f, 0.0f };
+	float Radius = 0.0f;
+};
+
+// The 6 planes of a view frustum, normals pointing inside and normalized so that
+// dot(plane.xyz, p) + plane.w is the signed distance of p to the plane.
+struct MeshletFrustum
+{
+	enum { Left = 0, Right, Bottom, Top, Near, Far, PlaneCount };
+
+	SimdMath::Float4 Planes[PlaneCount];
+
+	// Extracts the planes from a local to clip space transform (world*view*proj
+	// for row vectors), with the Direct3D clip volume 0 <= z <= w.  The result
+	// is in the mesh's local space.
+	static MeshletFrustum FromMatrix(const SimdMath::Float4x4& localToClip);
+
+	// False only if the sphere is entirely outside one of the planes.
+	bool Intersects(const MeshletSphere& sphere)const;
+};
+
+struct Meshlet
+{
+	// Range into MeshletMesh::UniqueVertices.
+	std::uint32_t VertexOffset = 0;
+	std::uint32_t VertexCount = 0;
+
+	// Range into MeshletMesh::Indices (in indices, not triangles).
+	std::uint32_t IndexOffset = 0;
+	std::uint32_t TriangleCount = 0;
+
+	MeshletSphere Bounds;
+
+	// All triangle normals are within the cone around ConeAxis.  ConeCutoff is
+	// the sine of the cone half angle, or > 1 if the normals spread over more
+	// than a hemisphere and the cone can never reject the meshlet.
+	SimdMath::Float3 ConeAxis = { 0.0f, 0.0f, 1.0f };
+	float ConeCutoff = 2.0f;
+};
+
+struct MeshletMesh
+{
+	std::vector<Meshlet> Meshlets;
+
+	// Original vertex indices referenced by each meshlet.
+	std::vector<std::uint32_t> UniqueVertices;
+
+	// Original index buffer reordered so that each meshlet is contiguous.
+	std::vector<std::uint32_t> Indices;
+
+	// Time spent in MeshletBuilder::Build.
+	float BuildMilliseconds = 0.0f;
+};
+
+class MeshletBuilder
+{
+public:
+	static const std::uint32_t MaxVertices = 64;
+	static const std::uint32_t MaxTriangles = 124;
+
+	// positions points to the first position with positionStride bytes between
+	// consecutive vertices, so it can read straight out of a Vertex array.
+	static void Build(
+		const SimdMath::Float3* positions, std::uint32_t positionStride, std::uint32_t vertexCount,
+		const std::uint32_t* indices, std::uint32_t indexCount,
+		MeshletMesh& mesh,
+		std::uint32_t maxVertices = MaxVertices, std::uint32_t maxTriangles = MaxTriangles);
+
+	static void Build(
+		const SimdMath::Float3* positions, std::uint32_t positionStride, std::uint32_t vertexCount,
+		const std::uint16_t* indices, std::uint32_t indexCount,
+		MeshletMesh& mesh,
+		std::uint32_t maxVertices = MaxVertices, std::uint32_t maxTriangles = MaxTriangles);
+
+private:
+	static void ComputeBounds(
+		const SimdMath::Float3* positions, std::uint32_t positionStride,
+		const MeshletMesh& mesh, Meshlet& meshlet);
+};
+
+class MeshletCuller
+{
+public:
+	struct Stats
+	{
+		std::uint32_t MeshletsTested = 0;
+		std::uint32_t FrustumCulled = 0;
+		std::uint32_t BackfaceCulled = 0;
+		std::uint32_t MeshletsVisible = 0;
+		std::uint32_t TrianglesTested = 0;
+		std::uint32_t TrianglesVisible = 0;
+		float CullMilliseconds = 0.0f;
+	};
+
+	struct DrawRange
+	{
+		std::uint32_t IndexCount = 0;
+		std::uint32_t StartIndexLocation = 0;
+	};
+
+	// localFrustum and localEyePos must be in the mesh's local space, the same
+	// way InstancingAndCullingApp transforms the camera frustum per instance.
+	// Visible meshlet indices are appended to visible in ascending order.
+	static void Cull(
+		const MeshletMesh& mesh,
+		const MeshletFrustum& localFrustum,
+		const SimdMath::Float3& localEyePos,
+		std::vector<std::uint32_t>& visible,
+		Stats* stats = nullptr);
+
+	// Merges runs of consecutive visible meshlets into single index ranges.
+	static void BuildDrawRanges(
+		const MeshletMesh& mesh,
+		const std::vector<std::uint32_t>& visible,
+		std::vector<DrawRange>& ranges);
+
+	static bool IsBackfacing(const Meshlet& meshlet, const SimdMath::Float3& localEyePos);
+};
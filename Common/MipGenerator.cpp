@@ -0,0 +1,622 @@
+//***************************************************************************************
+// MipGenerator.cpp by DanielDFY
+//***************************************************************************************
+
+#include "MipGenerator.h"
+#include "SimdMath.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+
+using SimdMath::Float4;
+using SimdMath::Vector;
+
+namespace
+{
+	struct FormatInfo
+	{
+		bool Bgr = false;
+		bool Srgb = false;
+		bool Opaque = false;  // X8: the fourth byte is not alpha
+	};
+
+	bool GetFormatInfo(DXGI_FORMAT format, FormatInfo* info)
+	{
+		*info = FormatInfo();
+		switch(format)
+		{
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB: info->Srgb = true; return true;
+		case DXGI_FORMAT_R8G8B8A8_UNORM:      return true;
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB: info->Srgb = true; info->Bgr = true; return true;
+		case DXGI_FORMAT_B8G8R8A8_UNORM:      info->Bgr = true; return true;
+		case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB: info->Srgb = true; info->Bgr = true; info->Opaque = true; return true;
+		case DXGI_FORMAT_B8G8R8X8_UNORM:      info->Bgr = true; info->Opaque = true; return true;
+		default:                              return false;
+		}
+	}
+
+	// 8 bit values to linear floats, and the linear values halfway between
+	// consecutive sRGB codes, so encoding rounds exactly like the formula.
+	// SrgbStart[i] is the code of linear value i / SrgbStartSteps, where the
+	// search for the code of the values above it begins.
+	const int SrgbStartSteps = 1024;
+
+	struct ConversionTables
+	{
+		float ToLinear[256];
+		float SrgbToLinear[256];
+		float SrgbMidpoints[255];
+		std::uint8_t SrgbStart[SrgbStartSteps + 1];
+
+		ConversionTables()
+		{
+			for(int i = 0; i < 256; ++i)
+			{
+				ToLinear[i] = i / 255.0f;
+				SrgbToLinear[i] = DecodeSrgb(i / 255.0f);
+			}
+			for(int i = 0; i < 255; ++i)
+				SrgbMidpoints[i] = DecodeSrgb((i + 0.5f) / 255.0f);
+			for(int i = 0; i <= SrgbStartSteps; ++i)
+			{
+				float linear = (float)i / SrgbStartSteps;
+				SrgbStart[i] = (std::uint8_t)(std::upper_bound(SrgbMidpoints, SrgbMidpoints + 255, linear) - SrgbMidpoints);
+			}
+		}
+
+		static float DecodeSrgb(float c)
+		{
+			return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+	};
+
+	const ConversionTables& Tables()
+	{
+		static const ConversionTables tables;
+		return tables;
+	}
+
+	// linear in [0, 1].
+	std::uint8_t EncodeSrgb(const ConversionTables& tables, float linear)
+	{
+		std::uint32_t code = tables.SrgbStart[(int)(linear * SrgbStartSteps)];
+		while(code < 255 && linear >= tables.SrgbMidpoints[code])
+			++code;
+		return (std::uint8_t)code;
+	}
+
+	//----------------------------------------------------------------------------------
+	// Filters
+	//----------------------------------------------------------------------------------
+
+	float Sinc(float x)
+	{
+		x *= SimdMath::Pi;
+		return std::fabs(x) < 1e-5f ? 1.0f : std::sin(x) / x;
+	}
+
+	// Modified Bessel function of the first kind, order 0, for the Kaiser window.
+	float BesselI0(float x)
+	{
+		float sum = 1.0f;
+		float term = 1.0f;
+		float halfX = 0.5f * x;
+		for(int k = 1; k < 32; ++k)
+		{
+			term *= (halfX / k) * (halfX / k);
+			sum += term;
+			if(term < sum * 1e-8f)
+				break;
+		}
+		return sum;
+	}
+
+	// Half width of the filter, in texels of the destination mip.
+	float FilterSupport(MipGenerator::Filter filter)
+	{
+		return filter == MipGenerator::Filter::Box ? 0.5f : 3.0f;
+	}
+
+	float FilterWeight(MipGenerator::Filter filter, float x)
+	{
+		const float KaiserAlpha = 4.0f;
+
+		x = std::fabs(x);
+		switch(filter)
+		{
+		case MipGenerator::Filter::Box:
+			return x <= 0.5f ? 1.0f : 0.0f;
+
+		case MipGenerator::Filter::Kaiser:
+		{
+			if(x >= 3.0f)
+				return 0.0f;
+			float t = x / 3.0f;
+			return Sinc(x) * BesselI0(KaiserAlpha * std::sqrt(1.0f - t * t)) / BesselI0(KaiserAlpha);
+		}
+
+		case MipGenerator::Filter::Lanczos:
+			return x >= 3.0f ? 0.0f : Sinc(x) * Sinc(x / 3.0f);
+		}
+
+		return 0.0f;
+	}
+
+	// Taps of a 1D resampling from srcSize to dstSize texels, with the edge
+	// addressing resolved and the weights of each destination texel summing
+	// to one.
+	struct Kernel
+	{
+		std::uint32_t Taps = 0;
+		std::vector<std::uint32_t> Index;
+		std::vector<float> Weight;
+	};
+
+	Kernel BuildKernel(MipGenerator::Filter filter, std::uint32_t srcSize, std::uint32_t dstSize, bool wrap)
+	{
+		Kernel k;
+		if(srcSize == dstSize)
+		{
+			// A side that is already 1 texel.
+			k.Taps = 1;
+			for(std::uint32_t i = 0; i < dstSize; ++i)
+			{
+				k.Index.push_back(i);
+				k.Weight.push_back(1.0f);
+			}
+			return k;
+		}
+
+		float scale = (float)srcSize / dstSize;
+		float radius = FilterSupport(filter) * scale;
+		k.Taps = (std::uint32_t)std::ceil(2.0f * radius) + 1;
+		k.Index.resize((size_t)dstSize * k.Taps);
+		k.Weight.resize((size_t)dstSize * k.Taps);
+
+		for(std::uint32_t i = 0; i < dstSize; ++i)
+		{
+			float center = (i + 0.5f) * scale;
+			int first = (int)std::floor(center - radius);
+
+			float sum = 0.0f;
+			for(std::uint32_t t = 0; t < k.Taps; ++t)
+			{
+				int j = first + (int)t;
+				float w = FilterWeight(filter, (j + 0.5f - center) / scale);
+
+				int size = (int)srcSize;
+				if(wrap)
+					j = ((j % size) + size) % size;
+				else
+					j = j < 0 ? 0 : (j >= size ? size - 1 : j);
+
+				k.Index[i * k.Taps + t] = (std::uint32_t)j;
+				k.Weight[i * k.Taps + t] = w;
+				sum += w;
+			}
+
+			for(std::uint32_t t = 0; t < k.Taps; ++t)
+				k.Weight[i * k.Taps + t] /= sum;
+		}
+
+		return k;
+	}
+
+	//----------------------------------------------------------------------------------
+	// Per slice work
+	//----------------------------------------------------------------------------------
+
+	struct Context
+	{
+		MipGenerator::Settings Settings;
+		FormatInfo Info;
+		const std::vector<DDSFile::Subresource>* Tops = nullptr;
+		MipGenerator::Image* Image = nullptr;
+
+		// Per mip; [0] is unused.
+		std::vector<Kernel> Horizontal;
+		std::vector<Kernel> Vertical;
+	};
+
+	// Float texels of the slice being filtered, linear RGBA.
+	struct Scratch
+	{
+		std::vector<Float4> Level;
+		std::vector<Float4> Rows;
+		std::vector<Float4> Next;
+	};
+
+	// job(i) for every i in [0, count), across the pool if there is one.
+	void ForEach(ThreadPool* pool, std::uint32_t count, const std::function<void(std::uint32_t)>& job)
+	{
+		if(pool != nullptr)
+		{
+			pool->ParallelFor(count, [&](std::uint32_t i, std::uint32_t) { job(i); });
+		}
+		else
+		{
+			for(std::uint32_t i = 0; i < count; ++i)
+				job(i);
+		}
+	}
+
+	float AlphaCoverage(const std::vector<Float4>& texels, float scale, float reference)
+	{
+		size_t passed = 0;
+		for(const Float4& t : texels)
+		{
+			if(t.w * scale >= reference)
+				++passed;
+		}
+		return (float)passed / texels.size();
+	}
+
+	// The alpha scale that brings the coverage of texels closest to target.
+	float CoverageScale(const std::vector<Float4>& texels, float reference, float target)
+	{
+		if(target <= 0.0f || target >= 1.0f)
+			return 1.0f;
+
+		float lo = 0.0f;
+		float hi = 1.0f;
+		while(AlphaCoverage(texels, hi, reference) < target && hi < 256.0f)
+		{
+			lo = hi;
+			hi *= 2.0f;
+		}
+
+		for(int iteration = 0; iteration < 12; ++iteration)
+		{
+			float mid = 0.5f * (lo + hi);
+			if(AlphaCoverage(texels, mid, reference) < target)
+				lo = mid;
+			else
+				hi = mid;
+		}
+
+		return hi;
+	}
+
+	void DecodeRow(const Context& c, const std::uint8_t* src, std::uint32_t width, Float4* dst)
+	{
+		const ConversionTables& tables = Tables();
+		const float* color = c.Info.Srgb ? tables.SrgbToLinear : tables.ToLinear;
+		int r = c.Info.Bgr ? 2 : 0;
+		int b = c.Info.Bgr ? 0 : 2;
+		for(std::uint32_t x = 0; x < width; ++x)
+		{
+			const std::uint8_t* p = src + x * 4;
+			dst[x].x = color[p[r]];
+			dst[x].y = color[p[1]];
+			dst[x].z = color[p[b]];
+			dst[x].w = c.Info.Opaque ? 1.0f : tables.ToLinear[p[3]];
+		}
+	}
+
+	void EncodeRow(const Context& c, const Float4* src, std::uint32_t width, float alphaScale, std::uint8_t* dst)
+	{
+		const Vector scale = SimdMath::VectorSet(255.0f, 255.0f, 255.0f, 255.0f * alphaScale);
+		const Vector half = SimdMath::VectorReplicate(0.5f);
+		const ConversionTables& tables = Tables();
+		int r = c.Info.Bgr ? 2 : 0;
+		int b = c.Info.Bgr ? 0 : 2;
+		for(std::uint32_t x = 0; x < width; ++x)
+		{
+			Float4 v;
+			SimdMath::StoreFloat4(&v, SimdMath::VectorMin(
+				SimdMath::VectorMultiplyAdd(SimdMath::LoadFloat4(&src[x]), scale, half),
+				SimdMath::VectorReplicate(255.5f)));
+
+			std::uint8_t* p = dst + x * 4;
+			if(c.Info.Srgb)
+			{
+				p[r] = EncodeSrgb(tables, src[x].x);
+				p[1] = EncodeSrgb(tables, src[x].y);
+				p[b] = EncodeSrgb(tables, src[x].z);
+			}
+			else
+			{
+				p[r] = (std::uint8_t)v.x;
+				p[1] = (std::uint8_t)v.y;
+				p[b] = (std::uint8_t)v.z;
+			}
+			p[3] = c.Info.Opaque ? 255 : (std::uint8_t)v.w;
+		}
+	}
+
+	// Filters the whole chain of one slice; rowPool, if given, splits the rows
+	// of every pass.
+	void BuildSlice(const Context& c, std::uint32_t slice, Scratch& s, ThreadPool* rowPool)
+	{
+		const DDSFile::Subresource& top = (*c.Tops)[slice];
+		MipGenerator::Image& image = *c.Image;
+
+		std::uint32_t width = top.Width;
+		std::uint32_t height = top.Height;
+
+		const DDSFile::Subresource& out0 = image.GetSubresource(0, slice);
+		s.Level.resize((size_t)width * height);
+		ForEach(rowPool, height, [&](std::uint32_t y)
+		{
+			const std::uint8_t* src = top.Data + y * top.RowPitch;
+			std::copy(src, src + out0.RowPitch, image.Data.data() + out0.Offset + y * out0.RowPitch);
+			DecodeRow(c, src, width, &s.Level[(size_t)y * width]);
+		});
+
+		float reference = c.Settings.AlphaReference;
+		bool preserveCoverage = c.Settings.PreserveAlphaCoverage && !c.Info.Opaque && reference > 0.0f;
+		float targetCoverage = preserveCoverage ? AlphaCoverage(s.Level, 1.0f, reference) : 0.0f;
+
+		for(std::uint32_t mip = 1; mip < image.Desc.MipLevels; ++mip)
+		{
+			const Kernel& kx = c.Horizontal[mip];
+			const Kernel& ky = c.Vertical[mip];
+			const DDSFile::Subresource& out = image.GetSubresource(mip, slice);
+			std::uint32_t dstWidth = out.Width;
+			std::uint32_t dstHeight = out.Height;
+
+			// Rows: width -> dstWidth.
+			s.Rows.resize((size_t)dstWidth * height);
+			ForEach(rowPool, height, [&](std::uint32_t y)
+			{
+				const Float4* src = &s.Level[(size_t)y * width];
+				Float4* dst = &s.Rows[(size_t)y * dstWidth];
+				for(std::uint32_t x = 0; x < dstWidth; ++x)
+				{
+					const std::uint32_t* index = &kx.Index[(size_t)x * kx.Taps];
+					const float* weight = &kx.Weight[(size_t)x * kx.Taps];
+
+					Vector sum = SimdMath::VectorZero();
+					for(std::uint32_t t = 0; t < kx.Taps; ++t)
+						sum = SimdMath::VectorMultiplyAdd(SimdMath::VectorReplicate(weight[t]), SimdMath::LoadFloat4(&src[index[t]]), sum);
+					SimdMath::StoreFloat4(&dst[x], sum);
+				}
+			});
+
+			// Columns: height -> dstHeight.  Negative lobes can overshoot, so
+			// each mip is clamped before it feeds the next.
+			s.Next.resize((size_t)dstWidth * dstHeight);
+			ForEach(rowPool, dstHeight, [&](std::uint32_t y)
+			{
+				const std::uint32_t* index = &ky.Index[(size_t)y * ky.Taps];
+				const float* weight = &ky.Weight[(size_t)y * ky.Taps];
+				Float4* dst = &s.Next[(size_t)y * dstWidth];
+				for(std::uint32_t x = 0; x < dstWidth; ++x)
+				{
+					Vector sum = SimdMath::VectorZero();
+					for(std::uint32_t t = 0; t < ky.Taps; ++t)
+						sum = SimdMath::VectorMultiplyAdd(SimdMath::VectorReplicate(weight[t]), SimdMath::LoadFloat4(&s.Rows[(size_t)index[t] * dstWidth + x]), sum);
+					SimdMath::StoreFloat4(&dst[x], SimdMath::VectorSaturate(sum));
+				}
+			});
+
+			std::swap(s.Level, s.Next);
+			width = dstWidth;
+			height = dstHeight;
+
+			// Only the stored alpha is scaled; the next mip is filtered from the
+			// unscaled one.
+			float alphaScale = preserveCoverage ? CoverageScale(s.Level, reference, targetCoverage) : 1.0f;
+			ForEach(rowPool, height, [&](std::uint32_t y)
+			{
+				EncodeRow(c, &s.Level[(size_t)y * width], width, alphaScale,
+					image.Data.data() + out.Offset + y * out.RowPitch);
+			});
+		}
+	}
+}
+
+std::string MipGenerator::Report::ToString()const
+{
+	std::ostringstream outs;
+	outs << ArraySize << (ArraySize == 1 ? " slice" : " slices") << " x " << MipLevels << " mips, " <<
+		GeneratedTexels / 1000 << "K texels generated in " << Milliseconds << " ms";
+	return outs.str();
+}
+
+bool MipGenerator::IsSupported(DXGI_FORMAT format)
+{
+	FormatInfo info;
+	return GetFormatInfo(format, &info);
+}
+
+std::uint32_t MipGenerator::FullMipLevels(std::uint32_t width, std::uint32_t height)
+{
+	std::uint32_t levels = 1;
+	while(width > 1 || height > 1)
+	{
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		++levels;
+	}
+	return levels;
+}
+
+MipGenerator::Status MipGenerator::Generate(DXGI_FORMAT format, std::uint32_t width, std::uint32_t height,
+	const std::uint8_t* texels, std::uint64_t rowPitch, const Settings& settings, Image* image,
+	ThreadPool* pool, Report* report)
+{
+	DDSFile::Desc desc;
+	desc.Dimension = DDSFile::TextureDimension::Texture2D;
+	desc.Format = format;
+	desc.Width = width;
+	desc.Height = height;
+	desc.Depth = 1;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+
+	DDSFile::Subresource top;
+	top.Data = texels;
+	top.Width = width;
+	top.Height = height;
+	top.Depth = 1;
+	top.RowPitch = rowPitch;
+	top.SlicePitch = rowPitch * height;
+	top.RowCount = height;
+
+	return Generate(desc, std::vector<DDSFile::Subresource>(1, top), settings, image, pool, report);
+}
+
+MipGenerator::Status MipGenerator::Generate(const DDSFile& file, const Settings& settings, Image* image,
+	ThreadPool* pool, Report* report)
+{
+	const DDSFile::Desc& desc = file.GetDesc();
+	if(desc.Dimension != DDSFile::TextureDimension::Texture2D)
+		return Status::NotSupported;
+
+	std::vector<DDSFile::Subresource> tops;
+	for(std::uint32_t slice = 0; slice < desc.ArraySize; ++slice)
+		tops.push_back(file.GetSubresource(0, slice));
+
+	return Generate(desc, tops, settings, image, pool, report);
+}
+
+MipGenerator::Status MipGenerator::Generate(const DDSFile::Desc& desc, const std::vector<DDSFile::Subresource>& tops,
+	const Settings& settings, Image* image, ThreadPool* pool, Report* report)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	Context c;
+	if(!GetFormatInfo(desc.Format, &c.Info) || desc.Dimension != DDSFile::TextureDimension::Texture2D ||
+		desc.Width == 0 || desc.Height == 0 || tops.empty())
+	{
+		return Status::NotSupported;
+	}
+
+	std::uint32_t fullMipLevels = FullMipLevels(desc.Width, desc.Height);
+	std::uint32_t mipLevels = settings.MipLevels == 0 || settings.MipLevels > fullMipLevels ?
+		fullMipLevels : settings.MipLevels;
+
+	c.Settings = settings;
+	c.Tops = &tops;
+	c.Image = image;
+
+	// Lay the chain out slice after slice, as in a DDS file.
+	image->Desc = desc;
+	image->Desc.MipLevels = mipLevels;
+	image->Desc.ArraySize = (std::uint32_t)tops.size();
+	image->Subresources.clear();
+
+	std::uint64_t offset = 0;
+	for(std::uint32_t slice = 0; slice < image->Desc.ArraySize; ++slice)
+	{
+		std::uint32_t w = desc.Width;
+		std::uint32_t h = desc.Height;
+		for(std::uint32_t mip = 0; mip < mipLevels; ++mip)
+		{
+			DDSFile::Subresource s;
+			s.Offset = offset;
+			s.Width = w;
+			s.Height = h;
+			s.Depth = 1;
+			s.RowPitch = (std::uint64_t)w * 4;
+			s.SlicePitch = s.RowPitch * h;
+			s.RowCount = h;
+			image->Subresources.push_back(s);
+
+			offset += s.SlicePitch;
+			w = w > 1 ? w / 2 : 1;
+			h = h > 1 ? h / 2 : 1;
+		}
+	}
+
+	image->Data.resize((size_t)offset);
+	for(DDSFile::Subresource& s : image->Subresources)
+		s.Data = image->Data.data() + s.Offset;
+
+	c.Horizontal.resize(mipLevels);
+	c.Vertical.resize(mipLevels);
+	for(std::uint32_t mip = 1; mip < mipLevels; ++mip)
+	{
+		const DDSFile::Subresource& src = image->GetSubresource(mip - 1, 0);
+		const DDSFile::Subresource& dst = image->GetSubresource(mip, 0);
+		c.Horizontal[mip] = BuildKernel(settings.MipFilter, src.Width, dst.Width, settings.WrapAddress);
+		c.Vertical[mip] = BuildKernel(settings.MipFilter, src.Height, dst.Height, settings.WrapAddress);
+	}
+
+	std::uint32_t workers = pool != nullptr ? pool->WorkerCount() : 1;
+	std::vector<Scratch> scratch(workers);
+	if(pool != nullptr && image->Desc.ArraySize >= workers)
+	{
+		pool->ParallelFor(image->Desc.ArraySize, [&](std::uint32_t slice, std::uint32_t worker)
+		{
+			BuildSlice(c, slice, scratch[worker], nullptr);
+		});
+	}
+	else
+	{
+		for(std::uint32_t slice = 0; slice < image->Desc.ArraySize; ++slice)
+			BuildSlice(c, slice, scratch[0], pool);
+	}
+
+	if(report != nullptr)
+	{
+		Report r;
+		r.MipLevels = mipLevels;
+		r.ArraySize = image->Desc.ArraySize;
+		for(std::uint32_t slice = 0; slice < r.ArraySize; ++slice)
+		{
+			for(std::uint32_t mip = 1; mip < mipLevels; ++mip)
+			{
+				const DDSFile::Subresource& s = image->GetSubresource(mip, slice);
+				r.GeneratedTexels += (std::uint64_t)s.Width * s.Height;
+			}
+		}
+		r.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		*report = r;
+	}
+
+	return Status::Ok;
+}
+
+MipGenerator::Status MipGenerator::GenerateDDS(const std::string& input, const std::string& output,
+	const Settings& settings, ThreadPool* pool, Report* report)
+{
+	DDSFile file;
+	if(file.Open(input) != DDSFile::Status::Ok)
+		return Status::OpenFailed;
+
+	Image image;
+	Status status = Generate(file, settings, &image, pool, report);
+	if(status != Status::Ok)
+		return status;
+
+	std::ofstream out(output, std::ios::binary | std::ios::trunc);
+	if(!out)
+		return Status::WriteFailed;
+
+	bool written = DDSFile::WriteHeader(out, image.Desc, file.Header()->reserved1);
+	if(written)
+	{
+		out.write((const char*)image.Data.data(), (std::streamsize)image.Data.size());
+		out.close();
+		written = !out.fail();
+	}
+
+	if(!written)
+	{
+		out.close();
+		std::remove(output.c_str());
+		return Status::WriteFailed;
+	}
+
+	return Status::Ok;
+}
+
+const char* MipGenerator::StatusToString(Status status)
+{
+	switch(status)
+	{
+	case Status::Ok:           return "Ok";
+	case Status::OpenFailed:   return "OpenFailed";
+	case Status::NotSupported: return "NotSupported";
+	case Status::WriteFailed:  return "WriteFailed";
+	}
+
+	return "Unknown";
+}
@@ -0,0 +1,126 @@
+//***************************************************************************************
+// MipGenerator.h by DanielDFY
+//
+// Builds the mip chain of 8 bit RGBA textures on the CPU, for DDS files saved
+// with a single mip and for textures the demos create in code.  Without mips,
+// minified textures alias and every sample touches a new cache line.
+//
+// Each mip is filtered from the previous one at float precision with one of
+//   Box     : 2x2 average, the cheapest and the softest
+//   Kaiser  : Kaiser windowed sinc over 3 texels each side, sharper, little
+//             ringing; the default
+//   Lanczos : Lanczos 3, the sharpest, with the most ringing
+// applied separably, rows then columns.  Filtering is done in linear space:
+// sRGB formats are decoded before and encoded after, so dark and bright
+// texels average to the right brightness.  Alpha is always linear.
+//
+// Alpha tested textures (foliage, fences) lose coverage in the smaller mips as
+// alpha is averaged towards the test reference, so the trees thin out in the
+// distance.  PreserveAlphaCoverage scales each mip's alpha so the same share
+// of texels passes the test as in the top mip.
+//
+// Texels are processed as SimdMath vectors, all four channels at once.  Array
+// slices are handed to the workers of a ThreadPool when there are at least as
+// many slices as workers; otherwise the rows of every pass are split instead.
+//***************************************************************************************
+
+#pragma once
+
+#include "DDSFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+class MipGenerator
+{
+public:
+	enum class Filter
+	{
+		Box,
+		Kaiser,
+		Lanczos
+	};
+
+	enum class Status
+	{
+		Ok,
+		OpenFailed,    // the input could not be opened or parsed
+		NotSupported,  // not an 8 bit RGBA/BGRA 2D texture
+		WriteFailed
+	};
+
+	struct Settings
+	{
+		Filter MipFilter = Filter::Kaiser;
+
+		// Levels in the output including the top one; 0 for the full chain
+		// down to 1x1.
+		std::uint32_t MipLevels = 0;
+
+		// Filter taps past the edges wrap around instead of repeating the edge
+		// texels; for textures that tile.
+		bool WrapAddress = false;
+
+		// Keep the share of texels with alpha >= AlphaReference, which is what
+		// clip(alpha - AlphaReference) lets through, the same in every mip.
+		bool PreserveAlphaCoverage = false;
+		float AlphaReference = 0.5f;
+	};
+
+	// A texture held in memory, laid out like a DDS file: every mip of slice
+	// 0, then every mip of slice 1, and so on, rows packed without padding.
+	// Subresources point into Data in that order.
+	struct Image
+	{
+		DDSFile::Desc Desc;
+		std::vector<std::uint8_t> Data;
+		std::vector<DDSFile::Subresource> Subresources;
+
+		const DDSFile::Subresource& GetSubresource(std::uint32_t mip, std::uint32_t arraySlice)const
+		{
+			return Subresources[mip + arraySlice * Desc.MipLevels];
+		}
+	};
+
+	struct Report
+	{
+		std::uint32_t MipLevels = 0;
+		std::uint32_t ArraySize = 0;
+
+		// Texels written below the top mip.
+		std::uint64_t GeneratedTexels = 0;
+
+		double Milliseconds = 0.0;
+
+		std::string ToString()const;
+	};
+
+	// R8G8B8A8, B8G8R8A8 and B8G8R8X8, UNORM or SRGB.
+	static bool IsSupported(DXGI_FORMAT format);
+
+	// Levels of the full chain for a top mip of the given size.
+	static std::uint32_t FullMipLevels(std::uint32_t width, std::uint32_t height);
+
+	// The chain of a single 2D texture from its top mip.
+	static Status Generate(DXGI_FORMAT format, std::uint32_t width, std::uint32_t height,
+		const std::uint8_t* texels, std::uint64_t rowPitch, const Settings& settings, Image* image,
+		ThreadPool* pool = nullptr, Report* report = nullptr);
+
+	// The chain of every slice of a 2D texture (arrays and cubes included)
+	// from the top mips in file; mips the file already has are replaced.
+	static Status Generate(const DDSFile& file, const Settings& settings, Image* image,
+		ThreadPool* pool = nullptr, Report* report = nullptr);
+
+	// Generate from input, written as a DDS file with the reserved words of
+	// the input's header.
+	static Status GenerateDDS(const std::string& input, const std::string& output,
+		const Settings& settings, ThreadPool* pool = nullptr, Report* report = nullptr);
+
+	static const char* StatusToString(Status status);
+
+private:
+	static Status Generate(const DDSFile::Desc& desc, const std::vector<DDSFile::Subresource>& tops,
+		const Settings& settings, Image* image, ThreadPool* pool, Report* report);
+};
@@ -0,0 +1,82 @@
+//***************************************************************************************
+// ParallelCommandLists.h by DanielDFY
+//
+// Command lists that can be recorded concurrently: listCount lists, each with
+// its own allocator per frame resource (an allocator must not be used by two
+// threads at once, nor reset while the GPU still executes its commands).
+//
+// Usage per frame:
+//   BeginFrame(frameIndex)       on the main thread, after the frame's fence wait
+//   Begin(i) ... Close()         on any thread, one thread per list
+//   List(i)                      collect the lists in a fixed order and execute
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class ParallelCommandLists
+{
+public:
+	ParallelCommandLists(ID3D12Device* device, UINT frameCount, UINT listCount,
+		D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT) :
+		mListCount(listCount)
+	{
+		mAllocators.resize(frameCount * listCount);
+		for(auto& a : mAllocators)
+			ThrowIfFailed(device->CreateCommandAllocator(type, IID_PPV_ARGS(a.GetAddressOf())));
+
+		mLists.resize(listCount);
+		for(auto& l : mLists)
+		{
+			ThrowIfFailed(device->CreateCommandList(0, type, mAllocators[0].Get(), nullptr,
+				IID_PPV_ARGS(l.GetAddressOf())));
+
+			// Lists are created open; Begin resets them.
+			ThrowIfFailed(l->Close());
+		}
+	}
+
+	ParallelCommandLists(const ParallelCommandLists& rhs) = delete;
+	ParallelCommandLists& operator=(const ParallelCommandLists& rhs) = delete;
+
+	UINT ListCount()const
+	{
+		return mListCount;
+	}
+
+	// Resets the allocators of the frame resource.  The GPU must be done with
+	// the commands recorded the last time this frame resource was used.
+	void BeginFrame(UINT frameIndex)
+	{
+		mFrameIndex = frameIndex;
+		for(UINT i = 0; i < mListCount; ++i)
+			ThrowIfFailed(Allocator(i)->Reset());
+	}
+
+	// Opens list i on the current frame's allocator.  Different lists may be
+	// opened and recorded on different threads at the same time.
+	ID3D12GraphicsCommandList* Begin(UINT i, ID3D12PipelineState* initialState = nullptr)
+	{
+		ThrowIfFailed(mLists[i]->Reset(Allocator(i), initialState));
+		return mLists[i].Get();
+	}
+
+	ID3D12GraphicsCommandList* List(UINT i)const
+	{
+		return mLists[i].Get();
+	}
+
+private:
+	ID3D12CommandAllocator* Allocator(UINT i)const
+	{
+		return mAllocators[mFrameIndex * mListCount + i].Get();
+	}
+
+private:
+	UINT mListCount = 0;
+	UINT mFrameIndex = 0;
+
+	std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> mAllocators;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>> mLists;
+};
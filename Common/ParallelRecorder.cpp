@@ -0,0 +1,53 @@
+//***************************************************************************************
+// ParallelRecorder.cpp by DanielDFY
+//***************************************************************************************
+
+#include "ParallelRecorder.h"
+#include <chrono>
+
+ParallelRecorder::ParallelRecorder(ThreadPool& pool) :
+	mPool(pool)
+{
+}
+
+ParallelRecorder::Stats ParallelRecorder::Record(const DrawPacketQueue& queue, std::uint32_t chunkCount,
+	bool filterRedundant, const ChunkRecorded& onRecorded)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	if(mStreams.size() < chunkCount)
+		mStreams.resize(chunkCount);
+	mChunkStats.assign(chunkCount, DrawPacketQueue::SubmitStats());
+
+	size_t packetCount = queue.Size();
+
+	mPool.ParallelFor(chunkCount, [&](std::uint32_t chunk, std::uint32_t worker)
+	{
+		// Even split, chunk sizes differ by at most one packet.
+		size_t first = packetCount * chunk / chunkCount;
+		size_t last = packetCount * (chunk + 1) / chunkCount;
+
+		CommandStream& stream = mStreams[chunk];
+		stream.Clear();
+		mChunkStats[chunk] = queue.Submit(stream, filterRedundant, first, last - first);
+
+		if(onRecorded)
+			onRecorded(chunk, worker, stream);
+	});
+
+	Stats stats;
+	stats.Chunks = chunkCount;
+	for(std::uint32_t i = 0; i < chunkCount; ++i)
+	{
+		stats.Packets += mChunkStats[i].Packets;
+		stats.StateChanges += mChunkStats[i].StateChanges;
+		stats.RedundantStateSkipped += mChunkStats[i].RedundantStateSkipped;
+		stats.Commands += mStreams[i].CommandCount();
+		stats.StreamBytes += mStreams[i].SizeInBytes();
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	stats.RecordMilliseconds = std::chrono::duration<float, std::milli>(end - start).count();
+
+	return stats;
+}
@@ -0,0 +1,50 @@
+//***************************************************************************************
+// ParallelRecorder.h by DanielDFY
+//
+// Splits the draw packets of a sorted DrawPacketQueue into contiguous chunks and
+// records each chunk into its own CommandStream on a ThreadPool worker.  The
+// callback then runs on the same worker, so the app can replay the chunk into
+// a command list owned by that chunk.  Chunk i always covers the i-th slice of
+// the sorted packets, so submitting the chunk lists in chunk order draws in
+// the same order as a single threaded Submit, whatever the thread timing.
+//
+// Without a callback only the CPU-side streams are recorded, which is how the
+// scaling can be measured without a device.
+//***************************************************************************************
+
+#pragma once
+
+#include "CommandStream.h"
+#include "ThreadPool.h"
+
+class ParallelRecorder
+{
+public:
+	typedef std::function<void(std::uint32_t chunk, std::uint32_t worker, const CommandStream& stream)> ChunkRecorded;
+
+	struct Stats
+	{
+		std::uint32_t Chunks = 0;
+		std::uint32_t Packets = 0;
+		std::uint32_t StateChanges = 0;
+		std::uint32_t RedundantStateSkipped = 0;
+		std::uint32_t Commands = 0;
+		std::uint64_t StreamBytes = 0;
+		float RecordMilliseconds = 0.0f;
+	};
+
+	explicit ParallelRecorder(ThreadPool& pool);
+
+	// Every chunk starts with nothing bound, so a few bindings are repeated at
+	// chunk boundaries compared to one Submit over all packets.
+	Stats Record(const DrawPacketQueue& queue, std::uint32_t chunkCount, bool filterRedundant,
+		const ChunkRecorded& onRecorded = ChunkRecorded());
+
+	const CommandStream& Stream(std::uint32_t chunk)const { return mStreams[chunk]; }
+
+private:
+	ThreadPool& mPool;
+
+	std::vector<CommandStream> mStreams;
+	std::vector<DrawPacketQueue::SubmitStats> mChunkStats;
+};
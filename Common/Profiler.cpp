@@ -0,0 +1,324 @@
+//***************************************************************************************
+// Profiler.cpp by DanielDFY
+//***************************************************************************************
+
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+
+const std::uint32_t Profiler::EventsPerThread;
+
+struct Profiler::ThreadBuffer
+{
+	// Slots are atomics so that exporting while the owner records is well
+	// defined; relaxed loads and stores compile to plain moves.
+	struct Slot
+	{
+		std::atomic<const char*> Name;
+		std::atomic<std::uint64_t> Begin;
+		std::atomic<std::uint64_t> End;
+		std::atomic<std::uint32_t> Depth;
+	};
+
+	std::unique_ptr<Slot[]> Slots;
+
+	// Number of events ever written, and where the last Reset left it.  Only
+	// the owning thread advances Head.
+	std::atomic<std::uint64_t> Head;
+	std::atomic<std::uint64_t> Tail;
+
+	// Scopes currently open on the owning thread.
+	std::uint32_t Depth = 0;
+
+	std::uint32_t Id = 0;
+	std::string Name;
+};
+
+Profiler& Profiler::Get()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+std::uint64_t Profiler::Now()
+{
+	return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Profiler::Profiler() :
+	mEnabled(true),
+	mStartTime(Now())
+{
+}
+
+Profiler::ThreadBuffer* Profiler::GetThreadBuffer()
+{
+	// Hands the buffer back when the thread exits.
+	struct Owner
+	{
+		ThreadBuffer* Buffer = nullptr;
+
+		~Owner()
+		{
+			if(Buffer != nullptr)
+				Profiler::Get().ReleaseThreadBuffer(Buffer);
+		}
+	};
+
+	static thread_local Owner owner;
+	if(owner.Buffer == nullptr)
+		owner.Buffer = AcquireThreadBuffer();
+
+	return owner.Buffer;
+}
+
+Profiler::ThreadBuffer* Profiler::AcquireThreadBuffer()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	// Take over the buffer of an exited thread, dropping its events.
+	if(!mFreeBuffers.empty())
+	{
+		ThreadBuffer* b = mFreeBuffers.back();
+		mFreeBuffers.pop_back();
+
+		b->Tail.store(b->Head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		b->Depth = 0;
+		b->Name = "Thread " + std::to_string(b->Id);
+		return b;
+	}
+
+	auto b = std::make_unique<ThreadBuffer>();
+	b->Slots.reset(new ThreadBuffer::Slot[EventsPerThread]());
+	b->Head.store(0, std::memory_order_relaxed);
+	b->Tail.store(0, std::memory_order_relaxed);
+	b->Id = (std::uint32_t)mBuffers.size() + 1;
+	b->Name = "Thread " + std::to_string(b->Id);
+
+	mBuffers.push_back(std::move(b));
+	return mBuffers.back().get();
+}
+
+void Profiler::ReleaseThreadBuffer(ThreadBuffer* buffer)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mFreeBuffers.push_back(buffer);
+}
+
+std::uint32_t Profiler::GetThreadBufferCount()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return (std::uint32_t)mBuffers.size();
+}
+
+Profiler::ThreadBuffer* Profiler::BeginScope()
+{
+	if(!IsEnabled())
+		return nullptr;
+
+	ThreadBuffer* buffer = GetThreadBuffer();
+	buffer->Depth++;
+
+	return buffer;
+}
+
+void Profiler::EndScope(ThreadBuffer* buffer, const char* name, std::uint64_t begin, std::uint64_t end)
+{
+	std::uint64_t head = buffer->Head.load(std::memory_order_relaxed);
+	ThreadBuffer::Slot& slot = buffer->Slots[head & (EventsPerThread - 1)];
+
+	// Once the ring is full this overwrites event head - EventsPerThread.  The
+	// fence orders the previous Head store before the slot stores, so a reader
+	// that sees any of the new values also sees Head at least at head and
+	// drops the slot (the acquire fence in ReadEvents pairs with this one).
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot.Name.store(name, std::memory_order_relaxed);
+	slot.Begin.store(begin, std::memory_order_relaxed);
+	slot.End.store(end, std::memory_order_relaxed);
+	slot.Depth.store(--buffer->Depth, std::memory_order_relaxed);
+
+	buffer->Head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+	ThreadBuffer* buffer = GetThreadBuffer();
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	buffer->Name = name;
+}
+
+void Profiler::Reset()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	for(auto& b : mBuffers)
+		b->Tail.store(b->Head.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+std::vector<Profiler::Event> Profiler::ReadEvents(const ThreadBuffer& buffer)const
+{
+	std::uint64_t head = buffer.Head.load(std::memory_order_acquire);
+	std::uint64_t first = std::max(buffer.Tail.load(std::memory_order_relaxed),
+		head > EventsPerThread ? head - EventsPerThread : 0);
+
+	std::vector<Event> events;
+	events.reserve((size_t)(head - first));
+	for(std::uint64_t i = first; i < head; ++i)
+	{
+		const ThreadBuffer::Slot& slot = buffer.Slots[i & (EventsPerThread - 1)];
+
+		Event e;
+		e.Name = slot.Name.load(std::memory_order_relaxed);
+		e.Begin = slot.Begin.load(std::memory_order_relaxed);
+		e.End = slot.End.load(std::memory_order_relaxed);
+		e.Depth = slot.Depth.load(std::memory_order_relaxed);
+		events.push_back(e);
+	}
+
+	// The owner may have wrapped around while we copied.  Drop the slots it
+	// could have been overwriting; the rest were complete when we read them.
+	std::atomic_thread_fence(std::memory_order_acquire);
+	std::uint64_t newHead = buffer.Head.load(std::memory_order_relaxed);
+	if(newHead >= first + EventsPerThread)
+	{
+		size_t overwritten = (size_t)std::min<std::uint64_t>(newHead - EventsPerThread + 1 - first, events.size());
+		events.erase(events.begin(), events.begin() + overwritten);
+	}
+
+	return events;
+}
+
+std::vector<Profiler::ScopeStats> Profiler::GetScopeStats()const
+{
+	std::map<std::string, ScopeStats> byName;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	for(auto& b : mBuffers)
+	{
+		std::vector<Event> events = ReadEvents(*b);
+
+		// Events are written when scopes end, so children come before their
+		// parent.  childTime[d] sums the children of the open scope at depth d.
+		std::vector<std::uint64_t> childTime;
+		for(const Event& e : events)
+		{
+			if(childTime.size() < e.Depth + 1)
+				childTime.resize(e.Depth + 1, 0);
+
+			std::uint64_t duration = e.End - e.Begin;
+			std::uint64_t self = duration - std::min(duration, childTime[e.Depth]);
+			childTime[e.Depth] = 0;
+			if(e.Depth > 0)
+				childTime[e.Depth - 1] += duration;
+
+			double ms = duration / 1000000.0;
+
+			ScopeStats& s = byName[e.Name];
+			if(s.Calls == 0)
+			{
+				s.Name = e.Name;
+				s.MinMilliseconds = ms;
+				s.MaxMilliseconds = ms;
+			}
+			s.Calls++;
+			s.TotalMilliseconds += ms;
+			s.SelfMilliseconds += self / 1000000.0;
+			s.MinMilliseconds = std::min(s.MinMilliseconds, ms);
+			s.MaxMilliseconds = std::max(s.MaxMilliseconds, ms);
+		}
+	}
+
+	std::vector<ScopeStats> stats;
+	for(auto& e : byName)
+		stats.push_back(e.second);
+
+	std::sort(stats.begin(), stats.end(), [](const ScopeStats& a, const ScopeStats& b)
+	{
+		return a.TotalMilliseconds > b.TotalMilliseconds;
+	});
+
+	return stats;
+}
+
+std::string Profiler::ReportToString()const
+{
+	std::string s;
+	char buf[256];
+
+	snprintf(buf, sizeof(buf), "%-32s %8s %12s %12s %10s %10s %10s\n",
+		"Scope", "Calls", "Total ms", "Self ms", "Avg ms", "Min ms", "Max ms");
+	s += buf;
+
+	for(const ScopeStats& st : GetScopeStats())
+	{
+		snprintf(buf, sizeof(buf), "%-32s %8u %12.3f %12.3f %10.4f %10.4f %10.4f\n",
+			st.Name.c_str(), st.Calls, st.TotalMilliseconds, st.SelfMilliseconds,
+			st.TotalMilliseconds / st.Calls, st.MinMilliseconds, st.MaxMilliseconds);
+		s += buf;
+	}
+
+	return s;
+}
+
+static void WriteJsonString(std::ostream& os, const char* str)
+{
+	os << '"';
+	for(const char* c = str; *c != '\0'; ++c)
+	{
+		if(*c == '"' || *c == '\\')
+			os << '\\' << *c;
+		else if((unsigned char)*c < 0x20)
+			os << ' ';
+		else
+			os << *c;
+	}
+	os << '"';
+}
+
+void Profiler::WriteChromeTrace(std::ostream& os)const
+{
+	// Complete ("X") events with microsecond timestamps, plus one metadata
+	// event per thread for its name.
+	char buf[128];
+	bool first = true;
+
+	os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	for(auto& b : mBuffers)
+	{
+		os << (first ? "\n" : ",\n");
+		first = false;
+
+		os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->Id << ",\"args\":{\"name\":";
+		WriteJsonString(os, b->Name.c_str());
+		os << "}}";
+
+		for(const Event& e : ReadEvents(*b))
+		{
+			os << ",\n{\"name\":";
+			WriteJsonString(os, e.Name);
+			snprintf(buf, sizeof(buf), ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				b->Id, (e.Begin - mStartTime) / 1000.0, (e.End - e.Begin) / 1000.0);
+			os << buf;
+		}
+	}
+
+	os << "\n]}\n";
+}
+
+bool Profiler::WriteChromeTrace(const std::string& filename)const
+{
+	std::ofstream fout(filename);
+	if(!fout)
+		return false;
+
+	WriteChromeTrace(fout);
+
+	return (bool)fout;
+}
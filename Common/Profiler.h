@@ -0,0 +1,142 @@
+//***************************************************************************************
+// Profiler.h by DanielDFY
+//
+// Scoped CPU profiler.  PROFILE_SCOPE("Name") times the enclosing block and
+// records it, with its nesting depth, in a buffer owned by the calling thread.
+// Recording takes no lock: a thread only ever writes its own buffer, and the
+// buffers are rings holding the last EventsPerThread scopes, so the profiler
+// can stay enabled indefinitely.  When a thread exits its buffer goes back to
+// a free list and the next new thread takes it over, so memory is bounded by
+// the number of threads alive at once rather than ever started.
+//
+// Any thread may export what is in the buffers at any time, either as a Chrome
+// trace (open chrome://tracing or https://ui.perfetto.dev and load the file)
+// or as per-scope statistics.
+//
+// Scope names must outlive the profiler; pass string literals.  Define
+// DISABLE_PROFILER to compile every PROFILE_SCOPE out.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class Profiler
+{
+public:
+	struct ThreadBuffer;
+
+	// Times of a scope over the events currently in the buffers.  Self time
+	// excludes the time spent in nested scopes.
+	struct ScopeStats
+	{
+		std::string Name;
+		std::uint32_t Calls = 0;
+		double TotalMilliseconds = 0.0;
+		double SelfMilliseconds = 0.0;
+		double MinMilliseconds = 0.0;
+		double MaxMilliseconds = 0.0;
+	};
+
+	static const std::uint32_t EventsPerThread = 1 << 16;
+
+	static Profiler& Get();
+
+	// Nanoseconds on the steady clock.
+	static std::uint64_t Now();
+
+	Profiler(const Profiler& rhs) = delete;
+	Profiler& operator=(const Profiler& rhs) = delete;
+
+	void SetEnabled(bool enabled) { mEnabled.store(enabled, std::memory_order_relaxed); }
+	bool IsEnabled()const { return mEnabled.load(std::memory_order_relaxed); }
+
+	// Names the calling thread in the trace.
+	void SetThreadName(const std::string& name);
+
+	// Forgets the events recorded so far.
+	void Reset();
+
+	// Buffers allocated so far, including those of exited threads waiting to
+	// be reused.
+	std::uint32_t GetThreadBufferCount()const;
+
+	// Sorted by total time, largest first.
+	std::vector<ScopeStats> GetScopeStats()const;
+	std::string ReportToString()const;
+
+	void WriteChromeTrace(std::ostream& os)const;
+	bool WriteChromeTrace(const std::string& filename)const;
+
+	// Used by ProfileScope.  BeginScope returns nullptr while disabled.
+	ThreadBuffer* BeginScope();
+	static void EndScope(ThreadBuffer* buffer, const char* name, std::uint64_t begin, std::uint64_t end);
+
+private:
+	struct Event
+	{
+		const char* Name;
+		std::uint64_t Begin;
+		std::uint64_t End;
+		std::uint32_t Depth;
+	};
+
+	Profiler();
+
+	ThreadBuffer* GetThreadBuffer();
+	ThreadBuffer* AcquireThreadBuffer();
+	void ReleaseThreadBuffer(ThreadBuffer* buffer);
+	std::vector<Event> ReadEvents(const ThreadBuffer& buffer)const;
+
+private:
+	std::atomic<bool> mEnabled;
+	std::uint64_t mStartTime = 0;
+
+	mutable std::mutex mMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> mBuffers;
+
+	// Buffers of exited threads.  Their events stay exportable until a new
+	// thread takes the buffer over.
+	std::vector<ThreadBuffer*> mFreeBuffers;
+};
+
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name) :
+		mName(name)
+	{
+		mBuffer = Profiler::Get().BeginScope();
+		if(mBuffer != nullptr)
+			mBegin = Profiler::Now();
+	}
+
+	~ProfileScope()
+	{
+		if(mBuffer != nullptr)
+			Profiler::EndScope(mBuffer, mName, mBegin, Profiler::Now());
+	}
+
+	ProfileScope(const ProfileScope& rhs) = delete;
+	ProfileScope& operator=(const ProfileScope& rhs) = delete;
+
+private:
+	const char* mName;
+	Profiler::ThreadBuffer* mBuffer;
+	std::uint64_t mBegin = 0;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifndef DISABLE_PROFILER
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#endif
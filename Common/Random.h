@@ -0,0 +1,406 @@
+//***************************************************************************************
+// Random.h by DanielDFY
+//
+// Fast random number generation replacing the C rand() calls behind MathHelper.
+//
+// Random is a PCG32 generator (O'Neill, "PCG: A Family of Simple Fast
+// Space-Efficient Statistically Good Algorithms for Random Number Generation").
+// Each generator has a 64-bit seed and a 64-bit stream selector, so generators
+// with the same seed but different streams produce independent sequences.
+// Split() derives a new independent generator, e.g. one per worker job.
+//
+// Random::ThreadLocal() returns a per-thread generator, so MathHelper::RandF and
+// friends no longer serialize threads on the C runtime's global state.  Thread
+// generators use the global seed and the order in which threads first ask for
+// one as their stream.
+//
+// The Fill* functions generate large batches four lanes at a time with a
+// xoshiro128+ generator seeded from the PCG state, using SSE2/AVX2 where
+// SimdMath.h selects them.  Unit and hemisphere vectors are computed in closed
+// form, without rejection loops.
+//
+// Reproducibility: all integer outputs and the [0, 1) floats are computed with
+// exact integer arithmetic and are bit identical on every platform and backend.
+// Vectors use a polynomial sin/cos instead of the C runtime, so they only differ
+// by the rounding of fused multiply-adds on AVX2 builds.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SimdMath.h"
+
+class Random
+{
+public:
+	static const std::uint64_t DefaultSeed = 0x853c49e6748fea9bULL;
+
+	explicit Random(std::uint64_t seed = DefaultSeed, std::uint64_t stream = 0)
+	{
+		Seed(seed, stream);
+	}
+
+	void Seed(std::uint64_t seed, std::uint64_t stream = 0)
+	{
+		mState = 0;
+		mIncrement = (stream << 1) | 1;
+		NextUInt();
+		mState += seed;
+		NextUInt();
+	}
+
+	// Returns a generator whose sequence is independent of this one.  Advances
+	// this generator, so splitting twice gives two different generators.
+	Random Split()
+	{
+		std::uint64_t seed = NextUInt64();
+		std::uint64_t stream = NextUInt64();
+		return Random(seed, stream);
+	}
+
+	// Returns uniformly distributed 32 bits.
+	std::uint32_t NextUInt()
+	{
+		std::uint64_t old = mState;
+		mState = old*6364136223846793005ULL + mIncrement;
+		std::uint32_t xorShifted = (std::uint32_t)(((old >> 18u) ^ old) >> 27u);
+		std::uint32_t rot = (std::uint32_t)(old >> 59u);
+		return (xorShifted >> rot) | (xorShifted << ((32u - rot) & 31u));
+	}
+
+	std::uint64_t NextUInt64()
+	{
+		std::uint64_t hi = NextUInt();
+		return (hi << 32) | NextUInt();
+	}
+
+	// Returns an integer in [0, bound) without modulo bias (Lemire's method).
+	std::uint32_t NextUInt(std::uint32_t bound)
+	{
+		std::uint64_t m = (std::uint64_t)NextUInt()*bound;
+		std::uint32_t low = (std::uint32_t)m;
+		if(low < bound)
+		{
+			std::uint32_t threshold = (0u - bound) % bound;
+			while(low < threshold)
+			{
+				m = (std::uint64_t)NextUInt()*bound;
+				low = (std::uint32_t)m;
+			}
+		}
+		return (std::uint32_t)(m >> 32);
+	}
+
+	// Returns an integer in [a, b].
+	int NextInt(int a, int b)
+	{
+		std::uint32_t range = (std::uint32_t)((std::int64_t)b - a) + 1u;
+		if(range == 0)
+			return (int)NextUInt();
+		return (int)((std::int64_t)a + NextUInt(range));
+	}
+
+	// Returns a float in [0, 1).
+	float NextFloat()
+	{
+		return ToFloat(NextUInt());
+	}
+
+	// Returns a float in [a, b).
+	float NextFloat(float a, float b)
+	{
+		return a + NextFloat()*(b - a);
+	}
+
+	//
+	// Batch generation.  Each call consumes a fixed number of values from this
+	// generator, so results only depend on the seed and the call sequence.
+	//
+
+	// Fills out with floats in [a, b).
+	void FillFloats(float* out, size_t count, float a = 0.0f, float b = 1.0f)
+	{
+		Lanes lanes(*this);
+
+		SimdMath::Vector scale = SimdMath::VectorReplicate(b - a);
+		SimdMath::Vector bias = SimdMath::VectorReplicate(a);
+
+		size_t i = 0;
+		for(; i + 4 <= count; i += 4)
+		{
+			SimdMath::Vector v = SimdMath::VectorMultiplyAdd(lanes.NextFloat4(), scale, bias);
+			SimdMath::StoreFloat4(reinterpret_cast<SimdMath::Float4*>(out + i), v);
+		}
+
+		if(i < count)
+		{
+			SimdMath::Float4 tail;
+			SimdMath::StoreFloat4(&tail, SimdMath::VectorMultiplyAdd(lanes.NextFloat4(), scale, bias));
+			for(size_t k = 0; i < count; ++i, ++k)
+				out[i] = (&tail.x)[k];
+		}
+	}
+
+	// Fills count 3D unit vectors, uniformly distributed over the sphere.  out
+	// points to the first vector with stride bytes between consecutive vectors,
+	// so it can write straight into an XMFLOAT3 array or a vertex buffer.
+	void FillUnitVec3(float* out, size_t stride, size_t count)
+	{
+		FillSphere(out, stride, count, nullptr);
+	}
+
+	// Fills count unit vectors uniformly distributed over the hemisphere
+	// around the normal n, i.e. dot(v, n) >= 0.
+	void FillHemisphereUnitVec3(float* out, size_t stride, size_t count, const float n[3])
+	{
+		FillSphere(out, stride, count, n);
+	}
+
+	template<typename Float3T>
+	void FillUnitVec3(Float3T* out, size_t count)
+	{
+		static_assert(sizeof(Float3T) == 3*sizeof(float), "Float3T must be three packed floats.");
+		FillUnitVec3(reinterpret_cast<float*>(out), sizeof(Float3T), count);
+	}
+
+	template<typename Float3T>
+	void FillHemisphereUnitVec3(Float3T* out, size_t count, const Float3T& n)
+	{
+		static_assert(sizeof(Float3T) == 3*sizeof(float), "Float3T must be three packed floats.");
+		FillHemisphereUnitVec3(reinterpret_cast<float*>(out), sizeof(Float3T), count, reinterpret_cast<const float*>(&n));
+	}
+
+	//
+	// Per-thread generators.
+	//
+
+	// The calling thread's generator, created on first use.
+	static Random& ThreadLocal()
+	{
+		thread_local Random generator(GlobalSeed().load(), NextThreadStream());
+		return generator;
+	}
+
+	// Seed used by thread generators created after this call.  Reseeds the
+	// calling thread's generator with stream 0, so a single threaded program
+	// replays the same sequence after SetGlobalSeed.
+	static void SetGlobalSeed(std::uint64_t seed)
+	{
+		GlobalSeed().store(seed);
+		ThreadLocal().Seed(seed, 0);
+	}
+
+	// Converts the top 24 bits to a float in [0, 1).  Exact, so identical everywhere.
+	static float ToFloat(std::uint32_t bits)
+	{
+		return (float)(bits >> 8)*(1.0f / 16777216.0f);
+	}
+
+private:
+	// Four xoshiro128+ generators, one per SIMD lane.
+	struct Lanes
+	{
+		explicit Lanes(Random& source)
+		{
+			// xoshiro must not start from an all zero state; SplitMix64 of
+			// distinct inputs never gives zero for both halves.
+			for(int lane = 0; lane < 4; ++lane)
+			{
+				std::uint64_t a = SplitMix64(source.NextUInt64());
+				std::uint64_t b = SplitMix64(a);
+				s[0][lane] = (std::uint32_t)a;
+				s[1][lane] = (std::uint32_t)(a >> 32);
+				s[2][lane] = (std::uint32_t)b;
+				s[3][lane] = (std::uint32_t)(b >> 32);
+			}
+		}
+
+		// Next four raw 32-bit values, lane i in element i.
+		void NextUInt4(std::uint32_t r[4])
+		{
+#if defined(SIMDMATH_SCALAR)
+			for(int lane = 0; lane < 4; ++lane)
+			{
+				r[lane] = s[0][lane] + s[3][lane];
+
+				std::uint32_t t = s[1][lane] << 9;
+				s[2][lane] ^= s[0][lane];
+				s[3][lane] ^= s[1][lane];
+				s[1][lane] ^= s[2][lane];
+				s[0][lane] ^= s[3][lane];
+				s[2][lane] ^= t;
+				s[3][lane] = (s[3][lane] << 11) | (s[3][lane] >> 21);
+			}
+#else
+			__m128i s0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s[0]));
+			__m128i s1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s[1]));
+			__m128i s2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s[2]));
+			__m128i s3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s[3]));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(r), _mm_add_epi32(s0, s3));
+
+			__m128i t = _mm_slli_epi32(s1, 9);
+			s2 = _mm_xor_si128(s2, s0);
+			s3 = _mm_xor_si128(s3, s1);
+			s1 = _mm_xor_si128(s1, s2);
+			s0 = _mm_xor_si128(s0, s3);
+			s2 = _mm_xor_si128(s2, t);
+			s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(s[0]), s0);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(s[1]), s1);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(s[2]), s2);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(s[3]), s3);
+#endif
+		}
+
+		SimdMath::Vector NextFloat4()
+		{
+			alignas(16) std::uint32_t r[4];
+			NextUInt4(r);
+#if defined(SIMDMATH_SCALAR)
+			return SimdMath::VectorSet(ToFloat(r[0]), ToFloat(r[1]), ToFloat(r[2]), ToFloat(r[3]));
+#else
+			__m128i bits = _mm_srli_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(r)), 8);
+			return _mm_mul_ps(_mm_cvtepi32_ps(bits), _mm_set1_ps(1.0f / 16777216.0f));
+#endif
+		}
+
+		std::uint32_t s[4][4];
+	};
+
+	// Uniform sphere sampling: z uniform in [-1, 1), azimuth uniform in [0, 2pi).
+	// For the hemisphere, vectors below the plane are mirrored through the
+	// origin, which keeps the distribution uniform.
+	void FillSphere(float* out, size_t stride, size_t count, const float* n)
+	{
+		using namespace SimdMath;
+
+		Lanes lanes(*this);
+
+		const Vector one = VectorSplatOne();
+		const Vector two = VectorReplicate(2.0f);
+		const Vector four = VectorReplicate(4.0f);
+
+		Vector nx = VectorZero(), ny = VectorZero(), nz = VectorZero();
+		if(n != nullptr)
+		{
+			nx = VectorReplicate(n[0]);
+			ny = VectorReplicate(n[1]);
+			nz = VectorReplicate(n[2]);
+		}
+
+		for(size_t i = 0; i < count; i += 4)
+		{
+			Vector z = VectorSubtract(one, VectorMultiply(two, lanes.NextFloat4()));
+			Vector r = VectorSqrt(VectorMax(VectorSubtract(one, VectorMultiply(z, z)), VectorZero()));
+
+			// Azimuth as quadrant + angle within the quadrant, so sin/cos only
+			// need to be approximated on [0, pi/2).
+			Vector turns = VectorMultiply(lanes.NextFloat4(), four);
+			Vector quadrant = VectorFloor4(turns);
+			Vector angle = VectorMultiply(VectorSubtract(turns, quadrant), VectorReplicate(PiDiv2));
+
+			Vector s, c;
+			SinCosQuarter(angle, s, c);
+
+			// Rotate (c, s) by quadrant*90 degrees.
+			Vector q1 = VectorEqual(quadrant, one);
+			Vector q2 = VectorEqual(quadrant, two);
+			Vector q3 = VectorEqual(quadrant, VectorReplicate(3.0f));
+			Vector cosA = VectorSelect(c, VectorNegate(s), q1);
+			Vector sinA = VectorSelect(s, c, q1);
+			cosA = VectorSelect(cosA, VectorNegate(c), q2);
+			sinA = VectorSelect(sinA, VectorNegate(s), q2);
+			cosA = VectorSelect(cosA, s, q3);
+			sinA = VectorSelect(sinA, VectorNegate(c), q3);
+
+			Vector x = VectorMultiply(r, cosA);
+			Vector y = VectorMultiply(r, sinA);
+
+			if(n != nullptr)
+			{
+				Vector d = VectorMultiplyAdd(x, nx, VectorMultiplyAdd(y, ny, VectorMultiply(z, nz)));
+				Vector flip = VectorLess(d, VectorZero());
+				x = VectorSelect(x, VectorNegate(x), flip);
+				y = VectorSelect(y, VectorNegate(y), flip);
+				z = VectorSelect(z, VectorNegate(z), flip);
+			}
+
+			Float4 fx, fy, fz;
+			StoreFloat4(&fx, x);
+			StoreFloat4(&fy, y);
+			StoreFloat4(&fz, z);
+
+			for(size_t k = 0; k < 4 && i + k < count; ++k)
+			{
+				float* v = reinterpret_cast<float*>(reinterpret_cast<std::uint8_t*>(out) + (i + k)*stride);
+				v[0] = (&fx.x)[k];
+				v[1] = (&fy.x)[k];
+				v[2] = (&fz.x)[k];
+			}
+		}
+	}
+
+	// Floor for non-negative values below 2^23.
+	static SimdMath::Vector VectorFloor4(SimdMath::Vector v)
+	{
+#if defined(SIMDMATH_SCALAR)
+		return SimdMath::VectorSet(
+			(float)(int)v.f[0], (float)(int)v.f[1], (float)(int)v.f[2], (float)(int)v.f[3]);
+#else
+		return _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+#endif
+	}
+
+	// Taylor series of sin/cos on [0, pi/2); max error about 6e-8.
+	static void SinCosQuarter(SimdMath::Vector x, SimdMath::Vector& s, SimdMath::Vector& c)
+	{
+		using namespace SimdMath;
+
+		Vector x2 = VectorMultiply(x, x);
+
+		Vector ps = VectorReplicate(-1.0f / 39916800.0f);
+		ps = VectorMultiplyAdd(ps, x2, VectorReplicate(1.0f / 362880.0f));
+		ps = VectorMultiplyAdd(ps, x2, VectorReplicate(-1.0f / 5040.0f));
+		ps = VectorMultiplyAdd(ps, x2, VectorReplicate(1.0f / 120.0f));
+		ps = VectorMultiplyAdd(ps, x2, VectorReplicate(-1.0f / 6.0f));
+		ps = VectorMultiplyAdd(ps, x2, VectorSplatOne());
+		s = VectorMultiply(ps, x);
+
+		Vector pc = VectorReplicate(-1.0f / 3628800.0f);
+		pc = VectorMultiplyAdd(pc, x2, VectorReplicate(1.0f / 40320.0f));
+		pc = VectorMultiplyAdd(pc, x2, VectorReplicate(-1.0f / 720.0f));
+		pc = VectorMultiplyAdd(pc, x2, VectorReplicate(1.0f / 24.0f));
+		pc = VectorMultiplyAdd(pc, x2, VectorReplicate(-0.5f));
+		c = VectorMultiplyAdd(pc, x2, VectorSplatOne());
+	}
+
+	static std::uint64_t SplitMix64(std::uint64_t x)
+	{
+		x += 0x9e3779b97f4a7c15ULL;
+		x = (x ^ (x >> 30))*0xbf58476d1ce4e5b9ULL;
+		x = (x ^ (x >> 27))*0x94d049bb133111ebULL;
+		return x ^ (x >> 31);
+	}
+
+	static std::atomic<std::uint64_t>& GlobalSeed()
+	{
+		static std::atomic<std::uint64_t> seed(DefaultSeed);
+		return seed;
+	}
+
+	static std::uint64_t NextThreadStream()
+	{
+		static std::atomic<std::uint64_t> counter(0);
+		return counter.fetch_add(1);
+	}
+
+private:
+	std::uint64_t mState = 0;
+	std::uint64_t mIncrement = 1;
+};
@@ -0,0 +1,116 @@
+//***************************************************************************************
+// ResourceStateTracker.cpp by DanielDFY
+//***************************************************************************************
+
+#include "ResourceStateTracker.h"
+#include <cassert>
+
+ResourceStateTracker::ResourceStateTracker(State readOnlyMask) :
+	mReadOnlyMask(readOnlyMask)
+{
+}
+
+ResourceStateTracker::ResourceId ResourceStateTracker::Register(State initialState)
+{
+	ResourceId id;
+	if(!mFreeIds.empty())
+	{
+		id = mFreeIds.back();
+		mFreeIds.pop_back();
+	}
+	else
+	{
+		id = (ResourceId)mEntries.size();
+		mEntries.push_back(Entry());
+	}
+
+	Entry& e = mEntries[id];
+	e.Current = initialState;
+	e.Pending = NoPending;
+	e.Registered = true;
+
+	return id;
+}
+
+void ResourceStateTracker::Unregister(ResourceId id)
+{
+	assert(id < mEntries.size() && mEntries[id].Registered);
+
+	// Flush before letting go of a resource with a pending transition.
+	assert(mEntries[id].Pending == NoPending);
+
+	mEntries[id].Registered = false;
+	mFreeIds.push_back(id);
+}
+
+void ResourceStateTracker::Clear()
+{
+	assert(mPendingCount == 0);
+
+	mEntries.clear();
+	mFreeIds.clear();
+	mPending.clear();
+}
+
+ResourceStateTracker::State ResourceStateTracker::GetState(ResourceId id)const
+{
+	assert(id < mEntries.size() && mEntries[id].Registered);
+	return mEntries[id].Current;
+}
+
+void ResourceStateTracker::Transition(ResourceId id, State state)
+{
+	assert(id < mEntries.size() && mEntries[id].Registered);
+
+	Entry& e = mEntries[id];
+	mStats.Requests++;
+
+	if(e.Pending != NoPending)
+	{
+		// Retarget the transition already in the batch instead of adding a second
+		// one; if it now goes back where it started it is cancelled.
+		auto& t = mPending[e.Pending];
+		if(IsRedundant(t.After, state))
+		{
+			mStats.Redundant++;
+			return;
+		}
+
+		mStats.Merged++;
+		t.After = state;
+		e.Current = state;
+		if(t.Before == t.After)
+		{
+			e.Pending = NoPending;
+			mPendingCount--;
+		}
+		return;
+	}
+
+	if(IsRedundant(e.Current, state))
+	{
+		mStats.Redundant++;
+		return;
+	}
+
+	Barrier t;
+	t.Resource = id;
+	t.Before = e.Current;
+	t.After = state;
+
+	e.Pending = (std::uint32_t)mPending.size();
+	e.Current = state;
+	mPending.push_back(t);
+	mPendingCount++;
+}
+
+bool ResourceStateTracker::IsRedundant(State current, State requested)const
+{
+	if(current == requested)
+		return true;
+
+	// Already in a read state that covers every requested read.
+	bool currentReadOnly = current != 0 && (current & ~mReadOnlyMask) == 0;
+	bool requestedReadOnly = requested != 0 && (requested & ~mReadOnlyMask) == 0;
+	return currentReadOnly && requestedReadOnly && (current & requested) == requested;
+}
@@ -0,0 +1,114 @@
+//***************************************************************************************
+// ResourceStateTracker.h by DanielDFY
+//
+// Tracks the current state of a set of resources and turns "resource X is needed
+// in state S" requests into a batch of transitions:
+//   - a request for the state the resource is already in is dropped;
+//   - several requests for the same resource before a Flush are merged into one
+//     transition (and dropped if the resource ends up where it started);
+//   - Flush hands every pending transition to the caller at once, so they can go
+//     into a single ResourceBarrier call.
+//
+// Resources are identified by the index Register returns and states are plain
+// bit masks, so the class has no D3D dependency; BarrierBatch.h maps
+// ID3D12Resource and D3D12_RESOURCE_STATES onto it.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class ResourceStateTracker
+{
+public:
+	typedef std::uint32_t ResourceId;
+	typedef std::uint32_t State;
+
+	struct Barrier
+	{
+		ResourceId Resource;
+		State Before;
+		State After;
+	};
+
+	struct Stats
+	{
+		std::uint32_t Requests = 0;
+		std::uint32_t Redundant = 0;
+		std::uint32_t Merged = 0;
+		std::uint32_t Transitions = 0;
+		std::uint32_t Flushes = 0;
+	};
+
+	// States in readOnlyMask may be combined.  A request for a combination of
+	// read states is redundant if the resource is already in a read state
+	// that includes all of them.
+	explicit ResourceStateTracker(State readOnlyMask = 0);
+
+	ResourceId Register(State initialState);
+	void Unregister(ResourceId id);
+	void Clear();
+
+	State GetState(ResourceId id)const;
+
+	// Requests that the resource be in state by the next Flush.
+	void Transition(ResourceId id, State state);
+
+	bool HasPending()const { return mPendingCount > 0; }
+
+	// Calls emit(const Barrier* barriers, count) once if anything is
+	// pending, then clears the batch.
+	template<typename Emit>
+	void Flush(Emit&& emit)
+	{
+		if(mPendingCount == 0)
+		{
+			mPending.clear();
+			return;
+		}
+
+		mFlushed.clear();
+		for(auto& t : mPending)
+		{
+			if(t.Before != t.After)
+				mFlushed.push_back(t);
+			mEntries[t.Resource].Pending = NoPending;
+		}
+		mPending.clear();
+		mPendingCount = 0;
+
+		mStats.Transitions += (std::uint32_t)mFlushed.size();
+		mStats.Flushes++;
+		emit(mFlushed.data(), (std::uint32_t)mFlushed.size());
+	}
+
+	const Stats& GetStats()const { return mStats; }
+	void ResetStats() { mStats = Stats(); }
+
+private:
+	bool IsRedundant(State current, State requested)const;
+
+private:
+	static const std::uint32_t NoPending = ~0u;
+
+	struct Entry
+	{
+		State Current = 0;
+		std::uint32_t Pending = NoPending;
+		bool Registered = false;
+	};
+
+	State mReadOnlyMask = 0;
+
+	std::vector<Entry> mEntries;
+	std::vector<ResourceId> mFreeIds;
+
+	// Transitions cancelled by a later request stay in mPending with
+	// Before == After and are skipped by Flush.
+	std::vector<Barrier> mPending;
+	std::uint32_t mPendingCount = 0;
+	std::vector<Barrier> mFlushed;
+
+	Stats mStats;
+};
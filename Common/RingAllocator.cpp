@@ -0,0 +1,120 @@
+//***************************************************************************************
+// RingAllocator.cpp by DanielDFY
+//***************************************************************************************
+
+#include "RingAllocator.h"
+#include <cassert>
+
+RingAllocator::RingAllocator(std::uint64_t capacity)
+{
+	Reset(capacity);
+}
+
+void RingAllocator::Reset(std::uint64_t capacity)
+{
+	mCapacity = capacity;
+	mHead = 0;
+	mTail = 0;
+	mUsed = 0;
+	mCurrFrameBytes = 0;
+	mFrames.clear();
+	mStats = Stats();
+}
+
+std::uint64_t RingAllocator::Allocate(std::uint64_t size, std::uint64_t alignment)
+{
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+	// Zero sized allocations still get a distinct, valid offset.
+	if(size == 0)
+		size = 1;
+
+	// Nothing in flight: start over from the beginning so the whole buffer
+	// is available as one block.
+	if(mUsed == 0)
+	{
+		mHead = 0;
+		mTail = 0;
+	}
+
+	std::uint64_t aligned = (mHead + alignment - 1) & ~(alignment - 1);
+	std::uint64_t newHead = 0;
+	std::uint64_t offset = InvalidOffset;
+	bool wrapped = false;
+
+	if(mHead >= mTail && !(mHead == mTail && mUsed != 0))
+	{
+		// Free space is [head, capacity) followed by [0, tail).
+		if(aligned + size <= mCapacity)
+		{
+			offset = aligned;
+			newHead = aligned + size;
+		}
+		else if(size <= mTail)
+		{
+			// Skip the end of the buffer and wrap to the beginning.
+			offset = 0;
+			newHead = size;
+			wrapped = true;
+		}
+	}
+	else if(aligned + size <= mTail)
+	{
+		// Free space is [head, tail).
+		offset = aligned;
+		newHead = aligned + size;
+	}
+
+	if(offset == InvalidOffset)
+	{
+		mStats.FailedAllocations++;
+		return InvalidOffset;
+	}
+
+	std::uint64_t consumed = wrapped ? (mCapacity - mHead) + newHead : newHead - mHead;
+
+	mStats.PaddingBytes += consumed - size;
+	mStats.Allocations++;
+
+	mHead = newHead == mCapacity ? 0 : newHead;
+	mUsed += consumed;
+	mCurrFrameBytes += consumed;
+
+	if(mUsed > mStats.PeakUsedBytes)
+		mStats.PeakUsedBytes = mUsed;
+
+	return offset;
+}
+
+void RingAllocator::FinishFrame(std::uint64_t fenceValue)
+{
+	assert(mFrames.empty() || mFrames.back().Fence <= fenceValue);
+
+	if(mCurrFrameBytes == 0)
+		return;
+
+	FrameMarker marker;
+	marker.Fence = fenceValue;
+	marker.End = mHead;
+	marker.Bytes = mCurrFrameBytes;
+	mFrames.push_back(marker);
+
+	mCurrFrameBytes = 0;
+}
+
+void RingAllocator::Retire(std::uint64_t completedFenceValue)
+{
+	while(!mFrames.empty() && mFrames.front().Fence <= completedFenceValue)
+	{
+		mTail = mFrames.front().End;
+		mUsed -= mFrames.front().Bytes;
+		mFrames.pop_front();
+	}
+}
+
+const RingAllocator::Stats& RingAllocator::GetStats()const
+{
+	mStats.UsedBytes = mUsed;
+	mStats.FramesInFlight = (std::uint32_t)mFrames.size();
+	return mStats;
+}
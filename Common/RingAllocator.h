@@ -0,0 +1,76 @@
+//***************************************************************************************
+// RingAllocator.h by DanielDFY
+//
+// Bookkeeping for a linear ring buffer of transient per-frame data.  Allocations
+// are bumped from the head; FinishFrame tags everything allocated since the
+// previous FinishFrame with the frame's fence value, and Retire frees whole
+// frames from the tail once the GPU has passed their fence.
+//
+// The class only deals with offsets and fence values, so it works the same for
+// an upload heap (UploadRing.h), a descriptor range or a simulated fence.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+class RingAllocator
+{
+public:
+	static const std::uint64_t InvalidOffset = ~0ull;
+
+	struct Stats
+	{
+		std::uint64_t UsedBytes = 0;
+		std::uint64_t PeakUsedBytes = 0;
+
+		// Bytes lost to alignment and to skipping the end of the buffer on wrap.
+		std::uint64_t PaddingBytes = 0;
+
+		std::uint32_t Allocations = 0;
+		std::uint32_t FailedAllocations = 0;
+		std::uint32_t FramesInFlight = 0;
+	};
+
+	explicit RingAllocator(std::uint64_t capacity = 0);
+
+	void Reset(std::uint64_t capacity);
+
+	// Returns the offset of size bytes aligned to alignment (a power of two), or
+	// InvalidOffset if the space is still in use by frames in flight.  An
+	// allocation never wraps around the end of the buffer.
+	std::uint64_t Allocate(std::uint64_t size, std::uint64_t alignment);
+
+	// Everything allocated since the previous call is freed by Retire once
+	// completedFenceValue >= fenceValue.  Fence values must increase.
+	void FinishFrame(std::uint64_t fenceValue);
+
+	void Retire(std::uint64_t completedFenceValue);
+
+	std::uint64_t Capacity()const { return mCapacity; }
+	std::uint64_t UsedBytes()const { return mUsed; }
+	std::uint64_t FreeBytes()const { return mCapacity - mUsed; }
+
+	const Stats& GetStats()const;
+
+private:
+	struct FrameMarker
+	{
+		std::uint64_t Fence;
+		std::uint64_t End;
+		std::uint64_t Bytes;
+	};
+
+	std::uint64_t mCapacity = 0;
+	std::uint64_t mHead = 0;
+	std::uint64_t mTail = 0;
+	std::uint64_t mUsed = 0;
+
+	// Bytes (with padding) allocated since the last FinishFrame.
+	std::uint64_t mCurrFrameBytes = 0;
+
+	std::deque<FrameMarker> mFrames;
+
+	mutable Stats mStats;
+};
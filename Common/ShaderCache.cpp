@@ -0,0 +1,509 @@
+//***************************************************************************************
+// ShaderCache.cpp by DanielDFY
+//***************************************************************************************
+
+#include "ShaderCache.h"
+#include "Hash.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	const std::uint32_t EntryMagic = 0x43524853; // "SHRC"
+	const std::uint32_t EntryVersion = 1;
+
+	struct EntryHeader
+	{
+		std::uint32_t Magic;
+		std::uint32_t Version;
+		std::uint64_t Key;
+		std::uint64_t Size;
+	};
+
+	// '/' separators, "." and ".." segments resolved where possible, so every
+	// spelling of a path maps to one SourceFile.
+	std::string NormalizePath(const std::string& path)
+	{
+		std::vector<std::string> segments;
+		std::string segment;
+		bool absolute = !path.empty() && (path[0] == '/' || path[0] == '\\');
+
+		for(std::size_t i = 0; i <= path.size(); ++i)
+		{
+			if(i < path.size() && path[i] != '/' && path[i] != '\\')
+			{
+				segment += path[i];
+				continue;
+			}
+
+			if(segment == "..")
+			{
+				if(!segments.empty() && segments.back() != "..")
+					segments.pop_back();
+				else
+					segments.push_back(segment);
+			}
+			else if(!segment.empty() && segment != ".")
+			{
+				segments.push_back(segment);
+			}
+			segment.clear();
+		}
+
+		std::string result = absolute ? "/" : "";
+		for(std::size_t i = 0; i < segments.size(); ++i)
+		{
+			if(i > 0)
+				result += '/';
+			result += segments[i];
+		}
+
+		return result;
+	}
+
+	std::string DirectoryOf(const std::string& path)
+	{
+		std::size_t slash = path.find_last_of('/');
+		return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+	}
+
+	// The text with comments replaced by spaces, line breaks kept.
+	std::string StripComments(const std::string& text)
+	{
+		std::string out = text;
+		std::size_t i = 0;
+		while(i < out.size())
+		{
+			if(out[i] == '/' && i + 1 < out.size() && out[i + 1] == '/')
+			{
+				while(i < out.size() && out[i] != '\n')
+					out[i++] = ' ';
+			}
+			else if(out[i] == '/' && i + 1 < out.size() && out[i + 1] == '*')
+			{
+				out[i++] = ' ';
+				out[i++] = ' ';
+				while(i < out.size() && !(out[i] == '*' && i + 1 < out.size() && out[i + 1] == '/'))
+				{
+					if(out[i] != '\n')
+						out[i] = ' ';
+					++i;
+				}
+				for(int k = 0; k < 2 && i < out.size(); ++k)
+					out[i++] = ' ';
+			}
+			else if(out[i] == '"')
+			{
+				// Skip string literals, so "//" inside one is not a comment.
+				for(++i; i < out.size() && out[i] != '"' && out[i] != '\n'; ++i)
+				{
+				}
+				if(i < out.size())
+					++i;
+			}
+			else
+			{
+				++i;
+			}
+		}
+
+		return out;
+	}
+
+	// The file names of the #include directives in text, in order.
+	std::vector<std::string> FindIncludes(const std::string& text)
+	{
+		std::vector<std::string> includes;
+		std::string code = StripComments(text);
+
+		std::size_t i = 0;
+		while(i < code.size())
+		{
+			std::size_t end = code.find('\n', i);
+			if(end == std::string::npos)
+				end = code.size();
+
+			std::size_t p = i;
+			auto skipSpaces = [&]()
+			{
+				while(p < end && (code[p] == ' ' || code[p] == '\t' || code[p] == '\r'))
+					++p;
+			};
+
+			skipSpaces();
+			if(p < end && code[p] == '#')
+			{
+				++p;
+				skipSpaces();
+				if(code.compare(p, 7, "include") == 0)
+				{
+					p += 7;
+					skipSpaces();
+					if(p < end && (code[p] == '"' || code[p] == '<'))
+					{
+						char close = code[p] == '"' ? '"' : '>';
+						std::size_t first = ++p;
+						while(p < end && code[p] != close)
+							++p;
+						if(p < end && p > first)
+							includes.push_back(code.substr(first, p - first));
+					}
+				}
+			}
+
+			i = end + 1;
+		}
+
+		return includes;
+	}
+
+	bool CreateDirectoryIfMissing(const std::string& path)
+	{
+#ifdef _WIN32
+		return ::CreateDirectoryA(path.c_str(), nullptr) != 0 || ::GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+		struct stat s;
+		return ::mkdir(path.c_str(), 0755) == 0 || (::stat(path.c_str(), &s) == 0 && S_ISDIR(s.st_mode));
+#endif
+	}
+}
+
+std::string ShaderCache::Stats::ToString()const
+{
+	std::ostringstream outs;
+	outs << Requests << " shaders: " << MemoryHits << " from memory, " << DiskHits << " from disk, " <<
+		Compiled << " compiled, " << Failed << " failed; scan " << ScanMilliseconds << " ms, compile " <<
+		CompileMilliseconds << " ms";
+	if(WriteFailures > 0)
+		outs << "; " << WriteFailures << " could not be stored";
+	return outs.str();
+}
+
+ShaderCache::ShaderCache(Backend& backend) :
+	ShaderCache(backend, Settings())
+{
+}
+
+ShaderCache::ShaderCache(Backend& backend, const Settings& settings) :
+	mBackend(backend),
+	mSettings(settings),
+	mIdentity(backend.Identity())
+{
+}
+
+const ShaderCache::SourceFile& ShaderCache::ReadSource(const std::string& filename, SourceFiles& files)
+{
+	auto it = files.find(filename);
+	if(it != files.end())
+		return it->second;
+
+	SourceFile& file = files[filename];
+
+	std::ifstream fin(filename, std::ios::binary);
+	if(!fin)
+		return file;
+
+	std::string text((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+	if(fin.bad())
+		return file;
+
+	file.Exists = true;
+	file.Hash = Hash64(text);
+
+	std::string directory = DirectoryOf(filename);
+	for(const std::string& include : FindIncludes(text))
+	{
+		file.Includes.push_back(NormalizePath(directory + include));
+		file.Spelled.push_back(include);
+	}
+
+	return file;
+}
+
+bool ShaderCache::Walk(const std::string& filename, SourceFiles& files, std::vector<std::string>* paths)
+{
+	paths->clear();
+
+	std::string root = NormalizePath(filename);
+	if(!ReadSource(root, files).Exists)
+		return false;
+
+	// Explicit stack, children pushed in reverse so they pop in include order.
+	std::vector<std::string> stack(1, root);
+	std::unordered_map<std::string, bool> visited;
+	while(!stack.empty())
+	{
+		std::string path = stack.back();
+		stack.pop_back();
+
+		if(visited[path])
+			continue;
+		visited[path] = true;
+
+		const SourceFile& file = ReadSource(path, files);
+		if(!file.Exists)
+			continue;
+
+		paths->push_back(path);
+		for(std::size_t i = file.Includes.size(); i-- > 0;)
+		{
+			if(!visited[file.Includes[i]])
+				stack.push_back(file.Includes[i]);
+		}
+	}
+
+	return true;
+}
+
+bool ShaderCache::ComputeKey(const Request& request, SourceFiles& files, std::uint64_t* key)const
+{
+	std::vector<std::string> paths;
+	if(!Walk(request.Filename, files, &paths))
+		return false;
+
+	std::uint64_t h = Hash64(mIdentity);
+	h = Hash64(request.Target, h);
+	h = Hash64(request.EntryPoint, h);
+	for(const Define& define : request.Defines)
+	{
+		h = Hash64(define.Name, h);
+		h = Hash64(define.Value, h);
+	}
+
+	for(const std::string& path : paths)
+	{
+		const SourceFile& file = files[path];
+		h = Hash64(&file.Hash, sizeof(file.Hash), h);
+
+		// A missing include may be created later, or be found by the compiler
+		// somewhere the scanner does not look.
+		for(std::size_t i = 0; i < file.Includes.size(); ++i)
+		{
+			if(!files[file.Includes[i]].Exists)
+				h = Hash64(file.Spelled[i], h);
+		}
+	}
+
+	*key = h;
+	return true;
+}
+
+ShaderCache::Status ShaderCache::ScanDependencies(const std::string& filename, std::vector<std::string>* dependencies)
+{
+	SourceFiles files;
+	return Walk(filename, files, dependencies) ? Status::Ok : Status::OpenFailed;
+}
+
+std::string ShaderCache::EntryPath(std::uint64_t key)const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+	return mSettings.Directory + name;
+}
+
+bool ShaderCache::LoadEntry(std::uint64_t key, std::vector<std::uint8_t>* bytecode)const
+{
+	if(mSettings.Directory.empty())
+		return false;
+
+	std::ifstream fin(EntryPath(key), std::ios::binary);
+	if(!fin)
+		return false;
+
+	EntryHeader header;
+	if(!fin.read((char*)&header, sizeof(header)))
+		return false;
+
+	if(header.Magic != EntryMagic || header.Version != EntryVersion || header.Key != key)
+		return false;
+
+	bytecode->resize((std::size_t)header.Size);
+	if(!fin.read((char*)bytecode->data(), (std::streamsize)header.Size))
+	{
+		bytecode->clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool ShaderCache::StoreEntry(std::uint64_t key, const std::vector<std::uint8_t>& bytecode)const
+{
+	std::string path = EntryPath(key);
+	std::string temp = path + ".tmp";
+
+	{
+		std::ofstream fout(temp, std::ios::binary | std::ios::trunc);
+
+		EntryHeader header;
+		header.Magic = EntryMagic;
+		header.Version = EntryVersion;
+		header.Key = key;
+		header.Size = bytecode.size();
+
+		fout.write((const char*)&header, sizeof(header));
+		fout.write((const char*)bytecode.data(), (std::streamsize)bytecode.size());
+		fout.close();
+		if(!fout)
+		{
+			std::remove(temp.c_str());
+			return false;
+		}
+	}
+
+	if(std::rename(temp.c_str(), path.c_str()) != 0)
+	{
+		// Windows does not replace an existing file; another run stored the
+		// same entry in the meantime.
+		std::remove(path.c_str());
+		if(std::rename(temp.c_str(), path.c_str()) != 0)
+		{
+			std::remove(temp.c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+ShaderCache::Status ShaderCache::Build(const std::vector<Request>& requests, std::vector<Shader>* shaders, ThreadPool* pool)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	shaders->assign(requests.size(), Shader());
+
+	// Requests equal to an earlier miss wait for its bytecode instead of
+	// compiling it again.
+	std::vector<std::uint32_t> misses;
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> duplicates;
+	std::unordered_map<std::uint64_t, std::uint32_t> missByKey;
+
+	SourceFiles files;
+	for(std::uint32_t i = 0; i < (std::uint32_t)requests.size(); ++i)
+	{
+		Shader& shader = (*shaders)[i];
+		mStats.Requests++;
+
+		if(!ComputeKey(requests[i], files, &shader.Key))
+		{
+			shader.Result = Status::OpenFailed;
+			mStats.Failed++;
+			continue;
+		}
+
+		auto memory = mMemory.find(shader.Key);
+		if(memory != mMemory.end())
+		{
+			shader.Bytecode = memory->second;
+			mStats.MemoryHits++;
+			continue;
+		}
+
+		auto miss = missByKey.find(shader.Key);
+		if(miss != missByKey.end())
+		{
+			duplicates.emplace_back(i, miss->second);
+			continue;
+		}
+
+		if(LoadEntry(shader.Key, &shader.Bytecode))
+		{
+			mMemory[shader.Key] = shader.Bytecode;
+			mStats.DiskHits++;
+			continue;
+		}
+
+		missByKey.emplace(shader.Key, i);
+		misses.push_back(i);
+	}
+
+	auto scanned = std::chrono::steady_clock::now();
+
+	bool store = !mSettings.Directory.empty() && !misses.empty() && CreateDirectoryIfMissing(mSettings.Directory);
+	std::vector<char> stored(misses.size(), 0);
+
+	auto compile = [&](std::uint32_t m)
+	{
+		std::uint32_t i = misses[m];
+		Shader& shader = (*shaders)[i];
+
+		if(!mBackend.Compile(requests[i], &shader.Bytecode, &shader.Errors))
+		{
+			shader.Result = Status::CompileFailed;
+			shader.Bytecode.clear();
+			return;
+		}
+
+		if(store)
+			stored[m] = StoreEntry(shader.Key, shader.Bytecode) ? 1 : 0;
+	};
+
+	if(pool != nullptr && misses.size() > 1)
+		pool->ParallelFor((std::uint32_t)misses.size(), [&](std::uint32_t m, std::uint32_t) { compile(m); });
+	else
+	{
+		for(std::uint32_t m = 0; m < (std::uint32_t)misses.size(); ++m)
+			compile(m);
+	}
+
+	for(std::uint32_t m = 0; m < (std::uint32_t)misses.size(); ++m)
+	{
+		const Shader& shader = (*shaders)[misses[m]];
+		if(shader.Result != Status::Ok)
+		{
+			mStats.Failed++;
+			continue;
+		}
+
+		mStats.Compiled++;
+		if(!mSettings.Directory.empty() && !stored[m])
+			mStats.WriteFailures++;
+		mMemory[shader.Key] = shader.Bytecode;
+	}
+
+	for(const auto& d : duplicates)
+	{
+		Shader& shader = (*shaders)[d.first];
+		const Shader& first = (*shaders)[d.second];
+		shader.Result = first.Result;
+		shader.Bytecode = first.Bytecode;
+		if(shader.Result == Status::Ok)
+			mStats.MemoryHits++;
+		else
+			mStats.Failed++;
+	}
+
+	auto finished = std::chrono::steady_clock::now();
+	mStats.ScanMilliseconds += std::chrono::duration<double, std::milli>(scanned - start).count();
+	mStats.CompileMilliseconds += std::chrono::duration<double, std::milli>(finished - scanned).count();
+
+	for(const Shader& shader : *shaders)
+	{
+		if(shader.Result != Status::Ok)
+			return shader.Result;
+	}
+
+	return Status::Ok;
+}
+
+const char* ShaderCache::StatusToString(Status status)
+{
+	switch(status)
+	{
+	case Status::Ok:            return "Ok";
+	case Status::OpenFailed:    return "OpenFailed";
+	case Status::CompileFailed: return "CompileFailed";
+	}
+
+	return "Unknown";
+}
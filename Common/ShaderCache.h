@@ -0,0 +1,154 @@
+//***************************************************************************************
+// ShaderCache.h by DanielDFY
+//
+// Compiled shader bytecode kept between runs, so the demos stop recompiling
+// every HLSL file from source at each launch.
+//
+// A shader is keyed by a hash of the compiler (version and flags), the target,
+// the entry point, the defines in order, and the contents of the source file
+// and of every file it includes, transitively.  Includes are found by scanning
+// for #include "file" and #include <file> outside comments and resolving them
+// against the including file's directory, as D3D_COMPILE_STANDARD_FILE_INCLUDE
+// does.  Includes in inactive #if branches are hashed too, and missing ones by
+// name, so the key changes whenever the compiled result could.
+//
+// Build looks each shader up in memory, then in Settings::Directory, and
+// compiles the misses in parallel on an optional ThreadPool, storing them on
+// disk for the next run.  Entries are written to a temporary file and renamed,
+// so a run that is killed leaves no truncated entry behind.
+//
+// The compiler is a Backend; ShaderCacheBackend.h compiles with D3DCompiler.
+// Backend::Compile must be thread safe.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ThreadPool;
+
+class ShaderCache
+{
+public:
+	enum class Status
+	{
+		Ok,
+		OpenFailed,    // the source file could not be read
+		CompileFailed  // see Shader::Errors
+	};
+
+	struct Define
+	{
+		std::string Name;
+		std::string Value;
+	};
+
+	struct Request
+	{
+		std::string Filename;
+		std::vector<Define> Defines;
+		std::string EntryPoint;
+		std::string Target;
+	};
+
+	class Backend
+	{
+	public:
+		virtual ~Backend() = default;
+
+		// Identifies the compiler and its options; part of every key, so a new
+		// compiler or debug/release flags never reuse each other's bytecode.
+		virtual std::string Identity()const = 0;
+
+		// Called from several threads at once.  errors receives the messages
+		// (warnings included) even on success.
+		virtual bool Compile(const Request& request, std::vector<std::uint8_t>* bytecode, std::string* errors) = 0;
+	};
+
+	struct Settings
+	{
+		// Where entries are stored, created if missing; empty keeps them in
+		// memory only.
+		std::string Directory = "ShaderCache";
+	};
+
+	struct Shader
+	{
+		Status Result = Status::Ok;
+		std::uint64_t Key = 0;
+		std::vector<std::uint8_t> Bytecode;
+
+		// Compiler messages; empty when the bytecode came from the cache.
+		std::string Errors;
+	};
+
+	struct Stats
+	{
+		std::uint64_t Requests = 0;
+		std::uint64_t MemoryHits = 0;
+		std::uint64_t DiskHits = 0;
+		std::uint64_t Compiled = 0;
+		std::uint64_t Failed = 0;
+
+		// Entries that could not be stored; they compile again next run.
+		std::uint64_t WriteFailures = 0;
+
+		// Reading and hashing the sources, and compiling the misses.
+		double ScanMilliseconds = 0.0;
+		double CompileMilliseconds = 0.0;
+
+		std::string ToString()const;
+	};
+
+	ShaderCache(Backend& backend);
+	ShaderCache(Backend& backend, const Settings& settings);
+	ShaderCache(const ShaderCache& rhs) = delete;
+	ShaderCache& operator=(const ShaderCache& rhs) = delete;
+
+	// shaders[i] for requests[i].  Returns the first failure, or Ok.
+	Status Build(const std::vector<Request>& requests, std::vector<Shader>* shaders, ThreadPool* pool = nullptr);
+
+	const Stats& GetStats()const { return mStats; }
+
+	// The files filename depends on, itself first, each once, in the order
+	// the scanner reaches them; includes that do not exist are left out.
+	static Status ScanDependencies(const std::string& filename, std::vector<std::string>* dependencies);
+
+	static const char* StatusToString(Status status);
+
+private:
+	struct SourceFile
+	{
+		bool Exists = false;
+		std::uint64_t Hash = 0;
+
+		// Resolved paths; Spelled as written, for hashing missing ones.
+		std::vector<std::string> Includes;
+		std::vector<std::string> Spelled;
+	};
+
+	typedef std::unordered_map<std::string, SourceFile> SourceFiles;
+
+	static const SourceFile& ReadSource(const std::string& filename, SourceFiles& files);
+
+	// Depth first from filename, each existing file once; false if filename
+	// itself cannot be read.
+	static bool Walk(const std::string& filename, SourceFiles& files, std::vector<std::string>* paths);
+	bool ComputeKey(const Request& request, SourceFiles& files, std::uint64_t* key)const;
+
+	std::string EntryPath(std::uint64_t key)const;
+	bool LoadEntry(std::uint64_t key, std::vector<std::uint8_t>* bytecode)const;
+	bool StoreEntry(std::uint64_t key, const std::vector<std::uint8_t>& bytecode)const;
+
+private:
+	Backend& mBackend;
+	Settings mSettings;
+	std::string mIdentity;
+
+	std::unordered_map<std::uint64_t, std::vector<std::uint8_t>> mMemory;
+
+	Stats mStats;
+};
@@ -0,0 +1,72 @@
+//***************************************************************************************
+// ShaderCacheBackend.h by DanielDFY
+//
+// The D3DCompiler side of ShaderCache: compiles with D3DCompileFromFile and
+// the standard file include handler, using the flags d3dUtil::CompileShader
+// uses (debug info and no optimization in debug builds).  D3DCompileFromFile
+// may be called from several threads at once.
+//
+// Usage:
+//   ShaderCacheBackend compiler;
+//   ShaderCache cache(compiler);
+//   cache.Build(requests, &shaders, &pool);
+//   mShaders["standardVS"] = ShaderCacheBackend::ToBlob(shaders[0].Bytecode);
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "ShaderCache.h"
+
+class ShaderCacheBackend : public ShaderCache::Backend
+{
+public:
+	ShaderCacheBackend()
+	{
+#if defined(DEBUG) || defined(_DEBUG)
+		mCompileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+	}
+
+	std::string Identity()const override
+	{
+		return "D3DCompiler " + std::to_string(D3D_COMPILER_VERSION) + " flags " + std::to_string(mCompileFlags);
+	}
+
+	bool Compile(const ShaderCache::Request& request, std::vector<std::uint8_t>* bytecode, std::string* errors)override
+	{
+		std::vector<D3D_SHADER_MACRO> defines;
+		for(const ShaderCache::Define& define : request.Defines)
+			defines.push_back({ define.Name.c_str(), define.Value.c_str() });
+		defines.push_back({ nullptr, nullptr });
+
+		Microsoft::WRL::ComPtr<ID3DBlob> byteCode;
+		Microsoft::WRL::ComPtr<ID3DBlob> errorBlob;
+		HRESULT hr = D3DCompileFromFile(AnsiToWString(request.Filename).c_str(), defines.data(),
+			D3D_COMPILE_STANDARD_FILE_INCLUDE, request.EntryPoint.c_str(), request.Target.c_str(),
+			mCompileFlags, 0, &byteCode, &errorBlob);
+
+		if(errorBlob != nullptr)
+			errors->assign((const char*)errorBlob->GetBufferPointer());
+
+		if(FAILED(hr))
+			return false;
+
+		const std::uint8_t* data = (const std::uint8_t*)byteCode->GetBufferPointer();
+		bytecode->assign(data, data + byteCode->GetBufferSize());
+
+		return true;
+	}
+
+	static Microsoft::WRL::ComPtr<ID3DBlob> ToBlob(const std::vector<std::uint8_t>& bytecode)
+	{
+		Microsoft::WRL::ComPtr<ID3DBlob> blob;
+		ThrowIfFailed(D3DCreateBlob(bytecode.size(), blob.GetAddressOf()));
+		std::memcpy(blob->GetBufferPointer(), bytecode.data(), bytecode.size());
+
+		return blob;
+	}
+
+private:
+	UINT mCompileFlags = 0;
+};
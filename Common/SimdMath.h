@@ -0,0 +1,998 @@
+//***************************************************************************************
+// SimdMath.h by DanielDFY
+//
+// Portable vector/matrix/quaternion library mirroring the DirectXMath operations
+// used by Common and the demos, for CPU side code (animation, waves, culling,
+// picking) that has to build without the Windows SDK.
+//
+// Naming follows DirectXMath with the "XM" prefix dropped, e.g.
+//   XMVECTOR            -> SimdMath::Vector
+//   XMMATRIX            -> SimdMath::Matrix
+//   XMFLOAT3            -> SimdMath::Float3
+//   XMVector3Normalize  -> SimdMath::Vector3Normalize
+//   XMMatrixLookAtLH    -> SimdMath::MatrixLookAtLH
+// and the same conventions: row vectors, left handed, angles in radians,
+// quaternions stored as (x, y, z, w).  Operators are not overloaded because
+// __m128 is not a class type on every compiler.
+//
+// The backend is chosen at compile time:
+//   SIMDMATH_AVX2   : AVX2 + FMA (MSVC /arch:AVX2, GCC/Clang -mavx2 -mfma)
+//   SIMDMATH_SSE2   : any x86/x64 target with SSE2
+//   SIMDMATH_SCALAR : everything else, or define SIMDMATH_NO_INTRINSICS
+// Only the primitives at the top of the file differ between backends; the
+// rest of the library is written in terms of them.
+//***************************************************************************************
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(SIMDMATH_NO_INTRINSICS)
+	#define SIMDMATH_SCALAR 1
+#elif defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+	#define SIMDMATH_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define SIMDMATH_SSE2 1
+#else
+	#define SIMDMATH_SCALAR 1
+#endif
+
+#if defined(SIMDMATH_AVX2)
+	#include <immintrin.h>
+#elif defined(SIMDMATH_SSE2)
+	#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(SIMDMATH_SCALAR) && (defined(_M_X64) || _M_IX86_FP >= 2)
+	#define SM_CALLCONV __vectorcall
+#else
+	#define SM_CALLCONV
+#endif
+
+namespace SimdMath
+{
+
+const float Pi = 3.141592654f;
+const float TwoPi = 6.283185307f;
+const float PiDiv2 = 1.570796327f;
+
+inline float ConvertToRadians(float degrees) { return degrees * (Pi / 180.0f); }
+inline float ConvertToDegrees(float radians) { return radians * (180.0f / Pi); }
+
+//
+// Types.
+//
+
+#if defined(SIMDMATH_SCALAR)
+struct alignas(16) Vector
+{
+	float f[4];
+};
+#else
+using Vector = __m128;
+#endif
+
+struct alignas(16) Matrix
+{
+	Vector r[4];
+
+	Matrix() = default;
+	Matrix(Vector r0, Vector r1, Vector r2, Vector r3)
+	{
+		r[0] = r0;
+		r[1] = r1;
+		r[2] = r2;
+		r[3] = r3;
+	}
+};
+
+struct Float2
+{
+	float x, y;
+
+	Float2() = default;
+	Float2(float _x, float _y) : x(_x), y(_y) {}
+};
+
+struct Float3
+{
+	float x, y, z;
+
+	Float3() = default;
+	Float3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+};
+
+struct Float4
+{
+	float x, y, z, w;
+
+	Float4() = default;
+	Float4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+};
+
+struct Float4x4
+{
+	float m[4][4];
+
+	Float4x4() = default;
+	Float4x4(
+		float m00, float m01, float m02, float m03,
+		float m10, float m11, float m12, float m13,
+		float m20, float m21, float m22, float m23,
+		float m30, float m31, float m32, float m33)
+	{
+		m[0][0] = m00; m[0][1] = m01; m[0][2] = m02; m[0][3] = m03;
+		m[1][0] = m10; m[1][1] = m11; m[1][2] = m12; m[1][3] = m13;
+		m[2][0] = m20; m[2][1] = m21; m[2][2] = m22; m[2][3] = m23;
+		m[3][0] = m30; m[3][1] = m31; m[3][2] = m32; m[3][3] = m33;
+	}
+
+	float operator()(int row, int col)const { return m[row][col]; }
+	float& operator()(int row, int col) { return m[row][col]; }
+};
+
+//***************************************************************************************
+// Backend primitives.
+//***************************************************************************************
+
+#if defined(SIMDMATH_SCALAR)
+
+inline Vector SM_CALLCONV VectorSet(float x, float y, float z, float w)
+{
+	Vector v = { { x, y, z, w } };
+	return v;
+}
+
+inline Vector SM_CALLCONV VectorReplicate(float s) { return VectorSet(s, s, s, s); }
+inline Vector SM_CALLCONV VectorZero() { return VectorReplicate(0.0f); }
+
+inline float SM_CALLCONV VectorGetByIndex(Vector v, int i) { return v.f[i]; }
+
+inline Vector SM_CALLCONV LoadFloat4(const Float4* p) { return VectorSet(p->x, p->y, p->z, p->w); }
+inline void SM_CALLCONV StoreFloat4(Float4* p, Vector v) { p->x = v.f[0]; p->y = v.f[1]; p->z = v.f[2]; p->w = v.f[3]; }
+
+#define SIMDMATH_SCALAR_BINARY(name, expr)                  \
+inline Vector SM_CALLCONV name(Vector a, Vector b)          \
+{                                                           \
+	Vector r;                                               \
+	for(int i = 0; i < 4; ++i) { float x = a.f[i], y = b.f[i]; r.f[i] = (expr); } \
+	return r;                                               \
+}
+
+SIMDMATH_SCALAR_BINARY(VectorAdd, x + y)
+SIMDMATH_SCALAR_BINARY(VectorSubtract, x - y)
+SIMDMATH_SCALAR_BINARY(VectorMultiply, x * y)
+SIMDMATH_SCALAR_BINARY(VectorDivide, x / y)
+SIMDMATH_SCALAR_BINARY(VectorMin, x < y ? x : y)
+SIMDMATH_SCALAR_BINARY(VectorMax, x > y ? x : y)
+
+#undef SIMDMATH_SCALAR_BINARY
+
+inline Vector SM_CALLCONV VectorMultiplyAdd(Vector a, Vector b, Vector c)
+{
+	return VectorSet(a.f[0]*b.f[0] + c.f[0], a.f[1]*b.f[1] + c.f[1], a.f[2]*b.f[2] + c.f[2], a.f[3]*b.f[3] + c.f[3]);
+}
+
+inline Vector SM_CALLCONV VectorSqrt(Vector v)
+{
+	return VectorSet(std::sqrt(v.f[0]), std::sqrt(v.f[1]), std::sqrt(v.f[2]), std::sqrt(v.f[3]));
+}
+
+// Comparison results are per component masks (all bits set for true), like DirectXMath.
+inline Vector SM_CALLCONV MaskFromBools(bool x, bool y, bool z, bool w)
+{
+	std::uint32_t u[4] = { x ? 0xFFFFFFFFu : 0u, y ? 0xFFFFFFFFu : 0u, z ? 0xFFFFFFFFu : 0u, w ? 0xFFFFFFFFu : 0u };
+	Vector r;
+	std::memcpy(r.f, u, sizeof(u));
+	return r;
+}
+
+inline Vector SM_CALLCONV VectorEqual(Vector a, Vector b) { return MaskFromBools(a.f[0] == b.f[0], a.f[1] == b.f[1], a.f[2] == b.f[2], a.f[3] == b.f[3]); }
+inline Vector SM_CALLCONV VectorLess(Vector a, Vector b) { return MaskFromBools(a.f[0] < b.f[0], a.f[1] < b.f[1], a.f[2] < b.f[2], a.f[3] < b.f[3]); }
+inline Vector SM_CALLCONV VectorLessOrEqual(Vector a, Vector b) { return MaskFromBools(a.f[0] <= b.f[0], a.f[1] <= b.f[1], a.f[2] <= b.f[2], a.f[3] <= b.f[3]); }
+inline Vector SM_CALLCONV VectorGreater(Vector a, Vector b) { return VectorLess(b, a); }
+inline Vector SM_CALLCONV VectorGreaterOrEqual(Vector a, Vector b) { return VectorLessOrEqual(b, a); }
+
+// Per component: control ? b : a.
+inline Vector SM_CALLCONV VectorSelect(Vector a, Vector b, Vector control)
+{
+	std::uint32_t ua[4], ub[4], uc[4];
+	std::memcpy(ua, a.f, 16);
+	std::memcpy(ub, b.f, 16);
+	std::memcpy(uc, control.f, 16);
+	for(int i = 0; i < 4; ++i)
+		ua[i] = (ua[i] & ~uc[i]) | (ub[i] & uc[i]);
+	Vector r;
+	std::memcpy(r.f, ua, 16);
+	return r;
+}
+
+// Bit i of the result is set if component i of the mask is set.
+inline int SM_CALLCONV VectorMoveMask(Vector mask)
+{
+	std::uint32_t u[4];
+	std::memcpy(u, mask.f, 16);
+	return (int)((u[0] >> 31) | ((u[1] >> 31) << 1) | ((u[2] >> 31) << 2) | ((u[3] >> 31) << 3));
+}
+
+template<int X, int Y, int Z, int W>
+inline Vector SM_CALLCONV VectorSwizzle(Vector v)
+{
+	return VectorSet(v.f[X], v.f[Y], v.f[Z], v.f[W]);
+}
+
+inline Vector SM_CALLCONV Vector3Dot(Vector a, Vector b)
+{
+	return VectorReplicate(a.f[0]*b.f[0] + a.f[1]*b.f[1] + a.f[2]*b.f[2]);
+}
+
+inline Vector SM_CALLCONV Vector4Dot(Vector a, Vector b)
+{
+	return VectorReplicate(a.f[0]*b.f[0] + a.f[1]*b.f[1] + a.f[2]*b.f[2] + a.f[3]*b.f[3]);
+}
+
+#else // SSE2 / AVX2
+
+inline Vector SM_CALLCONV VectorSet(float x, float y, float z, float w) { return _mm_set_ps(w, z, y, x); }
+inline Vector SM_CALLCONV VectorReplicate(float s) { return _mm_set1_ps(s); }
+inline Vector SM_CALLCONV VectorZero() { return _mm_setzero_ps(); }
+
+inline float SM_CALLCONV VectorGetByIndex(Vector v, int i)
+{
+	alignas(16) float f[4];
+	_mm_store_ps(f, v);
+	return f[i];
+}
+
+inline Vector SM_CALLCONV LoadFloat4(const Float4* p) { return _mm_loadu_ps(&p->x); }
+inline void SM_CALLCONV StoreFloat4(Float4* p, Vector v) { _mm_storeu_ps(&p->x, v); }
+
+inline Vector SM_CALLCONV VectorAdd(Vector a, Vector b) { return _mm_add_ps(a, b); }
+inline Vector SM_CALLCONV VectorSubtract(Vector a, Vector b) { return _mm_sub_ps(a, b); }
+inline Vector SM_CALLCONV VectorMultiply(Vector a, Vector b) { return _mm_mul_ps(a, b); }
+inline Vector SM_CALLCONV VectorDivide(Vector a, Vector b) { return _mm_div_ps(a, b); }
+inline Vector SM_CALLCONV VectorMin(Vector a, Vector b) { return _mm_min_ps(a, b); }
+inline Vector SM_CALLCONV VectorMax(Vector a, Vector b) { return _mm_max_ps(a, b); }
+inline Vector SM_CALLCONV VectorSqrt(Vector v) { return _mm_sqrt_ps(v); }
+
+inline Vector SM_CALLCONV VectorMultiplyAdd(Vector a, Vector b, Vector c)
+{
+#if defined(SIMDMATH_AVX2)
+	return _mm_fmadd_ps(a, b, c);
+#else
+	return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+
+inline Vector SM_CALLCONV VectorEqual(Vector a, Vector b) { return _mm_cmpeq_ps(a, b); }
+inline Vector SM_CALLCONV VectorLess(Vector a, Vector b) { return _mm_cmplt_ps(a, b); }
+inline Vector SM_CALLCONV VectorLessOrEqual(Vector a, Vector b) { return _mm_cmple_ps(a, b); }
+inline Vector SM_CALLCONV VectorGreater(Vector a, Vector b) { return _mm_cmpgt_ps(a, b); }
+inline Vector SM_CALLCONV VectorGreaterOrEqual(Vector a, Vector b) { return _mm_cmpge_ps(a, b); }
+
+inline Vector SM_CALLCONV VectorSelect(Vector a, Vector b, Vector control)
+{
+#if defined(SIMDMATH_AVX2)
+	return _mm_blendv_ps(a, b, control);
+#else
+	return _mm_or_ps(_mm_andnot_ps(control, a), _mm_and_ps(b, control));
+#endif
+}
+
+inline int SM_CALLCONV VectorMoveMask(Vector mask) { return _mm_movemask_ps(mask); }
+
+template<int X, int Y, int Z, int W>
+inline Vector SM_CALLCONV VectorSwizzle(Vector v)
+{
+#if defined(SIMDMATH_AVX2)
+	return _mm_permute_ps(v, _MM_SHUFFLE(W, Z, Y, X));
+#else
+	return _mm_shuffle_ps(v, v, _MM_SHUFFLE(W, Z, Y, X));
+#endif
+}
+
+inline Vector SM_CALLCONV Vector3Dot(Vector a, Vector b)
+{
+#if defined(SIMDMATH_AVX2)
+	return _mm_dp_ps(a, b, 0x7F);
+#else
+	Vector m = _mm_mul_ps(a, b);
+	Vector y = _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1));
+	Vector z = _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 2, 2, 2));
+	Vector sum = _mm_add_ss(_mm_add_ss(m, y), z);
+	return _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(0, 0, 0, 0));
+#endif
+}
+
+inline Vector SM_CALLCONV Vector4Dot(Vector a, Vector b)
+{
+#if defined(SIMDMATH_AVX2)
+	return _mm_dp_ps(a, b, 0xFF);
+#else
+	Vector m = _mm_mul_ps(a, b);
+	Vector s = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_add_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 0, 3, 2)));
+#endif
+}
+
+#endif
+
+//***************************************************************************************
+// Everything below is backend independent.
+//***************************************************************************************
+
+//
+// Load/store.
+//
+
+inline Vector SM_CALLCONV LoadFloat2(const Float2* p) { return VectorSet(p->x, p->y, 0.0f, 0.0f); }
+inline Vector SM_CALLCONV LoadFloat3(const Float3* p) { return VectorSet(p->x, p->y, p->z, 0.0f); }
+inline Vector SM_CALLCONV LoadFloat(const float* p) { return VectorSet(*p, 0.0f, 0.0f, 0.0f); }
+
+inline void SM_CALLCONV StoreFloat(float* p, Vector v)
+{
+	*p = VectorGetByIndex(v, 0);
+}
+
+inline void SM_CALLCONV StoreFloat2(Float2* p, Vector v)
+{
+	Float4 f;
+	StoreFloat4(&f, v);
+	p->x = f.x;
+	p->y = f.y;
+}
+
+inline void SM_CALLCONV StoreFloat3(Float3* p, Vector v)
+{
+	Float4 f;
+	StoreFloat4(&f, v);
+	p->x = f.x;
+	p->y = f.y;
+	p->z = f.z;
+}
+
+inline Matrix SM_CALLCONV LoadFloat4x4(const Float4x4* p)
+{
+	return Matrix(
+		LoadFloat4(reinterpret_cast<const Float4*>(p->m[0])),
+		LoadFloat4(reinterpret_cast<const Float4*>(p->m[1])),
+		LoadFloat4(reinterpret_cast<const Float4*>(p->m[2])),
+		LoadFloat4(reinterpret_cast<const Float4*>(p->m[3])));
+}
+
+inline void SM_CALLCONV StoreFloat4x4(Float4x4* p, const Matrix& m)
+{
+	for(int i = 0; i < 4; ++i)
+		StoreFloat4(reinterpret_cast<Float4*>(p->m[i]), m.r[i]);
+}
+
+//
+// Component access.
+//
+
+inline float SM_CALLCONV VectorGetX(Vector v) { return VectorGetByIndex(v, 0); }
+inline float SM_CALLCONV VectorGetY(Vector v) { return VectorGetByIndex(v, 1); }
+inline float SM_CALLCONV VectorGetZ(Vector v) { return VectorGetByIndex(v, 2); }
+inline float SM_CALLCONV VectorGetW(Vector v) { return VectorGetByIndex(v, 3); }
+
+inline Vector SM_CALLCONV VectorSplatX(Vector v) { return VectorSwizzle<0, 0, 0, 0>(v); }
+inline Vector SM_CALLCONV VectorSplatY(Vector v) { return VectorSwizzle<1, 1, 1, 1>(v); }
+inline Vector SM_CALLCONV VectorSplatZ(Vector v) { return VectorSwizzle<2, 2, 2, 2>(v); }
+inline Vector SM_CALLCONV VectorSplatW(Vector v) { return VectorSwizzle<3, 3, 3, 3>(v); }
+inline Vector SM_CALLCONV VectorSplatOne() { return VectorReplicate(1.0f); }
+
+inline Vector SM_CALLCONV VectorSetByIndex(Vector v, float s, int i)
+{
+	Float4 f;
+	StoreFloat4(&f, v);
+	(&f.x)[i] = s;
+	return LoadFloat4(&f);
+}
+
+inline Vector SM_CALLCONV VectorSetX(Vector v, float s) { return VectorSetByIndex(v, s, 0); }
+inline Vector SM_CALLCONV VectorSetY(Vector v, float s) { return VectorSetByIndex(v, s, 1); }
+inline Vector SM_CALLCONV VectorSetZ(Vector v, float s) { return VectorSetByIndex(v, s, 2); }
+inline Vector SM_CALLCONV VectorSetW(Vector v, float s) { return VectorSetByIndex(v, s, 3); }
+
+//
+// Component-wise arithmetic.
+//
+
+inline Vector SM_CALLCONV VectorScale(Vector v, float s) { return VectorMultiply(v, VectorReplicate(s)); }
+inline Vector SM_CALLCONV VectorNegate(Vector v) { return VectorSubtract(VectorZero(), v); }
+inline Vector SM_CALLCONV VectorAbs(Vector v) { return VectorMax(v, VectorNegate(v)); }
+inline Vector SM_CALLCONV VectorReciprocal(Vector v) { return VectorDivide(VectorSplatOne(), v); }
+inline Vector SM_CALLCONV VectorReciprocalSqrt(Vector v) { return VectorDivide(VectorSplatOne(), VectorSqrt(v)); }
+
+inline Vector SM_CALLCONV VectorSaturate(Vector v)
+{
+	return VectorMin(VectorMax(v, VectorZero()), VectorSplatOne());
+}
+
+inline Vector SM_CALLCONV VectorClamp(Vector v, Vector lo, Vector hi)
+{
+	return VectorMin(VectorMax(v, lo), hi);
+}
+
+// a + t*(b - a)
+inline Vector SM_CALLCONV VectorLerp(Vector a, Vector b, float t)
+{
+	return VectorMultiplyAdd(VectorSubtract(b, a), VectorReplicate(t), a);
+}
+
+inline Vector SM_CALLCONV VectorLerpV(Vector a, Vector b, Vector t)
+{
+	return VectorMultiplyAdd(VectorSubtract(b, a), t, a);
+}
+
+//
+// 3D vector functions.  The w component of the result is unspecified unless
+// noted, as in DirectXMath.
+//
+
+inline Vector SM_CALLCONV Vector3LengthSq(Vector v) { return Vector3Dot(v, v); }
+inline Vector SM_CALLCONV Vector3Length(Vector v) { return VectorSqrt(Vector3Dot(v, v)); }
+
+inline Vector SM_CALLCONV Vector3Normalize(Vector v)
+{
+	Vector len = Vector3Length(v);
+
+	// Zero length vectors stay zero instead of turning into NaNs.
+	Vector result = VectorDivide(v, len);
+	return VectorSelect(result, VectorZero(), VectorEqual(len, VectorZero()));
+}
+
+inline Vector SM_CALLCONV Vector3Cross(Vector a, Vector b)
+{
+	// (a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x, 0)
+	Vector aYZX = VectorSwizzle<1, 2, 0, 3>(a);
+	Vector bZXY = VectorSwizzle<2, 0, 1, 3>(b);
+	Vector aZXY = VectorSwizzle<2, 0, 1, 3>(a);
+	Vector bYZX = VectorSwizzle<1, 2, 0, 3>(b);
+	Vector r = VectorSubtract(VectorMultiply(aYZX, bZXY), VectorMultiply(aZXY, bYZX));
+	return VectorSetW(r, 0.0f);
+}
+
+inline Vector SM_CALLCONV Vector3AngleBetweenNormals(Vector n1, Vector n2)
+{
+	float d = VectorGetX(Vector3Dot(n1, n2));
+	d = d < -1.0f ? -1.0f : (d > 1.0f ? 1.0f : d);
+	return VectorReplicate(std::acos(d));
+}
+
+inline Vector SM_CALLCONV Vector3AngleBetweenVectors(Vector v1, Vector v2)
+{
+	return Vector3AngleBetweenNormals(Vector3Normalize(v1), Vector3Normalize(v2));
+}
+
+// Boolean comparisons of the x, y and z components.
+inline bool SM_CALLCONV Vector3Equal(Vector a, Vector b) { return (VectorMoveMask(VectorEqual(a, b)) & 7) == 7; }
+inline bool SM_CALLCONV Vector3NotEqual(Vector a, Vector b) { return (VectorMoveMask(VectorEqual(a, b)) & 7) != 7; }
+inline bool SM_CALLCONV Vector3Less(Vector a, Vector b) { return (VectorMoveMask(VectorLess(a, b)) & 7) == 7; }
+inline bool SM_CALLCONV Vector3LessOrEqual(Vector a, Vector b) { return (VectorMoveMask(VectorLessOrEqual(a, b)) & 7) == 7; }
+inline bool SM_CALLCONV Vector3Greater(Vector a, Vector b) { return (VectorMoveMask(VectorGreater(a, b)) & 7) == 7; }
+inline bool SM_CALLCONV Vector3GreaterOrEqual(Vector a, Vector b) { return (VectorMoveMask(VectorGreaterOrEqual(a, b)) & 7) == 7; }
+
+inline bool SM_CALLCONV Vector3NearEqual(Vector a, Vector b, Vector epsilon)
+{
+	Vector d = VectorAbs(VectorSubtract(a, b));
+	return (VectorMoveMask(VectorLessOrEqual(d, epsilon)) & 7) == 7;
+}
+
+//
+// 4D vector functions.
+//
+
+inline Vector SM_CALLCONV Vector4LengthSq(Vector v) { return Vector4Dot(v, v); }
+inline Vector SM_CALLCONV Vector4Length(Vector v) { return VectorSqrt(Vector4Dot(v, v)); }
+
+inline Vector SM_CALLCONV Vector4Normalize(Vector v)
+{
+	Vector len = Vector4Length(v);
+	Vector result = VectorDivide(v, len);
+	return VectorSelect(result, VectorZero(), VectorEqual(len, VectorZero()));
+}
+
+inline bool SM_CALLCONV Vector4NearEqual(Vector a, Vector b, Vector epsilon)
+{
+	Vector d = VectorAbs(VectorSubtract(a, b));
+	return VectorMoveMask(VectorLessOrEqual(d, epsilon)) == 15;
+}
+
+//
+// Vector/matrix transforms (row vector times matrix).
+//
+
+inline Vector SM_CALLCONV Vector4Transform(Vector v, const Matrix& m)
+{
+	Vector r = VectorMultiply(VectorSplatX(v), m.r[0]);
+	r = VectorMultiplyAdd(VectorSplatY(v), m.r[1], r);
+	r = VectorMultiplyAdd(VectorSplatZ(v), m.r[2], r);
+	return VectorMultiplyAdd(VectorSplatW(v), m.r[3], r);
+}
+
+// Treats v as a point (w = 1) and divides by the resulting w.
+inline Vector SM_CALLCONV Vector3TransformCoord(Vector v, const Matrix& m)
+{
+	Vector r = VectorMultiplyAdd(VectorSplatZ(v), m.r[2], m.r[3]);
+	r = VectorMultiplyAdd(VectorSplatY(v), m.r[1], r);
+	r = VectorMultiplyAdd(VectorSplatX(v), m.r[0], r);
+	return VectorDivide(r, VectorSplatW(r));
+}
+
+// Treats v as a direction (w = 0).
+inline Vector SM_CALLCONV Vector3TransformNormal(Vector v, const Matrix& m)
+{
+	Vector r = VectorMultiply(VectorSplatZ(v), m.r[2]);
+	r = VectorMultiplyAdd(VectorSplatY(v), m.r[1], r);
+	return VectorMultiplyAdd(VectorSplatX(v), m.r[0], r);
+}
+
+// Batch versions over strided arrays, like XMVector3TransformCoordStream.
+inline void SM_CALLCONV Vector3TransformCoordStream(
+	Float3* out, size_t outStride, const Float3* in, size_t inStride, size_t count, const Matrix& m)
+{
+	for(size_t i = 0; i < count; ++i)
+	{
+		const Float3* src = reinterpret_cast<const Float3*>(reinterpret_cast<const std::uint8_t*>(in) + i*inStride);
+		Float3* dst = reinterpret_cast<Float3*>(reinterpret_cast<std::uint8_t*>(out) + i*outStride);
+		StoreFloat3(dst, Vector3TransformCoord(LoadFloat3(src), m));
+	}
+}
+
+inline void SM_CALLCONV Vector3TransformNormalStream(
+	Float3* out, size_t outStride, const Float3* in, size_t inStride, size_t count, const Matrix& m)
+{
+	for(size_t i = 0; i < count; ++i)
+	{
+		const Float3* src = reinterpret_cast<const Float3*>(reinterpret_cast<const std::uint8_t*>(in) + i*inStride);
+		Float3* dst = reinterpret_cast<Float3*>(reinterpret_cast<std::uint8_t*>(out) + i*outStride);
+		StoreFloat3(dst, Vector3TransformNormal(LoadFloat3(src), m));
+	}
+}
+
+//
+// Matrices.
+//
+
+inline Matrix SM_CALLCONV MatrixSet(
+	float m00, float m01, float m02, float m03,
+	float m10, float m11, float m12, float m13,
+	float m20, float m21, float m22, float m23,
+	float m30, float m31, float m32, float m33)
+{
+	return Matrix(
+		VectorSet(m00, m01, m02, m03),
+		VectorSet(m10, m11, m12, m13),
+		VectorSet(m20, m21, m22, m23),
+		VectorSet(m30, m31, m32, m33));
+}
+
+inline Matrix SM_CALLCONV MatrixIdentity()
+{
+	return MatrixSet(
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+inline Matrix SM_CALLCONV MatrixMultiply(const Matrix& a, const Matrix& b)
+{
+	Matrix r;
+	for(int i = 0; i < 4; ++i)
+		r.r[i] = Vector4Transform(a.r[i], b);
+	return r;
+}
+
+inline Matrix SM_CALLCONV MatrixTranspose(const Matrix& m)
+{
+#if defined(SIMDMATH_SCALAR)
+	Matrix r;
+	for(int i = 0; i < 4; ++i)
+		for(int j = 0; j < 4; ++j)
+			r.r[i].f[j] = m.r[j].f[i];
+	return r;
+#else
+	Matrix r = m;
+	_MM_TRANSPOSE4_PS(r.r[0], r.r[1], r.r[2], r.r[3]);
+	return r;
+#endif
+}
+
+// Determinant replicated into all four components.
+inline Vector SM_CALLCONV MatrixDeterminant(const Matrix& m)
+{
+	Float4x4 f;
+	StoreFloat4x4(&f, m);
+
+	float s0 = f.m[0][0]*f.m[1][1] - f.m[1][0]*f.m[0][1];
+	float s1 = f.m[0][0]*f.m[1][2] - f.m[1][0]*f.m[0][2];
+	float s2 = f.m[0][0]*f.m[1][3] - f.m[1][0]*f.m[0][3];
+	float s3 = f.m[0][1]*f.m[1][2] - f.m[1][1]*f.m[0][2];
+	float s4 = f.m[0][1]*f.m[1][3] - f.m[1][1]*f.m[0][3];
+	float s5 = f.m[0][2]*f.m[1][3] - f.m[1][2]*f.m[0][3];
+
+	float c5 = f.m[2][2]*f.m[3][3] - f.m[3][2]*f.m[2][3];
+	float c4 = f.m[2][1]*f.m[3][3] - f.m[3][1]*f.m[2][3];
+	float c3 = f.m[2][1]*f.m[3][2] - f.m[3][1]*f.m[2][2];
+	float c2 = f.m[2][0]*f.m[3][3] - f.m[3][0]*f.m[2][3];
+	float c1 = f.m[2][0]*f.m[3][2] - f.m[3][0]*f.m[2][2];
+	float c0 = f.m[2][0]*f.m[3][1] - f.m[3][0]*f.m[2][1];
+
+	return VectorReplicate(s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0);
+}
+
+// General 4x4 inverse by 2x2 sub-determinants (Laplace expansion).  The
+// determinant is written to det if it is not null; a singular matrix returns
+// the identity matrix.
+inline Matrix SM_CALLCONV MatrixInverse(Vector* det, const Matrix& m)
+{
+	Float4x4 f;
+	StoreFloat4x4(&f, m);
+	const float (*a)[4] = f.m;
+
+	float s0 = a[0][0]*a[1][1] - a[1][0]*a[0][1];
+	float s1 = a[0][0]*a[1][2] - a[1][0]*a[0][2];
+	float s2 = a[0][0]*a[1][3] - a[1][0]*a[0][3];
+	float s3 = a[0][1]*a[1][2] - a[1][1]*a[0][2];
+	float s4 = a[0][1]*a[1][3] - a[1][1]*a[0][3];
+	float s5 = a[0][2]*a[1][3] - a[1][2]*a[0][3];
+
+	float c5 = a[2][2]*a[3][3] - a[3][2]*a[2][3];
+	float c4 = a[2][1]*a[3][3] - a[3][1]*a[2][3];
+	float c3 = a[2][1]*a[3][2] - a[3][1]*a[2][2];
+	float c2 = a[2][0]*a[3][3] - a[3][0]*a[2][3];
+	float c1 = a[2][0]*a[3][2] - a[3][0]*a[2][2];
+	float c0 = a[2][0]*a[3][1] - a[3][0]*a[2][1];
+
+	float d = s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0;
+	if(det != nullptr)
+		*det = VectorReplicate(d);
+
+	if(d == 0.0f)
+		return MatrixIdentity();
+
+	float inv = 1.0f / d;
+
+	Float4x4 r;
+	r.m[0][0] = ( a[1][1]*c5 - a[1][2]*c4 + a[1][3]*c3)*inv;
+	r.m[0][1] = (-a[0][1]*c5 + a[0][2]*c4 - a[0][3]*c3)*inv;
+	r.m[0][2] = ( a[3][1]*s5 - a[3][2]*s4 + a[3][3]*s3)*inv;
+	r.m[0][3] = (-a[2][1]*s5 + a[2][2]*s4 - a[2][3]*s3)*inv;
+
+	r.m[1][0] = (-a[1][0]*c5 + a[1][2]*c2 - a[1][3]*c1)*inv;
+	r.m[1][1] = ( a[0][0]*c5 - a[0][2]*c2 + a[0][3]*c1)*inv;
+	r.m[1][2] = (-a[3][0]*s5 + a[3][2]*s2 - a[3][3]*s1)*inv;
+	r.m[1][3] = ( a[2][0]*s5 - a[2][2]*s2 + a[2][3]*s1)*inv;
+
+	r.m[2][0] = ( a[1][0]*c4 - a[1][1]*c2 + a[1][3]*c0)*inv;
+	r.m[2][1] = (-a[0][0]*c4 + a[0][1]*c2 - a[0][3]*c0)*inv;
+	r.m[2][2] = ( a[3][0]*s4 - a[3][1]*s2 + a[3][3]*s0)*inv;
+	r.m[2][3] = (-a[2][0]*s4 + a[2][1]*s2 - a[2][3]*s0)*inv;
+
+	r.m[3][0] = (-a[1][0]*c3 + a[1][1]*c1 - a[1][2]*c0)*inv;
+	r.m[3][1] = ( a[0][0]*c3 - a[0][1]*c1 + a[0][2]*c0)*inv;
+	r.m[3][2] = (-a[3][0]*s3 + a[3][1]*s1 - a[3][2]*s0)*inv;
+	r.m[3][3] = ( a[2][0]*s3 - a[2][1]*s1 + a[2][2]*s0)*inv;
+
+	return LoadFloat4x4(&r);
+}
+
+inline Matrix SM_CALLCONV MatrixScaling(float sx, float sy, float sz)
+{
+	return MatrixSet(
+		sx, 0.0f, 0.0f, 0.0f,
+		0.0f, sy, 0.0f, 0.0f,
+		0.0f, 0.0f, sz, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+inline Matrix SM_CALLCONV MatrixScalingFromVector(Vector s)
+{
+	return MatrixScaling(VectorGetX(s), VectorGetY(s), VectorGetZ(s));
+}
+
+inline Matrix SM_CALLCONV MatrixTranslation(float x, float y, float z)
+{
+	return MatrixSet(
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		x, y, z, 1.0f);
+}
+
+inline Matrix SM_CALLCONV MatrixTranslationFromVector(Vector t)
+{
+	return MatrixTranslation(VectorGetX(t), VectorGetY(t), VectorGetZ(t));
+}
+
+inline Matrix SM_CALLCONV MatrixRotationX(float angle)
+{
+	float s = std::sin(angle);
+	float c = std::cos(angle);
+	return MatrixSet(
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, c, s, 0.0f,
+		0.0f, -s, c, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+inline Matrix SM_CALLCONV MatrixRotationY(float angle)
+{
+	float s = std::sin(angle);
+	float c = std::cos(angle);
+	return MatrixSet(
+		c, 0.0f, -s, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		s, 0.0f, c, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+inline Matrix SM_CALLCONV MatrixRotationZ(float angle)
+{
+	float s = std::sin(angle);
+	float c = std::cos(angle);
+	return MatrixSet(
+		c, s, 0.0f, 0.0f,
+		-s, c, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+// Rotation about a unit length axis.
+inline Matrix SM_CALLCONV MatrixRotationNormal(Vector axis, float angle)
+{
+	float x = VectorGetX(axis);
+	float y = VectorGetY(axis);
+	float z = VectorGetZ(axis);
+	float s = std::sin(angle);
+	float c = std::cos(angle);
+	float t = 1.0f - c;
+
+	return MatrixSet(
+		t*x*x + c,   t*x*y + s*z, t*x*z - s*y, 0.0f,
+		t*x*y - s*z, t*y*y + c,   t*y*z + s*x, 0.0f,
+		t*x*z + s*y, t*y*z - s*x, t*z*z + c,   0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+inline Matrix SM_CALLCONV MatrixRotationAxis(Vector axis, float angle)
+{
+	return MatrixRotationNormal(Vector3Normalize(axis), angle);
+}
+
+inline Matrix SM_CALLCONV MatrixLookToLH(Vector eyePos, Vector eyeDir, Vector up)
+{
+	Vector r2 = Vector3Normalize(eyeDir);
+	Vector r0 = Vector3Normalize(Vector3Cross(up, r2));
+	Vector r1 = Vector3Cross(r2, r0);
+
+	Vector negEye = VectorNegate(eyePos);
+	float d0 = VectorGetX(Vector3Dot(r0, negEye));
+	float d1 = VectorGetX(Vector3Dot(r1, negEye));
+	float d2 = VectorGetX(Vector3Dot(r2, negEye));
+
+	Matrix m(
+		VectorSetW(r0, d0),
+		VectorSetW(r1, d1),
+		VectorSetW(r2, d2),
+		VectorSet(0.0f, 0.0f, 0.0f, 1.0f));
+
+	return MatrixTranspose(m);
+}
+
+inline Matrix SM_CALLCONV MatrixLookAtLH(Vector eyePos, Vector focusPos, Vector up)
+{
+	return MatrixLookToLH(eyePos, VectorSubtract(focusPos, eyePos), up);
+}
+
+inline Matrix SM_CALLCONV MatrixPerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ)
+{
+	float height = std::cos(0.5f*fovAngleY) / std::sin(0.5f*fovAngleY);
+	float width = height / aspectRatio;
+	float range = farZ / (farZ - nearZ);
+
+	return MatrixSet(
+		width, 0.0f, 0.0f, 0.0f,
+		0.0f, height, 0.0f, 0.0f,
+		0.0f, 0.0f, range, 1.0f,
+		0.0f, 0.0f, -range*nearZ, 0.0f);
+}
+
+inline Matrix SM_CALLCONV MatrixOrthographicOffCenterLH(
+	float left, float right, float bottom, float top, float nearZ, float farZ)
+{
+	float rw = 1.0f / (right - left);
+	float rh = 1.0f / (top - bottom);
+	float range = 1.0f / (farZ - nearZ);
+
+	return MatrixSet(
+		rw + rw, 0.0f, 0.0f, 0.0f,
+		0.0f, rh + rh, 0.0f, 0.0f,
+		0.0f, 0.0f, range, 0.0f,
+		-(left + right)*rw, -(top + bottom)*rh, -range*nearZ, 1.0f);
+}
+
+// Reflection about the plane (a, b, c, d) with a unit normal.
+inline Matrix SM_CALLCONV MatrixReflect(Vector plane)
+{
+	float a = VectorGetX(plane);
+	float b = VectorGetY(plane);
+	float c = VectorGetZ(plane);
+	float d = VectorGetW(plane);
+
+	return MatrixSet(
+		1.0f - 2.0f*a*a, -2.0f*a*b, -2.0f*a*c, 0.0f,
+		-2.0f*b*a, 1.0f - 2.0f*b*b, -2.0f*b*c, 0.0f,
+		-2.0f*c*a, -2.0f*c*b, 1.0f - 2.0f*c*c, 0.0f,
+		-2.0f*d*a, -2.0f*d*b, -2.0f*d*c, 1.0f);
+}
+
+//
+// Quaternions.
+//
+
+inline Vector SM_CALLCONV QuaternionIdentity() { return VectorSet(0.0f, 0.0f, 0.0f, 1.0f); }
+
+inline Vector SM_CALLCONV QuaternionNormalize(Vector q) { return Vector4Normalize(q); }
+
+inline Vector SM_CALLCONV QuaternionConjugate(Vector q)
+{
+	return VectorMultiply(q, VectorSet(-1.0f, -1.0f, -1.0f, 1.0f));
+}
+
+// Returns q1*q2, which represents the rotation q1 followed by q2 (DirectXMath order).
+inline Vector SM_CALLCONV QuaternionMultiply(Vector q1, Vector q2)
+{
+	float x1 = VectorGetX(q1), y1 = VectorGetY(q1), z1 = VectorGetZ(q1), w1 = VectorGetW(q1);
+	float x2 = VectorGetX(q2), y2 = VectorGetY(q2), z2 = VectorGetZ(q2), w2 = VectorGetW(q2);
+
+	return VectorSet(
+		w2*x1 + x2*w1 + y2*z1 - z2*y1,
+		w2*y1 - x2*z1 + y2*w1 + z2*x1,
+		w2*z1 + x2*y1 - y2*x1 + z2*w1,
+		w2*w1 - x2*x1 - y2*y1 - z2*z1);
+}
+
+inline Vector SM_CALLCONV QuaternionRotationNormal(Vector axis, float angle)
+{
+	float s = std::sin(0.5f*angle);
+	float c = std::cos(0.5f*angle);
+	return VectorSetW(VectorScale(axis, s), c);
+}
+
+inline Vector SM_CALLCONV QuaternionRotationAxis(Vector axis, float angle)
+{
+	return QuaternionRotationNormal(Vector3Normalize(axis), angle);
+}
+
+// Same rotation order as XMQuaternionRotationRollPitchYaw: roll (z), then pitch (x), then yaw (y).
+inline Vector SM_CALLCONV QuaternionRotationRollPitchYaw(float pitch, float yaw, float roll)
+{
+	float sp = std::sin(0.5f*pitch), cp = std::cos(0.5f*pitch);
+	float sy = std::sin(0.5f*yaw),   cy = std::cos(0.5f*yaw);
+	float sr = std::sin(0.5f*roll),  cr = std::cos(0.5f*roll);
+
+	return VectorSet(
+		cr*sp*cy + sr*cp*sy,
+		cr*cp*sy - sr*sp*cy,
+		sr*cp*cy - cr*sp*sy,
+		cr*cp*cy + sr*sp*sy);
+}
+
+inline Vector SM_CALLCONV QuaternionSlerp(Vector q0, Vector q1, float t)
+{
+	float cosOmega = VectorGetX(Vector4Dot(q0, q1));
+
+	// Take the short way around.
+	if(cosOmega < 0.0f)
+	{
+		q1 = VectorNegate(q1);
+		cosOmega = -cosOmega;
+	}
+
+	float k0, k1;
+	if(cosOmega > 0.9999f)
+	{
+		// Nearly parallel, fall back to lerp to avoid dividing by sin(0).
+		k0 = 1.0f - t;
+		k1 = t;
+	}
+	else
+	{
+		float sinOmega = std::sqrt(1.0f - cosOmega*cosOmega);
+		float omega = std::atan2(sinOmega, cosOmega);
+		float invSin = 1.0f / sinOmega;
+		k0 = std::sin((1.0f - t)*omega)*invSin;
+		k1 = std::sin(t*omega)*invSin;
+	}
+
+	Vector r = VectorMultiplyAdd(q1, VectorReplicate(k1), VectorScale(q0, k0));
+	return QuaternionNormalize(r);
+}
+
+inline Matrix SM_CALLCONV MatrixRotationQuaternion(Vector q)
+{
+	float x = VectorGetX(q), y = VectorGetY(q), z = VectorGetZ(q), w = VectorGetW(q);
+	float xx = x*x, yy = y*y, zz = z*z;
+	float xy = x*y, xz = x*z, yz = y*z;
+	float wx = w*x, wy = w*y, wz = w*z;
+
+	return MatrixSet(
+		1.0f - 2.0f*(yy + zz), 2.0f*(xy + wz), 2.0f*(xz - wy), 0.0f,
+		2.0f*(xy - wz), 1.0f - 2.0f*(xx + zz), 2.0f*(yz + wx), 0.0f,
+		2.0f*(xz + wy), 2.0f*(yz - wx), 1.0f - 2.0f*(xx + yy), 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+inline Vector SM_CALLCONV QuaternionRotationMatrix(const Matrix& m)
+{
+	Float4x4 f;
+	StoreFloat4x4(&f, m);
+	const float (*a)[4] = f.m;
+
+	float trace = a[0][0] + a[1][1] + a[2][2];
+	float x, y, z, w;
+	if(trace > 0.0f)
+	{
+		float s = 2.0f*std::sqrt(trace + 1.0f);
+		w = 0.25f*s;
+		x = (a[1][2] - a[2][1]) / s;
+		y = (a[2][0] - a[0][2]) / s;
+		z = (a[0][1] - a[1][0]) / s;
+	}
+	else if(a[0][0] > a[1][1] && a[0][0] > a[2][2])
+	{
+		float s = 2.0f*std::sqrt(1.0f + a[0][0] - a[1][1] - a[2][2]);
+		w = (a[1][2] - a[2][1]) / s;
+		x = 0.25f*s;
+		y = (a[0][1] + a[1][0]) / s;
+		z = (a[2][0] + a[0][2]) / s;
+	}
+	else if(a[1][1] > a[2][2])
+	{
+		float s = 2.0f*std::sqrt(1.0f + a[1][1] - a[0][0] - a[2][2]);
+		w = (a[2][0] - a[0][2]) / s;
+		x = (a[0][1] + a[1][0]) / s;
+		y = 0.25f*s;
+		z = (a[1][2] + a[2][1]) / s;
+	}
+	else
+	{
+		float s = 2.0f*std::sqrt(1.0f + a[2][2] - a[0][0] - a[1][1]);
+		w = (a[0][1] - a[1][0]) / s;
+		x = (a[2][0] + a[0][2]) / s;
+		y = (a[1][2] + a[2][1]) / s;
+		z = 0.25f*s;
+	}
+
+	return VectorSet(x, y, z, w);
+}
+
+// Rotates v by the unit quaternion q.
+inline Vector SM_CALLCONV Vector3Rotate(Vector v, Vector q)
+{
+	Vector p = VectorSetW(v, 0.0f);
+	return QuaternionMultiply(QuaternionMultiply(QuaternionConjugate(q), p), q);
+}
+
+// Scale, then rotate about rotationOrigin, then translate; as used by the
+// skinned mesh keyframe interpolation.
+inline Matrix SM_CALLCONV MatrixAffineTransformation(
+	Vector scaling, Vector rotationOrigin, Vector rotationQuaternion, Vector translation)
+{
+	Matrix s = MatrixScalingFromVector(scaling);
+	Matrix r = MatrixRotationQuaternion(rotationQuaternion);
+
+	Vector origin = VectorSetW(rotationOrigin, 0.0f);
+
+	Matrix m = MatrixMultiply(s, MatrixTranslationFromVector(VectorNegate(origin)));
+	m = MatrixMultiply(m, r);
+	m.r[3] = VectorAdd(m.r[3], VectorSetW(VectorAdd(origin, translation), 0.0f));
+	return m;
+}
+
+}
@@ -0,0 +1,236 @@
+//***************************************************************************************
+// TaskGraph.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TaskGraph.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+const TaskGraph::TaskId TaskGraph::NoTask;
+
+TaskGraph::ResourceId TaskGraph::AddResource(const std::string& name)
+{
+	Resource r;
+	r.Name = name;
+	mResources.push_back(r);
+
+	return (ResourceId)mResources.size() - 1;
+}
+
+TaskGraph::TaskId TaskGraph::AddTask(const std::string& name, TaskFunction function,
+	std::initializer_list<ResourceId> reads,
+	std::initializer_list<ResourceId> writes)
+{
+	TaskId id = (TaskId)mTasks.size();
+
+	Task t;
+	t.Name = name;
+	t.Function = std::move(function);
+	mTasks.push_back(std::move(t));
+
+	// Reads wait for the last writer.
+	for(ResourceId r : reads)
+	{
+		assert(r < mResources.size());
+		Resource& res = mResources[r];
+		if(res.LastWriter != NoTask)
+			AddEdge(res.LastWriter, id);
+	}
+
+	// Writes wait for the last writer and for everybody who read since.
+	for(ResourceId r : writes)
+	{
+		assert(r < mResources.size());
+		Resource& res = mResources[r];
+		if(res.LastWriter != NoTask)
+			AddEdge(res.LastWriter, id);
+		for(TaskId reader : res.Readers)
+			AddEdge(reader, id);
+	}
+
+	// Update the resources after all edges are in, so a task that reads and
+	// writes the same resource does not depend on itself.
+	for(ResourceId r : reads)
+		mResources[r].Readers.push_back(id);
+	for(ResourceId r : writes)
+	{
+		mResources[r].LastWriter = id;
+		mResources[r].Readers.clear();
+	}
+
+	return id;
+}
+
+void TaskGraph::AddEdge(TaskId from, TaskId to)
+{
+	if(from == to)
+		return;
+
+	auto& preds = mTasks[to].Predecessors;
+	if(std::find(preds.begin(), preds.end(), from) != preds.end())
+		return;
+
+	preds.push_back(from);
+	mTasks[from].Successors.push_back(to);
+}
+
+void TaskGraph::Clear()
+{
+	mTasks.clear();
+	mResources.clear();
+	mStats = FrameStats();
+}
+
+const TaskGraph::FrameStats& TaskGraph::Run(ThreadPool& pool)
+{
+	mRunStart = std::chrono::high_resolution_clock::now();
+
+	mWaitingFor.resize(mTasks.size());
+	mReady.clear();
+	mRemaining = (std::uint32_t)mTasks.size();
+	mAborted = false;
+	mException = nullptr;
+
+	// Tasks are picked from the back, so push the roots in reverse to start
+	// with the first added.
+	for(size_t i = mTasks.size(); i-- > 0;)
+	{
+		mWaitingFor[i] = (std::uint32_t)mTasks[i].Predecessors.size();
+		if(mWaitingFor[i] == 0)
+			mReady.push_back((TaskId)i);
+	}
+
+	// One loop per worker; each runs ready tasks until all are done.
+	pool.ParallelFor(pool.WorkerCount(), [this](std::uint32_t index, std::uint32_t worker)
+	{
+		WorkerLoop(worker);
+	});
+
+	if(mException)
+	{
+		std::exception_ptr e = mException;
+		mException = nullptr;
+		std::rethrow_exception(e);
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	mStats.WallMilliseconds = std::chrono::duration<float, std::milli>(end - mRunStart).count();
+
+	ComputeCriticalPath();
+
+	return mStats;
+}
+
+void TaskGraph::WorkerLoop(std::uint32_t worker)
+{
+	for(;;)
+	{
+		TaskId id;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mReadyChanged.wait(lock, [this] { return !mReady.empty() || mRemaining == 0 || mAborted; });
+			if(mRemaining == 0 || mAborted)
+				return;
+
+			id = mReady.back();
+			mReady.pop_back();
+		}
+
+		Task& task = mTasks[id];
+		auto start = std::chrono::high_resolution_clock::now();
+
+		try
+		{
+			task.Function();
+		}
+		catch(...)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if(!mException)
+				mException = std::current_exception();
+			mAborted = true;
+			mReadyChanged.notify_all();
+			return;
+		}
+
+		auto end = std::chrono::high_resolution_clock::now();
+		task.Timing.StartMilliseconds = std::chrono::duration<float, std::milli>(start - mRunStart).count();
+		task.Timing.Milliseconds = std::chrono::duration<float, std::milli>(end - start).count();
+		task.Timing.Worker = worker;
+
+		bool wake = false;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mRemaining--;
+			for(TaskId s : task.Successors)
+			{
+				if(--mWaitingFor[s] == 0)
+				{
+					mReady.push_back(s);
+					wake = true;
+				}
+			}
+			wake = wake || mRemaining == 0;
+		}
+
+		if(wake)
+			mReadyChanged.notify_all();
+	}
+}
+
+void TaskGraph::ComputeCriticalPath()
+{
+	// Tasks only depend on earlier tasks, so the order they were added in is a
+	// topological order.
+	std::vector<float> finish(mTasks.size());
+	std::vector<TaskId> via(mTasks.size(), NoTask);
+
+	mStats.SerialMilliseconds = 0.0f;
+	TaskId last = NoTask;
+	for(TaskId i = 0; i < (TaskId)mTasks.size(); ++i)
+	{
+		float start = 0.0f;
+		for(TaskId p : mTasks[i].Predecessors)
+		{
+			if(finish[p] > start)
+			{
+				start = finish[p];
+				via[i] = p;
+			}
+		}
+
+		finish[i] = start + mTasks[i].Timing.Milliseconds;
+		mStats.SerialMilliseconds += mTasks[i].Timing.Milliseconds;
+
+		if(last == NoTask || finish[i] > finish[last])
+			last = i;
+	}
+
+	mStats.CriticalPath.clear();
+	mStats.CriticalPathMilliseconds = last == NoTask ? 0.0f : finish[last];
+	for(TaskId t = last; t != NoTask; t = via[t])
+		mStats.CriticalPath.push_back(t);
+	std::reverse(mStats.CriticalPath.begin(), mStats.CriticalPath.end());
+}
+
+std::string TaskGraph::CriticalPathToString()const
+{
+	std::string s;
+	char buf[64];
+
+	for(size_t i = 0; i < mStats.CriticalPath.size(); ++i)
+	{
+		const Task& t = mTasks[mStats.CriticalPath[i]];
+		if(i > 0)
+			s += " > ";
+		snprintf(buf, sizeof(buf), " %.2f", t.Timing.Milliseconds);
+		s += t.Name + buf;
+	}
+
+	snprintf(buf, sizeof(buf), " = %.2f ms (serial %.2f ms)",
+		mStats.CriticalPathMilliseconds, mStats.SerialMilliseconds);
+	s += buf;
+
+	return s;
+}
@@ -0,0 +1,111 @@
+//***************************************************************************************
+// TaskGraph.h by DanielDFY
+//
+// Runs a fixed set of per-frame tasks (e.g. the stages of Update) on a ThreadPool,
+// as concurrently as their data allows.  Each task declares the resources it
+// reads and writes; a task runs after every earlier-added task it conflicts
+// with (read after write, write after read, write after write), so the result
+// is the same as calling the tasks one after another in the order they were
+// added.
+//
+// Every Run measures the tasks and reports the critical path: the chain of
+// dependent tasks with the largest total time, i.e. the shortest the frame's
+// work can take no matter how many workers there are.
+//***************************************************************************************
+
+#pragma once
+
+#include "ThreadPool.h"
+#include <chrono>
+#include <initializer_list>
+#include <string>
+
+class TaskGraph
+{
+public:
+	typedef std::uint32_t TaskId;
+	typedef std::uint32_t ResourceId;
+	typedef std::function<void()> TaskFunction;
+
+	struct FrameStats
+	{
+		// From the start of Run to the end of the last task.
+		float WallMilliseconds = 0.0f;
+
+		// Sum of all task times, what running them one after another would cost.
+		float SerialMilliseconds = 0.0f;
+
+		float CriticalPathMilliseconds = 0.0f;
+		std::vector<TaskId> CriticalPath;
+	};
+
+	struct TaskTiming
+	{
+		float StartMilliseconds = 0.0f;
+		float Milliseconds = 0.0f;
+		std::uint32_t Worker = 0;
+	};
+
+	ResourceId AddResource(const std::string& name);
+
+	TaskId AddTask(const std::string& name, TaskFunction function,
+		std::initializer_list<ResourceId> reads,
+		std::initializer_list<ResourceId> writes);
+
+	void Clear();
+
+	// Runs every task once and returns when all are done.  If a task throws,
+	// tasks not started yet are skipped and the exception is rethrown here.
+	const FrameStats& Run(ThreadPool& pool);
+
+	const FrameStats& GetFrameStats()const { return mStats; }
+	const TaskTiming& GetTaskTiming(TaskId id)const { return mTasks[id].Timing; }
+
+	std::uint32_t TaskCount()const { return (std::uint32_t)mTasks.size(); }
+	const std::string& TaskName(TaskId id)const { return mTasks[id].Name; }
+	const std::vector<TaskId>& Predecessors(TaskId id)const { return mTasks[id].Predecessors; }
+
+	// e.g. "Input 0.02 > MainPassCB 0.05 > SsaoCB 0.11 = 0.18 ms (serial 0.40 ms)"
+	std::string CriticalPathToString()const;
+
+private:
+	void AddEdge(TaskId from, TaskId to);
+	void WorkerLoop(std::uint32_t worker);
+	void ComputeCriticalPath();
+
+private:
+	struct Task
+	{
+		std::string Name;
+		TaskFunction Function;
+		std::vector<TaskId> Predecessors;
+		std::vector<TaskId> Successors;
+		TaskTiming Timing;
+	};
+
+	struct Resource
+	{
+		std::string Name;
+
+		// Last task that wrote the resource and the tasks that read it since.
+		TaskId LastWriter = NoTask;
+		std::vector<TaskId> Readers;
+	};
+
+	static const TaskId NoTask = ~0u;
+
+	std::vector<Task> mTasks;
+	std::vector<Resource> mResources;
+
+	// Run state.
+	std::mutex mMutex;
+	std::condition_variable mReadyChanged;
+	std::vector<TaskId> mReady;
+	std::vector<std::uint32_t> mWaitingFor;
+	std::uint32_t mRemaining = 0;
+	bool mAborted = false;
+	std::exception_ptr mException;
+	std::chrono::high_resolution_clock::time_point mRunStart;
+
+	FrameStats mStats;
+};
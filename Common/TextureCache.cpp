@@ -0,0 +1,491 @@
+//***************************************************************************************
+// TextureCache.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TextureCache.h"
+#include "Hash.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+
+const TextureCache::TextureId TextureCache::InvalidTexture;
+
+namespace
+{
+	// Desc has padding after IsCubeMap, so it is hashed and compared by field.
+	const std::uint32_t DescWordCount = 9;
+
+	void GetDescWords(const DDSFile::Desc& desc, std::uint32_t words[DescWordCount])
+	{
+		words[0] = (std::uint32_t)desc.Dimension;
+		words[1] = (std::uint32_t)desc.Format;
+		words[2] = desc.Width;
+		words[3] = desc.Height;
+		words[4] = desc.Depth;
+		words[5] = desc.MipLevels;
+		words[6] = desc.ArraySize;
+		words[7] = desc.IsCubeMap ? 1 : 0;
+		words[8] = desc.AlphaMode;
+	}
+
+	bool SameDesc(const DDSFile::Desc& a, const DDSFile::Desc& b)
+	{
+		std::uint32_t wordsA[DescWordCount];
+		std::uint32_t wordsB[DescWordCount];
+		GetDescWords(a, wordsA);
+		GetDescWords(b, wordsB);
+
+		return std::equal(wordsA, wordsA + DescWordCount, wordsB);
+	}
+}
+
+double TextureCache::Stats::HitRate()const
+{
+	if(Requests == 0)
+		return 0.0;
+
+	return (double)(PathHits + Coalesced + ContentHits) / (double)Requests;
+}
+
+std::string TextureCache::Stats::ToString()const
+{
+	std::ostringstream s;
+	s << Requests << " requests: " << PathHits << " path hits, " << Coalesced << " coalesced, "
+		<< Misses << " misses (" << ContentHits << " resident under another path), "
+		<< FailedLoads << " failed; hit rate " << (int)(HitRate() * 100.0 + 0.5) << "%; "
+		<< ResidentTextures << " textures, " << (ResidentBytes >> 10) << " KB resident (peak "
+		<< (PeakResidentBytes >> 10) << " KB), " << Evictions << " evicted";
+	return s.str();
+}
+
+TextureCache::Handle::Handle(TextureCache* cache, std::uint32_t entry) :
+	mCache(cache),
+	mEntry(entry)
+{
+	mCache->AddRef(mEntry);
+}
+
+TextureCache::Handle::Handle(const Handle& rhs) :
+	mCache(rhs.mCache),
+	mEntry(rhs.mEntry)
+{
+	if(mCache != nullptr)
+		mCache->AddRef(mEntry);
+}
+
+TextureCache::Handle::Handle(Handle&& rhs) :
+	mCache(rhs.mCache),
+	mEntry(rhs.mEntry)
+{
+	rhs.mCache = nullptr;
+}
+
+TextureCache::Handle& TextureCache::Handle::operator=(const Handle& rhs)
+{
+	if(rhs.mCache != nullptr)
+		rhs.mCache->AddRef(rhs.mEntry);
+
+	Reset();
+	mCache = rhs.mCache;
+	mEntry = rhs.mEntry;
+
+	return *this;
+}
+
+TextureCache::Handle& TextureCache::Handle::operator=(Handle&& rhs)
+{
+	if(this != &rhs)
+	{
+		Reset();
+		mCache = rhs.mCache;
+		mEntry = rhs.mEntry;
+		rhs.mCache = nullptr;
+	}
+
+	return *this;
+}
+
+TextureCache::Handle::~Handle()
+{
+	Reset();
+}
+
+void TextureCache::Handle::Reset()
+{
+	if(mCache != nullptr)
+	{
+		mCache->Release(mEntry);
+		mCache = nullptr;
+	}
+}
+
+TextureCache::TextureCache(Backend& backend) :
+	TextureCache(backend, Settings())
+{
+}
+
+TextureCache::TextureCache(Backend& backend, const Settings& settings) :
+	mBackend(backend),
+	mSettings(settings)
+{
+	for(std::uint32_t i = 0; i < mSettings.IoThreads; ++i)
+		mIoThreads.emplace_back(&TextureCache::IoThreadMain, this);
+}
+
+TextureCache::~TextureCache()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+	mWake.notify_all();
+
+	for(std::thread& t : mIoThreads)
+		t.join();
+
+#ifndef NDEBUG
+	for(const auto& e : mEntries)
+		assert(e->RefCount == 0 && "a TextureCache::Handle outlived its cache");
+#endif
+}
+
+std::string TextureCache::NormalizePath(const std::string& filename)
+{
+	std::string path = filename;
+	for(char& c : path)
+	{
+		if(c == '\\')
+			c = '/';
+		else if(c >= 'A' && c <= 'Z')
+			c = (char)(c - 'A' + 'a');
+	}
+
+	return path;
+}
+
+TextureCache::Handle TextureCache::Acquire(const std::string& filename)
+{
+	mStats.Requests++;
+
+	std::string path = NormalizePath(filename);
+	auto it = mEntriesByPath.find(path);
+
+	std::uint32_t index;
+	if(it == mEntriesByPath.end())
+	{
+		auto e = std::make_unique<Entry>();
+		e->Filename = filename;
+
+		index = (std::uint32_t)mEntries.size();
+		mEntries.push_back(std::move(e));
+		mEntriesByPath.emplace(path, index);
+	}
+	else
+	{
+		index = it->second;
+	}
+
+	Entry& e = *mEntries[index];
+	if(e.Loading)
+	{
+		mStats.Coalesced++;
+	}
+	else if(e.Texture != InvalidTexture || e.Failed)
+	{
+		mStats.PathHits++;
+	}
+	else
+	{
+		mStats.Misses++;
+		Issue(e);
+	}
+
+	return Handle(this, index);
+}
+
+void TextureCache::AddRef(std::uint32_t entry)
+{
+	Entry& e = *mEntries[entry];
+	e.RefCount++;
+
+	if(e.Texture != InvalidTexture)
+		mResidents[e.Texture].RefCount++;
+}
+
+void TextureCache::Release(std::uint32_t entry)
+{
+	Entry& e = *mEntries[entry];
+	assert(e.RefCount > 0);
+	e.RefCount--;
+
+	// Nothing observes the failure anymore; the next Acquire retries.
+	if(e.RefCount == 0)
+		e.Failed = false;
+
+	if(e.Texture != InvalidTexture)
+	{
+		Resident& r = mResidents[e.Texture];
+		assert(r.RefCount > 0);
+		if(--r.RefCount == 0)
+			r.ReleasedTick = ++mTick;
+	}
+}
+
+void TextureCache::IoThreadMain()
+{
+	Profiler::Get().SetThreadName("Texture I/O");
+
+	for(;;)
+	{
+		Entry* e;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWake.wait(lock, [this] { return mQuit || !mRequests.empty(); });
+			if(mQuit)
+				return;
+
+			e = mRequests.front();
+			mRequests.pop_front();
+		}
+
+		Load(*e);
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mCompleted.push_back(e);
+			mLoadsInFlight--;
+		}
+		mDone.notify_all();
+	}
+}
+
+void TextureCache::Load(Entry& e)
+{
+	PROFILE_SCOPE("TextureCache::Load");
+
+	e.LoadStatus = e.File.Open(e.Filename);
+	if(e.LoadStatus != DDSFile::Status::Ok)
+		return;
+
+	// Hashing reads every byte, which also faults the pages in, so the upload
+	// on the main thread copies from memory instead of waiting for the disk.
+	std::uint32_t words[DescWordCount];
+	GetDescWords(e.File.GetDesc(), words);
+
+	std::uint64_t hash = Hash64(words, sizeof(words));
+	for(const DDSFile::Subresource& s : e.File.Subresources())
+		hash = Hash64(s.Data, (std::size_t)(s.SlicePitch * s.Depth), hash);
+
+	e.Hash = hash;
+}
+
+void TextureCache::Issue(Entry& e)
+{
+	assert(!e.Loading);
+	e.Loading = true;
+
+	if(mIoThreads.empty())
+	{
+		Load(e);
+		mCompleted.push_back(&e);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mRequests.push_back(&e);
+		mLoadsInFlight++;
+	}
+	mWake.notify_one();
+}
+
+void TextureCache::CompleteLoads()
+{
+	std::vector<Entry*> completed;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		completed.swap(mCompleted);
+	}
+
+	for(Entry* e : completed)
+		Complete(*e);
+}
+
+TextureCache::TextureId TextureCache::FindTexture(const Entry& e)const
+{
+	auto range = mTexturesByHash.equal_range(e.Hash);
+	for(auto it = range.first; it != range.second; ++it)
+	{
+		// The hash covers the desc already; comparing it again rules out most
+		// collisions for the price of a few words.
+		const Resident& r = mResidents[it->second];
+		if(r.Bytes == e.File.DataSize() && SameDesc(r.Desc, e.File.GetDesc()))
+			return it->second;
+	}
+
+	return InvalidTexture;
+}
+
+void TextureCache::Complete(Entry& e)
+{
+	PROFILE_SCOPE("TextureCache::Complete");
+
+	e.Loading = false;
+
+	if(e.LoadStatus != DDSFile::Status::Ok)
+	{
+		e.File.Close();
+		e.Failed = e.RefCount > 0;
+		mStats.FailedLoads++;
+		return;
+	}
+
+	TextureId id = FindTexture(e);
+	if(id != InvalidTexture)
+	{
+		mStats.ContentHits++;
+	}
+	else
+	{
+		if(mFreeIds.empty())
+		{
+			id = (TextureId)mResidents.size();
+			mResidents.emplace_back();
+		}
+		else
+		{
+			id = mFreeIds.back();
+			mFreeIds.pop_back();
+		}
+
+		if(!mBackend.CreateTexture(id, e.File))
+		{
+			mFreeIds.push_back(id);
+			e.File.Close();
+			e.Failed = e.RefCount > 0;
+			mStats.FailedLoads++;
+			return;
+		}
+
+		Resident& r = mResidents[id];
+		r.Live = true;
+		r.Hash = e.Hash;
+		r.Bytes = e.File.DataSize();
+		r.Desc = e.File.GetDesc();
+		r.RefCount = 0;
+		r.ReleasedTick = ++mTick;
+		mTexturesByHash.emplace(r.Hash, id);
+
+		mStats.ResidentBytes += r.Bytes;
+		mStats.PeakResidentBytes = std::max(mStats.PeakResidentBytes, mStats.ResidentBytes);
+		mStats.ResidentTextures++;
+	}
+
+	e.File.Close();
+
+	// The Handles taken while loading now hold the texture as well.
+	e.Texture = id;
+	Resident& r = mResidents[id];
+	r.RefCount += e.RefCount;
+	if(r.RefCount == 0)
+		r.ReleasedTick = ++mTick;
+}
+
+void TextureCache::Evict(TextureId id)
+{
+	Resident& r = mResidents[id];
+	assert(r.Live && r.RefCount == 0);
+
+	mBackend.DestroyTexture(id);
+
+	auto range = mTexturesByHash.equal_range(r.Hash);
+	for(auto it = range.first; it != range.second; ++it)
+	{
+		if(it->second == id)
+		{
+			mTexturesByHash.erase(it);
+			break;
+		}
+	}
+
+	// Every path that resolved to it loads again when next acquired.
+	for(auto& e : mEntries)
+	{
+		if(e->Texture == id)
+			e->Texture = InvalidTexture;
+	}
+
+	mStats.ResidentBytes -= r.Bytes;
+	mStats.ResidentTextures--;
+	mStats.Evictions++;
+
+	r = Resident();
+	mFreeIds.push_back(id);
+}
+
+void TextureCache::TrimToBudget()
+{
+	while(mStats.ResidentBytes > mSettings.BudgetBytes)
+	{
+		TextureId victim = InvalidTexture;
+		for(TextureId id = 0; id < mResidents.size(); ++id)
+		{
+			const Resident& r = mResidents[id];
+			if(!r.Live || r.RefCount != 0)
+				continue;
+
+			if(victim == InvalidTexture || r.ReleasedTick < mResidents[victim].ReleasedTick)
+				victim = id;
+		}
+
+		// Whatever is left is in use.
+		if(victim == InvalidTexture)
+			break;
+
+		Evict(victim);
+	}
+}
+
+void TextureCache::Update()
+{
+	PROFILE_SCOPE("TextureCache::Update");
+
+	CompleteLoads();
+	TrimToBudget();
+}
+
+void TextureCache::WaitIdle()
+{
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mDone.wait(lock, [this] { return mLoadsInFlight == 0; });
+	}
+
+	CompleteLoads();
+	TrimToBudget();
+}
+
+TextureCache::TextureId TextureCache::GetTexture(const Handle& handle)const
+{
+	assert(handle.mCache == this);
+	return mEntries[handle.mEntry]->Texture;
+}
+
+bool TextureCache::IsReady(const Handle& handle)const
+{
+	return GetTexture(handle) != InvalidTexture;
+}
+
+bool TextureCache::IsFailed(const Handle& handle)const
+{
+	assert(handle.mCache == this);
+	return mEntries[handle.mEntry]->Failed;
+}
+
+const DDSFile::Desc& TextureCache::GetDesc(const Handle& handle)const
+{
+	TextureId id = GetTexture(handle);
+	assert(id != InvalidTexture);
+	return mResidents[id].Desc;
+}
@@ -0,0 +1,212 @@
+//***************************************************************************************
+// TextureCache.h by DanielDFY
+//
+// Loads each DDS texture once for the whole process instead of once per app,
+// material or scene that names it.  Textures are looked up by path and, once
+// loaded, by a hash of their contents, so two paths holding the same texture
+// share one GPU resource.
+//
+// Acquire returns a reference counted Handle right away and loads in the
+// background; requests for a file that is already loading wait for that load
+// instead of starting another.  A texture no Handle refers to anymore stays
+// resident, so acquiring it again is free, until the resident bytes exceed the
+// budget: then the least recently released ones are evicted first.  Textures
+// that are still referenced are never evicted.  A failed load is remembered
+// only while Handles to it remain; once the last one is released the next
+// Acquire of the path tries again, e.g. after the file has been cooked.
+//
+// Files are opened, hashed and faulted in by the I/O threads; the GPU side is a
+// Backend, called from Update (and WaitIdle) on the calling thread only.
+// Acquire, Update and Handles belong to that same thread, and every Handle must
+// be released before the cache is destroyed.  TextureCacheBackend.h is the
+// D3D12 Backend.
+//***************************************************************************************
+
+#pragma once
+
+#include "DDSFile.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class TextureCache
+{
+public:
+	// A distinct texture (content) on the GPU side.
+	typedef std::uint32_t TextureId;
+
+	static const TextureId InvalidTexture = ~0u;
+
+	class Backend
+	{
+	public:
+		virtual ~Backend() = default;
+
+		// Creates the GPU texture from file, which is only valid during the
+		// call.  Returning false fails every Handle of the texture.
+		virtual bool CreateTexture(TextureId id, const DDSFile& file) = 0;
+
+		// The texture was evicted; id may be reused by a later CreateTexture.
+		virtual void DestroyTexture(TextureId id) = 0;
+	};
+
+	struct Settings
+	{
+		// Resident bytes above which unreferenced textures are evicted.
+		std::uint64_t BudgetBytes = 256ull * 1024 * 1024;
+
+		// 0 loads on the calling thread inside Acquire; the texture is still
+		// created by the next Update.
+		std::uint32_t IoThreads = 2;
+	};
+
+	struct Stats
+	{
+		std::uint64_t Requests = 0;
+
+		// Requests for a path that was already resident (or had failed and is
+		// still held), and for one that was still loading, which share that
+		// load.
+		std::uint64_t PathHits = 0;
+		std::uint64_t Coalesced = 0;
+
+		// Requests that read the file, and those of them whose contents turned
+		// out to be resident under another path already.
+		std::uint64_t Misses = 0;
+		std::uint64_t ContentHits = 0;
+
+		std::uint64_t Evictions = 0;
+		std::uint64_t FailedLoads = 0;
+
+		// Bytes of the resident textures as laid out in their files.
+		std::uint64_t ResidentBytes = 0;
+		std::uint64_t PeakResidentBytes = 0;
+		std::uint32_t ResidentTextures = 0;
+
+		// Share of requests that did not create a GPU texture.
+		double HitRate()const;
+
+		std::string ToString()const;
+	};
+
+	class Handle
+	{
+	public:
+		Handle() = default;
+		Handle(const Handle& rhs);
+		Handle(Handle&& rhs);
+		Handle& operator=(const Handle& rhs);
+		Handle& operator=(Handle&& rhs);
+		~Handle();
+
+		bool IsValid()const { return mCache != nullptr; }
+
+		void Reset();
+
+	private:
+		friend class TextureCache;
+		Handle(TextureCache* cache, std::uint32_t entry);
+
+		TextureCache* mCache = nullptr;
+		std::uint32_t mEntry = 0;
+	};
+
+	TextureCache(Backend& backend);
+	TextureCache(Backend& backend, const Settings& settings);
+	TextureCache(const TextureCache& rhs) = delete;
+	TextureCache& operator=(const TextureCache& rhs) = delete;
+	~TextureCache();
+
+	// Paths are compared with '/' and '\' equal and ASCII case folded, as the
+	// Windows file system does.
+	Handle Acquire(const std::string& filename);
+
+	// Creates the textures whose loads finished and evicts while over budget.
+	// Call once per frame while the cache is in use.
+	void Update();
+
+	// Waits for every load issued so far and creates its texture.
+	void WaitIdle();
+
+	// InvalidTexture while loading or after failing.
+	TextureId GetTexture(const Handle& handle)const;
+	bool IsReady(const Handle& handle)const;
+	bool IsFailed(const Handle& handle)const;
+
+	// Valid once IsReady.
+	const DDSFile::Desc& GetDesc(const Handle& handle)const;
+
+	const Stats& GetStats()const { return mStats; }
+
+private:
+	// One per path.
+	struct Entry
+	{
+		std::string Filename;
+		TextureId Texture = InvalidTexture;
+		std::uint32_t RefCount = 0;
+		bool Loading = false;
+		bool Failed = false;
+
+		// Written by an I/O thread while Loading.
+		DDSFile File;
+		DDSFile::Status LoadStatus = DDSFile::Status::Ok;
+		std::uint64_t Hash = 0;
+	};
+
+	// One per distinct texture on the GPU side.
+	struct Resident
+	{
+		bool Live = false;
+		std::uint64_t Hash = 0;
+		std::uint64_t Bytes = 0;
+		DDSFile::Desc Desc;
+
+		// Handles over every path that resolved to this texture.
+		std::uint32_t RefCount = 0;
+		std::uint64_t ReleasedTick = 0;
+	};
+
+	void AddRef(std::uint32_t entry);
+	void Release(std::uint32_t entry);
+
+	void IoThreadMain();
+	void Load(Entry& e);
+	void Issue(Entry& e);
+	void CompleteLoads();
+	void Complete(Entry& e);
+	TextureId FindTexture(const Entry& e)const;
+	void Evict(TextureId id);
+	void TrimToBudget();
+
+	static std::string NormalizePath(const std::string& filename);
+
+private:
+	Backend& mBackend;
+	Settings mSettings;
+
+	std::vector<std::unique_ptr<Entry>> mEntries;
+	std::unordered_map<std::string, std::uint32_t> mEntriesByPath;
+
+	std::vector<Resident> mResidents;
+	std::vector<TextureId> mFreeIds;
+	std::unordered_multimap<std::uint64_t, TextureId> mTexturesByHash;
+	std::uint64_t mTick = 0;
+
+	std::vector<std::thread> mIoThreads;
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::condition_variable mDone;
+	std::deque<Entry*> mRequests;
+	std::vector<Entry*> mCompleted;
+	std::uint32_t mLoadsInFlight = 0;
+	bool mQuit = false;
+
+	Stats mStats;
+};
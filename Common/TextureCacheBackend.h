@@ -0,0 +1,128 @@
+//***************************************************************************************
+// TextureCacheBackend.h by DanielDFY
+//
+// The D3D12 side of TextureCache.  Each distinct texture becomes a committed
+// resource with every mip of the file, filled through the UploadManager and
+// left in D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE; views are up to the app.
+// An evicted texture is released once the frames that may still use it have
+// retired.
+//
+// Usage per frame:
+//   Retire(fence->GetCompletedValue())  after waiting for the frame resource
+//   TextureCache::Update                then UploadManager::Flush
+//   Resource(id)                        for the ready textures
+//   FinishFrame(fenceValue)             after signaling the frame's fence
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "TextureCache.h"
+#include "UploadManager.h"
+
+class TextureCacheBackend : public TextureCache::Backend
+{
+public:
+	TextureCacheBackend(ID3D12Device* device, UploadManager& uploads) :
+		mDevice(device),
+		mUploads(uploads)
+	{
+	}
+
+	TextureCacheBackend(const TextureCacheBackend& rhs) = delete;
+	TextureCacheBackend& operator=(const TextureCacheBackend& rhs) = delete;
+
+	bool CreateTexture(TextureCache::TextureId id, const DDSFile& file)override
+	{
+		const DDSFile::Desc& desc = file.GetDesc();
+
+		D3D12_RESOURCE_DESC texDesc = {};
+		texDesc.Dimension = (D3D12_RESOURCE_DIMENSION)desc.Dimension;
+		texDesc.Width = desc.Width;
+		texDesc.Height = desc.Height;
+		texDesc.DepthOrArraySize = (UINT16)(desc.Dimension == DDSFile::TextureDimension::Texture3D ?
+			desc.Depth : desc.ArraySize);
+		texDesc.MipLevels = (UINT16)desc.MipLevels;
+		texDesc.Format = desc.Format;
+		texDesc.SampleDesc.Count = 1;
+		texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+		HRESULT hr = mDevice->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+			D3D12_HEAP_FLAG_NONE,
+			&texDesc,
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(resource.GetAddressOf()));
+		if(FAILED(hr))
+			return false;
+
+		// DDSFile subresources are already in D3D12 order.
+		mInitData.clear();
+		for(const DDSFile::Subresource& s : file.Subresources())
+		{
+			D3D12_SUBRESOURCE_DATA data;
+			data.pData = s.Data;
+			data.RowPitch = (LONG_PTR)s.RowPitch;
+			data.SlicePitch = (LONG_PTR)s.SlicePitch;
+			mInitData.push_back(data);
+		}
+
+		mUploads.CopyToTexture(resource.Get(), 0, (UINT)mInitData.size(), mInitData.data(),
+			D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+		if(id >= mTextures.size())
+			mTextures.resize(id + 1);
+		mTextures[id] = resource;
+
+		return true;
+	}
+
+	void DestroyTexture(TextureCache::TextureId id)override
+	{
+		Retired r;
+		r.Resource = std::move(mTextures[id]);
+		mRetired.push_back(r);
+	}
+
+	ID3D12Resource* Resource(TextureCache::TextureId id)const
+	{
+		return id < mTextures.size() ? mTextures[id].Get() : nullptr;
+	}
+
+	void FinishFrame(UINT64 fenceValue)
+	{
+		for(auto& r : mRetired)
+		{
+			if(r.Fence == 0)
+				r.Fence = fenceValue;
+		}
+	}
+
+	void Retire(UINT64 completedFenceValue)
+	{
+		auto end = std::remove_if(mRetired.begin(), mRetired.end(), [&](const Retired& r)
+		{
+			return r.Fence != 0 && r.Fence <= completedFenceValue;
+		});
+		mRetired.erase(end, mRetired.end());
+	}
+
+private:
+	// Evicted textures, kept until the GPU passes the fence of the last frame
+	// that may have used them (0 until that frame is finished).
+	struct Retired
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		UINT64 Fence = 0;
+	};
+
+	ID3D12Device* mDevice = nullptr;
+	UploadManager& mUploads;
+
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> mTextures;
+	std::vector<Retired> mRetired;
+	std::vector<D3D12_SUBRESOURCE_DATA> mInitData;
+};
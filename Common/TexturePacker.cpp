@@ -0,0 +1,453 @@
+//***************************************************************************************
+// TexturePacker.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TexturePacker.h"
+#include "MipGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	// Marks a file written by TexturePacker in DDS_HEADER::reserved1[0], followed
+	// by the frame count, columns and rows.
+	const std::uint32_t LayoutTag = MAKEFOURCC('T', 'P', 'A', 'K');
+
+	const std::uint32_t MaxTexture2DSize = 16384;
+	const std::uint32_t MaxTexture2DArraySize = 2048;
+
+	// D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+	// and D3D12_TEXTURE_DATA_PITCH_ALIGNMENT.
+	const std::uint64_t ResourceAlignment = 65536;
+	const std::uint64_t UploadPlacementAlignment = 512;
+	const std::uint64_t UploadPitchAlignment = 256;
+
+	std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// Texels per side of the format's blocks: 4 for BC formats, 1 for the
+	// others, 0 for the packed and sub-byte formats no grid can split.
+	std::uint32_t BlockSize(DXGI_FORMAT format)
+	{
+		size_t numBytes = 0;
+		size_t rowBytes = 0;
+		size_t numRows = 0;
+		DDSGetSurfaceInfo(4, 4, format, &numBytes, &rowBytes, &numRows);
+		if(numRows == 1)
+			return 4;
+
+		size_t rowBytes1 = 0;
+		size_t rowBytes2 = 0;
+		DDSGetSurfaceInfo(1, 1, format, &numBytes, &rowBytes1, &numRows);
+		DDSGetSurfaceInfo(2, 1, format, &numBytes, &rowBytes2, &numRows);
+
+		return rowBytes1 != 0 && rowBytes2 == 2 * rowBytes1 ? 1 : 0;
+	}
+
+	// One mip of one frame: a subresource of its file, or a mip the packer
+	// derived because the file stops short of the packed chain.
+	struct FrameMip
+	{
+		const std::uint8_t* Data = nullptr;
+		std::uint32_t Width = 0;
+		std::uint32_t Height = 0;
+		std::uint64_t RowPitch = 0;
+		std::uint64_t SlicePitch = 0;
+		std::uint32_t RowCount = 0;
+	};
+
+	// Default heap and upload buffer bytes of a texture loaded the way
+	// CreateDDSTextureFromFile12 loads it: one committed texture and one
+	// committed upload buffer laid out by GetCopyableFootprints.
+	void EstimateFootprint(DXGI_FORMAT format, std::uint32_t width, std::uint32_t height,
+		std::uint32_t mipLevels, std::uint32_t arraySize,
+		std::uint64_t* resourceBytes, std::uint64_t* uploadBytes)
+	{
+		std::uint64_t data = 0;
+		std::uint64_t upload = 0;
+		for(std::uint32_t slice = 0; slice < arraySize; ++slice)
+		{
+			std::uint32_t w = width;
+			std::uint32_t h = height;
+			for(std::uint32_t mip = 0; mip < mipLevels; ++mip)
+			{
+				size_t numBytes = 0;
+				size_t rowBytes = 0;
+				size_t numRows = 0;
+				DDSGetSurfaceInfo(w, h, format, &numBytes, &rowBytes, &numRows);
+
+				data += numBytes;
+				upload = AlignUp(upload, UploadPlacementAlignment) +
+					AlignUp(rowBytes, UploadPitchAlignment) * (numRows - 1) + rowBytes;
+
+				w = w > 1 ? w / 2 : 1;
+				h = h > 1 ? h / 2 : 1;
+			}
+		}
+
+		*resourceBytes = AlignUp(data, ResourceAlignment);
+		*uploadBytes = AlignUp(upload, ResourceAlignment);
+	}
+}
+
+std::string TexturePacker::Report::ToString()const
+{
+	std::ostringstream outs;
+	outs << Frames << " frames as ";
+	if(PackedLayout.IsAtlas())
+		outs << "a " << PackedLayout.Columns << "x" << PackedLayout.Rows << " atlas";
+	else
+		outs << "an array";
+	outs << ": files " << SourceFileBytes / 1024 << " -> " << PackedFileBytes / 1024 <<
+		" KB, textures " << SourceResourceBytes / 1024 << " KB in " << Frames << " -> " <<
+		PackedResourceBytes / 1024 << " KB in 1, upload " << SourceUploadBytes / 1024 << " KB in " <<
+		Frames << " -> " << PackedUploadBytes / 1024 << " KB in 1";
+	if(DerivedMips != 0)
+		outs << ", " << DerivedMips << " mips derived";
+	if(DroppedMips != 0)
+		outs << ", " << DroppedMips << " mips dropped";
+	outs << ", packed in " << PackMilliseconds << " ms";
+	return outs.str();
+}
+
+TexturePacker::Status TexturePacker::PackArray(const std::vector<std::string>& inputs,
+	const std::string& output, Report* report)
+{
+	return Pack(inputs, output, 0, false, report);
+}
+
+TexturePacker::Status TexturePacker::PackAtlas(const std::vector<std::string>& inputs,
+	const std::string& output, std::uint32_t columns, Report* report)
+{
+	return Pack(inputs, output, columns, true, report);
+}
+
+TexturePacker::Status TexturePacker::Pack(const std::vector<std::string>& inputs,
+	const std::string& output, std::uint32_t columns, bool atlas, Report* report)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	Report r;
+	r.Frames = (std::uint32_t)inputs.size();
+
+	auto finish = [&](Status status, const std::string& filename)
+	{
+		r.Filename = filename;
+		r.PackMilliseconds = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+		if(report != nullptr)
+			*report = r;
+		return status;
+	};
+
+	if(inputs.empty() || (!atlas && inputs.size() > MaxTexture2DArraySize))
+		return finish(Status::NotSupported, output);
+
+	// Every frame stays mapped until the file is written; an atlas reads
+	// a row of each frame in turn.
+	std::vector<DDSFile> files(inputs.size());
+	for(size_t i = 0; i < inputs.size(); ++i)
+	{
+		if(files[i].Open(inputs[i]) != DDSFile::Status::Ok)
+			return finish(Status::OpenFailed, inputs[i]);
+
+		const DDSFile::Desc& d = files[i].GetDesc();
+		if(d.Dimension != DDSFile::TextureDimension::Texture2D || d.ArraySize != 1)
+			return finish(Status::NotSupported, inputs[i]);
+
+		const DDSFile::Desc& first = files[0].GetDesc();
+		if(d.Format != first.Format || d.Width != first.Width || d.Height != first.Height)
+			return finish(Status::Mismatch, inputs[i]);
+
+		std::uint64_t resourceBytes = 0;
+		std::uint64_t uploadBytes = 0;
+		EstimateFootprint(d.Format, d.Width, d.Height, d.MipLevels, 1, &resourceBytes, &uploadBytes);
+
+		r.SourceFileBytes += files[i].Size();
+		r.SourceResourceBytes += resourceBytes;
+		r.SourceUploadBytes += uploadBytes;
+	}
+
+	const DDSFile::Desc& desc = files[0].GetDesc();
+
+	// Every slice of an array has the same mips.  Frames with a shorter chain
+	// than the longest get the rest derived if the format can be filtered;
+	// otherwise the shortest chain decides for all of them.
+	std::uint32_t shortestMipLevels = desc.MipLevels;
+	std::uint32_t longestMipLevels = desc.MipLevels;
+	for(const DDSFile& f : files)
+	{
+		std::uint32_t fileMipLevels = f.GetDesc().MipLevels;
+		shortestMipLevels = fileMipLevels < shortestMipLevels ? fileMipLevels : shortestMipLevels;
+		longestMipLevels = fileMipLevels > longestMipLevels ? fileMipLevels : longestMipLevels;
+	}
+
+	std::uint32_t sourceMipLevels = MipGenerator::IsSupported(desc.Format) ? longestMipLevels : shortestMipLevels;
+
+	std::uint32_t width = desc.Width;
+	std::uint32_t height = desc.Height;
+	std::uint32_t mipLevels = sourceMipLevels;
+	std::uint32_t arraySize = r.Frames;
+
+	r.PackedLayout.Frames = r.Frames;
+
+	if(atlas)
+	{
+		std::uint32_t blockSize = BlockSize(desc.Format);
+		if(blockSize == 0)
+			return finish(Status::NotSupported, inputs[0]);
+
+		if(columns == 0)
+			columns = (std::uint32_t)std::ceil(std::sqrt((double)r.Frames * desc.Height / desc.Width));
+		columns = columns < r.Frames ? columns : r.Frames;
+		columns = columns > 0 ? columns : 1;
+
+		std::uint32_t rows = (r.Frames + columns - 1) / columns;
+		if((std::uint64_t)columns * desc.Width > MaxTexture2DSize ||
+			(std::uint64_t)rows * desc.Height > MaxTexture2DSize)
+		{
+			return finish(Status::NotSupported, output);
+		}
+
+		// Keep the mips in which every frame is still a whole number of blocks
+		// at a whole block offset; below that a frame's mip no longer lines up
+		// with the atlas mip.
+		mipLevels = 0;
+		while(mipLevels < sourceMipLevels)
+		{
+			std::uint32_t w = desc.Width >> mipLevels;
+			std::uint32_t h = desc.Height >> mipLevels;
+			if(w == 0 || h == 0 || (w << mipLevels) != desc.Width || (h << mipLevels) != desc.Height ||
+				w % blockSize != 0 || h % blockSize != 0)
+			{
+				break;
+			}
+			++mipLevels;
+		}
+
+		if(mipLevels == 0)
+			return finish(Status::NotSupported, inputs[0]);
+
+		width = columns * desc.Width;
+		height = rows * desc.Height;
+		arraySize = 1;
+
+		r.PackedLayout.Columns = columns;
+		r.PackedLayout.Rows = rows;
+	}
+
+	// Owns the derived mips; moving an image keeps its data in place.
+	std::vector<MipGenerator::Image> derived;
+
+	std::vector<std::vector<FrameMip>> frames(files.size());
+	for(size_t i = 0; i < files.size(); ++i)
+	{
+		std::uint32_t fileMipLevels = files[i].GetDesc().MipLevels;
+		if(fileMipLevels > mipLevels && fileMipLevels - mipLevels > r.DroppedMips)
+			r.DroppedMips = fileMipLevels - mipLevels;
+
+		frames[i].resize(mipLevels);
+		for(std::uint32_t mip = 0; mip < mipLevels; ++mip)
+		{
+			FrameMip& m = frames[i][mip];
+			if(mip < fileMipLevels)
+			{
+				const DDSFile::Subresource& s = files[i].GetSubresource(mip, 0);
+				m.Data = s.Data;
+				m.Width = s.Width;
+				m.Height = s.Height;
+				m.RowPitch = s.RowPitch;
+				m.SlicePitch = s.SlicePitch;
+				m.RowCount = s.RowCount;
+				continue;
+			}
+
+			// The rest of the chain, box filtered from the file's last mip.
+			if(mip == fileMipLevels)
+			{
+				const FrameMip& last = frames[i][mip - 1];
+
+				MipGenerator::Settings settings;
+				settings.MipFilter = MipGenerator::Filter::Box;
+				settings.MipLevels = mipLevels - fileMipLevels + 1;
+
+				derived.emplace_back();
+				MipGenerator::Generate(desc.Format, last.Width, last.Height, last.Data, last.RowPitch,
+					settings, &derived.back());
+			}
+
+			const DDSFile::Subresource& s = derived.back().GetSubresource(mip - fileMipLevels + 1, 0);
+			m.Data = s.Data;
+			m.Width = s.Width;
+			m.Height = s.Height;
+			m.RowPitch = s.RowPitch;
+			m.SlicePitch = s.SlicePitch;
+			m.RowCount = s.RowCount;
+
+			++r.DerivedMips;
+		}
+	}
+
+	EstimateFootprint(desc.Format, width, height, mipLevels, arraySize,
+		&r.PackedResourceBytes, &r.PackedUploadBytes);
+
+	std::ofstream out(output, std::ios::binary | std::ios::trunc);
+	if(!out)
+		return finish(Status::WriteFailed, output);
+
+	DDSFile::Desc packed = desc;
+	packed.Width = width;
+	packed.Height = height;
+	packed.MipLevels = mipLevels;
+	packed.ArraySize = arraySize;
+
+	std::uint32_t reserved1[11] = { LayoutTag, r.PackedLayout.Frames, r.PackedLayout.Columns, r.PackedLayout.Rows };
+
+	bool written = DDSFile::WriteHeader(out, packed, reserved1);
+
+	if(!atlas)
+	{
+		// Slice after slice, each with its full mip chain, as DDSFile and the
+		// loaders expect.
+		for(size_t i = 0; i < files.size() && written; ++i)
+		{
+			for(const FrameMip& m : frames[i])
+				out.write((const char*)m.Data, (std::streamsize)m.SlicePitch);
+
+			written = out.good();
+		}
+	}
+	else
+	{
+		std::uint32_t columnCount = r.PackedLayout.Columns;
+		std::uint32_t rowCount = r.PackedLayout.Rows;
+
+		std::vector<std::uint8_t> row;
+		for(std::uint32_t mip = 0; mip < mipLevels && written; ++mip)
+		{
+			const FrameMip& frame = frames[0][mip];
+
+			// One row of blocks across the atlas; cells without a frame stay 0.
+			row.assign((size_t)(frame.RowPitch * columnCount), 0);
+
+			for(std::uint32_t gridRow = 0; gridRow < rowCount && written; ++gridRow)
+			{
+				for(std::uint32_t y = 0; y < frame.RowCount; ++y)
+				{
+					for(std::uint32_t column = 0; column < columnCount; ++column)
+					{
+						std::uint32_t index = gridRow * columnCount + column;
+						if(index >= frames.size())
+						{
+							// The row still holds the grid row above.
+							std::fill(row.begin() + (size_t)(column * frame.RowPitch), row.end(), (std::uint8_t)0);
+							break;
+						}
+
+						const FrameMip& m = frames[index][mip];
+						std::copy(m.Data + y * m.RowPitch, m.Data + (y + 1) * m.RowPitch,
+							row.begin() + (size_t)(column * m.RowPitch));
+					}
+
+					out.write((const char*)row.data(), (std::streamsize)row.size());
+				}
+
+				written = out.good();
+			}
+		}
+	}
+
+	if(written)
+	{
+		r.PackedFileBytes = (std::uint64_t)out.tellp();
+		out.close();
+		written = !out.fail();
+	}
+
+	if(!written)
+	{
+		out.close();
+		std::remove(output.c_str());
+		return finish(Status::WriteFailed, output);
+	}
+
+	return finish(Status::Ok, output);
+}
+
+bool TexturePacker::ReadLayout(const DDSFile& file, Layout* layout)
+{
+	const DDS_HEADER* header = file.Header();
+	if(header == nullptr || header->reserved1[0] != LayoutTag)
+		return false;
+
+	Layout l;
+	l.Frames = header->reserved1[1];
+	l.Columns = header->reserved1[2];
+	l.Rows = header->reserved1[3];
+
+	const DDSFile::Desc& desc = file.GetDesc();
+	if(desc.Dimension != DDSFile::TextureDimension::Texture2D || desc.IsCubeMap || l.Frames == 0)
+		return false;
+
+	if(l.IsAtlas())
+	{
+		if(desc.ArraySize != 1 || (std::uint64_t)l.Columns * l.Rows < l.Frames)
+			return false;
+	}
+	else if(desc.ArraySize != l.Frames || l.Rows != 0)
+	{
+		return false;
+	}
+
+	*layout = l;
+	return true;
+}
+
+bool TexturePacker::IsPacked(const std::string& filename, std::uint32_t frames)
+{
+	DDSFile file;
+	if(file.Open(filename) != DDSFile::Status::Ok)
+		return false;
+
+	Layout layout;
+	return ReadLayout(file, &layout) && layout.Frames == frames;
+}
+
+std::vector<TexturePacker::AtlasTransform> TexturePacker::GetAtlasTransforms(const Layout& layout)
+{
+	std::vector<AtlasTransform> transforms;
+	if(!layout.IsAtlas())
+		return transforms;
+
+	transforms.resize(layout.Frames);
+	for(std::uint32_t i = 0; i < layout.Frames; ++i)
+	{
+		AtlasTransform& t = transforms[i];
+		t.ScaleU = 1.0f / layout.Columns;
+		t.ScaleV = 1.0f / layout.Rows;
+		t.OffsetU = (float)(i % layout.Columns) / layout.Columns;
+		t.OffsetV = (float)(i / layout.Columns) / layout.Rows;
+	}
+
+	return transforms;
+}
+
+const char* TexturePacker::StatusToString(Status status)
+{
+	switch(status)
+	{
+	case Status::Ok:           return "Ok";
+	case Status::OpenFailed:   return "OpenFailed";
+	case Status::Mismatch:     return "Mismatch";
+	case Status::NotSupported: return "NotSupported";
+	case Status::WriteFailed:  return "WriteFailed";
+	}
+
+	return "Unknown";
+}
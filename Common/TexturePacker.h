@@ -0,0 +1,120 @@
+//***************************************************************************************
+// TexturePacker.h by DanielDFY
+//
+// Packs a sequence of same-format 2D DDS textures, such as the frames of a
+// flipbook animation, into one DDS file, so the whole sequence is one file
+// open, one resource, one upload and one descriptor instead of one of each
+// per frame.
+//
+//   PackArray : a Texture2DArray with one slice per frame.  Frames keep their
+//               full mip chain and never bleed into each other; sample it with
+//               a Texture2DArray and the frame index as the third coordinate.
+//   PackAtlas : a single Texture2D with the frames on a grid, for shaders or
+//               hardware that need a plain Texture2D.  Remap the UVs with the
+//               table from GetAtlasTransforms.  Only the mips in which every
+//               frame still starts on a whole texel (or block) are kept, and
+//               bilinear filtering near a frame's edge reads its neighbors.
+//
+// The frames must share format and size, but not their mips: a frame saved
+// with a shorter chain gets the missing mips box filtered from its last one
+// by MipGenerator if the format has four 8 bit channels.  For other formats
+// the packed chain is as long as the shortest input chain; the Report says
+// how many mips were derived or dropped.
+//
+// Both write the layout into the reserved words of the DDS header, which the
+// loaders ignore, so the packed file describes itself: ReadLayout recovers it.
+//
+// Packing is meant to run at cook time; IsPacked lets an app cook on first run
+// and load the packed file afterwards.
+//***************************************************************************************
+
+#pragma once
+
+#include "DDSFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TexturePacker
+{
+public:
+	enum class Status
+	{
+		Ok,
+		OpenFailed,    // an input could not be opened or parsed
+		Mismatch,      // an input differs in format or size from the first one
+		NotSupported,  // not a single 2D texture, or a format/size the layout cannot hold
+		WriteFailed
+	};
+
+	struct Layout
+	{
+		std::uint32_t Frames = 0;
+
+		// 0 for an array; otherwise the atlas grid, filled row by row.
+		std::uint32_t Columns = 0;
+		std::uint32_t Rows = 0;
+
+		bool IsAtlas()const { return Columns != 0; }
+	};
+
+	// uv' = uv * Scale + Offset maps a frame's [0,1] UVs into the atlas.
+	struct AtlasTransform
+	{
+		float ScaleU = 1.0f;
+		float ScaleV = 1.0f;
+		float OffsetU = 0.0f;
+		float OffsetV = 0.0f;
+	};
+
+	// What packing saves.  Resource and upload sizes follow the D3D12
+	// placement rules (64KB resources, 512 byte subresource offsets and 256
+	// byte row pitches in upload buffers), so they are estimates of what the
+	// driver allocates rather than exact figures.
+	struct Report
+	{
+		std::uint32_t Frames = 0;
+		Layout PackedLayout;
+
+		std::uint64_t SourceFileBytes = 0;
+		std::uint64_t PackedFileBytes = 0;
+		std::uint64_t SourceResourceBytes = 0;
+		std::uint64_t PackedResourceBytes = 0;
+		std::uint64_t SourceUploadBytes = 0;
+		std::uint64_t PackedUploadBytes = 0;
+
+		// Mips derived over all frames, and the most mips any frame lost to
+		// the frame with the fewest mips or to the atlas grid.
+		std::uint32_t DerivedMips = 0;
+		std::uint32_t DroppedMips = 0;
+
+		double PackMilliseconds = 0.0;
+
+		// The input or output the returned Status refers to.
+		std::string Filename;
+
+		std::string ToString()const;
+	};
+
+	static Status PackArray(const std::vector<std::string>& inputs, const std::string& output,
+		Report* report = nullptr);
+
+	// columns == 0 picks the grid closest to square.
+	static Status PackAtlas(const std::vector<std::string>& inputs, const std::string& output,
+		std::uint32_t columns = 0, Report* report = nullptr);
+
+	// False if the file was not written by TexturePacker.
+	static bool ReadLayout(const DDSFile& file, Layout* layout);
+
+	// True if filename is a packed file of the given number of frames.
+	static bool IsPacked(const std::string& filename, std::uint32_t frames);
+
+	// One transform per frame; empty for an array.
+	static std::vector<AtlasTransform> GetAtlasTransforms(const Layout& layout);
+
+	static const char* StatusToString(Status status);
+
+private:
+	static Status Pack(const std::vector<std::string>& inputs, const std::string& output,
+		std::uint32_t columns, bool atlas, Report* report);
+};
@@ -0,0 +1,268 @@
+//***************************************************************************************
+// TextureStreamBackend.h by DanielDFY
+//
+// The D3D12 side of TextureStreamer.  Every residency change creates a texture
+// with just the resident mips, fills it from the mapped DDS file through the
+// UploadManager and gives it a new SRV in a DescriptorHeap; the old texture and
+// SRV are released once the frames that may still use them have retired.
+// Until its mip tail arrives a texture has a null SRV of the file's dimension,
+// which samples as zero.
+//
+// Usage per frame:
+//   Retire(fence->GetCompletedValue())  after waiting for the frame resource
+//   TextureStreamer::Update             then UploadManager::Flush
+//   Srv(id)                             while building the frame
+//   FinishFrame(fenceValue)             after signaling the frame's fence
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "DescriptorHeap.h"
+#include "TextureStreamer.h"
+#include "UploadManager.h"
+
+class TextureStreamBackend : public TextureStreamer::Backend
+{
+public:
+	TextureStreamBackend(ID3D12Device* device, UploadManager& uploads, DescriptorHeap& srvHeap) :
+		mDevice(device),
+		mUploads(uploads),
+		mSrvHeap(srvHeap)
+	{
+		// A null SRV must still match the dimension the shader declares, so
+		// there is one per view dimension a DDS file can need.
+		const D3D12_SRV_DIMENSION dimensions[] =
+		{
+			D3D12_SRV_DIMENSION_TEXTURE2D,
+			D3D12_SRV_DIMENSION_TEXTURE2DARRAY,
+			D3D12_SRV_DIMENSION_TEXTURECUBE,
+			D3D12_SRV_DIMENSION_TEXTURECUBEARRAY,
+		};
+		mNullSrvs = mSrvHeap.Allocate(_countof(dimensions));
+
+		for(D3D12_SRV_DIMENSION dimension : dimensions)
+		{
+			D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+			srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+			srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			srvDesc.ViewDimension = dimension;
+			switch(srvDesc.ViewDimension)
+			{
+			case D3D12_SRV_DIMENSION_TEXTURE2D:
+				srvDesc.Texture2D.MipLevels = 1;
+				break;
+			case D3D12_SRV_DIMENSION_TEXTURE2DARRAY:
+				srvDesc.Texture2DArray.MipLevels = 1;
+				srvDesc.Texture2DArray.ArraySize = 1;
+				break;
+			case D3D12_SRV_DIMENSION_TEXTURECUBE:
+				srvDesc.TextureCube.MipLevels = 1;
+				break;
+			case D3D12_SRV_DIMENSION_TEXTURECUBEARRAY:
+				srvDesc.TextureCubeArray.MipLevels = 1;
+				srvDesc.TextureCubeArray.NumCubes = 1;
+				break;
+			}
+			mDevice->CreateShaderResourceView(nullptr, &srvDesc, mNullSrvs.Cpu(NullSrvIndex(dimension)));
+		}
+	}
+
+	TextureStreamBackend(const TextureStreamBackend& rhs) = delete;
+	TextureStreamBackend& operator=(const TextureStreamBackend& rhs) = delete;
+
+	~TextureStreamBackend()
+	{
+		// The owner waits for the GPU before destroying the backend.
+		for(auto& t : mTextures)
+		{
+			if(t.Resource != nullptr)
+				mSrvHeap.Free(t.Srv);
+		}
+		for(auto& r : mRetired)
+			mSrvHeap.Free(r.Srv);
+		mSrvHeap.Free(mNullSrvs);
+	}
+
+	void RegisterTexture(TextureStreamer::TextureId id, const DDSFile::Desc& desc)override
+	{
+		if(id >= mTextures.size())
+			mTextures.resize(id + 1);
+
+		mTextures[id].ViewDimension = ViewDimension(desc);
+	}
+
+	bool SetResidentMips(TextureStreamer::TextureId id, const DDSFile& file, std::uint32_t firstMip)override
+	{
+		const DDSFile::Desc& desc = file.GetDesc();
+		if(desc.Dimension != DDSFile::TextureDimension::Texture2D)
+			return false;
+
+		UINT mipLevels = desc.MipLevels - firstMip;
+		const DDSFile::Subresource& top = file.GetSubresource(firstMip, 0);
+
+		D3D12_RESOURCE_DESC texDesc = CD3DX12_RESOURCE_DESC::Tex2D(
+			desc.Format, top.Width, top.Height, (UINT16)desc.ArraySize, (UINT16)mipLevels);
+
+		Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+		HRESULT hr = mDevice->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+			D3D12_HEAP_FLAG_NONE,
+			&texDesc,
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(resource.GetAddressOf()));
+		if(FAILED(hr))
+			return false;
+
+		// Subresource i + slice * mipLevels of the new texture is mip
+		// firstMip + i of the file.
+		mInitData.clear();
+		for(std::uint32_t slice = 0; slice < desc.ArraySize; ++slice)
+		{
+			for(std::uint32_t mip = firstMip; mip < desc.MipLevels; ++mip)
+			{
+				const DDSFile::Subresource& s = file.GetSubresource(mip, slice);
+
+				D3D12_SUBRESOURCE_DATA data;
+				data.pData = s.Data;
+				data.RowPitch = (LONG_PTR)s.RowPitch;
+				data.SlicePitch = (LONG_PTR)s.SlicePitch;
+				mInitData.push_back(data);
+			}
+		}
+
+		mUploads.CopyToTexture(resource.Get(), 0, (UINT)mInitData.size(), mInitData.data(),
+			D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+		DescriptorRange srv = mSrvHeap.Allocate(1);
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Format = desc.Format;
+		srvDesc.ViewDimension = ViewDimension(desc);
+		switch(srvDesc.ViewDimension)
+		{
+		case D3D12_SRV_DIMENSION_TEXTURECUBEARRAY:
+			srvDesc.TextureCubeArray.MipLevels = mipLevels;
+			srvDesc.TextureCubeArray.NumCubes = desc.ArraySize / 6;
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURECUBE:
+			srvDesc.TextureCube.MipLevels = mipLevels;
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURE2DARRAY:
+			srvDesc.Texture2DArray.MipLevels = mipLevels;
+			srvDesc.Texture2DArray.ArraySize = desc.ArraySize;
+			break;
+		default:
+			srvDesc.Texture2D.MipLevels = mipLevels;
+			break;
+		}
+		mDevice->CreateShaderResourceView(resource.Get(), &srvDesc, srv.Cpu());
+
+		if(id >= mTextures.size())
+			mTextures.resize(id + 1);
+
+		Texture& t = mTextures[id];
+		if(t.Resource != nullptr)
+		{
+			Retired r;
+			r.Resource = t.Resource;
+			r.Srv = t.Srv;
+			mRetired.push_back(r);
+		}
+
+		t.Resource = resource;
+		t.Srv = srv;
+		t.ViewDimension = srvDesc.ViewDimension;
+
+		return true;
+	}
+
+	CD3DX12_GPU_DESCRIPTOR_HANDLE Srv(TextureStreamer::TextureId id)const
+	{
+		if(id >= mTextures.size())
+			return mNullSrvs.Gpu(NullSrvIndex(D3D12_SRV_DIMENSION_TEXTURE2D));
+
+		const Texture& t = mTextures[id];
+		if(t.Resource != nullptr)
+			return t.Srv.Gpu();
+
+		return mNullSrvs.Gpu(NullSrvIndex(t.ViewDimension));
+	}
+
+	ID3D12Resource* Resource(TextureStreamer::TextureId id)const
+	{
+		return id < mTextures.size() ? mTextures[id].Resource.Get() : nullptr;
+	}
+
+	void FinishFrame(UINT64 fenceValue)
+	{
+		for(auto& r : mRetired)
+		{
+			if(r.Fence == 0)
+				r.Fence = fenceValue;
+		}
+	}
+
+	void Retire(UINT64 completedFenceValue)
+	{
+		auto end = std::remove_if(mRetired.begin(), mRetired.end(), [&](const Retired& r)
+		{
+			if(r.Fence == 0 || r.Fence > completedFenceValue)
+				return false;
+
+			mSrvHeap.Free(r.Srv);
+			return true;
+		});
+		mRetired.erase(end, mRetired.end());
+	}
+
+private:
+	static UINT NullSrvIndex(D3D12_SRV_DIMENSION dimension)
+	{
+		switch(dimension)
+		{
+		case D3D12_SRV_DIMENSION_TEXTURE2DARRAY: return 1;
+		case D3D12_SRV_DIMENSION_TEXTURECUBE: return 2;
+		case D3D12_SRV_DIMENSION_TEXTURECUBEARRAY: return 3;
+		default: return 0;
+		}
+	}
+
+	static D3D12_SRV_DIMENSION ViewDimension(const DDSFile::Desc& desc)
+	{
+		if(desc.IsCubeMap && desc.ArraySize > 6)
+			return D3D12_SRV_DIMENSION_TEXTURECUBEARRAY;
+		if(desc.IsCubeMap)
+			return D3D12_SRV_DIMENSION_TEXTURECUBE;
+		if(desc.ArraySize > 1)
+			return D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		return D3D12_SRV_DIMENSION_TEXTURE2D;
+	}
+
+	struct Texture
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		DescriptorRange Srv;
+		D3D12_SRV_DIMENSION ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	};
+
+	// Replaced textures, kept until the GPU passes the fence of the last frame
+	// that may have used them (0 until that frame is finished).
+	struct Retired
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		DescriptorRange Srv;
+		UINT64 Fence = 0;
+	};
+
+	ID3D12Device* mDevice = nullptr;
+	UploadManager& mUploads;
+	DescriptorHeap& mSrvHeap;
+
+	DescriptorRange mNullSrvs;
+	std::vector<Texture> mTextures;
+	std::vector<Retired> mRetired;
+	std::vector<D3D12_SUBRESOURCE_DATA> mInitData;
+};
@@ -0,0 +1,426 @@
+//***************************************************************************************
+// TextureStreamer.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TextureStreamer.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+const TextureStreamer::TextureId TextureStreamer::InvalidTexture;
+const std::uint32_t TextureStreamer::NotResident;
+
+TextureStreamer::TextureStreamer(Backend& backend) :
+	TextureStreamer(backend, Settings())
+{
+}
+
+TextureStreamer::TextureStreamer(Backend& backend, const Settings& settings) :
+	mBackend(backend),
+	mSettings(settings)
+{
+	assert(mSettings.MaxPendingLoads > 0);
+
+	for(std::uint32_t i = 0; i < mSettings.IoThreads; ++i)
+		mIoThreads.emplace_back(&TextureStreamer::IoThreadMain, this);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+	mWake.notify_all();
+
+	for(std::thread& t : mIoThreads)
+		t.join();
+}
+
+TextureStreamer::TextureId TextureStreamer::Register(const std::string& filename)
+{
+	auto t = std::make_unique<Texture>();
+	t->Filename = filename;
+	t->LastUsedFrame = mFrame;
+
+	// Mapping the file and parsing the header touch only its first page; the
+	// mips are read by the I/O threads.
+	if(t->File.Open(filename) == DDSFile::Status::Ok)
+	{
+		const DDSFile::Desc& desc = t->File.GetDesc();
+		t->MipLevels = desc.MipLevels;
+
+		t->TailMip = t->MipLevels - 1;
+		for(std::uint32_t m = 0; m < t->MipLevels; ++m)
+		{
+			const DDSFile::Subresource& s = t->File.GetSubresource(m, 0);
+			if(std::max(s.Width, s.Height) <= mSettings.MipTailSize)
+			{
+				t->TailMip = m;
+				break;
+			}
+		}
+
+		t->BytesFrom.assign(t->MipLevels + 1, 0);
+		for(std::uint32_t m = t->MipLevels; m-- > 0;)
+		{
+			std::uint64_t bytes = 0;
+			for(std::uint32_t slice = 0; slice < desc.ArraySize; ++slice)
+			{
+				const DDSFile::Subresource& s = t->File.GetSubresource(m, slice);
+				bytes += s.SlicePitch * s.Depth;
+			}
+			t->BytesFrom[m] = t->BytesFrom[m + 1] + bytes;
+		}
+	}
+	else
+	{
+		t->Failed = true;
+		mStats.FailedTextures++;
+	}
+
+	TextureId id;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mTextures.push_back(std::move(t));
+		id = (TextureId)mTextures.size() - 1;
+	}
+	mStats.Textures = id + 1;
+
+	if(!mTextures[id]->Failed)
+		mBackend.RegisterTexture(id, mTextures[id]->File.GetDesc());
+
+	return id;
+}
+
+void TextureStreamer::ReportUsage(TextureId id, float screenPixels)
+{
+	assert(id < mTextures.size());
+	Texture& t = *mTextures[id];
+
+	if(t.LastUsedFrame != mFrame || !t.Used)
+		t.ScreenPixels = screenPixels;
+	else
+		t.ScreenPixels = std::max(t.ScreenPixels, screenPixels);
+
+	t.LastUsedFrame = mFrame;
+	t.Used = true;
+}
+
+void TextureStreamer::IoThreadMain()
+{
+	Profiler::Get().SetThreadName("Texture I/O");
+
+	for(;;)
+	{
+		LoadRequest request;
+		const Texture* texture;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWake.wait(lock, [this] { return mQuit || !mRequests.empty(); });
+			if(mQuit)
+				return;
+
+			request = mRequests.front();
+			mRequests.pop_front();
+
+			// Register may be growing the vector on the main thread.
+			texture = mTextures[request.Id].get();
+		}
+
+		Load(*texture, request);
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mCompleted.push_back(request);
+			mLoadsInFlight--;
+		}
+		mDone.notify_all();
+	}
+}
+
+void TextureStreamer::Load(const Texture& t, const LoadRequest& request)
+{
+	PROFILE_SCOPE("TextureStreamer::Load");
+
+	std::uint32_t firstMip = request.FirstMip;
+	std::uint32_t endMip = request.EndMip;
+
+	// Fault the pages in here, so the upload on the main thread copies from
+	// memory instead of waiting for the disk.
+	const std::uint32_t pageSize = 4096;
+	std::uint32_t sum = 0;
+	for(std::uint32_t slice = 0; slice < t.File.GetDesc().ArraySize; ++slice)
+	{
+		for(std::uint32_t m = firstMip; m < endMip; ++m)
+		{
+			const DDSFile::Subresource& s = t.File.GetSubresource(m, slice);
+			std::uint64_t bytes = s.SlicePitch * s.Depth;
+			for(std::uint64_t offset = 0; offset < bytes; offset += pageSize)
+				sum += s.Data[offset];
+			sum += s.Data[bytes - 1];
+		}
+	}
+
+	volatile std::uint32_t sink = sum;
+	(void)sink;
+}
+
+void TextureStreamer::Issue(TextureId id, std::uint32_t firstMip, std::uint32_t endMip, std::uint64_t bytes)
+{
+	Texture& t = *mTextures[id];
+	assert(!t.Loading);
+
+	t.Loading = true;
+	t.LoadMip = firstMip;
+	t.LoadBytes = bytes;
+	mStats.PendingBytes += bytes;
+	mStats.PendingLoads++;
+
+	LoadRequest request;
+	request.Id = id;
+	request.FirstMip = firstMip;
+	request.EndMip = endMip;
+
+	if(mIoThreads.empty())
+	{
+		Load(t, request);
+		mCompleted.push_back(request);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mRequests.push_back(request);
+		mLoadsInFlight++;
+	}
+	mWake.notify_one();
+}
+
+void TextureStreamer::CompleteLoads()
+{
+	std::vector<LoadRequest> completed;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		completed.swap(mCompleted);
+	}
+
+	for(const LoadRequest& request : completed)
+	{
+		Texture& t = *mTextures[request.Id];
+
+		mStats.PendingBytes -= t.LoadBytes;
+		mStats.PendingLoads--;
+		t.Loading = false;
+		t.LoadBytes = 0;
+
+		bool tail = t.ResidentMip == NotResident;
+		std::uint32_t firstMip = t.LoadMip;
+
+		if(SetResidentMips(request.Id, firstMip))
+		{
+			if(tail)
+				mStats.TailsLoaded++;
+			else
+				mStats.MipsLoaded++;
+		}
+	}
+}
+
+bool TextureStreamer::SetResidentMips(TextureId id, std::uint32_t firstMip)
+{
+	Texture& t = *mTextures[id];
+
+	if(!mBackend.SetResidentMips(id, t.File, firstMip))
+	{
+		t.Failed = true;
+		mStats.FailedTextures++;
+		return false;
+	}
+
+	if(t.ResidentMip != NotResident)
+		mStats.ResidentBytes -= t.BytesFrom[t.ResidentMip];
+	mStats.ResidentBytes += t.BytesFrom[firstMip];
+	mStats.PeakResidentBytes = std::max(mStats.PeakResidentBytes, mStats.ResidentBytes);
+
+	t.ResidentMip = firstMip;
+
+	return true;
+}
+
+void TextureStreamer::UpdateWantedMip(Texture& t)
+{
+	if(!t.Used || t.LastUsedFrame + mSettings.EvictionDelayFrames < mFrame)
+	{
+		t.WantedMip = t.TailMip;
+		return;
+	}
+
+	// One texel per pixel: the mip whose size is the first not larger than
+	// the screen size.
+	const DDSFile::Desc& desc = t.File.GetDesc();
+	float size = (float)std::max(desc.Width, desc.Height);
+	float pixels = std::max(t.ScreenPixels, 1.0f);
+
+	std::uint32_t mip = 0;
+	if(size > pixels)
+		mip = (std::uint32_t)std::floor(std::log2(size / pixels));
+
+	t.WantedMip = std::min<std::uint32_t>(mip, t.TailMip);
+}
+
+bool TextureStreamer::IsEvictable(const Texture& t)const
+{
+	if(t.Loading || t.Failed || t.ResidentMip == NotResident || t.ResidentMip >= t.TailMip)
+		return false;
+
+	bool unused = !t.Used || t.LastUsedFrame + mSettings.EvictionDelayFrames < mFrame;
+
+	return unused || t.ResidentMip + mSettings.HysteresisMips < t.WantedMip;
+}
+
+bool TextureStreamer::EvictOne(TextureId except)
+{
+	TextureId victim = InvalidTexture;
+	for(TextureId id = 0; id < mTextures.size(); ++id)
+	{
+		const Texture& t = *mTextures[id];
+		if(id == except || !IsEvictable(t))
+			continue;
+
+		if(victim == InvalidTexture || t.LastUsedFrame < mTextures[victim]->LastUsedFrame)
+			victim = id;
+	}
+
+	if(victim == InvalidTexture)
+		return false;
+
+	Texture& t = *mTextures[victim];
+	std::uint32_t before = t.ResidentMip;
+
+	// WantedMip is the tail for unused textures.
+	if(SetResidentMips(victim, t.WantedMip))
+		mStats.MipsEvicted += t.ResidentMip - before;
+
+	return true;
+}
+
+void TextureStreamer::Update()
+{
+	PROFILE_SCOPE("TextureStreamer::Update");
+
+	CompleteLoads();
+
+	for(auto& t : mTextures)
+	{
+		if(!t->Loading && !t->Failed && t->ResidentMip != NotResident)
+			UpdateWantedMip(*t);
+	}
+
+	// Mip tails first, in the order the textures were registered.
+	for(TextureId id = 0; id < mTextures.size() && mStats.PendingLoads < mSettings.MaxPendingLoads; ++id)
+	{
+		const Texture& t = *mTextures[id];
+		if(!t.Loading && !t.Failed && t.ResidentMip == NotResident)
+			Issue(id, t.TailMip, t.MipLevels, t.BytesFrom[t.TailMip]);
+	}
+
+	// Then one more mip for the textures whose resident mips are stretched
+	// the most on screen.
+	mCandidates.clear();
+	for(TextureId id = 0; id < mTextures.size(); ++id)
+	{
+		const Texture& t = *mTextures[id];
+		if(!t.Loading && !t.Failed && t.ResidentMip != NotResident && t.ResidentMip > t.WantedMip)
+			mCandidates.push_back(id);
+	}
+
+	auto stretch = [this](TextureId id)
+	{
+		const Texture& t = *mTextures[id];
+		const DDSFile::Subresource& s = t.File.GetSubresource(t.ResidentMip, 0);
+		return t.ScreenPixels / (float)std::max(s.Width, s.Height);
+	};
+
+	std::sort(mCandidates.begin(), mCandidates.end(), [&](TextureId a, TextureId b)
+	{
+		return stretch(a) > stretch(b);
+	});
+
+	for(TextureId id : mCandidates)
+	{
+		if(mStats.PendingLoads >= mSettings.MaxPendingLoads)
+			break;
+
+		const Texture& t = *mTextures[id];
+		std::uint32_t mip = t.ResidentMip - 1;
+		std::uint64_t bytes = t.BytesFrom[mip] - t.BytesFrom[t.ResidentMip];
+
+		bool fits = true;
+		while(mStats.ResidentBytes + mStats.PendingBytes + bytes > mSettings.BudgetBytes)
+		{
+			if(!EvictOne(id))
+			{
+				fits = false;
+				break;
+			}
+		}
+
+		// The textures further down the list are less stretched; leave the
+		// room for this one.
+		if(!fits)
+		{
+			mStats.BudgetStalls++;
+			break;
+		}
+
+		Issue(id, mip, t.ResidentMip, bytes);
+	}
+
+	// Mip tails alone may go over budget.
+	while(mStats.ResidentBytes > mSettings.BudgetBytes && EvictOne(InvalidTexture))
+	{
+	}
+
+	mFrame++;
+}
+
+void TextureStreamer::WaitIdle()
+{
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mDone.wait(lock, [this] { return mLoadsInFlight == 0; });
+	}
+
+	CompleteLoads();
+}
+
+std::uint32_t TextureStreamer::GetResidentMip(TextureId id)const
+{
+	assert(id < mTextures.size());
+	return mTextures[id]->ResidentMip;
+}
+
+std::uint32_t TextureStreamer::GetWantedMip(TextureId id)const
+{
+	assert(id < mTextures.size());
+	return mTextures[id]->WantedMip;
+}
+
+bool TextureStreamer::IsFailed(TextureId id)const
+{
+	assert(id < mTextures.size());
+	return mTextures[id]->Failed;
+}
+
+const DDSFile::Desc& TextureStreamer::GetDesc(TextureId id)const
+{
+	assert(id < mTextures.size());
+	return mTextures[id]->File.GetDesc();
+}
+
+const TextureStreamer::Stats& TextureStreamer::GetStats()const
+{
+	return mStats;
+}
@@ -0,0 +1,200 @@
+//***************************************************************************************
+// TextureStreamer.h by DanielDFY
+//
+// Streams DDS textures in the background instead of loading every mip of every
+// texture on the main thread during Initialize.  Each texture first gets its
+// mip tail (the mips no larger than Settings::MipTailSize), so something can be
+// drawn after a few small reads; higher mips follow one level at a time in
+// order of how blurry each texture currently looks, given the screen size the
+// app reports for it every frame.
+//
+// Resident bytes are kept under a budget.  When a load does not fit, mips are
+// evicted from the least recently used textures that either were not used for
+// EvictionDelayFrames frames or hold more than HysteresisMips levels of detail
+// beyond what they need, so a texture moving back and forth across a mip
+// boundary is not evicted and reloaded over and over.
+//
+// Register maps the file and reads its header, so the texture's dimension and
+// size are known before any of it is resident; the pages are faulted in by the
+// I/O threads.  The GPU side is a Backend, called from Register and Update on
+// the calling thread only.  The scheduling does not depend on D3D, so it can
+// run headless against a mock Backend (TextureStreamBackend.h is the D3D12 one).
+//***************************************************************************************
+
+#pragma once
+
+#include "DDSFile.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TextureStreamer
+{
+public:
+	typedef std::uint32_t TextureId;
+
+	static const TextureId InvalidTexture = ~0u;
+
+	// Returned by GetResidentMip while no mip is resident yet.
+	static const std::uint32_t NotResident = ~0u;
+
+	class Backend
+	{
+	public:
+		virtual ~Backend() = default;
+
+		// Called by Register once the header has been read, before any mip
+		// is resident, e.g. to pick a placeholder of the right dimension.
+		virtual void RegisterTexture(TextureId id, const DDSFile::Desc& desc) {}
+
+		// Makes mips [firstMip, MipLevels) of every array slice of the texture
+		// resident, replacing whatever was resident before; firstMip is lower
+		// than before to stream in and higher to evict.  The file stays mapped
+		// while the texture is registered.  Returning false stops streaming the
+		// texture and keeps its previous mips.
+		virtual bool SetResidentMips(TextureId id, const DDSFile& file, std::uint32_t firstMip) = 0;
+	};
+
+	struct Settings
+	{
+		std::uint64_t BudgetBytes = 256ull * 1024 * 1024;
+
+		// Mips with neither dimension larger than this are loaded first and
+		// never evicted.
+		std::uint32_t MipTailSize = 64;
+
+		// 0 loads on the calling thread inside Update, which makes the order of
+		// events deterministic for tests.
+		std::uint32_t IoThreads = 2;
+
+		// Loads issued but not yet uploaded.  Keeping this small leaves the
+		// order of the later loads to the priorities of later frames.
+		std::uint32_t MaxPendingLoads = 4;
+
+		std::uint32_t EvictionDelayFrames = 60;
+		std::uint32_t HysteresisMips = 1;
+	};
+
+	struct Stats
+	{
+		// Bytes of the resident mips as laid out in the files, which is close to
+		// but not exactly what the GPU allocates for them.
+		std::uint64_t ResidentBytes = 0;
+		std::uint64_t PeakResidentBytes = 0;
+
+		// Reserved for loads in flight.
+		std::uint64_t PendingBytes = 0;
+
+		std::uint32_t Textures = 0;
+		std::uint32_t PendingLoads = 0;
+		std::uint32_t TailsLoaded = 0;
+		std::uint32_t MipsLoaded = 0;
+		std::uint32_t MipsEvicted = 0;
+		std::uint32_t FailedTextures = 0;
+
+		// Loads put off because nothing could be evicted to make room.
+		std::uint32_t BudgetStalls = 0;
+	};
+
+	explicit TextureStreamer(Backend& backend);
+	TextureStreamer(Backend& backend, const Settings& settings);
+	TextureStreamer(const TextureStreamer& rhs) = delete;
+	TextureStreamer& operator=(const TextureStreamer& rhs) = delete;
+	~TextureStreamer();
+
+	// Maps the file and reads its header; the mip tail is requested on the
+	// next Update.  A file that cannot be opened or parsed is failed right
+	// away.  May be called while loads are in flight.
+	TextureId Register(const std::string& filename);
+
+	// Size in pixels the texture covers on screen this frame, along the axis of
+	// its larger dimension.  Call every frame the texture is used; if it is
+	// used more than once, the largest size counts.
+	void ReportUsage(TextureId id, float screenPixels);
+
+	// Once per frame, before drawing: uploads finished loads, issues new ones
+	// and evicts while over budget.
+	void Update();
+
+	// Waits for every issued load and uploads it.
+	void WaitIdle();
+
+	std::uint32_t GetResidentMip(TextureId id)const;
+	std::uint32_t GetWantedMip(TextureId id)const;
+	bool IsFailed(TextureId id)const;
+
+	// Valid unless the texture failed to open.
+	const DDSFile::Desc& GetDesc(TextureId id)const;
+
+	const Stats& GetStats()const;
+
+private:
+	struct Texture
+	{
+		std::string Filename;
+
+		// Set by Register; the I/O threads only read them.
+		DDSFile File;
+		std::uint32_t MipLevels = 0;
+		std::uint32_t TailMip = 0;
+
+		// Bytes of mips [m, MipLevels) over all array slices, for every m.
+		std::vector<std::uint64_t> BytesFrom;
+
+		// Main thread only.
+		bool Loading = false;
+		bool Failed = false;
+		std::uint32_t ResidentMip = NotResident;
+		std::uint32_t WantedMip = 0;
+		std::uint32_t LoadMip = 0;
+		std::uint64_t LoadBytes = 0;
+
+		float ScreenPixels = 0.0f;
+		std::uint64_t LastUsedFrame = 0;
+		bool Used = false;
+	};
+
+	struct LoadRequest
+	{
+		TextureId Id = InvalidTexture;
+		std::uint32_t FirstMip = 0;
+		std::uint32_t EndMip = 0;
+	};
+
+	void IoThreadMain();
+	void Load(const Texture& t, const LoadRequest& request);
+	void Issue(TextureId id, std::uint32_t firstMip, std::uint32_t endMip, std::uint64_t bytes);
+	void CompleteLoads();
+
+	void UpdateWantedMip(Texture& t);
+	bool IsEvictable(const Texture& t)const;
+	bool EvictOne(TextureId except);
+	bool SetResidentMips(TextureId id, std::uint32_t firstMip);
+
+private:
+	Backend& mBackend;
+	Settings mSettings;
+
+	// Only the main thread changes the vector, under mMutex, so the I/O
+	// threads look textures up under mMutex too.
+	std::vector<std::unique_ptr<Texture>> mTextures;
+	std::uint64_t mFrame = 1;
+
+	std::vector<std::thread> mIoThreads;
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::condition_variable mDone;
+	std::deque<LoadRequest> mRequests;
+	std::vector<LoadRequest> mCompleted;
+	std::uint32_t mLoadsInFlight = 0;
+	bool mQuit = false;
+
+	std::vector<TextureId> mCandidates;
+
+	Stats mStats;
+};
@@ -0,0 +1,119 @@
+//***************************************************************************************
+// ThreadPool.cpp by DanielDFY
+//***************************************************************************************
+
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include <cassert>
+
+ThreadPool::ThreadPool(std::uint32_t threadCount) :
+	mNextIndex(0),
+	mFailed(false)
+{
+	for(std::uint32_t i = 0; i < threadCount; ++i)
+		mThreads.emplace_back(&ThreadPool::WorkerMain, this, i + 1);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+	mWake.notify_all();
+
+	for(auto& t : mThreads)
+		t.join();
+}
+
+std::uint32_t ThreadPool::DefaultThreadCount()
+{
+	std::uint32_t n = std::thread::hardware_concurrency();
+	return n > 1 ? n - 1 : 0;
+}
+
+void ThreadPool::ParallelFor(std::uint32_t count, const Job& job)
+{
+	if(count == 0)
+		return;
+
+	// Not worth waking anybody for a single index.
+	if(count == 1 || mThreads.empty())
+	{
+		for(std::uint32_t i = 0; i < count; ++i)
+			job(i, 0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		assert(mJob == nullptr);
+
+		mJob = &job;
+		mJobCount = count;
+		mNextIndex = 0;
+		mBusyThreads = (std::uint32_t)mThreads.size();
+		mException = nullptr;
+		mFailed = false;
+		mGeneration++;
+	}
+	mWake.notify_all();
+
+	RunJob(0);
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mDone.wait(lock, [this] { return mBusyThreads == 0; });
+	mJob = nullptr;
+
+	if(mException)
+	{
+		std::exception_ptr e = mException;
+		mException = nullptr;
+		std::rethrow_exception(e);
+	}
+}
+
+void ThreadPool::WorkerMain(std::uint32_t worker)
+{
+	Profiler::Get().SetThreadName("Worker " + std::to_string(worker));
+
+	std::uint64_t generation = 0;
+	for(;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWake.wait(lock, [&] { return mQuit || mGeneration != generation; });
+			if(mQuit)
+				return;
+			generation = mGeneration;
+		}
+
+		RunJob(worker);
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		if(--mBusyThreads == 0)
+			mDone.notify_one();
+	}
+}
+
+void ThreadPool::RunJob(std::uint32_t worker)
+{
+	for(;;)
+	{
+		std::uint32_t i = mNextIndex.fetch_add(1);
+		if(i >= mJobCount || mFailed)
+			return;
+
+		try
+		{
+			(*mJob)(i, worker);
+		}
+		catch(...)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if(!mException)
+				mException = std::current_exception();
+			mFailed = true;
+		}
+	}
+}
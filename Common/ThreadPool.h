@@ -0,0 +1,65 @@
+//***************************************************************************************
+// ThreadPool.h by DanielDFY
+//
+// A fixed set of worker threads for splitting per-frame CPU work.  ParallelFor
+// hands out indices to the workers and to the calling thread, which works too
+// instead of just waiting, and returns when every index has been processed.
+//
+// Worker index 0 is always the calling thread, so per-worker data (command
+// lists, scratch memory) can be indexed with [0, WorkerCount()).
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	typedef std::function<void(std::uint32_t index, std::uint32_t worker)> Job;
+
+	// threadCount threads besides the calling thread.  By default one less than
+	// the number of hardware threads.
+	explicit ThreadPool(std::uint32_t threadCount = DefaultThreadCount());
+	ThreadPool(const ThreadPool& rhs) = delete;
+	ThreadPool& operator=(const ThreadPool& rhs) = delete;
+	~ThreadPool();
+
+	static std::uint32_t DefaultThreadCount();
+
+	std::uint32_t WorkerCount()const { return (std::uint32_t)mThreads.size() + 1; }
+
+	// Runs job(index, worker) for every index in [0, count).  Indices are handed
+	// out in increasing order, but may complete in any order.  If a job throws,
+	// the remaining indices are skipped and the first exception is rethrown
+	// here.  Not reentrant: do not call from inside a job.
+	void ParallelFor(std::uint32_t count, const Job& job);
+
+private:
+	void WorkerMain(std::uint32_t worker);
+	void RunJob(std::uint32_t worker);
+
+private:
+	std::vector<std::thread> mThreads;
+
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::condition_variable mDone;
+
+	const Job* mJob = nullptr;
+	std::uint32_t mJobCount = 0;
+	std::atomic<std::uint32_t> mNextIndex;
+	std::uint32_t mBusyThreads = 0;
+	std::uint64_t mGeneration = 0;
+	bool mQuit = false;
+
+	std::exception_ptr mException;
+	std::atomic<bool> mFailed;
+};
@@ -0,0 +1,127 @@
+//***************************************************************************************
+// UploadBatcher.cpp by DanielDFY
+//***************************************************************************************
+
+#include "UploadBatcher.h"
+#include <cassert>
+#include <sstream>
+
+std::wstring UploadBatcher::Stats::ToString()const
+{
+	std::wostringstream outs;
+	outs << L"uploaded " << BytesUploaded / 1024 << L" KB in " << Copies << L" copies, " <<
+		Batches << L" batches (" << BudgetFlushes << L" over budget), " <<
+		StagingStalls << L" stalls, staging peak " << PeakStagingBytes / 1024 <<
+		L" / " << StagingCapacity / 1024 << L" KB";
+	return outs.str();
+}
+
+UploadBatcher::UploadBatcher(Backend& backend, std::uint64_t stagingByteSize, std::uint64_t batchByteBudget) :
+	mBackend(backend),
+	mStagingRing(stagingByteSize),
+	mBatchByteBudget(batchByteBudget)
+{
+	mStats.StagingCapacity = stagingByteSize;
+}
+
+void UploadBatcher::BeginCopy()
+{
+	if(mBatchOpen)
+		return;
+
+	// Reuse an allocator whose batch has finished executing.
+	std::uint64_t completed = mBackend.CompletedFence();
+	mCurrAllocator = (std::uint32_t)mAllocatorFences.size();
+	for(std::uint32_t i = 0; i < (std::uint32_t)mAllocatorFences.size(); ++i)
+	{
+		if(mAllocatorFences[i] <= completed)
+		{
+			mCurrAllocator = i;
+			break;
+		}
+	}
+
+	mBackend.OpenBatch(mCurrAllocator);
+	if(mCurrAllocator == mAllocatorFences.size())
+		mAllocatorFences.push_back(0);
+
+	mBatchOpen = true;
+	mBatchBytes = 0;
+}
+
+std::uint64_t UploadBatcher::AllocateStaging(std::uint64_t byteSize, std::uint64_t alignment)
+{
+	assert(mBatchOpen);
+	assert(byteSize <= mStagingRing.Capacity());
+
+	mStagingRing.Retire(mBackend.CompletedFence());
+
+	std::uint64_t offset = mStagingRing.Allocate(byteSize, alignment);
+	if(offset == RingAllocator::InvalidOffset)
+	{
+		// The ring is full of copies that have not executed yet.  Submit what
+		// we have, wait for the GPU and start a new batch.
+		mStats.StagingStalls++;
+		WaitIdle();
+		BeginCopy();
+
+		offset = mStagingRing.Allocate(byteSize, alignment);
+		assert(offset != RingAllocator::InvalidOffset);
+	}
+
+	mBatchBytes += byteSize;
+	return offset;
+}
+
+void UploadBatcher::EndCopy(std::uint64_t bytesUploaded)
+{
+	mStats.BytesUploaded += bytesUploaded;
+	mStats.Copies++;
+
+	if(mBatchBytes >= mBatchByteBudget)
+	{
+		mStats.BudgetFlushes++;
+		Flush();
+	}
+}
+
+std::uint64_t UploadBatcher::Flush()
+{
+	if(!mBatchOpen)
+		return mLastSubmittedFence;
+
+	mLastSubmittedFence = mBackend.SubmitBatch();
+
+	// The staging space and the allocator of this batch are free once the
+	// GPU reaches the fence.
+	mStagingRing.FinishFrame(mLastSubmittedFence);
+	mAllocatorFences[mCurrAllocator] = mLastSubmittedFence;
+
+	mBatchOpen = false;
+	mStats.Batches++;
+
+	return mLastSubmittedFence;
+}
+
+bool UploadBatcher::IsComplete(std::uint64_t fenceValue)const
+{
+	return mBackend.CompletedFence() >= fenceValue;
+}
+
+void UploadBatcher::WaitForFence(std::uint64_t fenceValue)
+{
+	if(!IsComplete(fenceValue))
+		mBackend.WaitForCompletion(fenceValue);
+}
+
+void UploadBatcher::WaitIdle()
+{
+	WaitForFence(Flush());
+	mStagingRing.Retire(mBackend.CompletedFence());
+}
+
+const UploadBatcher::Stats& UploadBatcher::GetStats()const
+{
+	mStats.PeakStagingBytes = mStagingRing.GetStats().PeakUsedBytes;
+	return mStats;
+}
@@ -0,0 +1,115 @@
+//***************************************************************************************
+// UploadBatcher.h by DanielDFY
+//
+// The batching and staging policy behind UploadManager, without any D3D12 types
+// so it can be driven by a simulated queue and fence.
+//
+// Staging space is suballocated from a RingAllocator and recycled when the
+// fence of the batch that used it completes.  A batch is opened by the first
+// copy after a submit and submitted on Flush, or by EndCopy once its staging
+// bytes reach the batch budget.  When the ring is full the batcher submits the
+// open batch, waits for the GPU and continues the copy in a new batch.  Each
+// batch records into a command allocator slot that is reused once the fence
+// of the batch that last used it has completed.
+//
+// A copy looks like:
+//   BeginCopy()
+//   AllocateStaging(...)     once per chunk, then record the GPU copy
+//   EndCopy(bytes)
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "RingAllocator.h"
+
+class UploadBatcher
+{
+public:
+	// Records and submits the copies.  The batcher calls OpenBatch before the
+	// first copy of a batch and SubmitBatch when the batch is done.
+	class Backend
+	{
+	public:
+		virtual ~Backend() = default;
+
+		// Starts recording a batch into command allocator slot allocatorIndex.
+		// The slot's previous batch has completed; a slot equal to the number
+		// of slots used so far is new and must be created.
+		virtual void OpenBatch(std::uint32_t allocatorIndex) = 0;
+
+		// Submits the open batch and returns the fence value signaled after it.
+		virtual std::uint64_t SubmitBatch() = 0;
+
+		virtual std::uint64_t CompletedFence() = 0;
+		virtual void WaitForCompletion(std::uint64_t fenceValue) = 0;
+	};
+
+	struct Stats
+	{
+		std::uint64_t BytesUploaded = 0;
+		std::uint32_t Copies = 0;
+		std::uint32_t Batches = 0;
+
+		// Batches submitted early because they exceeded the batch budget.
+		std::uint32_t BudgetFlushes = 0;
+
+		// Times the CPU had to wait for the GPU to free staging space.
+		std::uint32_t StagingStalls = 0;
+
+		std::uint64_t StagingCapacity = 0;
+		std::uint64_t PeakStagingBytes = 0;
+
+		std::wstring ToString()const;
+	};
+
+	UploadBatcher(Backend& backend, std::uint64_t stagingByteSize, std::uint64_t batchByteBudget);
+	UploadBatcher(const UploadBatcher& rhs) = delete;
+	UploadBatcher& operator=(const UploadBatcher& rhs) = delete;
+
+	// Opens a batch if none is open.
+	void BeginCopy();
+
+	// Returns the staging offset of byteSize bytes (at most the staging
+	// capacity).  May submit the open batch, wait for the GPU and open a new
+	// batch, so record the GPU copy of this chunk after the call.
+	std::uint64_t AllocateStaging(std::uint64_t byteSize, std::uint64_t alignment);
+
+	// Counts the copy and submits the batch if it is over budget.
+	void EndCopy(std::uint64_t bytesUploaded);
+
+	// Submits the open batch and returns the fence value that marks its
+	// completion (the last submitted value if nothing was pending).
+	std::uint64_t Flush();
+
+	bool IsComplete(std::uint64_t fenceValue)const;
+	void WaitForFence(std::uint64_t fenceValue);
+
+	// Flushes and waits for every copy.
+	void WaitIdle();
+
+	std::uint64_t StagingCapacity()const { return mStagingRing.Capacity(); }
+	bool IsBatchOpen()const { return mBatchOpen; }
+	std::uint32_t AllocatorCount()const { return (std::uint32_t)mAllocatorFences.size(); }
+
+	const Stats& GetStats()const;
+
+private:
+	Backend& mBackend;
+
+	RingAllocator mStagingRing;
+	std::uint64_t mLastSubmittedFence = 0;
+
+	// Fence of the last batch recorded into each command allocator slot.
+	std::vector<std::uint64_t> mAllocatorFences;
+	std::uint32_t mCurrAllocator = 0;
+
+	bool mBatchOpen = false;
+	std::uint64_t mBatchBytes = 0;
+	std::uint64_t mBatchByteBudget = 0;
+
+	mutable Stats mStats;
+};
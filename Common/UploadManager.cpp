@@ -0,0 +1,211 @@
+//***************************************************************************************
+// UploadManager.cpp by DanielDFY
+//***************************************************************************************
+
+#include "UploadManager.h"
+
+using Microsoft::WRL::ComPtr;
+
+UploadManager::UploadManager(ID3D12Device* device, ID3D12CommandQueue* queue,
+	UINT64 stagingByteSize, UINT64 batchByteBudget) :
+	mDevice(device),
+	mQueue(queue),
+	mBatcher(*this, stagingByteSize, batchByteBudget)
+{
+	ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence)));
+
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(stagingByteSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&mStagingBuffer)));
+
+	ThrowIfFailed(mStagingBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mMappedStaging)));
+}
+
+UploadManager::~UploadManager()
+{
+	// The GPU may still be reading the staging buffer.
+	mBatcher.WaitIdle();
+
+	if(mStagingBuffer != nullptr)
+		mStagingBuffer->Unmap(0, nullptr);
+	mMappedStaging = nullptr;
+}
+
+ComPtr<ID3D12Resource> UploadManager::CreateDefaultBuffer(
+	const void* initData,
+	UINT64 byteSize,
+	D3D12_RESOURCE_STATES finalState)
+{
+	ComPtr<ID3D12Resource> defaultBuffer;
+
+	ThrowIfFailed(mDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(defaultBuffer.GetAddressOf())));
+
+	CopyToBuffer(defaultBuffer.Get(), 0, initData, byteSize, D3D12_RESOURCE_STATE_COMMON, finalState);
+
+	return defaultBuffer;
+}
+
+void UploadManager::CopyToBuffer(
+	ID3D12Resource* dst, UINT64 dstOffset,
+	const void* data, UINT64 byteSize,
+	D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter)
+{
+	mBatcher.BeginCopy();
+
+	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(dst,
+		stateBefore, D3D12_RESOURCE_STATE_COPY_DEST));
+
+	// Copy through the ring in chunks no larger than the ring itself.  A chunk
+	// may close the batch to free staging space, in which case the rest of the
+	// copy goes into the next batch; the buffer stays in COPY_DEST meanwhile.
+	const BYTE* src = reinterpret_cast<const BYTE*>(data);
+	UINT64 copied = 0;
+	while(copied < byteSize)
+	{
+		UINT64 chunk = MathHelper::Min(byteSize - copied, mBatcher.StagingCapacity());
+		UINT64 offset = mBatcher.AllocateStaging(chunk, D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT);
+
+		memcpy(mMappedStaging + offset, src + copied, (size_t)chunk);
+		mCommandList->CopyBufferRegion(dst, dstOffset + copied, mStagingBuffer.Get(), offset, chunk);
+
+		copied += chunk;
+	}
+
+	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(dst,
+		D3D12_RESOURCE_STATE_COPY_DEST, stateAfter));
+
+	mBatcher.EndCopy(byteSize);
+}
+
+void UploadManager::CopyToTexture(
+	ID3D12Resource* dst, UINT firstSubresource, UINT numSubresources,
+	const D3D12_SUBRESOURCE_DATA* data,
+	D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter)
+{
+	mBatcher.BeginCopy();
+
+	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(dst,
+		stateBefore, D3D12_RESOURCE_STATE_COPY_DEST));
+
+	UINT64 bytesUploaded = 0;
+	D3D12_RESOURCE_DESC desc = dst->GetDesc();
+	for(UINT i = 0; i < numSubresources; ++i)
+	{
+		UINT subresource = firstSubresource + i;
+
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout;
+		UINT numRows = 0;
+		UINT64 rowSize = 0;
+		UINT64 totalBytes = 0;
+		mDevice->GetCopyableFootprints(&desc, subresource, 1, 0, &layout, &numRows, &rowSize, &totalBytes);
+
+		if(totalBytes > mBatcher.StagingCapacity())
+			ThrowIfFailed(E_OUTOFMEMORY);
+
+		// Rows are padded to D3D12_TEXTURE_DATA_PITCH_ALIGNMENT in the ring.
+		layout.Offset = mBatcher.AllocateStaging(totalBytes, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+		D3D12_MEMCPY_DEST dest = { mMappedStaging + layout.Offset, layout.Footprint.RowPitch,
+			(SIZE_T)layout.Footprint.RowPitch * numRows };
+		MemcpySubresource(&dest, &data[i], (SIZE_T)rowSize, numRows, layout.Footprint.Depth);
+
+		CD3DX12_TEXTURE_COPY_LOCATION dstLocation(dst, subresource);
+		CD3DX12_TEXTURE_COPY_LOCATION srcLocation(mStagingBuffer.Get(), layout);
+		mCommandList->CopyTextureRegion(&dstLocation, 0, 0, 0, &srcLocation, nullptr);
+
+		bytesUploaded += totalBytes;
+	}
+
+	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(dst,
+		D3D12_RESOURCE_STATE_COPY_DEST, stateAfter));
+
+	mBatcher.EndCopy(bytesUploaded);
+}
+
+void UploadManager::OpenBatch(std::uint32_t allocatorIndex)
+{
+	if(allocatorIndex == mAllocators.size())
+	{
+		ComPtr<ID3D12CommandAllocator> allocator;
+		ThrowIfFailed(mDevice->CreateCommandAllocator(
+			D3D12_COMMAND_LIST_TYPE_DIRECT,
+			IID_PPV_ARGS(allocator.GetAddressOf())));
+		mAllocators.push_back(allocator);
+	}
+
+	ID3D12CommandAllocator* allocator = mAllocators[allocatorIndex].Get();
+	ThrowIfFailed(allocator->Reset());
+
+	if(mCommandList == nullptr)
+	{
+		ThrowIfFailed(mDevice->CreateCommandList(
+			0,
+			D3D12_COMMAND_LIST_TYPE_DIRECT,
+			allocator,
+			nullptr,
+			IID_PPV_ARGS(mCommandList.GetAddressOf())));
+	}
+	else
+	{
+		ThrowIfFailed(mCommandList->Reset(allocator, nullptr));
+	}
+}
+
+std::uint64_t UploadManager::SubmitBatch()
+{
+	ThrowIfFailed(mCommandList->Close());
+
+	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
+	mQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+
+	ThrowIfFailed(mQueue->Signal(mFence.Get(), ++mNextFenceValue));
+	return mNextFenceValue;
+}
+
+std::uint64_t UploadManager::CompletedFence()
+{
+	return mFence->GetCompletedValue();
+}
+
+void UploadManager::WaitForCompletion(std::uint64_t fenceValue)
+{
+	HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
+	ThrowIfFailed(mFence->SetEventOnCompletion(fenceValue, eventHandle));
+	WaitForSingleObject(eventHandle, INFINITE);
+	CloseHandle(eventHandle);
+}
+
+UINT64 UploadManager::Flush()
+{
+	return mBatcher.Flush();
+}
+
+bool UploadManager::IsComplete(UINT64 fenceValue)const
+{
+	return mBatcher.IsComplete(fenceValue);
+}
+
+void UploadManager::WaitForFence(UINT64 fenceValue)
+{
+	mBatcher.WaitForFence(fenceValue);
+}
+
+void UploadManager::WaitIdle()
+{
+	mBatcher.WaitIdle();
+}
+
+const UploadManager::Stats& UploadManager::GetStats()const
+{
+	return mBatcher.GetStats();
+}
@@ -0,0 +1,89 @@
+//***************************************************************************************
+// UploadManager.h by DanielDFY
+//
+// Batched uploads into default heap buffers through one shared staging ring,
+// replacing the dedicated upload buffer d3dUtil::CreateDefaultBuffer creates for
+// every buffer (kept alive in MeshGeometry::VertexBufferUploader/IndexBufferUploader
+// until DisposeUploaders).  Textures can be filled the same way.
+//
+// Copies are recorded into the manager's own command list and submitted in
+// batches to the app's queue, so they execute before any command list the app
+// submits afterwards.  When batches are submitted and staging space is
+// recycled is decided by UploadBatcher (see UploadBatcher.h); this class is
+// its D3D12 backend.  Buffers larger than the ring are copied in chunks.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "UploadBatcher.h"
+
+class UploadManager : private UploadBatcher::Backend
+{
+public:
+	typedef UploadBatcher::Stats Stats;
+
+	UploadManager(ID3D12Device* device, ID3D12CommandQueue* queue,
+		UINT64 stagingByteSize = 16*1024*1024,
+		UINT64 batchByteBudget = 4*1024*1024);
+	UploadManager(const UploadManager& rhs) = delete;
+	UploadManager& operator=(const UploadManager& rhs) = delete;
+	~UploadManager()override;
+
+	// Same result as d3dUtil::CreateDefaultBuffer, but without a per-buffer
+	// upload heap.  The buffer is in finalState once the copy has executed.
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
+		const void* initData,
+		UINT64 byteSize,
+		D3D12_RESOURCE_STATES finalState = D3D12_RESOURCE_STATE_GENERIC_READ);
+
+	// Copies data into an existing buffer, transitioning it from stateBefore to
+	// COPY_DEST and then to stateAfter.
+	void CopyToBuffer(
+		ID3D12Resource* dst, UINT64 dstOffset,
+		const void* data, UINT64 byteSize,
+		D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter);
+
+	// Copies numSubresources subresources, starting at firstSubresource, into
+	// a texture, with the same transitions as CopyToBuffer.  Each subresource
+	// goes through the ring in one piece, so it must fit in the ring.
+	void CopyToTexture(
+		ID3D12Resource* dst, UINT firstSubresource, UINT numSubresources,
+		const D3D12_SUBRESOURCE_DATA* data,
+		D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter);
+
+	// Submits the pending copies and returns the fence value that marks their
+	// completion (the last submitted value if nothing was pending).
+	UINT64 Flush();
+
+	bool IsComplete(UINT64 fenceValue)const;
+	void WaitForFence(UINT64 fenceValue);
+
+	// Flushes and waits for every copy.
+	void WaitIdle();
+
+	const Stats& GetStats()const;
+
+private:
+	void OpenBatch(std::uint32_t allocatorIndex)override;
+	std::uint64_t SubmitBatch()override;
+	std::uint64_t CompletedFence()override;
+	void WaitForCompletion(std::uint64_t fenceValue)override;
+
+private:
+	ID3D12Device* mDevice = nullptr;
+	ID3D12CommandQueue* mQueue = nullptr;
+
+	Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
+	UINT64 mNextFenceValue = 0;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> mStagingBuffer;
+	BYTE* mMappedStaging = nullptr;
+
+	// Command allocators can only be reset once the GPU is done with them;
+	// the batcher hands out a slot per batch in flight.
+	std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> mAllocators;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> mCommandList;
+
+	UploadBatcher mBatcher;
+};
@@ -0,0 +1,115 @@
+//***************************************************************************************
+// UploadRing.h by DanielDFY
+//
+// One large persistently mapped upload heap shared by all per-frame transient
+// data (constants, instance buffers, ...), suballocated with a RingAllocator.
+// Unlike one UploadBuffer<T> per type and frame resource, the amount of data
+// per frame can vary and any type can go into the same buffer.
+//
+// Usage per frame:
+//   Retire(fence->GetCompletedValue())  after waiting for the frame resource
+//   Allocate*/AllocateConstants         while building the frame
+//   FinishFrame(fenceValue)             after signaling the frame's fence
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "RingAllocator.h"
+
+class UploadRing
+{
+public:
+	struct Allocation
+	{
+		BYTE* CpuAddress = nullptr;
+		D3D12_GPU_VIRTUAL_ADDRESS GpuAddress = 0;
+		UINT64 Offset = 0;
+		UINT64 Size = 0;
+	};
+
+	UploadRing(ID3D12Device* device, UINT64 byteSize) :
+		mAllocator(byteSize)
+	{
+		ThrowIfFailed(device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&mUploadBuffer)));
+
+		// Mapped for the lifetime of the ring; the fences keep us from writing
+		// to memory the GPU is still reading.
+		ThrowIfFailed(mUploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mMappedData)));
+	}
+
+	UploadRing(const UploadRing& rhs) = delete;
+	UploadRing& operator=(const UploadRing& rhs) = delete;
+	~UploadRing()
+	{
+		if(mUploadBuffer != nullptr)
+			mUploadBuffer->Unmap(0, nullptr);
+
+		mMappedData = nullptr;
+	}
+
+	ID3D12Resource* Resource()const
+	{
+		return mUploadBuffer.Get();
+	}
+
+	const RingAllocator& Allocator()const
+	{
+		return mAllocator;
+	}
+
+	// Throws E_OUTOFMEMORY if the frames in flight still use the space; size the
+	// ring for gNumFrameResources frames of the worst case.
+	Allocation Allocate(UINT64 byteSize, UINT64 alignment)
+	{
+		UINT64 offset = mAllocator.Allocate(byteSize, alignment);
+		if(offset == RingAllocator::InvalidOffset)
+			ThrowIfFailed(E_OUTOFMEMORY);
+
+		Allocation a;
+		a.CpuAddress = mMappedData + offset;
+		a.GpuAddress = mUploadBuffer->GetGPUVirtualAddress() + offset;
+		a.Offset = offset;
+		a.Size = byteSize;
+		return a;
+	}
+
+	// Constant buffer data, placed and padded to 256 bytes as CBVs require.
+	template<typename T>
+	Allocation AllocateConstants(const T& data)
+	{
+		Allocation a = Allocate(d3dUtil::CalcConstantBufferByteSize(sizeof(T)),
+			D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+		memcpy(a.CpuAddress, &data, sizeof(T));
+		return a;
+	}
+
+	// Room for count elements of a structured buffer bound as a root SRV.
+	template<typename T>
+	Allocation AllocateArray(UINT count)
+	{
+		return Allocate((UINT64)sizeof(T)*count, D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT);
+	}
+
+	void FinishFrame(UINT64 fenceValue)
+	{
+		mAllocator.FinishFrame(fenceValue);
+	}
+
+	void Retire(UINT64 completedFenceValue)
+	{
+		mAllocator.Retire(completedFenceValue);
+	}
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
+	BYTE* mMappedData = nullptr;
+
+	RingAllocator mAllocator;
+};
@@ -0,0 +1,357 @@
+//***************************************************************************************
+// VertexCompression.cpp by DanielDFY
+//***************************************************************************************
+
+#include "VertexCompression.h"
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	template<typename T>
+	T* StridedAt(T* base, UINT stride, UINT i)
+	{
+		return reinterpret_cast<T*>(reinterpret_cast<BYTE*>(base) + (size_t)stride*i);
+	}
+
+	template<typename T>
+	const T* StridedAt(const T* base, UINT stride, UINT i)
+	{
+		return reinterpret_cast<const T*>(reinterpret_cast<const BYTE*>(base) + (size_t)stride*i);
+	}
+
+	// Quantization is done relative to the box corner.  Degenerate (flat) axes
+	// get a tiny extent so we never divide by zero.
+	void GetBoxMinAndSize(const BoundingBox& bounds, XMVECTOR& boxMin, XMVECTOR& boxSize)
+	{
+		XMVECTOR center  = XMLoadFloat3(&bounds.Center);
+		XMVECTOR extents = XMLoadFloat3(&bounds.Extents);
+
+		boxMin  = XMVectorSubtract(center, extents);
+		boxSize = XMVectorMax(XMVectorScale(extents, 2.0f), XMVectorReplicate(1e-6f));
+	}
+
+	// Octahedral mapping of a unit vector onto the [-1,1]^2 square.
+	XMVECTOR OctEncode(FXMVECTOR v)
+	{
+		const XMVECTOR zero = XMVectorZero();
+		const XMVECTOR one  = XMVectorSplatOne();
+
+		// Project onto the octahedron |x|+|y|+|z| = 1.
+		XMVECTOR l1 = XMVector3Dot(XMVectorAbs(v), one);
+		XMVECTOR n  = XMVectorDivide(v, XMVectorMax(l1, XMVectorReplicate(1e-20f)));
+
+		// Fold the lower hemisphere over the diagonals.
+		XMVECTOR signNotNeg = XMVectorSelect(XMVectorNegate(one), one, XMVectorGreaterOrEqual(n, zero));
+		XMVECTOR yx = XMVectorSwizzle<1, 0, 2, 3>(XMVectorAbs(n));
+		XMVECTOR folded = XMVectorMultiply(XMVectorSubtract(one, yx), signNotNeg);
+
+		XMVECTOR lowerHemisphere = XMVectorSplatZ(XMVectorLess(n, zero));
+		return XMVectorSelect(n, folded, lowerHemisphere);
+	}
+
+	XMVECTOR OctDecode(FXMVECTOR e)
+	{
+		const XMVECTOR zero = XMVectorZero();
+		const XMVECTOR one  = XMVectorSplatOne();
+
+		// z = 1 - |x| - |y|
+		XMVECTOR absE = XMVectorAbs(e);
+		XMVECTOR z = XMVectorSubtract(XMVectorSubtract(one, XMVectorSplatX(absE)), XMVectorSplatY(absE));
+
+		// Unfold the lower hemisphere: xy += (xy >= 0) ? -t : t, with t = max(-z, 0).
+		XMVECTOR t = XMVectorMax(XMVectorNegate(z), zero);
+		XMVECTOR offset = XMVectorSelect(t, XMVectorNegate(t), XMVectorGreaterOrEqual(e, zero));
+		XMVECTOR n = XMVectorAdd(e, offset);
+		n = XMVectorPermute<XM_PERMUTE_0X, XM_PERMUTE_0Y, XM_PERMUTE_1Z, XM_PERMUTE_1W>(n, z);
+
+		return XMVector3Normalize(XMVectorSetW(n, 0.0f));
+	}
+
+	// Clamps the 3 stored weights to [0,1] and derives the implied 4th.  If the
+	// stored weights add up to more than 1 they are scaled down to sum to 1, so
+	// the 4 weights always form a partition of unity before quantization.
+	XMVECTOR NormalizeBoneWeights(FXMVECTOR w3)
+	{
+		XMVECTOR w = XMVectorSaturate(XMVectorSetW(w3, 0.0f));
+
+		float sum = XMVectorGetX(XMVector3Dot(w, XMVectorSplatOne()));
+		if(sum > 1.0f)
+			return XMVectorScale(w, 1.0f / sum);
+
+		return XMVectorSetW(w, 1.0f - sum);
+	}
+
+	// atan2 of |a x b| and a.b instead of the acos of the dot product, which
+	// cannot resolve angles below a few hundredths of a degree in float.
+	float AngleBetweenDegrees(FXMVECTOR a, FXMVECTOR b)
+	{
+		float sine = XMVectorGetX(XMVector3Length(XMVector3Cross(a, b)));
+		float cosine = XMVectorGetX(XMVector3Dot(a, b));
+		return XMConvertToDegrees(atan2f(sine, cosine));
+	}
+}
+
+std::wstring VertexCompression::Report::ToString()const
+{
+	std::wostringstream ss;
+	ss << L"vertices: " << VertexCount
+		<< L", bytes: " << SourceByteSize << L" -> " << CompressedByteSize
+		<< L", pos err max/avg: " << MaxPositionError << L"/" << AvgPositionError
+		<< L", normal err max/avg (deg): " << MaxNormalError << L"/" << AvgNormalError
+		<< L", tangent err max (deg): " << MaxTangentError
+		<< L", uv err max: " << MaxTexCError
+		<< L", weight err max: " << MaxBoneWeightError
+		<< L"\n";
+
+	return ss.str();
+}
+
+void VertexCompression::EncodePositions(const XMFLOAT3* src, UINT srcStride, UINT count,
+	const BoundingBox& bounds,
+	XMUSHORTN4* dst, UINT dstStride)
+{
+	XMVECTOR boxMin, boxSize;
+	GetBoxMinAndSize(bounds, boxMin, boxSize);
+	XMVECTOR invSize = XMVectorReciprocal(boxSize);
+
+	for(UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR p = XMLoadFloat3(StridedAt(src, srcStride, i));
+		XMVECTOR q = XMVectorMultiply(XMVectorSubtract(p, boxMin), invSize);
+
+		// XMStoreUShortN4 saturates to [0,1] and rounds to nearest.
+		XMStoreUShortN4(StridedAt(dst, dstStride, i), XMVectorSetW(q, 1.0f));
+	}
+}
+
+void VertexCompression::DecodePositions(const XMUSHORTN4* src, UINT srcStride, UINT count,
+	const BoundingBox& bounds,
+	XMFLOAT3* dst, UINT dstStride)
+{
+	XMVECTOR boxMin, boxSize;
+	GetBoxMinAndSize(bounds, boxMin, boxSize);
+
+	for(UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR q = XMLoadUShortN4(StridedAt(src, srcStride, i));
+		XMStoreFloat3(StridedAt(dst, dstStride, i), XMVectorMultiplyAdd(q, boxSize, boxMin));
+	}
+}
+
+void VertexCompression::EncodeUnitVectors(const XMFLOAT3* src, UINT srcStride, UINT count,
+	XMSHORTN2* dst, UINT dstStride)
+{
+	for(UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR v = XMLoadFloat3(StridedAt(src, srcStride, i));
+		XMStoreShortN2(StridedAt(dst, dstStride, i), OctEncode(v));
+	}
+}
+
+void VertexCompression::DecodeUnitVectors(const XMSHORTN2* src, UINT srcStride, UINT count,
+	XMFLOAT3* dst, UINT dstStride)
+{
+	for(UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR e = XMLoadShortN2(StridedAt(src, srcStride, i));
+		XMStoreFloat3(StridedAt(dst, dstStride, i), OctDecode(e));
+	}
+}
+
+void VertexCompression::EncodeTexCoordsHalf(const XMFLOAT2* src, UINT srcStride, UINT count,
+	XMHALF2* dst, UINT dstStride)
+{
+	for(UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR uv = XMLoadFloat2(StridedAt(src, srcStride, i));
+		XMStoreHalf2(StridedAt(dst, dstStride, i), uv);
+	}
+}
+
+void VertexCompression::DecodeTexCoordsHalf(const XMHALF2* src, UINT srcStride, UINT count,
+	XMFLOAT2* dst, UINT dstStride)
+{
+	for(UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR uv = XMLoadHalf2(StridedAt(src, srcStride, i));
+		XMStoreFloat2(StridedAt(dst, dstStride, i), uv);
+	}
+}
+
+void VertexCompression::EncodeTexCoordsUNorm(const XMFLOAT2* src, UINT srcStride, UINT count,
+	XMUSHORTN2* dst, UINT dstStride)
+{
+	for(UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR uv = XMLoadFloat2(StridedAt(src, srcStride, i));
+		XMStoreUShortN2(StridedAt(dst, dstStride, i), uv);
+	}
+}
+
+void VertexCompression::DecodeTexCoordsUNorm(const XMUSHORTN2* src, UINT srcStride, UINT count,
+	XMFLOAT2* dst, UINT dstStride)
+{
+	for(UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR uv = XMLoadUShortN2(StridedAt(src, srcStride, i));
+		XMStoreFloat2(StridedAt(dst, dstStride, i), uv);
+	}
+}
+
+void VertexCompression::EncodeBoneWeights(const XMFLOAT3* src, UINT srcStride, UINT count,
+	XMUBYTEN4* dst, UINT dstStride)
+{
+	for(UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR w = NormalizeBoneWeights(XMLoadFloat3(StridedAt(src, srcStride, i)));
+
+		XMUBYTEN4* out = StridedAt(dst, dstStride, i);
+		XMStoreUByteN4(out, w);
+
+		// Rounding each weight on its own can leave the sum at 254 or 256.  Give
+		// the difference to the largest weight, where it matters the least.
+		int sum = out->x + out->y + out->z + out->w;
+		if(sum != 255)
+		{
+			uint8_t* c = &out->x;
+			int largest = 0;
+			for(int j = 1; j < 4; ++j)
+			{
+				if(c[j] > c[largest])
+					largest = j;
+			}
+
+			c[largest] = (uint8_t)MathHelper::Clamp(c[largest] + 255 - sum, 0, 255);
+		}
+	}
+}
+
+void VertexCompression::DecodeBoneWeights(const XMUBYTEN4* src, UINT srcStride, UINT count,
+	XMFLOAT3* dst, UINT dstStride)
+{
+	for(UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR w = XMLoadUByteN4(StridedAt(src, srcStride, i));
+		XMStoreFloat3(StridedAt(dst, dstStride, i), w);
+	}
+}
+
+void VertexCompression::MeasurePositions(const XMFLOAT3* src, UINT srcStride, UINT count,
+	const BoundingBox& bounds,
+	const XMUSHORTN4* enc, UINT encStride, Report& report)
+{
+	XMVECTOR boxMin, boxSize;
+	GetBoxMinAndSize(bounds, boxMin, boxSize);
+
+	for(UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR p = XMLoadFloat3(StridedAt(src, srcStride, i));
+		XMVECTOR q = XMLoadUShortN4(StridedAt(enc, encStride, i));
+		XMVECTOR decoded = XMVectorMultiplyAdd(q, boxSize, boxMin);
+
+		float err = XMVectorGetX(XMVector3Length(XMVectorSubtract(p, decoded)));
+		report.MaxPositionError = MathHelper::Max(report.MaxPositionError, err);
+		report.AvgPositionError += err;
+	}
+}
+
+void VertexCompression::MeasureNormals(const XMFLOAT3* src, UINT srcStride, UINT count,
+	const XMSHORTN2* enc, UINT encStride, Report& report)
+{
+	for(UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR n = XMLoadFloat3(StridedAt(src, srcStride, i));
+		XMVECTOR decoded = OctDecode(XMLoadShortN2(StridedAt(enc, encStride, i)));
+
+		float err = AngleBetweenDegrees(n, decoded);
+		report.MaxNormalError = MathHelper::Max(report.MaxNormalError, err);
+		report.AvgNormalError += err;
+	}
+}
+
+void VertexCompression::MeasureTangents(const XMFLOAT3* src, UINT srcStride, UINT count,
+	const XMSHORTN2* enc, UINT encStride, Report& report)
+{
+	for(UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR t = XMLoadFloat3(StridedAt(src, srcStride, i));
+		XMVECTOR decoded = OctDecode(XMLoadShortN2(StridedAt(enc, encStride, i)));
+
+		report.MaxTangentError = MathHelper::Max(report.MaxTangentError, AngleBetweenDegrees(t, decoded));
+	}
+}
+
+void VertexCompression::MeasureTexCoords(const XMFLOAT2* src, UINT srcStride, UINT count,
+	const XMHALF2* enc, UINT encStride, Report& report)
+{
+	for(UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR uv = XMLoadFloat2(StridedAt(src, srcStride, i));
+		XMVECTOR decoded = XMLoadHalf2(StridedAt(enc, encStride, i));
+
+		XMVECTOR diff = XMVectorAbs(XMVectorSubtract(uv, decoded));
+		float err = MathHelper::Max(XMVectorGetX(diff), XMVectorGetY(diff));
+		report.MaxTexCError = MathHelper::Max(report.MaxTexCError, err);
+	}
+}
+
+void VertexCompression::MeasureBoneWeights(const XMFLOAT3* src, UINT srcStride, UINT count,
+	const XMUBYTEN4* enc, UINT encStride, Report& report)
+{
+	for(UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR w = NormalizeBoneWeights(XMLoadFloat3(StridedAt(src, srcStride, i)));
+		XMVECTOR decoded = XMLoadUByteN4(StridedAt(enc, encStride, i));
+
+		XMVECTOR diff = XMVectorAbs(XMVectorSubtract(w, decoded));
+		float err = MathHelper::Max(XMVectorGetX(diff), MathHelper::Max(XMVectorGetY(diff), XMVectorGetZ(diff)));
+		report.MaxBoneWeightError = MathHelper::Max(report.MaxBoneWeightError, err);
+	}
+}
+
+void VertexCompression::GetDequantizeScaleBias(const BoundingBox& bounds, XMFLOAT3& scale, XMFLOAT3& bias)
+{
+	XMVECTOR boxMin, boxSize;
+	GetBoxMinAndSize(bounds, boxMin, boxSize);
+
+	XMStoreFloat3(&scale, boxSize);
+	XMStoreFloat3(&bias, boxMin);
+}
+
+XMMATRIX VertexCompression::GetDequantizeTransform(const BoundingBox& bounds)
+{
+	XMVECTOR boxMin, boxSize;
+	GetBoxMinAndSize(bounds, boxMin, boxSize);
+
+	return XMMatrixScalingFromVector(boxSize) * XMMatrixTranslationFromVector(boxMin);
+}
+
+std::vector<D3D12_INPUT_ELEMENT_DESC> VertexCompression::GetInputLayout()
+{
+	return
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	};
+}
+
+void VertexCompression::BeginReport(Report& report, UINT count, UINT srcStride, UINT dstStride)
+{
+	report = Report();
+	report.VertexCount = count;
+	report.SourceByteSize = count*srcStride;
+	report.CompressedByteSize = count*dstStride;
+}
+
+void VertexCompression::EndReport(Report& report)
+{
+	// The Measure* functions accumulate sums into the average fields.
+	if(report.VertexCount > 0)
+	{
+		report.AvgPositionError /= (float)report.VertexCount;
+		report.AvgNormalError /= (float)report.VertexCount;
+	}
+}
@@ -0,0 +1,171 @@
+//***************************************************************************************
+// VertexCompression.h by DanielDFY
+//
+// A compressed vertex format and CPU encoders/decoders for its attributes.
+//
+//   Position : R16G16B16A16_UNORM, quantized relative to the submesh Bounds.
+//   Normal   : R16G16_SNORM, octahedral encoding.
+//   TangentU : R16G16_SNORM, octahedral encoding.
+//   TexC     : R16G16_FLOAT (or R16G16_UNORM if the UVs are known to be in [0,1]).
+//   Weights  : R8G8B8A8_UNORM, the four weights always sum to exactly 255
+//              (weights that sum above 1 are normalized first).
+//
+// The input assembler converts UNORM/FLOAT formats back to float, so the only
+// shader side changes are:
+//   1. Positions arrive in [0,1]^3 and must be mapped back with the scale/bias
+//      returned by GetDequantizeScaleBias() (or the matrix from
+//      GetDequantizeTransform() premultiplied to the world matrix).
+//   2. Normals/tangents arrive as float2 and must be unfolded:
+//
+//      float3 OctDecode(float2 e)
+//      {
+//          float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+//          float t = saturate(-n.z);
+//          n.xy += n.xy >= 0.0f ? -t : t;
+//          return normalize(n);
+//      }
+//
+// The batch functions work on strided arrays so they can read straight out of
+// the app specific vertex structures.  Each vertex is encoded with DirectXMath
+// vector operations (one vertex per register, not several vertices at once),
+// so they follow whatever instruction set DirectXMath was built for.
+//
+// InstancingAndCullingApp draws its skull from the compressed Vertex format; see
+// its Default.hlsl for the matching decode.  Tangents and bone weights have
+// encoders but no vertex format yet; add one next to Vertex together with the
+// shader decode of the app that needs it.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class VertexCompression
+{
+public:
+
+	// 16 bytes, replaces { XMFLOAT3 Pos; XMFLOAT3 Normal; XMFLOAT2 TexC; } (32 bytes).
+	struct Vertex
+	{
+		DirectX::PackedVector::XMUSHORTN4 Pos;
+		DirectX::PackedVector::XMSHORTN2 Normal;
+		DirectX::PackedVector::XMHALF2 TexC;
+	};
+
+	// Error introduced by the compression of one model.  Position errors are in
+	// the units of the source mesh, angular errors in degrees.
+	struct Report
+	{
+		UINT VertexCount = 0;
+		UINT SourceByteSize = 0;
+		UINT CompressedByteSize = 0;
+
+		float MaxPositionError = 0.0f;
+		float AvgPositionError = 0.0f;
+		float MaxNormalError = 0.0f;
+		float AvgNormalError = 0.0f;
+		float MaxTangentError = 0.0f;
+		float MaxTexCError = 0.0f;
+		float MaxBoneWeightError = 0.0f;
+
+		std::wstring ToString()const;
+	};
+
+	//
+	// Batch encoders/decoders.  Strides are in bytes.
+	//
+
+	static void EncodePositions(const DirectX::XMFLOAT3* src, UINT srcStride, UINT count,
+		const DirectX::BoundingBox& bounds,
+		DirectX::PackedVector::XMUSHORTN4* dst, UINT dstStride);
+	static void DecodePositions(const DirectX::PackedVector::XMUSHORTN4* src, UINT srcStride, UINT count,
+		const DirectX::BoundingBox& bounds,
+		DirectX::XMFLOAT3* dst, UINT dstStride);
+
+	// Used for both normals and tangents.  The input does not need to be normalized.
+	static void EncodeUnitVectors(const DirectX::XMFLOAT3* src, UINT srcStride, UINT count,
+		DirectX::PackedVector::XMSHORTN2* dst, UINT dstStride);
+	static void DecodeUnitVectors(const DirectX::PackedVector::XMSHORTN2* src, UINT srcStride, UINT count,
+		DirectX::XMFLOAT3* dst, UINT dstStride);
+
+	static void EncodeTexCoordsHalf(const DirectX::XMFLOAT2* src, UINT srcStride, UINT count,
+		DirectX::PackedVector::XMHALF2* dst, UINT dstStride);
+	static void DecodeTexCoordsHalf(const DirectX::PackedVector::XMHALF2* src, UINT srcStride, UINT count,
+		DirectX::XMFLOAT2* dst, UINT dstStride);
+
+	// Only valid for UVs in [0,1]; values outside are clamped.
+	static void EncodeTexCoordsUNorm(const DirectX::XMFLOAT2* src, UINT srcStride, UINT count,
+		DirectX::PackedVector::XMUSHORTN2* dst, UINT dstStride);
+	static void DecodeTexCoordsUNorm(const DirectX::PackedVector::XMUSHORTN2* src, UINT srcStride, UINT count,
+		DirectX::XMFLOAT2* dst, UINT dstStride);
+
+	// The source stores 3 weights, the 4th is implied as 1-w0-w1-w2 (as in the .m3d format).
+	// Weights summing to more than 1 are scaled to sum to 1 and the 4th is then 0.
+	static void EncodeBoneWeights(const DirectX::XMFLOAT3* src, UINT srcStride, UINT count,
+		DirectX::PackedVector::XMUBYTEN4* dst, UINT dstStride);
+	static void DecodeBoneWeights(const DirectX::PackedVector::XMUBYTEN4* src, UINT srcStride, UINT count,
+		DirectX::XMFLOAT3* dst, UINT dstStride);
+
+	//
+	// Error measurement.  Each function decodes the compressed stream and
+	// accumulates the difference to the source into the report.
+	//
+
+	static void MeasurePositions(const DirectX::XMFLOAT3* src, UINT srcStride, UINT count,
+		const DirectX::BoundingBox& bounds,
+		const DirectX::PackedVector::XMUSHORTN4* enc, UINT encStride, Report& report);
+	static void MeasureNormals(const DirectX::XMFLOAT3* src, UINT srcStride, UINT count,
+		const DirectX::PackedVector::XMSHORTN2* enc, UINT encStride, Report& report);
+	static void MeasureTangents(const DirectX::XMFLOAT3* src, UINT srcStride, UINT count,
+		const DirectX::PackedVector::XMSHORTN2* enc, UINT encStride, Report& report);
+	static void MeasureTexCoords(const DirectX::XMFLOAT2* src, UINT srcStride, UINT count,
+		const DirectX::PackedVector::XMHALF2* enc, UINT encStride, Report& report);
+	static void MeasureBoneWeights(const DirectX::XMFLOAT3* src, UINT srcStride, UINT count,
+		const DirectX::PackedVector::XMUBYTEN4* enc, UINT encStride, Report& report);
+
+	//
+	// Whole vertex compression.  VertexT must have Pos, Normal and TexC members,
+	// which is the case for the Vertex structures of the demos and M3DLoader.
+	//
+
+	template<typename VertexT>
+	static void Compress(const VertexT* src, UINT count, const DirectX::BoundingBox& bounds,
+		Vertex* dst, Report* report = nullptr)
+	{
+		const UINT ss = sizeof(VertexT);
+		const UINT ds = sizeof(Vertex);
+		EncodePositions(&src->Pos, ss, count, bounds, &dst->Pos, ds);
+		EncodeUnitVectors(&src->Normal, ss, count, &dst->Normal, ds);
+		EncodeTexCoordsHalf(&src->TexC, ss, count, &dst->TexC, ds);
+
+		if(report != nullptr)
+		{
+			BeginReport(*report, count, ss, ds);
+			MeasurePositions(&src->Pos, ss, count, bounds, &dst->Pos, ds, *report);
+			MeasureNormals(&src->Normal, ss, count, &dst->Normal, ds, *report);
+			MeasureTexCoords(&src->TexC, ss, count, &dst->TexC, ds, *report);
+			EndReport(*report);
+		}
+	}
+
+	//
+	// Position dequantization: posL = q*scale + bias, where q is in [0,1]^3.
+	//
+
+	static void GetDequantizeScaleBias(const DirectX::BoundingBox& bounds,
+		DirectX::XMFLOAT3& scale, DirectX::XMFLOAT3& bias);
+
+	// Only apply this to positions.  The scale is non-uniform in general, so
+	// normals must keep using the original world matrix.
+	static DirectX::XMMATRIX GetDequantizeTransform(const DirectX::BoundingBox& bounds);
+
+	//
+	// Input layout matching Vertex.
+	//
+
+	static std::vector<D3D12_INPUT_ELEMENT_DESC> GetInputLayout();
+
+private:
+	static void BeginReport(Report& report, UINT count, UINT srcStride, UINT dstStride);
+	static void EndReport(Report& report);
+};
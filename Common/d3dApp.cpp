@@ -29,6 +29,10 @@ D3DApp::D3DApp(HINSTANCE hInstance)
     // Only one D3DApp can be constructed.
     assert(mApp == nullptr);
     mApp = this;
+
+    mUpdateStage = mFrameStats.AddStage("Update");
+    mDrawStage = mFrameStats.AddStage("Draw");
+    mTimer.SetFrameStatistics(&mFrameStats);
 }
 
 D3DApp::~D3DApp()
@@ -75,6 +79,8 @@ int D3DApp::Run()
  
 	mTimer.Reset();
 
+	Profiler::Get().SetThreadName("Main");
+
 	while(msg.message != WM_QUIT)
 	{
 		// If there are Window messages then process them.
@@ -90,9 +96,29 @@ int D3DApp::Run()
 
 			if( !mAppPaused )
 			{
+				if(!BeginInputFrame())
+				{
+					// The replay is over; keep its frame times for comparison.
+					SaveFrameStats();
+					PostQuitMessage(0);
+					continue;
+				}
+
+				PROFILE_SCOPE("Frame");
+
 				CalculateFrameStats();
-				Update(mTimer);	
-                Draw(mTimer);
+				{
+					PROFILE_SCOPE("Update");
+					FrameStatistics::ScopedStage stage(mFrameStats, mUpdateStage);
+					Update(mTimer);
+				}
+				{
+					PROFILE_SCOPE("Draw");
+					FrameStatistics::ScopedStage stage(mFrameStats, mDrawStage);
+					Draw(mTimer);
+				}
+
+				EndInputFrame();
 			}
 			else
 			{
@@ -101,11 +127,24 @@ int D3DApp::Run()
         }
     }
 
+	if(mInputMode == InputMode::Record)
+	{
+		InputLog::Status status = mInputLog.Save(mInputLogFile);
+		if(status != InputLog::Status::Ok)
+		{
+			std::string text = "Could not write " + mInputLogFile + ": " + InputLog::StatusToString(status) + "\n";
+			OutputDebugStringA(text.c_str());
+		}
+	}
+
 	return (int)msg.wParam;
 }
 
 bool D3DApp::Initialize()
 {
+	if(!InitInputLog())
+		return false;
+
 	if(!InitMainWindow())
 		return false;
 
@@ -348,15 +387,15 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	case WM_LBUTTONDOWN:
 	case WM_MBUTTONDOWN:
 	case WM_RBUTTONDOWN:
-		OnMouseDown(wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+		HandleMouseMessage(InputLog::EventType::MouseDown, wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
 		return 0;
 	case WM_LBUTTONUP:
 	case WM_MBUTTONUP:
 	case WM_RBUTTONUP:
-		OnMouseUp(wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+		HandleMouseMessage(InputLog::EventType::MouseUp, wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
 		return 0;
 	case WM_MOUSEMOVE:
-		OnMouseMove(wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+		HandleMouseMessage(InputLog::EventType::MouseMove, wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
 		return 0;
     case WM_KEYUP:
         if(wParam == VK_ESCAPE)
@@ -365,6 +404,10 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         }
         else if((int)wParam == VK_F2)
             Set4xMsaaState(!m4xMsaaState);
+        else if((int)wParam == VK_F3)
+            SaveProfile();
+        else if((int)wParam == VK_F4)
+            SaveFrameStats();
 
         return 0;
 	}
@@ -577,7 +620,9 @@ void D3DApp::CalculateFrameStats()
 {
 	// Code computes the average frames per second, and also the 
 	// average time it takes to render one frame.  These stats 
-	// are appended to the window caption bar.
+	// are appended to the window caption bar, together with the
+	// 99th percentile and worst frame time of the recent frames,
+	// which show the hitches the average hides.
     
 	static int frameCnt = 0;
 	static float timeElapsed = 0.0f;
@@ -593,9 +638,13 @@ void D3DApp::CalculateFrameStats()
         wstring fpsStr = to_wstring(fps);
         wstring mspfStr = to_wstring(mspf);
 
+        FrameStatistics::Summary recent = mFrameStats.GetSummary();
+
         wstring windowText = mMainWndCaption +
             L"    fps: " + fpsStr +
-            L"   mspf: " + mspfStr;
+            L"   mspf: " + mspfStr +
+            L"   p99: " + to_wstring(recent.P99Milliseconds) +
+            L"   max: " + to_wstring(recent.MaxMilliseconds);
 
         SetWindowText(mhMainWnd, windowText.c_str());
 		
@@ -605,6 +654,151 @@ void D3DApp::CalculateFrameStats()
 	}
 }
 
+void D3DApp::SaveProfile()
+{
+    if(!Profiler::Get().WriteChromeTrace("profile.json"))
+        OutputDebugString(L"Could not write profile.json\n");
+
+    OutputDebugStringA(Profiler::Get().ReportToString().c_str());
+}
+
+void D3DApp::SaveFrameStats()
+{
+    if(!mFrameStats.WriteCsv("frame_stats.csv") || !mFrameStats.WriteJson("frame_stats.json"))
+        OutputDebugString(L"Could not write frame_stats.csv/json\n");
+
+    std::string text = "Frame times: " + mFrameStats.SummaryToString() + "\n";
+    OutputDebugStringA(text.c_str());
+}
+
+bool D3DApp::IsKeyDown(int key)
+{
+	key &= 0xff;
+
+	if(mInputMode != InputMode::Replay)
+	{
+		bool down = (GetAsyncKeyState(key) & 0x8000) != 0;
+		if(mInputMode == InputMode::Record && down != mKeyDown[key])
+			mInputLog.AddEvent(InputLog::KeyEvent(key, down));
+
+		mKeyDown[key] = down;
+	}
+
+	return mKeyDown[key];
+}
+
+bool D3DApp::InitInputLog()
+{
+	for(int i = 1; i + 1 < __argc; ++i)
+	{
+		if(strcmp(__argv[i], "-record") == 0)
+		{
+			mInputMode = InputMode::Record;
+			mInputLogFile = __argv[++i];
+		}
+		else if(strcmp(__argv[i], "-replay") == 0)
+		{
+			mInputMode = InputMode::Replay;
+			mInputLogFile = __argv[++i];
+		}
+		else if(strcmp(__argv[i], "-fixedstep") == 0)
+		{
+			mFixedStep = (float)atof(__argv[++i]);
+		}
+	}
+
+	if(mInputMode == InputMode::Replay)
+	{
+		InputLog::Status status = mInputLog.Load(mInputLogFile);
+		if(status != InputLog::Status::Ok)
+		{
+			std::string text = "Could not read " + mInputLogFile + ": " + InputLog::StatusToString(status);
+			MessageBoxA(0, text.c_str(), 0, 0);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool D3DApp::BeginInputFrame()
+{
+	float dt = mTimer.DeltaTime();
+
+	if(mInputMode == InputMode::Replay)
+	{
+		if(mReplayFrame == mInputLog.FrameCount())
+			return false;
+
+		const InputLog::Frame& frame = mInputLog.GetFrame(mReplayFrame);
+		dt = frame.DeltaTime;
+
+		// Key changes were seen while polling in Update, so they apply from
+		// the start of the frame.
+		for(std::uint32_t i = 0; i < frame.EventCount; ++i)
+		{
+			const InputLog::Event& e = mInputLog.GetEvent(frame.FirstEvent + i);
+			if(e.Type == InputLog::EventType::KeyDown || e.Type == InputLog::EventType::KeyUp)
+				mKeyDown[e.Code] = e.Type == InputLog::EventType::KeyDown;
+		}
+	}
+
+	if(mFixedStep > 0.0f)
+		dt = mFixedStep;
+
+	if(mInputMode == InputMode::Record)
+		mInputLog.BeginFrame(dt);
+
+	// The total time is the sum of the frame times, both when recording and
+	// replaying, so the app sees the same times in both.
+	if(mInputMode != InputMode::Live || mFixedStep > 0.0f)
+	{
+		mInputTotalTime += dt;
+		mTimer.Override((float)mInputTotalTime, dt);
+	}
+
+	return true;
+}
+
+void D3DApp::EndInputFrame()
+{
+	if(mInputMode != InputMode::Replay)
+		return;
+
+	// Mouse messages arrived after the frame's Draw.
+	const InputLog::Frame& frame = mInputLog.GetFrame(mReplayFrame);
+	for(std::uint32_t i = 0; i < frame.EventCount; ++i)
+	{
+		const InputLog::Event& e = mInputLog.GetEvent(frame.FirstEvent + i);
+		DispatchMouseEvent(e.Type, e.Code, e.X, e.Y);
+	}
+
+	mReplayFrame++;
+}
+
+void D3DApp::HandleMouseMessage(InputLog::EventType type, WPARAM btnState, int x, int y)
+{
+	// The live mouse is ignored while replaying.
+	if(mInputMode == InputMode::Replay)
+		return;
+
+	if(mInputMode == InputMode::Record)
+		mInputLog.AddEvent(InputLog::MouseEvent(type, (std::uint32_t)btnState, x, y));
+
+	DispatchMouseEvent(type, btnState, x, y);
+}
+
+void D3DApp::DispatchMouseEvent(InputLog::EventType type, WPARAM btnState, int x, int y)
+{
+	switch(type)
+	{
+	case InputLog::EventType::MouseDown: OnMouseDown(btnState, x, y); break;
+	case InputLog::EventType::MouseUp:   OnMouseUp(btnState, x, y);   break;
+	case InputLog::EventType::MouseMove: OnMouseMove(btnState, x, y); break;
+	default: break;
+	}
+}
+
 void D3DApp::LogAdapters()
 {
     UINT i = 0;
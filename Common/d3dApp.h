@@ -11,6 +11,9 @@
 
 #include "d3dUtil.h"
 #include "GameTimer.h"
+#include "Profiler.h"
+#include "FrameStatistics.h"
+#include "InputLog.h"
 
 // Link necessary d3d12 libraries.
 #pragma comment(lib,"d3dcompiler.lib")
@@ -53,6 +56,10 @@ protected:
 	virtual void OnMouseUp(WPARAM btnState, int x, int y)  { }
 	virtual void OnMouseMove(WPARAM btnState, int x, int y){ }
 
+	// Use instead of GetAsyncKeyState(key) & 0x8000, so the key is recorded
+	// and replayed with the rest of the input.
+	bool IsKeyDown(int key);
+
 protected:
 
 	bool InitMainWindow();
@@ -68,6 +75,20 @@ protected:
 
 	void CalculateFrameStats();
 
+    // Writes profile.json (Chrome trace) and the per-scope times to the debugger output.
+    void SaveProfile();
+
+    // Writes frame_stats.csv (every recorded frame) and frame_stats.json (percentiles).
+    void SaveFrameStats();
+
+    // Input record/replay, see InputLog.h.  BeginInputFrame returns false once
+    // a replay has run out of frames.
+    bool InitInputLog();
+    bool BeginInputFrame();
+    void EndInputFrame();
+    void HandleMouseMessage(InputLog::EventType type, WPARAM btnState, int x, int y);
+    void DispatchMouseEvent(InputLog::EventType type, WPARAM btnState, int x, int y);
+
     void LogAdapters();
     void LogAdapterOutputs(IDXGIAdapter* adapter);
     void LogOutputDisplayModes(IDXGIOutput* output, DXGI_FORMAT format);
@@ -90,6 +111,24 @@ protected:
 
 	// Used to keep track of the "delta-time" and game time (4.4).
 	GameTimer mTimer;
+
+	// Frame times fed by mTimer.Tick, with the Update and Draw stages.
+	FrameStatistics mFrameStats;
+	std::uint32_t mUpdateStage = 0;
+	std::uint32_t mDrawStage = 0;
+
+	// From the command line: "-record file" saves the input and frame times
+	// when the app quits; "-replay file" plays them back instead of the live
+	// input and clock, then saves the frame statistics and quits; "-fixedstep
+	// seconds" replaces the frame times with a fixed step.
+	enum class InputMode { Live, Record, Replay };
+	InputMode mInputMode = InputMode::Live;
+	InputLog mInputLog;
+	std::string mInputLogFile;
+	std::uint32_t mReplayFrame = 0;
+	double mInputTotalTime = 0.0;
+	float mFixedStep = 0.0f;
+	bool mKeyDown[256] = {};
 	
     Microsoft::WRL::ComPtr<IDXGIFactory4> mdxgiFactory;
     Microsoft::WRL::ComPtr<IDXGISwapChain> mSwapChain;
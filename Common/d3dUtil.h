@@ -28,6 +28,7 @@
 #include "d3dx12.h"
 #include "DDSTextureLoader.h"
 #include "MathHelper.h"
+#include "BoundsFitting.h"
 
 extern const int gNumFrameResources;
 
@@ -155,6 +156,10 @@ struct SubmeshGeometry
     // Bounding box of the geometry defined by this submesh. 
     // This is used in later chapters of the book.
 	DirectX::BoundingBox Bounds;
+
+	// Tightest of sphere/box/oriented box fitted to the vertices by
+	// BoundsFitting::Fit.  Only set by the demos that cull or pick against it.
+	BoundingVolume TightBounds;
 };
 
 struct MeshGeometry
@@ -250,6 +255,10 @@ struct Material
 	// Index into SRV heap for normal texture.
 	int NormalSrvHeapIndex = -1;
 
+	// TextureStreamer id of the diffuse texture, for the demos that stream it
+	// instead of giving it a fixed SRV heap slot (~0u if not streamed).
+	UINT DiffuseStreamedTexture = ~0u;
+
 	// Dirty flag indicating the material has changed and we need to update the constant buffer.
 	// Because we have a material constant buffer for each FrameResource, we have to apply the
 	// update to each FrameResource.  Thus, when we modify a material we should set 
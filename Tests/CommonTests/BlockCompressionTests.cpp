@@ -0,0 +1,311 @@
+//***************************************************************************************
+// BlockCompressionTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/BlockCompression.h"
+#include "../../Common/Random.h"
+#include "../../Common/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace
+{
+	typedef BlockCompression::Format Format;
+	typedef BlockCompression::Quality Quality;
+
+	// A straight transcription of the D3D block compression rules, written
+	// independently of BlockCompression so its encoder can be checked against
+	// something other than its own decoder.  Palette entries are computed at
+	// full precision and rounded; hardware may differ by one step.
+	namespace Reference
+	{
+		std::uint32_t Bits(const std::uint8_t* bytes, std::uint32_t first, std::uint32_t count)
+		{
+			std::uint32_t value = 0;
+			for(std::uint32_t i = 0; i < count; ++i)
+			{
+				std::uint32_t bit = first + i;
+				value |= ((bytes[bit / 8] >> (bit % 8)) & 1u) << i;
+			}
+			return value;
+		}
+
+		std::uint8_t Lerp(std::uint32_t a, std::uint32_t b, std::uint32_t weightB, std::uint32_t denominator)
+		{
+			return (std::uint8_t)std::floor(((double)a * (denominator - weightB) + (double)b * weightB) / denominator + 0.5);
+		}
+
+		void DecodeColor(const std::uint8_t* block, bool alwaysFourColor, std::uint8_t rgba[64])
+		{
+			std::uint32_t c[2] = { Bits(block, 0, 16), Bits(block, 16, 16) };
+
+			std::uint8_t palette[4][4];
+			for(int i = 0; i < 2; ++i)
+			{
+				std::uint32_t r = c[i] >> 11, g = (c[i] >> 5) & 63, b = c[i] & 31;
+				palette[i][0] = (std::uint8_t)(r << 3 | r >> 2);
+				palette[i][1] = (std::uint8_t)(g << 2 | g >> 4);
+				palette[i][2] = (std::uint8_t)(b << 3 | b >> 2);
+				palette[i][3] = 255;
+			}
+
+			bool fourColor = alwaysFourColor || c[0] > c[1];
+			for(int ch = 0; ch < 3; ++ch)
+			{
+				if(fourColor)
+				{
+					palette[2][ch] = Lerp(palette[0][ch], palette[1][ch], 1, 3);
+					palette[3][ch] = Lerp(palette[0][ch], palette[1][ch], 2, 3);
+				}
+				else
+				{
+					palette[2][ch] = Lerp(palette[0][ch], palette[1][ch], 1, 2);
+					palette[3][ch] = 0;
+				}
+			}
+			palette[2][3] = 255;
+			palette[3][3] = fourColor ? 255 : 0;
+
+			for(std::uint32_t t = 0; t < 16; ++t)
+			{
+				std::uint32_t index = Bits(block, 32 + 2 * t, 2);
+				for(int ch = 0; ch < 4; ++ch)
+					rgba[4 * t + ch] = palette[index][ch];
+			}
+		}
+
+		void DecodeChannel(const std::uint8_t* block, std::uint8_t rgba[64], int channel)
+		{
+			std::uint32_t r0 = block[0], r1 = block[1];
+
+			std::uint8_t palette[8] = { (std::uint8_t)r0, (std::uint8_t)r1 };
+			if(r0 > r1)
+			{
+				for(std::uint32_t i = 1; i <= 6; ++i)
+					palette[i + 1] = Lerp(r0, r1, i, 7);
+			}
+			else
+			{
+				for(std::uint32_t i = 1; i <= 4; ++i)
+					palette[i + 1] = Lerp(r0, r1, i, 5);
+				palette[6] = 0;
+				palette[7] = 255;
+			}
+
+			for(std::uint32_t t = 0; t < 16; ++t)
+				rgba[4 * t + channel] = palette[Bits(block, 16 + 3 * t, 3)];
+		}
+
+		void DecodeBlock(Format format, const std::uint8_t* block, std::uint8_t rgba[64])
+		{
+			for(std::uint32_t t = 0; t < 16; ++t)
+			{
+				rgba[4 * t + 0] = rgba[4 * t + 1] = rgba[4 * t + 2] = 0;
+				rgba[4 * t + 3] = 255;
+			}
+
+			switch(format)
+			{
+			case Format::BC1: DecodeColor(block, false, rgba); break;
+			case Format::BC3: DecodeColor(block + 8, true, rgba); DecodeChannel(block, rgba, 3); break;
+			case Format::BC4: DecodeChannel(block, rgba, 0); break;
+			case Format::BC5: DecodeChannel(block, rgba, 0); DecodeChannel(block + 8, rgba, 1); break;
+			}
+		}
+	}
+
+	const Format AllFormats[] = { Format::BC1, Format::BC3, Format::BC4, Format::BC5 };
+	const Quality AllQualities[] = { Quality::Fast, Quality::Normal, Quality::High };
+
+	// Smooth gradients with some noise, like most texture content; alpha is
+	// a ramp so that BC1 gets transparent texels.
+	std::vector<std::uint8_t> MakeImage(std::uint32_t width, std::uint32_t height, std::uint64_t seed)
+	{
+		Random random(seed);
+		std::vector<std::uint8_t> rgba((size_t)width * height * 4);
+		for(std::uint32_t y = 0; y < height; ++y)
+		{
+			for(std::uint32_t x = 0; x < width; ++x)
+			{
+				std::uint8_t* t = &rgba[((size_t)y * width + x) * 4];
+				float u = (float)x / width, v = (float)y / height;
+				t[0] = (std::uint8_t)(255.0f * u * (0.9f + 0.1f * random.NextFloat()));
+				t[1] = (std::uint8_t)(255.0f * v * (0.9f + 0.1f * random.NextFloat()));
+				t[2] = (std::uint8_t)(127.5f + 127.5f * std::sin(6.0f * (u + v)));
+				t[3] = (std::uint8_t)(255.0f * (1.0f - u));
+			}
+		}
+		return rgba;
+	}
+
+	// The reference decode of a whole image of blocks.
+	std::vector<std::uint8_t> ReferenceDecode(Format format, const std::vector<std::uint8_t>& blocks,
+		std::uint32_t width, std::uint32_t height)
+	{
+		std::uint32_t blockBytes = BlockCompression::BlockBytes(format);
+		std::uint32_t blocksWide = width / 4;
+
+		std::vector<std::uint8_t> rgba((size_t)width * height * 4);
+		for(std::uint32_t by = 0; by < height / 4; ++by)
+		{
+			for(std::uint32_t bx = 0; bx < blocksWide; ++bx)
+			{
+				std::uint8_t texels[64];
+				Reference::DecodeBlock(format, &blocks[((size_t)by * blocksWide + bx) * blockBytes], texels);
+				for(std::uint32_t t = 0; t < 16; ++t)
+				{
+					std::uint8_t* out = &rgba[((size_t)(by * 4 + t / 4) * width + bx * 4 + t % 4) * 4];
+					for(int ch = 0; ch < 4; ++ch)
+						out[ch] = texels[4 * t + ch];
+				}
+			}
+		}
+		return rgba;
+	}
+
+	int MaxDifference(const std::uint8_t* a, const std::uint8_t* b, size_t bytes)
+	{
+		int diff = 0;
+		for(size_t i = 0; i < bytes; ++i)
+			diff = std::max(diff, std::abs((int)a[i] - (int)b[i]));
+		return diff;
+	}
+}
+
+TEST(BlockCompression, DecoderMatchesReference)
+{
+	// Random bytes reach every mode: both endpoint orders for BC1 and both
+	// value counts for the channels.
+	Random random(44);
+	for(Format format : AllFormats)
+	{
+		int worst = 0;
+		for(int i = 0; i < 20000; ++i)
+		{
+			std::uint8_t block[16];
+			for(std::uint8_t& b : block)
+				b = (std::uint8_t)random.NextUInt(256);
+
+			std::uint8_t actual[64], expected[64];
+			BlockCompression::DecodeBlock(format, block, actual);
+			Reference::DecodeBlock(format, block, expected);
+			worst = std::max(worst, MaxDifference(actual, expected, 64));
+		}
+		CHECK(worst <= 1);
+	}
+}
+
+TEST(BlockCompression, RoundTripThroughReference)
+{
+	const std::uint32_t width = 64, height = 64;
+	std::vector<std::uint8_t> source = MakeImage(width, height, 44);
+	ThreadPool pool(3);
+
+	// Floors in dB for the gradient image, well under what each format gets.
+	const double minimumPsnr[] = { 30.0, 30.0, 40.0, 40.0 };
+
+	for(int f = 0; f < 4; ++f)
+	{
+		Format format = AllFormats[f];
+		std::uint32_t blockBytes = BlockCompression::BlockBytes(format);
+		std::uint64_t blockRowPitch = (std::uint64_t)width / 4 * blockBytes;
+
+		double previousPsnr = 0.0;
+		for(Quality quality : AllQualities)
+		{
+			std::vector<std::uint8_t> blocks((size_t)(blockRowPitch * height / 4));
+			BlockCompression::Encode(format, quality, source.data(), width, height, width * 4,
+				blocks.data(), blockRowPitch, &pool);
+
+			std::vector<std::uint8_t> expected = ReferenceDecode(format, blocks, width, height);
+
+			std::vector<std::uint8_t> decoded(source.size());
+			BlockCompression::Decode(format, blocks.data(), blockRowPitch, width, height,
+				decoded.data(), width * 4, &pool);
+			CHECK(MaxDifference(decoded.data(), expected.data(), decoded.size()) <= 1);
+
+			// The quality the encoder promises holds for what a decoder that is
+			// not its own reads back.  BC1 is compared on the texels it keeps
+			// opaque, since transparent ones read back as black.
+			if(format == Format::BC1)
+			{
+				for(size_t i = 0; i < source.size(); i += 4)
+				{
+					CHECK((source[i + 3] < 128) == (expected[i + 3] == 0));
+					if(expected[i + 3] == 0)
+					{
+						CHECK(expected[i] == 0 && expected[i + 1] == 0 && expected[i + 2] == 0);
+						std::copy(&source[i], &source[i + 3], &expected[i]);
+					}
+				}
+			}
+
+			double psnr = BlockCompression::Psnr(format, source.data(), width * 4,
+				expected.data(), width * 4, width, height);
+			CHECK(psnr >= minimumPsnr[f]);
+			CHECK(psnr >= previousPsnr - 0.25);
+			previousPsnr = psnr;
+		}
+	}
+}
+
+TEST(BlockCompression, ExactValues)
+{
+	// A color on the 5:6:5 grid (30, 32 and 5 expanded to 8 bits) and an alpha
+	// with at most eight values survive exactly.
+	std::uint8_t texels[64];
+	for(std::uint32_t t = 0; t < 16; ++t)
+	{
+		texels[4 * t + 0] = 0xF7;
+		texels[4 * t + 1] = 0x82;
+		texels[4 * t + 2] = 0x29;
+		texels[4 * t + 3] = t < 8 ? 200 : 10;
+	}
+
+	for(Quality quality : AllQualities)
+	{
+		std::uint8_t block[16], decoded[64];
+
+		BlockCompression::EncodeBlock(Format::BC3, quality, texels, block);
+		Reference::DecodeBlock(Format::BC3, block, decoded);
+		CHECK(MaxDifference(texels, decoded, 64) == 0);
+
+		// 0 and 255 with values between need the 6 value mode to be exact
+		// at the ends.
+		std::uint8_t ends[64];
+		for(std::uint32_t t = 0; t < 16; ++t)
+			ends[4 * t] = t == 0 ? 0 : t == 15 ? 255 : (std::uint8_t)(100 + t);
+		BlockCompression::EncodeBlock(Format::BC4, quality, ends, block);
+		Reference::DecodeBlock(Format::BC4, block, decoded);
+		if(quality != Quality::Fast)
+			CHECK(decoded[0] == 0 && decoded[60] == 255);
+	}
+}
+
+BENCHMARK(BlockCompression, Encode)
+{
+	const std::uint32_t size = 256;
+	std::vector<std::uint8_t> source = MakeImage(size, size, 44);
+	std::vector<std::uint8_t> blocks((size_t)size * size);
+
+	const char* formats[] = { "BC1", "BC3", "BC4", "BC5" };
+	const char* qualities[] = { "Fast", "Normal", "High" };
+	for(int f = 0; f < 4; ++f)
+	{
+		Format format = AllFormats[f];
+		std::uint64_t blockRowPitch = (std::uint64_t)size / 4 * BlockCompression::BlockBytes(format);
+		for(int q = 0; q < 3; ++q)
+		{
+			std::string label = std::string(formats[f]) + " " + qualities[q] + ", 256x256 on one thread";
+			bench.Run(label.c_str(), [&]()
+			{
+				BlockCompression::Encode(format, AllQualities[q], source.data(), size, size, size * 4,
+					blocks.data(), blockRowPitch);
+			});
+		}
+	}
+}
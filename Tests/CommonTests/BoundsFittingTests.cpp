@@ -0,0 +1,344 @@
+//***************************************************************************************
+// BoundsFittingTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/BoundsFitting.h"
+#include "../../Common/MathHelper.h"
+#include "../../Common/Random.h"
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	struct Cloud
+	{
+		const char* Name;
+		std::vector<XMFLOAT3> Points;
+	};
+
+	// Uniform in a box of the given half extents, rotated by (pitch, yaw, roll)
+	// and moved to center.
+	std::vector<XMFLOAT3> BoxCloud(Random& random, std::uint32_t count, XMFLOAT3 extents,
+		float pitch, float yaw, float roll, XMFLOAT3 center)
+	{
+		XMVECTOR q = XMQuaternionRotationRollPitchYaw(pitch, yaw, roll);
+		XMVECTOR c = XMLoadFloat3(&center);
+
+		std::vector<XMFLOAT3> points(count);
+		for(XMFLOAT3& p : points)
+		{
+			XMVECTOR local = XMVectorSet(random.NextFloat(-extents.x, extents.x),
+				random.NextFloat(-extents.y, extents.y), random.NextFloat(-extents.z, extents.z), 0.0f);
+			XMStoreFloat3(&p, XMVectorAdd(XMVector3Rotate(local, q), c));
+		}
+
+		return points;
+	}
+
+	// On the surface of a sphere, where the sphere is the tightest volume.
+	std::vector<XMFLOAT3> SphereCloud(Random& random, std::uint32_t count, float radius, XMFLOAT3 center)
+	{
+		std::vector<XMFLOAT3> points;
+		while(points.size() < count)
+		{
+			XMVECTOR v = XMVectorSet(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), 0.0f);
+			float lengthSq = XMVectorGetX(XMVector3LengthSq(v));
+			if(lengthSq < 1e-4f || lengthSq > 1.0f)
+				continue;
+
+			XMFLOAT3 p;
+			XMStoreFloat3(&p, XMVectorAdd(XMVectorScale(XMVector3Normalize(v), radius), XMLoadFloat3(&center)));
+			points.push_back(p);
+		}
+
+		return points;
+	}
+
+	// Same file the skull demos read; empty if it is not there.
+	std::vector<XMFLOAT3> SkullCloud()
+	{
+		std::vector<XMFLOAT3> points;
+		std::ifstream fin("../../Models/skull.txt");
+		if(!fin)
+		{
+			TestFramework::Fail(__FILE__, __LINE__, "../../Models/skull.txt not found");
+			return points;
+		}
+
+		std::uint32_t vcount = 0;
+		std::string ignore;
+		fin >> ignore >> vcount;
+		fin >> ignore >> ignore;
+		fin >> ignore >> ignore >> ignore >> ignore;
+
+		points.resize(vcount);
+		for(XMFLOAT3& p : points)
+		{
+			XMFLOAT3 normal;
+			fin >> p.x >> p.y >> p.z;
+			fin >> normal.x >> normal.y >> normal.z;
+		}
+
+		return points;
+	}
+
+	std::vector<Cloud> Clouds()
+	{
+		Random random(28);
+
+		std::vector<Cloud> clouds;
+		clouds.push_back({ "axis aligned box", BoxCloud(random, 2000, XMFLOAT3(3.0f, 1.0f, 2.0f), 0.0f, 0.0f, 0.0f, XMFLOAT3(5.0f, -2.0f, 1.0f)) });
+		clouds.push_back({ "rotated rod", BoxCloud(random, 2000, XMFLOAT3(10.0f, 0.5f, 0.5f), 0.6f, 0.8f, 0.3f, XMFLOAT3(0.0f, 4.0f, -3.0f)) });
+		clouds.push_back({ "rotated slab", BoxCloud(random, 2000, XMFLOAT3(4.0f, 4.0f, 0.1f), -0.4f, 1.1f, 0.7f, XMFLOAT3(-2.0f, 0.0f, 0.0f)) });
+		clouds.push_back({ "sphere", SphereCloud(random, 2000, 2.5f, XMFLOAT3(1.0f, 2.0f, 3.0f)) });
+		clouds.push_back({ "skull", SkullCloud() });
+
+		// Degenerate sets: one point, two points, a line and a plane.
+		clouds.push_back({ "point", { XMFLOAT3(1.0f, 2.0f, 3.0f) } });
+		clouds.push_back({ "pair", { XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT3(3.0f, 0.0f, 0.0f) } });
+		clouds.push_back({ "line", { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), XMFLOAT3(2.0f, 2.0f, 2.0f), XMFLOAT3(5.0f, 5.0f, 5.0f) } });
+		clouds.push_back({ "plane", BoxCloud(random, 200, XMFLOAT3(2.0f, 3.0f, 0.0f), 0.3f, 0.2f, 0.0f, XMFLOAT3(0.0f, 0.0f, 0.0f)) });
+
+		return clouds;
+	}
+
+	// Points sit on the surfaces, so allow for round off relative to the size.
+	float Tolerance(float size)
+	{
+		return 1e-5f*size + 1e-5f;
+	}
+
+	bool SphereContains(const BoundingSphere& s, const XMFLOAT3& p)
+	{
+		float dist = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&p), XMLoadFloat3(&s.Center))));
+		return dist <= s.Radius + Tolerance(s.Radius);
+	}
+
+	bool BoxContains(const BoundingBox& b, const XMFLOAT3& p)
+	{
+		return fabsf(p.x - b.Center.x) <= b.Extents.x + Tolerance(b.Extents.x) &&
+			fabsf(p.y - b.Center.y) <= b.Extents.y + Tolerance(b.Extents.y) &&
+			fabsf(p.z - b.Center.z) <= b.Extents.z + Tolerance(b.Extents.z);
+	}
+
+	bool OrientedBoxContains(const BoundingOrientedBox& b, const XMFLOAT3& p)
+	{
+		XMVECTOR d = XMVectorSubtract(XMLoadFloat3(&p), XMLoadFloat3(&b.Center));
+		XMFLOAT3 local;
+		XMStoreFloat3(&local, XMVector3InverseRotate(d, XMLoadFloat4(&b.Orientation)));
+
+		float size = MathHelper::Max(b.Extents.x, MathHelper::Max(b.Extents.y, b.Extents.z));
+		return fabsf(local.x) <= b.Extents.x + Tolerance(size) &&
+			fabsf(local.y) <= b.Extents.y + Tolerance(size) &&
+			fabsf(local.z) <= b.Extents.z + Tolerance(size);
+	}
+
+	bool VolumeContains(const BoundingVolume& bv, const XMFLOAT3& p)
+	{
+		switch(bv.Type)
+		{
+		case BoundingVolume::Shape::Sphere:
+			return SphereContains(bv.Sphere, p);
+		case BoundingVolume::Shape::OrientedBox:
+			return OrientedBoxContains(bv.OrientedBox, p);
+		default:
+			return BoxContains(bv.Box, p);
+		}
+	}
+
+	BoundingVolume FitCloud(const Cloud& cloud)
+	{
+		return BoundsFitting::Fit(cloud.Points.data(), sizeof(XMFLOAT3), (std::uint32_t)cloud.Points.size());
+	}
+
+	void CheckAllContained(const Cloud& cloud, bool contained)
+	{
+		if(!contained)
+			TestFramework::Fail(__FILE__, __LINE__, std::string("a point of the ") + cloud.Name + " is outside");
+	}
+}
+
+TEST(BoundsFitting, ContainsEveryPoint)
+{
+	for(const Cloud& cloud : Clouds())
+	{
+		const std::uint32_t count = (std::uint32_t)cloud.Points.size();
+		BoundingSphere sphere = BoundsFitting::MinimalSphere(cloud.Points.data(), sizeof(XMFLOAT3), count);
+		BoundingOrientedBox obb = BoundsFitting::FitOrientedBox(cloud.Points.data(), sizeof(XMFLOAT3), count);
+		BoundingOrientedBox pca = BoundsFitting::PcaOrientedBox(cloud.Points.data(), sizeof(XMFLOAT3), count);
+		BoundingVolume bv = FitCloud(cloud);
+
+		bool inSphere = true, inObb = true, inPca = true, inFit = true, inBox = true;
+		for(const XMFLOAT3& p : cloud.Points)
+		{
+			inSphere = inSphere && SphereContains(sphere, p);
+			inObb = inObb && OrientedBoxContains(obb, p);
+			inPca = inPca && OrientedBoxContains(pca, p);
+			inFit = inFit && VolumeContains(bv, p);
+			inBox = inBox && BoxContains(bv.Box, p);
+		}
+
+		CheckAllContained(cloud, inSphere);
+		CheckAllContained(cloud, inObb);
+		CheckAllContained(cloud, inPca);
+		CheckAllContained(cloud, inFit);
+		CheckAllContained(cloud, inBox);
+	}
+}
+
+TEST(BoundsFitting, MinimalSphere)
+{
+	// Two points: the sphere through both.
+	XMFLOAT3 pair[2] = { XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT3(3.0f, 0.0f, 0.0f) };
+	BoundingSphere s = BoundsFitting::MinimalSphere(pair, sizeof(XMFLOAT3), 2);
+	CHECK_NEAR(s.Center.x, 1.0f, 1e-5f);
+	CHECK_NEAR(s.Radius, 2.0f, 1e-3f);
+
+	// Points on a sphere come within a percent of it.
+	Random random(1);
+	std::vector<XMFLOAT3> points = SphereCloud(random, 5000, 2.5f, XMFLOAT3(1.0f, 2.0f, 3.0f));
+	s = BoundsFitting::MinimalSphere(points.data(), sizeof(XMFLOAT3), (std::uint32_t)points.size());
+	CHECK(s.Radius >= 2.5f && s.Radius <= 2.5f*1.01f);
+
+	// Refinement never makes the sphere larger than Ritter's.
+	std::vector<XMFLOAT3> box = BoxCloud(random, 5000, XMFLOAT3(3.0f, 1.0f, 2.0f), 0.2f, 0.4f, 0.6f, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	BoundingSphere ritter = BoundsFitting::MinimalSphere(box.data(), sizeof(XMFLOAT3), (std::uint32_t)box.size(), 0);
+	BoundingSphere refined = BoundsFitting::MinimalSphere(box.data(), sizeof(XMFLOAT3), (std::uint32_t)box.size());
+	CHECK(refined.Radius <= ritter.Radius);
+
+	// The same points give the same sphere.
+	BoundingSphere again = BoundsFitting::MinimalSphere(box.data(), sizeof(XMFLOAT3), (std::uint32_t)box.size());
+	CHECK(again.Radius == refined.Radius && again.Center.x == refined.Center.x);
+
+	// The stride skips whatever else the vertices hold.
+	struct Vertex { XMFLOAT3 Pos; XMFLOAT3 Normal; };
+	std::vector<Vertex> vertices(box.size());
+	for(size_t i = 0; i < box.size(); ++i)
+		vertices[i] = { box[i], XMFLOAT3(100.0f, 100.0f, 100.0f) };
+	BoundingSphere strided = BoundsFitting::MinimalSphere(&vertices[0].Pos, sizeof(Vertex), (std::uint32_t)vertices.size());
+	CHECK(strided.Radius == refined.Radius);
+}
+
+TEST(BoundsFitting, TighterThanAabb)
+{
+	for(const Cloud& cloud : Clouds())
+	{
+		BoundingVolume bv = FitCloud(cloud);
+		CHECK(bv.Volume() <= BoundsFitting::Volume(bv.Box));
+	}
+
+	// A rod along a diagonal fills a small part of its AABB; the oriented box
+	// hugs it.
+	Random random(2);
+	std::vector<XMFLOAT3> rod = BoxCloud(random, 5000, XMFLOAT3(10.0f, 0.5f, 0.5f), 0.6f, 0.8f, 0.3f, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	BoundingVolume bv = BoundsFitting::Fit(rod.data(), sizeof(XMFLOAT3), (std::uint32_t)rod.size());
+	CHECK(bv.Type == BoundingVolume::Shape::OrientedBox);
+	CHECK(bv.Volume() < 0.1f*BoundsFitting::Volume(bv.Box));
+
+	// Within a few percent of the true box (20 x 1 x 1).
+	CHECK(bv.Volume() < 20.0f*1.05f);
+
+	// So does a rotated slab.
+	std::vector<XMFLOAT3> slab = BoxCloud(random, 5000, XMFLOAT3(4.0f, 4.0f, 0.1f), -0.4f, 1.1f, 0.7f, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	bv = BoundsFitting::Fit(slab.data(), sizeof(XMFLOAT3), (std::uint32_t)slab.size());
+	CHECK(bv.Type == BoundingVolume::Shape::OrientedBox);
+	CHECK(bv.Volume() < 0.2f*BoundsFitting::Volume(bv.Box));
+}
+
+TEST(BoundsFitting, OrientedBoxAxesAreOrthonormal)
+{
+	for(const Cloud& cloud : Clouds())
+	{
+		const std::uint32_t count = (std::uint32_t)cloud.Points.size();
+		BoundingOrientedBox boxes[2] =
+		{
+			BoundsFitting::FitOrientedBox(cloud.Points.data(), sizeof(XMFLOAT3), count),
+			BoundsFitting::PcaOrientedBox(cloud.Points.data(), sizeof(XMFLOAT3), count)
+		};
+
+		for(const BoundingOrientedBox& box : boxes)
+		{
+			XMVECTOR q = XMLoadFloat4(&box.Orientation);
+			CHECK_NEAR(XMVectorGetX(XMVector4Length(q)), 1.0f, 1e-5f);
+
+			// The rows of the rotation are the box axes: unit length, perpendicular
+			// and right handed.
+			XMMATRIX R = XMMatrixRotationQuaternion(q);
+			for(int i = 0; i < 3; ++i)
+			{
+				CHECK_NEAR(XMVectorGetX(XMVector3Length(R.r[i])), 1.0f, 1e-5f);
+				for(int j = i + 1; j < 3; ++j)
+					CHECK_NEAR(XMVectorGetX(XMVector3Dot(R.r[i], R.r[j])), 0.0f, 1e-5f);
+			}
+			CHECK_NEAR(XMVectorGetX(XMVector3Dot(XMVector3Cross(R.r[0], R.r[1]), R.r[2])), 1.0f, 1e-5f);
+
+			CHECK(box.Extents.x >= 0.0f && box.Extents.y >= 0.0f && box.Extents.z >= 0.0f);
+		}
+	}
+}
+
+TEST(BoundsFitting, FitPicksCheapestWithinThreshold)
+{
+	// A more expensive shape is only picked when it is at least 2% smaller
+	// than the cheaper ones: sphere, then AABB, then oriented box.
+	for(const Cloud& cloud : Clouds())
+	{
+		BoundingVolume bv = FitCloud(cloud);
+
+		float sphere = BoundsFitting::Volume(bv.Sphere);
+		float box = BoundsFitting::Volume(bv.Box);
+		float obb = BoundsFitting::Volume(bv.OrientedBox);
+
+		BoundingVolume::Shape expected = BoundingVolume::Shape::Sphere;
+		float best = sphere;
+		if(box < best*0.98f)
+		{
+			expected = BoundingVolume::Shape::Box;
+			best = box;
+		}
+		if(obb < best*0.98f)
+			expected = BoundingVolume::Shape::OrientedBox;
+
+		if(bv.Type != expected)
+			TestFramework::Fail(__FILE__, __LINE__, std::string("unexpected shape for the ") + cloud.Name);
+	}
+
+	Random random(3);
+
+	// Points on a sphere: the sphere.
+	std::vector<XMFLOAT3> points = SphereCloud(random, 2000, 1.0f, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	CHECK(BoundsFitting::Fit(points.data(), sizeof(XMFLOAT3), 2000).Type == BoundingVolume::Shape::Sphere);
+
+	// An axis aligned box: the oriented box cannot beat the AABB by 2%, so the
+	// cheaper AABB is kept.
+	points = BoxCloud(random, 2000, XMFLOAT3(3.0f, 1.0f, 2.0f), 0.0f, 0.0f, 0.0f, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	BoundingVolume bv = BoundsFitting::Fit(points.data(), sizeof(XMFLOAT3), 2000);
+	CHECK(bv.Type == BoundingVolume::Shape::Box);
+	CHECK(BoundsFitting::Volume(bv.OrientedBox) >= 0.98f*BoundsFitting::Volume(bv.Box));
+
+	// Nothing to fit.
+	bv = BoundsFitting::Fit(nullptr, sizeof(XMFLOAT3), 0);
+	CHECK(bv.Type == BoundingVolume::Shape::Box);
+}
+
+BENCHMARK(BoundsFitting, Skull)
+{
+	std::vector<XMFLOAT3> skull = SkullCloud();
+	if(skull.empty())
+		return;
+
+	const std::uint32_t count = (std::uint32_t)skull.size();
+	bench.Run("MinimalSphere", [&]() { BoundsFitting::MinimalSphere(skull.data(), sizeof(XMFLOAT3), count); });
+	bench.Run("FitOrientedBox", [&]() { BoundsFitting::FitOrientedBox(skull.data(), sizeof(XMFLOAT3), count); });
+	bench.Run("Fit", [&]() { BoundsFitting::Fit(skull.data(), sizeof(XMFLOAT3), count); });
+
+	BoundingVolume bv = BoundsFitting::Fit(skull.data(), sizeof(XMFLOAT3), count);
+	bench.Report("AABB volume", BoundsFitting::Volume(bv.Box));
+	bench.Report("sphere volume", BoundsFitting::Volume(bv.Sphere));
+	bench.Report("oriented box volume", BoundsFitting::Volume(bv.OrientedBox));
+}
@@ -0,0 +1,314 @@
+//***************************************************************************************
+// DDSFileTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/DDSFile.h"
+#include "../../Common/Random.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	DDSFile::Desc MakeDesc(DDSFile::TextureDimension dimension, DXGI_FORMAT format,
+		std::uint32_t width, std::uint32_t height, std::uint32_t depth, std::uint32_t mipLevels,
+		std::uint32_t arraySize, bool cube = false)
+	{
+		DDSFile::Desc desc;
+		desc.Dimension = dimension;
+		desc.Format = format;
+		desc.Width = width;
+		desc.Height = height;
+		desc.Depth = depth;
+		desc.MipLevels = mipLevels;
+		desc.ArraySize = arraySize;
+		desc.IsCubeMap = cube;
+		return desc;
+	}
+
+	// A complete file: header, then every subresource filled with its index.
+	std::string MakeFile(const DDSFile::Desc& desc, std::uint64_t dataBytes)
+	{
+		std::ostringstream out;
+		CHECK(DDSFile::WriteHeader(out, desc));
+		std::string file = out.str();
+		for(std::uint64_t i = 0; i < dataBytes; ++i)
+			file.push_back((char)(i * 7));
+		return file;
+	}
+
+	// What the subresources of desc must add up to, computed independently.
+	std::uint64_t ExpectedDataSize(const DDSFile::Desc& desc, std::uint32_t bytesPerBlock, bool blockCompressed)
+	{
+		std::uint64_t total = 0;
+		std::uint32_t w = desc.Width, h = desc.Height, d = desc.Depth;
+		for(std::uint32_t mip = 0; mip < desc.MipLevels; ++mip)
+		{
+			std::uint64_t rows = blockCompressed ? (h + 3) / 4 : h;
+			std::uint64_t columns = blockCompressed ? (w + 3) / 4 : w;
+			total += rows * columns * bytesPerBlock * d;
+			w = w > 1 ? w / 2 : 1;
+			h = h > 1 ? h / 2 : 1;
+			d = d > 1 ? d / 2 : 1;
+		}
+		return total * desc.ArraySize;
+	}
+
+	void CheckLayout(const DDSFile& dds, std::uint64_t fileSize)
+	{
+		// Subresources are contiguous, in D3D12 order, and inside the file.
+		const DDSFile::Desc& desc = dds.GetDesc();
+		const std::vector<DDSFile::Subresource>& subs = dds.Subresources();
+		CHECK(subs.size() == (size_t)desc.MipLevels * desc.ArraySize);
+
+		std::uint64_t offset = subs.empty() ? 0 : subs[0].Offset;
+		for(std::uint32_t slice = 0; slice < desc.ArraySize; ++slice)
+		{
+			for(std::uint32_t mip = 0; mip < desc.MipLevels; ++mip)
+			{
+				const DDSFile::Subresource& s = dds.GetSubresource(mip, slice);
+				CHECK(s.Offset == offset);
+				CHECK(s.Width == std::max(desc.Width >> mip, 1u));
+				CHECK(s.Height == std::max(desc.Height >> mip, 1u));
+				CHECK(s.RowPitch * s.RowCount == s.SlicePitch);
+				offset += s.SlicePitch * s.Depth;
+			}
+		}
+		CHECK(offset <= fileSize);
+		CHECK(offset - (subs.empty() ? 0 : subs[0].Offset) == dds.DataSize());
+	}
+}
+
+TEST(DDSFile, WriteHeaderRoundTrip)
+{
+	struct Case
+	{
+		DDSFile::Desc Desc;
+		std::uint32_t BytesPerBlock;
+		bool BlockCompressed;
+	};
+
+	const Case cases[] = {
+		{ MakeDesc(DDSFile::TextureDimension::Texture2D, DXGI_FORMAT_R8G8B8A8_UNORM, 256, 128, 1, 9, 1), 4, false },
+		{ MakeDesc(DDSFile::TextureDimension::Texture2D, DXGI_FORMAT_BC1_UNORM, 100, 60, 1, 7, 1), 8, true },
+		{ MakeDesc(DDSFile::TextureDimension::Texture2D, DXGI_FORMAT_BC3_UNORM_SRGB, 64, 64, 1, 7, 5), 16, true },
+		{ MakeDesc(DDSFile::TextureDimension::Texture2D, DXGI_FORMAT_R16G16B16A16_FLOAT, 32, 32, 1, 6, 12, true), 8, false },
+		{ MakeDesc(DDSFile::TextureDimension::Texture3D, DXGI_FORMAT_R8_UNORM, 16, 8, 4, 5, 1), 1, false },
+		{ MakeDesc(DDSFile::TextureDimension::Texture1D, DXGI_FORMAT_R32_FLOAT, 300, 1, 1, 1, 3), 4, false },
+	};
+
+	for(const Case& c : cases)
+	{
+		std::uint64_t dataSize = ExpectedDataSize(c.Desc, c.BytesPerBlock, c.BlockCompressed);
+		std::string file = MakeFile(c.Desc, dataSize);
+
+		DDSFile dds;
+		CHECK(dds.Parse(file.data(), file.size()) == DDSFile::Status::Ok);
+
+		const DDSFile::Desc& desc = dds.GetDesc();
+		CHECK(desc.Dimension == c.Desc.Dimension);
+		CHECK(desc.Format == c.Desc.Format);
+		CHECK(desc.Width == c.Desc.Width && desc.Height == c.Desc.Height && desc.Depth == c.Desc.Depth);
+		CHECK(desc.MipLevels == c.Desc.MipLevels);
+		CHECK(desc.ArraySize == c.Desc.ArraySize);
+		CHECK(desc.IsCubeMap == c.Desc.IsCubeMap);
+		CHECK(dds.DataSize() == dataSize);
+		CHECK(dds.Size() == file.size());
+		CheckLayout(dds, file.size());
+
+		// Data points into the buffer given to Parse.
+		const DDSFile::Subresource& last = dds.Subresources().back();
+		CHECK(last.Data == (const std::uint8_t*)file.data() + last.Offset);
+
+		// One byte short is truncated, not a crash or a partial table.
+		DDSFile shortFile;
+		CHECK(shortFile.Parse(file.data(), file.size() - 1) == DDSFile::Status::Truncated);
+		CHECK(shortFile.Subresources().empty());
+		CHECK(shortFile.GetDesc().Width == 0);
+	}
+}
+
+TEST(DDSFile, LegacyHeaders)
+{
+	// A DXT1 file without the DX10 header, as texconv wrote them.
+	DDS_HEADER header = {};
+	header.size = sizeof(DDS_HEADER);
+	header.flags = 0x1 | DDS_HEIGHT | DDS_WIDTH | 0x1000 | 0x20000;
+	header.width = 64;
+	header.height = 32;
+	header.mipMapCount = 3;
+	header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+	header.ddspf.flags = DDS_FOURCC;
+	header.ddspf.fourCC = MAKEFOURCC('D', 'X', 'T', '1');
+
+	std::string file((const char*)&DDS_MAGIC, sizeof(DDS_MAGIC));
+	file.append((const char*)&header, sizeof(header));
+	file.append((16*8 + 8*4 + 4*2) * 8, '\0');
+
+	DDSFile dds;
+	CHECK(dds.Parse(file.data(), file.size()) == DDSFile::Status::Ok);
+	CHECK(dds.GetDesc().Format == DXGI_FORMAT_BC1_UNORM);
+	CHECK(dds.GetDesc().Dimension == DDSFile::TextureDimension::Texture2D);
+	CHECK(dds.GetSubresource(2, 0).RowPitch == 4*8 && dds.GetSubresource(2, 0).RowCount == 2);
+	CheckLayout(dds, file.size());
+
+	// A legacy cube map needs all six faces.
+	header.caps2 = DDS_CUBEMAP_ALLFACES;
+	std::string cube((const char*)&DDS_MAGIC, sizeof(DDS_MAGIC));
+	cube.append((const char*)&header, sizeof(header));
+	cube.append((16*8 + 8*4 + 4*2) * 8 * 6, '\0');
+	CHECK(dds.Parse(cube.data(), cube.size()) == DDSFile::Status::Ok);
+	CHECK(dds.GetDesc().IsCubeMap && dds.GetDesc().ArraySize == 6);
+
+	header.caps2 = DDS_CUBEMAP_POSITIVEX | DDS_CUBEMAP_NEGATIVEX;
+	std::memcpy(&cube[sizeof(DDS_MAGIC)], &header, sizeof(header));
+	CHECK(dds.Parse(cube.data(), cube.size()) == DDSFile::Status::NotSupported);
+}
+
+TEST(DDSFile, RejectsBadHeaders)
+{
+	DDSFile::Desc desc = MakeDesc(DDSFile::TextureDimension::Texture2D, DXGI_FORMAT_R8G8B8A8_UNORM, 16, 16, 1, 5, 1);
+	std::string good = MakeFile(desc, ExpectedDataSize(desc, 4, false));
+	const size_t ext = sizeof(DDS_MAGIC) + sizeof(DDS_HEADER);
+
+	auto parse = [](const std::string& file)
+	{
+		DDSFile dds;
+		return dds.Parse(file.data(), file.size());
+	};
+
+	CHECK(parse(good) == DDSFile::Status::Ok);
+	CHECK(parse(good.substr(0, 100)) == DDSFile::Status::InvalidData);
+	CHECK(parse(good.substr(0, ext + 4)) == DDSFile::Status::InvalidData);
+
+	std::string bad = good;
+	bad[0] = 'X';
+	CHECK(parse(bad) == DDSFile::Status::InvalidData);
+
+	// Width 0.
+	bad = good;
+	std::memset(&bad[sizeof(DDS_MAGIC) + offsetof(DDS_HEADER, width)], 0, 4);
+	CHECK(parse(bad) == DDSFile::Status::InvalidData);
+
+	// Array size 0.
+	bad = good;
+	std::memset(&bad[ext + offsetof(DDS_HEADER_DXT10, arraySize)], 0, 4);
+	CHECK(parse(bad) == DDSFile::Status::InvalidData);
+
+	// Palettized formats and more mips than D3D12 allows.
+	desc.Format = DXGI_FORMAT_P8;
+	CHECK(parse(MakeFile(desc, 4096)) == DDSFile::Status::NotSupported);
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.MipLevels = 16;
+	CHECK(parse(MakeFile(desc, 4096)) == DDSFile::Status::NotSupported);
+
+	// Array sizes beyond the hardware limit, before any allocation.
+	desc = MakeDesc(DDSFile::TextureDimension::Texture2D, DXGI_FORMAT_R8G8B8A8_UNORM, 4, 4, 1, 1, 100000);
+	CHECK(parse(MakeFile(desc, 64)) == DDSFile::Status::NotSupported);
+}
+
+TEST(DDSFile, CorruptHeadersStayInBounds)
+{
+	// Random header bytes must only ever produce a status and, when Ok, a
+	// subresource table inside the data (AddressSanitizer catches the rest).
+	DDSFile::Desc desc = MakeDesc(DDSFile::TextureDimension::Texture2D, DXGI_FORMAT_BC1_UNORM, 64, 64, 1, 7, 2);
+	std::string good = MakeFile(desc, ExpectedDataSize(desc, 8, true));
+	const size_t headerBytes = sizeof(DDS_MAGIC) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+
+	Random random(41);
+	std::uint32_t ok = 0;
+	for(int i = 0; i < 20000; ++i)
+	{
+		std::string file = good;
+		std::uint32_t changes = 1 + random.NextUInt(4);
+		for(std::uint32_t c = 0; c < changes; ++c)
+			file[random.NextUInt((std::uint32_t)headerBytes)] = (char)random.NextUInt(256);
+
+		DDSFile dds;
+		if(dds.Parse(file.data(), file.size()) == DDSFile::Status::Ok)
+		{
+			++ok;
+			CheckLayout(dds, file.size());
+			const DDSFile::Subresource& last = dds.Subresources().back();
+			CHECK(last.Offset + last.SlicePitch * last.Depth <= file.size());
+		}
+	}
+	CHECK(ok > 0);
+}
+
+TEST(DDSFile, OpenMapsFile)
+{
+	DDSFile::Desc desc = MakeDesc(DDSFile::TextureDimension::Texture2D, DXGI_FORMAT_R8G8B8A8_UNORM, 8, 8, 1, 4, 1);
+	std::string file = MakeFile(desc, ExpectedDataSize(desc, 4, false));
+
+	const char* filename = "DDSFileTests.tmp.dds";
+	{
+		std::ofstream out(filename, std::ios::binary);
+		out.write(file.data(), file.size());
+	}
+
+	DDSFile dds;
+	CHECK(dds.Open(filename) == DDSFile::Status::Ok);
+	CHECK(dds.Size() == file.size());
+	CHECK(std::memcmp(dds.GetSubresource(1, 0).Data, file.data() + dds.GetSubresource(1, 0).Offset,
+		(size_t)dds.GetSubresource(1, 0).SlicePitch) == 0);
+	dds.Close();
+	CHECK(dds.Subresources().empty());
+	std::remove(filename);
+
+	CHECK(dds.Open("DoesNotExist.dds") == DDSFile::Status::OpenFailed);
+	CHECK(dds.SystemError() != 0);
+	CHECK(std::strcmp(DDSFile::StatusToString(DDSFile::Status::Truncated), "Truncated") == 0);
+}
+
+TEST(DDSFile, DemoTextures)
+{
+	// Every DDS file the demos ship parses and fits in its file.
+	const char* names[] = {
+		"WoodCrate01.dds", "bricks.dds", "bricks_nmap.dds", "checkboard.dds", "default_nmap.dds",
+		"grass.dds", "tree01S.dds", "treeArray2.dds", "treearray.dds", "water1.dds",
+		"wave0_nmap.dds", "white1x1.dds", "Bolt001.dds" };
+
+	for(const char* name : names)
+	{
+		DDSFile dds;
+		DDSFile::Status status = dds.Open(std::string("../../Textures/") + name);
+		CHECK(status == DDSFile::Status::Ok);
+		if(status != DDSFile::Status::Ok)
+			continue;
+
+		CHECK(dds.GetDesc().Format != DXGI_FORMAT_UNKNOWN);
+		CheckLayout(dds, dds.Size());
+	}
+}
+
+BENCHMARK(DDSFile, Parse)
+{
+	// Header parse and subresource table only: no pixel is touched.
+	DDSFile::Desc desc = MakeDesc(DDSFile::TextureDimension::Texture2D, DXGI_FORMAT_BC3_UNORM, 1024, 1024, 1, 11, 1);
+	std::string file = MakeFile(desc, ExpectedDataSize(desc, 16, true));
+
+	DDSFile dds;
+	bench.Run("1024x1024 BC3, 11 mips", [&]()
+	{
+		dds.Parse(file.data(), file.size());
+	});
+
+	desc = MakeDesc(DDSFile::TextureDimension::Texture2D, DXGI_FORMAT_BC1_UNORM, 256, 256, 1, 9, 64);
+	file = MakeFile(desc, ExpectedDataSize(desc, 8, true));
+	bench.Run("256x256 BC1 array of 64, 9 mips", [&]()
+	{
+		dds.Parse(file.data(), file.size());
+	});
+
+	// Map, parse and unmap a demo texture.
+	bench.Run("open bricks_nmap.dds", [&]()
+	{
+		dds.Open("../../Textures/bricks_nmap.dds");
+		dds.Close();
+	});
+}
@@ -0,0 +1,183 @@
+//***************************************************************************************
+// DescriptorAllocatorTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/DescriptorAllocator.h"
+#include "../../Common/Random.h"
+
+namespace
+{
+	struct Allocation
+	{
+		std::uint32_t Offset;
+		std::uint32_t Count;
+	};
+
+	// Number of maximal runs of free slots, which is what a fully coalesced
+	// free list must contain.
+	std::uint32_t FreeRuns(const std::vector<bool>& used)
+	{
+		std::uint32_t runs = 0;
+		for(size_t i = 0; i < used.size(); ++i)
+		{
+			if(!used[i] && (i == 0 || used[i - 1]))
+				++runs;
+		}
+		return runs;
+	}
+}
+
+TEST(DescriptorAllocator, AllocatesAndCoalesces)
+{
+	DescriptorAllocator heap(100);
+
+	std::uint32_t a = heap.Allocate(10);
+	std::uint32_t b = heap.Allocate(20);
+	std::uint32_t c = heap.Allocate(30);
+	CHECK(a == 0 && b == 10 && c == 30);
+	CHECK(heap.AllocatedCount() == 60);
+
+	// Freeing the middle leaves a hole; freeing its neighbours merges them.
+	heap.Free(b, 20);
+	CHECK(heap.GetStats().FreeRanges == 2);
+	heap.Free(a, 10);
+	CHECK(heap.GetStats().FreeRanges == 2);
+	CHECK(heap.GetStats().LargestFreeRange == 40);
+	heap.Free(c, 30);
+	CHECK(heap.GetStats().FreeRanges == 1);
+	CHECK(heap.GetStats().LargestFreeRange == 100);
+	CHECK(heap.AllocatedCount() == 0);
+	CHECK(heap.GetStats().PeakAllocatedCount == 60);
+
+	// Too large fails without changing anything.
+	CHECK(heap.Allocate(101) == DescriptorAllocator::InvalidOffset);
+	CHECK(heap.GetStats().FailedAllocations == 1);
+	CHECK(heap.Allocate(100) == 0);
+}
+
+TEST(DescriptorAllocator, BestFit)
+{
+	DescriptorAllocator heap(100);
+	std::uint32_t r[5];
+	for(int i = 0; i < 5; ++i)
+		r[i] = heap.Allocate(20);
+
+	// A 20 wide hole at 0 and a 40 wide one at 40 (two merged ranges).
+	heap.Free(r[0], 20);
+	heap.Free(r[2], 20);
+	heap.Free(r[3], 20);
+
+	// A request of 15 goes into the 20 wide hole, not the 40 wide one.
+	CHECK(heap.Allocate(15) == 0);
+	CHECK(heap.Allocate(40) == 40);
+	CHECK(heap.Allocate(6) == DescriptorAllocator::InvalidOffset);
+	CHECK(heap.Allocate(5) == 15);
+	CHECK(heap.FreeCount() == 0);
+}
+
+TEST(DescriptorAllocator, RandomChurn)
+{
+	const std::uint32_t capacity = 4096;
+	DescriptorAllocator heap(capacity);
+	std::vector<bool> used(capacity, false);
+	std::vector<Allocation> live;
+	Random random(35);
+
+	for(int step = 0; step < 20000; ++step)
+	{
+		bool allocate = live.empty() || random.NextUInt(100) < 55;
+		if(allocate)
+		{
+			std::uint32_t count = random.NextUInt(8) == 0 ? 1 + random.NextUInt(256) : 1 + random.NextUInt(8);
+			std::uint32_t offset = heap.Allocate(count);
+			if(offset == DescriptorAllocator::InvalidOffset)
+			{
+				// Only allowed if no free run is long enough.
+				std::uint32_t run = 0, longest = 0;
+				for(bool u : used)
+				{
+					run = u ? 0 : run + 1;
+					longest = run > longest ? run : longest;
+				}
+				CHECK(longest < count);
+				continue;
+			}
+
+			CHECK(offset + count <= capacity);
+			for(std::uint32_t i = offset; i < offset + count && i < capacity; ++i)
+			{
+				CHECK(!used[i]);
+				used[i] = true;
+			}
+			live.push_back({ offset, count });
+		}
+		else
+		{
+			std::uint32_t k = random.NextUInt((std::uint32_t)live.size());
+			Allocation a = live[k];
+			live[k] = live.back();
+			live.pop_back();
+
+			heap.Free(a.Offset, a.Count);
+			for(std::uint32_t i = a.Offset; i < a.Offset + a.Count; ++i)
+				used[i] = false;
+		}
+
+		if(step % 500 == 0)
+		{
+			CHECK(heap.GetStats().FreeRanges == FreeRuns(used));
+			std::uint32_t allocated = 0;
+			for(bool u : used)
+				allocated += u ? 1 : 0;
+			CHECK(heap.AllocatedCount() == allocated);
+		}
+	}
+
+	for(const Allocation& a : live)
+		heap.Free(a.Offset, a.Count);
+	CHECK(heap.GetStats().FreeRanges == 1);
+	CHECK(heap.GetStats().LargestFreeRange == capacity);
+}
+
+BENCHMARK(DescriptorAllocator, Churn)
+{
+	// A 1M descriptor heap with 64K live single descriptors and small tables,
+	// replacing 1K of them per iteration.
+	const std::uint32_t capacity = 1000000;
+	DescriptorAllocator heap(capacity);
+	Random random(36);
+
+	std::vector<Allocation> live;
+	for(int i = 0; i < 64*1024; ++i)
+	{
+		std::uint32_t count = random.NextUInt(4) == 0 ? 1 + random.NextUInt(8) : 1;
+		live.push_back({ heap.Allocate(count), count });
+	}
+
+	// Free every other one so the heap is fragmented into many small holes.
+	std::vector<Allocation> kept;
+	for(size_t i = 0; i < live.size(); ++i)
+	{
+		if(i % 2 == 0)
+			heap.Free(live[i].Offset, live[i].Count);
+		else
+			kept.push_back(live[i]);
+	}
+	live.swap(kept);
+
+	bench.Run("free + allocate 1K", [&]()
+	{
+		for(int i = 0; i < 1024; ++i)
+		{
+			Allocation& a = live[random.NextUInt((std::uint32_t)live.size())];
+			heap.Free(a.Offset, a.Count);
+			a.Count = random.NextUInt(4) == 0 ? 1 + random.NextUInt(8) : 1;
+			a.Offset = heap.Allocate(a.Count);
+		}
+	});
+
+	const DescriptorAllocator::Stats& stats = heap.GetStats();
+	bench.Report("free ranges", (double)stats.FreeRanges);
+	bench.Report("largest free range", (double)stats.LargestFreeRange);
+}
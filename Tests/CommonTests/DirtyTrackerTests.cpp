@@ -0,0 +1,194 @@
+//***************************************************************************************
+// DirtyTrackerTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/DirtyTracker.h"
+#include "../../Common/Random.h"
+
+namespace
+{
+	// The per-object counters DirtyTracker replaces.
+	struct CounterModel
+	{
+		CounterModel(std::uint32_t frameCount, std::uint32_t count)
+			: Dirty(frameCount, std::vector<bool>(count, true))
+		{
+		}
+
+		void MarkDirty(std::uint32_t index)
+		{
+			for(std::vector<bool>& frame : Dirty)
+				frame[index] = true;
+		}
+
+		void Resize(std::uint32_t count)
+		{
+			for(std::vector<bool>& frame : Dirty)
+				frame.resize(count, true);
+		}
+
+		std::vector<std::uint32_t> Consume(std::uint32_t frameIndex)
+		{
+			std::vector<std::uint32_t> result;
+			std::vector<bool>& frame = Dirty[frameIndex];
+			for(std::uint32_t i = 0; i < (std::uint32_t)frame.size(); ++i)
+			{
+				if(frame[i])
+					result.push_back(i);
+				frame[i] = false;
+			}
+			return result;
+		}
+
+		std::vector<std::vector<bool>> Dirty;
+	};
+
+	std::vector<std::uint32_t> Consume(DirtyTracker& tracker, std::uint32_t frameIndex)
+	{
+		std::vector<std::uint32_t> result;
+		tracker.ConsumeDirty(frameIndex, [&result](std::uint32_t i) { result.push_back(i); });
+		return result;
+	}
+}
+
+TEST(DirtyTracker, NewObjectsStartDirtyInEveryFrame)
+{
+	DirtyTracker tracker(3, 130);
+	for(std::uint32_t f = 0; f < 3; ++f)
+	{
+		CHECK(tracker.DirtyCount(f) == 130);
+		std::vector<std::uint32_t> dirty = Consume(tracker, f);
+		CHECK(dirty.size() == 130);
+		for(std::uint32_t i = 0; i < dirty.size(); ++i)
+			CHECK(dirty[i] == i);
+		CHECK(tracker.DirtyCount(f) == 0);
+	}
+
+	// Consuming one frame resource leaves the others alone.
+	tracker.MarkDirty(64);
+	CHECK(Consume(tracker, 1).size() == 1);
+	CHECK(tracker.IsDirty(0, 64) && !tracker.IsDirty(1, 64) && tracker.IsDirty(2, 64));
+	CHECK(tracker.DirtyCount(0) == 1);
+
+	// Marking twice counts once.
+	tracker.MarkDirty(64);
+	CHECK(tracker.DirtyCount(0) == 1);
+	CHECK(tracker.DirtyCount(1) == 1);
+}
+
+TEST(DirtyTracker, MatchesFrameCounters)
+{
+	const std::uint32_t frameCount = 3;
+	Random random(31);
+	std::uint32_t count = 5000;
+	DirtyTracker tracker(frameCount, count);
+	CounterModel model(frameCount, count);
+
+	for(std::uint32_t frame = 0; frame < 300; ++frame)
+	{
+		// A handful of changes per frame, the occasional resize and mark all.
+		std::uint32_t changes = random.NextUInt(40);
+		for(std::uint32_t c = 0; c < changes; ++c)
+		{
+			std::uint32_t i = random.NextUInt(count);
+			tracker.MarkDirty(i);
+			model.MarkDirty(i);
+		}
+
+		if(frame % 50 == 17)
+		{
+			count = 64*random.NextUInt(100) + random.NextUInt(64) + 1;
+			tracker.Resize(count);
+			model.Resize(count);
+		}
+
+		if(frame % 97 == 5)
+		{
+			tracker.MarkAllDirty();
+			for(std::uint32_t i = 0; i < count; ++i)
+				model.MarkDirty(i);
+		}
+
+		std::uint32_t frameIndex = frame % frameCount;
+		std::vector<std::uint32_t> expected = model.Consume(frameIndex);
+		CHECK(tracker.DirtyCount(frameIndex) == expected.size());
+		CHECK(Consume(tracker, frameIndex) == expected);
+	}
+}
+
+TEST(DirtyTracker, ShrinkDropsOutOfRangeBits)
+{
+	DirtyTracker tracker(2, 200);
+	Consume(tracker, 0);
+	Consume(tracker, 1);
+
+	tracker.MarkDirty(10);
+	tracker.MarkDirty(150);
+	tracker.MarkDirty(199);
+	tracker.Resize(100);
+	CHECK(tracker.DirtyCount(0) == 1);
+	CHECK(Consume(tracker, 0) == std::vector<std::uint32_t>{ 10 });
+
+	// Growing again brings the new range back dirty, but not the dropped bits twice.
+	tracker.Resize(160);
+	CHECK(tracker.DirtyCount(1) == 61);
+	std::vector<std::uint32_t> dirty = Consume(tracker, 1);
+	CHECK(dirty.front() == 10 && dirty[1] == 100 && dirty.back() == 159);
+}
+
+BENCHMARK(DirtyTracker, Consume)
+{
+	// 100k objects, 1% changing per frame, over three frame resources.
+	const std::uint32_t count = 100000;
+	const std::uint32_t changes = count / 100;
+	const std::uint32_t frameCount = 3;
+
+	Random random(32);
+	std::vector<std::uint32_t> changed(changes*64);
+	for(std::uint32_t& i : changed)
+		i = random.NextUInt(count);
+
+	std::vector<int> numFramesDirty(count, 0);
+	std::uint32_t frame = 0;
+	std::uint64_t sum = 0;
+	bench.Run("NumFramesDirty counters", [&]()
+	{
+		const std::uint32_t* c = &changed[(frame % 64)*changes];
+		for(std::uint32_t k = 0; k < changes; ++k)
+			numFramesDirty[c[k]] = frameCount;
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			if(numFramesDirty[i] > 0)
+			{
+				sum += i;
+				numFramesDirty[i]--;
+			}
+		}
+		++frame;
+	});
+
+	DirtyTracker tracker(frameCount, count);
+	frame = 0;
+	bench.Run("DirtyTracker", [&]()
+	{
+		const std::uint32_t* c = &changed[(frame % 64)*changes];
+		for(std::uint32_t k = 0; k < changes; ++k)
+			tracker.MarkDirty(c[k]);
+		tracker.ConsumeDirty(frame % frameCount, [&sum](std::uint32_t i) { sum += i; });
+		++frame;
+	});
+
+	// Nothing changed: the common case for static scenes.
+	Consume(tracker, 0);
+	Consume(tracker, 1);
+	Consume(tracker, 2);
+	bench.Run("DirtyTracker, idle frame", [&]()
+	{
+		tracker.ConsumeDirty(0, [&sum](std::uint32_t i) { sum += i; });
+	});
+
+	// Keep the visits from being optimized away.
+	volatile std::uint64_t sink = sum;
+	(void)sink;
+}
@@ -0,0 +1,283 @@
+//***************************************************************************************
+// DrawPacketTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/DrawPacket.h"
+#include "../../Common/Random.h"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	// Packets with random keys; StartInstanceLocation holds the index they were
+	// added at, so stability can be checked after sorting.
+	std::vector<DrawPacket> MakePackets(Random& random, std::uint32_t count, std::uint64_t keyMask, std::uint64_t keyBits)
+	{
+		std::vector<DrawPacket> packets(count);
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			std::uint64_t key = random.NextUInt64();
+			packets[i].SortKey = (key & keyMask) | keyBits;
+			packets[i].StartInstanceLocation = i;
+		}
+
+		return packets;
+	}
+
+	bool SortsLikeStableSort(const std::vector<DrawPacket>& packets)
+	{
+		DrawPacketQueue queue;
+		for(const DrawPacket& p : packets)
+			queue.Add(p);
+		queue.Sort();
+
+		std::vector<DrawPacket> expected = packets;
+		std::stable_sort(expected.begin(), expected.end(),
+			[](const DrawPacket& a, const DrawPacket& b) { return a.SortKey < b.SortKey; });
+
+		if(queue.Size() != expected.size())
+			return false;
+
+		for(size_t i = 0; i < expected.size(); ++i)
+		{
+			const DrawPacket& p = queue.Packets()[i];
+			if(p.SortKey != expected[i].SortKey || p.StartInstanceLocation != expected[i].StartInstanceLocation)
+				return false;
+		}
+
+		return true;
+	}
+
+	// A frame of the shapes demos: a few PSOs, geometries and materials shared
+	// by many objects, added in no particular order.
+	DrawPacketQueue MakeScene(Random& random, std::uint32_t count)
+	{
+		DrawPacketQueue queue;
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			std::uint32_t layer = random.NextUInt(8) == 0 ? 1 : 0;
+
+			DrawPacket p;
+			p.Pso = layer;
+			p.Geometry = random.NextUInt(4);
+			p.PrimitiveTopology = 4;
+			p.Material = random.NextUInt(6);
+			p.ObjectCB = 0x10000 + 256ull*i;
+			p.IndexCount = 36;
+			p.SortKey = DrawPacketQueue::MakeSortKey(layer, p.Pso, p.Geometry, p.Material,
+				random.NextFloat(), layer == 1);
+			queue.Add(p);
+		}
+
+		return queue;
+	}
+
+	// Tracks what is bound, and checks every draw sees its packet's bindings.
+	class CheckingRecorder : public DrawPacketRecorder
+	{
+	public:
+		virtual void SetPipelineState(std::uint32_t pso)override { mPso = pso; }
+		virtual void SetGeometry(std::uint32_t geometry)override { mGeometry = geometry; }
+		virtual void SetPrimitiveTopology(std::uint32_t topology)override { mTopology = topology; }
+		virtual void SetMaterial(std::uint32_t material)override { mMaterial = material; }
+		virtual void SetObjectCB(std::uint64_t objectCB)override { mObjectCB = objectCB; }
+
+		virtual void DrawIndexedInstanced(const DrawPacket& packet)override
+		{
+			bool bound = (packet.Pso == DrawPacket::NoBinding || packet.Pso == mPso) &&
+				(packet.Geometry == DrawPacket::NoBinding || packet.Geometry == mGeometry) &&
+				(packet.PrimitiveTopology == DrawPacket::NoBinding || packet.PrimitiveTopology == mTopology) &&
+				(packet.Material == DrawPacket::NoBinding || packet.Material == mMaterial) &&
+				packet.ObjectCB == mObjectCB;
+			if(!bound)
+				mWrongDraws++;
+		}
+
+		std::uint32_t WrongDraws()const { return mWrongDraws; }
+
+	private:
+		std::uint32_t mPso = DrawPacket::NoBinding;
+		std::uint32_t mGeometry = DrawPacket::NoBinding;
+		std::uint32_t mTopology = DrawPacket::NoBinding;
+		std::uint32_t mMaterial = DrawPacket::NoBinding;
+		std::uint64_t mObjectCB = ~0ull;
+		std::uint32_t mWrongDraws = 0;
+	};
+}
+
+TEST(DrawPacket, RadixSortMatchesStableSort)
+{
+	Random random(32);
+
+	// Random keys: every byte differs somewhere, so all eight passes run.
+	CHECK(SortsLikeStableSort(MakePackets(random, 5000, ~0ull, 0)));
+
+	// Few distinct keys, so many are equal and stability matters.
+	CHECK(SortsLikeStableSort(MakePackets(random, 5000, 0x0000000300000007ull, 0)));
+
+	// Bytes in which all keys agree skip their pass, whether they are zero or
+	// not, at the bottom, the top or in between.
+	CHECK(SortsLikeStableSort(MakePackets(random, 5000, 0x00ff00ff00ff00ffull, 0x1200340056007800ull)));
+	CHECK(SortsLikeStableSort(MakePackets(random, 5000, 0xffffffff00000000ull, 0x00000000deadbeefull)));
+	CHECK(SortsLikeStableSort(MakePackets(random, 5000, 0x00000000ffffff00ull, 0xab000000000000cdull)));
+
+	// All keys equal: no pass runs and the order is kept.
+	CHECK(SortsLikeStableSort(MakePackets(random, 1000, 0, 0x0123456789abcdefull)));
+
+	// Real keys.
+	DrawPacketQueue scene = MakeScene(random, 2000);
+	CHECK(SortsLikeStableSort(scene.Packets()));
+
+	// Nothing and one packet.
+	CHECK(SortsLikeStableSort(std::vector<DrawPacket>()));
+	CHECK(SortsLikeStableSort(MakePackets(random, 1, ~0ull, 0)));
+
+	// Sorting again after Clear reuses the scratch buffers.
+	DrawPacketQueue queue;
+	std::vector<DrawPacket> packets = MakePackets(random, 3000, ~0ull, 0);
+	for(const DrawPacket& p : packets)
+		queue.Add(p);
+	queue.Sort();
+	queue.Clear();
+	CHECK(queue.Size() == 0);
+	for(size_t i = 0; i < 100; ++i)
+		queue.Add(packets[i]);
+	queue.Sort();
+	CHECK(queue.Size() == 100);
+	for(size_t i = 1; i < queue.Size(); ++i)
+		CHECK(queue.Packets()[i - 1].SortKey <= queue.Packets()[i].SortKey);
+}
+
+TEST(DrawPacket, SortKeyOrder)
+{
+	typedef DrawPacketQueue Q;
+
+	// The layer comes first, whatever the rest.
+	CHECK(Q::MakeSortKey(0, 1000, 4000, 16000, 1.0f) < Q::MakeSortKey(1, 0, 0, 0, 0.0f));
+	CHECK(Q::MakeSortKey(0, 1000, 4000, 16000, 1.0f) < Q::MakeSortKey(1, 0, 0, 0, 1.0f, true));
+	CHECK(Q::MakeSortKey(1, 1000, 4000, 16000, 0.0f, true) < Q::MakeSortKey(2, 0, 0, 0, 1.0f));
+
+	// Opaque: PSO, then geometry, then material, then front to back.
+	CHECK(Q::MakeSortKey(0, 1, 9, 9, 0.9f) < Q::MakeSortKey(0, 2, 0, 0, 0.0f));
+	CHECK(Q::MakeSortKey(0, 1, 1, 9, 0.9f) < Q::MakeSortKey(0, 1, 2, 0, 0.0f));
+	CHECK(Q::MakeSortKey(0, 1, 1, 1, 0.9f) < Q::MakeSortKey(0, 1, 1, 2, 0.0f));
+	CHECK(Q::MakeSortKey(0, 1, 1, 1, 0.1f) < Q::MakeSortKey(0, 1, 1, 1, 0.2f));
+
+	// Transparent: back to front first, state only breaks ties.
+	CHECK(Q::MakeSortKey(1, 9, 9, 9, 0.8f, true) < Q::MakeSortKey(1, 0, 0, 0, 0.2f, true));
+	CHECK(Q::MakeSortKey(1, 1, 9, 9, 0.5f, true) < Q::MakeSortKey(1, 2, 0, 0, 0.5f, true));
+	CHECK(Q::MakeSortKey(1, 1, 1, 1, 0.5f, true) < Q::MakeSortKey(1, 1, 1, 2, 0.5f, true));
+
+	// Depth is clamped to [0, 1].
+	CHECK(Q::MakeSortKey(0, 1, 1, 1, -5.0f) == Q::MakeSortKey(0, 1, 1, 1, 0.0f));
+	CHECK(Q::MakeSortKey(0, 1, 1, 1, 5.0f) == Q::MakeSortKey(0, 1, 1, 1, 1.0f));
+	CHECK(Q::MakeSortKey(1, 1, 1, 1, 5.0f, true) == Q::MakeSortKey(1, 1, 1, 1, 1.0f, true));
+
+	// Ids that do not fit, NoBinding included, share the largest value of
+	// their field and do not spill into the next one.
+	CHECK(Q::MakeSortKey(0, DrawPacket::NoBinding, 0, 0, 0.0f) == Q::MakeSortKey(0, 5000, 0, 0, 0.0f));
+	CHECK(Q::MakeSortKey(0, DrawPacket::NoBinding, 0, 0, 0.0f) < Q::MakeSortKey(1, 0, 0, 0, 0.0f));
+	CHECK(Q::MakeSortKey(0, 0, 0, DrawPacket::NoBinding, 1.0f) < Q::MakeSortKey(0, 0, 1, 0, 0.0f));
+}
+
+TEST(DrawPacket, SubmitSkipsRedundantState)
+{
+	Random random(7);
+	DrawPacketQueue queue = MakeScene(random, 1000);
+	queue.Sort();
+
+	CountingDrawPacketRecorder all;
+	DrawPacketQueue::SubmitStats allStats = queue.Submit(all, false);
+
+	CountingDrawPacketRecorder filtered;
+	DrawPacketQueue::SubmitStats filteredStats = queue.Submit(filtered);
+
+	// Unfiltered: every binding of every packet.
+	const CountingDrawPacketRecorder::Counts& a = all.GetCounts();
+	CHECK(a.Draws == 1000 && a.PipelineStates == 1000 && a.Geometries == 1000);
+	CHECK(a.PrimitiveTopologies == 1000 && a.Materials == 1000 && a.ObjectCBs == 1000);
+	CHECK(allStats.Packets == 1000 && allStats.RedundantStateSkipped == 0);
+	CHECK(allStats.StateChanges + a.Draws == a.Total());
+
+	// Filtered: the same draws, far fewer bindings.  Sorted opaque packets
+	// change PSO once per layer and geometry once per PSO.
+	const CountingDrawPacketRecorder::Counts& f = filtered.GetCounts();
+	CHECK(f.Draws == 1000 && f.ObjectCBs == 1000);
+	CHECK(f.PipelineStates < 100 && f.PrimitiveTopologies == 1);
+	CHECK(f.Geometries < a.Geometries && f.Materials < a.Materials);
+	CHECK(f.Total() < a.Total());
+	CHECK(filteredStats.StateChanges + f.Draws == f.Total());
+	CHECK(filteredStats.StateChanges + filteredStats.RedundantStateSkipped == allStats.StateChanges);
+
+	// Either way each draw sees its own bindings.
+	CheckingRecorder checkAll;
+	queue.Submit(checkAll, false);
+	CHECK(checkAll.WrongDraws() == 0);
+
+	CheckingRecorder checkFiltered;
+	queue.Submit(checkFiltered);
+	CHECK(checkFiltered.WrongDraws() == 0);
+
+	// A chunk starts with nothing bound, so its first packet binds everything.
+	CountingDrawPacketRecorder chunk;
+	DrawPacketQueue::SubmitStats chunkStats = queue.Submit(chunk, true, 500, 1);
+	CHECK(chunkStats.Packets == 1 && chunkStats.StateChanges == 5);
+	CHECK(chunk.GetCounts().Total() == 6);
+
+	CheckingRecorder checkChunk;
+	queue.Submit(checkChunk, true, 300, 400);
+	CHECK(checkChunk.WrongDraws() == 0);
+
+	// NoBinding is never set and keeps the previous binding.
+	DrawPacketQueue shared;
+	DrawPacket p;
+	p.Pso = 0;
+	p.Material = DrawPacket::NoBinding;
+	shared.Add(p);
+	p.Pso = DrawPacket::NoBinding;
+	shared.Add(p);
+	CountingDrawPacketRecorder sharedCounts;
+	shared.Submit(sharedCounts, false);
+	CHECK(sharedCounts.GetCounts().PipelineStates == 1 && sharedCounts.GetCounts().Materials == 0);
+	CHECK(sharedCounts.GetCounts().ObjectCBs == 2);
+
+	CheckingRecorder checkShared;
+	shared.Submit(checkShared);
+	CHECK(checkShared.WrongDraws() == 0);
+}
+
+BENCHMARK(DrawPacket, SortAndSubmit)
+{
+	Random random(32);
+	DrawPacketQueue scene = MakeScene(random, 10000);
+	const std::vector<DrawPacket> packets = scene.Packets();
+
+	DrawPacketQueue queue;
+	bench.Run("radix sort 10000 packets", [&]()
+	{
+		queue.Clear();
+		for(const DrawPacket& p : packets)
+			queue.Add(p);
+		queue.Sort();
+	});
+
+	std::vector<DrawPacket> sorted;
+	bench.Run("std::stable_sort 10000 packets", [&]()
+	{
+		sorted = packets;
+		std::stable_sort(sorted.begin(), sorted.end(),
+			[](const DrawPacket& a, const DrawPacket& b) { return a.SortKey < b.SortKey; });
+	});
+
+	CountingDrawPacketRecorder recorder;
+	bench.Run("submit filtered", [&]() { queue.Submit(recorder); });
+	bench.Run("submit unfiltered", [&]() { queue.Submit(recorder, false); });
+
+	CountingDrawPacketRecorder all;
+	CountingDrawPacketRecorder filtered;
+	queue.Submit(all, false);
+	queue.Submit(filtered);
+	bench.Report("calls unfiltered", (double)all.GetCounts().Total());
+	bench.Report("calls filtered", (double)filtered.GetCounts().Total());
+}
@@ -0,0 +1,153 @@
+//***************************************************************************************
+// FixedTimestepTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/Clock.h"
+#include "../../Common/FixedTimestep.h"
+#include "../../Common/GameTimer.h"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	// Runs stepper for seconds at framesPerSecond, timed by a GameTimer on a
+	// ManualClock as an app would be, and returns the steps of each frame.
+	std::vector<std::uint32_t> Run(FixedTimestep& stepper, double framesPerSecond, double seconds)
+	{
+		ManualClock clock;
+		GameTimer timer(clock);
+		timer.Reset();
+
+		std::vector<std::uint32_t> steps;
+		int frames = (int)(framesPerSecond*seconds + 0.5);
+		for(int frame = 1; frame <= frames; ++frame)
+		{
+			// Frame boundaries on whole nanoseconds, so rounding does not add up.
+			clock.Set((std::int64_t)(frame*1e9 / framesPerSecond + 0.5));
+			timer.Tick();
+			steps.push_back(stepper.Advance(timer.DeltaTime()));
+		}
+
+		return steps;
+	}
+}
+
+TEST(FixedTimestep, StepsAtAnyFrameRate)
+{
+	// 30 Hz takes 30 steps per second at 60, 144 and 24 frames per second,
+	// spread as evenly as the frame rate allows.
+	const double rates[] = { 60.0, 144.0, 24.0, 30.0 };
+	for(double rate : rates)
+	{
+		FixedTimestep stepper(1.0 / 30.0);
+		std::vector<std::uint32_t> steps = Run(stepper, rate, 10.0);
+
+		CHECK(stepper.StepCount() == 300);
+		CHECK_NEAR(stepper.SimulatedSeconds(), 10.0, 1e-9);
+		CHECK(stepper.DroppedSeconds() == 0.0);
+
+		std::uint32_t fewest = 100, most = 0;
+		for(std::uint32_t s : steps)
+		{
+			fewest = std::min(fewest, s);
+			most = std::max(most, s);
+		}
+		CHECK(most - fewest <= 1);
+	}
+
+	// At 60 frames per second, exactly every other frame.
+	FixedTimestep stepper(1.0 / 30.0);
+	std::vector<std::uint32_t> steps = Run(stepper, 60.0, 1.0);
+	for(size_t i = 0; i < steps.size(); ++i)
+		CHECK(steps[i] == (i % 2 == 1 ? 1u : 0u));
+}
+
+TEST(FixedTimestep, Alpha)
+{
+	FixedTimestep stepper(0.1);
+	CHECK(stepper.Alpha() == 0.0f);
+
+	CHECK(stepper.Advance(0.025) == 0);
+	CHECK_NEAR(stepper.Alpha(), 0.25f, 1e-5f);
+
+	CHECK(stepper.Advance(0.1) == 1);
+	CHECK_NEAR(stepper.Alpha(), 0.25f, 1e-5f);
+
+	CHECK(stepper.Advance(0.05) == 0);
+	CHECK_NEAR(stepper.Alpha(), 0.75f, 1e-5f);
+
+	// Negative frame times (a clock that went backwards) count as nothing.
+	CHECK(stepper.Advance(-1.0) == 0);
+	CHECK_NEAR(stepper.Alpha(), 0.75f, 1e-5f);
+
+	CHECK(stepper.Advance(0.225) == 3);
+	CHECK(stepper.Alpha() >= 0.0f && stepper.Alpha() < 1e-5f);
+	CHECK(stepper.StepCount() == 4);
+
+	stepper.Reset();
+	CHECK(stepper.Alpha() == 0.0f && stepper.StepCount() == 0);
+}
+
+TEST(FixedTimestep, SpiralOfDeathClamp)
+{
+	ManualClock clock;
+	GameTimer timer(clock);
+	timer.Reset();
+
+	FixedTimestep stepper(1.0 / 60.0, 4);
+	CHECK(stepper.MaxStepsPerFrame() == 4);
+
+	// A one second hitch (a breakpoint, a load) runs 4 steps, not 60, and
+	// drops the rest but for the part of a step.
+	clock.Advance(1.0 + 0.25 / 60.0);
+	timer.Tick();
+	CHECK(stepper.Advance(timer.DeltaTime()) == 4);
+	CHECK_NEAR(stepper.Alpha(), 0.25f, 1e-3f);
+	CHECK_NEAR(stepper.DroppedSeconds(), 56.0 / 60.0, 1e-6);
+
+	// The next frames run on time instead of catching up.
+	for(int frame = 0; frame < 10; ++frame)
+	{
+		clock.Advance(1.0 / 60.0);
+		timer.Tick();
+		CHECK(stepper.Advance(timer.DeltaTime()) == 1);
+	}
+	CHECK(stepper.StepCount() == 14);
+	CHECK_NEAR(stepper.DroppedSeconds(), 56.0 / 60.0, 1e-6);
+
+	// Exactly at the limit nothing is dropped.
+	FixedTimestep exact(0.25, 4);
+	CHECK(exact.Advance(1.0) == 4);
+	CHECK(exact.DroppedSeconds() == 0.0 && exact.Alpha() == 0.0f);
+}
+
+TEST(FixedTimestep, PausedTimerTakesNoSteps)
+{
+	ManualClock clock;
+	GameTimer timer(clock);
+	timer.Reset();
+
+	FixedTimestep stepper(0.1);
+	clock.Advance(0.15);
+	timer.Tick();
+	CHECK(stepper.Advance(timer.DeltaTime()) == 1);
+
+	// While paused the simulation holds, alpha included.
+	float alpha = stepper.Alpha();
+	timer.Stop();
+	for(int frame = 0; frame < 5; ++frame)
+	{
+		clock.Advance(1.0);
+		timer.Tick();
+		CHECK(stepper.Advance(timer.DeltaTime()) == 0);
+	}
+	CHECK(stepper.Alpha() == alpha);
+
+	// The paused time is not made up afterwards.
+	timer.Start();
+	clock.Advance(0.05);
+	timer.Tick();
+	CHECK(stepper.Advance(timer.DeltaTime()) == 1);
+	CHECK(stepper.StepCount() == 2 && stepper.DroppedSeconds() == 0.0);
+}
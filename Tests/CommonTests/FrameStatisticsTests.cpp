@@ -0,0 +1,233 @@
+//***************************************************************************************
+// FrameStatisticsTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/FrameStatistics.h"
+#include "../../Common/Random.h"
+#include <algorithm>
+#include <sstream>
+#include <thread>
+
+TEST(FrameStatistics, NearestRankPercentiles)
+{
+	// 1..100 ms in random order.
+	std::vector<float> times;
+	for(int i = 1; i <= 100; ++i)
+		times.push_back((float)i);
+	Random random(40);
+	for(size_t i = times.size() - 1; i > 0; --i)
+		std::swap(times[i], times[random.NextUInt((std::uint32_t)i + 1)]);
+
+	FrameStatistics stats(128);
+	stats.SetHitchThreshold(1000.0f, 1000.0f);
+	for(float ms : times)
+		stats.EndFrame(ms);
+
+	FrameStatistics::Summary s = stats.GetSummary();
+	CHECK(s.Frames == 100);
+	CHECK_NEAR(s.MeanMilliseconds, 50.5f, 1e-4f);
+	CHECK(s.P50Milliseconds == 50.0f);
+	CHECK(s.P95Milliseconds == 95.0f);
+	CHECK(s.P99Milliseconds == 99.0f);
+	CHECK(s.MaxMilliseconds == 100.0f);
+
+	// One frame is every percentile.
+	FrameStatistics single;
+	single.EndFrame(7.0f);
+	s = single.GetSummary();
+	CHECK(s.Frames == 1 && s.P50Milliseconds == 7.0f && s.P99Milliseconds == 7.0f && s.MaxMilliseconds == 7.0f);
+
+	// No frames, all zero.
+	FrameStatistics empty;
+	CHECK(empty.GetSummary().Frames == 0 && empty.GetSummary().MaxMilliseconds == 0.0f);
+}
+
+TEST(FrameStatistics, Hitches)
+{
+	FrameStatistics stats(256);
+	for(int i = 0; i < 100; ++i)
+		stats.EndFrame(16.0f);
+	CHECK(stats.HitchCount() == 0);
+
+	// Well above 2x the typical 16 ms.
+	stats.EndFrame(40.0f);
+	CHECK(stats.HitchCount() == 1);
+
+	// The hitch does not raise the bar, so a second one is caught too...
+	stats.EndFrame(40.0f);
+	CHECK(stats.HitchCount() == 2);
+
+	// ...while a somewhat slow frame is not a hitch.
+	stats.EndFrame(24.0f);
+	CHECK(stats.HitchCount() == 2);
+
+	std::vector<FrameStatistics::FrameRecord> frames = stats.GetFrames();
+	CHECK(frames.size() == 103);
+	CHECK(frames[100].Hitch && frames[101].Hitch && !frames[102].Hitch);
+
+	// Short frames need the absolute minimum as well: at 1 ms typical, 3 ms
+	// is three times slower but only 2 ms longer.
+	FrameStatistics fast;
+	for(int i = 0; i < 50; ++i)
+		fast.EndFrame(1.0f);
+	fast.EndFrame(3.0f);
+	CHECK(fast.HitchCount() == 0);
+	fast.EndFrame(6.0f);
+	CHECK(fast.HitchCount() == 1);
+
+	// A slow start becomes the typical time instead of a hitch.
+	FrameStatistics slowStart;
+	slowStart.EndFrame(100.0f);
+	slowStart.EndFrame(16.0f);
+	CHECK(slowStart.HitchCount() == 0);
+}
+
+TEST(FrameStatistics, RingAndReset)
+{
+	FrameStatistics stats(8);
+	for(int i = 0; i < 20; ++i)
+		stats.EndFrame((float)i);
+
+	std::vector<FrameStatistics::FrameRecord> frames = stats.GetFrames();
+	CHECK(frames.size() == 8);
+	for(size_t i = 0; i < frames.size(); ++i)
+	{
+		CHECK(frames[i].Index == 12 + i);
+		CHECK(frames[i].FrameMilliseconds == (float)(12 + i));
+	}
+	CHECK(stats.TotalFrames() == 20);
+
+	stats.Reset();
+	CHECK(stats.GetFrames().empty());
+	CHECK(stats.GetSummary().Frames == 0);
+
+	stats.EndFrame(1.0f);
+	stats.EndFrame(2.0f);
+	frames = stats.GetFrames();
+	CHECK(frames.size() == 2 && frames[0].Index == 20 && frames[1].FrameMilliseconds == 2.0f);
+	CHECK(stats.TotalFrames() == 22);
+}
+
+TEST(FrameStatistics, Stages)
+{
+	FrameStatistics stats(16);
+	std::uint32_t update = stats.AddStage("Update");
+	std::uint32_t draw = stats.AddStage("Draw");
+	CHECK(stats.StageCount() == 2 && stats.StageName(draw) == "Draw");
+
+	for(int i = 0; i < 10; ++i)
+	{
+		// Times add up within a frame and start from zero in the next.
+		stats.AddStageTime(update, 1.0f);
+		stats.AddStageTime(update, 0.5f);
+		stats.AddStageTime(draw, (float)i);
+		stats.EndFrame(16.0f);
+	}
+
+	std::vector<FrameStatistics::FrameRecord> frames = stats.GetFrames();
+	for(size_t i = 0; i < frames.size(); ++i)
+	{
+		CHECK(frames[i].StageMilliseconds[update] == 1.5f);
+		CHECK(frames[i].StageMilliseconds[draw] == (float)i);
+	}
+	CHECK(stats.GetStageSummary(update).P99Milliseconds == 1.5f);
+	CHECK(stats.GetStageSummary(draw).MaxMilliseconds == 9.0f);
+	CHECK(stats.GetStageSummary(draw).P50Milliseconds == 4.0f);
+
+	{
+		FrameStatistics::ScopedStage stage(stats, update);
+	}
+	stats.EndFrame(16.0f);
+	float scoped = stats.GetFrames().back().StageMilliseconds[update];
+	CHECK(scoped >= 0.0f && scoped < 1000.0f);
+}
+
+TEST(FrameStatistics, CsvAndJson)
+{
+	FrameStatistics stats(4);
+	std::uint32_t update = stats.AddStage("Update");
+	stats.AddStageTime(update, 2.0f);
+	stats.EndFrame(16.0f);
+	stats.AddStageTime(update, 3.0f);
+	stats.EndFrame(17.5f);
+
+	std::ostringstream csv;
+	stats.WriteCsv(csv);
+	CHECK(csv.str() ==
+		"frame,frame_ms,hitch,Update_ms\n"
+		"0,16.0000,0,2.0000\n"
+		"1,17.5000,0,3.0000\n");
+
+	std::ostringstream json;
+	stats.WriteJson(json);
+	CHECK(json.str() ==
+		"{\"frames\":2,\"hitches\":0,"
+		"\"frame\":{\"mean_ms\":16.7500,\"p50_ms\":16.0000,\"p95_ms\":17.5000,\"p99_ms\":17.5000,\"max_ms\":17.5000},"
+		"\"stages\":{\"Update\":{\"mean_ms\":2.5000,\"p50_ms\":2.0000,\"p95_ms\":3.0000,\"p99_ms\":3.0000,\"max_ms\":3.0000}}}\n");
+
+	CHECK(stats.SummaryToString() == "p50 16.00  p95 17.50  p99 17.50  max 17.50 ms  hitches 0");
+}
+
+TEST(FrameStatistics, ReadWhileRecording)
+{
+	// The recorder wraps a small ring while the main thread reads.  Every
+	// frame a reader gets must be complete: its times all derive from its
+	// index.
+	FrameStatistics stats(16);
+	std::uint32_t stage = stats.AddStage("Stage");
+	stats.SetHitchThreshold(1e9f, 1e9f);
+
+	const std::uint64_t frameCount = 200000;
+	std::thread recorder([&]()
+	{
+		for(std::uint64_t i = 0; i < frameCount; ++i)
+		{
+			stats.AddStageTime(stage, (float)(i % 4096) + 0.5f);
+			stats.EndFrame((float)(i % 4096));
+		}
+	});
+
+	std::uint32_t reads = 0;
+	while(stats.TotalFrames() < frameCount)
+	{
+		std::vector<FrameStatistics::FrameRecord> frames = stats.GetFrames();
+		CHECK(frames.size() <= 16);
+		for(size_t i = 0; i < frames.size(); ++i)
+		{
+			const FrameStatistics::FrameRecord& f = frames[i];
+			CHECK(f.FrameMilliseconds == (float)(f.Index % 4096));
+			CHECK(f.StageMilliseconds[stage] == (float)(f.Index % 4096) + 0.5f);
+			CHECK(i == 0 || f.Index == frames[i - 1].Index + 1);
+		}
+		++reads;
+	}
+	recorder.join();
+
+	CHECK(reads > 0);
+	CHECK(stats.GetFrames().size() == 16);
+}
+
+BENCHMARK(FrameStatistics, RecordAndSummarize)
+{
+	FrameStatistics stats(1024);
+	std::uint32_t update = stats.AddStage("Update");
+	std::uint32_t draw = stats.AddStage("Draw");
+	Random random(41);
+
+	bench.Run("1K frames recorded", [&]()
+	{
+		for(int i = 0; i < 1024; ++i)
+		{
+			stats.AddStageTime(update, 2.0f + random.NextFloat());
+			stats.AddStageTime(draw, 5.0f + random.NextFloat());
+			stats.EndFrame(16.0f + 4.0f*random.NextFloat());
+		}
+	});
+
+	volatile float sink = 0.0f;
+	bench.Run("summary of 1K frames", [&]()
+	{
+		sink = sink + stats.GetSummary().P99Milliseconds;
+	});
+}
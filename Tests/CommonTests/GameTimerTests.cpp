@@ -0,0 +1,116 @@
+//***************************************************************************************
+// GameTimerTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/Clock.h"
+#include "../../Common/FrameStatistics.h"
+#include "../../Common/GameTimer.h"
+
+TEST(GameTimer, TicksFollowTheClock)
+{
+	ManualClock clock;
+	clock.Set(123456789);
+
+	GameTimer timer(clock);
+	timer.Reset();
+
+	clock.Advance(0.016);
+	timer.Tick();
+	CHECK(timer.DeltaTime() == 0.016f);
+	CHECK_NEAR(timer.TotalTime(), 0.016f, 1e-6f);
+
+	clock.Advance(0.050);
+	timer.Tick();
+	CHECK_NEAR(timer.DeltaTime(), 0.050f, 1e-6f);
+	CHECK_NEAR(timer.TotalTime(), 0.066f, 1e-6f);
+
+	// A clock that does not move gives an empty frame.
+	timer.Tick();
+	CHECK(timer.DeltaTime() == 0.0f);
+	CHECK_NEAR(timer.TotalTime(), 0.066f, 1e-6f);
+}
+
+TEST(GameTimer, PauseIsNotCounted)
+{
+	ManualClock clock;
+	GameTimer timer(clock);
+	timer.Reset();
+
+	clock.Advance(1.0);
+	timer.Tick();
+
+	// Stopped: frames are empty and the total holds.
+	timer.Stop();
+	clock.Advance(5.0);
+	timer.Tick();
+	CHECK(timer.DeltaTime() == 0.0f);
+	CHECK_NEAR(timer.TotalTime(), 1.0f, 1e-6f);
+
+	// Stopping twice keeps the first stop time.
+	clock.Advance(2.0);
+	timer.Stop();
+
+	// The first frame after starting again only covers the time since then.
+	timer.Start();
+	clock.Advance(0.5);
+	timer.Tick();
+	CHECK_NEAR(timer.DeltaTime(), 0.5f, 1e-6f);
+	CHECK_NEAR(timer.TotalTime(), 1.5f, 1e-6f);
+
+	// Pauses add up.
+	timer.Stop();
+	clock.Advance(3.0);
+	timer.Start();
+	timer.Start();
+	clock.Advance(0.25);
+	timer.Tick();
+	CHECK_NEAR(timer.DeltaTime(), 0.25f, 1e-6f);
+	CHECK_NEAR(timer.TotalTime(), 1.75f, 1e-6f);
+}
+
+TEST(GameTimer, OverrideLastsOneFrame)
+{
+	ManualClock clock;
+	GameTimer timer(clock);
+	timer.Reset();
+
+	clock.Advance(0.1);
+	timer.Tick();
+
+	// A replayed frame time replaces the clock's until the next Tick.
+	timer.Override(42.0f, 0.02f);
+	CHECK(timer.TotalTime() == 42.0f && timer.DeltaTime() == 0.02f);
+
+	clock.Advance(0.1);
+	timer.Tick();
+	CHECK_NEAR(timer.DeltaTime(), 0.1f, 1e-6f);
+	CHECK_NEAR(timer.TotalTime(), 0.2f, 1e-6f);
+}
+
+TEST(GameTimer, RecordsFrameStatistics)
+{
+	ManualClock clock;
+	GameTimer timer(clock);
+	timer.Reset();
+
+	FrameStatistics stats(16);
+	timer.SetFrameStatistics(&stats);
+
+	const double frameSeconds[] = { 0.016, 0.033, 0.010 };
+	for(double seconds : frameSeconds)
+	{
+		clock.Advance(seconds);
+		timer.Tick();
+	}
+
+	// Paused frames are not frames.
+	timer.Stop();
+	clock.Advance(1.0);
+	timer.Tick();
+
+	std::vector<FrameStatistics::FrameRecord> frames = stats.GetFrames();
+	CHECK(frames.size() == 3);
+	for(size_t i = 0; i < frames.size() && i < 3; ++i)
+		CHECK_NEAR(frames[i].FrameMilliseconds, (float)(frameSeconds[i] * 1000.0), 1e-3f);
+}
@@ -0,0 +1,234 @@
+//***************************************************************************************
+// HeadlessRunnerTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/HeadlessRunner.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const char* const CsvFile = "HeadlessRunnerTests.tmp.csv";
+	const char* const JsonFile = "HeadlessRunnerTests.tmp.json";
+
+	// Busy time of each warm-up frame; recorded frames are far quicker.
+	const int WarmupMilliseconds = 20;
+
+	// Records the times it is given and draws two packets a frame.  Warm-up
+	// frames are made slow, so any of them counted would show in the stats.
+	class TestApp : public HeadlessApp
+	{
+	public:
+		explicit TestApp(std::uint32_t warmupFrames, bool initializes = true) :
+			mWarmupFrames(warmupFrames), mInitializes(initializes)
+		{
+		}
+
+		virtual bool Initialize()override
+		{
+			InitializeCalls++;
+			return mInitializes;
+		}
+
+		virtual void Update(float totalTime, float deltaTime)override
+		{
+			TotalTimes.push_back(totalTime);
+			DeltaTimes.push_back(deltaTime);
+
+			if(TotalTimes.size() <= mWarmupFrames)
+			{
+				auto start = std::chrono::steady_clock::now();
+				while(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(WarmupMilliseconds))
+				{
+				}
+			}
+		}
+
+		virtual void Draw(DrawPacketRecorder& recorder)override
+		{
+			DrawPacket packet;
+			recorder.SetPipelineState(0);
+			recorder.SetObjectCB(256);
+			recorder.DrawIndexedInstanced(packet);
+			recorder.SetObjectCB(512);
+			recorder.DrawIndexedInstanced(packet);
+			DrawCalls++;
+		}
+
+		std::uint32_t InitializeCalls = 0;
+		std::uint32_t DrawCalls = 0;
+		std::vector<float> TotalTimes;
+		std::vector<float> DeltaTimes;
+
+	private:
+		std::uint32_t mWarmupFrames;
+		bool mInitializes;
+	};
+
+	std::vector<std::string> ReadLines(const std::string& filename)
+	{
+		std::vector<std::string> lines;
+		std::ifstream fin(filename);
+		std::string line;
+		while(std::getline(fin, line))
+			lines.push_back(line);
+		return lines;
+	}
+}
+
+TEST(HeadlessRunner, ParseArguments)
+{
+	// Nothing but the program name and -headless keeps the defaults.
+	HeadlessRunner::Settings settings;
+	const char* defaults[] = { "LandAndWaves.exe", "-headless" };
+	CHECK(HeadlessRunner::ParseArguments(2, defaults, &settings));
+	CHECK(settings.Frames == 1000 && settings.WarmupFrames == 60);
+	CHECK(settings.DeltaTime == 1.0f / 60.0f);
+	CHECK(settings.CsvFile.empty() && settings.JsonFile.empty());
+
+	const char* all[] = { "LandAndWaves.exe", "-frames", "250", "-headless", "-warmup", "0",
+		"-dt", "0.02", "-csv", "frames.csv", "-json", "summary.json" };
+	CHECK(HeadlessRunner::ParseArguments(12, all, &settings));
+	CHECK(settings.Frames == 250 && settings.WarmupFrames == 0);
+	CHECK(settings.DeltaTime == 0.02f);
+	CHECK(settings.CsvFile == "frames.csv" && settings.JsonFile == "summary.json");
+
+	// Unknown options, missing and bad values.
+	auto fails = [](std::vector<const char*> args)
+	{
+		HeadlessRunner::Settings s;
+		args.insert(args.begin(), "LandAndWaves.exe");
+		return !HeadlessRunner::ParseArguments((int)args.size(), args.data(), &s);
+	};
+	CHECK(fails({ "-fps", "60" }));
+	CHECK(fails({ "frames", "60" }));
+	CHECK(fails({ "-frames" }));
+	CHECK(fails({ "-frames", "0" }));
+	CHECK(fails({ "-frames", "-5" }));
+	CHECK(fails({ "-frames", "10x" }));
+	CHECK(fails({ "-warmup", "" }));
+	CHECK(fails({ "-dt", "0" }));
+	CHECK(fails({ "-dt", "-0.1" }));
+	CHECK(fails({ "-dt", "fast" }));
+	CHECK(fails({ "-frames", "10", "-csv" }));
+}
+
+TEST(HeadlessRunner, ParseCommandLine)
+{
+	// WinMain gets no program name; quotes keep a file name with spaces
+	// together, tabs and repeated spaces separate.
+	HeadlessRunner::Settings settings;
+	CHECK(HeadlessRunner::ParseCommandLine(
+		"-headless  -frames 200\t-csv \"my frames.csv\" -json out.json", &settings));
+	CHECK(settings.Frames == 200);
+	CHECK(settings.CsvFile == "my frames.csv" && settings.JsonFile == "out.json");
+
+	// Quotes in the middle of an argument do not split it.
+	CHECK(HeadlessRunner::ParseCommandLine("-csv C:\\\"Run Logs\"\\frames.csv", &settings));
+	CHECK(settings.CsvFile == "C:\\Run Logs\\frames.csv");
+
+	// An empty quoted value is still a value.
+	CHECK(HeadlessRunner::ParseCommandLine("-json \"\"", &settings));
+	CHECK(settings.JsonFile.empty());
+
+	HeadlessRunner::Settings defaults;
+	CHECK(HeadlessRunner::ParseCommandLine("", &defaults));
+	CHECK(defaults.Frames == 1000);
+
+	CHECK(!HeadlessRunner::ParseCommandLine("-frames", &settings));
+	CHECK(!HeadlessRunner::ParseCommandLine("-headless -dt 1/60", &settings));
+}
+
+TEST(HeadlessRunner, Run)
+{
+	HeadlessRunner::Settings settings;
+	settings.Frames = 10;
+	settings.WarmupFrames = 3;
+	settings.DeltaTime = 0.025f;
+
+	HeadlessRunner runner(settings);
+	TestApp app(settings.WarmupFrames);
+	CHECK(runner.Run(app));
+
+	// Every frame runs with the fixed step, warm-up included, and the total
+	// time follows the frame index.
+	CHECK(app.InitializeCalls == 1);
+	CHECK(app.TotalTimes.size() == 13 && app.DrawCalls == 13);
+	for(size_t i = 0; i < app.TotalTimes.size(); ++i)
+	{
+		CHECK(app.DeltaTimes[i] == 0.025f);
+		CHECK_NEAR(app.TotalTimes[i], 0.025f*(i + 1), 1e-6f);
+	}
+
+	// Only the recorded frames count, for the stats and the commands.
+	const HeadlessRunner::Report& report = runner.GetReport();
+	CHECK(report.Frames == 10 && report.DeltaTime == 0.025f);
+	CHECK(report.Frame.Frames == 10 && report.Update.Frames == 10 && report.Draw.Frames == 10);
+	CHECK(runner.GetFrameStats().GetFrames().size() == 10);
+	CHECK(report.Frame.MaxMilliseconds < WarmupMilliseconds);
+	CHECK(report.TotalMilliseconds < WarmupMilliseconds);
+
+	CHECK(report.Commands.Draws == 20 && report.Commands.ObjectCBs == 20);
+	CHECK(report.Commands.PipelineStates == 10 && report.Commands.Total() == 50);
+
+	std::string text = report.ToString();
+	CHECK(text.find("Headless run: 10 frames of 25.000 ms") == 0);
+	CHECK(text.find("Commands per frame: 5.0 (draws 2.0, PSOs 1.0, geometries 0.0, topologies 0.0, materials 0.0, object CBs 2.0)") != std::string::npos);
+
+	// Running again starts over.
+	TestApp again(0);
+	CHECK(runner.Run(again));
+	CHECK(runner.GetReport().Commands.Draws == 20);
+	CHECK(runner.GetFrameStats().GetFrames().size() == 10);
+
+	// A failed Initialize runs no frames.
+	TestApp failing(0, false);
+	CHECK(!runner.Run(failing));
+	CHECK(failing.TotalTimes.empty() && failing.DrawCalls == 0);
+}
+
+TEST(HeadlessRunner, WritesStatistics)
+{
+	HeadlessRunner::Settings settings;
+	settings.Frames = 5;
+	settings.WarmupFrames = 2;
+	settings.CsvFile = CsvFile;
+	settings.JsonFile = JsonFile;
+
+	HeadlessRunner runner(settings);
+	TestApp app(0);
+	CHECK(runner.Run(app));
+
+	// One line per recorded frame, with both stages.
+	std::vector<std::string> csv = ReadLines(CsvFile);
+	CHECK(csv.size() == 6);
+	if(!csv.empty())
+		CHECK(csv[0] == "frame,frame_ms,hitch,Update_ms,Draw_ms");
+	if(csv.size() > 1)
+		CHECK(csv[1].find("0,") == 0);
+
+	std::vector<std::string> json = ReadLines(JsonFile);
+	CHECK(json.size() == 1);
+	if(!json.empty())
+	{
+		CHECK(json[0].find("{\"frames\":5,") == 0);
+		CHECK(json[0].find("\"Update\":") != std::string::npos);
+		CHECK(json[0].find("\"Draw\":") != std::string::npos);
+	}
+
+	std::remove(CsvFile);
+	std::remove(JsonFile);
+
+	// A file that cannot be written fails the run, after the frames ran.
+	settings.CsvFile = "HeadlessRunnerTests.Missing/frames.csv";
+	settings.JsonFile.clear();
+	HeadlessRunner failing(settings);
+	TestApp app2(0);
+	CHECK(!failing.Run(app2));
+	CHECK(app2.TotalTimes.size() == 7);
+	CHECK(failing.GetReport().Frames == 5);
+}
@@ -0,0 +1,198 @@
+//***************************************************************************************
+// InputLogTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/InputLog.h"
+#include "../../Common/Random.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	typedef InputLog::EventType EventType;
+
+	const char* const LogFile = "InputLogTests.tmp.ilog";
+
+	// What a run would record: a few hundred frames of varying length, with
+	// drags, clicks and key presses on some of them.
+	InputLog MakeLog(std::uint64_t seed)
+	{
+		Random random(seed);
+		InputLog log;
+
+		for(int frame = 0; frame < 300; ++frame)
+		{
+			log.BeginFrame(random.NextFloat(0.004f, 0.05f));
+
+			std::uint32_t events = random.NextUInt(4) == 0 ? random.NextUInt(6) : 0;
+			for(std::uint32_t e = 0; e < events; ++e)
+			{
+				switch(random.NextUInt(5))
+				{
+				case 0: log.AddEvent(InputLog::KeyEvent('1' + random.NextInt(0, 8), true)); break;
+				case 1: log.AddEvent(InputLog::KeyEvent('W', false)); break;
+				default:
+					log.AddEvent(InputLog::MouseEvent((EventType)random.NextUInt(3), random.NextUInt(4),
+						random.NextInt(-100, 2000), random.NextInt(-100, 1200)));
+					break;
+				}
+			}
+		}
+
+		return log;
+	}
+
+	bool SameEvent(const InputLog::Event& a, const InputLog::Event& b)
+	{
+		return a.Type == b.Type && a.Code == b.Code && a.X == b.X && a.Y == b.Y;
+	}
+
+	bool SameLog(const InputLog& a, const InputLog& b)
+	{
+		if(a.FrameCount() != b.FrameCount())
+			return false;
+
+		for(std::uint32_t f = 0; f < a.FrameCount(); ++f)
+		{
+			const InputLog::Frame& fa = a.GetFrame(f);
+			const InputLog::Frame& fb = b.GetFrame(f);
+			if(fa.DeltaTime != fb.DeltaTime || fa.FirstEvent != fb.FirstEvent || fa.EventCount != fb.EventCount)
+				return false;
+
+			for(std::uint32_t e = 0; e < fa.EventCount; ++e)
+			{
+				if(!SameEvent(a.GetEvent(fa.FirstEvent + e), b.GetEvent(fb.FirstEvent + e)))
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	std::string ReadFile(const std::string& filename)
+	{
+		std::ifstream fin(filename, std::ios::binary);
+		std::ostringstream s;
+		s << fin.rdbuf();
+		return s.str();
+	}
+
+	void WriteFile(const std::string& filename, const std::string& bytes)
+	{
+		std::ofstream fout(filename, std::ios::binary | std::ios::trunc);
+		fout.write(bytes.data(), bytes.size());
+	}
+}
+
+TEST(InputLog, RecordSaveLoad)
+{
+	InputLog recorded = MakeLog(49);
+	CHECK(recorded.Save(LogFile) == InputLog::Status::Ok);
+
+	std::uint32_t events = 0;
+	for(std::uint32_t f = 0; f < recorded.FrameCount(); ++f)
+		events += recorded.GetFrame(f).EventCount;
+	CHECK(events > 0);
+
+	// 16 bytes of header, 8 per frame and 6 per event.
+	CHECK(ReadFile(LogFile).size() == 16 + 8 * recorded.FrameCount() + 6 * events);
+
+	// Loading replaces whatever was there.
+	InputLog replayed = MakeLog(7);
+	CHECK(replayed.Load(LogFile) == InputLog::Status::Ok);
+	CHECK(SameLog(recorded, replayed));
+
+	// Saving what was loaded gives the same file back.
+	std::string first = ReadFile(LogFile);
+	CHECK(replayed.Save(LogFile) == InputLog::Status::Ok);
+	CHECK(ReadFile(LogFile) == first);
+
+	// So does an empty log.
+	InputLog empty;
+	CHECK(empty.Save(LogFile) == InputLog::Status::Ok);
+	CHECK(replayed.Load(LogFile) == InputLog::Status::Ok);
+	CHECK(replayed.FrameCount() == 0);
+
+	std::remove(LogFile);
+}
+
+TEST(InputLog, Recording)
+{
+	InputLog log;
+
+	// Nothing to attach an event to before the first frame.
+	log.AddEvent(InputLog::KeyEvent('1', true));
+	CHECK(log.FrameCount() == 0);
+
+	log.BeginFrame(0.016f);
+	log.AddEvent(InputLog::MouseEvent(EventType::MouseDown, 1, 40000, -40000));
+	log.AddEvent(InputLog::KeyEvent('1', false));
+	log.BeginFrame(0.017f);
+	log.BeginFrame(0.018f);
+	log.AddEvent(InputLog::MouseEvent(EventType::MouseMove, 0, 12, 34));
+
+	CHECK(log.FrameCount() == 3);
+	CHECK(log.GetFrame(0).FirstEvent == 0 && log.GetFrame(0).EventCount == 2);
+	CHECK(log.GetFrame(1).FirstEvent == 2 && log.GetFrame(1).EventCount == 0);
+	CHECK(log.GetFrame(2).FirstEvent == 2 && log.GetFrame(2).EventCount == 1);
+
+	// Coordinates outside 16 bits are clamped, not wrapped.
+	const InputLog::Event& down = log.GetEvent(0);
+	CHECK(down.Type == EventType::MouseDown && down.Code == 1);
+	CHECK(down.X == 32767 && down.Y == -32768);
+
+	const InputLog::Event& up = log.GetEvent(1);
+	CHECK(up.Type == EventType::KeyUp && up.Code == '1');
+
+	const InputLog::Event& move = log.GetEvent(2);
+	CHECK(move.X == 12 && move.Y == 34);
+
+	log.Clear();
+	CHECK(log.FrameCount() == 0);
+}
+
+TEST(InputLog, RejectsBadFiles)
+{
+	InputLog log;
+	CHECK(log.Load("InputLogTests.Missing.tmp.ilog") == InputLog::Status::OpenFailed);
+
+	CHECK(MakeLog(49).Save(LogFile) == InputLog::Status::Ok);
+	const std::string good = ReadFile(LogFile);
+
+	// Every corruption fails to load and leaves the log empty.
+	auto check = [&](const std::string& bytes)
+	{
+		WriteFile(LogFile, bytes);
+		CHECK(log.Load(LogFile) == InputLog::Status::BadFormat);
+		CHECK(log.FrameCount() == 0);
+	};
+
+	// Truncated in the header, the frames and the events.
+	check(good.substr(0, 10));
+	check(good.substr(0, 16 + 8 * 100));
+	check(good.substr(0, good.size() - 1));
+
+	// Another file type or version.
+	std::string bytes = good;
+	bytes[0] = 'X';
+	check(bytes);
+	bytes = good;
+	bytes[4] = 2;
+	check(bytes);
+
+	// Frames that claim more events than the file holds.
+	bytes = good;
+	bytes[16 + 4] = (char)(bytes[16 + 4] + 1);
+	check(bytes);
+
+	// An unknown event type.
+	bytes = good;
+	bytes[16 + 8 * 300] = 9;
+	check(bytes);
+
+	std::remove(LogFile);
+}
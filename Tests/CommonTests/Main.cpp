@@ -0,0 +1,63 @@
+//***************************************************************************************
+// Main.cpp by DanielDFY
+//
+// Console runner for the tests and benchmarks of the portable Common modules.
+//
+//   CommonTests                 runs every test
+//   CommonTests Meshlet         runs the tests whose "Group.Name" contains "Meshlet"
+//   CommonTests -bench [filter] runs the benchmarks instead (use a Release build)
+//
+// Returns the number of failed tests, so it can gate a build step.  The project
+// only uses Common code that builds without the Windows SDK, so on Linux it
+// builds with
+//   g++ -std=c++14 -O2 -pthread *.cpp <the ..\..\Common .cpp files of CommonTests.vcxproj>
+// and runs from this directory (the tests read ../../Models and ../../Textures).
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include <cstring>
+
+int main(int argc, char* argv[])
+{
+	bool bench = false;
+	const char* filter = nullptr;
+	for(int i = 1; i < argc; ++i)
+	{
+		if(std::strcmp(argv[i], "-bench") == 0)
+			bench = true;
+		else
+			filter = argv[i];
+	}
+
+	int run = 0;
+	int failed = 0;
+	for(const TestFramework::Entry& e : TestFramework::Registry())
+	{
+		if(filter != nullptr && e.Name.find(filter) == std::string::npos)
+			continue;
+
+		if(bench && e.Bench)
+		{
+			std::printf("[ BENCH ] %s\n", e.Name.c_str());
+			TestFramework::Benchmark b;
+			e.Bench(b);
+			++run;
+		}
+		else if(!bench && e.Test)
+		{
+			TestFramework::CurrentFailures() = 0;
+			e.Test();
+			bool ok = TestFramework::CurrentFailures() == 0;
+			std::printf("[ %s ] %s\n", ok ? " OK " : "FAIL", e.Name.c_str());
+			failed += ok ? 0 : 1;
+			++run;
+		}
+	}
+
+	if(bench)
+		std::printf("%d benchmarks run\n", run);
+	else
+		std::printf("%d tests run, %d failed\n", run, failed);
+
+	return failed;
+}
@@ -0,0 +1,422 @@
+//***************************************************************************************
+// MeshletTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/Meshlet.h"
+#include <algorithm>
+#include <array>
+#include <fstream>
+
+using namespace SimdMath;
+
+namespace
+{
+	struct SkullMesh
+	{
+		std::vector<Float3> Positions;
+		std::vector<std::uint32_t> Indices;
+	};
+
+	// Same file and layout as the skull demos read.
+	bool LoadSkull(SkullMesh& skull)
+	{
+		std::ifstream fin("../../Models/skull.txt");
+		if(!fin)
+			return false;
+
+		std::uint32_t vcount = 0;
+		std::uint32_t tcount = 0;
+		std::string ignore;
+
+		fin >> ignore >> vcount;
+		fin >> ignore >> tcount;
+		fin >> ignore >> ignore >> ignore >> ignore;
+
+		skull.Positions.resize(vcount);
+		for(std::uint32_t i = 0; i < vcount; ++i)
+		{
+			Float3 normal;
+			fin >> skull.Positions[i].x >> skull.Positions[i].y >> skull.Positions[i].z;
+			fin >> normal.x >> normal.y >> normal.z;
+		}
+
+		fin >> ignore >> ignore >> ignore;
+
+		skull.Indices.resize(3*tcount);
+		for(std::uint32_t& index : skull.Indices)
+			fin >> index;
+
+		return (bool)fin;
+	}
+
+	const SkullMesh& Skull()
+	{
+		static SkullMesh skull;
+		static bool loaded = LoadSkull(skull);
+		if(!loaded)
+			TestFramework::Fail(__FILE__, __LINE__, "../../Models/skull.txt not found");
+		return skull;
+	}
+
+	const MeshletMesh& SkullMeshlets()
+	{
+		static MeshletMesh mesh;
+		static bool built = false;
+		if(!built)
+		{
+			const SkullMesh& skull = Skull();
+			MeshletBuilder::Build(skull.Positions.data(), sizeof(Float3), (std::uint32_t)skull.Positions.size(),
+				skull.Indices.data(), (std::uint32_t)skull.Indices.size(), mesh);
+			built = true;
+		}
+		return mesh;
+	}
+
+	Vector FaceNormal(const SkullMesh& skull, const std::uint32_t* tri)
+	{
+		Vector p0 = LoadFloat3(&skull.Positions[tri[0]]);
+		Vector p1 = LoadFloat3(&skull.Positions[tri[1]]);
+		Vector p2 = LoadFloat3(&skull.Positions[tri[2]]);
+		return Vector3Cross(VectorSubtract(p1, p0), VectorSubtract(p2, p0));
+	}
+
+	// Camera at eye looking at the skull, with the lens of the demos.
+	Float4x4 ViewProj(Vector eye)
+	{
+		Matrix view = MatrixLookAtLH(eye, VectorZero(), VectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		Matrix proj = MatrixPerspectiveFovLH(0.25f*Pi, 1.333f, 1.0f, 1000.0f);
+
+		Float4x4 m;
+		StoreFloat4x4(&m, MatrixMultiply(view, proj));
+		return m;
+	}
+
+	bool InsideClipVolume(const Float4x4& m, const Float3& p)
+	{
+		Vector clip = Vector4Transform(VectorSet(p.x, p.y, p.z, 1.0f), LoadFloat4x4(&m));
+		float x = VectorGetX(clip);
+		float y = VectorGetY(clip);
+		float z = VectorGetZ(clip);
+		float w = VectorGetW(clip);
+		return -w <= x && x <= w && -w <= y && y <= w && 0.0f <= z && z <= w;
+	}
+}
+
+TEST(Meshlet, BuildCoversEveryTriangleOnce)
+{
+	const SkullMesh& skull = Skull();
+	const MeshletMesh& mesh = SkullMeshlets();
+
+	CHECK(mesh.Indices.size() == skull.Indices.size());
+
+	std::uint32_t triangles = 0;
+	for(const Meshlet& m : mesh.Meshlets)
+	{
+		CHECK(m.VertexCount <= MeshletBuilder::MaxVertices);
+		CHECK(m.TriangleCount <= MeshletBuilder::MaxTriangles);
+		CHECK(m.IndexOffset == triangles*3);
+		triangles += m.TriangleCount;
+
+		// Every index of the meshlet refers to one of its unique vertices.
+		auto first = mesh.UniqueVertices.begin() + m.VertexOffset;
+		auto last = first + m.VertexCount;
+		for(std::uint32_t i = 0; i < m.TriangleCount*3; ++i)
+			CHECK(std::find(first, last, mesh.Indices[m.IndexOffset + i]) != last);
+	}
+	CHECK(triangles*3 == skull.Indices.size());
+
+	// The reordered index buffer holds the same triangles, winding included.
+	auto sortedTriangles = [](const std::vector<std::uint32_t>& indices)
+	{
+		std::vector<std::array<std::uint32_t, 3>> tris(indices.size() / 3);
+		for(size_t t = 0; t < tris.size(); ++t)
+		{
+			std::array<std::uint32_t, 3> tri = { indices[t*3], indices[t*3 + 1], indices[t*3 + 2] };
+
+			// Rotate the smallest index to the front, which keeps the winding.
+			while(tri[0] > tri[1] || tri[0] > tri[2])
+				tri = { tri[1], tri[2], tri[0] };
+			tris[t] = tri;
+		}
+		std::sort(tris.begin(), tris.end());
+		return tris;
+	};
+	CHECK(sortedTriangles(mesh.Indices) == sortedTriangles(skull.Indices));
+}
+
+TEST(Meshlet, BuildWith16BitIndicesMatches32Bit)
+{
+	// 16x16 quad grid in the xz plane.
+	const std::uint32_t n = 16;
+	std::vector<Float3> positions;
+	for(std::uint32_t z = 0; z <= n; ++z)
+	{
+		for(std::uint32_t x = 0; x <= n; ++x)
+			positions.push_back(Float3((float)x, 0.0f, (float)z));
+	}
+
+	std::vector<std::uint32_t> indices32;
+	for(std::uint32_t z = 0; z < n; ++z)
+	{
+		for(std::uint32_t x = 0; x < n; ++x)
+		{
+			std::uint32_t i = z*(n + 1) + x;
+			indices32.insert(indices32.end(), { i, i + n + 1, i + 1, i + 1, i + n + 1, i + n + 2 });
+		}
+	}
+	std::vector<std::uint16_t> indices16(indices32.begin(), indices32.end());
+
+	MeshletMesh a;
+	MeshletMesh b;
+	MeshletBuilder::Build(positions.data(), sizeof(Float3), (std::uint32_t)positions.size(),
+		indices32.data(), (std::uint32_t)indices32.size(), a, 32, 32);
+	MeshletBuilder::Build(positions.data(), sizeof(Float3), (std::uint32_t)positions.size(),
+		indices16.data(), (std::uint32_t)indices16.size(), b, 32, 32);
+
+	CHECK(a.Meshlets.size() == b.Meshlets.size());
+	CHECK(a.Indices == b.Indices);
+	CHECK(a.UniqueVertices == b.UniqueVertices);
+	for(const Meshlet& m : a.Meshlets)
+	{
+		CHECK(m.VertexCount <= 32);
+		CHECK(m.TriangleCount <= 32);
+	}
+}
+
+TEST(Meshlet, SphereContainsVertices)
+{
+	const SkullMesh& skull = Skull();
+	const MeshletMesh& mesh = SkullMeshlets();
+
+	for(const Meshlet& m : mesh.Meshlets)
+	{
+		Vector center = LoadFloat3(&m.Bounds.Center);
+		float maxDist = 0.0f;
+		for(std::uint32_t i = 0; i < m.VertexCount; ++i)
+		{
+			Vector p = LoadFloat3(&skull.Positions[mesh.UniqueVertices[m.VertexOffset + i]]);
+			maxDist = std::max(maxDist, VectorGetX(Vector3Length(VectorSubtract(p, center))));
+		}
+		CHECK(maxDist <= m.Bounds.Radius*1.0001f + 1e-5f);
+	}
+}
+
+TEST(Meshlet, ConeContainsFaceNormals)
+{
+	const SkullMesh& skull = Skull();
+	const MeshletMesh& mesh = SkullMeshlets();
+
+	std::uint32_t withCone = 0;
+	for(const Meshlet& m : mesh.Meshlets)
+	{
+		if(m.ConeCutoff > 1.0f)
+			continue;
+		++withCone;
+
+		// cos(half angle) of the cone.
+		float minDot = sqrtf(1.0f - m.ConeCutoff*m.ConeCutoff);
+		Vector axis = LoadFloat3(&m.ConeAxis);
+		for(std::uint32_t t = 0; t < m.TriangleCount; ++t)
+		{
+			Vector n = FaceNormal(skull, &mesh.Indices[m.IndexOffset + t*3]);
+			if(VectorGetX(Vector3LengthSq(n)) < 1e-20f)
+				continue;
+			CHECK(VectorGetX(Vector3Dot(Vector3Normalize(n), axis)) >= minDot - 1e-4f);
+		}
+	}
+
+	// The skull is curved and noisy, so only part of its meshlets get a usable
+	// cone (about 40% at 64 vertices, see the Meshlet.Build benchmark).
+	CHECK(withCone > 0);
+}
+
+TEST(Meshlet, BackfaceRejectionIsConservative)
+{
+	const SkullMesh& skull = Skull();
+	const MeshletMesh& mesh = SkullMeshlets();
+
+	const Float3 eyes[] =
+	{
+		Float3(0.0f, 0.0f, -20.0f), Float3(0.0f, 0.0f, 20.0f), Float3(20.0f, 5.0f, 0.0f),
+		Float3(-15.0f, -10.0f, 5.0f), Float3(2.0f, 1.0f, -6.0f),
+	};
+
+	std::uint32_t culled = 0;
+	for(const Float3& eye : eyes)
+	{
+		Vector e = LoadFloat3(&eye);
+		for(const Meshlet& m : mesh.Meshlets)
+		{
+			if(!MeshletCuller::IsBackfacing(m, eye))
+				continue;
+			++culled;
+
+			// Clockwise front faces: the triangle faces away when the eye is on
+			// the negative side of its plane.
+			for(std::uint32_t t = 0; t < m.TriangleCount; ++t)
+			{
+				const std::uint32_t* tri = &mesh.Indices[m.IndexOffset + t*3];
+				Vector n = FaceNormal(skull, tri);
+				Vector toEye = VectorSubtract(e, LoadFloat3(&skull.Positions[tri[0]]));
+				CHECK(VectorGetX(Vector3Dot(n, toEye)) <= 1e-4f);
+			}
+		}
+	}
+
+	CHECK(culled > 0);
+}
+
+TEST(Meshlet, FrustumPlanes)
+{
+	Float4x4 viewProj = ViewProj(VectorSet(0.0f, 0.0f, -20.0f, 1.0f));
+	MeshletFrustum f = MeshletFrustum::FromMatrix(viewProj);
+
+	for(const Float4& plane : f.Planes)
+		CHECK_NEAR(VectorGetX(Vector3Length(LoadFloat4(&plane))), 1.0f, 1e-5f);
+
+	MeshletSphere s;
+	s.Radius = 1.0f;
+
+	s.Center = Float3(0.0f, 0.0f, 0.0f);
+	CHECK(f.Intersects(s));
+
+	// Behind the camera, beyond the far plane and far to the side.
+	s.Center = Float3(0.0f, 0.0f, -25.0f);
+	CHECK(!f.Intersects(s));
+	s.Center = Float3(0.0f, 0.0f, 1000.0f);
+	CHECK(!f.Intersects(s));
+	s.Center = Float3(100.0f, 0.0f, 0.0f);
+	CHECK(!f.Intersects(s));
+
+	// Just outside the near plane (z = -19 in world space) but overlapping it.
+	s.Center = Float3(0.0f, 0.0f, -19.5f);
+	CHECK(f.Intersects(s));
+	s.Radius = 0.25f;
+	CHECK(!f.Intersects(s));
+}
+
+TEST(Meshlet, CullKeepsEveryVisibleTriangle)
+{
+	const SkullMesh& skull = Skull();
+	const MeshletMesh& mesh = SkullMeshlets();
+
+	// Close enough that the skull does not fit the view.
+	Float3 eye(1.0f, 2.0f, -7.0f);
+	Float4x4 viewProj = ViewProj(LoadFloat3(&eye));
+	MeshletFrustum f = MeshletFrustum::FromMatrix(viewProj);
+
+	std::vector<std::uint32_t> visible;
+	MeshletCuller::Stats stats;
+	MeshletCuller::Cull(mesh, f, eye, visible, &stats);
+
+	CHECK(stats.MeshletsTested == mesh.Meshlets.size());
+	CHECK(stats.MeshletsVisible == visible.size());
+	CHECK(stats.FrustumCulled + stats.BackfaceCulled + stats.MeshletsVisible == stats.MeshletsTested);
+	CHECK(stats.FrustumCulled > 0);
+	CHECK(stats.BackfaceCulled > 0);
+	CHECK(std::is_sorted(visible.begin(), visible.end()));
+
+	// A meshlet rejected by the frustum has no vertex inside the clip volume.
+	std::vector<bool> isVisible(mesh.Meshlets.size(), false);
+	for(std::uint32_t i : visible)
+		isVisible[i] = true;
+	for(std::uint32_t i = 0; i < (std::uint32_t)mesh.Meshlets.size(); ++i)
+	{
+		const Meshlet& m = mesh.Meshlets[i];
+		if(isVisible[i] || MeshletCuller::IsBackfacing(m, eye))
+			continue;
+		for(std::uint32_t v = 0; v < m.VertexCount; ++v)
+			CHECK(!InsideClipVolume(viewProj, skull.Positions[mesh.UniqueVertices[m.VertexOffset + v]]));
+	}
+
+	// The draw ranges cover exactly the visible meshlets.
+	std::vector<MeshletCuller::DrawRange> ranges;
+	MeshletCuller::BuildDrawRanges(mesh, visible, ranges);
+
+	std::uint32_t rangeIndices = 0;
+	for(const MeshletCuller::DrawRange& r : ranges)
+		rangeIndices += r.IndexCount;
+	CHECK(rangeIndices == stats.TrianglesVisible*3);
+	CHECK(ranges.size() <= visible.size());
+
+	std::vector<std::uint32_t> all(mesh.Meshlets.size());
+	for(std::uint32_t i = 0; i < (std::uint32_t)all.size(); ++i)
+		all[i] = i;
+	MeshletCuller::BuildDrawRanges(mesh, all, ranges);
+	CHECK(ranges.size() == 1 && ranges[0].IndexCount == mesh.Indices.size());
+}
+
+BENCHMARK(Meshlet, Build)
+{
+	const SkullMesh& skull = Skull();
+
+	MeshletMesh mesh;
+	bench.Run("skull (31076 v, 60339 t)", [&]()
+	{
+		MeshletBuilder::Build(skull.Positions.data(), sizeof(Float3), (std::uint32_t)skull.Positions.size(),
+			skull.Indices.data(), (std::uint32_t)skull.Indices.size(), mesh);
+	}, 1.0);
+
+	std::uint32_t withCone = 0;
+	for(const Meshlet& m : mesh.Meshlets)
+		withCone += m.ConeCutoff <= 1.0f ? 1 : 0;
+
+	bench.Report("meshlets", (double)mesh.Meshlets.size());
+	bench.Report("vertices per meshlet", (double)mesh.UniqueVertices.size() / mesh.Meshlets.size());
+	bench.Report("triangles per meshlet", (double)mesh.Indices.size() / 3 / mesh.Meshlets.size());
+	bench.Report("vertex duplication", (double)mesh.UniqueVertices.size() / skull.Positions.size(), "x");
+	bench.Report("meshlets with a cone", 100.0*withCone / mesh.Meshlets.size(), "%");
+}
+
+BENCHMARK(Meshlet, Cull)
+{
+	const MeshletMesh& mesh = SkullMeshlets();
+
+	// Orbit the skull at two distances: fully in view and partly out of view.
+	struct View
+	{
+		Float3 Eye;
+		MeshletFrustum Frustum;
+	};
+	std::vector<View> views;
+	for(float radius : { 20.0f, 8.0f })
+	{
+		for(int i = 0; i < 8; ++i)
+		{
+			float angle = TwoPi*i / 8.0f;
+			View v;
+			v.Eye = Float3(radius*cosf(angle), 3.0f, radius*sinf(angle));
+			v.Frustum = MeshletFrustum::FromMatrix(ViewProj(LoadFloat3(&v.Eye)));
+			views.push_back(v);
+		}
+	}
+
+	std::vector<std::uint32_t> visible;
+	visible.reserve(mesh.Meshlets.size());
+	bench.Run("16 views", [&]()
+	{
+		for(const View& v : views)
+		{
+			visible.clear();
+			MeshletCuller::Cull(mesh, v.Frustum, v.Eye, visible);
+		}
+	});
+
+	double tested = 0.0, frustum = 0.0, backface = 0.0, triTested = 0.0, triVisible = 0.0;
+	for(const View& v : views)
+	{
+		MeshletCuller::Stats stats;
+		visible.clear();
+		MeshletCuller::Cull(mesh, v.Frustum, v.Eye, visible, &stats);
+		tested += stats.MeshletsTested;
+		frustum += stats.FrustumCulled;
+		backface += stats.BackfaceCulled;
+		triTested += stats.TrianglesTested;
+		triVisible += stats.TrianglesVisible;
+	}
+
+	bench.Report("meshlets frustum culled", 100.0*frustum / tested, "%");
+	bench.Report("meshlets backface culled", 100.0*backface / tested, "%");
+	bench.Report("triangles submitted", 100.0*triVisible / triTested, "%");
+}
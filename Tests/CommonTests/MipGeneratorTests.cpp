@@ -0,0 +1,313 @@
+//***************************************************************************************
+// MipGeneratorTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/MipGenerator.h"
+#include "../../Common/Random.h"
+#include "../../Common/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	typedef MipGenerator::Filter Filter;
+
+	const Filter AllFilters[] = { Filter::Box, Filter::Kaiser, Filter::Lanczos };
+
+	MipGenerator::Settings MakeSettings(Filter filter)
+	{
+		MipGenerator::Settings settings;
+		settings.MipFilter = filter;
+		return settings;
+	}
+
+	std::vector<std::uint8_t> Fill(std::uint32_t width, std::uint32_t height, std::uint8_t r, std::uint8_t g,
+		std::uint8_t b, std::uint8_t a)
+	{
+		std::vector<std::uint8_t> texels((size_t)width * height * 4);
+		for(size_t i = 0; i < texels.size(); i += 4)
+		{
+			texels[i + 0] = r;
+			texels[i + 1] = g;
+			texels[i + 2] = b;
+			texels[i + 3] = a;
+		}
+		return texels;
+	}
+
+	const std::uint8_t* Texel(const MipGenerator::Image& image, std::uint32_t mip, std::uint32_t x, std::uint32_t y,
+		std::uint32_t slice = 0)
+	{
+		const DDSFile::Subresource& s = image.GetSubresource(mip, slice);
+		return s.Data + y * s.RowPitch + x * 4;
+	}
+
+	// Share of texels whose alpha passes clip(alpha - reference).
+	float Coverage(const MipGenerator::Image& image, std::uint32_t mip, float reference)
+	{
+		const DDSFile::Subresource& s = image.GetSubresource(mip, 0);
+		std::uint32_t passed = 0;
+		for(std::uint32_t y = 0; y < s.Height; ++y)
+		{
+			for(std::uint32_t x = 0; x < s.Width; ++x)
+				passed += Texel(image, mip, x, y)[3] / 255.0f >= reference ? 1 : 0;
+		}
+		return (float)passed / (s.Width * s.Height);
+	}
+}
+
+TEST(MipGenerator, ChainLayout)
+{
+	CHECK(MipGenerator::FullMipLevels(1, 1) == 1);
+	CHECK(MipGenerator::FullMipLevels(256, 256) == 9);
+	CHECK(MipGenerator::FullMipLevels(256, 4) == 9);
+	CHECK(MipGenerator::FullMipLevels(5, 3) == 3);
+
+	// Odd sizes round down: 5x3, 2x1, 1x1.
+	std::vector<std::uint8_t> texels = Fill(5, 3, 10, 20, 30, 40);
+	MipGenerator::Image image;
+	MipGenerator::Report report;
+	CHECK(MipGenerator::Generate(DXGI_FORMAT_R8G8B8A8_UNORM, 5, 3, texels.data(), 5 * 4,
+		MakeSettings(Filter::Kaiser), &image, nullptr, &report) == MipGenerator::Status::Ok);
+	CHECK(image.Desc.MipLevels == 3 && report.MipLevels == 3 && report.GeneratedTexels == 3);
+	CHECK(image.GetSubresource(1, 0).Width == 2 && image.GetSubresource(1, 0).Height == 1);
+	CHECK(image.GetSubresource(2, 0).Width == 1 && image.GetSubresource(2, 0).Height == 1);
+	CHECK(image.Data.size() == (5 * 3 + 2 + 1) * 4);
+	CHECK(std::memcmp(image.GetSubresource(0, 0).Data, texels.data(), texels.size()) == 0);
+
+	// A shorter chain on request.
+	MipGenerator::Settings settings = MakeSettings(Filter::Box);
+	settings.MipLevels = 2;
+	CHECK(MipGenerator::Generate(DXGI_FORMAT_R8G8B8A8_UNORM, 5, 3, texels.data(), 5 * 4,
+		settings, &image) == MipGenerator::Status::Ok);
+	CHECK(image.Desc.MipLevels == 2);
+
+	CHECK(!MipGenerator::IsSupported(DXGI_FORMAT_BC1_UNORM));
+	CHECK(MipGenerator::Generate(DXGI_FORMAT_BC1_UNORM, 4, 4, texels.data(), 16, settings, &image) ==
+		MipGenerator::Status::NotSupported);
+}
+
+TEST(MipGenerator, FiltersKeepConstantsAndRamps)
+{
+	const std::uint32_t size = 32;
+
+	for(Filter filter : AllFilters)
+	{
+		// The weights of every filter sum to one, edges included.
+		for(DXGI_FORMAT format : { DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB })
+		{
+			std::vector<std::uint8_t> texels = Fill(size, size, 1, 77, 200, 255);
+			MipGenerator::Image image;
+			CHECK(MipGenerator::Generate(format, size, size, texels.data(), size * 4, MakeSettings(filter), &image) ==
+				MipGenerator::Status::Ok);
+			for(std::uint32_t mip = 1; mip < image.Desc.MipLevels; ++mip)
+			{
+				const std::uint8_t* t = Texel(image, mip, 0, 0);
+				CHECK(t[0] == 1 && t[1] == 77 && t[2] == 200 && t[3] == 255);
+			}
+		}
+
+		// Symmetric filters reproduce a linear ramp away from the edges: red
+		// is 4x + 2 at the top, so texel x of mip 1 is the mean of 8x + 2
+		// and 8x + 6.
+		std::vector<std::uint8_t> ramp = Fill(size, size, 0, 0, 0, 255);
+		for(std::uint32_t y = 0; y < size; ++y)
+		{
+			for(std::uint32_t x = 0; x < size; ++x)
+				ramp[((size_t)y * size + x) * 4] = (std::uint8_t)(4 * x + 2);
+		}
+
+		MipGenerator::Image image;
+		MipGenerator::Generate(DXGI_FORMAT_R8G8B8A8_UNORM, size, size, ramp.data(), size * 4, MakeSettings(filter), &image);
+		for(std::uint32_t x = 3; x < size / 2 - 3; ++x)
+			CHECK(std::abs((int)Texel(image, 1, x, 5)[0] - (int)(8 * x + 4)) <= 1);
+	}
+}
+
+TEST(MipGenerator, BoxAveragesInLinearSpace)
+{
+	// Black and white columns: half the light either way.
+	std::vector<std::uint8_t> texels = Fill(4, 4, 0, 0, 0, 255);
+	for(std::uint32_t y = 0; y < 4; ++y)
+	{
+		for(std::uint32_t x = 0; x < 4; x += 2)
+		{
+			std::uint8_t* t = &texels[((size_t)y * 4 + x) * 4];
+			t[0] = t[1] = t[2] = 255;
+			t[3] = 0;
+		}
+	}
+
+	MipGenerator::Settings settings = MakeSettings(Filter::Box);
+	MipGenerator::Image image;
+
+	// UNORM averages the codes; alpha is always linear.
+	MipGenerator::Generate(DXGI_FORMAT_R8G8B8A8_UNORM, 4, 4, texels.data(), 16, settings, &image);
+	CHECK(Texel(image, 1, 0, 0)[0] == 128 && Texel(image, 1, 1, 1)[3] == 128);
+
+	// sRGB averages the light: linear 0.5 is code 188, not 128.
+	MipGenerator::Generate(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, 4, 4, texels.data(), 16, settings, &image);
+	CHECK(Texel(image, 1, 0, 0)[0] == 188 && Texel(image, 1, 0, 0)[2] == 188);
+	CHECK(Texel(image, 1, 1, 1)[3] == 128 && Texel(image, 2, 0, 0)[1] == 188);
+
+	// BGR keeps its channel order, X8 stays opaque.
+	texels[0] = 0;
+	texels[2] = 255;
+	MipGenerator::Generate(DXGI_FORMAT_B8G8R8X8_UNORM, 4, 4, texels.data(), 16, settings, &image);
+	CHECK(Texel(image, 1, 0, 0)[3] == 255);
+	CHECK(Texel(image, 1, 0, 0)[0] < Texel(image, 1, 0, 0)[2]);
+}
+
+TEST(MipGenerator, WrapAddress)
+{
+	// A bright first column: with wrapping, the sinc filters see it next to
+	// the last column too.
+	const std::uint32_t size = 16;
+	std::vector<std::uint8_t> texels = Fill(size, size, 0, 0, 0, 255);
+	for(std::uint32_t y = 0; y < size; ++y)
+		texels[(size_t)y * size * 4] = 255;
+
+	MipGenerator::Settings settings = MakeSettings(Filter::Kaiser);
+	MipGenerator::Image clamped, wrapped;
+	MipGenerator::Generate(DXGI_FORMAT_R8G8B8A8_UNORM, size, size, texels.data(), size * 4, settings, &clamped);
+	settings.WrapAddress = true;
+	MipGenerator::Generate(DXGI_FORMAT_R8G8B8A8_UNORM, size, size, texels.data(), size * 4, settings, &wrapped);
+
+	std::uint32_t last = size / 2 - 1;
+	CHECK(Texel(clamped, 1, last, 3)[0] == 0);
+	CHECK(Texel(wrapped, 1, last, 3)[0] > 0);
+
+	// Away from the edges addressing makes no difference.
+	CHECK(Texel(clamped, 1, 4, 3)[0] == Texel(wrapped, 1, 4, 3)[0]);
+}
+
+TEST(MipGenerator, PreserveAlphaCoverage)
+{
+	// Foliage-like alpha: sparse opaque blobs on transparent, tested at 0.5.
+	const std::uint32_t size = 128;
+	std::vector<std::uint8_t> texels = Fill(size, size, 50, 120, 40, 0);
+	Random random(45);
+	for(std::uint32_t y = 0; y < size; ++y)
+	{
+		for(std::uint32_t x = 0; x < size; ++x)
+		{
+			float v = 0.5f + 0.25f * std::sin(x * 0.4f) * std::sin(y * 0.3f) + 0.25f * random.NextFloat();
+			texels[((size_t)y * size + x) * 4 + 3] = v > 0.72f ? 255 : (std::uint8_t)(v * 160.0f);
+		}
+	}
+
+	MipGenerator::Settings settings = MakeSettings(Filter::Kaiser);
+	settings.AlphaReference = 0.5f;
+	MipGenerator::Image plain, preserved;
+	MipGenerator::Generate(DXGI_FORMAT_R8G8B8A8_UNORM, size, size, texels.data(), size * 4, settings, &plain);
+	settings.PreserveAlphaCoverage = true;
+	MipGenerator::Generate(DXGI_FORMAT_R8G8B8A8_UNORM, size, size, texels.data(), size * 4, settings, &preserved);
+
+	float target = Coverage(preserved, 0, 0.5f);
+	CHECK(target > 0.1f && target < 0.5f);
+
+	float plainError = 0.0f;
+	float preservedError = 0.0f;
+	for(std::uint32_t mip = 1; mip <= 4; ++mip)
+	{
+		plainError = std::max(plainError, std::fabs(Coverage(plain, mip, 0.5f) - target));
+		preservedError = std::max(preservedError, std::fabs(Coverage(preserved, mip, 0.5f) - target));
+	}
+	CHECK(preservedError < 0.03f);
+	CHECK(preservedError < plainError);
+
+	// Color is not touched by the alpha scale.
+	CHECK(std::memcmp(Texel(plain, 2, 0, 0), Texel(preserved, 2, 0, 0), 3) == 0);
+}
+
+TEST(MipGenerator, PoolMatchesSerial)
+{
+	// Two slices on four workers split the rows; eight split the slices.
+	ThreadPool pool(3);
+	const std::uint32_t size = 64;
+
+	for(std::uint32_t slices : { 1u, 2u, 8u })
+	{
+		DDSFile::Desc desc;
+		desc.Dimension = DDSFile::TextureDimension::Texture2D;
+		desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+		desc.Width = size;
+		desc.Height = size;
+		desc.Depth = 1;
+		desc.MipLevels = 1;
+		desc.ArraySize = slices;
+
+		std::ostringstream out;
+		CHECK(DDSFile::WriteHeader(out, desc));
+		std::string file = out.str();
+		Random random(slices);
+		for(std::uint32_t i = 0; i < size * size * 4 * slices; ++i)
+			file.push_back((char)random.NextUInt(256));
+
+		const char* filename = "MipGeneratorTests.tmp.dds";
+		{
+			std::ofstream fout(filename, std::ios::binary);
+			fout.write(file.data(), file.size());
+		}
+
+		DDSFile dds;
+		CHECK(dds.Open(filename) == DDSFile::Status::Ok);
+
+		MipGenerator::Settings settings = MakeSettings(Filter::Lanczos);
+		settings.PreserveAlphaCoverage = true;
+		MipGenerator::Image serial, parallel;
+		CHECK(MipGenerator::Generate(dds, settings, &serial) == MipGenerator::Status::Ok);
+		CHECK(MipGenerator::Generate(dds, settings, &parallel, &pool) == MipGenerator::Status::Ok);
+		CHECK(serial.Desc.ArraySize == slices && serial.Desc.MipLevels == 7);
+		CHECK(serial.Data == parallel.Data);
+
+		// GenerateDDS writes the same chain.
+		const char* output = "MipGeneratorTests.out.tmp.dds";
+		CHECK(MipGenerator::GenerateDDS(filename, output, settings, &pool) == MipGenerator::Status::Ok);
+		DDSFile written;
+		CHECK(written.Open(output) == DDSFile::Status::Ok);
+		CHECK(written.GetDesc().MipLevels == 7 && written.GetDesc().ArraySize == slices);
+		CHECK(std::memcmp(written.GetSubresource(0, 0).Data, serial.Data.data(), serial.Data.size()) == 0);
+		written.Close();
+		dds.Close();
+		std::remove(output);
+		std::remove(filename);
+	}
+
+	CHECK(MipGenerator::GenerateDDS("MipGeneratorTests.missing.dds", "MipGeneratorTests.out.tmp.dds",
+		MipGenerator::Settings()) == MipGenerator::Status::OpenFailed);
+}
+
+BENCHMARK(MipGenerator, Filters)
+{
+	const std::uint32_t size = 1024;
+	std::vector<std::uint8_t> texels((size_t)size * size * 4);
+	Random random(45);
+	for(std::uint8_t& t : texels)
+		t = (std::uint8_t)random.NextUInt(256);
+
+	ThreadPool pool;
+	MipGenerator::Image image;
+	const char* names[] = { "Box", "Kaiser", "Lanczos" };
+	for(int f = 0; f < 3; ++f)
+	{
+		MipGenerator::Settings settings = MakeSettings(AllFilters[f]);
+		std::string label = std::string(names[f]) + ", 1024x1024 sRGB, one thread";
+		bench.Run(label.c_str(), [&]()
+		{
+			MipGenerator::Generate(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, size, size, texels.data(), size * 4, settings, &image);
+		});
+
+		label = std::string(names[f]) + ", 1024x1024 sRGB, pool";
+		bench.Run(label.c_str(), [&]()
+		{
+			MipGenerator::Generate(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, size, size, texels.data(), size * 4, settings, &image, &pool);
+		});
+	}
+}
@@ -0,0 +1,218 @@
+//***************************************************************************************
+// ParallelRecorderTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/ParallelRecorder.h"
+#include "../../Common/Random.h"
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <stdexcept>
+
+namespace
+{
+	// Logs every call as (opcode, argument) pairs so two recordings can be compared.
+	class LogRecorder : public DrawPacketRecorder
+	{
+	public:
+		virtual void SetPipelineState(std::uint32_t pso)override { Add(0, pso); }
+		virtual void SetGeometry(std::uint32_t geometry)override { Add(1, geometry); }
+		virtual void SetPrimitiveTopology(std::uint32_t topology)override { Add(2, topology); }
+		virtual void SetMaterial(std::uint32_t material)override { Add(3, material); }
+		virtual void SetObjectCB(std::uint64_t objectCB)override { Add(4, objectCB); }
+		virtual void DrawIndexedInstanced(const DrawPacket& p)override
+		{
+			Add(5, p.IndexCount);
+			Add(6, p.InstanceCount);
+			Add(7, p.StartIndexLocation);
+			Add(8, (std::uint32_t)p.BaseVertexLocation);
+			Add(9, p.StartInstanceLocation);
+		}
+
+		std::vector<std::pair<std::uint32_t, std::uint64_t>> Calls;
+
+	private:
+		void Add(std::uint32_t op, std::uint64_t value)
+		{
+			Calls.push_back(std::make_pair(op, value));
+		}
+	};
+
+	void FillQueue(DrawPacketQueue& queue, std::uint32_t count, std::uint64_t seed)
+	{
+		Random random(seed);
+		queue.Clear();
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			DrawPacket p;
+			p.Pso = random.NextUInt(4);
+			p.Geometry = random.NextUInt(16);
+			p.PrimitiveTopology = 4;
+			p.Material = random.NextUInt(8) == 0 ? DrawPacket::NoBinding : random.NextUInt(64);
+			p.ObjectCB = 0x10000 + 256ull*i;
+			p.IndexCount = 3 + 3*random.NextUInt(1000);
+			p.InstanceCount = 1 + random.NextUInt(3);
+			p.StartIndexLocation = random.NextUInt(100000);
+			p.BaseVertexLocation = (std::int32_t)random.NextUInt(50000) - 1000;
+			p.StartInstanceLocation = i;
+			p.SortKey = DrawPacketQueue::MakeSortKey(random.NextUInt(3), p.Pso, p.Geometry, p.Material,
+				random.NextFloat(), false);
+			queue.Add(p);
+		}
+		queue.Sort();
+	}
+}
+
+TEST(ThreadPool, ParallelForVisitsEveryIndexOnce)
+{
+	for(std::uint32_t threads : { 0u, 1u, 3u, 7u })
+	{
+		ThreadPool pool(threads);
+		CHECK(pool.WorkerCount() == threads + 1);
+
+		for(std::uint32_t count : { 0u, 1u, 5u, 1000u })
+		{
+			std::vector<std::atomic<std::uint32_t>> visits(count);
+			for(auto& v : visits)
+				v = 0;
+			std::atomic<bool> badWorker(false);
+
+			pool.ParallelFor(count, [&](std::uint32_t index, std::uint32_t worker)
+			{
+				visits[index]++;
+				if(worker >= pool.WorkerCount())
+					badWorker = true;
+			});
+
+			for(auto& v : visits)
+				CHECK(v == 1);
+			CHECK(!badWorker);
+		}
+	}
+}
+
+TEST(ThreadPool, RethrowsFirstException)
+{
+	ThreadPool pool(3);
+	bool caught = false;
+	try
+	{
+		pool.ParallelFor(100, [](std::uint32_t index, std::uint32_t)
+		{
+			if(index == 10)
+				throw std::runtime_error("job failed");
+		});
+	}
+	catch(const std::runtime_error&)
+	{
+		caught = true;
+	}
+	CHECK(caught);
+
+	// The pool is still usable afterwards.
+	std::atomic<std::uint32_t> sum(0);
+	pool.ParallelFor(100, [&sum](std::uint32_t index, std::uint32_t) { sum += index; });
+	CHECK(sum == 4950);
+}
+
+TEST(CommandStream, ReplayMatchesDirectRecording)
+{
+	DrawPacketQueue queue;
+	FillQueue(queue, 2000, 37);
+
+	LogRecorder direct;
+	DrawPacketQueue::SubmitStats directStats = queue.Submit(direct, true);
+
+	CommandStream stream;
+	queue.Submit(stream, true);
+	LogRecorder replayed;
+	stream.Replay(replayed);
+
+	CHECK(replayed.Calls == direct.Calls);
+	CHECK(stream.CommandCount() == directStats.StateChanges + directStats.Packets);
+
+	// Cleared streams record from scratch.
+	stream.Clear();
+	CHECK(stream.CommandCount() == 0 && stream.SizeInBytes() == 0);
+}
+
+TEST(ParallelRecorder, ChunksReplayInSubmitOrder)
+{
+	DrawPacketQueue queue;
+	FillQueue(queue, 5003, 38);
+
+	// Every draw of a plain Submit, in order.
+	LogRecorder all;
+	queue.Submit(all, false);
+
+	for(std::uint32_t threads : { 0u, 1u, 3u, 7u })
+	{
+		ThreadPool pool(threads);
+		ParallelRecorder recorder(pool);
+
+		for(std::uint32_t chunks : { 1u, 2u, 4u, 8u, 13u })
+		{
+			std::vector<std::atomic<std::uint32_t>> callbacks(chunks);
+			for(auto& c : callbacks)
+				c = 0;
+
+			ParallelRecorder::Stats stats = recorder.Record(queue, chunks, true,
+				[&](std::uint32_t chunk, std::uint32_t worker, const CommandStream& stream)
+			{
+				CHECK(worker < pool.WorkerCount());
+				CHECK(&stream == &recorder.Stream(chunk));
+				callbacks[chunk]++;
+			});
+
+			for(auto& c : callbacks)
+				CHECK(c == 1);
+			CHECK(stats.Chunks == chunks);
+			CHECK(stats.Packets == queue.Size());
+
+			// Each chunk equals a sequential Submit of the same slice...
+			LogRecorder concatenated, expected;
+			for(std::uint32_t c = 0; c < chunks; ++c)
+			{
+				size_t first = queue.Size()*c / chunks;
+				size_t last = queue.Size()*(c + 1) / chunks;
+				queue.Submit(expected, true, first, last - first);
+				recorder.Stream(c).Replay(concatenated);
+			}
+			CHECK(concatenated.Calls == expected.Calls);
+
+			// ...and the draws come out in the single threaded order.
+			auto isDraw = [](const std::pair<std::uint32_t, std::uint64_t>& call) { return call.first >= 5; };
+			std::vector<std::pair<std::uint32_t, std::uint64_t>> draws, allDraws;
+			std::copy_if(concatenated.Calls.begin(), concatenated.Calls.end(), std::back_inserter(draws), isDraw);
+			std::copy_if(all.Calls.begin(), all.Calls.end(), std::back_inserter(allDraws), isDraw);
+			CHECK(draws == allDraws);
+		}
+	}
+}
+
+BENCHMARK(ParallelRecorder, Record)
+{
+	DrawPacketQueue queue;
+	FillQueue(queue, 50000, 39);
+
+	ThreadPool pool(7);
+	ParallelRecorder recorder(pool);
+
+	char label[64];
+	for(std::uint32_t chunks : { 1u, 2u, 4u, 8u })
+	{
+		std::snprintf(label, sizeof(label), "50K packets, %u chunks", chunks);
+		bench.Run(label, [&]()
+		{
+			recorder.Record(queue, chunks, true);
+		});
+	}
+
+	CountingDrawPacketRecorder counter;
+	bench.Run("replay 50K packets", [&]()
+	{
+		for(std::uint32_t c = 0; c < 8; ++c)
+			recorder.Stream(c).Replay(counter);
+	});
+}
@@ -0,0 +1,228 @@
+//***************************************************************************************
+// ProfilerTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/Profiler.h"
+#include <sstream>
+#include <thread>
+
+namespace
+{
+	// The profiler is shared by every test, so look scopes up by name.
+	Profiler::ScopeStats FindScope(const char* name)
+	{
+		for(const Profiler::ScopeStats& s : Profiler::Get().GetScopeStats())
+		{
+			if(s.Name == name)
+				return s;
+		}
+		return Profiler::ScopeStats();
+	}
+
+	void Spin(std::uint64_t nanoseconds)
+	{
+		std::uint64_t end = Profiler::Now() + nanoseconds;
+		while(Profiler::Now() < end)
+		{
+		}
+	}
+}
+
+TEST(Profiler, NestedScopes)
+{
+	Profiler& profiler = Profiler::Get();
+	profiler.Reset();
+
+	for(int i = 0; i < 3; ++i)
+	{
+		PROFILE_SCOPE("ProfilerTests::Outer");
+		Spin(200000);
+		for(int j = 0; j < 2; ++j)
+		{
+			PROFILE_SCOPE("ProfilerTests::Inner");
+			Spin(300000);
+		}
+	}
+
+	Profiler::ScopeStats outer = FindScope("ProfilerTests::Outer");
+	Profiler::ScopeStats inner = FindScope("ProfilerTests::Inner");
+	CHECK(outer.Calls == 3);
+	CHECK(inner.Calls == 6);
+
+	// Inner scopes count towards the outer total but not its self time.
+	CHECK(inner.TotalMilliseconds >= 6*0.3);
+	CHECK(outer.TotalMilliseconds >= inner.TotalMilliseconds + 3*0.2);
+	CHECK_NEAR(outer.SelfMilliseconds, outer.TotalMilliseconds - inner.TotalMilliseconds, 1e-6);
+	CHECK_NEAR(inner.SelfMilliseconds, inner.TotalMilliseconds, 1e-9);
+	CHECK(inner.MinMilliseconds >= 0.3 && inner.MinMilliseconds <= inner.MaxMilliseconds);
+
+	profiler.Reset();
+	CHECK(FindScope("ProfilerTests::Outer").Calls == 0);
+}
+
+TEST(Profiler, DisabledRecordsNothing)
+{
+	Profiler& profiler = Profiler::Get();
+	profiler.Reset();
+
+	profiler.SetEnabled(false);
+	{
+		PROFILE_SCOPE("ProfilerTests::Disabled");
+	}
+	profiler.SetEnabled(true);
+
+	// A scope opened while disabled stays unrecorded even if it ends enabled.
+	profiler.SetEnabled(false);
+	{
+		PROFILE_SCOPE("ProfilerTests::Disabled");
+		profiler.SetEnabled(true);
+	}
+
+	CHECK(FindScope("ProfilerTests::Disabled").Calls == 0);
+}
+
+TEST(Profiler, RingKeepsLatestEvents)
+{
+	Profiler& profiler = Profiler::Get();
+	profiler.Reset();
+
+	// Run on a fresh thread so the ring holds nothing else.
+	std::thread t([]()
+	{
+		for(std::uint32_t i = 0; i < Profiler::EventsPerThread + 1000; ++i)
+		{
+			PROFILE_SCOPE("ProfilerTests::Wrap");
+		}
+	});
+	t.join();
+
+	// The oldest slot is the one the owner's next event overwrites, so an
+	// export leaves it out.
+	CHECK(FindScope("ProfilerTests::Wrap").Calls == Profiler::EventsPerThread - 1);
+}
+
+TEST(Profiler, ExitedThreadBuffersAreReused)
+{
+	Profiler& profiler = Profiler::Get();
+
+	auto record = []()
+	{
+		PROFILE_SCOPE("ProfilerTests::ShortLived");
+	};
+
+	std::thread first(record);
+	first.join();
+	std::uint32_t count = profiler.GetThreadBufferCount();
+	profiler.Reset();
+
+	// One thread at a time: every new thread takes over the buffer of the
+	// previous one instead of allocating another, and drops its events.
+	for(int i = 0; i < 20; ++i)
+	{
+		std::thread t(record);
+		t.join();
+	}
+	CHECK(profiler.GetThreadBufferCount() == count);
+	CHECK(FindScope("ProfilerTests::ShortLived").Calls == 1);
+
+	// Four at once need at most three more.
+	std::thread a(record), b(record), c(record), d(record);
+	a.join();
+	b.join();
+	c.join();
+	d.join();
+	CHECK(profiler.GetThreadBufferCount() <= count + 3);
+}
+
+TEST(Profiler, ExportWhileRecording)
+{
+	// Writers wrap their rings while the main thread exports; every exported
+	// event must be one that was actually recorded.
+	Profiler& profiler = Profiler::Get();
+	profiler.Reset();
+
+	std::atomic<bool> stop(false);
+	std::vector<std::thread> writers;
+	for(int i = 0; i < 3; ++i)
+	{
+		writers.emplace_back([&stop]()
+		{
+			while(!stop)
+			{
+				PROFILE_SCOPE("ProfilerTests::Concurrent");
+				{
+					PROFILE_SCOPE("ProfilerTests::ConcurrentChild");
+				}
+			}
+		});
+	}
+
+	for(int i = 0; i < 50; ++i)
+	{
+		for(const Profiler::ScopeStats& s : profiler.GetScopeStats())
+		{
+			if(s.Name.compare(0, 24, "ProfilerTests::Concurren") != 0)
+				continue;
+
+			CHECK(s.Name == "ProfilerTests::Concurrent" || s.Name == "ProfilerTests::ConcurrentChild");
+			CHECK(s.Calls <= 3*Profiler::EventsPerThread);
+			CHECK(s.MinMilliseconds >= 0.0 && s.MinMilliseconds <= s.MaxMilliseconds);
+			CHECK(s.SelfMilliseconds <= s.TotalMilliseconds + 1e-9);
+		}
+
+		std::ostringstream trace;
+		profiler.WriteChromeTrace(trace);
+		CHECK(trace.str().find("\"traceEvents\":[") != std::string::npos);
+	}
+
+	stop = true;
+	for(std::thread& t : writers)
+		t.join();
+}
+
+TEST(Profiler, ChromeTrace)
+{
+	Profiler& profiler = Profiler::Get();
+	profiler.Reset();
+
+	std::thread t([]()
+	{
+		Profiler::Get().SetThreadName("Quoted \"Worker\"");
+		PROFILE_SCOPE("ProfilerTests::Traced");
+	});
+	t.join();
+
+	std::ostringstream os;
+	profiler.WriteChromeTrace(os);
+	std::string trace = os.str();
+
+	CHECK(trace.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[") == 0);
+	CHECK(trace.find("\"name\":\"Quoted \\\"Worker\\\"\"") != std::string::npos);
+	CHECK(trace.find("{\"name\":\"ProfilerTests::Traced\",\"ph\":\"X\"") != std::string::npos);
+	CHECK(trace.substr(trace.size() - 4) == "\n]}\n");
+}
+
+BENCHMARK(Profiler, Scope)
+{
+	Profiler& profiler = Profiler::Get();
+
+	bench.Run("1M empty scopes, enabled", []()
+	{
+		for(int i = 0; i < 1000000; ++i)
+		{
+			PROFILE_SCOPE("ProfilerTests::Bench");
+		}
+	});
+
+	profiler.SetEnabled(false);
+	bench.Run("1M empty scopes, disabled", []()
+	{
+		for(int i = 0; i < 1000000; ++i)
+		{
+			PROFILE_SCOPE("ProfilerTests::Bench");
+		}
+	});
+	profiler.SetEnabled(true);
+	profiler.Reset();
+}
@@ -0,0 +1,276 @@
+//***************************************************************************************
+// RandomTests.cpp by DanielDFY
+//
+// Reference outputs, distribution checks and batch fill throughput of Random.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/Random.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+	// FNV-1a over the raw bytes, to compare whole batches against a constant.
+	std::uint32_t Hash(const void* data, size_t size)
+	{
+		const std::uint8_t* p = static_cast<const std::uint8_t*>(data);
+		std::uint32_t h = 2166136261u;
+		for(size_t i = 0; i < size; ++i)
+			h = (h ^ p[i])*16777619u;
+		return h;
+	}
+
+	float Length(const float* v)
+	{
+		return std::sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+	}
+}
+
+TEST(Random, MatchesPcg32Reference)
+{
+	// First outputs of pcg32_srandom_r(42, 54) from the PCG reference implementation.
+	Random random(42, 54);
+	const std::uint32_t expected[] = { 0xa15c02b7, 0x7b47f409, 0xba1d3330, 0x83d2f293, 0xbfa4784b, 0xcbed606e };
+	for(std::uint32_t e : expected)
+		CHECK(random.NextUInt() == e);
+}
+
+TEST(Random, SeedsStreamsAndSplit)
+{
+	Random a(7, 1), b(7, 1), c(7, 2), d(8, 1);
+	int sameStream = 0, otherStream = 0, otherSeed = 0;
+	for(int i = 0; i < 1000; ++i)
+	{
+		std::uint32_t va = a.NextUInt();
+		sameStream += va == b.NextUInt();
+		otherStream += va == c.NextUInt();
+		otherSeed += va == d.NextUInt();
+	}
+	CHECK(sameStream == 1000);
+	CHECK(otherStream < 5);
+	CHECK(otherSeed < 5);
+
+	// Reseeding replays the sequence.
+	a.Seed(7, 1);
+	b.Seed(7, 1);
+	CHECK(a.NextUInt64() == b.NextUInt64());
+
+	// Two splits give different generators, and splitting is deterministic.
+	Random s0 = a.Split();
+	Random s1 = a.Split();
+	Random t0 = b.Split();
+	CHECK(s0.NextUInt64() != s1.NextUInt64());
+	s0 = Random(7, 1).Split();
+	t0 = Random(7, 1).Split();
+	CHECK(s0.NextUInt64() == t0.NextUInt64());
+}
+
+TEST(Random, BoundedIntegers)
+{
+	Random random(3);
+
+	// Chi-square over 10 buckets; 27.9 is the 0.999 quantile for 9 degrees of freedom.
+	const int buckets = 10, samples = 100000;
+	int counts[buckets] = {};
+	for(int i = 0; i < samples; ++i)
+	{
+		int v = random.NextInt(-3, 6);
+		CHECK(v >= -3 && v <= 6);
+		if(v >= -3 && v <= 6)
+			++counts[v + 3];
+	}
+	double expected = (double)samples / buckets, chi2 = 0.0;
+	for(int c : counts)
+		chi2 += (c - expected)*(c - expected) / expected;
+	CHECK(chi2 < 27.9);
+
+	// Degenerate and full ranges.
+	CHECK(random.NextInt(5, 5) == 5);
+	CHECK(random.NextUInt(1) == 0);
+	bool negative = false, positive = false;
+	for(int i = 0; i < 100; ++i)
+	{
+		int v = random.NextInt(INT32_MIN, INT32_MAX);
+		negative |= v < 0;
+		positive |= v > 0;
+	}
+	CHECK(negative && positive);
+}
+
+TEST(Random, FloatRanges)
+{
+	Random random(4);
+	double sum = 0.0;
+	for(int i = 0; i < 100000; ++i)
+	{
+		float f = random.NextFloat();
+		CHECK(f >= 0.0f && f < 1.0f);
+		sum += f;
+	}
+	CHECK_NEAR(sum / 100000.0, 0.5, 0.01);
+
+	CHECK(Random::ToFloat(0u) == 0.0f);
+	CHECK(Random::ToFloat(0xffffffffu) < 1.0f);
+
+	for(int i = 0; i < 1000; ++i)
+	{
+		float f = random.NextFloat(-2.0f, 3.0f);
+		CHECK(f >= -2.0f && f < 3.0f);
+	}
+}
+
+TEST(Random, FillFloatsIsReproducible)
+{
+	// Odd count to cover the partial last batch; the guard must stay untouched.
+	const size_t count = 1001;
+	std::vector<float> a(count + 1, -1.0f), b(count + 1, -1.0f);
+	Random(11).FillFloats(a.data(), count);
+	Random(11).FillFloats(b.data(), count);
+	CHECK(std::memcmp(a.data(), b.data(), count*sizeof(float)) == 0);
+	CHECK(a[count] == -1.0f);
+
+	double sum = 0.0;
+	for(size_t i = 0; i < count; ++i)
+	{
+		CHECK(a[i] >= 0.0f && a[i] < 1.0f);
+		sum += a[i];
+	}
+	CHECK_NEAR(sum / count, 0.5, 0.05);
+
+	// [0, 1) batches are exact integer arithmetic, so every backend produces
+	// the same bits.  The constant was recorded from the scalar backend.
+	CHECK(Hash(a.data(), count*sizeof(float)) == 0xe46da611u);
+
+	std::vector<float> r(count);
+	Random(12).FillFloats(r.data(), count, 10.0f, 20.0f);
+	for(float f : r)
+		CHECK(f >= 10.0f && f <= 20.0f);
+}
+
+TEST(Random, UnitVectors)
+{
+	const size_t count = 20003;
+	std::vector<float> v(count*3);
+	Random(13).FillUnitVec3(v.data(), 3*sizeof(float), count);
+
+	double mean[3] = {};
+	int octants[8] = {};
+	for(size_t i = 0; i < count; ++i)
+	{
+		const float* p = &v[i*3];
+		CHECK_NEAR(Length(p), 1.0, 1e-5);
+		for(int k = 0; k < 3; ++k)
+			mean[k] += p[k];
+		++octants[(p[0] < 0.0f ? 1 : 0) | (p[1] < 0.0f ? 2 : 0) | (p[2] < 0.0f ? 4 : 0)];
+	}
+
+	// Uniform on the sphere: zero mean and equally populated octants.
+	for(int k = 0; k < 3; ++k)
+		CHECK_NEAR(mean[k] / count, 0.0, 0.02);
+	for(int o : octants)
+		CHECK_NEAR((double)o / count, 0.125, 0.01);
+}
+
+TEST(Random, HemisphereVectors)
+{
+	struct Float3 { float x, y, z; };
+
+	const size_t count = 10001;
+	const float inv = 1.0f / std::sqrt(3.0f);
+	Float3 n = { inv, -inv, inv };
+	std::vector<Float3> v(count + 1, Float3{ 9.0f, 9.0f, 9.0f });
+	Random(14).FillHemisphereUnitVec3(v.data(), count, n);
+
+	double meanCos = 0.0;
+	for(size_t i = 0; i < count; ++i)
+	{
+		float d = v[i].x*n.x + v[i].y*n.y + v[i].z*n.z;
+		CHECK(d >= 0.0f);
+		CHECK_NEAR(Length(&v[i].x), 1.0, 1e-5);
+		meanCos += d;
+	}
+	CHECK(v[count].x == 9.0f);
+
+	// The mean cosine of a uniform hemisphere is 1/2.
+	CHECK_NEAR(meanCos / count, 0.5, 0.02);
+}
+
+TEST(Random, ThreadGeneratorsAreIndependent)
+{
+	std::uint64_t values[4] = {};
+	std::vector<std::thread> threads;
+	for(int t = 0; t < 4; ++t)
+		threads.emplace_back([&values, t]() { values[t] = Random::ThreadLocal().NextUInt64(); });
+	for(std::thread& t : threads)
+		t.join();
+
+	for(int i = 0; i < 4; ++i)
+		for(int j = i + 1; j < 4; ++j)
+			CHECK(values[i] != values[j]);
+
+	// SetGlobalSeed replays the calling thread's sequence.
+	Random::SetGlobalSeed(99);
+	std::uint64_t first = Random::ThreadLocal().NextUInt64();
+	Random::SetGlobalSeed(99);
+	CHECK(Random::ThreadLocal().NextUInt64() == first);
+	Random::SetGlobalSeed(Random::DefaultSeed);
+}
+
+BENCHMARK(Random, Floats)
+{
+	const size_t count = 64*1024;
+	std::vector<float> out(count);
+	Random random;
+
+	bench.Run("rand() 64K", [&]()
+	{
+		for(size_t i = 0; i < count; ++i)
+			out[i] = (float)std::rand() / (float)RAND_MAX;
+	});
+
+	bench.Run("NextFloat 64K", [&]()
+	{
+		for(size_t i = 0; i < count; ++i)
+			out[i] = random.NextFloat();
+	});
+
+	bench.Run("FillFloats 64K", [&]()
+	{
+		random.FillFloats(out.data(), count);
+	});
+}
+
+BENCHMARK(Random, UnitVectors)
+{
+	const size_t count = 64*1024;
+	std::vector<float> out(count*3);
+	Random random;
+
+	// What MathHelper::RandUnitVec3 used to do.
+	bench.Run("rejection sampling 64K", [&]()
+	{
+		for(size_t i = 0; i < count; ++i)
+		{
+			float x, y, z, len2;
+			do
+			{
+				x = random.NextFloat(-1.0f, 1.0f);
+				y = random.NextFloat(-1.0f, 1.0f);
+				z = random.NextFloat(-1.0f, 1.0f);
+				len2 = x*x + y*y + z*z;
+			} while(len2 > 1.0f || len2 == 0.0f);
+			float s = 1.0f / std::sqrt(len2);
+			out[i*3 + 0] = x*s;
+			out[i*3 + 1] = y*s;
+			out[i*3 + 2] = z*s;
+		}
+	});
+
+	bench.Run("FillUnitVec3 64K", [&]()
+	{
+		random.FillUnitVec3(out.data(), 3*sizeof(float), count);
+	});
+}
@@ -0,0 +1,260 @@
+//***************************************************************************************
+// ResourceStateTrackerTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/ResourceStateTracker.h"
+#include "../../Common/Random.h"
+
+namespace
+{
+	// The D3D12_RESOURCE_STATES bits the demos use.
+	enum : ResourceStateTracker::State
+	{
+		Common = 0,
+		VertexAndConstantBuffer = 0x1,
+		IndexBuffer = 0x2,
+		RenderTarget = 0x4,
+		UnorderedAccess = 0x8,
+		DepthWrite = 0x10,
+		DepthRead = 0x20,
+		NonPixelShaderResource = 0x40,
+		PixelShaderResource = 0x80,
+		CopyDest = 0x400,
+		CopySource = 0x800,
+		GenericRead = 0x1 | 0x2 | 0x40 | 0x80 | 0x200 | 0x800,
+		Present = 0
+	};
+
+	const ResourceStateTracker::State ReadOnlyStates = VertexAndConstantBuffer | IndexBuffer |
+		NonPixelShaderResource | PixelShaderResource | 0x200 | CopySource | DepthRead;
+
+	// A command list that validates barriers the way the debug layer does: the
+	// before state must be the resource's actual state, and every use must find
+	// the resource in a state that allows it.
+	struct MockCommandList
+	{
+		explicit MockCommandList(std::uint32_t resourceCount, ResourceStateTracker::State initial = Common) :
+			States(resourceCount, initial)
+		{
+		}
+
+		void ResourceBarrier(const ResourceStateTracker::Barrier* barriers, std::uint32_t count)
+		{
+			++BarrierCalls;
+			Barriers += count;
+			for(std::uint32_t i = 0; i < count; ++i)
+			{
+				const ResourceStateTracker::Barrier& b = barriers[i];
+				CHECK(b.Before != b.After);
+				CHECK(States[b.Resource] == b.Before);
+				States[b.Resource] = b.After;
+			}
+		}
+
+		// A command that needs the resource in (a state containing) state.
+		void Use(ResourceStateTracker::ResourceId id, ResourceStateTracker::State state)
+		{
+			ResourceStateTracker::State actual = States[id];
+			bool ok = actual == state || (state != 0 && (actual & state) == state && (actual & ~ReadOnlyStates) == 0);
+			CHECK(ok);
+			++Uses;
+		}
+
+		std::vector<ResourceStateTracker::State> States;
+		std::uint32_t BarrierCalls = 0;
+		std::uint32_t Barriers = 0;
+		std::uint32_t Uses = 0;
+	};
+
+	void Flush(ResourceStateTracker& tracker, MockCommandList& cmdList)
+	{
+		tracker.Flush([&cmdList](const ResourceStateTracker::Barrier* barriers, std::uint32_t count)
+		{
+			cmdList.ResourceBarrier(barriers, count);
+		});
+	}
+}
+
+TEST(ResourceStateTracker, DropsAndMergesTransitions)
+{
+	ResourceStateTracker tracker(ReadOnlyStates);
+	MockCommandList cmdList(3, Common);
+	auto a = tracker.Register(Common);
+	auto b = tracker.Register(Common);
+	auto c = tracker.Register(Common);
+
+	// Already there.
+	tracker.Transition(a, Common);
+	CHECK(!tracker.HasPending());
+
+	// a: COMMON -> COPY_DEST -> PSR merges into one COMMON -> PSR.
+	tracker.Transition(a, CopyDest);
+	tracker.Transition(a, PixelShaderResource);
+
+	// b: COMMON -> UAV -> COMMON cancels out.
+	tracker.Transition(b, UnorderedAccess);
+	tracker.Transition(b, Common);
+
+	tracker.Transition(c, RenderTarget);
+	CHECK(tracker.HasPending());
+
+	Flush(tracker, cmdList);
+	CHECK(cmdList.BarrierCalls == 1);
+	CHECK(cmdList.Barriers == 2);
+	CHECK(tracker.GetState(a) == PixelShaderResource);
+	CHECK(tracker.GetState(b) == Common);
+
+	// A read that the current read state already covers is redundant.
+	tracker.Transition(a, GenericRead);
+	Flush(tracker, cmdList);
+	tracker.Transition(a, PixelShaderResource);
+	tracker.Transition(a, NonPixelShaderResource | PixelShaderResource);
+	CHECK(!tracker.HasPending());
+
+	// Nothing pending: no ResourceBarrier call at all.
+	Flush(tracker, cmdList);
+	CHECK(cmdList.BarrierCalls == 2);
+
+	const ResourceStateTracker::Stats& stats = tracker.GetStats();
+	CHECK(stats.Requests == 9);
+	CHECK(stats.Redundant == 3);
+	CHECK(stats.Merged == 2);
+	CHECK(stats.Transitions == 3);
+}
+
+TEST(ResourceStateTracker, BlurPasses)
+{
+	// The ping-pong of BlurFilter::Execute: each pass reads one map and writes
+	// the other, with the horizontal and vertical dispatches per pass.
+	ResourceStateTracker tracker(ReadOnlyStates);
+	MockCommandList cmdList(3, Common);
+	auto input = tracker.Register(RenderTarget);
+	auto map0 = tracker.Register(Common);
+	auto map1 = tracker.Register(Common);
+	cmdList.States[input] = RenderTarget;
+
+	tracker.Transition(input, CopySource);
+	tracker.Transition(map0, CopyDest);
+	Flush(tracker, cmdList);
+	cmdList.Use(input, CopySource);
+	cmdList.Use(map0, CopyDest);
+
+	const int blurCount = 4;
+	for(int i = 0; i < blurCount; ++i)
+	{
+		tracker.Transition(map0, NonPixelShaderResource);
+		tracker.Transition(map1, UnorderedAccess);
+		Flush(tracker, cmdList);
+		cmdList.Use(map0, NonPixelShaderResource);
+		cmdList.Use(map1, UnorderedAccess);
+
+		tracker.Transition(map0, UnorderedAccess);
+		tracker.Transition(map1, NonPixelShaderResource);
+		Flush(tracker, cmdList);
+		cmdList.Use(map1, NonPixelShaderResource);
+		cmdList.Use(map0, UnorderedAccess);
+	}
+
+	// Back to what the next frame expects.
+	tracker.Transition(input, RenderTarget);
+	tracker.Transition(map0, Common);
+	tracker.Transition(map1, Common);
+	Flush(tracker, cmdList);
+
+	// One call per step instead of one per transition.
+	CHECK(cmdList.BarrierCalls == 2 + 2*blurCount);
+	CHECK(cmdList.Barriers == 2 + 4*blurCount + 3);
+	CHECK(cmdList.States[input] == RenderTarget && cmdList.States[map0] == Common && cmdList.States[map1] == Common);
+}
+
+TEST(ResourceStateTracker, RandomRequestsStayInSync)
+{
+	// Random requests, flushes and re-registrations: the mock's validation
+	// fails if the tracker ever loses track of a resource's real state.
+	const ResourceStateTracker::State states[] = {
+		Common, VertexAndConstantBuffer, IndexBuffer, RenderTarget, UnorderedAccess, DepthWrite,
+		DepthRead, NonPixelShaderResource, PixelShaderResource, NonPixelShaderResource | PixelShaderResource,
+		CopyDest, CopySource, GenericRead };
+	const std::uint32_t stateCount = sizeof(states) / sizeof(states[0]);
+
+	const std::uint32_t resourceCount = 16;
+	ResourceStateTracker tracker(ReadOnlyStates);
+	MockCommandList cmdList(resourceCount);
+	for(std::uint32_t i = 0; i < resourceCount; ++i)
+		CHECK(tracker.Register(Common) == i);
+
+	Random random(36);
+	std::vector<std::pair<ResourceStateTracker::ResourceId, ResourceStateTracker::State>> uses;
+	for(int step = 0; step < 20000; ++step)
+	{
+		ResourceStateTracker::ResourceId id = random.NextUInt(resourceCount);
+		ResourceStateTracker::State state = states[random.NextUInt(stateCount)];
+		tracker.Transition(id, state);
+		CHECK(tracker.GetState(id) == state || (state != 0 && (tracker.GetState(id) & state) == state));
+		uses.push_back(std::make_pair(id, state));
+
+		if(random.NextUInt(8) == 0)
+		{
+			Flush(tracker, cmdList);
+
+			// Only the last request per resource is guaranteed after the flush.
+			for(size_t i = uses.size(); i-- > 0; )
+			{
+				bool last = true;
+				for(size_t j = i + 1; j < uses.size(); ++j)
+					last = last && uses[j].first != uses[i].first;
+				if(last)
+					cmdList.Use(uses[i].first, uses[i].second);
+			}
+			uses.clear();
+
+			// Occasionally recycle an id for a resource in another state.
+			if(random.NextUInt(16) == 0)
+			{
+				ResourceStateTracker::ResourceId old = random.NextUInt(resourceCount);
+				tracker.Unregister(old);
+				ResourceStateTracker::State initial = states[random.NextUInt(stateCount)];
+				CHECK(tracker.Register(initial) == old);
+				cmdList.States[old] = initial;
+			}
+		}
+	}
+	Flush(tracker, cmdList);
+
+	for(std::uint32_t i = 0; i < resourceCount; ++i)
+		CHECK(cmdList.States[i] == tracker.GetState(i));
+	CHECK(tracker.GetStats().Transitions == cmdList.Barriers);
+	CHECK(cmdList.Uses > 0);
+}
+
+BENCHMARK(ResourceStateTracker, Requests)
+{
+	// 4K render targets and textures, 16K requests and 64 flushes per frame.
+	const std::uint32_t resourceCount = 4096;
+	ResourceStateTracker tracker(ReadOnlyStates);
+	for(std::uint32_t i = 0; i < resourceCount; ++i)
+		tracker.Register(Common);
+
+	Random random(37);
+	std::vector<std::uint32_t> ids(16*1024);
+	for(std::uint32_t& id : ids)
+		id = random.NextUInt(resourceCount);
+
+	const ResourceStateTracker::State cycle[] = { RenderTarget, PixelShaderResource, PixelShaderResource, CopySource };
+	std::uint32_t frame = 0;
+	std::uint32_t barriers = 0;
+	bench.Run("16K requests, 64 flushes", [&]()
+	{
+		for(std::uint32_t i = 0; i < (std::uint32_t)ids.size(); ++i)
+		{
+			tracker.Transition(ids[i], cycle[(i + frame) & 3]);
+			if((i & 255) == 255)
+				tracker.Flush([&barriers](const ResourceStateTracker::Barrier*, std::uint32_t count) { barriers += count; });
+		}
+		++frame;
+	});
+
+	const ResourceStateTracker::Stats& stats = tracker.GetStats();
+	bench.Report("redundant or merged", 100.0*(stats.Redundant + stats.Merged) / stats.Requests, "%");
+}
@@ -0,0 +1,178 @@
+//***************************************************************************************
+// RingAllocatorTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/RingAllocator.h"
+#include "../../Common/Random.h"
+#include <deque>
+
+namespace
+{
+	struct Range
+	{
+		std::uint64_t Begin;
+		std::uint64_t End;
+	};
+
+	// A GPU that completes each frame's fence a fixed number of frames late.
+	struct SimulatedFence
+	{
+		explicit SimulatedFence(std::uint32_t latency) : Latency(latency) {}
+
+		std::uint64_t Signal()
+		{
+			++Current;
+			return Current;
+		}
+
+		std::uint64_t Completed()const
+		{
+			return Current > Latency ? Current - Latency : 0;
+		}
+
+		std::uint32_t Latency;
+		std::uint64_t Current = 0;
+	};
+}
+
+TEST(RingAllocator, AllocatesAlignedAndWraps)
+{
+	RingAllocator ring(1024);
+
+	CHECK(ring.Allocate(100, 1) == 0);
+	CHECK(ring.Allocate(10, 256) == 256);
+	CHECK(ring.UsedBytes() == 266);
+	ring.FinishFrame(1);
+
+	CHECK(ring.Allocate(500, 256) == 512);
+	ring.FinishFrame(2);
+
+	// No room at the end and the first frame is still in flight.
+	CHECK(ring.Allocate(200, 1) == RingAllocator::InvalidOffset);
+	CHECK(ring.GetStats().FailedAllocations == 1);
+
+	// Once it retires the allocation wraps to the beginning rather than straddling the end.
+	ring.Retire(1);
+	CHECK(ring.Allocate(200, 1) == 0);
+	CHECK(ring.UsedBytes() == (1012 - 266) + (1024 - 1012) + 200);
+
+	// Padding: two alignments plus the skipped end of the buffer.
+	CHECK(ring.GetStats().PaddingBytes == (256 - 100) + (512 - 266) + (1024 - 1012));
+	ring.FinishFrame(3);
+
+	ring.Retire(3);
+	CHECK(ring.UsedBytes() == 0);
+	CHECK(ring.GetStats().FramesInFlight == 0);
+}
+
+TEST(RingAllocator, EmptyRingRestartsAtZero)
+{
+	RingAllocator ring(1000);
+	CHECK(ring.Allocate(700, 1) == 0);
+	ring.FinishFrame(1);
+	ring.Retire(1);
+
+	// Everything retired, so the full capacity is one block again.
+	CHECK(ring.Allocate(1000, 1) == 0);
+	CHECK(ring.Allocate(1, 1) == RingAllocator::InvalidOffset);
+	ring.FinishFrame(2);
+	ring.Retire(2);
+
+	// Zero sized allocations get distinct offsets.
+	std::uint64_t a = ring.Allocate(0, 1);
+	std::uint64_t b = ring.Allocate(0, 1);
+	CHECK(a != b);
+
+	// A frame without allocations does not leave a marker behind.
+	ring.FinishFrame(3);
+	ring.FinishFrame(4);
+	CHECK(ring.GetStats().FramesInFlight == 1);
+}
+
+TEST(RingAllocator, SimulatedFrames)
+{
+	// Random sizes and alignments with two frames of GPU latency: no live
+	// allocation may overlap another, and retiring everything frees the ring.
+	const std::uint64_t capacity = 64*1024;
+	RingAllocator ring(capacity);
+	SimulatedFence fence(2);
+	Random random(33);
+
+	struct Frame
+	{
+		std::uint64_t Fence;
+		std::vector<Range> Ranges;
+	};
+	std::deque<Frame> inFlight;
+	std::uint32_t failures = 0;
+
+	for(std::uint32_t f = 0; f < 20000; ++f)
+	{
+		std::uint64_t completed = fence.Completed();
+		ring.Retire(completed);
+		while(!inFlight.empty() && inFlight.front().Fence <= completed)
+			inFlight.pop_front();
+
+		Frame frame;
+		std::uint32_t count = random.NextUInt(12);
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			std::uint64_t size = 1 + random.NextUInt(4096);
+			std::uint64_t alignment = 1ull << random.NextUInt(9);
+			std::uint64_t offset = ring.Allocate(size, alignment);
+			if(offset == RingAllocator::InvalidOffset)
+			{
+				++failures;
+				continue;
+			}
+
+			CHECK(offset % alignment == 0);
+			CHECK(offset + size <= capacity);
+
+			Range r = { offset, offset + size };
+			for(const Frame& other : inFlight)
+				for(const Range& o : other.Ranges)
+					CHECK(r.End <= o.Begin || o.End <= r.Begin);
+			for(const Range& o : frame.Ranges)
+				CHECK(r.End <= o.Begin || o.End <= r.Begin);
+			frame.Ranges.push_back(r);
+		}
+
+		frame.Fence = fence.Signal();
+		ring.FinishFrame(frame.Fence);
+		inFlight.push_back(frame);
+
+		CHECK(ring.UsedBytes() <= capacity);
+	}
+
+	// About three frames of at most 12*4K fit 64K, so the ring must have filled.
+	CHECK(failures > 0);
+	CHECK(ring.GetStats().FailedAllocations == failures);
+	CHECK(ring.GetStats().PeakUsedBytes <= capacity);
+
+	ring.Retire(fence.Current);
+	CHECK(ring.UsedBytes() == 0);
+	CHECK(ring.GetStats().FramesInFlight == 0);
+}
+
+BENCHMARK(RingAllocator, Allocate)
+{
+	RingAllocator ring(16*1024*1024);
+	SimulatedFence fence(2);
+	std::uint64_t sum = 0;
+
+	// A frame's worth of constant buffers: 1000 256-byte aligned allocations.
+	bench.Run("1000 constant buffers + FinishFrame/Retire", [&]()
+	{
+		ring.Retire(fence.Completed());
+		for(int i = 0; i < 1000; ++i)
+			sum += ring.Allocate(64 + (i & 127), 256);
+		ring.FinishFrame(fence.Signal());
+	});
+
+	bench.Report("peak used", ring.GetStats().PeakUsedBytes / 1024.0, "KB");
+
+	volatile std::uint64_t sink = sum;
+	(void)sink;
+}
@@ -0,0 +1,345 @@
+//***************************************************************************************
+// ShaderCacheTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/ShaderCache.h"
+#include "../../Common/ThreadPool.h"
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#define rmdir _rmdir
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// Stands in for D3DCompiler: the "bytecode" spells out the request, so a
+	// shader handed back for the wrong request is caught, and entry points
+	// named "Broken" fail to compile.
+	class StubCompiler : public ShaderCache::Backend
+	{
+	public:
+		explicit StubCompiler(const std::string& identity) :
+			mIdentity(identity)
+		{
+		}
+
+		std::string Identity()const override
+		{
+			return mIdentity;
+		}
+
+		bool Compile(const ShaderCache::Request& request, std::vector<std::uint8_t>* bytecode, std::string* errors)override
+		{
+			Compiles++;
+
+			if(request.EntryPoint == "Broken")
+			{
+				*errors = request.Filename + ": error X3000: syntax error";
+				return false;
+			}
+
+			*errors = request.Filename + ": warning X3206: implicit truncation";
+			std::string text = Expected(request);
+			bytecode->assign(text.begin(), text.end());
+			return true;
+		}
+
+		static std::string Expected(const ShaderCache::Request& request)
+		{
+			std::string text = request.Filename + "|" + request.EntryPoint + "|" + request.Target;
+			for(const ShaderCache::Define& define : request.Defines)
+				text += "|" + define.Name + "=" + define.Value;
+			return text;
+		}
+
+		std::atomic<std::uint32_t> Compiles{ 0 };
+
+	private:
+		std::string mIdentity;
+	};
+
+	const char* const Directory = "ShaderCacheTests.tmp";
+	const char* const MainFile = "ShaderCacheTests.Main.tmp.hlsl";
+	const char* const CommonFile = "ShaderCacheTests.Common.tmp.hlsli";
+	const char* const LightingFile = "ShaderCacheTests.Lighting.tmp.hlsli";
+	const char* const OtherFile = "ShaderCacheTests.Other.tmp.hlsl";
+
+	void WriteFile(const std::string& filename, const std::string& text)
+	{
+		std::ofstream fout(filename, std::ios::binary | std::ios::trunc);
+		fout << text;
+	}
+
+	// Main includes Common, which includes Lighting; Other includes Lighting
+	// only.  Removed again, with the cache directory, when the test ends.
+	class TempSources
+	{
+	public:
+		TempSources()
+		{
+			WriteFile(MainFile,
+				"// #include \"ShaderCacheTests.Missing.tmp.hlsli\" is commented out\n"
+				"#include \"ShaderCacheTests.Common.tmp.hlsli\"\n"
+				"float4 PS() : SV_Target { return Shade(); }\n");
+			WriteFile(CommonFile,
+				"  #  include <ShaderCacheTests.Lighting.tmp.hlsli>\n"
+				"#include \"ShaderCacheTests.Main.tmp.hlsl\"\n");
+			WriteFile(LightingFile, "float4 Shade() { return 1.0f; }\n");
+			WriteFile(OtherFile,
+				"#include \"ShaderCacheTests.Lighting.tmp.hlsli\"\n"
+				"float4 VS() : SV_Position { return Shade(); }\n");
+		}
+
+		~TempSources()
+		{
+			for(const char* file : { MainFile, CommonFile, LightingFile, OtherFile })
+				std::remove(file);
+
+			for(std::uint64_t key : Keys)
+			{
+				char name[32];
+				std::snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+				std::remove((std::string(Directory) + name).c_str());
+			}
+			rmdir(Directory);
+		}
+
+		// Entries the test may have stored.
+		void Track(const std::vector<ShaderCache::Shader>& shaders)
+		{
+			for(const ShaderCache::Shader& shader : shaders)
+				Keys.push_back(shader.Key);
+		}
+
+	private:
+		std::vector<std::uint64_t> Keys;
+	};
+
+	ShaderCache::Request MakeRequest(const std::string& filename, const std::string& entryPoint,
+		const std::string& target, const std::vector<ShaderCache::Define>& defines = {})
+	{
+		ShaderCache::Request request;
+		request.Filename = filename;
+		request.Defines = defines;
+		request.EntryPoint = entryPoint;
+		request.Target = target;
+		return request;
+	}
+
+	std::vector<ShaderCache::Request> MakeRequests()
+	{
+		return
+		{
+			MakeRequest(MainFile, "PS", "ps_5_1"),
+			MakeRequest(MainFile, "PS", "ps_5_1", { { "ALPHA_TEST", "1" } }),
+			MakeRequest(OtherFile, "VS", "vs_5_1"),
+			MakeRequest(MainFile, "PS", "ps_5_1"),
+		};
+	}
+
+	bool Matches(const std::vector<ShaderCache::Request>& requests, const std::vector<ShaderCache::Shader>& shaders)
+	{
+		if(requests.size() != shaders.size())
+			return false;
+
+		for(size_t i = 0; i < requests.size(); ++i)
+		{
+			if(shaders[i].Result != ShaderCache::Status::Ok)
+				return false;
+
+			std::string expected = StubCompiler::Expected(requests[i]);
+			if(std::string(shaders[i].Bytecode.begin(), shaders[i].Bytecode.end()) != expected)
+				return false;
+		}
+
+		return true;
+	}
+}
+
+TEST(ShaderCache, ScanDependencies)
+{
+	TempSources sources;
+
+	// Each file once, in include order, across the cycle back to Main; the
+	// include in the comment is not followed.
+	std::vector<std::string> dependencies;
+	CHECK(ShaderCache::ScanDependencies(MainFile, &dependencies) == ShaderCache::Status::Ok);
+	CHECK(dependencies.size() == 3);
+	if(dependencies.size() == 3)
+	{
+		CHECK(dependencies[0] == MainFile);
+		CHECK(dependencies[1] == CommonFile);
+		CHECK(dependencies[2] == LightingFile);
+	}
+
+	dependencies.clear();
+	CHECK(ShaderCache::ScanDependencies("ShaderCacheTests.Missing.tmp.hlsl", &dependencies) ==
+		ShaderCache::Status::OpenFailed);
+	CHECK(dependencies.empty());
+}
+
+TEST(ShaderCache, CompilesOnlyWhatChanged)
+{
+	TempSources sources;
+	ThreadPool pool(3);
+
+	ShaderCache::Settings settings;
+	settings.Directory = Directory;
+
+	std::vector<ShaderCache::Request> requests = MakeRequests();
+	std::vector<ShaderCache::Shader> shaders;
+
+	// Cold: the duplicate request shares its twin's compile.
+	StubCompiler compiler("stub 1");
+	{
+		ShaderCache cache(compiler, settings);
+		CHECK(cache.Build(requests, &shaders, &pool) == ShaderCache::Status::Ok);
+		sources.Track(shaders);
+		CHECK(Matches(requests, shaders));
+		CHECK(compiler.Compiles == 3);
+		CHECK(!shaders[0].Errors.empty());
+		CHECK(shaders[0].Key == shaders[3].Key && shaders[0].Key != shaders[1].Key);
+
+		const ShaderCache::Stats& stats = cache.GetStats();
+		CHECK(stats.Requests == 4 && stats.Compiled == 3 && stats.MemoryHits == 1);
+		CHECK(stats.Failed == 0 && stats.WriteFailures == 0);
+
+		// The same cache again: everything from memory.
+		CHECK(cache.Build(requests, &shaders, &pool) == ShaderCache::Status::Ok);
+		CHECK(Matches(requests, shaders));
+		CHECK(compiler.Compiles == 3 && stats.MemoryHits == 5);
+	}
+
+	// The next run: everything from disk, without messages.
+	{
+		ShaderCache cache(compiler, settings);
+		CHECK(cache.Build(requests, &shaders, &pool) == ShaderCache::Status::Ok);
+		CHECK(Matches(requests, shaders));
+		CHECK(compiler.Compiles == 3);
+		CHECK(cache.GetStats().DiskHits == 3 && cache.GetStats().MemoryHits == 1);
+		CHECK(shaders[0].Errors.empty());
+	}
+
+	// Editing a file two includes deep recompiles everything that reaches
+	// it; editing Main leaves Other alone.
+	WriteFile(LightingFile, "float4 Shade() { return 0.5f; }\n");
+	{
+		ShaderCache cache(compiler, settings);
+		CHECK(cache.Build(requests, &shaders, &pool) == ShaderCache::Status::Ok);
+		sources.Track(shaders);
+		CHECK(compiler.Compiles == 6);
+	}
+
+	WriteFile(MainFile, "#include \"ShaderCacheTests.Common.tmp.hlsli\"\n");
+	{
+		ShaderCache cache(compiler, settings);
+		CHECK(cache.Build(requests, &shaders, &pool) == ShaderCache::Status::Ok);
+		sources.Track(shaders);
+		CHECK(compiler.Compiles == 8);
+		CHECK(cache.GetStats().DiskHits == 1);
+	}
+
+	// A different compiler never sees the other's bytecode.
+	StubCompiler other("stub 2");
+	{
+		ShaderCache cache(other, settings);
+		CHECK(cache.Build(requests, &shaders, &pool) == ShaderCache::Status::Ok);
+		sources.Track(shaders);
+		CHECK(Matches(requests, shaders));
+		CHECK(other.Compiles == 3 && cache.GetStats().DiskHits == 0);
+	}
+}
+
+TEST(ShaderCache, Failures)
+{
+	TempSources sources;
+	ThreadPool pool(3);
+
+	ShaderCache::Settings settings;
+	settings.Directory = Directory;
+
+	std::vector<ShaderCache::Request> requests =
+	{
+		MakeRequest(MainFile, "PS", "ps_5_1"),
+		MakeRequest(MainFile, "Broken", "ps_5_1"),
+		MakeRequest("ShaderCacheTests.Missing.tmp.hlsl", "PS", "ps_5_1"),
+		MakeRequest(MainFile, "Broken", "ps_5_1"),
+	};
+
+	StubCompiler compiler("stub");
+	std::vector<ShaderCache::Shader> shaders;
+	for(int run = 0; run < 2; ++run)
+	{
+		// Failed shaders are not stored, so the next run reports them again.
+		ShaderCache cache(compiler, settings);
+		CHECK(cache.Build(requests, &shaders, &pool) == ShaderCache::Status::CompileFailed);
+		sources.Track(shaders);
+
+		CHECK(shaders[0].Result == ShaderCache::Status::Ok);
+		CHECK(shaders[1].Result == ShaderCache::Status::CompileFailed);
+		CHECK(shaders[1].Bytecode.empty());
+		CHECK(shaders[1].Errors.find("error") != std::string::npos);
+		CHECK(shaders[2].Result == ShaderCache::Status::OpenFailed);
+		CHECK(shaders[3].Result == ShaderCache::Status::CompileFailed);
+		CHECK(cache.GetStats().Failed == 3);
+	}
+	CHECK(compiler.Compiles == 3);
+}
+
+TEST(ShaderCache, PoolMatchesSerial)
+{
+	TempSources sources;
+	ThreadPool pool(3);
+
+	// In memory only, so each cache compiles everything.
+	ShaderCache::Settings settings;
+	settings.Directory.clear();
+
+	std::vector<ShaderCache::Request> requests;
+	for(int i = 0; i < 64; ++i)
+	{
+		std::string value = std::to_string(i);
+		requests.push_back(MakeRequest(i % 2 ? MainFile : OtherFile, "Main", "ps_5_1", { { "VARIANT", value } }));
+	}
+
+	StubCompiler compiler("stub");
+	std::vector<ShaderCache::Shader> serial, parallel;
+
+	ShaderCache serialCache(compiler, settings);
+	CHECK(serialCache.Build(requests, &serial) == ShaderCache::Status::Ok);
+	ShaderCache parallelCache(compiler, settings);
+	CHECK(parallelCache.Build(requests, &parallel, &pool) == ShaderCache::Status::Ok);
+
+	CHECK(compiler.Compiles == 128);
+	CHECK(Matches(requests, serial) && Matches(requests, parallel));
+	for(size_t i = 0; i < requests.size(); ++i)
+		CHECK(serial[i].Key == parallel[i].Key);
+}
+
+BENCHMARK(ShaderCache, Build)
+{
+	TempSources sources;
+
+	ShaderCache::Settings settings;
+	settings.Directory.clear();
+
+	std::vector<ShaderCache::Request> requests = MakeRequests();
+	StubCompiler compiler("stub");
+	ShaderCache cache(compiler, settings);
+	std::vector<ShaderCache::Shader> shaders;
+	cache.Build(requests, &shaders);
+
+	// What a launch with a warm cache pays: reading and hashing the sources.
+	bench.Run("4 requests over 4 files, all in memory", [&]()
+	{
+		cache.Build(requests, &shaders);
+	});
+}
@@ -0,0 +1,602 @@
+//***************************************************************************************
+// SimdMathTests.cpp by DanielDFY
+//
+// Conformance of SimdMath against a double precision reference, for whichever
+// backend (AVX2, SSE2 or scalar) the project is built with.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/SimdMath.h"
+#include "../../Common/Random.h"
+#include "../../Common/MathHelper.h"
+#include <cmath>
+
+using namespace SimdMath;
+
+namespace
+{
+	struct DVec
+	{
+		double v[4];
+	};
+
+	struct DMat
+	{
+		double m[4][4];
+	};
+
+	DVec ToD(Vector v)
+	{
+		Float4 f;
+		StoreFloat4(&f, v);
+		return { { f.x, f.y, f.z, f.w } };
+	}
+
+	DMat ToD(const Matrix& m)
+	{
+		Float4x4 f;
+		StoreFloat4x4(&f, m);
+		DMat d;
+		for(int i = 0; i < 4; ++i)
+			for(int j = 0; j < 4; ++j)
+				d.m[i][j] = f.m[i][j];
+		return d;
+	}
+
+	DVec Transform(const DVec& v, const DMat& m)
+	{
+		DVec r = { { 0.0, 0.0, 0.0, 0.0 } };
+		for(int j = 0; j < 4; ++j)
+			for(int k = 0; k < 4; ++k)
+				r.v[j] += v.v[k]*m.m[k][j];
+		return r;
+	}
+
+	DMat Multiply(const DMat& a, const DMat& b)
+	{
+		DMat r;
+		for(int i = 0; i < 4; ++i)
+		{
+			DVec row = { { a.m[i][0], a.m[i][1], a.m[i][2], a.m[i][3] } };
+			DVec t = Transform(row, b);
+			for(int j = 0; j < 4; ++j)
+				r.m[i][j] = t.v[j];
+		}
+		return r;
+	}
+
+	// Gauss-Jordan elimination with partial pivoting.
+	bool Inverse(const DMat& a, DMat& inv, double& det)
+	{
+		double w[4][8];
+		for(int i = 0; i < 4; ++i)
+		{
+			for(int j = 0; j < 4; ++j)
+			{
+				w[i][j] = a.m[i][j];
+				w[i][j + 4] = i == j ? 1.0 : 0.0;
+			}
+		}
+
+		det = 1.0;
+		for(int c = 0; c < 4; ++c)
+		{
+			int pivot = c;
+			for(int r = c + 1; r < 4; ++r)
+			{
+				if(std::fabs(w[r][c]) > std::fabs(w[pivot][c]))
+					pivot = r;
+			}
+			if(std::fabs(w[pivot][c]) < 1e-12)
+			{
+				det = 0.0;
+				return false;
+			}
+			if(pivot != c)
+			{
+				for(int j = 0; j < 8; ++j)
+					std::swap(w[c][j], w[pivot][j]);
+				det = -det;
+			}
+
+			double p = w[c][c];
+			det *= p;
+			for(int j = 0; j < 8; ++j)
+				w[c][j] /= p;
+			for(int r = 0; r < 4; ++r)
+			{
+				if(r == c)
+					continue;
+				double f = w[r][c];
+				for(int j = 0; j < 8; ++j)
+					w[r][j] -= f*w[c][j];
+			}
+		}
+
+		for(int i = 0; i < 4; ++i)
+			for(int j = 0; j < 4; ++j)
+				inv.m[i][j] = w[i][j + 4];
+		return true;
+	}
+
+	// Rotation of the row vector v about the unit axis k, matching the
+	// DirectXMath convention: v' = v*cos + (k x v)*sin + k*(k.v)*(1 - cos).
+	DVec Rotate(const DVec& v, const DVec& k, double angle)
+	{
+		double c = std::cos(angle);
+		double s = std::sin(angle);
+		double kv = k.v[0]*v.v[0] + k.v[1]*v.v[1] + k.v[2]*v.v[2];
+		DVec cross = { {
+			k.v[1]*v.v[2] - k.v[2]*v.v[1],
+			k.v[2]*v.v[0] - k.v[0]*v.v[2],
+			k.v[0]*v.v[1] - k.v[1]*v.v[0],
+			0.0 } };
+
+		DVec r;
+		for(int i = 0; i < 3; ++i)
+			r.v[i] = v.v[i]*c + cross.v[i]*s + k.v[i]*kv*(1.0 - c);
+		r.v[3] = v.v[3];
+		return r;
+	}
+
+	void CheckVec(Vector actual, const DVec& expected, double eps, int components = 4)
+	{
+		DVec a = ToD(actual);
+		for(int i = 0; i < components; ++i)
+		{
+			double tol = eps*std::max(1.0, std::fabs(expected.v[i]));
+			CHECK_NEAR(a.v[i], expected.v[i], tol);
+		}
+	}
+
+	void CheckMat(const Matrix& actual, const DMat& expected, double eps)
+	{
+		DMat a = ToD(actual);
+		for(int i = 0; i < 4; ++i)
+		{
+			for(int j = 0; j < 4; ++j)
+			{
+				double tol = eps*std::max(1.0, std::fabs(expected.m[i][j]));
+				CHECK_NEAR(a.m[i][j], expected.m[i][j], tol);
+			}
+		}
+	}
+
+	Vector RandomVector(Random& random, float lo = -10.0f, float hi = 10.0f)
+	{
+		return VectorSet(random.NextFloat(lo, hi), random.NextFloat(lo, hi), random.NextFloat(lo, hi), random.NextFloat(lo, hi));
+	}
+
+	// Random matrix with a dominant diagonal, so it is well conditioned.
+	Matrix RandomMatrix(Random& random)
+	{
+		Float4x4 f;
+		for(int i = 0; i < 4; ++i)
+			for(int j = 0; j < 4; ++j)
+				f.m[i][j] = random.NextFloat(-1.0f, 1.0f) + (i == j ? 4.0f : 0.0f);
+		return LoadFloat4x4(&f);
+	}
+
+	Vector RandomUnitVector(Random& random)
+	{
+		return Vector3Normalize(VectorSetW(RandomVector(random, -1.0f, 1.0f), 0.0f));
+	}
+
+	const char* BackendName()
+	{
+#if defined(SIMDMATH_AVX2)
+		return "AVX2";
+#elif defined(SIMDMATH_SSE2)
+		return "SSE2";
+#else
+		return "scalar";
+#endif
+	}
+}
+
+TEST(SimdMath, VectorArithmetic)
+{
+	Random random(1);
+	for(int n = 0; n < 100; ++n)
+	{
+		Vector a = RandomVector(random);
+		Vector b = VectorAdd(RandomVector(random, 0.5f, 10.0f), VectorZero());
+		Vector c = RandomVector(random);
+		DVec da = ToD(a), db = ToD(b), dc = ToD(c);
+
+		DVec add, sub, mul, div, mn, mx, mad, sq, neg, abs;
+		for(int i = 0; i < 4; ++i)
+		{
+			add.v[i] = da.v[i] + db.v[i];
+			sub.v[i] = da.v[i] - db.v[i];
+			mul.v[i] = da.v[i]*db.v[i];
+			div.v[i] = da.v[i] / db.v[i];
+			mn.v[i] = std::min(da.v[i], db.v[i]);
+			mx.v[i] = std::max(da.v[i], db.v[i]);
+			mad.v[i] = da.v[i]*db.v[i] + dc.v[i];
+			sq.v[i] = std::sqrt(db.v[i]);
+			neg.v[i] = -da.v[i];
+			abs.v[i] = std::fabs(da.v[i]);
+		}
+
+		CheckVec(VectorAdd(a, b), add, 1e-6);
+		CheckVec(VectorSubtract(a, b), sub, 1e-6);
+		CheckVec(VectorMultiply(a, b), mul, 1e-6);
+		CheckVec(VectorDivide(a, b), div, 1e-6);
+		CheckVec(VectorMin(a, b), mn, 0.0);
+		CheckVec(VectorMax(a, b), mx, 0.0);
+		CheckVec(VectorMultiplyAdd(a, b, c), mad, 1e-5);
+		CheckVec(VectorSqrt(b), sq, 1e-6);
+		CheckVec(VectorNegate(a), neg, 0.0);
+		CheckVec(VectorAbs(a), abs, 0.0);
+	}
+}
+
+TEST(SimdMath, VectorAccessAndCompare)
+{
+	Vector v = VectorSet(1.0f, 2.0f, 3.0f, 4.0f);
+	CHECK(VectorGetX(v) == 1.0f && VectorGetY(v) == 2.0f && VectorGetZ(v) == 3.0f && VectorGetW(v) == 4.0f);
+	CHECK(VectorGetZ(VectorSetZ(v, 7.0f)) == 7.0f);
+	CHECK(VectorGetX(VectorSplatW(v)) == 4.0f);
+	CheckVec(VectorSwizzle<3, 2, 1, 0>(v), { { 4.0, 3.0, 2.0, 1.0 } }, 0.0);
+
+	Vector w = VectorSet(1.0f, 5.0f, 3.0f, 0.0f);
+	CHECK(VectorMoveMask(VectorEqual(v, w)) == 0x5);
+	CHECK(VectorMoveMask(VectorLess(v, w)) == 0x2);
+	CHECK(VectorMoveMask(VectorGreater(v, w)) == 0x8);
+	CheckVec(VectorSelect(v, w, VectorLess(v, w)), { { 1.0, 5.0, 3.0, 4.0 } }, 0.0);
+
+	// The 3 component comparisons ignore w.
+	CHECK(Vector3Equal(v, VectorSetW(v, 9.0f)));
+	CHECK(Vector3Less(v, VectorAdd(v, VectorSet(1.0f, 1.0f, 1.0f, -10.0f))));
+	CHECK(!Vector3Less(v, w));
+	CHECK(Vector3NearEqual(v, VectorAdd(v, VectorReplicate(1e-4f)), VectorReplicate(1e-3f)));
+
+	CheckVec(VectorSaturate(VectorSet(-1.0f, 0.5f, 2.0f, 1.0f)), { { 0.0, 0.5, 1.0, 1.0 } }, 0.0);
+	CheckVec(VectorLerp(VectorZero(), v, 0.25f), { { 0.25, 0.5, 0.75, 1.0 } }, 1e-7);
+
+	Float3 f3;
+	StoreFloat3(&f3, v);
+	CHECK(f3.x == 1.0f && f3.y == 2.0f && f3.z == 3.0f);
+	CHECK(VectorGetW(LoadFloat3(&f3)) == 0.0f);
+}
+
+TEST(SimdMath, Vector3Geometry)
+{
+	Random random(2);
+	for(int n = 0; n < 100; ++n)
+	{
+		Vector a = RandomVector(random);
+		Vector b = RandomVector(random);
+		DVec da = ToD(a), db = ToD(b);
+
+		double dot3 = da.v[0]*db.v[0] + da.v[1]*db.v[1] + da.v[2]*db.v[2];
+		double dot4 = dot3 + da.v[3]*db.v[3];
+		double len = std::sqrt(da.v[0]*da.v[0] + da.v[1]*da.v[1] + da.v[2]*da.v[2]);
+
+		CheckVec(Vector3Dot(a, b), { { dot3, dot3, dot3, dot3 } }, 1e-5);
+		CheckVec(Vector4Dot(a, b), { { dot4, dot4, dot4, dot4 } }, 1e-5);
+		CHECK_NEAR(VectorGetX(Vector3Length(a)), len, 1e-5*len);
+
+		DVec cross = { {
+			da.v[1]*db.v[2] - da.v[2]*db.v[1],
+			da.v[2]*db.v[0] - da.v[0]*db.v[2],
+			da.v[0]*db.v[1] - da.v[1]*db.v[0],
+			0.0 } };
+		CheckVec(Vector3Cross(a, b), cross, 1e-5, 3);
+
+		DVec normalized = { { da.v[0] / len, da.v[1] / len, da.v[2] / len, 0.0 } };
+		CheckVec(Vector3Normalize(a), normalized, 1e-6, 3);
+
+		double angle = std::acos(std::max(-1.0, std::min(1.0, dot3 / (len*std::sqrt(db.v[0]*db.v[0] + db.v[1]*db.v[1] + db.v[2]*db.v[2])))));
+		CHECK_NEAR(VectorGetX(Vector3AngleBetweenVectors(a, b)), angle, 1e-3);
+	}
+
+	// Normalizing the zero vector must not produce NaNs that poison later math.
+	Vector zero = Vector3Normalize(VectorZero());
+	CHECK(VectorGetX(zero) == VectorGetX(zero));
+}
+
+TEST(SimdMath, Transforms)
+{
+	Random random(3);
+	for(int n = 0; n < 100; ++n)
+	{
+		Matrix m = RandomMatrix(random);
+		Vector v = RandomVector(random);
+		DMat dm = ToD(m);
+		DVec dv = ToD(v);
+
+		CheckVec(Vector4Transform(v, m), Transform(dv, dm), 1e-5);
+
+		DVec point = dv;
+		point.v[3] = 1.0;
+		DVec coord = Transform(point, dm);
+		for(int i = 0; i < 4; ++i)
+			coord.v[i] /= coord.v[3];
+		CheckVec(Vector3TransformCoord(v, m), coord, 1e-4, 3);
+
+		DVec dir = dv;
+		dir.v[3] = 0.0;
+		CheckVec(Vector3TransformNormal(v, m), Transform(dir, dm), 1e-5, 3);
+	}
+
+	// The stream versions give the same results as the single ones.
+	Matrix m = RandomMatrix(random);
+	std::vector<Float3> in(37), out(37);
+	for(Float3& p : in)
+		StoreFloat3(&p, RandomVector(random));
+	Vector3TransformCoordStream(out.data(), sizeof(Float3), in.data(), sizeof(Float3), in.size(), m);
+	for(size_t i = 0; i < in.size(); ++i)
+		CHECK(Vector3Equal(LoadFloat3(&out[i]), Vector3TransformCoord(LoadFloat3(&in[i]), m)));
+	Vector3TransformNormalStream(out.data(), sizeof(Float3), in.data(), sizeof(Float3), in.size(), m);
+	for(size_t i = 0; i < in.size(); ++i)
+		CHECK(Vector3Equal(LoadFloat3(&out[i]), Vector3TransformNormal(LoadFloat3(&in[i]), m)));
+}
+
+TEST(SimdMath, MatrixAlgebra)
+{
+	Random random(4);
+	for(int n = 0; n < 100; ++n)
+	{
+		Matrix a = RandomMatrix(random);
+		Matrix b = RandomMatrix(random);
+		DMat da = ToD(a);
+		DMat db = ToD(b);
+
+		CheckMat(MatrixMultiply(a, b), Multiply(da, db), 1e-5);
+
+		DMat t;
+		for(int i = 0; i < 4; ++i)
+			for(int j = 0; j < 4; ++j)
+				t.m[i][j] = da.m[j][i];
+		CheckMat(MatrixTranspose(a), t, 0.0);
+
+		DMat inv;
+		double det = 0.0;
+		CHECK(Inverse(da, inv, det));
+		CHECK_NEAR(VectorGetX(MatrixDeterminant(a)), det, 1e-5*std::fabs(det));
+
+		Vector invDet;
+		CheckMat(MatrixInverse(&invDet, a), inv, 1e-5);
+		CHECK_NEAR(VectorGetX(invDet), det, 1e-5*std::fabs(det));
+	}
+
+	// A singular matrix has a zero determinant and inverts to the identity.
+	Matrix singular = MatrixScaling(1.0f, 0.0f, 1.0f);
+	Vector det;
+	CheckMat(MatrixInverse(&det, singular), ToD(MatrixIdentity()), 0.0);
+	CHECK(VectorGetX(det) == 0.0f);
+}
+
+TEST(SimdMath, Rotations)
+{
+	Random random(5);
+	const DVec axes[] = { { { 1.0, 0.0, 0.0, 0.0 } }, { { 0.0, 1.0, 0.0, 0.0 } }, { { 0.0, 0.0, 1.0, 0.0 } } };
+	for(int n = 0; n < 50; ++n)
+	{
+		float angle = random.NextFloat(-Pi, Pi);
+		Vector v = VectorSetW(RandomVector(random), 1.0f);
+		DVec dv = ToD(v);
+
+		CheckVec(Vector4Transform(v, MatrixRotationX(angle)), Rotate(dv, axes[0], angle), 1e-5);
+		CheckVec(Vector4Transform(v, MatrixRotationY(angle)), Rotate(dv, axes[1], angle), 1e-5);
+		CheckVec(Vector4Transform(v, MatrixRotationZ(angle)), Rotate(dv, axes[2], angle), 1e-5);
+
+		Vector axis = RandomUnitVector(random);
+		DVec daxis = ToD(axis);
+		DVec expected = Rotate(dv, daxis, angle);
+		CheckVec(Vector4Transform(v, MatrixRotationNormal(axis, angle)), expected, 1e-5);
+		CheckVec(Vector4Transform(v, MatrixRotationAxis(VectorScale(axis, 3.0f), angle)), expected, 1e-5);
+
+		// The quaternion forms rotate the same way.
+		Vector q = QuaternionRotationAxis(axis, angle);
+		CHECK_NEAR(VectorGetX(Vector4Length(q)), 1.0, 1e-6);
+		CheckVec(Vector3Rotate(v, q), expected, 1e-5, 3);
+		CheckMat(MatrixRotationQuaternion(q), ToD(MatrixRotationNormal(axis, angle)), 1e-5);
+
+		// Matrix -> quaternion gives q or -q.
+		Vector back = QuaternionRotationMatrix(MatrixRotationQuaternion(q));
+		float sameSign = VectorGetX(Vector4Dot(back, q));
+		CHECK_NEAR(std::fabs(sameSign), 1.0, 1e-5);
+	}
+
+	// Roll, then pitch, then yaw.
+	float pitch = 0.3f, yaw = -1.1f, roll = 2.0f;
+	Matrix rpy = MatrixMultiply(MatrixMultiply(MatrixRotationZ(roll), MatrixRotationX(pitch)), MatrixRotationY(yaw));
+	CheckMat(MatrixRotationQuaternion(QuaternionRotationRollPitchYaw(pitch, yaw, roll)), ToD(rpy), 1e-5);
+}
+
+TEST(SimdMath, QuaternionSlerp)
+{
+	Random random(6);
+	for(int n = 0; n < 50; ++n)
+	{
+		Vector axis = RandomUnitVector(random);
+		float a0 = random.NextFloat(-Pi, Pi);
+		float a1 = a0 + random.NextFloat(-3.0f, 3.0f);
+		Vector q0 = QuaternionRotationNormal(axis, a0);
+		Vector q1 = QuaternionRotationNormal(axis, a1);
+
+		CheckVec(QuaternionSlerp(q0, q1, 0.0f), ToD(q0), 1e-5);
+
+		// Slerp takes the short way, so the end may be -q1.
+		float endDot = VectorGetX(Vector4Dot(QuaternionSlerp(q0, q1, 1.0f), q1));
+		CHECK_NEAR(std::fabs(endDot), 1.0, 1e-5);
+
+		// About a common axis, slerp interpolates the angle linearly.
+		float t = random.NextFloat();
+		Vector q = QuaternionSlerp(q0, q1, t);
+		CHECK_NEAR(VectorGetX(Vector4Length(q)), 1.0, 1e-5);
+
+		double delta = std::remainder((double)a1 - a0, 2.0*3.14159265358979323846);
+		Vector expected = QuaternionRotationNormal(axis, (float)(a0 + t*delta));
+		CHECK_NEAR(std::fabs(VectorGetX(Vector4Dot(q, expected))), 1.0, 1e-4);
+	}
+
+	// Nearly identical rotations fall back to lerp and stay normalized.
+	Vector q = QuaternionRotationNormal(VectorSet(0.0f, 1.0f, 0.0f, 0.0f), 0.5f);
+	Vector r = QuaternionRotationNormal(VectorSet(0.0f, 1.0f, 0.0f, 0.0f), 0.5001f);
+	CHECK_NEAR(VectorGetX(Vector4Length(QuaternionSlerp(q, r, 0.5f))), 1.0, 1e-6);
+}
+
+TEST(SimdMath, CameraMatrices)
+{
+	Vector eye = VectorSet(3.0f, 4.0f, -10.0f, 1.0f);
+	Vector focus = VectorSet(-1.0f, 0.5f, 2.0f, 1.0f);
+	Vector up = VectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	Matrix view = MatrixLookAtLH(eye, focus, up);
+
+	// The eye goes to the origin and the focus point onto +z.
+	CheckVec(Vector3TransformCoord(eye, view), { { 0.0, 0.0, 0.0, 0.0 } }, 1e-5, 3);
+	double dist = VectorGetX(Vector3Length(VectorSubtract(focus, eye)));
+	CheckVec(Vector3TransformCoord(focus, view), { { 0.0, 0.0, dist, 0.0 } }, 1e-5, 3);
+
+	// The view matrix is a rigid transform.
+	DMat dv = ToD(view);
+	DMat inv;
+	double det = 0.0;
+	CHECK(Inverse(dv, inv, det));
+	CHECK_NEAR(det, 1.0, 1e-5);
+
+	float fovY = 0.25f*Pi, aspect = 1.5f, nearZ = 1.0f, farZ = 100.0f;
+	Matrix proj = MatrixPerspectiveFovLH(fovY, aspect, nearZ, farZ);
+
+	// Depth maps [near, far] to [0, 1] and the fov edges to +-1.
+	CHECK_NEAR(VectorGetZ(Vector3TransformCoord(VectorSet(0.0f, 0.0f, nearZ, 1.0f), proj)), 0.0, 1e-6);
+	CHECK_NEAR(VectorGetZ(Vector3TransformCoord(VectorSet(0.0f, 0.0f, farZ, 1.0f), proj)), 1.0, 1e-6);
+	float z = 10.0f;
+	float edgeY = z*std::tan(0.5f*fovY);
+	CHECK_NEAR(VectorGetY(Vector3TransformCoord(VectorSet(0.0f, edgeY, z, 1.0f), proj)), 1.0, 1e-5);
+	CHECK_NEAR(VectorGetX(Vector3TransformCoord(VectorSet(edgeY*aspect, 0.0f, z, 1.0f), proj)), 1.0, 1e-5);
+
+	Matrix ortho = MatrixOrthographicOffCenterLH(-2.0f, 6.0f, -1.0f, 3.0f, 0.5f, 20.0f);
+	CheckVec(Vector3TransformCoord(VectorSet(-2.0f, -1.0f, 0.5f, 1.0f), ortho), { { -1.0, -1.0, 0.0, 0.0 } }, 1e-6, 3);
+	CheckVec(Vector3TransformCoord(VectorSet(6.0f, 3.0f, 20.0f, 1.0f), ortho), { { 1.0, 1.0, 1.0, 0.0 } }, 1e-6, 3);
+}
+
+TEST(SimdMath, ReflectAndAffine)
+{
+	// Mirror in the plane y = 2.
+	Matrix reflect = MatrixReflect(VectorSet(0.0f, 1.0f, 0.0f, -2.0f));
+	CheckVec(Vector3TransformCoord(VectorSet(1.0f, 5.0f, -3.0f, 1.0f), reflect), { { 1.0, -1.0, -3.0, 0.0 } }, 1e-6, 3);
+
+	Random random(7);
+	for(int n = 0; n < 50; ++n)
+	{
+		Vector scale = VectorSet(random.NextFloat(0.5f, 2.0f), random.NextFloat(0.5f, 2.0f), random.NextFloat(0.5f, 2.0f), 1.0f);
+		Vector origin = VectorSetW(RandomVector(random), 0.0f);
+		Vector axis = RandomUnitVector(random);
+		float angle = random.NextFloat(-Pi, Pi);
+		Vector translation = VectorSetW(RandomVector(random), 0.0f);
+
+		Matrix m = MatrixAffineTransformation(scale, origin, QuaternionRotationNormal(axis, angle), translation);
+
+		// Reference: scale, rotate about origin, translate.
+		Vector p = VectorSetW(RandomVector(random), 1.0f);
+		DVec dp = ToD(p), ds = ToD(scale), dorigin = ToD(origin), dt = ToD(translation);
+		DVec q;
+		for(int i = 0; i < 3; ++i)
+			q.v[i] = dp.v[i]*ds.v[i] - dorigin.v[i];
+		q.v[3] = 1.0;
+		q = Rotate(q, ToD(axis), angle);
+		for(int i = 0; i < 3; ++i)
+			q.v[i] += dorigin.v[i] + dt.v[i];
+
+		CheckVec(Vector3TransformCoord(p, m), q, 1e-4, 3);
+	}
+}
+
+// MathHelper's scalar part must build without DirectXMath so portable code can share it.
+TEST(SimdMath, MathHelperScalarHelpers)
+{
+	for(int n = 0; n < 1000; ++n)
+	{
+		float f = MathHelper::RandF(-2.0f, 3.0f);
+		CHECK(f >= -2.0f && f < 3.0f);
+		int i = MathHelper::Rand(-3, 3);
+		CHECK(i >= -3 && i <= 3);
+	}
+
+	CHECK(MathHelper::Clamp(5, 0, 3) == 3);
+	CHECK(MathHelper::Lerp(2.0f, 4.0f, 0.5f) == 3.0f);
+	CHECK_NEAR(MathHelper::AngleFromXY(0.0f, -1.0f), 1.5*3.14159265358979323846, 1e-6);
+}
+
+BENCHMARK(SimdMath, Transforms)
+{
+	std::printf("    backend: %s\n", BackendName());
+
+	const size_t count = 64*1024;
+	Random random(8);
+	std::vector<Float3> in(count), out(count);
+	random.FillFloats(&in[0].x, count*3, -100.0f, 100.0f);
+	Matrix m = MatrixMultiply(MatrixRotationAxis(VectorSet(1.0f, 2.0f, 3.0f, 0.0f), 0.7f), MatrixTranslation(1.0f, 2.0f, 3.0f));
+	Float4x4 mf;
+	StoreFloat4x4(&mf, m);
+
+	bench.Run("Vector3TransformCoordStream 64K", [&]()
+	{
+		Vector3TransformCoordStream(out.data(), sizeof(Float3), in.data(), sizeof(Float3), count, m);
+	});
+
+	// Plain float loop for comparison.
+	bench.Run("scalar reference 64K", [&]()
+	{
+		const float (*a)[4] = mf.m;
+		for(size_t i = 0; i < count; ++i)
+		{
+			const Float3& p = in[i];
+			float x = p.x*a[0][0] + p.y*a[1][0] + p.z*a[2][0] + a[3][0];
+			float y = p.x*a[0][1] + p.y*a[1][1] + p.z*a[2][1] + a[3][1];
+			float z = p.x*a[0][2] + p.y*a[1][2] + p.z*a[2][2] + a[3][2];
+			float w = p.x*a[0][3] + p.y*a[1][3] + p.z*a[2][3] + a[3][3];
+			out[i] = Float3(x / w, y / w, z / w);
+		}
+	});
+
+	bench.Run("Vector3Normalize 64K", [&]()
+	{
+		for(size_t i = 0; i < count; ++i)
+			StoreFloat3(&out[i], Vector3Normalize(LoadFloat3(&in[i])));
+	});
+}
+
+BENCHMARK(SimdMath, Matrices)
+{
+	const size_t count = 4096;
+	Random random(9);
+	std::vector<Float4x4> mats(count), results(count);
+	for(Float4x4& f : mats)
+		StoreFloat4x4(&f, RandomMatrix(random));
+
+	bench.Run("MatrixMultiply 4K", [&]()
+	{
+		for(size_t i = 0; i + 1 < count; ++i)
+			StoreFloat4x4(&results[i], MatrixMultiply(LoadFloat4x4(&mats[i]), LoadFloat4x4(&mats[i + 1])));
+	});
+
+	bench.Run("MatrixInverse 4K", [&]()
+	{
+		for(size_t i = 0; i < count; ++i)
+			StoreFloat4x4(&results[i], MatrixInverse(nullptr, LoadFloat4x4(&mats[i])));
+	});
+
+	std::vector<Float4> quats(count);
+	for(Float4& q : quats)
+		StoreFloat4(&q, QuaternionRotationAxis(RandomUnitVector(random), random.NextFloat(-Pi, Pi)));
+
+	bench.Run("QuaternionSlerp 4K", [&]()
+	{
+		for(size_t i = 0; i + 1 < count; ++i)
+			StoreFloat4(&quats[i], QuaternionSlerp(LoadFloat4(&quats[i]), LoadFloat4(&quats[i + 1]), 0.3f));
+	});
+
+	bench.Run("MatrixAffineTransformation 4K", [&]()
+	{
+		Vector s = VectorSet(1.0f, 2.0f, 1.0f, 1.0f);
+		Vector t = VectorSet(5.0f, 0.0f, -2.0f, 0.0f);
+		for(size_t i = 0; i < count; ++i)
+			StoreFloat4x4(&results[i], MatrixAffineTransformation(s, VectorZero(), LoadFloat4(&quats[i]), t));
+	});
+}
@@ -0,0 +1,240 @@
+//***************************************************************************************
+// TaskGraphTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/TaskGraph.h"
+#include "../../Common/Random.h"
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+	bool HasPredecessor(const TaskGraph& graph, TaskGraph::TaskId task, TaskGraph::TaskId pred)
+	{
+		const std::vector<TaskGraph::TaskId>& preds = graph.Predecessors(task);
+		return std::find(preds.begin(), preds.end(), pred) != preds.end();
+	}
+
+	void Sleep(int milliseconds)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+	}
+}
+
+TEST(TaskGraph, DependenciesFollowConflicts)
+{
+	TaskGraph graph;
+	auto a = graph.AddResource("A");
+	auto b = graph.AddResource("B");
+
+	auto writeA = graph.AddTask("WriteA", []() {}, {}, { a });
+	auto readA0 = graph.AddTask("ReadA0", []() {}, { a }, {});
+	auto readA1 = graph.AddTask("ReadA1", []() {}, { a }, { b });
+	auto rewriteA = graph.AddTask("RewriteA", []() {}, {}, { a });
+	auto updateA = graph.AddTask("UpdateA", []() {}, { a }, { a });
+	auto readB = graph.AddTask("ReadB", []() {}, { b }, {});
+
+	// Read after write.
+	CHECK(graph.Predecessors(readA0).size() == 1 && HasPredecessor(graph, readA0, writeA));
+	CHECK(graph.Predecessors(readA1).size() == 1 && HasPredecessor(graph, readA1, writeA));
+
+	// Write after read waits for every reader since the last write, and write
+	// after write for the writer.
+	CHECK(graph.Predecessors(rewriteA).size() == 3);
+	CHECK(HasPredecessor(graph, rewriteA, writeA));
+	CHECK(HasPredecessor(graph, rewriteA, readA0));
+	CHECK(HasPredecessor(graph, rewriteA, readA1));
+
+	// Reading and writing the same resource is not a self dependency.
+	CHECK(graph.Predecessors(updateA).size() == 1 && HasPredecessor(graph, updateA, rewriteA));
+
+	CHECK(graph.Predecessors(readB).size() == 1 && HasPredecessor(graph, readB, readA1));
+	CHECK(graph.Predecessors(writeA).empty());
+}
+
+TEST(TaskGraph, RandomGraphsMatchSerialOrder)
+{
+	// Every task folds the values it reads into the values it writes.  Running
+	// the graph must give the same values as calling the tasks in order, and
+	// no task may start before its predecessors have finished.
+	const std::uint32_t resourceCount = 6;
+	const std::uint32_t taskCount = 40;
+	Random random(38);
+
+	for(std::uint32_t threads : { 0u, 1u, 3u, 7u })
+	{
+		ThreadPool pool(threads);
+
+		for(int round = 0; round < 20; ++round)
+		{
+			// Up to two reads and two writes per task.  Missing reads use a
+			// resource nobody writes, which adds no dependencies.
+			const std::uint32_t unused = resourceCount;
+			std::vector<std::uint32_t> reads(2*taskCount), writes(2*taskCount), writeCounts(taskCount);
+			for(std::uint32_t t = 0; t < taskCount; ++t)
+			{
+				reads[2*t] = random.NextUInt(3) == 0 ? unused : random.NextUInt(resourceCount);
+				reads[2*t + 1] = random.NextUInt(3) == 0 ? unused : random.NextUInt(resourceCount);
+				writes[2*t] = random.NextUInt(resourceCount);
+				writes[2*t + 1] = (writes[2*t] + 1 + random.NextUInt(resourceCount - 1)) % resourceCount;
+				writeCounts[t] = random.NextUInt(3);
+			}
+
+			auto runTask = [&](std::vector<std::uint64_t>& values, std::uint32_t t)
+			{
+				std::uint64_t h = 0xcbf29ce484222325ull ^ t;
+				h = (h ^ values[reads[2*t]])*0x100000001b3ull;
+				h = (h ^ values[reads[2*t + 1]])*0x100000001b3ull;
+				for(std::uint32_t i = 0; i < writeCounts[t]; ++i)
+				{
+					std::uint64_t& v = values[writes[2*t + i]];
+					v = (h ^ v)*0x100000001b3ull + i;
+				}
+			};
+
+			std::vector<std::uint64_t> expected(resourceCount + 1, 0);
+			for(std::uint32_t t = 0; t < taskCount; ++t)
+				runTask(expected, t);
+
+			std::vector<std::uint64_t> values(resourceCount + 1, 0);
+			std::atomic<std::uint32_t> clock(0);
+			std::vector<std::uint32_t> started(taskCount), finished(taskCount);
+
+			TaskGraph graph;
+			for(std::uint32_t r = 0; r <= resourceCount; ++r)
+				graph.AddResource("R" + std::to_string(r));
+
+			for(std::uint32_t t = 0; t < taskCount; ++t)
+			{
+				auto function = [&, t]()
+				{
+					started[t] = clock++;
+					runTask(values, t);
+					finished[t] = clock++;
+				};
+
+				std::uint32_t r0 = reads[2*t], r1 = reads[2*t + 1];
+				std::uint32_t w0 = writes[2*t], w1 = writes[2*t + 1];
+				if(writeCounts[t] == 0)
+					graph.AddTask("T", function, { r0, r1 }, {});
+				else if(writeCounts[t] == 1)
+					graph.AddTask("T", function, { r0, r1 }, { w0 });
+				else
+					graph.AddTask("T", function, { r0, r1 }, { w0, w1 });
+			}
+
+			// Runs twice to check the graph can be reused frame after frame.
+			for(int run = 0; run < 2; ++run)
+			{
+				std::fill(values.begin(), values.end(), 0);
+				graph.Run(pool);
+
+				CHECK(values == expected);
+				for(std::uint32_t t = 0; t < taskCount; ++t)
+				{
+					for(TaskGraph::TaskId p : graph.Predecessors(t))
+						CHECK(finished[p] < started[t]);
+					CHECK(graph.GetTaskTiming(t).Worker < pool.WorkerCount());
+				}
+			}
+		}
+	}
+}
+
+TEST(TaskGraph, ExceptionSkipsDependents)
+{
+	ThreadPool pool(3);
+	TaskGraph graph;
+	auto a = graph.AddResource("A");
+	auto b = graph.AddResource("B");
+
+	bool fail = true;
+	std::atomic<std::uint32_t> dependentRuns(0), independentRuns(0);
+	graph.AddTask("Fails", [&fail]() { if(fail) throw std::runtime_error("task failed"); }, {}, { a });
+	graph.AddTask("Dependent", [&dependentRuns]() { dependentRuns++; }, { a }, {});
+	graph.AddTask("Independent", [&independentRuns]() { independentRuns++; }, {}, { b });
+
+	bool caught = false;
+	try
+	{
+		graph.Run(pool);
+	}
+	catch(const std::runtime_error&)
+	{
+		caught = true;
+	}
+	CHECK(caught);
+	CHECK(dependentRuns == 0);
+	CHECK(independentRuns <= 1);
+
+	// The next frame runs everything again.
+	fail = false;
+	graph.Run(pool);
+	CHECK(dependentRuns == 1);
+}
+
+TEST(TaskGraph, CriticalPath)
+{
+	// Two chains, Input > Long and Input > Short > Short2, plus an unrelated
+	// task; the path through Long is the critical one.
+	ThreadPool pool(3);
+	TaskGraph graph;
+	auto input = graph.AddResource("Input");
+	auto x = graph.AddResource("X");
+	auto y = graph.AddResource("Y");
+	auto z = graph.AddResource("Z");
+
+	auto inputTask = graph.AddTask("Input", []() { Sleep(2); }, {}, { input });
+	auto longTask = graph.AddTask("Long", []() { Sleep(40); }, { input }, { x });
+	graph.AddTask("Short", []() { Sleep(2); }, { input }, { y });
+	graph.AddTask("Short2", []() { Sleep(2); }, { y }, {});
+	graph.AddTask("Unrelated", []() { Sleep(5); }, {}, { z });
+
+	const TaskGraph::FrameStats& stats = graph.Run(pool);
+
+	CHECK(stats.CriticalPath.size() == 2 && stats.CriticalPath[0] == inputTask && stats.CriticalPath[1] == longTask);
+	CHECK(stats.CriticalPathMilliseconds >= 42.0f);
+	CHECK(stats.SerialMilliseconds >= stats.CriticalPathMilliseconds + 8.0f);
+	CHECK(stats.WallMilliseconds >= stats.CriticalPathMilliseconds);
+
+	std::string text = graph.CriticalPathToString();
+	CHECK(text.find("Input ") == 0);
+	CHECK(text.find(" > Long ") != std::string::npos);
+	CHECK(text.find("Short") == std::string::npos);
+
+	// An empty graph has an empty path.
+	graph.Clear();
+	CHECK(graph.Run(pool).CriticalPath.empty());
+	CHECK(graph.GetFrameStats().CriticalPathMilliseconds == 0.0f);
+}
+
+BENCHMARK(TaskGraph, Run)
+{
+	// Overhead of scheduling SkinnedMesh's nine Update stages with no work.
+	TaskGraph graph;
+	auto lights = graph.AddResource("Lights");
+	auto materials = graph.AddResource("Materials");
+	auto shadow = graph.AddResource("Shadow");
+	auto frame = graph.AddResource("FrameResource");
+
+	graph.AddTask("AnimateLights", []() {}, {}, { lights });
+	graph.AddTask("AnimateMaterials", []() {}, {}, { materials });
+	graph.AddTask("ObjectCBs", []() {}, {}, {});
+	graph.AddTask("SkinnedCBs", []() {}, {}, {});
+	graph.AddTask("MaterialBuffer", []() {}, { materials }, {});
+	graph.AddTask("ShadowTransform", []() {}, { lights }, { shadow });
+	graph.AddTask("MainPassCB", []() {}, { lights, shadow }, { frame });
+	graph.AddTask("ShadowPassCB", []() {}, { shadow }, {});
+	graph.AddTask("SsaoCB", []() {}, {}, { frame });
+
+	for(std::uint32_t threads : { 0u, 3u })
+	{
+		ThreadPool pool(threads);
+		bench.Run(threads == 0 ? "9 empty tasks, 1 worker" : "9 empty tasks, 4 workers", [&]()
+		{
+			graph.Run(pool);
+		});
+	}
+}
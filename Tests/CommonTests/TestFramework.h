@@ -0,0 +1,152 @@
+//***************************************************************************************
+// TestFramework.h by DanielDFY
+//
+// Minimal test and benchmark registry for the CommonTests console project.
+//
+//   TEST(Meshlet, BuildCoversEveryTriangle)
+//   {
+//       CHECK(mesh.Indices.size() == indices.size());
+//       CHECK_NEAR(sphere.Radius, 1.0f, 1e-4f);
+//   }
+//
+//   BENCHMARK(Meshlet, Build)
+//   {
+//       bench.Run("skull", [&]() { MeshletBuilder::Build(...); });
+//       bench.Report("meshlets", (double)mesh.Meshlets.size());
+//   }
+//
+// A failed CHECK prints the expression and continues, so one run lists every
+// failure of a test.  Benchmarks only run with -bench (see Main.cpp).
+//***************************************************************************************
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace TestFramework
+{
+
+class Benchmark
+{
+public:
+	// Calls body once to warm up, then repeatedly for at least minSeconds and
+	// prints the average time per call.
+	void Run(const char* label, const std::function<void()>& body, double minSeconds = 0.25)
+	{
+		using clock = std::chrono::steady_clock;
+
+		body();
+
+		std::uint64_t calls = 0;
+		double elapsed = 0.0;
+		auto start = clock::now();
+		do
+		{
+			body();
+			++calls;
+			elapsed = std::chrono::duration<double>(clock::now() - start).count();
+		} while(elapsed < minSeconds);
+
+		double perCall = elapsed / (double)calls;
+		const char* unit = "s";
+		if(perCall < 1e-6)
+		{
+			perCall *= 1e9;
+			unit = "ns";
+		}
+		else if(perCall < 1e-3)
+		{
+			perCall *= 1e6;
+			unit = "us";
+		}
+		else if(perCall < 1.0)
+		{
+			perCall *= 1e3;
+			unit = "ms";
+		}
+
+		std::printf("    %-32s %10.3f %s/call (%llu calls)\n", label, perCall, unit, (unsigned long long)calls);
+	}
+
+	// Prints a measured quantity that is not a time, e.g. a cull ratio.
+	void Report(const char* label, double value, const char* unit = "")
+	{
+		std::printf("    %-32s %10.3f %s\n", label, value, unit);
+	}
+};
+
+struct Entry
+{
+	std::string Name;
+	std::function<void()> Test;
+	std::function<void(Benchmark&)> Bench;
+};
+
+inline std::vector<Entry>& Registry()
+{
+	static std::vector<Entry> entries;
+	return entries;
+}
+
+// Failures of the test that is currently running.
+inline int& CurrentFailures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+inline void Fail(const char* file, int line, const std::string& message)
+{
+	std::printf("    %s(%d): %s\n", file, line, message.c_str());
+	++CurrentFailures();
+}
+
+struct Registrar
+{
+	Registrar(const char* name, std::function<void()> test)
+	{
+		Registry().push_back({ name, std::move(test), nullptr });
+	}
+
+	Registrar(const char* name, std::function<void(Benchmark&)> bench)
+	{
+		Registry().push_back({ name, nullptr, std::move(bench) });
+	}
+};
+
+}
+
+#define TEST(group, name)                                                              \
+	static void group##_##name##_Test();                                               \
+	static TestFramework::Registrar group##_##name##_Registrar(#group "." #name,        \
+		std::function<void()>(&group##_##name##_Test));                                 \
+	static void group##_##name##_Test()
+
+#define BENCHMARK(group, name)                                                         \
+	static void group##_##name##_Bench(TestFramework::Benchmark& bench);              \
+	static TestFramework::Registrar group##_##name##_BenchRegistrar(#group "." #name,  \
+		std::function<void(TestFramework::Benchmark&)>(&group##_##name##_Bench));       \
+	static void group##_##name##_Bench(TestFramework::Benchmark& bench)
+
+#define CHECK(expr)                                                                    \
+	do                                                                                 \
+	{                                                                                  \
+		if(!(expr))                                                                    \
+			TestFramework::Fail(__FILE__, __LINE__, "CHECK(" #expr ") failed");        \
+	} while(false)
+
+#define CHECK_NEAR(a, b, eps)                                                          \
+	do                                                                                 \
+	{                                                                                  \
+		double checkA_ = (double)(a);                                                  \
+		double checkB_ = (double)(b);                                                  \
+		double checkD_ = checkA_ > checkB_ ? checkA_ - checkB_ : checkB_ - checkA_;    \
+		if(!(checkD_ <= (double)(eps)))                                                \
+			TestFramework::Fail(__FILE__, __LINE__, "CHECK_NEAR(" #a ", " #b ") failed: " \
+				+ std::to_string(checkA_) + " vs " + std::to_string(checkB_));            \
+	} while(false)
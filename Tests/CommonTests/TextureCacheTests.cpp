@@ -0,0 +1,284 @@
+//***************************************************************************************
+// TextureCacheTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/TextureCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+namespace
+{
+	// Records which textures the cache creates and destroys.
+	class MockBackend : public TextureCache::Backend
+	{
+	public:
+		bool CreateTexture(TextureCache::TextureId id, const DDSFile& file)override
+		{
+			CHECK(std::find(Live.begin(), Live.end(), id) == Live.end());
+
+			// The file must be readable for the whole call.
+			const DDSFile::Subresource& s = file.GetSubresource(0, 0);
+			Checksum += s.Data[0] + s.Data[s.SlicePitch * s.Depth - 1];
+
+			Created++;
+			if(Refuse)
+				return false;
+
+			Live.push_back(id);
+			return true;
+		}
+
+		void DestroyTexture(TextureCache::TextureId id)override
+		{
+			auto it = std::find(Live.begin(), Live.end(), id);
+			CHECK(it != Live.end());
+			if(it != Live.end())
+				Live.erase(it);
+			Destroyed.push_back(id);
+		}
+
+		std::vector<TextureCache::TextureId> Live;
+		std::vector<TextureCache::TextureId> Destroyed;
+		std::uint32_t Created = 0;
+		std::uint32_t Checksum = 0;
+		bool Refuse = false;
+	};
+
+	// An uncompressed RGBA file with one mip whose texels are all fill, so
+	// files with the same size and fill have the same contents.  Removed again
+	// when the test ends.
+	class TempTexture
+	{
+	public:
+		TempTexture(const std::string& filename, std::uint32_t size, char fill) :
+			mFilename(filename)
+		{
+			DDSFile::Desc desc;
+			desc.Dimension = DDSFile::TextureDimension::Texture2D;
+			desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			desc.Width = size;
+			desc.Height = size;
+			desc.Depth = 1;
+			desc.ArraySize = 1;
+			desc.MipLevels = 1;
+
+			std::ostringstream out;
+			CHECK(DDSFile::WriteHeader(out, desc));
+			std::string file = out.str();
+			file.append((size_t)size * size * 4, fill);
+
+			std::ofstream fout(mFilename, std::ios::binary);
+			fout.write(file.data(), file.size());
+		}
+
+		~TempTexture()
+		{
+			std::remove(mFilename.c_str());
+		}
+
+		const std::string& Filename()const { return mFilename; }
+
+	private:
+		std::string mFilename;
+	};
+
+	TextureCache::Settings MakeSettings(std::uint32_t ioThreads, std::uint64_t budgetBytes)
+	{
+		TextureCache::Settings settings;
+		settings.IoThreads = ioThreads;
+		settings.BudgetBytes = budgetBytes;
+		return settings;
+	}
+
+	// Bytes of one test texture.
+	const std::uint64_t TextureBytes = 64 * 64 * 4;
+}
+
+TEST(TextureCache, PathsAndContentsShareTextures)
+{
+	TempTexture a("TextureCacheTests.A.tmp.dds", 64, 1);
+	TempTexture copy("TextureCacheTests.Copy.tmp.dds", 64, 1);
+	TempTexture b("TextureCacheTests.B.tmp.dds", 64, 2);
+
+	for(std::uint32_t ioThreads : { 0u, 2u })
+	{
+		MockBackend backend;
+		TextureCache cache(backend, MakeSettings(ioThreads, TextureBytes * 16));
+
+		// The same path spelled differently, while the first load is still
+		// pending, shares that load.
+		TextureCache::Handle h0 = cache.Acquire(a.Filename());
+		TextureCache::Handle h1 = cache.Acquire("TEXTURECACHETESTS.a.TMP.DDS");
+		CHECK(!cache.IsReady(h0) && !cache.IsFailed(h0));
+
+		TextureCache::Handle h2 = cache.Acquire(copy.Filename());
+		TextureCache::Handle h3 = cache.Acquire(b.Filename());
+		cache.WaitIdle();
+
+		CHECK(cache.IsReady(h0) && cache.IsReady(h1) && cache.IsReady(h2) && cache.IsReady(h3));
+		CHECK(cache.GetTexture(h0) == cache.GetTexture(h1));
+		CHECK(cache.GetTexture(h0) == cache.GetTexture(h2));
+		CHECK(cache.GetTexture(h0) != cache.GetTexture(h3));
+		CHECK(cache.GetDesc(h0).Width == 64);
+		CHECK(backend.Created == 2 && backend.Live.size() == 2);
+
+		// A resident path is a hit without touching the file.
+		TextureCache::Handle h4 = cache.Acquire(copy.Filename());
+		CHECK(cache.IsReady(h4));
+
+		const TextureCache::Stats& stats = cache.GetStats();
+		CHECK(stats.Requests == 5);
+		CHECK(stats.Coalesced == 1);
+		CHECK(stats.PathHits == 1);
+		CHECK(stats.Misses == 3);
+		CHECK(stats.ContentHits == 1);
+		CHECK(stats.ResidentTextures == 2 && stats.ResidentBytes == 2 * TextureBytes);
+		CHECK(stats.FailedLoads == 0);
+	}
+}
+
+TEST(TextureCache, EvictsLeastRecentlyReleased)
+{
+	std::vector<std::unique_ptr<TempTexture>> files;
+	for(char i = 0; i < 4; ++i)
+		files.push_back(std::make_unique<TempTexture>("TextureCacheTests." + std::to_string(i) + ".tmp.dds", 64, i));
+
+	MockBackend backend;
+	TextureCache cache(backend, MakeSettings(0, TextureBytes * 2));
+
+	// Over budget while everything is held: nothing can go.
+	std::vector<TextureCache::Handle> handles;
+	for(const auto& file : files)
+		handles.push_back(cache.Acquire(file->Filename()));
+	cache.Update();
+	CHECK(backend.Live.size() == 4 && backend.Destroyed.empty());
+
+	std::vector<TextureCache::TextureId> ids;
+	for(const TextureCache::Handle& h : handles)
+		ids.push_back(cache.GetTexture(h));
+
+	// Released in the order 2, 0, 3; 1 stays held.
+	handles[2].Reset();
+	handles[0].Reset();
+	handles[3].Reset();
+	cache.Update();
+	CHECK(backend.Destroyed.size() == 2);
+	CHECK(backend.Destroyed[0] == ids[2] && backend.Destroyed[1] == ids[0]);
+	CHECK(cache.GetStats().ResidentBytes == 2 * TextureBytes);
+	CHECK(cache.GetStats().Evictions == 2);
+
+	// Acquiring 3 again is free and makes 1 and 3 both held; loading 0 again
+	// goes over budget with nothing to evict.
+	TextureCache::Handle again = cache.Acquire(files[3]->Filename());
+	CHECK(cache.IsReady(again) && cache.GetTexture(again) == ids[3]);
+	TextureCache::Handle reloaded = cache.Acquire(files[0]->Filename());
+	CHECK(!cache.IsReady(reloaded));
+	cache.Update();
+	CHECK(cache.IsReady(reloaded));
+	CHECK(backend.Live.size() == 3 && cache.GetStats().Evictions == 2);
+
+	// Released again, 3 is now the least recent.
+	again.Reset();
+	reloaded.Reset();
+	cache.Update();
+	CHECK(backend.Destroyed.size() == 3 && backend.Destroyed[2] == ids[3]);
+	CHECK(backend.Live.size() == 2);
+
+	handles.clear();
+}
+
+TEST(TextureCache, FailedPathsRetryOnceReleased)
+{
+	const std::string filename = "TextureCacheTests.Late.tmp.dds";
+	std::remove(filename.c_str());
+
+	for(std::uint32_t ioThreads : { 0u, 2u })
+	{
+		MockBackend backend;
+		TextureCache cache(backend, MakeSettings(ioThreads, TextureBytes * 16));
+
+		TextureCache::Handle h0 = cache.Acquire(filename);
+		cache.WaitIdle();
+		CHECK(cache.IsFailed(h0) && !cache.IsReady(h0));
+
+		// While a Handle sees the failure it stays failed.
+		TextureCache::Handle h1 = cache.Acquire(filename);
+		CHECK(cache.IsFailed(h1));
+		CHECK(cache.GetStats().Misses == 1 && cache.GetStats().PathHits == 1);
+
+		// Once nothing holds it, the file is looked at again.
+		h0.Reset();
+		h1.Reset();
+		{
+			TempTexture late(filename, 64, 5);
+			TextureCache::Handle h2 = cache.Acquire(filename);
+			cache.WaitIdle();
+			CHECK(cache.IsReady(h2) && !cache.IsFailed(h2));
+			CHECK(cache.GetStats().Misses == 2 && cache.GetStats().FailedLoads == 1);
+		}
+
+		// A load nobody waits for anymore leaves nothing behind either.
+		TextureCache::Handle h3 = cache.Acquire("TextureCacheTests.Missing.tmp.dds");
+		h3.Reset();
+		cache.WaitIdle();
+		h3 = cache.Acquire("TextureCacheTests.Missing.tmp.dds");
+		CHECK(!cache.IsFailed(h3));
+		cache.WaitIdle();
+		CHECK(cache.IsFailed(h3));
+		CHECK(cache.GetStats().Misses == 4 && cache.GetStats().FailedLoads == 3);
+	}
+}
+
+TEST(TextureCache, BackendFailures)
+{
+	TempTexture file("TextureCacheTests.Refused.tmp.dds", 64, 7);
+
+	MockBackend backend;
+	TextureCache cache(backend, MakeSettings(0, TextureBytes * 16));
+
+	backend.Refuse = true;
+	TextureCache::Handle h0 = cache.Acquire(file.Filename());
+	cache.Update();
+	CHECK(cache.IsFailed(h0));
+	CHECK(cache.GetStats().FailedLoads == 1 && cache.GetStats().ResidentTextures == 0);
+
+	// The id the backend refused is handed out again.
+	h0.Reset();
+	backend.Refuse = false;
+	TextureCache::Handle h1 = cache.Acquire(file.Filename());
+	cache.Update();
+	CHECK(cache.IsReady(h1) && cache.GetTexture(h1) == 0);
+	CHECK(backend.Created == 2 && backend.Live.size() == 1);
+}
+
+BENCHMARK(TextureCache, Acquire)
+{
+	TempTexture file("TextureCacheTests.Bench.tmp.dds", 256, 9);
+
+	MockBackend backend;
+	TextureCache cache(backend, MakeSettings(0, 0));
+
+	// Budget 0: every release evicts, so each Acquire reads, hashes and
+	// creates the texture again.
+	bench.Run("Acquire and create a 256x256 RGBA texture", [&]()
+	{
+		TextureCache::Handle h = cache.Acquire(file.Filename());
+		cache.Update();
+		h.Reset();
+		cache.Update();
+	});
+
+	std::vector<TextureCache::Handle> held;
+	held.push_back(cache.Acquire(file.Filename()));
+	cache.Update();
+	bench.Run("Acquire a resident texture", [&]()
+	{
+		TextureCache::Handle h = cache.Acquire(file.Filename());
+	});
+	held.clear();
+	cache.Update();
+}
@@ -0,0 +1,289 @@
+//***************************************************************************************
+// TexturePackerTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/TexturePacker.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	// Writes RGBA frames whose texel (x, y) of mip m reads (frame, x, y, m),
+	// so a packed texel tells where it came from; removes them at the end.
+	class Frames
+	{
+	public:
+		Frames(const std::string& prefix, std::uint32_t count, std::uint32_t size, std::uint32_t mipLevels,
+			DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM)
+		{
+			for(std::uint32_t i = 0; i < count; ++i)
+				Add(prefix + std::to_string(i) + ".tmp.dds", i, size, size, mipLevels, format);
+		}
+
+		~Frames()
+		{
+			for(const std::string& name : Names)
+				std::remove(name.c_str());
+		}
+
+		void Add(const std::string& filename, std::uint32_t frame, std::uint32_t width, std::uint32_t height,
+			std::uint32_t mipLevels, DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM)
+		{
+			DDSFile::Desc desc;
+			desc.Dimension = DDSFile::TextureDimension::Texture2D;
+			desc.Format = format;
+			desc.Width = width;
+			desc.Height = height;
+			desc.Depth = 1;
+			desc.MipLevels = mipLevels;
+			desc.ArraySize = 1;
+
+			std::ostringstream out;
+			CHECK(DDSFile::WriteHeader(out, desc));
+			std::string file = out.str();
+
+			bool bc = format != DXGI_FORMAT_R8G8B8A8_UNORM;
+			for(std::uint32_t mip = 0; mip < mipLevels; ++mip)
+			{
+				std::uint32_t w = std::max(width >> mip, 1u);
+				std::uint32_t h = std::max(height >> mip, 1u);
+				if(bc)
+				{
+					// BC1: 8 bytes per 4x4 block, filled with the frame index.
+					file.append((size_t)((w + 3) / 4) * ((h + 3) / 4) * 8, (char)frame);
+					continue;
+				}
+
+				for(std::uint32_t y = 0; y < h; ++y)
+				{
+					for(std::uint32_t x = 0; x < w; ++x)
+					{
+						const char texel[4] = { (char)frame, (char)x, (char)y, (char)mip };
+						file.append(texel, 4);
+					}
+				}
+			}
+
+			std::ofstream fout(filename, std::ios::binary);
+			fout.write(file.data(), file.size());
+			Names.push_back(filename);
+		}
+
+		std::vector<std::string> Names;
+	};
+
+	const std::uint8_t* Texel(const DDSFile& file, std::uint32_t mip, std::uint32_t slice,
+		std::uint32_t x, std::uint32_t y)
+	{
+		const DDSFile::Subresource& s = file.GetSubresource(mip, slice);
+		return s.Data + y * s.RowPitch + x * 4;
+	}
+}
+
+TEST(TexturePacker, ArrayKeepsEveryFrame)
+{
+	Frames frames("TexturePackerTests.array.", 5, 16, 5);
+	const char* output = "TexturePackerTests.array.out.tmp.dds";
+
+	TexturePacker::Report report;
+	CHECK(TexturePacker::PackArray(frames.Names, output, &report) == TexturePacker::Status::Ok);
+	CHECK(report.Frames == 5 && report.DerivedMips == 0 && report.DroppedMips == 0);
+	CHECK(report.PackedResourceBytes <= report.SourceResourceBytes);
+	CHECK(report.PackedUploadBytes <= report.SourceUploadBytes);
+
+	DDSFile packed;
+	CHECK(packed.Open(output) == DDSFile::Status::Ok);
+	CHECK(report.PackedFileBytes == packed.Size());
+
+	const DDSFile::Desc& desc = packed.GetDesc();
+	CHECK(desc.Width == 16 && desc.Height == 16 && desc.MipLevels == 5 && desc.ArraySize == 5);
+
+	// Slice i is frame i, byte for byte.
+	for(std::uint32_t slice = 0; slice < 5; ++slice)
+	{
+		DDSFile source;
+		CHECK(source.Open(frames.Names[slice]) == DDSFile::Status::Ok);
+		for(std::uint32_t mip = 0; mip < 5; ++mip)
+		{
+			const DDSFile::Subresource& a = packed.GetSubresource(mip, slice);
+			const DDSFile::Subresource& b = source.GetSubresource(mip, 0);
+			CHECK(a.SlicePitch == b.SlicePitch && std::memcmp(a.Data, b.Data, (size_t)a.SlicePitch) == 0);
+		}
+	}
+
+	TexturePacker::Layout layout;
+	CHECK(TexturePacker::ReadLayout(packed, &layout));
+	CHECK(layout.Frames == 5 && !layout.IsAtlas());
+	CHECK(TexturePacker::GetAtlasTransforms(layout).empty());
+	packed.Close();
+
+	CHECK(TexturePacker::IsPacked(output, 5));
+	CHECK(!TexturePacker::IsPacked(output, 4));
+	CHECK(!TexturePacker::IsPacked(frames.Names[0], 1));
+	std::remove(output);
+}
+
+TEST(TexturePacker, AtlasGrid)
+{
+	Frames frames("TexturePackerTests.atlas.", 5, 16, 5);
+	const char* output = "TexturePackerTests.atlas.out.tmp.dds";
+
+	// Closest to square for five frames: 3 x 2, one cell empty.
+	TexturePacker::Report report;
+	CHECK(TexturePacker::PackAtlas(frames.Names, output, 0, &report) == TexturePacker::Status::Ok);
+	CHECK(report.PackedLayout.Columns == 3 && report.PackedLayout.Rows == 2);
+
+	DDSFile packed;
+	CHECK(packed.Open(output) == DDSFile::Status::Ok);
+	const DDSFile::Desc& desc = packed.GetDesc();
+	CHECK(desc.Width == 48 && desc.Height == 32 && desc.ArraySize == 1 && desc.MipLevels == 5);
+
+	for(std::uint32_t mip = 0; mip < desc.MipLevels; ++mip)
+	{
+		std::uint32_t size = 16 >> mip;
+		for(std::uint32_t y = 0; y < 2 * size; ++y)
+		{
+			for(std::uint32_t x = 0; x < 3 * size; ++x)
+			{
+				std::uint32_t frame = (y / size) * 3 + x / size;
+				const std::uint8_t* t = Texel(packed, mip, 0, x, y);
+				if(frame < 5)
+					CHECK(t[0] == frame && t[1] == x % size && t[2] == y % size && t[3] == mip);
+				else
+					CHECK(t[0] == 0 && t[1] == 0 && t[2] == 0 && t[3] == 0);
+			}
+		}
+	}
+
+	TexturePacker::Layout layout;
+	CHECK(TexturePacker::ReadLayout(packed, &layout));
+	std::vector<TexturePacker::AtlasTransform> transforms = TexturePacker::GetAtlasTransforms(layout);
+	CHECK(transforms.size() == 5);
+	CHECK_NEAR(transforms[4].ScaleU, 1.0f / 3.0f, 1e-6f);
+	CHECK_NEAR(transforms[4].ScaleV, 0.5f, 1e-6f);
+	CHECK_NEAR(transforms[4].OffsetU, 1.0f / 3.0f, 1e-6f);
+	CHECK_NEAR(transforms[4].OffsetV, 0.5f, 1e-6f);
+	packed.Close();
+
+	// A single row when asked for.
+	CHECK(TexturePacker::PackAtlas(frames.Names, output, 5, &report) == TexturePacker::Status::Ok);
+	CHECK(report.PackedLayout.Columns == 5 && report.PackedLayout.Rows == 1);
+	std::remove(output);
+}
+
+TEST(TexturePacker, ShortMipChains)
+{
+	const char* output = "TexturePackerTests.short.out.tmp.dds";
+
+	// RGBA: the frame saved without mips gets them box filtered.
+	Frames rgba("TexturePackerTests.short.", 3, 16, 5);
+	rgba.Add("TexturePackerTests.short.top.tmp.dds", 3, 16, 16, 1);
+
+	TexturePacker::Report report;
+	CHECK(TexturePacker::PackArray(rgba.Names, output, &report) == TexturePacker::Status::Ok);
+	CHECK(report.DerivedMips == 4 && report.DroppedMips == 0);
+
+	DDSFile packed;
+	CHECK(packed.Open(output) == DDSFile::Status::Ok);
+	CHECK(packed.GetDesc().MipLevels == 5);
+	for(std::uint32_t mip = 1; mip < 5; ++mip)
+	{
+		// The frame channel is constant and so survives filtering exactly;
+		// alpha is the top mip's 0.
+		const std::uint8_t* t = Texel(packed, mip, 3, 0, 0);
+		CHECK(t[0] == 3 && t[3] == 0);
+	}
+	packed.Close();
+
+	// BC1 cannot be filtered: the chain is cut to the shortest one.
+	Frames bc("TexturePackerTests.bc.", 2, 16, 5, DXGI_FORMAT_BC1_UNORM);
+	bc.Add("TexturePackerTests.bc.short.tmp.dds", 2, 16, 16, 2, DXGI_FORMAT_BC1_UNORM);
+
+	CHECK(TexturePacker::PackArray(bc.Names, output, &report) == TexturePacker::Status::Ok);
+	CHECK(report.DerivedMips == 0 && report.DroppedMips == 3);
+	CHECK(packed.Open(output) == DDSFile::Status::Ok);
+	CHECK(packed.GetDesc().MipLevels == 2 && packed.GetDesc().ArraySize == 3);
+	packed.Close();
+
+	// An atlas of BC1 keeps only the mips that are whole blocks: 16, 8 and 4.
+	Frames bcFull("TexturePackerTests.bcfull.", 4, 16, 5, DXGI_FORMAT_BC1_UNORM);
+	CHECK(TexturePacker::PackAtlas(bcFull.Names, output, 2, &report) == TexturePacker::Status::Ok);
+	CHECK(report.DroppedMips == 2);
+	CHECK(packed.Open(output) == DDSFile::Status::Ok);
+	CHECK(packed.GetDesc().Width == 32 && packed.GetDesc().MipLevels == 3);
+	packed.Close();
+
+	std::remove(output);
+}
+
+TEST(TexturePacker, Errors)
+{
+	const char* output = "TexturePackerTests.errors.out.tmp.dds";
+	Frames frames("TexturePackerTests.errors.", 2, 16, 5);
+	TexturePacker::Report report;
+
+	CHECK(TexturePacker::PackArray({}, output) == TexturePacker::Status::NotSupported);
+
+	std::vector<std::string> missing = frames.Names;
+	missing.push_back("TexturePackerTests.missing.dds");
+	CHECK(TexturePacker::PackArray(missing, output, &report) == TexturePacker::Status::OpenFailed);
+	CHECK(report.Filename == "TexturePackerTests.missing.dds");
+
+	frames.Add("TexturePackerTests.errors.big.tmp.dds", 2, 32, 32, 6);
+	CHECK(TexturePacker::PackAtlas(frames.Names, output, 0, &report) == TexturePacker::Status::Mismatch);
+	CHECK(report.Filename == "TexturePackerTests.errors.big.tmp.dds");
+
+	// Nothing is left behind by a failed pack.
+	std::ifstream written(output);
+	CHECK(!written);
+	CHECK(std::strcmp(TexturePacker::StatusToString(TexturePacker::Status::Mismatch), "Mismatch") == 0);
+}
+
+TEST(TexturePacker, BoltFrames)
+{
+	// The flipbook Exercise_11_07 packs; two of its frames have no mips.
+	std::vector<std::string> names;
+	for(int i = 1; i <= 60; ++i)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "../../Textures/Bolt%03d.dds", i);
+		names.push_back(name);
+	}
+
+	const char* output = "TexturePackerTests.bolt.tmp.dds";
+	TexturePacker::Report report;
+	CHECK(TexturePacker::PackArray(names, output, &report) == TexturePacker::Status::Ok);
+	CHECK(report.Frames == 60 && report.DerivedMips > 0);
+	CHECK(report.PackedResourceBytes < report.SourceResourceBytes);
+	CHECK(TexturePacker::IsPacked(output, 60));
+	std::remove(output);
+}
+
+BENCHMARK(TexturePacker, BoltFrames)
+{
+	std::vector<std::string> names;
+	for(int i = 1; i <= 60; ++i)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "../../Textures/Bolt%03d.dds", i);
+		names.push_back(name);
+	}
+
+	const char* output = "TexturePackerTests.bench.tmp.dds";
+	TexturePacker::Report report;
+	bench.Run("pack 60 frames as an array", [&]()
+	{
+		TexturePacker::PackArray(names, output, &report);
+	});
+	bench.Run("pack 60 frames as an atlas", [&]()
+	{
+		TexturePacker::PackAtlas(names, output, 0, &report);
+	});
+	bench.Report("atlas resource", (double)report.PackedResourceBytes / 1024, "KB");
+	bench.Report("separate resources", (double)report.SourceResourceBytes / 1024, "KB");
+	std::remove(output);
+}
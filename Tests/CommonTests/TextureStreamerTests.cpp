@@ -0,0 +1,303 @@
+//***************************************************************************************
+// TextureStreamerTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/TextureStreamer.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	// Records what the streamer asks for instead of creating textures.
+	class MockBackend : public TextureStreamer::Backend
+	{
+	public:
+		struct Call
+		{
+			TextureStreamer::TextureId Id;
+			std::uint32_t FirstMip;
+		};
+
+		void RegisterTexture(TextureStreamer::TextureId id, const DDSFile::Desc& desc)override
+		{
+			if(id >= Descs.size())
+				Descs.resize(id + 1);
+			Descs[id] = desc;
+		}
+
+		bool SetResidentMips(TextureStreamer::TextureId id, const DDSFile& file, std::uint32_t firstMip)override
+		{
+			// Every mip handed over must be readable.
+			const DDSFile::Desc& desc = file.GetDesc();
+			for(std::uint32_t slice = 0; slice < desc.ArraySize; ++slice)
+			{
+				for(std::uint32_t mip = firstMip; mip < desc.MipLevels; ++mip)
+				{
+					const DDSFile::Subresource& s = file.GetSubresource(mip, slice);
+					Checksum += s.Data[0] + s.Data[s.SlicePitch * s.Depth - 1];
+				}
+			}
+
+			Call call;
+			call.Id = id;
+			call.FirstMip = firstMip;
+			Calls.push_back(call);
+
+			return id != RefusedId;
+		}
+
+		std::vector<DDSFile::Desc> Descs;
+		std::vector<Call> Calls;
+		TextureStreamer::TextureId RefusedId = TextureStreamer::InvalidTexture;
+		std::uint32_t Checksum = 0;
+	};
+
+	// An uncompressed RGBA file, removed again when the test ends.
+	class TempTexture
+	{
+	public:
+		TempTexture(const std::string& filename, std::uint32_t size, std::uint32_t arraySize, bool cube) :
+			mFilename(filename)
+		{
+			DDSFile::Desc desc;
+			desc.Dimension = DDSFile::TextureDimension::Texture2D;
+			desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			desc.Width = size;
+			desc.Height = size;
+			desc.Depth = 1;
+			desc.ArraySize = arraySize;
+			desc.IsCubeMap = cube;
+			desc.MipLevels = 1;
+			while((size >> (desc.MipLevels - 1)) > 1)
+				desc.MipLevels++;
+
+			std::ostringstream out;
+			CHECK(DDSFile::WriteHeader(out, desc));
+			std::string file = out.str();
+			for(std::uint32_t slice = 0; slice < arraySize; ++slice)
+			{
+				for(std::uint32_t mip = 0; mip < desc.MipLevels; ++mip)
+				{
+					std::uint32_t s = std::max(size >> mip, 1u);
+					file.append((size_t)s * s * 4, (char)mip);
+				}
+			}
+
+			std::ofstream fout(mFilename, std::ios::binary);
+			fout.write(file.data(), file.size());
+		}
+
+		~TempTexture()
+		{
+			std::remove(mFilename.c_str());
+		}
+
+		const std::string& Filename()const { return mFilename; }
+
+	private:
+		std::string mFilename;
+	};
+
+	// Bytes of mips [firstMip, end) of a square RGBA texture with one slice.
+	std::uint64_t MipBytes(std::uint32_t size, std::uint32_t firstMip)
+	{
+		std::uint64_t bytes = 0;
+		for(std::uint32_t s = size >> firstMip; s > 0; s >>= 1)
+			bytes += (std::uint64_t)s * s * 4;
+		return bytes;
+	}
+
+	TextureStreamer::Settings SyncSettings()
+	{
+		TextureStreamer::Settings settings;
+		settings.IoThreads = 0;
+		settings.MipTailSize = 64;
+		return settings;
+	}
+}
+
+TEST(TextureStreamer, TailsFirstThenDetail)
+{
+	TempTexture file("TextureStreamerTests.0.tmp.dds", 256, 1, false);
+
+	MockBackend backend;
+	TextureStreamer streamer(backend, SyncSettings());
+
+	TextureStreamer::TextureId ids[3];
+	for(TextureStreamer::TextureId& id : ids)
+		id = streamer.Register(file.Filename());
+	CHECK(backend.Descs.size() == 3 && backend.Descs[2].Width == 256 && backend.Descs[2].MipLevels == 9);
+	CHECK(streamer.GetResidentMip(ids[0]) == TextureStreamer::NotResident);
+
+	// Loads issued by one Update are uploaded by the next.
+	streamer.Update();
+	CHECK(backend.Calls.empty());
+	streamer.Update();
+	CHECK(backend.Calls.size() == 3);
+	for(size_t i = 0; i < backend.Calls.size(); ++i)
+		CHECK(backend.Calls[i].Id == ids[i] && backend.Calls[i].FirstMip == 2);
+	CHECK(streamer.GetStats().TailsLoaded == 3);
+	CHECK(streamer.GetStats().ResidentBytes == 3 * MipBytes(256, 2));
+
+	// Texture 1 fills the screen and texture 2 half of it; texture 0 is unused
+	// and keeps its tail.  Detail arrives one mip at a time.
+	for(int frame = 0; frame < 10; ++frame)
+	{
+		streamer.ReportUsage(ids[1], 256.0f);
+		streamer.ReportUsage(ids[2], 128.0f);
+		streamer.Update();
+	}
+	CHECK(streamer.GetResidentMip(ids[0]) == 2);
+	CHECK(streamer.GetResidentMip(ids[1]) == 0);
+	CHECK(streamer.GetResidentMip(ids[2]) == 1);
+	CHECK(streamer.GetStats().MipsLoaded == 3);
+	CHECK(streamer.GetStats().ResidentBytes == MipBytes(256, 2) + MipBytes(256, 0) + MipBytes(256, 1));
+	CHECK(streamer.GetStats().PendingLoads == 0 && streamer.GetStats().PendingBytes == 0);
+	for(size_t i = 3; i < backend.Calls.size(); ++i)
+		CHECK(backend.Calls[i].Id != ids[0]);
+}
+
+TEST(TextureStreamer, BudgetEvictsUnusedTextures)
+{
+	TempTexture file("TextureStreamerTests.1.tmp.dds", 256, 1, false);
+
+	// Room for both tails and one texture at full detail, not two.
+	TextureStreamer::Settings settings = SyncSettings();
+	settings.BudgetBytes = MipBytes(256, 0) + MipBytes(256, 2) + 1024;
+	settings.EvictionDelayFrames = 2;
+
+	MockBackend backend;
+	TextureStreamer streamer(backend, settings);
+	TextureStreamer::TextureId a = streamer.Register(file.Filename());
+	TextureStreamer::TextureId b = streamer.Register(file.Filename());
+
+	auto run = [&](TextureStreamer::TextureId used, int frames)
+	{
+		for(int i = 0; i < frames; ++i)
+		{
+			streamer.ReportUsage(used, 512.0f);
+			streamer.Update();
+
+			const TextureStreamer::Stats& stats = streamer.GetStats();
+			CHECK(stats.ResidentBytes + stats.PendingBytes <= settings.BudgetBytes);
+		}
+	};
+
+	run(a, 10);
+	CHECK(streamer.GetResidentMip(a) == 0 && streamer.GetResidentMip(b) == 2);
+	CHECK(streamer.GetStats().MipsEvicted == 0);
+
+	// b can only get its detail once a has gone unused for long enough.
+	run(b, 10);
+	CHECK(streamer.GetResidentMip(a) == 2 && streamer.GetResidentMip(b) == 0);
+	CHECK(streamer.GetStats().MipsEvicted == 2);
+	CHECK(streamer.GetStats().BudgetStalls > 0);
+	CHECK(streamer.GetStats().PeakResidentBytes <= settings.BudgetBytes);
+
+	// The eviction went through the backend: a's last call dropped to the tail.
+	for(size_t i = backend.Calls.size(); i-- > 0;)
+	{
+		if(backend.Calls[i].Id == a)
+		{
+			CHECK(backend.Calls[i].FirstMip == 2);
+			break;
+		}
+	}
+}
+
+TEST(TextureStreamer, Failures)
+{
+	TempTexture file("TextureStreamerTests.2.tmp.dds", 128, 1, false);
+
+	MockBackend backend;
+	TextureStreamer streamer(backend, SyncSettings());
+
+	// A missing file fails in Register and never reaches the backend.
+	TextureStreamer::TextureId missing = streamer.Register("TextureStreamerTests.missing.dds");
+	CHECK(streamer.IsFailed(missing));
+	CHECK(streamer.GetStats().FailedTextures == 1);
+	CHECK(backend.Descs.size() <= missing);
+
+	// A texture the backend refuses keeps failing quietly, without retries.
+	TextureStreamer::TextureId refused = streamer.Register(file.Filename());
+	TextureStreamer::TextureId ok = streamer.Register(file.Filename());
+	backend.RefusedId = refused;
+	for(int i = 0; i < 5; ++i)
+	{
+		streamer.ReportUsage(refused, 128.0f);
+		streamer.ReportUsage(ok, 128.0f);
+		streamer.Update();
+	}
+
+	CHECK(streamer.IsFailed(refused) && !streamer.IsFailed(ok));
+	CHECK(streamer.GetResidentMip(refused) == TextureStreamer::NotResident);
+	CHECK(streamer.GetResidentMip(ok) == 0);
+	CHECK(streamer.GetStats().FailedTextures == 2);
+	CHECK(std::count_if(backend.Calls.begin(), backend.Calls.end(),
+		[&](const MockBackend::Call& c) { return c.Id == refused; }) == 1);
+	CHECK(std::none_of(backend.Calls.begin(), backend.Calls.end(),
+		[&](const MockBackend::Call& c) { return c.Id == missing; }));
+}
+
+TEST(TextureStreamer, RegisterReportsDimension)
+{
+	TempTexture cube("TextureStreamerTests.3.tmp.dds", 64, 6, true);
+	TempTexture array("TextureStreamerTests.4.tmp.dds", 64, 3, false);
+
+	MockBackend backend;
+	TextureStreamer streamer(backend, SyncSettings());
+	TextureStreamer::TextureId c = streamer.Register(cube.Filename());
+	TextureStreamer::TextureId a = streamer.Register(array.Filename());
+
+	// Known before anything is resident, so a placeholder can match it.
+	CHECK(backend.Descs[c].IsCubeMap && backend.Descs[c].ArraySize == 6);
+	CHECK(!backend.Descs[a].IsCubeMap && backend.Descs[a].ArraySize == 3);
+	CHECK(streamer.GetDesc(c).IsCubeMap);
+
+	// The whole file is its tail; every slice is loaded.
+	streamer.Update();
+	streamer.Update();
+	CHECK(streamer.GetResidentMip(c) == 0 && streamer.GetResidentMip(a) == 0);
+	CHECK(streamer.GetStats().ResidentBytes == 6 * MipBytes(64, 0) + 3 * MipBytes(64, 0));
+}
+
+TEST(TextureStreamer, RegisterWhileLoading)
+{
+	TempTexture file("TextureStreamerTests.5.tmp.dds", 256, 1, false);
+
+	for(std::uint32_t threads : { 0u, 2u })
+	{
+		TextureStreamer::Settings settings;
+		settings.IoThreads = threads;
+		settings.MaxPendingLoads = 8;
+
+		MockBackend backend;
+		TextureStreamer streamer(backend, settings);
+
+		// The I/O threads are busy with earlier textures while later ones are
+		// registered.
+		std::vector<TextureStreamer::TextureId> ids;
+		for(int i = 0; i < 200; ++i)
+		{
+			ids.push_back(streamer.Register(file.Filename()));
+			streamer.ReportUsage(ids[i / 2], 256.0f);
+			streamer.Update();
+		}
+
+		for(int i = 0; i < 100; ++i)
+		{
+			streamer.WaitIdle();
+			streamer.Update();
+		}
+		streamer.WaitIdle();
+
+		CHECK(streamer.GetStats().Textures == 200);
+		CHECK(streamer.GetStats().TailsLoaded == 200);
+		CHECK(streamer.GetStats().FailedTextures == 0);
+		for(TextureStreamer::TextureId id : ids)
+			CHECK(streamer.GetResidentMip(id) != TextureStreamer::NotResident);
+	}
+}
@@ -0,0 +1,262 @@
+//***************************************************************************************
+// UploadBatcherTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/UploadBatcher.h"
+#include "../../Common/Random.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
+namespace
+{
+	// A queue that executes submitted batches a number of batches late.  Copies
+	// read the staging memory when they execute, like the GPU does, so staging
+	// space recycled too early shows up as corrupted destination data.
+	class SimulatedQueue : public UploadBatcher::Backend
+	{
+	public:
+		struct Copy
+		{
+			std::vector<std::uint8_t>* Dst;
+			std::uint64_t DstOffset;
+			std::uint64_t StagingOffset;
+			std::uint64_t Size;
+		};
+
+		SimulatedQueue(std::uint64_t stagingByteSize, std::uint32_t latency) :
+			Staging(stagingByteSize),
+			Latency(latency)
+		{
+		}
+
+		void OpenBatch(std::uint32_t allocatorIndex)override
+		{
+			CHECK(!Recording);
+			CHECK(allocatorIndex <= AllocatorBusyUntil.size());
+			if(allocatorIndex == AllocatorBusyUntil.size())
+				AllocatorBusyUntil.push_back(0);
+
+			// Resetting an allocator the GPU is still using is an error in D3D12.
+			CHECK(AllocatorBusyUntil[allocatorIndex] <= Completed);
+
+			Recording = true;
+			CurrAllocator = allocatorIndex;
+			Open.clear();
+		}
+
+		std::uint64_t SubmitBatch()override
+		{
+			CHECK(Recording);
+			Recording = false;
+
+			Batch b;
+			b.Fence = ++Signaled;
+			b.Copies = Open;
+			Pending.push_back(b);
+			AllocatorBusyUntil[CurrAllocator] = b.Fence;
+
+			// Submitting lets the GPU catch up with older batches.
+			while(Pending.size() > Latency)
+				ExecuteOldest();
+
+			return b.Fence;
+		}
+
+		std::uint64_t CompletedFence()override
+		{
+			return Completed;
+		}
+
+		void WaitForCompletion(std::uint64_t fenceValue)override
+		{
+			CHECK(fenceValue <= Signaled);
+			++Waits;
+			while(Completed < fenceValue)
+				ExecuteOldest();
+		}
+
+		void RecordCopy(std::vector<std::uint8_t>& dst, std::uint64_t dstOffset, std::uint64_t stagingOffset, std::uint64_t size)
+		{
+			CHECK(Recording);
+			Open.push_back({ &dst, dstOffset, stagingOffset, size });
+		}
+
+		std::vector<std::uint8_t> Staging;
+		std::uint32_t Latency;
+		std::uint64_t Signaled = 0;
+		std::uint64_t Completed = 0;
+		std::uint32_t Waits = 0;
+
+	private:
+		struct Batch
+		{
+			std::uint64_t Fence;
+			std::vector<Copy> Copies;
+		};
+
+		void ExecuteOldest()
+		{
+			const Batch& b = Pending.front();
+			for(const Copy& c : b.Copies)
+				std::memcpy(c.Dst->data() + c.DstOffset, Staging.data() + c.StagingOffset, (size_t)c.Size);
+			Completed = b.Fence;
+			Pending.pop_front();
+		}
+
+		bool Recording = false;
+		std::uint32_t CurrAllocator = 0;
+		std::vector<Copy> Open;
+		std::deque<Batch> Pending;
+		std::vector<std::uint64_t> AllocatorBusyUntil;
+	};
+
+	// What UploadManager::CopyToBuffer does, minus the barriers.
+	void Upload(UploadBatcher& batcher, SimulatedQueue& queue, std::vector<std::uint8_t>& dst, const std::vector<std::uint8_t>& src)
+	{
+		batcher.BeginCopy();
+
+		std::uint64_t size = src.size();
+		std::uint64_t copied = 0;
+		while(copied < size)
+		{
+			std::uint64_t chunk = std::min(size - copied, batcher.StagingCapacity());
+			std::uint64_t offset = batcher.AllocateStaging(chunk, 16);
+			CHECK(offset % 16 == 0);
+
+			std::memcpy(queue.Staging.data() + offset, src.data() + copied, (size_t)chunk);
+			queue.RecordCopy(dst, copied, offset, chunk);
+			copied += chunk;
+		}
+
+		batcher.EndCopy(size);
+	}
+
+	std::vector<std::uint8_t> RandomBytes(Random& random, size_t size)
+	{
+		std::vector<std::uint8_t> bytes(size);
+		for(std::uint8_t& b : bytes)
+			b = (std::uint8_t)random.NextUInt();
+		return bytes;
+	}
+}
+
+TEST(UploadBatcher, BatchesUntilFlushOrBudget)
+{
+	SimulatedQueue queue(1024, 1);
+	UploadBatcher batcher(queue, 1024, 300);
+	Random random(34);
+
+	std::vector<std::uint8_t> a = RandomBytes(random, 100), b = RandomBytes(random, 100), c = RandomBytes(random, 150);
+	std::vector<std::uint8_t> da(100), db(100), dc(150);
+
+	Upload(batcher, queue, da, a);
+	Upload(batcher, queue, db, b);
+	CHECK(batcher.IsBatchOpen());
+	CHECK(queue.Signaled == 0);
+
+	// The third copy takes the batch over its budget and submits it.
+	Upload(batcher, queue, dc, c);
+	CHECK(!batcher.IsBatchOpen());
+	CHECK(queue.Signaled == 1);
+	CHECK(batcher.GetStats().BudgetFlushes == 1);
+
+	// Flushing with nothing open returns the last fence.
+	CHECK(batcher.Flush() == 1);
+	CHECK(!batcher.IsComplete(1));
+	batcher.WaitIdle();
+	CHECK(batcher.IsComplete(1));
+	CHECK(da == a && db == b && dc == c);
+
+	const UploadBatcher::Stats& stats = batcher.GetStats();
+	CHECK(stats.Copies == 3);
+	CHECK(stats.BytesUploaded == 350);
+	CHECK(stats.Batches == 1);
+	CHECK(stats.StagingStalls == 0);
+}
+
+TEST(UploadBatcher, ChunksLargeCopiesAndStalls)
+{
+	// A copy four times the ring goes through in chunks, stalling for each.
+	SimulatedQueue queue(4096, 2);
+	UploadBatcher batcher(queue, 4096, 1024*1024);
+	Random random(35);
+
+	std::vector<std::uint8_t> src = RandomBytes(random, 4*4096 + 123), dst(src.size());
+	Upload(batcher, queue, dst, src);
+	batcher.WaitIdle();
+
+	CHECK(dst == src);
+	CHECK(batcher.GetStats().StagingStalls == 4);
+	CHECK(batcher.GetStats().Batches == 5);
+	CHECK(batcher.GetStats().PeakStagingBytes <= 4096);
+}
+
+TEST(UploadBatcher, SimulatedUploads)
+{
+	// Random copies against a queue that runs three batches behind: every
+	// destination must end up with its own data, and allocators and staging
+	// space must only be reused after their batch executed.
+	const std::uint64_t staging = 64*1024;
+	SimulatedQueue queue(staging, 3);
+	UploadBatcher batcher(queue, staging, 16*1024);
+	Random random(36);
+
+	std::vector<std::vector<std::uint8_t>> sources, dsts;
+	sources.reserve(2000);
+	dsts.reserve(2000);
+	for(int i = 0; i < 2000; ++i)
+	{
+		size_t size = 1 + random.NextUInt(i % 100 == 0 ? 200000 : 8000);
+		sources.push_back(RandomBytes(random, size));
+		dsts.push_back(std::vector<std::uint8_t>(size));
+		Upload(batcher, queue, dsts.back(), sources.back());
+
+		if(random.NextUInt(50) == 0)
+			batcher.Flush();
+	}
+	batcher.WaitIdle();
+
+	std::uint32_t mismatches = 0;
+	for(size_t i = 0; i < sources.size(); ++i)
+		mismatches += dsts[i] != sources[i] ? 1 : 0;
+	CHECK(mismatches == 0);
+
+	const UploadBatcher::Stats& stats = batcher.GetStats();
+	CHECK(stats.Copies == 2000);
+	CHECK(stats.BudgetFlushes > 0);
+	CHECK(stats.StagingStalls > 0);
+	CHECK(stats.PeakStagingBytes <= staging);
+
+	// One allocator per batch in flight, plus the one being recorded.
+	CHECK(batcher.AllocatorCount() <= queue.Latency + 1);
+}
+
+BENCHMARK(UploadBatcher, Upload)
+{
+	const std::uint64_t staging = 16*1024*1024;
+	SimulatedQueue queue(staging, 2);
+	UploadBatcher batcher(queue, staging, 4*1024*1024);
+	Random random(37);
+
+	// Mesh sized uploads: 256 buffers of 4-64 KB per iteration.
+	std::vector<std::vector<std::uint8_t>> sources, dsts;
+	for(int i = 0; i < 256; ++i)
+	{
+		sources.push_back(RandomBytes(random, 4096 + random.NextUInt(60*1024)));
+		dsts.push_back(std::vector<std::uint8_t>(sources.back().size()));
+	}
+
+	bench.Run("256 buffers, 4-64 KB", [&]()
+	{
+		for(size_t i = 0; i < sources.size(); ++i)
+			Upload(batcher, queue, dsts[i], sources[i]);
+		batcher.Flush();
+	});
+
+	batcher.WaitIdle();
+	const UploadBatcher::Stats& stats = batcher.GetStats();
+	bench.Report("batches per iteration", (double)stats.Batches*sources.size() / stats.Copies);
+	bench.Report("stalls per iteration", (double)stats.StagingStalls*sources.size() / stats.Copies);
+}
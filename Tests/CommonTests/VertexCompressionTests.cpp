@@ -0,0 +1,371 @@
+//***************************************************************************************
+// VertexCompressionTests.cpp by DanielDFY
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "../../Common/Random.h"
+#include "../../Common/VertexCompression.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	// Same layout as the Vertex structs of the demos.
+	struct SourceVertex
+	{
+		XMFLOAT3 Pos;
+		XMFLOAT3 Normal;
+		XMFLOAT2 TexC;
+	};
+
+	XMFLOAT3 RandomDirection(Random& random)
+	{
+		// Rejection sampling in the unit ball, so every direction is equally likely.
+		for(;;)
+		{
+			XMFLOAT3 v(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f));
+			float lengthSq = v.x*v.x + v.y*v.y + v.z*v.z;
+			if(lengthSq > 1e-4f && lengthSq <= 1.0f)
+				return v;
+		}
+	}
+
+	// A box of points that does not start at the origin, with normals and UVs.
+	std::vector<SourceVertex> MakeVertices(std::uint64_t seed, UINT count)
+	{
+		Random random(seed);
+		std::vector<SourceVertex> vertices(count);
+		for(SourceVertex& v : vertices)
+		{
+			v.Pos = XMFLOAT3(random.NextFloat(-3.0f, 5.0f), random.NextFloat(10.0f, 11.0f), random.NextFloat(-40.0f, 0.0f));
+			v.Normal = RandomDirection(random);
+			v.TexC = XMFLOAT2(random.NextFloat(-2.0f, 2.0f), random.NextFloat(0.0f, 1.0f));
+		}
+
+		return vertices;
+	}
+
+	BoundingBox BoundsOf(const std::vector<SourceVertex>& vertices)
+	{
+		BoundingBox bounds;
+		BoundingBox::CreateFromPoints(bounds, vertices.size(), &vertices[0].Pos, sizeof(SourceVertex));
+		return bounds;
+	}
+
+	// In double, so the reference is exact well below the errors measured.
+	double AngleDegrees(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		double cx = (double)a.y*b.z - (double)a.z*b.y;
+		double cy = (double)a.z*b.x - (double)a.x*b.z;
+		double cz = (double)a.x*b.y - (double)a.y*b.x;
+		double dot = (double)a.x*b.x + (double)a.y*b.y + (double)a.z*b.z;
+		return atan2(sqrt(cx*cx + cy*cy + cz*cz), dot) * 180.0 / 3.14159265358979323846;
+	}
+
+	float Distance(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&a), XMLoadFloat3(&b))));
+	}
+}
+
+TEST(VertexCompression, OctahedralNormals)
+{
+	std::vector<XMFLOAT3> normals =
+	{
+		// The poles, where the lower one folds onto the corners of the square.
+		XMFLOAT3(0.0f, 0.0f, 1.0f),
+		XMFLOAT3(0.0f, 0.0f, -1.0f),
+		XMFLOAT3(1e-6f, -1e-6f, -1.0f),
+
+		// The equator, where the fold starts, from both sides.
+		XMFLOAT3(1.0f, 0.0f, 0.0f),
+		XMFLOAT3(-1.0f, 0.0f, 0.0f),
+		XMFLOAT3(0.0f, 1.0f, 0.0f),
+		XMFLOAT3(0.0f, -1.0f, 0.0f),
+		XMFLOAT3(0.6f, 0.8f, 1e-6f),
+		XMFLOAT3(0.6f, 0.8f, -1e-6f),
+		XMFLOAT3(-0.6f, 0.8f, -1e-6f),
+		XMFLOAT3(-0.8f, -0.6f, -1e-6f),
+
+		// Lower hemisphere in every quadrant.
+		XMFLOAT3(0.5f, 0.5f, -0.7071f),
+		XMFLOAT3(-0.5f, 0.5f, -0.7071f),
+		XMFLOAT3(0.5f, -0.5f, -0.7071f),
+		XMFLOAT3(-0.5f, -0.5f, -0.7071f),
+
+		// Not normalized.
+		XMFLOAT3(0.0f, 3.0f, -4.0f),
+	};
+
+	Random random(26);
+	for(int i = 0; i < 10000; ++i)
+		normals.push_back(RandomDirection(random));
+
+	const UINT count = (UINT)normals.size();
+	std::vector<XMSHORTN2> encoded(count);
+	std::vector<XMFLOAT3> decoded(count);
+	VertexCompression::EncodeUnitVectors(normals.data(), sizeof(XMFLOAT3), count, encoded.data(), sizeof(XMSHORTN2));
+	VertexCompression::DecodeUnitVectors(encoded.data(), sizeof(XMSHORTN2), count, decoded.data(), sizeof(XMFLOAT3));
+
+	VertexCompression::Report report;
+	VertexCompression::MeasureNormals(normals.data(), sizeof(XMFLOAT3), count, encoded.data(), sizeof(XMSHORTN2), report);
+
+	// 16 bits per component keep every direction within a few thousandths of a degree.
+	CHECK(report.MaxNormalError < 0.005f);
+
+	double maxError = 0.0;
+	for(UINT i = 0; i < count; ++i)
+	{
+		double error = AngleDegrees(normals[i], decoded[i]);
+		maxError = MathHelper::Max(maxError, error);
+
+		// Decoded directions are unit length.
+		CHECK_NEAR(Distance(decoded[i], XMFLOAT3(0.0f, 0.0f, 0.0f)), 1.0f, 1e-5f);
+	}
+	CHECK_NEAR(maxError, report.MaxNormalError, 1e-4f);
+
+	// The poles come back exactly.
+	CHECK(decoded[0].z == 1.0f && decoded[1].z == -1.0f && decoded[2].z == -1.0f);
+
+	// Tangents share the encoding.
+	VertexCompression::Report tangentReport;
+	VertexCompression::MeasureTangents(normals.data(), sizeof(XMFLOAT3), count, encoded.data(), sizeof(XMSHORTN2), tangentReport);
+	CHECK(tangentReport.MaxTangentError == report.MaxNormalError);
+}
+
+TEST(VertexCompression, QuantizedPositions)
+{
+	std::vector<SourceVertex> vertices = MakeVertices(1, 5000);
+	BoundingBox bounds = BoundsOf(vertices);
+
+	const UINT count = (UINT)vertices.size();
+	std::vector<XMUSHORTN4> encoded(count);
+	std::vector<XMFLOAT3> decoded(count);
+	VertexCompression::EncodePositions(&vertices[0].Pos, sizeof(SourceVertex), count, bounds, encoded.data(), sizeof(XMUSHORTN4));
+	VertexCompression::DecodePositions(encoded.data(), sizeof(XMUSHORTN4), count, bounds, decoded.data(), sizeof(XMFLOAT3));
+
+	VertexCompression::Report report;
+	VertexCompression::MeasurePositions(&vertices[0].Pos, sizeof(SourceVertex), count, bounds,
+		encoded.data(), sizeof(XMUSHORTN4), report);
+
+	// Each axis is off by at most half a step of its extent over 65535 steps.
+	XMFLOAT3 step(2.0f*bounds.Extents.x / 65535.0f, 2.0f*bounds.Extents.y / 65535.0f, 2.0f*bounds.Extents.z / 65535.0f);
+	float maxError = 0.0f;
+	for(UINT i = 0; i < count; ++i)
+	{
+		const XMFLOAT3& p = vertices[i].Pos;
+		const XMFLOAT3& q = decoded[i];
+		CHECK(fabsf(p.x - q.x) <= 0.51f*step.x && fabsf(p.y - q.y) <= 0.51f*step.y && fabsf(p.z - q.z) <= 0.51f*step.z);
+		maxError = MathHelper::Max(maxError, Distance(p, q));
+	}
+	CHECK_NEAR(maxError, report.MaxPositionError, 1e-6f);
+	CHECK(report.MaxPositionError <= 0.51f*sqrtf(step.x*step.x + step.y*step.y + step.z*step.z));
+
+	// The shader side mapping gives the same positions as DecodePositions.
+	XMFLOAT3 scale, bias;
+	VertexCompression::GetDequantizeScaleBias(bounds, scale, bias);
+	XMMATRIX toLocal = VertexCompression::GetDequantizeTransform(bounds);
+	for(UINT i = 0; i < count; i += 97)
+	{
+		const XMUSHORTN4& e = encoded[i];
+		XMFLOAT3 q(e.x / 65535.0f, e.y / 65535.0f, e.z / 65535.0f);
+		XMFLOAT3 byScaleBias(q.x*scale.x + bias.x, q.y*scale.y + bias.y, q.z*scale.z + bias.z);
+		CHECK(Distance(byScaleBias, decoded[i]) < 1e-5f);
+
+		XMFLOAT3 byMatrix;
+		XMStoreFloat3(&byMatrix, XMVector3TransformCoord(XMLoadFloat3(&q), toLocal));
+		CHECK(Distance(byMatrix, decoded[i]) < 1e-5f);
+	}
+
+	// A flat mesh does not divide by zero.
+	std::vector<XMFLOAT3> flat = { XMFLOAT3(0.0f, 2.0f, 0.0f), XMFLOAT3(1.0f, 2.0f, 1.0f) };
+	BoundingBox flatBounds;
+	BoundingBox::CreateFromPoints(flatBounds, flat.size(), flat.data(), sizeof(XMFLOAT3));
+	XMUSHORTN4 flatEncoded[2];
+	XMFLOAT3 flatDecoded[2];
+	VertexCompression::EncodePositions(flat.data(), sizeof(XMFLOAT3), 2, flatBounds, flatEncoded, sizeof(XMUSHORTN4));
+	VertexCompression::DecodePositions(flatEncoded, sizeof(XMUSHORTN4), 2, flatBounds, flatDecoded, sizeof(XMFLOAT3));
+	for(int i = 0; i < 2; ++i)
+		CHECK(Distance(flat[i], flatDecoded[i]) < 1e-4f);
+}
+
+TEST(VertexCompression, TexCoords)
+{
+	// Multiples of 1/1024 in [-2,2] are exact in half precision.
+	std::vector<XMFLOAT2> exact;
+	for(int i = -2048; i <= 2048; i += 7)
+		exact.push_back(XMFLOAT2(i / 1024.0f, -i / 2048.0f));
+
+	UINT count = (UINT)exact.size();
+	std::vector<XMHALF2> halves(count);
+	std::vector<XMFLOAT2> decoded(count);
+	VertexCompression::EncodeTexCoordsHalf(exact.data(), sizeof(XMFLOAT2), count, halves.data(), sizeof(XMHALF2));
+	VertexCompression::DecodeTexCoordsHalf(halves.data(), sizeof(XMHALF2), count, decoded.data(), sizeof(XMFLOAT2));
+	for(UINT i = 0; i < count; ++i)
+		CHECK(decoded[i].x == exact[i].x && decoded[i].y == exact[i].y);
+
+	// Anything else within half a unit in the last place (11 bits).
+	std::vector<SourceVertex> vertices = MakeVertices(2, 5000);
+	count = (UINT)vertices.size();
+	halves.resize(count);
+	decoded.resize(count);
+	VertexCompression::EncodeTexCoordsHalf(&vertices[0].TexC, sizeof(SourceVertex), count, halves.data(), sizeof(XMHALF2));
+	VertexCompression::DecodeTexCoordsHalf(halves.data(), sizeof(XMHALF2), count, decoded.data(), sizeof(XMFLOAT2));
+
+	VertexCompression::Report report;
+	VertexCompression::MeasureTexCoords(&vertices[0].TexC, sizeof(SourceVertex), count,
+		halves.data(), sizeof(XMHALF2), report);
+
+	float maxError = 0.0f;
+	for(UINT i = 0; i < count; ++i)
+	{
+		const XMFLOAT2& uv = vertices[i].TexC;
+		float dx = fabsf(uv.x - decoded[i].x);
+		float dy = fabsf(uv.y - decoded[i].y);
+		CHECK(dx <= fabsf(uv.x)*(1.0f / 2048.0f) + 1e-7f && dy <= fabsf(uv.y)*(1.0f / 2048.0f) + 1e-7f);
+		maxError = MathHelper::Max(maxError, MathHelper::Max(dx, dy));
+	}
+	CHECK(maxError == report.MaxTexCError);
+	CHECK(report.MaxTexCError <= 1.0f / 1024.0f);
+
+	// UNORM UVs are clamped to [0,1] and off by at most half a step inside.
+	std::vector<XMUSHORTN2> unorms(count);
+	VertexCompression::EncodeTexCoordsUNorm(&vertices[0].TexC, sizeof(SourceVertex), count, unorms.data(), sizeof(XMUSHORTN2));
+	VertexCompression::DecodeTexCoordsUNorm(unorms.data(), sizeof(XMUSHORTN2), count, decoded.data(), sizeof(XMFLOAT2));
+	for(UINT i = 0; i < count; ++i)
+	{
+		float u = MathHelper::Clamp(vertices[i].TexC.x, 0.0f, 1.0f);
+		float v = MathHelper::Clamp(vertices[i].TexC.y, 0.0f, 1.0f);
+		CHECK(fabsf(u - decoded[i].x) <= 0.51f / 65535.0f && fabsf(v - decoded[i].y) <= 0.51f / 65535.0f);
+	}
+}
+
+TEST(VertexCompression, BoneWeights)
+{
+	std::vector<XMFLOAT3> weights =
+	{
+		// Each rounds up on its own and would sum to 256 or more.
+		XMFLOAT3(1.0f, 1.0f, 1.0f),
+		XMFLOAT3(0.5f, 0.5f, 0.5f),
+		XMFLOAT3(0.333f, 0.333f, 0.333f),
+
+		// Out of range and degenerate.
+		XMFLOAT3(2.0f, 0.0f, 0.0f),
+		XMFLOAT3(-1.0f, 0.25f, 0.0f),
+		XMFLOAT3(0.0f, 0.0f, 0.0f),
+		XMFLOAT3(1.0f, 0.0f, 0.0f),
+	};
+
+	Random random(28);
+	for(int i = 0; i < 10000; ++i)
+	{
+		float w0 = random.NextFloat();
+		float w1 = random.NextFloat(0.0f, 1.0f - w0);
+		float w2 = random.NextFloat(0.0f, 1.0f - w0 - w1);
+		weights.push_back(XMFLOAT3(w0, w1, w2));
+	}
+
+	const UINT count = (UINT)weights.size();
+	std::vector<XMUBYTEN4> encoded(count);
+	std::vector<XMFLOAT3> decoded(count);
+	VertexCompression::EncodeBoneWeights(weights.data(), sizeof(XMFLOAT3), count, encoded.data(), sizeof(XMUBYTEN4));
+	VertexCompression::DecodeBoneWeights(encoded.data(), sizeof(XMUBYTEN4), count, decoded.data(), sizeof(XMFLOAT3));
+
+	for(const XMUBYTEN4& w : encoded)
+		CHECK(w.x + w.y + w.z + w.w == 255);
+
+	// Weights above 1 in total are scaled to 1, so the implied 4th is 0.
+	CHECK(encoded[0].x == 85 && encoded[0].y == 85 && encoded[0].z == 85 && encoded[0].w == 0);
+	CHECK(encoded[1].x == 85 && encoded[1].y == 85 && encoded[1].z == 85 && encoded[1].w == 0);
+	CHECK(encoded[3].x == 255 && encoded[3].w == 0);
+	CHECK(encoded[4].x == 0 && encoded[4].y == 64 && encoded[4].w == 191);
+	CHECK(encoded[5].w == 255);
+	CHECK(encoded[6].x == 255 && encoded[6].w == 0);
+
+	VertexCompression::Report report;
+	VertexCompression::MeasureBoneWeights(weights.data(), sizeof(XMFLOAT3), count, encoded.data(), sizeof(XMUBYTEN4), report);
+
+	// In range weights move by half a step, plus the 1 or 2 steps handed to
+	// the largest weight to keep the sum.
+	float maxError = 0.0f;
+	for(UINT i = 7; i < count; ++i)
+	{
+		const XMFLOAT3& w = weights[i];
+		const XMFLOAT3& d = decoded[i];
+		maxError = MathHelper::Max(maxError,
+			MathHelper::Max(fabsf(w.x - d.x), MathHelper::Max(fabsf(w.y - d.y), fabsf(w.z - d.z))));
+	}
+	CHECK(maxError <= 2.5f / 255.0f);
+	CHECK(maxError <= report.MaxBoneWeightError + 1e-6f);
+	CHECK(report.MaxBoneWeightError <= 2.5f / 255.0f);
+}
+
+TEST(VertexCompression, CompressReport)
+{
+	std::vector<SourceVertex> vertices = MakeVertices(3, 4000);
+	BoundingBox bounds = BoundsOf(vertices);
+
+	const UINT count = (UINT)vertices.size();
+	std::vector<VertexCompression::Vertex> packed(count);
+	VertexCompression::Report report;
+	VertexCompression::Compress(vertices.data(), count, bounds, packed.data(), &report);
+
+	CHECK(sizeof(VertexCompression::Vertex) == 16);
+	CHECK(report.VertexCount == count);
+	CHECK(report.SourceByteSize == count*sizeof(SourceVertex));
+	CHECK(report.CompressedByteSize == count*16);
+
+	// The report matches what the vertices decode to.
+	std::vector<XMFLOAT3> positions(count);
+	std::vector<XMFLOAT3> normals(count);
+	std::vector<XMFLOAT2> texCoords(count);
+	const UINT ps = sizeof(VertexCompression::Vertex);
+	VertexCompression::DecodePositions(&packed[0].Pos, ps, count, bounds, positions.data(), sizeof(XMFLOAT3));
+	VertexCompression::DecodeUnitVectors(&packed[0].Normal, ps, count, normals.data(), sizeof(XMFLOAT3));
+	VertexCompression::DecodeTexCoordsHalf(&packed[0].TexC, ps, count, texCoords.data(), sizeof(XMFLOAT2));
+
+	double positionSum = 0.0, normalSum = 0.0;
+	float positionMax = 0.0f, texCMax = 0.0f;
+	double normalMax = 0.0;
+	for(UINT i = 0; i < count; ++i)
+	{
+		float positionError = Distance(vertices[i].Pos, positions[i]);
+		double normalError = AngleDegrees(vertices[i].Normal, normals[i]);
+		positionSum += positionError;
+		normalSum += normalError;
+		positionMax = MathHelper::Max(positionMax, positionError);
+		normalMax = MathHelper::Max(normalMax, normalError);
+		texCMax = MathHelper::Max(texCMax,
+			MathHelper::Max(fabsf(vertices[i].TexC.x - texCoords[i].x), fabsf(vertices[i].TexC.y - texCoords[i].y)));
+	}
+
+	CHECK_NEAR(report.MaxPositionError, positionMax, 1e-6f);
+	CHECK_NEAR(report.AvgPositionError, positionSum / count, 1e-6f);
+	CHECK_NEAR(report.MaxNormalError, normalMax, 1e-4f);
+	CHECK_NEAR(report.AvgNormalError, normalSum / count, 1e-4f);
+	CHECK(report.MaxTexCError == texCMax);
+	CHECK(report.AvgPositionError <= report.MaxPositionError && report.AvgNormalError <= report.MaxNormalError);
+
+	// Vertices without a report compress the same.
+	std::vector<VertexCompression::Vertex> again(count);
+	VertexCompression::Compress(vertices.data(), count, bounds, again.data());
+	CHECK(memcmp(again.data(), packed.data(), count*sizeof(VertexCompression::Vertex)) == 0);
+}
+
+BENCHMARK(VertexCompression, Compress)
+{
+	std::vector<SourceVertex> vertices = MakeVertices(4, 100000);
+	BoundingBox bounds = BoundsOf(vertices);
+
+	const UINT count = (UINT)vertices.size();
+	std::vector<VertexCompression::Vertex> packed(count);
+	bench.Run("100k vertices", [&]() { VertexCompression::Compress(vertices.data(), count, bounds, packed.data()); });
+
+	VertexCompression::Report report;
+	bench.Run("100k vertices with report", [&]() { VertexCompression::Compress(vertices.data(), count, bounds, packed.data(), &report); });
+	bench.Report("max normal error", report.MaxNormalError, "deg");
+}